@@ -0,0 +1,58 @@
+/* BootStub.c - runs from the start of the flash before the application: finishes a firmware update swap (or its revert)
+   and starts the image in slot A */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/scb.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/regs/m0plus.h"
+#include "hardware/sync.h"
+
+/* Include files from the application */
+#include "BootControl.h"
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void BootStubStartImage(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Same as the bootrom does with boot2: vector table of the image, its stack pointer, its reset handler. The image starts the
+   way the bootrom starts one - PRIMASK clear (its main sleeps and sets up USB before the scheduler would clear it), none of the
+   interrupts the runtime of the stub enabled left enabled or pending. They are masked one by one in the NVIC for the switch of
+   the stack, PRIMASK only cleared right before the jump */
+void BootStubStartImage(void)
+{
+	const uint32_t *vectors = (const uint32_t *)BOOT_FLASH_PTR(BOOT_SLOT_A_OFFSET + BOOT_APP_VECTOR_OFFSET);
+
+	(void)save_and_disable_interrupts();
+	*(io_rw_32 *)(PPB_BASE + M0PLUS_NVIC_ICER_OFFSET) = 0xFFFFFFFFU;
+	*(io_rw_32 *)(PPB_BASE + M0PLUS_NVIC_ICPR_OFFSET) = 0xFFFFFFFFU;
+	scb_hw->vtor = (uint32_t)vectors;
+	__asm volatile (
+		"msr msp, %0\n"
+		"cpsie i\n"
+		"bx %1\n"
+		:
+		: "r" (vectors[0]), "r" (vectors[1])
+		: "memory");
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+	BootControl_Service();
+
+	/* A new image which hangs before it gets to its own watchdog still comes back here - and uses up an attempt */
+	if(BootControl_GetState() == BOOT_STATE_TESTING)
+	{
+		watchdog_enable(BOOT_TEST_WATCHDOG_IN_MS, true);
+	}
+
+	BootStubStartImage();
+	return 0;
+}
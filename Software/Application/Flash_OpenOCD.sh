@@ -2,7 +2,7 @@
 
 echo "Flashing the board using Picoprobe and OpenOCD"
 
-openocd -f interface/cmsis-dap.cfg -f target/rp2040.cfg -c "adapter speed 5000" -c "program build/SwComponents/ElectronicBlinds_Main.elf verify reset exit" 
+openocd -f interface/cmsis-dap.cfg -f target/rp2040.cfg -c "adapter speed 5000" -c "program build/BootStub/BootStub.elf verify" -c "program build/SwComponents/ElectronicBlinds_Main.elf verify reset exit" 
 
 echo "Press any key to exit..."
 read -n 1 -s 
@@ -2,6 +2,8 @@
 #define AUTOMATICCONTROLTASK_H
 
 /*--------------- INCLUDES ---------------*/
+#include <stdint.h>
+#include <stdbool.h>
 #include <math.h>
 
 /*--------------- MACROS ---------------*/
@@ -20,15 +22,33 @@
 #define LATITUDE_SIEROSZEWICE_NOWA_10   (51.635799) //in degrees
 #define LONGITUDE_SIEROSZEWICE_NOWA_10   (17.966808) //in degrees
 #define TIME_ZONE_PLUS_TO_E (2)
+/* The location and time zone above are the build defaults of the site configuration (SiteConfig.h) */
 
 #define degToRad(angleInDegrees) ((angleInDegrees) * M_PI / 180.0)
 #define radToDeg(angleInRadians) ((angleInRadians) * 180.0 / M_PI)
 
+/* How far the ambient light level (LightSensor) may move the sunrise/sunset */
+#define LIGHT_SENSOR_SCHEDULE_SHIFT_IN_HOURS    (1.0)
+
 #define BLINDS_CLOSED   (1)
 #define BLINDS_OPEN     (0)
+#define BLINDS_UNKNOWN  (0xFF) //not read from the DS1307 yet
 
 /*--------------- GLOBAL VARIABLES DECLARATION (extern) ---------------*/
 void AutomaticControlTask( void *pvParameters );
 
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+/* Calendar and sun helpers - the schedule compiler (Schedule.c) uses them too */
+uint8_t ZellersCongruence(int year, int month, int day);
+bool isLeapYear(uint32_t year);
+bool isDST(uint32_t yearBCD, uint32_t monthBCD, uint32_t dayBCD);
+uint32_t CalculateDayOfYear(uint32_t yearBCD, uint32_t monthBCD, uint32_t dayBCD);
+void CalculateSolarDay(int dayOfYear, int timeZone, double* declination, double* eqOfTime);
+void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, int timeZone, double* sunrise, double* sunset);
+
+/* What DS1307_REG_ADDR_IS_CLOSED should hold after a power cut - the state before the move of the schedule while it has not ended at
+   the limit switches yet (the move is started again after the boot), the stored state otherwise. From any context (PowerMonitor.c) */
+uint8_t AutomaticControl_ClosedToStore(void);
+
 #endif /* AUTOMATICCONTROLTASK_H */
 
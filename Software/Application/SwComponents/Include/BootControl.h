@@ -0,0 +1,96 @@
+#ifndef BOOTCONTROL_H
+#define BOOTCONTROL_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/flash.h"
+#include "Hash.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Flash layout (offsets from the start of the 2MB flash) - the FLASH regions of the linker scripts in ../CMakeLists.txt
+   and ../BootStub/CMakeLists.txt have to match it */
+#define BOOT_FLASH_SIZE						(2048U * 1024U)
+#define BOOT_STUB_OFFSET					(0x000000U)	/* boot2 and the boot stub (BootStub/) - never updated over USB */
+#define BOOT_STUB_SIZE						(32U * 1024U)
+#define BOOT_SLOT_SIZE						(960U * 1024U)
+#define BOOT_SLOT_A_OFFSET					(0x008000U)	/* the image that runs - the firmware is linked to this address */
+#define BOOT_SLOT_B_OFFSET					(0x0F8000U)	/* the download slot, the previous image after a swap */
+#define BOOT_SCRATCH_OFFSET					(0x1E8000U)	/* one sector - the swap of a sector goes through it */
+#define BOOT_CONFIG_OFFSET					(0x1E9000U)	/* one sector - the site configuration (SiteConfig.c), kept over the updates */
+#define BOOT_TRACE_OFFSET					(0x1EC000U)	/* field trace (Trace.c), up to the boot control sector */
+#define BOOT_TRACE_SIZE						(BOOT_CONTROL_OFFSET - BOOT_TRACE_OFFSET)
+#define BOOT_CONTROL_OFFSET					(0x1FF000U)	/* boot control sector - the last sector of the flash */
+#define BOOT_SLOT_SECTORS					(BOOT_SLOT_SIZE / FLASH_SECTOR_SIZE)
+#define BOOT_APP_VECTOR_OFFSET				(0x100U)	/* an image starts with its copy of boot2 (256 bytes), the vector table follows */
+
+#define BOOT_FLASH_PTR(offset)				((const uint8_t *)(XIP_BASE + (offset)))
+
+/* Swap of a sector: slot A -> scratch, slot B -> slot A, scratch -> slot B. Every step is repeatable as long as its source
+   is intact, so a swap interrupted by a power loss or a reset continues with the step it did not record as done */
+#define BOOT_SWAP_STEPS_PER_SECTOR			(3U)
+
+/* A new image has this many boots to confirm itself (Update confirms after running UPDATE_CONFIRM_DELAY_IN_MS),
+   the stub rolls it back then. The stub keeps the watchdog running for an image under test until Watchdog_Init */
+#define BOOT_MAX_ATTEMPTS					(3U)
+#define BOOT_TEST_WATCHDOG_IN_MS			(8000U)		/* close to the 8.3s maximum - the start-up delay of the firmware is 4s */
+
+/* Boot control sector - one page per record. The request page is programmed once (the commit point of an update,
+   valid only with its CRC), the progress pages are bitmaps: every step done clears the next bit (NOR flash bits only go
+   from 1 to 0 until the sector is erased, so a page can be programmed again with one more bit cleared) */
+#define BOOT_CONTROL_PAGE_REQUEST			(0U)
+#define BOOT_CONTROL_PAGE_SWAP				(1U)		/* steps of the swap done */
+#define BOOT_CONTROL_PAGE_ATTEMPTS			(2U)		/* boots of the new image */
+#define BOOT_CONTROL_PAGE_CONFIRM			(3U)
+#define BOOT_CONTROL_PAGE_REVERT			(4U)		/* steps of the roll-back swap done */
+#define BOOT_REQUEST_MAGIC					(0x54445055U)	/* "UPDT" */
+#define BOOT_CONFIRM_MAGIC					(0x464E4F43U)	/* "CONF" */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	BOOT_STATE_NONE,						/* no update recorded - the image was flashed with the debug probe */
+	BOOT_STATE_SWAPPING,					/* update requested, the swap is not finished yet */
+	BOOT_STATE_TESTING,						/* new image in slot A, not confirmed yet */
+	BOOT_STATE_CONFIRMED,					/* new image in slot A, confirmed */
+	BOOT_STATE_REVERTING,					/* roll-back swap started, not finished yet */
+	BOOT_STATE_REVERTED						/* the new image never confirmed itself - the previous one is back in slot A */
+}BootState_t;
+
+/* The request page - the staged image is slot B for the changed sectors and slot A for all the others,
+   so the sectors the update does not change are neither written nor swapped */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t imageSize;						/* size of the new image */
+	uint32_t sectors;						/* sectors the new image covers */
+	uint8_t changedSectors[(BOOT_SLOT_SECTORS + 7U) / 8U];	/* one bit per sector */
+	uint8_t hash[HASH_SHA256_SIZE];			/* SHA-256 of the new image */
+	uint32_t crc;							/* CRC-32 of everything above */
+}BootRequest_t;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* State of the boot control sector - used by the firmware and by the boot stub */
+const BootRequest_t* BootControl_Request(void);
+BootState_t BootControl_GetState(void);
+uint32_t BootControl_Attempts(void);
+bool BootControl_SectorChanged(const BootRequest_t *request, uint32_t sector);
+void BootControl_HashStagedImage(const BootRequest_t *request, uint8_t hash[HASH_SHA256_SIZE]);
+
+/* Firmware side - the running image, the download slot and the records of an update (each flash operation in one
+   flash_safe_execute, the caller makes sure the watchdog does not expire during an erase) */
+uint32_t BootControl_RunningImageSize(void);
+void BootControl_HashRunningImage(uint8_t hash[HASH_SHA256_SIZE]);
+bool BootControl_WriteSector(uint32_t offset, const uint8_t *data);
+bool BootControl_WriteRequest(const BootRequest_t *request);
+bool BootControl_Confirm(void);
+bool BootControl_Erase(uint32_t offset);
+bool BootControl_Program(uint32_t offset, const uint8_t *data, uint32_t length);
+
+/* Boot stub side - finishes an interrupted swap, swaps a new image in, counts its boots and rolls it back */
+void BootControl_Service(void);
+
+#endif /* BOOTCONTROL_H */
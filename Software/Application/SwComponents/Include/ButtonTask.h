@@ -4,11 +4,29 @@
 /*---------------- INCLUDES ----------------------*/
 #include "MotorControllerTask.h"
 
+/*--------------- DATA TYPES ---------------*/
+
+/* Statistics of the closed-loop limit switch back-off (all times in us) */
+typedef struct
+{
+	uint32_t count;				/* Number of completed back-offs */
+	uint32_t timeouts;			/* Switch did not release within LIMIT_SWITCH_BACKOFF_TIMEOUT_IN_US - motor stopped */
+	uint32_t bounces;			/* Switch got pressed again during the extra travel */
+	uint32_t lastOvershoot_us;	/* Time the switch stayed pressed - from the first raw edge until the release edge */
+	uint32_t minOvershoot_us;
+	uint32_t maxOvershoot_us;
+	uint64_t sumOvershoot_us;
+	uint32_t lastBackoff_us;	/* Time the motor was reversing - from the debounced press until the motor stopped */
+	uint32_t maxBackoff_us;
+}LimitSwitchStats_t;
+
 /*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
-extern MotorState_t MotorState_Requested;
 extern SemaphoreHandle_t ButtonSemaphore;
+extern volatile uint32_t LimitSwitchBackoffActive;						/* one bit per channel */
+extern volatile uint32_t TopLimitReached, BottomLimitReached;			/* one bit per channel */
+extern LimitSwitchStats_t TopLimitStats[BLINDS_NUM_OF_CHANNELS], BottomLimitStats[BLINDS_NUM_OF_CHANNELS];
 
 /*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
 void ButtonTask( void *pvParameters );
 
-#endif /* BUTTONTASK_H */
\ No newline at end of file
+#endif /* BUTTONTASK_H */
@@ -0,0 +1,68 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+#define BLINDS_MAX_NUM_OF_CHANNELS			(4U)
+#define CHANNEL_BIT(channel)				(1UL << (channel))
+#define ALL_CHANNELS_MASK					(CHANNEL_BIT(BLINDS_NUM_OF_CHANNELS) - 1UL)
+#define CHANNEL_NONE						(0xFFU)
+#define CHANNEL_NUM_OF_GPIOS				(32U)
+
+/* IO_BANK0 packs 4 interrupt bits (LEVEL_LOW, LEVEL_HIGH, EDGE_LOW, EDGE_HIGH) of 8 GPIOs into each INTR/INTE/INTS register */
+#define GPIO_IRQ_NUM_OF_REGS				(4U)
+#define GPIO_IRQ_REG(gpio)					((gpio) / 8U)
+#define GPIO_IRQ_BITS(gpio, events)			((uint32_t)(events) << (4U * ((gpio) % 8U)))
+#define GPIO_IRQ_ALL_GPIOS(events)			((uint32_t)(events) * 0x11111111UL)
+#define GPIO_IRQ_BOTH_EDGES					(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	CHANNEL_INPUT_UP,
+	CHANNEL_INPUT_DOWN,
+	CHANNEL_INPUT_TOP_LIMIT,
+	CHANNEL_INPUT_BOTTOM_LIMIT,
+	CHANNEL_NUM_OF_INPUTS
+}ChannelInput_t;
+
+/* Channel descriptors - structure of arrays, every field is an array indexed by the channel, so a loop over
+   the channels (e.g. the motor outputs in MotorControllerTask) walks through consecutive bytes.
+   The table holds all the channels the board supports, only the first BLINDS_NUM_OF_CHANNELS are used. The pins of a site
+   are in its configuration block (SiteConfig->channels) */
+typedef struct
+{
+	uint8_t inputGpio[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS];
+	uint8_t motorControl1Gpio[BLINDS_MAX_NUM_OF_CHANNELS];
+	uint8_t motorControl2Gpio[BLINDS_MAX_NUM_OF_CHANNELS];
+}ChannelConfig_t;
+
+/* Lookup tables of the GPIO interrupt handler and the motor outputs (built by Channels_Init from the site configuration) - in SRAM,
+   the hot paths never read the configuration block through the XIP cache */
+typedef struct
+{
+	uint8_t channel[CHANNEL_NUM_OF_GPIOS];								/* Channel of the input, CHANNEL_NONE if the GPIO isn't one */
+	uint8_t input[CHANNEL_NUM_OF_GPIOS];								/* ChannelInput_t of the input */
+	uint32_t upDownIrqBits[GPIO_IRQ_NUM_OF_REGS];						/* Both edges of all the Up/Down buttons, per interrupt register */
+	uint32_t limitIrqBits[GPIO_IRQ_NUM_OF_REGS];						/* Both edges of all the limit switches, per interrupt register */
+	uint32_t channelIrqBits[GPIO_IRQ_NUM_OF_REGS][BLINDS_NUM_OF_CHANNELS];	/* Both edges of all the inputs of a channel */
+	uint32_t usedIrqRegs;												/* Bit per interrupt register with at least one input */
+	uint32_t inputsMask;												/* All the inputs as a GPIO bitmask (gpio_get_all) */
+	uint32_t motorOutputsMask;											/* All the motor outputs as a GPIO bitmask */
+	uint8_t inputGpio[CHANNEL_NUM_OF_INPUTS][BLINDS_NUM_OF_CHANNELS];	/* GPIO of an input of a channel */
+	uint32_t motorControl1Mask[BLINDS_NUM_OF_CHANNELS];					/* The motor outputs of a channel as GPIO bitmasks */
+	uint32_t motorControl2Mask[BLINDS_NUM_OF_CHANNELS];
+}ChannelLookup_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern ChannelLookup_t ChannelLookup;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void Channels_Init(void);
+
+#endif /* CHANNELS_H */
@@ -0,0 +1,165 @@
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include "hardware/structs/systick.h"
+#include "hardware/timer.h"
+#include "hardware/structs/xip_ctrl.h"
+
+/*--------------- MACROS ---------------*/
+
+/* clk_sys as set up by the SDK (the firmware does not change it) */
+#define CYCLE_COUNTER_CLK_SYS_MHZ			(125U)
+/* Measurements shorter than this use SysTick (exact), longer ones the 1us timer - SysTick wraps every 1ms */
+#define CYCLE_COUNTER_SYSTICK_LIMIT_IN_US	(500U)
+/* The XIP cache counters (CTR_ACC, CTR_HIT) saturate - they are cleared once the accesses get past this */
+#define CYCLE_COUNTER_XIP_CLEAR_LIMIT		(0x80000000U)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Measured code sections - one entry per interrupt handler and per task job (one iteration of the task loop) */
+typedef enum
+{
+	CYCLES_ISR_GPIO,						/* IO_IRQ_BANK0 - buttons and limit switches */
+	CYCLES_ISR_TIMER_UPDOWNBUTTONS,			/* TIMER_IRQ_0 (timer service) - Up/Down button debouncing */
+	CYCLES_ISR_TIMER_LIMITSWITCHES,			/* TIMER_IRQ_0 (timer service) - limit switch debouncing and back-off */
+	CYCLES_TASK_BUTTON,						/* ButtonTask */
+	CYCLES_TASK_MOTOR_CONTROLLER,			/* MotorControllerTask (from obtaining the semaphore) */
+	CYCLES_TASK_AUTOMATIC_CONTROL,			/* AutomaticControlTask - the decision */
+	CYCLES_TASK_SOLAR_WORKER,				/* SolarWorkerTask - the clock, the schedule of the year and the sun of the day */
+	CYCLES_NUM_OF_ITEMS
+}CycleItem_t;
+
+/* XIP cache counters at the start of a measurement */
+typedef struct
+{
+	uint32_t accesses;
+	uint32_t hits;
+}XipSample_t;
+
+/* Start of a task job measurement */
+typedef struct
+{
+	uint32_t systick;
+	uint32_t time_us;
+	XipSample_t xip;
+}CycleTimestamp_t;
+
+/* Execution time statistics in clk_sys cycles */
+typedef struct
+{
+	uint32_t count;
+	uint32_t last;
+	uint32_t worst;
+	uint64_t total;
+}CycleStats_t;
+
+/* Flash (XIP) accesses that missed the XIP cache - every miss stalls the core for a read over the QSPI bus */
+typedef struct
+{
+	uint64_t accesses;
+	uint64_t misses;
+	uint32_t last;							/* misses of the last run */
+	uint32_t worst;
+	uint32_t atWorstCycles;					/* misses of the run with the worst execution time */
+}XipStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern CycleStats_t CycleStats[CYCLES_NUM_OF_ITEMS];
+extern XipStats_t XipStats[CYCLES_NUM_OF_ITEMS];
+extern const char *const CycleItemNames[CYCLES_NUM_OF_ITEMS];
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Cortex-M0+ has no cycle counter (DWT), but SysTick counts down at clk_sys - FreeRTOS runs it with a 1ms reload,
+   so it can be used to measure anything shorter than that. SysTick is per core, so the start and the end
+   of a measurement have to be taken on the same core (true for an interrupt handler) */
+static inline uint32_t CycleCounter_Start(void)
+{
+	return systick_hw->cvr;
+}
+
+static inline uint32_t CycleCounter_Elapsed(uint32_t startCycles)
+{
+	uint32_t endCycles = systick_hw->cvr;
+	return (startCycles >= endCycles) ? (startCycles - endCycles) : (startCycles + (systick_hw->rvr + 1U) - endCycles);
+}
+
+static inline void CycleCounter_Record(CycleItem_t item, uint32_t cycles)
+{
+	CycleStats_t *stats = &CycleStats[item];
+	stats->count++;
+	stats->last = cycles;
+	stats->total += cycles;
+	if(cycles > stats->worst) stats->worst = cycles;
+}
+
+static inline void CycleCounter_Stop(CycleItem_t item, uint32_t startCycles)
+{
+	CycleCounter_Record(item, CycleCounter_Elapsed(startCycles));
+}
+
+/* The XIP cache is shared by both cores (and the DMA) - the accesses of the other core during a measurement are counted too.
+   Call CycleCounter_XipStop after CycleCounter_Stop of the same item, it takes the misses of the worst run from there */
+static inline XipSample_t CycleCounter_XipStart(void)
+{
+	XipSample_t sample;
+	sample.accesses = xip_ctrl_hw->ctr_acc;
+	sample.hits = xip_ctrl_hw->ctr_hit;
+	return sample;
+}
+
+static inline void CycleCounter_XipStop(CycleItem_t item, XipSample_t start)
+{
+	XipSample_t end = CycleCounter_XipStart();
+	if((end.accesses < start.accesses) || (end.hits < start.hits))
+	{
+		return; /* cleared in between */
+	}
+	uint32_t accesses = end.accesses - start.accesses;
+	uint32_t hits = end.hits - start.hits;
+	uint32_t misses = (accesses > hits) ? (accesses - hits) : 0U; /* the two counters are not read at once */
+
+	XipStats_t *stats = &XipStats[item];
+	stats->accesses += accesses;
+	stats->misses += misses;
+	stats->last = misses;
+	if(misses > stats->worst) stats->worst = misses;
+	if(CycleStats[item].last == CycleStats[item].worst) stats->atWorstCycles = misses;
+
+	if(end.accesses >= CYCLE_COUNTER_XIP_CLEAR_LIMIT)
+	{
+		xip_ctrl_hw->ctr_acc = 0U;
+		xip_ctrl_hw->ctr_hit = 0U;
+	}
+}
+
+/* Task jobs can take longer than the SysTick period (e.g. the I2C transfers of SolarWorkerTask), those are measured
+   with the 1us timer instead. The measured time includes the preemption by interrupts and higher priority tasks, 
+   and a job that migrated to the other core in between only gets the 1us timer's resolution right */
+static inline CycleTimestamp_t CycleCounter_TaskStart(void)
+{
+	CycleTimestamp_t timestamp;
+	timestamp.systick = systick_hw->cvr;
+	timestamp.time_us = timer_hw->timerawl;
+	timestamp.xip = CycleCounter_XipStart();
+	return timestamp;
+}
+
+static inline void CycleCounter_TaskStop(CycleItem_t item, CycleTimestamp_t start)
+{
+	uint32_t elapsed_us = timer_hw->timerawl - start.time_us;
+	uint32_t cycles = (elapsed_us < CYCLE_COUNTER_SYSTICK_LIMIT_IN_US) ? CycleCounter_Elapsed(start.systick) : (elapsed_us * CYCLE_COUNTER_CLK_SYS_MHZ);
+	CycleCounter_Record(item, cycles);
+	CycleCounter_XipStop(item, start.xip);
+}
+
+void CycleCounter_Reset(void);
+void CycleCounter_Report(void);
+
+/* USB link commands */
+void CycleCounter_Info(const uint8_t *payload, uint32_t length);
+void CycleCounter_ResetRemote(void);
+
+#endif /* CYCLECOUNTER_H */
@@ -0,0 +1,80 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "Channels.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Adaptive debounce - ButtonTask timestamps every edge of an input from its first rising edge on, the press is stable once the
+   input has been quiet for the settle window of the input (but never later than the fixed delay of ElectronicBlinds_Main.h -
+   a contact that keeps chattering is sampled then, as before). The bounce of every stable press (first to last edge) goes into
+   a histogram of the input, the settle window is a high percentile of it plus a margin, within the bounds below */
+#define DEBOUNCE_NUM_OF_BINS				(32U)
+#define DEBOUNCE_PERCENTILE					(95U)
+#define DEBOUNCE_MIN_SAMPLES				(8U)		/* until then the settle window stays at the maximum (or the one loaded) */
+#define DEBOUNCE_AGING_SAMPLES				(256U)		/* the bins are halved then - a wearing contact is followed */
+#define DEBOUNCE_MAX_EDGES					(64U)		/* per press - the input is masked for the rest of the fixed delay then */
+
+#define DEBOUNCE_BUTTON_BIN_IN_US			(2000U)		/* 64ms of bounce in the bins, the last one takes all the longer ones */
+#define DEBOUNCE_BUTTON_MARGIN_IN_US		(5000U)
+#define DEBOUNCE_BUTTON_MIN_IN_US			(10000U)
+#define DEBOUNCE_BUTTON_MAX_IN_US			DEBOUNCING_DELAY_IN_US	/* the build default - SiteConfig->debounceButton_us at runtime */
+#define DEBOUNCE_LIMIT_BIN_IN_US			(250U)		/* 8ms */
+#define DEBOUNCE_LIMIT_MARGIN_IN_US			(1000U)
+#define DEBOUNCE_LIMIT_MIN_IN_US			(2000U)
+#define DEBOUNCE_LIMIT_MAX_IN_US			DEBOUNCING_DELAY_IN_US_LIMITTER	/* SiteConfig->debounceLimit_us at runtime */
+
+/* DEBOUNCE_INFO payload: the input (channel * CHANNEL_NUM_OF_INPUTS + ChannelInput_t) ->
+   #DEBOUNCE <channel> <input> <settle us> <samples> <p50 us> <p95 us> <longest us> */
+#define DEBOUNCE_INFO_PAYLOAD_SIZE			(1U)
+
+/* The learned settle windows are kept in the battery backed RAM of the DS1307 (in units of DEBOUNCE_STORE_UNIT_IN_US) */
+#define DEBOUNCE_NVRAM_ADDR					(0x28U)			/* past TimeSyncState_t */
+#define DEBOUNCE_MAGIC						(0x4244U)		/* "DB" */
+#define DEBOUNCE_STORE_UNIT_IN_US			(500U)
+#define DEBOUNCE_DS1307_I2C_ADDRESS			(0x68U)
+#define DEBOUNCE_I2C_TIMEOUT_IN_US			(5000U)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Structure of arrays, indexed by the input and the channel (like ChannelConfig) */
+typedef struct
+{
+	uint16_t bins[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS][DEBOUNCE_NUM_OF_BINS];
+	uint32_t samples[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS];		/* in the bins */
+	uint32_t settle_us[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS];
+	uint32_t longest_us[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS];		/* since the boot */
+	volatile bool dirty;														/* a settle window to be saved */
+}DebounceStats_t;
+
+typedef struct
+{
+	uint16_t magic;
+	uint16_t reserved;
+	uint8_t settle[CHANNEL_NUM_OF_INPUTS][BLINDS_MAX_NUM_OF_CHANNELS];		/* 0 - not learned */
+	uint32_t crc;															/* Hash_Crc32 of the fields above */
+}DebounceState_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern DebounceStats_t DebounceStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Before the tasks start - loads the settle windows learned before the reboot */
+void Debounce_Init(void);
+
+/* ButtonTask (interrupt context) */
+uint32_t Debounce_Settle(uint32_t channel, uint32_t input);
+uint32_t Debounce_Max(uint32_t input);
+void Debounce_Record(uint32_t channel, uint32_t input, uint32_t bounce_us);
+
+/* Saves the settle windows that changed - SolarWorkerTask, RtcMutex taken */
+void Debounce_Service(void);
+
+/* USB link command */
+void Debounce_Info(const uint8_t *payload, uint32_t length);
+
+#endif /* DEBOUNCE_H */
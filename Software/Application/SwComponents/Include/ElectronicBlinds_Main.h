@@ -19,11 +19,22 @@
 #define MOTOR_CONTROLLER_TASK_PRIORITY		(tskIDLE_PRIORITY + 1)
 #define	BUTTON_TASK_PRIORITY				(tskIDLE_PRIORITY + 2)
 #define AUTOMATIC_CONTROL_TASK_PRIORITY     (tskIDLE_PRIORITY + 3)
+#define MOTION_SENSOR_TASK_PRIORITY         (tskIDLE_PRIORITY + 1)
+#define USB_LINK_TASK_PRIORITY              (tskIDLE_PRIORITY + 1)
+#define NODE_BUS_TASK_PRIORITY              (tskIDLE_PRIORITY + 2)
+#define SOLAR_WORKER_TASK_PRIORITY          (tskIDLE_PRIORITY) //below every other task - the slow part of the automatic control
+#define POWER_MONITOR_TASK_PRIORITY         (tskIDLE_PRIORITY + 4) //above every other task - the flush of a failing supply
 
 /* Task periods (ms) */
 #define BUTTON_TASK_PERIOD					(100)
 #define MOTOR_CONTROLLER_TASK_PERIOD		(100)
 #define AUTOMATIC_CONTROL_TASK_PERIOD       (50000)
+#define MOTION_SENSOR_TASK_PERIOD           (1000) //one FIFO drain per second - 2 I2C transactions
+#define USB_LINK_TASK_PERIOD                (100) //longest wait for characters - the task is woken by their arrival
+#define NODE_BUS_TASK_PERIOD                (1) //the DMA ring of the received bytes polled every tick - a frame takes longer on the wire
+
+/* How often ButtonTask reports the interrupt handler execution times (in its task cycles) */
+#define CYCLE_REPORT_PERIOD_IN_TASK_CYCLES  (600U) //60s
 
 /* The number of items the queue can hold */
 #define mainQUEUE_LENGTH					(1)
@@ -31,6 +42,20 @@
 /* By default the MPU6050 devices are on bus address 0x68 */ 
 #define MPU6050_I2C_ADDRESS   				 0x68
 
+/* Optional MPU6050 on the gear case - vibration based detection of a jammed motor and of a blind moving with the motor off.
+   It has a bus of its own (I2C1) - the DS1307 on I2C0 has the same fixed address 0x68 */
+#ifndef MOTION_SENSOR_ENABLED
+#define MOTION_SENSOR_ENABLED 0 //1 - MPU6050 connected, 0 - no motion sensor
+#endif
+#define MOTION_SENSOR_SDA_GPIO 6U //I2C1 SDA - also CH1_BUTTON_TOP_LIMIT, so the sensor allows only 1 channel
+#define MOTION_SENSOR_SCL_GPIO 7U //I2C1 SCL - also CH1_BUTTON_BOTTOM_LIMIT
+#define MOTION_SENSOR_CHANNEL 0U //the channel whose gear case carries the sensor
+
+/* Number of blinds (channels) driven by this board - 4 is the GPIO limit, see the channel pin mapping below */
+#ifndef BLINDS_NUM_OF_CHANNELS
+#define BLINDS_NUM_OF_CHANNELS 1U
+#endif
+
 /* GPIO IDs to Names mapping: */
 #define BUTTON_UP 14U
 #define BUTTON_DOWN 13U
@@ -43,12 +68,152 @@
 #define MOTOR_CONTROL_1 16U
 #define MOTOR_CONTROL_2 17U
 
+/* Additional channels (channel 0 uses the pins above). GPIO 4/5 are taken by I2C0 (DS1307), 23/24/25/29 by the Pico board itself */
+#define CH1_BUTTON_UP 2U
+#define CH1_BUTTON_DOWN 3U
+#define CH1_BUTTON_TOP_LIMIT 6U
+#define CH1_BUTTON_BOTTOM_LIMIT 7U
+#define CH1_MOTOR_CONTROL_1 18U
+#define CH1_MOTOR_CONTROL_2 19U
+#define CH2_BUTTON_UP 20U
+#define CH2_BUTTON_DOWN 21U
+#define CH2_BUTTON_TOP_LIMIT 22U
+#define CH2_BUTTON_BOTTOM_LIMIT 26U
+#define CH2_MOTOR_CONTROL_1 27U
+#define CH2_MOTOR_CONTROL_2 28U
+/* Channel 3 takes the 3.3V source pins (the buttons/switches of all channels then have to be supplied from the 3V3 rail)
+   and the UART0 pins (no prints over UART) */
+#define CH3_BUTTON_UP SOURCE_3V3_1
+#define CH3_BUTTON_DOWN SOURCE_3V3_2
+#define CH3_BUTTON_TOP_LIMIT SOURCE_3V3_3
+#define CH3_BUTTON_BOTTOM_LIMIT SOURCE_3V3_4
+#define CH3_MOTOR_CONTROL_1 0U
+#define CH3_MOTOR_CONTROL_2 1U
+
 /* Timing macros */
 #define DEBOUNCING_DELAY_IN_US 100000U //100ms
 #define DEBOUNCING_DELAY_IN_US_LIMITTER 10000U //10ms
-#define LIMIT_SWITCH_REACTION_DURATION_IN_US 100000 //100ms
+
+/* Limit switch back-off - the motor reverses until the switch releases (detected by the falling edge)
+   and then keeps going for the extra travel time below before it is stopped */
+#define LIMIT_SWITCH_BACKOFF_TOP_IN_US 200000U //200ms of extra travel after the top limit switch released
+#define LIMIT_SWITCH_BACKOFF_BOTTOM_IN_US 50000U //50ms of extra travel after the bottom limit switch released
+#define LIMIT_SWITCH_BACKOFF_TIMEOUT_IN_US 3000000U //3s - if the switch is still pressed after that, stop the motor (jam)
+
+/* Optional ambient light sensor (photodiode/LDR divider) - shifts the sunrise/sunset schedule of AutomaticControlTask */
+#ifndef LIGHT_SENSOR_ENABLED
+#define LIGHT_SENSOR_ENABLED 0 //1 - light sensor connected, 0 - schedule only
+#endif
+#define LIGHT_SENSOR_GPIO 26U //ADC0 - also CH2_BUTTON_BOTTOM_LIMIT, so the sensor allows at most 2 channels
+
+/* Schedule rules of AutomaticControlTask (Schedule.c) - weekday/weekend opening times, summer closing time and holidays */
+#ifndef SCHEDULE_RULES_ENABLED
+#define SCHEDULE_RULES_ENABLED 0 //1 - the rules of Schedule.c, 0 - closed between sunset and sunrise every day
+#endif
+
+/* Field trace (Trace.c) - the inputs and motor outputs of a cold boot recorded into the flash for HostTools/TraceReplay,
+   started by the USB link command TRACE_START */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0 //1 - capture mode built in, 0 - no trace
+#endif
+
+/* Glare control (SunTracker.c) - while the schedule keeps the blinds open, the channels with a window in SunTrackerWindows
+   are closed partially whenever the direct sun would get too deep into the room. There is no position sensor, the partial
+   positions are timed moves from the last known one (a limit switch) - the travel times below have to be measured on the blind */
+#ifndef GLARE_CONTROL_ENABLED
+#define GLARE_CONTROL_ENABLED 0 //1 - partial positions against the glare, 0 - open/closed only
+#endif
+#define BLIND_TRAVEL_DOWN_IN_MS 80000U //full travel from the top to the bottom limit switch
+#define BLIND_TRAVEL_UP_IN_MS 120000U //and back up (the motor lifts the blind)
+#define GLARE_POSITION_STEP (0.1f) //a blind closer than this to its target is not moved
+#define GLARE_POSITION_CLOSED (0.95f) //targets above this close the blind down to the limit switch
+
+/* Node bus (NodeBus.c) - the controllers of a house on one RS-485 pair (half duplex transceiver on UART0): frames to one node,
+   to a group of nodes or to all of them. The leader sends the moves of its schedule to the followers, which don't run their own
+   (one clock for the whole house). The address, the groups and the role can be changed over the USB link (BUS_CONFIG) */
+#ifndef NODE_BUS_ENABLED
+#define NODE_BUS_ENABLED 0 //1 - node bus on UART0, 0 - a standalone controller
+#endif
+#ifndef NODE_BUS_ADDRESS
+#define NODE_BUS_ADDRESS 1U //1..126 - unique on the bus
+#endif
+#ifndef NODE_BUS_GROUPS
+#define NODE_BUS_GROUPS 0x01U //groups 0..7 this node belongs to (one bit each) - e.g. the windows of one side of the house
+#endif
+#ifndef NODE_BUS_LEADER
+#define NODE_BUS_LEADER 0U //1 - the schedule of this node moves the blinds of the followers, 0 - follower (one leader per bus)
+#endif
+#define NODE_BUS_SCHEDULE_DESTINATION 0xFFU //where the leader sends its schedule moves - all the nodes (0x80 + group - one group)
+#define NODE_BUS_BAUD_RATE 115200U
+#define NODE_BUS_TX_GPIO 0U //UART0 TX - also CH3_MOTOR_CONTROL_1
+#define NODE_BUS_RX_GPIO 1U //UART0 RX - also CH3_MOTOR_CONTROL_2
+#define NODE_BUS_DE_GPIO 28U //driver enable of the transceiver - also CH2_MOTOR_CONTROL_2, so the bus allows at most 2 channels
+
+/* Motor starts of different channels are staggered so their inrush currents don't add up (e.g. all blinds opening at sunrise) */
+#define MOTOR_START_STAGGER_IN_US 250000U //250ms between two motor starts
+
+/* Deadlines of the motor commands (MotorControllerTask.c) - a start that is still held back by the stagger after that long is dropped.
+   The commands of the limit switches and the jam detection take effect right away */
+#define MOTOR_DEADLINE_MANUAL_IN_US 1000000U //1s
+#define MOTOR_DEADLINE_REMOTE_IN_US 1000000U //1s
+#define MOTOR_DEADLINE_AUTOMATIC_IN_US 5000000U //5s - all the channels starting at once
+
+/* End-to-end latency requirements - HostTools/ResponseTime checks the priorities, periods and delays above against them */
+#define LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US 15000U //15ms from the limit switch closing until the motor no longer drives into it
+#define BUTTON_TO_MOTOR_ON_BOUND_IN_US 350000U //350ms from pressing Up/Down until the motor runs
+
+/* Hot paths in SRAM - the input interrupt handlers (ButtonTask.c) and the motor outputs (MotorControllerTask.c) with the data
+   they read, copied to SRAM at the boot (the .time_critical sections of the SDK). From the XIP flash their latency depends on
+   the flash cache, which the soft-float of CalculateSunriseSunset keeps evicting - compare the XIP misses of CycleCounter */
+#ifndef RAM_HOT_PATHS_ENABLED
+#define RAM_HOT_PATHS_ENABLED 0 //1 - hot paths in SRAM, 0 - everything runs from the flash
+#endif
+#if (RAM_HOT_PATHS_ENABLED == 1)
+#define HOT_PATH_FUNC(func_name) __not_in_flash_func(func_name) //pico/platform.h
+#define HOT_PATH_DATA __not_in_flash("hot_path_data")
+#else
+#define HOT_PATH_FUNC(func_name) func_name
+#define HOT_PATH_DATA
+#endif
+
+/* Sampling profiler (Profiler.c) - the code and the task interrupted by the spare hardware alarm, sampled into RAM. Started and
+   read over the USB link (HostTools/FirmwareUpdate/UpdateSender --profile-start, --profile-read), symbolized against
+   ElectronicBlinds_Main.elf by HostTools/Profiler/ProfileReport */
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0 //1 - the profiler built in, 0 - no profiler
+#endif
+
+/* Quadrature encoder on the blind shaft of one channel (Encoder.c, in the room BlindsShaftAdapter leaves) - counted by a PIO
+   state machine, no interrupt per count. The count is zeroed at the top limit switch and the travel learned at the bottom one,
+   from then on MotorControllerTask moves the blind to any position (MotorCommand_SubmitPosition, the USB link POSITION
+   command) and the glare control uses it in place of the timed moves */
+#ifndef ENCODER_ENABLED
+#define ENCODER_ENABLED 0 //1 - encoder connected, 0 - the position is only known at the limit switches
+#endif
+#define ENCODER_A_GPIO 20U //also CH2_BUTTON_UP, so the encoder allows at most 2 channels
+#define ENCODER_B_GPIO 21U //also CH2_BUTTON_DOWN - B has to be the pin after A (the PIO program reads both in one IN)
+#define ENCODER_CHANNEL 0U //the channel whose blind shaft carries the encoder
+#define MOTOR_POSITION_PERIOD (10) //ms - MotorControllerTask samples the encoder that often while a position move runs
+#define MOTOR_POSITION_TOLERANCE (0.002f) //a position move is corrected until it stops closer than this to its target (of the travel)
+#define MOTOR_POSITION_MAX_CORRECTIONS 2U //moves after the first one that stopped too far from the target
+#define MOTOR_POSITION_OVERRUN_IN_US 150000U //travel after the brake, as time at the speed of the brake - learned at every stop from this
+#define MOTOR_POSITION_STALL_IN_US 1000000U //a move without a count for that long is stopped (encoder disconnected)
+
+/* Supply monitor (PowerMonitor.c) - the 12V rail through a divider on an ADC pin, converted and compared with the thresholds
+   every POWER_MONITOR_PERIOD_IN_US like a comparator with hysteresis. On the falling edge the H-bridge is turned off at once and
+   the state of the blinds is written into the battery backed RAM of the DS1307 while the bulk capacitors still hold the 3.3V
+   regulator up - the next boot reads it back (USB link POWER_INFO) */
+#ifndef POWER_MONITOR_ENABLED
+#define POWER_MONITOR_ENABLED 0 //1 - supply divider connected, 0 - no supply monitoring
+#endif
+#define POWER_MONITOR_GPIO 27U //ADC1 - also CH2_MOTOR_CONTROL_1, so the monitor allows at most 2 channels
+#define POWER_MONITOR_DIVIDER (11.0f) //100k over 10k - 12V is 1.09V at the pin, 36V (the most the pin takes) 3.3V
+#define POWER_MONITOR_PERIOD_IN_US 250U //between two conversions of the supply
+#define POWER_MONITOR_FAIL_MV 10000U //the rail is going down below that - the motor alone never pulls a healthy supply there
+#define POWER_MONITOR_GOOD_MV 11000U //back above that the motors may run again (a dip the board lived through)
+#define POWER_MONITOR_HOLD_UP_IN_US 20000U //from POWER_MONITOR_FAIL_MV until the regulator drops out, the H-bridge off - measured on the board
 
 /*--------------- GLOBAL VARIABLES DECLARATION (extern) ---------------*/
-extern bool buttonTopLimit_InitState, buttonBottomLimit_InitState;
+extern uint32_t buttonTopLimit_InitState, buttonBottomLimit_InitState; /* one bit per channel */
 
 #endif /* ELECTRONICBLINDS_MAIN_H */
@@ -0,0 +1,42 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Quadrature encoder (ENCODER_ENABLED): a PIO state machine samples A and B in a loop and jumps through a table of the 16
+   transitions (the last and the new levels) to a step of the count up, down or none - the count lives in its Y register and
+   every pass of the loop pushes it into the RX FIFO without blocking, the CPU reads it whenever it wants the position. The
+   program is assembled at the boot from the pio_encode_* helpers (no pioasm in the build), its table has to be at offset 0 */
+#define ENCODER_PROGRAM_LENGTH				(24U)
+#define ENCODER_MIN_SPAN					(100)		/* counts between the switches - less, the encoder does not count */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+	int32_t topCount;				/* at the last press of the top limit switch - position 0 */
+	int32_t bottomCount;			/* ... of the bottom one - position 1 */
+	bool topSeen;
+	bool bottomSeen;
+	uint32_t reads;
+}EncoderState_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern EncoderState_t EncoderState;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void Encoder_Init(void);
+int32_t Encoder_Read(void);								/* the count now - from the tasks and the interrupt handlers */
+void Encoder_LimitReached(uint32_t channel, bool top);	/* a limit switch press of a channel (ButtonTask.c) */
+void Encoder_Restore(int32_t fromTop, int32_t span);	/* the travel counted before a power cut (PowerMonitor.c) */
+bool Encoder_Calibrated(void);							/* both switches seen since the boot, the travel between them counted */
+int32_t Encoder_Travel(int32_t from, int32_t to);		/* counts from one count to the other towards the bottom switch */
+int32_t Encoder_CountAt(float position);				/* 0 - top switch, 1 - bottom switch */
+float Encoder_PositionAt(int32_t count);
+
+#endif /* ENCODER_H */
@@ -0,0 +1,35 @@
+#ifndef HASH_H
+#define HASH_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*--------------- MACROS ---------------*/
+
+#define HASH_SHA256_SIZE					(32U)
+#define HASH_SHA256_BLOCK_SIZE				(64U)
+#define HASH_CRC32_INIT						(0xFFFFFFFFUL)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* SHA-256 (FIPS 180-4) of a stream - the firmware images are hashed sector by sector straight from the flash (XIP) */
+typedef struct
+{
+	uint32_t state[8];
+	uint64_t length;						/* bytes hashed so far */
+	uint8_t block[HASH_SHA256_BLOCK_SIZE];
+	uint32_t blockFill;
+}HashSha256_t;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* CRC-32 (IEEE 802.3, reflected) - start with HASH_CRC32_INIT, the final value is the returned one inverted */
+uint32_t Hash_Crc32Update(uint32_t crc, const void *data, size_t length);
+uint32_t Hash_Crc32(const void *data, size_t length);
+
+void Hash_Sha256Init(HashSha256_t *context);
+void Hash_Sha256Update(HashSha256_t *context, const void *data, size_t length);
+void Hash_Sha256Final(HashSha256_t *context, uint8_t digest[HASH_SHA256_SIZE]);
+
+#endif /* HASH_H */
@@ -0,0 +1,48 @@
+#ifndef LIGHTSENSOR_H
+#define LIGHTSENSOR_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+#define LIGHT_SENSOR_ADC_INPUT				(LIGHT_SENSOR_GPIO - 26U)	/* ADC0..ADC3 are GPIO 26..29 */
+#define LIGHT_SENSOR_ADC_CLKDIV				(65535.0f)	/* slowest free-running rate - 48MHz / 65536 = ~732 samples/s, each conversion takes 2us */
+#define LIGHT_SENSOR_BUFFER_RING_BITS		(7U)		/* DMA write ring of 128 bytes */
+#define LIGHT_SENSOR_BUFFER_SAMPLES_BITS	(LIGHT_SENSOR_BUFFER_RING_BITS - 1U)
+#define LIGHT_SENSOR_BUFFER_SAMPLES			(1U << LIGHT_SENSOR_BUFFER_SAMPLES_BITS) /* 64 x 16-bit samples */
+#define LIGHT_SENSOR_FILTER_PERIOD_IN_TICKS	(1000U)		/* 1s - one filter step per second */
+#define LIGHT_SENSOR_FRACTION_BITS			(16U)		/* filter state is Q12.16 (12-bit ADC counts) */
+#define LIGHT_SENSOR_FILTER_SHIFT			(6U)		/* IIR coefficient 1/64 - time constant ~64 filter steps (~1 min) */
+#define LIGHT_SENSOR_SAMPLE_PERIOD_IN_US	(1000U)		/* POWER_MONITOR_ENABLED - converted along with the supply, the ring is the last 64ms */
+
+/* Level thresholds in ADC counts (12-bit), the level changes only once the filtered value is LIGHT_LEVEL_HYSTERESIS past them.
+   The build defaults of the site configuration (SiteConfig.h) */
+#define LIGHT_LEVEL_DARK_THRESHOLD			(400U)
+#define LIGHT_LEVEL_BRIGHT_THRESHOLD		(2800U)
+#define LIGHT_LEVEL_HYSTERESIS				(150U)
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	LIGHT_LEVEL_DARK,		/* night, or an overcast/stormy day - open later, close earlier */
+	LIGHT_LEVEL_NORMAL,		/* follow the computed sunrise/sunset */
+	LIGHT_LEVEL_BRIGHT		/* bright morning/evening - open earlier, close later */
+}LightLevel_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern volatile LightLevel_t LightLevel;
+extern volatile uint32_t LightFiltered;			/* filtered light level in ADC counts */
+extern uint32_t LightLevelChanges;
+extern SemaphoreHandle_t LightLevelSemaphore;	/* given on every change of LightLevel - wakes SolarWorkerTask */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void LightSensor_Init(void);
+void LightSensor_TickHook(void);
+void LightSensor_Sample(uint16_t sample);		/* POWER_MONITOR_ENABLED - PowerMonitor.c */
+
+#endif /* LIGHTSENSOR_H */
@@ -0,0 +1,75 @@
+#ifndef MOTIONSENSOR_H
+#define MOTIONSENSOR_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+/* MPU6050 registers (MPU-6000/MPU-6050 Register Map and Descriptions, rev 4.2) */
+#define MPU6050_REG_SMPLRT_DIV				(0x19U)
+#define MPU6050_REG_CONFIG					(0x1AU)
+#define MPU6050_REG_ACCEL_CONFIG			(0x1CU)
+#define MPU6050_REG_FIFO_EN					(0x23U)
+#define MPU6050_REG_USER_CTRL				(0x6AU)
+#define MPU6050_REG_PWR_MGMT_1				(0x6BU)
+#define MPU6050_REG_PWR_MGMT_2				(0x6CU)
+#define MPU6050_REG_FIFO_COUNTH				(0x72U)
+#define MPU6050_REG_FIFO_R_W				(0x74U)
+#define MPU6050_REG_WHO_AM_I				(0x75U)
+
+#define MPU6050_WHO_AM_I_VALUE				(0x68U)
+#define MPU6050_PWR_MGMT_1_DEVICE_RESET		(0x80U)
+#define MPU6050_PWR_MGMT_2_STBY_GYRO		(0x07U)	/* gyroscope in standby - only the accelerometer is used */
+#define MPU6050_CONFIG_DLPF_184HZ			(0x01U)	/* DLPF on - the sample rate divider then counts from 1kHz */
+#define MPU6050_FIFO_EN_ACCEL				(0x08U)
+#define MPU6050_USER_CTRL_FIFO_EN			(0x40U)
+#define MPU6050_USER_CTRL_FIFO_RESET		(0x04U)
+#define MPU6050_FIFO_SIZE					(1024U)
+#define MPU6050_FIFO_SAMPLE_SIZE			(6U)	/* ACCEL_XOUT_H .. ACCEL_ZOUT_L */
+
+/* Sampling - 1kHz / (1 + 9) = 100 samples/s of the 3 axes (600 bytes/s), the FIFO holds 1.7s of them */
+#define MOTION_SENSOR_SAMPLE_RATE_DIVIDER	(9U)
+#define MOTION_SENSOR_I2C_BAUDRATE			(400000U)
+#define MOTION_SENSOR_I2C_TIMEOUT_IN_US		(50000U)	/* a whole FIFO burst takes ~25ms at 400kHz */
+
+/* Vibration energy - the DC (gravity, mounting tilt) of every axis is tracked by a first order IIR and removed,
+   the rest is squared and averaged over the window (the samples of one drain). Units of (1/1024 g)^2 */
+#define MOTION_DC_FRACTION_BITS				(8U)
+#define MOTION_DC_FILTER_SHIFT				(5U)	/* IIR coefficient 1/32 - ~0.3s time constant at 100 samples/s */
+#define MOTION_VIBRATION_SHIFT				(4U)	/* +-2g full scale is 16384 LSB/g, 1/1024 g keeps the sum of squares in 32 bits */
+#define MOTION_VIBRATION_LIMIT				(1024)	/* deviation clamped to 1g - a knock can not overflow the window sum */
+
+/* Detection - the motor shakes the gear case (mean square of tens of mg), a still one only shows the sensor noise (a few mg) */
+#define MOTION_ENERGY_STILL_THRESHOLD		(100U)	/* ~6mg rms on every axis - motor on and less than this: not turning */
+#define MOTION_ENERGY_MOVING_THRESHOLD		(400U)	/* ~12mg rms on every axis - motor off and more than this: blind moving */
+#define MOTION_CONFIRM_WINDOWS				(2U)	/* consecutive windows past the threshold before an event is reported */
+#define MOTION_SETTLE_WINDOWS				(1U)	/* windows skipped after a motor start/stop (spin-up, coasting) */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+	uint32_t drains;				/* task runs that read the FIFO */
+	uint32_t i2cTransactions;		/* register accesses (write of the register address + read/write of the data) */
+	uint32_t i2cErrors;				/* accesses that were not acknowledged or timed out */
+	uint32_t samples;
+	uint32_t overflows;				/* the FIFO was full - its content was dropped */
+	uint32_t jams;					/* motor on but the gear case did not vibrate - motor stopped */
+	uint32_t unexpectedMoves;		/* motor off but the gear case vibrated (blind pulled, brake slipping) */
+	uint32_t lastEnergy;
+	uint32_t maxEnergyMotorOff;
+	uint32_t minEnergyMotorOn;
+}MotionStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern MotionStats_t MotionStats;
+extern volatile bool MotionJamDetected;			/* set by MotionSensorTask, cleared by MotorControllerTask once it stopped the motor */
+extern volatile bool MotionUnexpectedMovement;	/* motor off and the blind is moving */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void MotionSensorTask( void *pvParameters );
+
+#endif /* MOTIONSENSOR_H */
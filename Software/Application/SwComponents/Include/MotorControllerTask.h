@@ -1,22 +1,88 @@
 #ifndef MOTORCONTROLLERTASK_H
 #define MOTORCONTROLLERTASK_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+
 /* Constants and Macros */
 
 /* Data Types */
 
-typedef enum 
+typedef enum
 {
     STATE_OFF,
     STATE_CLOCKWISE,
     STATE_ANTICLOCKWISE
 } MotorState_t;
 
+/* Sources of the motor commands - a higher priority takes the channel over from a lower one */
+typedef enum
+{
+    MOTOR_PRIORITY_NONE,            /* nobody commands the channel - the motor is off */
+    MOTOR_PRIORITY_AUTOMATIC,       /* AutomaticControlTask, moves resumed after a watchdog reset */
+    MOTOR_PRIORITY_REMOTE,          /* USB link, node bus */
+    MOTOR_PRIORITY_MANUAL,          /* Up/Down buttons */
+    MOTOR_PRIORITY_SAFETY,          /* limit switch back-off, jam detection */
+    MOTOR_PRIORITY_POWER_FAIL,      /* supply monitor - every channel off while the 12V rail fails, a back-off included */
+    MOTOR_NUM_OF_PRIORITIES
+} MotorPriority_t;
+
+/* The command that owns a channel */
+typedef struct
+{
+    MotorState_t state;
+    MotorPriority_t priority;
+    uint32_t deadline_us;           /* timer_hw->timerawl by which a pending start has to be applied */
+    uint32_t run_us;                /* a timed move stops (and releases the channel) after running that long, 0 - until a limit switch */
+    uint32_t started_us;            /* when the move was applied */
+    uint32_t sequence;              /* accepted submits - a source tells by it whether its command was replaced */
+    bool pending;                   /* start held back by the stagger - applied by MotorControllerTask */
+} MotorCommand_t;
+
+typedef struct
+{
+    uint32_t submitted;
+    uint32_t applied;               /* commands that reached the H-bridge */
+    uint32_t coalesced;             /* the command that already owns the channel, sent again */
+    uint32_t preempted;             /* commands taken over by a source of a higher priority */
+    uint32_t dropped;               /* refused - a higher priority owns the channel, or the source was preempted and didn't release yet */
+    uint32_t expired;               /* starts not applied before their deadline */
+} MotorCommandStats_t;
+
+/* Position moves of the channel with the encoder (ENCODER_ENABLED) - the motor is braked ahead of the target by the travel it
+   overruns at the speed it runs, then corrected by moves back and forth until it stopped close enough */
+typedef struct
+{
+    uint32_t moves;                 /* ended within MOTOR_POSITION_TOLERANCE */
+    uint32_t missed;                /* ended further away - out of corrections */
+    uint32_t corrections;           /* moves after the first one */
+    uint32_t aborted;               /* taken over, released or replaced by another command before they ended */
+    uint32_t stalls;                /* stopped - no count for MOTOR_POSITION_STALL_IN_US */
+    int32_t lastError;              /* counts from the target towards the bottom switch where the last one stopped */
+    uint32_t lastDuration_us;       /* from its submit to its release */
+    uint32_t overrun_us[2];         /* travel after the brake up/down as time at the speed of the brake, learned at every stop */
+} MotorPositionStats_t;
+
+/* Global Variables */
+extern MotorState_t CurrentState[BLINDS_NUM_OF_CHANNELS];
+extern MotorCommand_t MotorCommands[BLINDS_NUM_OF_CHANNELS];
+extern MotorCommandStats_t MotorCommandStats;
+extern uint32_t MotorStarts, MotorStartsDeferred; /* motor starts, and task runs that held back a start because of the stagger */
+extern uint32_t MotorChannelStarts[BLINDS_NUM_OF_CHANNELS]; /* starts and reversals per channel - tells a source whether anybody else moved the blind */
+extern MotorPositionStats_t MotorPositionStats;
+
 /* Function Declarations */
 void MotorControllerTask( void *pvParameters );
-void stateOFF(void);
-void stateAnticlockwise(void);
-void stateClockwise(void);
+void MotorCommand_Init(void);
+bool MotorCommand_Submit(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us);
+bool MotorCommand_SubmitTimed(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us, uint32_t run_us);
+bool MotorCommand_SubmitPosition(uint32_t channel, float position, MotorPriority_t priority, uint32_t deadline_us);
+void MotorCommand_Release(uint32_t channel, MotorPriority_t priority);
+void MotorCommand_Remote(const uint8_t *payload, uint32_t length);
+void MotorCommand_Info(void);
+void MotorCommand_RemotePosition(const uint8_t *payload, uint32_t length);
+void MotorCommand_PositionInfo(void);
+void MotorOutputsOff(void);
 
 #endif /* MOTORCONTROLLERTASK_H */
-
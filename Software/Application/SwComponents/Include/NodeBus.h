@@ -0,0 +1,75 @@
+#ifndef NODEBUS_H
+#define NODEBUS_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "MotorControllerTask.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Frame on the wire: destination source command sequence length payload CRC-32(all before it - 32-bit LE), COBS encoded (no 0x00
+   inside) and ended by NODE_BUS_DELIMITER - a receiver that starts in the middle of a frame is in sync from the next delimiter on.
+   The bus is half duplex, a node sends once it has not seen a byte for a poll period and is not in the middle of a frame - two nodes
+   that start at once garble both frames, the CRC drops them (only the leader and the USB link start moves, nobody retries) */
+#define NODE_BUS_BROADCAST					(0xFFU)
+#define NODE_BUS_GROUP_FLAG					(0x80U)				/* destination 0x80 + group - the nodes of that group */
+#define NODE_BUS_NUM_OF_GROUPS				(8U)
+#define NODE_BUS_MAX_ADDRESS				(0x7EU)
+#define NODE_BUS_DELIMITER					(0x00U)
+#define NODE_BUS_HEADER_SIZE				(5U)
+#define NODE_BUS_MAX_PAYLOAD				(8U)
+#define NODE_BUS_CRC_SIZE					(4U)
+#define NODE_BUS_MAX_FRAME					(NODE_BUS_HEADER_SIZE + NODE_BUS_MAX_PAYLOAD + NODE_BUS_CRC_SIZE)
+#define NODE_BUS_MAX_ENCODED				(NODE_BUS_MAX_FRAME + 2U)	/* COBS overhead byte and the delimiter */
+#define NODE_BUS_TX_QUEUE_LENGTH			(4U)
+#define NODE_BUS_RX_RING_BITS				(8U)				/* DMA write ring of 256 bytes - 22ms of the bus at 115200 */
+#define NODE_BUS_RX_RING_SIZE				(1U << NODE_BUS_RX_RING_BITS)
+#define NODE_BUS_PING_TIMEOUT_IN_MS			(50U)
+#define NODE_BUS_ALL_CHANNELS				(0x0FU)				/* channel mask of a MOVE - whatever channels the node drives */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	NODE_BUS_CMD_MOVE = 0x01,				/* channel mask, MotorState_t, MotorPriority_t - STATE_OFF releases the channels */
+	NODE_BUS_CMD_PING = 0x02,				/* to one node only -> PONG with the same sequence */
+	NODE_BUS_CMD_PONG = 0x03				/* groups of the node */
+}NodeBusCommand_t;
+
+/* This node on the bus - from the site configuration (SiteConfig.h) until BUS_CONFIG changes them (until the reboot) */
+typedef struct
+{
+	uint8_t address;
+	uint8_t groups;							/* one bit per group */
+	bool leader;							/* the schedule of this node moves the followers */
+}NodeBusConfig_t;
+
+typedef struct
+{
+	uint32_t rxFrames;						/* valid frames for this node */
+	uint32_t otherFrames;					/* valid frames for other nodes */
+	uint32_t badFrames;						/* CRC, COBS or length errors - collisions, noise */
+	uint32_t txFrames;
+	uint32_t txDropped;						/* the queue was full */
+	uint32_t moves;							/* MOVE frames applied to the channels */
+}NodeBusStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern NodeBusConfig_t NodeBusConfig;
+extern NodeBusStats_t NodeBusStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void NodeBus_Init(void);
+void NodeBusTask(void *pvParameters);
+
+/* A move of the channels in the mask for the nodes of the destination (not applied to this node) - false if the queue was full */
+bool NodeBus_Move(uint8_t destination, uint32_t channelMask, MotorState_t state, MotorPriority_t priority);
+
+/* USB link commands */
+void NodeBus_Info(void);
+void NodeBus_Config(const uint8_t *payload, uint32_t length);
+void NodeBus_RemoteMove(const uint8_t *payload, uint32_t length);
+void NodeBus_RemotePing(const uint8_t *payload, uint32_t length);
+
+#endif /* NODEBUS_H */
@@ -0,0 +1,78 @@
+#ifndef POWERMONITOR_H
+#define POWERMONITOR_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Supply monitor (POWER_MONITOR_ENABLED): a periodic deadline of the timer service converts the divider of the 12V rail once and
+   compares it with the fail and the good threshold - the comparator of the board in software, no filter but the consecutive
+   samples below. The thresholds are turned into ADC counts once at the boot, the interrupt compares counts only (no software
+   floating point on the M0+) - millivolts are for POWER_INFO. The ADC converts on demand only, the light sensor input is converted in the same interrupt (LightSensor_Sample).
+   On the falling edge the interrupt turns the H-bridge off and takes the channels over with a safety stop, PowerMonitorTask
+   (above every other task) writes the record below into the RAM of the DS1307 - the time from the edge until the end of that
+   I2C write is the flush latency, it has to stay well within POWER_MONITOR_HOLD_UP_IN_US */
+#define POWER_MONITOR_ADC_INPUT				(POWER_MONITOR_GPIO - 26U)	/* ADC0..ADC3 are GPIO 26..29 */
+#define POWER_MONITOR_ADC_REF_MV			(3300U)
+#define POWER_MONITOR_ADC_COUNTS			(4096U)		/* 12 bits */
+#define POWER_MONITOR_FAIL_SAMPLES			(2U)		/* consecutive samples below POWER_MONITOR_FAIL_MV - a single spike is no edge */
+#define POWER_MONITOR_RTC_WAIT_IN_MS		(12U)		/* for the transfers of another task to end - then the flush is given up */
+
+/* Record of the falling edge in the battery backed RAM of the DS1307 - the 7 free bytes between DS1307_REG_ADDR_IS_CLOSED and
+   the time sync state. Written together with IS_CLOSED (one burst from 0x08) once AutomaticControlTask knows what it is */
+#define POWER_FAIL_NVRAM_ADDR				(0x09U)
+#define POWER_FAIL_RECORD_SIZE				(7U)
+#define POWER_FAIL_RECORD_MAGIC				(0x9FU)		/* the check byte is the CRC-32 of the other bytes (low byte) XOR this */
+#define POWER_FAIL_RECORD_CHANNELS			(2U)
+#define POWER_FAIL_NO_COUNT					(INT16_MIN)	/* the encoder had not counted the travel between the switches */
+#define POWER_MONITOR_DS1307_I2C_ADDRESS	(0x68U)
+#define POWER_MONITOR_I2C_TIMEOUT_IN_US		(2000U)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* The state of the blinds at the falling edge */
+typedef struct
+{
+	bool valid;
+	uint8_t channels[POWER_FAIL_RECORD_CHANNELS];	/* WATCHDOG_CHANNEL_* byte of each channel - what was moving and where to */
+	int16_t count;									/* encoder count from the top switch at the flush (ENCODER_CHANNEL) */
+	int16_t span;									/* from the top to the bottom switch */
+}PowerFailRecord_t;
+
+typedef struct
+{
+	uint16_t supply;				/* the last conversion [ADC counts] */
+	uint16_t lowest;				/* since the boot [ADC counts] */
+	uint32_t checks;
+	uint32_t failures;				/* falling edges */
+	uint32_t recoveries;			/* back above POWER_MONITOR_GOOD_MV - a dip the board lived through */
+	uint32_t flushes;
+	uint32_t flushErrors;			/* the I2C write did not go through */
+	uint32_t rtcBusy;				/* flushes given up - the RtcMutex still held at the end of the wait */
+	uint32_t lastDetect_us;			/* timer at the last falling edge */
+	uint32_t lastFlush_us;			/* from the last falling edge until its record was written */
+	uint32_t longestFlush_us;
+	PowerFailRecord_t bootRecord;	/* found at the boot - written by the last falling edge the board did not live through */
+	bool encoderRestored;			/* the encoder took the travel between the switches from it */
+}PowerMonitorStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern PowerMonitorStats_t PowerMonitorStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Before the tasks start, after TimerService_Init, Encoder_Init and TimeSync_Init - reads the record of the last falling edge
+   (and clears it, it only describes the boot after it) and starts the conversions */
+void PowerMonitor_Init(void);
+void PowerMonitorTask(void *pvParameters);
+
+/* USB link command */
+void PowerMonitor_Info(void);
+
+uint32_t PowerMonitor_Millivolts(uint32_t counts);		/* of the 12V rail - not from the interrupt */
+bool PowerMonitor_Failing(void);						/* from the falling edge until the recovery - the RTC is left to the flush */
+
+#endif /* POWERMONITOR_H */
@@ -0,0 +1,58 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/irq.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Statistical profiler (PROFILER_ENABLED): the alarm interrupt stacks the registers of the code it interrupted - a sample is the
+   PC of that frame and the task that ran (PROFILER_TASK_NONE - an interrupt handler or the code before the scheduler).
+   Alarm 0 is the timer service (TimerService.h), alarm 3 the default alarm pool of the SDK (sleep_ms) - alarm 2 is claimed here.
+   It runs above every other interrupt, so the handlers are sampled as well. Code with the interrupts disabled (critical
+   sections, the flash operations) is not - its samples land on the first instruction after it. Only core 0 is sampled (the interrupt is enabled there by Profiler_Init) */
+#define PROFILER_ALARM_NUM					(2U)
+#define PROFILER_IRQ						(TIMER_IRQ_2)
+#define PROFILER_MAX_SAMPLES				(2048U)		/* a capture stops once they are taken - 10KB of RAM */
+#define PROFILER_MAX_TASKS					(16U)
+#define PROFILER_TASK_NONE					(0xFFU)
+#define PROFILER_DEFAULT_RATE_HZ			(997U)		/* prime - not in step with the 1kHz tick or the task periods */
+#define PROFILER_MAX_RATE_HZ				(20000U)
+#define PROFILER_SAMPLE_SIZE				(5U)		/* in the #PDATA responses - PC (32-bit LE), task index */
+#define PROFILER_DATA_CHUNK					(9U)		/* samples per #PDATA response */
+#define PROFILER_START_PAYLOAD_SIZE			(4U)		/* rate in Hz (32-bit LE), 0 - stop */
+#define PROFILER_READ_PAYLOAD_SIZE			(4U)		/* first sample (32-bit LE) */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	PROFILER_STATE_OFF,			/* no capture since the boot */
+	PROFILER_STATE_CAPTURING,
+	PROFILER_STATE_DONE			/* full or stopped - the samples stay until the next start */
+}ProfilerState_t;
+
+typedef struct
+{
+	uint32_t samples;
+	uint32_t late;				/* alarms taken after the next one was due (the interrupts disabled for longer) - re-armed from then */
+}ProfilerStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern volatile ProfilerState_t ProfilerState;
+extern ProfilerStats_t ProfilerStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void Profiler_Init(void);
+bool Profiler_Start(uint32_t rate_hz);		/* a new capture, false if the rate is out of range */
+void Profiler_Stop(void);
+
+/* USB link commands */
+void Profiler_StartRemote(const uint8_t *payload, uint32_t length);
+void Profiler_Info(void);
+void Profiler_Read(const uint8_t *payload, uint32_t length);
+void Profiler_Task(const uint8_t *payload, uint32_t length);
+
+#endif /* PROFILER_H */
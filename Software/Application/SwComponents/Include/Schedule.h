@@ -0,0 +1,107 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Days of a rule - Monday is bit 0 (ZellersCongruence numbering). A holiday matches only the rules with SCHEDULE_DAY_HOLIDAY,
+   whatever day of the week it falls on */
+#define SCHEDULE_DAY_MON					(1U << 0)
+#define SCHEDULE_DAY_TUE					(1U << 1)
+#define SCHEDULE_DAY_WED					(1U << 2)
+#define SCHEDULE_DAY_THU					(1U << 3)
+#define SCHEDULE_DAY_FRI					(1U << 4)
+#define SCHEDULE_DAY_SAT					(1U << 5)
+#define SCHEDULE_DAY_SUN					(1U << 6)
+#define SCHEDULE_DAY_HOLIDAY				(1U << 7)
+#define SCHEDULE_DAYS_WEEKDAYS				(SCHEDULE_DAY_MON | SCHEDULE_DAY_TUE | SCHEDULE_DAY_WED | SCHEDULE_DAY_THU | SCHEDULE_DAY_FRI)
+#define SCHEDULE_DAYS_WEEKEND				(SCHEDULE_DAY_SAT | SCHEDULE_DAY_SUN)
+#define SCHEDULE_DAYS_ALL					(SCHEDULE_DAYS_WEEKDAYS | SCHEDULE_DAYS_WEEKEND | SCHEDULE_DAY_HOLIDAY)
+
+#define SCHEDULE_MMDD(month, day)			((uint16_t)(((month) * 100U) + (day)))	/* date of a rule range */
+#define SCHEDULE_HHMM(hour, minute)			((int16_t)(((hour) * 60) + (minute)))		/* minute of the day */
+#define SCHEDULE_EASTER						(0U)	/* month of a holiday that moves with Easter - the day is the offset from Easter Sunday */
+
+#define SCHEDULE_MINUTES_PER_DAY			(24 * 60)
+#define SCHEDULE_MAX_TRANSITIONS			(2U * 366U)	/* one open and one close per day */
+
+/* Transition of the compiled table - minute of the year (0 = January 1st 00:00) and the state from that minute on */
+#define SCHEDULE_TRANSITION(minute, open)	(((uint32_t)(minute) << 1) | ((open) ? 1U : 0U))
+#define SCHEDULE_TRANSITION_MINUTE(t)		((int32_t)((t) >> 1))
+#define SCHEDULE_TRANSITION_OPEN(t)			(((t) & 1U) != 0U)
+
+/* How far the ambient light level (LightSensor) may move the compiled transitions */
+#define SCHEDULE_LIGHT_SHIFT_IN_MINUTES		((int32_t)(LIGHT_SENSOR_SCHEDULE_SHIFT_IN_HOURS * 60.0))
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	SCHEDULE_REF_NONE,		/* not set by this rule - the next matching rule decides */
+	SCHEDULE_REF_CLOCK,		/* offset is the minute of the day (wall clock of the RTC) */
+	SCHEDULE_REF_SUNRISE,	/* offset in minutes from the computed sunrise/sunset of the day */
+	SCHEDULE_REF_SUNSET
+}ScheduleRef_t;
+
+typedef enum
+{
+	SCHEDULE_BOUND_NONE,
+	SCHEDULE_BOUND_NOT_BEFORE,	/* max(time, bound) */
+	SCHEDULE_BOUND_NOT_AFTER	/* min(time, bound) */
+}ScheduleBound_t;
+
+/* Open or close time of a rule, e.g. max(sunrise, 06:30) is { SCHEDULE_REF_SUNRISE, 0, SCHEDULE_BOUND_NOT_BEFORE, SCHEDULE_HHMM(6, 30) } */
+typedef struct
+{
+	uint8_t ref;			/* ScheduleRef_t */
+	int16_t offset;
+	uint8_t bound;			/* ScheduleBound_t */
+	int16_t boundMinute;
+}ScheduleTime_t;
+
+/* The open and close time of a day come from the first rule (in the table order) that matches the day and sets them,
+   sunrise and sunset if no rule does. A day whose open time is not before its close time stays closed */
+typedef struct
+{
+	uint8_t days;			/* SCHEDULE_DAY_* */
+	uint16_t from;			/* SCHEDULE_MMDD range, inclusive - 0/0 for the whole year, from > to wraps over the new year */
+	uint16_t to;
+	ScheduleTime_t open;
+	ScheduleTime_t close;
+}ScheduleRule_t;
+
+typedef struct
+{
+	uint8_t month;			/* SCHEDULE_EASTER - day is the offset from Easter Sunday */
+	int8_t day;
+}ScheduleHoliday_t;
+
+typedef struct
+{
+	const ScheduleRule_t *rules;
+	uint32_t numOfRules;
+	const ScheduleHoliday_t *holidays;
+	uint32_t numOfHolidays;
+}ScheduleConfig_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern const ScheduleConfig_t ScheduleConfig;	/* the rules of AutomaticControlTask - SCHEDULE_RULES_ENABLED */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Compiles the rules for every day of the year into the transition table (sorted by time) */
+void Schedule_Compile(const ScheduleConfig_t *config, uint32_t year);
+uint32_t Schedule_Year(void);	/* year of the compiled table, 0 before the first Schedule_Compile */
+uint32_t Schedule_Transitions(const uint32_t **transitions);
+
+/* State at the minute of the year, with the open periods narrowed by narrow_min (or widened if it is negative) at both ends */
+bool Schedule_IsOpen(int32_t minuteOfYear, int32_t narrow_min);
+
+/* Open and close minute of the compiled day (1..366) - false if the blinds stay closed that day */
+bool Schedule_Day(uint32_t dayOfYear, int32_t *open, int32_t *close);
+
+#endif /* SCHEDULE_H */
@@ -0,0 +1,114 @@
+#ifndef SITECONFIG_H
+#define SITECONFIG_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "Channels.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Site configuration - what differs between the installations of the same image: the location and time zone of the schedule,
+   the period of AutomaticControlTask, the debounce delays, the pins of the channels, the light level thresholds and the node bus
+   address. One block in its own flash sector (BOOT_CONFIG_OFFSET), read in place through the XIP window: SiteConfig_Init
+   checks the block (magic, version, size, CRC and the ranges) and points SiteConfig at it - no parsing, no copy. An erased or
+   invalid block leaves SiteConfig at the build defaults of ElectronicBlinds_Main.h and the headers of the modules.
+   Written over the USB link as a whole block (CONFIG_WRITE - HostTools/FirmwareUpdate/UpdateSender --config-set), the board
+   reboots into it */
+#define SITE_CONFIG_MAGIC					(0x47464342U)	/* "BCFG" */
+#define SITE_CONFIG_VERSION					(1U)			/* a block of another version is not used - the defaults then */
+#define SITE_CONFIG_SIZE					(80U)
+#define SITE_CONFIG_DATA_CHUNK				(48U)			/* bytes per #CDATA response */
+
+/* Ranges of a valid block */
+#define SITE_CONFIG_MAX_LATITUDE			(65.0)			/* CalculateSunriseSunset has no sunrise/sunset past the polar circles */
+#define SITE_CONFIG_MIN_TIME_ZONE			(-11)			/* UTC offset in the summer (hours) */
+#define SITE_CONFIG_MAX_TIME_ZONE			(14)
+#define SITE_CONFIG_MIN_PERIOD_IN_MS		(1000U)			/* up to AUTOMATIC_CONTROL_TASK_PERIOD - the deadline of the watchdog */
+#define SITE_CONFIG_MAX_LIGHT_LEVEL			(4095U)			/* 12-bit ADC */
+#define SITE_CONFIG_NUM_OF_GPIOS			(30U)			/* GPIO 0..29 of the RP2040 */
+
+/* GPIOs no channel may take: I2C0 of the DS1307 (4/5), the Pico board itself (23/24/25/29), the 3.3V source pins unless the
+   build has 4 channels, and the pins of the optional sensors and the node bus of this build */
+#define SITE_CONFIG_BOARD_GPIOS				((1UL << 4) | (1UL << 5) | (1UL << 23) | (1UL << 24) | (1UL << 25) | (1UL << 29))
+#if (BLINDS_NUM_OF_CHANNELS < 4U)
+#define SITE_CONFIG_SOURCE_GPIOS			((1UL << SOURCE_3V3_1) | (1UL << SOURCE_3V3_2) | (1UL << SOURCE_3V3_3) | (1UL << SOURCE_3V3_4))
+#else
+#define SITE_CONFIG_SOURCE_GPIOS			(0UL)
+#endif
+#if (MOTION_SENSOR_ENABLED == 1)
+#define SITE_CONFIG_MOTION_GPIOS			((1UL << MOTION_SENSOR_SDA_GPIO) | (1UL << MOTION_SENSOR_SCL_GPIO))
+#else
+#define SITE_CONFIG_MOTION_GPIOS			(0UL)
+#endif
+#if (LIGHT_SENSOR_ENABLED == 1)
+#define SITE_CONFIG_LIGHT_GPIOS				(1UL << LIGHT_SENSOR_GPIO)
+#else
+#define SITE_CONFIG_LIGHT_GPIOS				(0UL)
+#endif
+#if (NODE_BUS_ENABLED == 1)
+#define SITE_CONFIG_BUS_GPIOS				((1UL << NODE_BUS_TX_GPIO) | (1UL << NODE_BUS_RX_GPIO) | (1UL << NODE_BUS_DE_GPIO))
+#else
+#define SITE_CONFIG_BUS_GPIOS				(0UL)
+#endif
+#define SITE_CONFIG_RESERVED_GPIOS			(SITE_CONFIG_BOARD_GPIOS | SITE_CONFIG_SOURCE_GPIOS | SITE_CONFIG_MOTION_GPIOS | \
+											 SITE_CONFIG_LIGHT_GPIOS | SITE_CONFIG_BUS_GPIOS)
+
+/* CONFIG_READ payload: offset (32-bit LE) in the block -> #CDATA <offset> <up to SITE_CONFIG_DATA_CHUNK bytes in hex>, none at the end */
+#define SITE_CONFIG_READ_PAYLOAD_SIZE		(4U)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* The block as it is in the flash - every field at its natural alignment, the layout is the same for the firmware and the
+   host tools (SITE_CONFIG_SIZE checked below) */
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;							/* sizeof(SiteConfig_t) */
+
+	/* Schedule (Schedule.c, SunTracker.c, TimeSync.c) */
+	double latitude;						/* degrees, north positive */
+	double longitude;						/* degrees, east positive */
+	int32_t timeZone;						/* UTC offset in the summer (hours) - isDST takes an hour off in the winter */
+	uint32_t automaticControlPeriod_ms;
+
+	/* Inputs - the fixed debounce delays, the upper bounds of the learned settle windows (Debounce.c) */
+	uint32_t debounceButton_us;
+	uint32_t debounceLimit_us;
+	ChannelConfig_t channels;
+
+	/* Light level thresholds in ADC counts (LightSensor.c) */
+	uint16_t lightDarkThreshold;
+	uint16_t lightBrightThreshold;
+	uint16_t lightHysteresis;
+
+	/* Node bus (NodeBus.c) - BUS_CONFIG overrides them until the reboot */
+	uint8_t busAddress;
+	uint8_t busGroups;
+	uint8_t busLeader;
+	uint8_t reserved[3];					/* 0 */
+
+	uint32_t crc;							/* Hash_Crc32 of everything above */
+}SiteConfig_t;
+
+_Static_assert(sizeof(SiteConfig_t) == SITE_CONFIG_SIZE, "The layout of the site configuration block changed - new SITE_CONFIG_VERSION");
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern const SiteConfig_t SiteConfigDefault;
+extern const SiteConfig_t *SiteConfig;		/* the block in the flash or SiteConfigDefault */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* First thing of the boot - every module reads its configuration through SiteConfig from then on */
+void SiteConfig_Init(void);
+
+/* NULL for a valid block, the name of the first field in error otherwise */
+const char* SiteConfig_Check(const SiteConfig_t *config);
+
+/* USB link commands */
+void SiteConfig_Info(void);
+void SiteConfig_Read(const uint8_t *payload, uint32_t length);
+void SiteConfig_Write(const uint8_t *payload, uint32_t length);
+
+#endif /* SITECONFIG_H */
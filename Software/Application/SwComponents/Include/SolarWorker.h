@@ -0,0 +1,59 @@
+#ifndef SOLARWORKER_H
+#define SOLARWORKER_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "ElectronicBlinds_Main.h"
+#include "SunTracker.h"
+
+/*--------------- MACROS ---------------*/
+
+/* The slow part of the automatic control, in a task below every other one (SOLAR_WORKER_TASK_PRIORITY): the drift correction
+   of the DS1307 and the saved debounce windows, the blocking I2C reads of the clock, the schedule of the year (Schedule_Compile -
+   a soft-double CalculateSunriseSunset per day) and the sun of the day of the glare control (SunTracker_BeginDay). Every run
+   publishes a SolarDay_t and gives SolarDaySemaphore - AutomaticControlTask wakes up on it, reads the day and decides the moves.
+   A run of the worker is preempted by the buttons and the motor, the decisions never wait for it.
+
+   The day is published as a latch - two copies and a sequence number: the worker writes the copy the readers are not sent to,
+   then moves them over and writes the other one. A reader at a higher priority (the worker never runs in the middle of it)
+   gets a complete copy at the first try, a reader on the other core tries again at most once per publish */
+#define SOLAR_WORKER_MAX_READ_TRIES			(4U)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Clock of the run and what was computed for it */
+typedef struct
+{
+	uint32_t run;						/* publishes since the boot - 0, nothing published yet */
+	uint8_t yearBCD, monthBCD, dayBCD;	/* DS1307 */
+	uint8_t hourBCD, minuteBCD;
+	uint8_t isClosed;					/* DS1307_REG_ADDR_IS_CLOSED */
+	uint32_t dayOfYear;
+	int32_t minuteOfYear;				/* of the compiled schedule (Schedule_IsOpen) */
+#if (GLARE_CONTROL_ENABLED == 1)
+	SunTracker_t sunDay;				/* base state of the day (SunTracker_BeginDay), the minute not set */
+#endif
+}SolarDay_t;
+
+typedef struct
+{
+	uint32_t publishes;
+	uint32_t compiles;					/* Schedule_Compile - at the boot and at the new year */
+	uint32_t sunDays;					/* SunTracker_BeginDay */
+	uint32_t readRetries;				/* reads that found the day moving under them */
+}SolarWorkerStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern SemaphoreHandle_t SolarDaySemaphore;	/* given after every publish */
+extern SolarWorkerStats_t SolarWorkerStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void SolarWorkerTask( void *pvParameters );
+
+/* The day published last - false if there is none yet (or it kept moving for SOLAR_WORKER_MAX_READ_TRIES) */
+bool SolarWorker_Read(SolarDay_t *day);
+
+#endif /* SOLARWORKER_H */
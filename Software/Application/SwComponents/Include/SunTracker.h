@@ -0,0 +1,75 @@
+#ifndef SUNTRACKER_H
+#define SUNTRACKER_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+#include "Channels.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Position of the sun through the day - the declination and the equation of time of the day (the NOAA chain of
+   CalculateSunriseSunset) are computed once per day, then the hour angle is turned by a quarter of a degree per minute
+   of the clock. A minute costs a few float multiplications and no trigonometric function. The direction of the sun is
+   a unit vector in the horizontal frame of the site - east, north, up */
+#define SUN_TRACKER_STEP_DEG				(0.25f)			/* the earth turns 360 degrees in 1440 minutes */
+#define SUN_TRACKER_MAX_STEPS				(60)			/* longer jumps (RTC set, missed runs) are computed directly */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+	/* Base state of the day */
+	uint32_t dayOfYear;
+	int32_t utcOffset_min;				/* of the clock - the DST included */
+	float solarOffset_min;				/* true solar time minus the clock */
+	float sinLatSinDecl, cosLatCosDecl;	/* up = sinLatSinDecl + cosLatCosDecl * cos(H) */
+	float cosLatSinDecl, sinLatCosDecl;	/* north = cosLatSinDecl - sinLatCosDecl * cos(H) */
+	float cosDecl;						/* east = -cosDecl * sin(H) */
+	float windowEast[BLINDS_MAX_NUM_OF_CHANNELS];	/* horizontal unit vector out of the window of the channel */
+	float windowNorth[BLINDS_MAX_NUM_OF_CHANNELS];
+
+	/* Hour angle H of the minute */
+	int32_t minute;						/* of the clock day, -1 before the first SunTracker_Seek */
+	float cosHourAngle, sinHourAngle;
+}SunTracker_t;
+
+/* Window of a channel - the blind covers the glass from the top, its position is the covered part of the glass height
+   (0 - open, 1 - closed). Heights and depths in mm */
+typedef struct
+{
+	bool enabled;
+	float azimuth_deg;					/* direction the window faces - clockwise from the north, 180 south */
+	float height_mm;					/* of the glass, from the sill to the top */
+	float overhangDepth_mm;				/* horizontal depth of a balcony/eave above the window, 0 - none */
+	float overhangGap_mm;				/* from the top of the glass up to the overhang */
+	float penetration_mm;				/* how far the direct sun may reach into the room at the sill height */
+}SunTrackerWindow_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern const SunTrackerWindow_t SunTrackerWindows[BLINDS_MAX_NUM_OF_CHANNELS];	/* GLARE_CONTROL_ENABLED */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Base state of the day (1..366) at the site, the clock utcOffset_min ahead of the UTC, and the directions of the windows
+   (SunTrackerWindows) - the position is unknown until SunTracker_Seek */
+void SunTracker_BeginDay(SunTracker_t *tracker, double latitude, double longitude, uint32_t dayOfYear, int32_t utcOffset_min);
+
+/* Hour angle of the minute of the clock day computed directly (one sine and cosine) */
+void SunTracker_Seek(SunTracker_t *tracker, int32_t minute);
+
+/* To the minute of the clock day - stepped from the current minute if it is up to SUN_TRACKER_MAX_STEPS ahead, else SunTracker_Seek */
+void SunTracker_Advance(SunTracker_t *tracker, int32_t minute);
+
+/* Unit vector towards the sun - east, north, up (negative below the horizon) */
+void SunTracker_Direction(const SunTracker_t *tracker, float *east, float *north, float *up);
+
+/* Elevation (-90..90) and azimuth (0..360, clockwise from the north) in degrees - for the logs and tools, not per minute */
+void SunTracker_ElevationAzimuth(const SunTracker_t *tracker, float *elevation_deg, float *azimuth_deg);
+
+/* Position of the blind of the channel (0..1) that keeps the direct sun out of the room deeper than penetration_mm - 0 when
+   the sun is below the horizon, behind the window or the overhang shades the lit part of the glass enough */
+float SunTracker_GlarePosition(const SunTracker_t *tracker, uint32_t channel);
+
+#endif /* SUNTRACKER_H */
@@ -0,0 +1,74 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* Includes from the DS1307 library */
+#include "I2C_Driver.h"
+
+/*--------------- MACROS ---------------*/
+
+/* TIME_SYNC payload (LE): the UTC of the host when it sent the frame, in us since 1970 (64-bit), and its estimate of the link
+   delay in us (32-bit - half the shortest TIME_INFO round trip). The board writes the local civil time of the next whole second
+   (the time zone of SiteConfig, DST by isDST) into the DS1307 right at that second - the 7 time registers in one I2C burst, the divider
+   chain of the DS1307 restarts when the seconds register is written */
+#define TIME_SYNC_PAYLOAD_SIZE				(12U)
+#define TIME_INFO_PAYLOAD_SIZE				(4U)			/* sequence (32-bit LE) - echoed in #TIME */
+#define TIME_SYNC_UNIX_2000_IN_S			(946684800LL)	/* 2000-01-01 00:00:00 UTC in the UNIX time */
+#define TIME_SYNC_MIN_LEAD_IN_US			(20000U)		/* the second written is at least that far ahead of the frame */
+#define TIME_SYNC_WRITE_LEAD_IN_US			((3U * 9U * 1000000U) / I2C_FAST_MODE)	/* address, register and seconds bytes on the bus */
+#define TIME_SYNC_MUTEX_WAIT_IN_MS			(500U)			/* SolarWorkerTask holds the RTC longer only for a step - #ERR busy */
+#define TIME_SYNC_EDGE_POLL_IN_MS			(1U)
+#define TIME_SYNC_EDGE_TIMEOUT_IN_MS		(1100U)
+#define TIME_SYNC_DS1307_I2C_ADDRESS		(0x68U)
+#define TIME_SYNC_I2C_TIMEOUT_IN_US			(5000U)
+
+/* Drift - the offset of the DS1307 against the host just before a sync (the edge of its seconds register) over the time since the
+   previous sync, without the steps made in between. Between the syncs SolarWorkerTask steps the clock by a second whenever
+   the correction due is half a second off the steps made so far. Kept in the battery backed RAM of the DS1307 */
+#define TIME_SYNC_NVRAM_ADDR				(0x10U)			/* past DS1307_REG_ADDR_IS_CLOSED */
+#define TIME_SYNC_MAGIC						(0x434E5953U)	/* "SYNC" */
+#define TIME_SYNC_MIN_INTERVAL_IN_S			(3600U)			/* a sync sooner after the previous one keeps the drift */
+#define TIME_SYNC_MAX_DRIFT_PPB				(500000)		/* 500ppm - more is a clock set some other way, not a drift */
+#define TIME_SYNC_STEP_THRESHOLD_IN_MS		(500)
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t syncSeconds;					/* local time written by the last sync, seconds since 2000 */
+	int32_t utcOffset_min;					/* of that local time - the DS1307 does not switch the DST itself */
+	int32_t drift_ppb;						/* of the DS1307 against the host, positive - the clock runs fast */
+	int32_t corrected_ms;					/* steps since the last sync */
+	uint32_t crc;							/* Hash_Crc32 of the fields above */
+}TimeSyncState_t;
+
+typedef struct
+{
+	uint32_t syncs;
+	uint32_t steps;
+	int32_t lastOffset_ms;					/* DS1307 against the host before the last sync, 0 - not measured */
+}TimeSyncStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern TimeSyncState_t TimeSyncState;
+extern TimeSyncStats_t TimeSyncStats;
+extern SemaphoreHandle_t RtcMutex;			/* the DS1307 on I2C0 - SolarWorkerTask, AutomaticControlTask and the USB link */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void TimeSync_Init(void);
+
+/* Drift correction - SolarWorkerTask, RtcMutex taken. Waits for the next second of the DS1307 (up to a second) when a step is due,
+   no longer than until the supply fails */
+void TimeSync_Service(void);
+
+/* USB link commands */
+void TimeSync_Info(const uint8_t *payload, uint32_t length);
+void TimeSync_Sync(const uint8_t *payload, uint32_t length);
+
+#endif /* TIMESYNC_H */
@@ -0,0 +1,64 @@
+#ifndef TIMERSERVICE_H
+#define TIMERSERVICE_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/irq.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Timer service: one hardware alarm for every software deadline of the firmware (the debounce and back-off of ButtonTask.c and
+   whatever comes next) - alarm 1 stays free, alarm 2 is the profiler (Profiler.h), alarm 3 the default alarm pool of the SDK.
+   The deadlines sit in a hierarchical timing wheel on the 64-bit microsecond timer: level n has TIMER_SERVICE_SLOTS slots of
+   2^(TIMER_SERVICE_SLOT_BITS * n) us, a deadline goes to the level of the highest bit in which it differs from the time of the
+   wheel - start and cancel are O(1) at any distance, a deadline moves down a level at most once per level before it expires.
+   The alarm is set to the earliest slot only, the callbacks run in its interrupt at the exact microsecond */
+#define TIMER_SERVICE_ALARM_NUM				(0U)
+#define TIMER_SERVICE_IRQ					(TIMER_IRQ_0)
+#define TIMER_SERVICE_SLOT_BITS				(5U)
+#define TIMER_SERVICE_SLOTS					(1U << TIMER_SERVICE_SLOT_BITS)		/* an occupancy bit of each in a 32-bit word */
+#define TIMER_SERVICE_LEVELS				((64U + TIMER_SERVICE_SLOT_BITS - 1U) / TIMER_SERVICE_SLOT_BITS)
+#define TIMER_SERVICE_MAX_ALARM_US			(0x40000000U)		/* the alarm compares 32 bits - a later slot is reached in steps */
+
+/*--------------- DATA TYPES ---------------*/
+
+struct TimerService_Timer;
+typedef void (*TimerService_Callback_t)(struct TimerService_Timer *timer, void *context);
+
+/* A deadline - owned by the caller (static), set up once with TimerService_Setup */
+typedef struct TimerService_Timer
+{
+	struct TimerService_Timer *next;
+	struct TimerService_Timer **pprev;		/* the link pointing at this one, NULL - not armed */
+	uint64_t deadline_us;
+	uint32_t period_us;						/* 0 - one-shot */
+	TimerService_Callback_t callback;
+	void *context;
+	uint8_t level, slot;
+}TimerService_Timer_t;
+
+typedef struct
+{
+	uint32_t starts;
+	uint32_t cancels;
+	uint32_t expiries;
+	uint32_t cascades;						/* deadlines moved down a level */
+	uint32_t maxLate_us;					/* callback after its deadline - the interrupts disabled meanwhile */
+}TimerServiceStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern TimerServiceStats_t TimerServiceStats;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* The alarm interrupt is taken by the core which calls TimerService_Init. The rest may be called from the tasks on any core and
+   from the interrupt handlers, the callbacks included - a timer started again replaces its old deadline */
+void TimerService_Init(void);
+void TimerService_Setup(TimerService_Timer_t *timer, TimerService_Callback_t callback, void *context);
+void TimerService_Start(TimerService_Timer_t *timer, uint32_t delay_us);
+void TimerService_StartPeriodic(TimerService_Timer_t *timer, uint32_t period_us);		/* the first expiry a period from now */
+void TimerService_Cancel(TimerService_Timer_t *timer);
+bool TimerService_IsArmed(const TimerService_Timer_t *timer);
+
+#endif /* TIMERSERVICE_H */
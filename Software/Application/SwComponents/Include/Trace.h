@@ -0,0 +1,123 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+#include "hardware/flash.h"
+#include "ElectronicBlinds_Main.h"
+#include "Channels.h"
+#include "BootControl.h"
+
+/* Includes from the DS1307 library */
+#include "I2C_Driver.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Trace area (BOOT_TRACE_OFFSET): the header page, then the records up to the end of the area. A record is
+   type (1 byte, TraceType_t), id (1 byte), the time since the previous record in us and the value (both LEB128 varints).
+   The first erased byte where a type is expected ends the trace */
+#define TRACE_MAGIC							(0x43525442U)	/* "BTRC" */
+#define TRACE_VERSION						(1U)
+#define TRACE_DATA_OFFSET					(BOOT_TRACE_OFFSET + FLASH_PAGE_SIZE)
+#define TRACE_DATA_SIZE						(BOOT_TRACE_SIZE - FLASH_PAGE_SIZE)
+#define TRACE_END_OF_RECORDS				(0xFFU)
+#define TRACE_MAX_RECORD_SIZE				(2U + 10U + 5U)
+
+#define TRACE_RAM_SIZE						(2048U)		/* records not programmed yet - a multiple of FLASH_PAGE_SIZE */
+#define TRACE_FLUSH_PERIOD_IN_MS			(10000U)	/* a partly filled page is programmed (again) at most that often */
+#define TRACE_DATA_CHUNK					(48U)		/* bytes per #TDATA response */
+
+/* The record calls compile to nothing without TRACE_ENABLED */
+#if (TRACE_ENABLED == 1)
+#define TRACE_RECORD(type, id, value)		Trace_Record((type), (id), (value))
+#define TRACE_MOTOR_OUTPUTS(channel, motorControl1, motorControl2)	Trace_Record(TRACE_MOTOR, (channel), ((motorControl1) ? 1U : 0U) | ((motorControl2) ? 2U : 0U))
+#else
+#define TRACE_RECORD(type, id, value)
+#define TRACE_MOTOR_OUTPUTS(channel, motorControl1, motorControl2)
+#endif
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Everything the firmware takes from the outside world (so a host replay can feed it back) and the motor outputs it drives */
+typedef enum
+{
+	TRACE_GPIO_EDGE = 1,	/* id GPIO, value - GPIO_IRQ_EDGE_* events of the interrupt handler */
+	TRACE_INPUTS,			/* value - the channel inputs read by the firmware, when they differ from what the trace has shown so far */
+	TRACE_I2C_READ,			/* id register, value - when it differs from the last value read or written */
+	TRACE_I2C_WRITE,		/* id register, value */
+	TRACE_MOTOR				/* id channel, value - MOTOR_CONTROL_1 | MOTOR_CONTROL_2 << 1, when it changes */
+}TraceType_t;
+
+typedef enum
+{
+	TRACE_STATE_OFF,		/* no capture in this boot - the area holds the trace of an earlier boot (or nothing) */
+	TRACE_STATE_CAPTURING,
+	TRACE_STATE_FULL,		/* the area is full - the records up to there are complete */
+	TRACE_STATE_OVERFLOW	/* the records came faster than they could be programmed - the trace ends before that */
+}TraceState_t;
+
+/* First page of the trace area - the replay has to run an image built with the same configuration */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t channels;					/* BLINDS_NUM_OF_CHANNELS */
+	uint32_t features;					/* TRACE_FEATURE_* */
+	uint64_t origin_us;					/* time_us_64 the first record time counts from */
+}TraceHeader_t;
+
+#define TRACE_FEATURE_LIGHT_SENSOR			(1U << 0)
+#define TRACE_FEATURE_MOTION_SENSOR			(1U << 1)
+#define TRACE_FEATURE_SCHEDULE_RULES		(1U << 2)
+#define TRACE_FEATURES						(((LIGHT_SENSOR_ENABLED == 1) ? TRACE_FEATURE_LIGHT_SENSOR : 0U) | \
+											 ((MOTION_SENSOR_ENABLED == 1) ? TRACE_FEATURE_MOTION_SENSOR : 0U) | \
+											 ((SCHEDULE_RULES_ENABLED == 1) ? TRACE_FEATURE_SCHEDULE_RULES : 0U))
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern volatile TraceState_t TraceState;
+extern uint64_t TraceOrigin_us;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Capture runs in a cold boot with an erased trace area (Trace_Start erases it and reboots) - a watchdog reset
+   keeps the trace of the boot that crashed */
+void Trace_Init(bool fastBoot);
+void Trace_Record(TraceType_t type, uint32_t id, uint32_t value);
+void Trace_Service(void);			/* UsbLinkTask - programs the records into the flash */
+void Trace_Flush(void);				/* programs everything recorded so far */
+uint32_t Trace_Length(void);		/* bytes of the trace in the flash - the header page and the records, 0 if there is none */
+
+/* USB link commands */
+void Trace_Info(void);
+void Trace_Start(void);
+void Trace_Read(const uint8_t *payload, uint32_t length);
+
+/* Inputs read by the firmware - recorded with TRACE_ENABLED */
+static inline uint32_t Trace_GpioGetAll(void)
+{
+	uint32_t levels = gpio_get_all();
+	TRACE_RECORD(TRACE_INPUTS, 0U, levels & ChannelLookup.inputsMask);
+	return levels;
+}
+
+static inline bool Trace_GpioGet(uint gpio)
+{
+	return ((Trace_GpioGetAll() >> gpio) & 1U) != 0U;
+}
+
+static inline uint8_t Trace_I2cRead(uint8_t reg)
+{
+	uint8_t value = I2C_Register_Read(reg);
+	TRACE_RECORD(TRACE_I2C_READ, reg, value);
+	return value;
+}
+
+static inline bool Trace_I2cWrite(uint8_t reg, uint8_t value)
+{
+	TRACE_RECORD(TRACE_I2C_WRITE, reg, value);
+	return I2C_Register_Write(reg, value);
+}
+
+#endif /* TRACE_H */
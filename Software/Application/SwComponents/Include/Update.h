@@ -0,0 +1,58 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "BootControl.h"
+
+/*--------------- MACROS ---------------*/
+
+#define UPDATE_CONFIRM_DELAY_IN_MS			(30000U)	/* a new image that ran that long (no watchdog reset) confirms itself */
+#define UPDATE_REBOOT_DELAY_IN_MS			(100U)		/* for the last response to get out over USB */
+
+/* UPDATE_BEGIN payload: image size, payload size (32-bit LE), flags, SHA-256 of the new image, SHA-256 of the running
+   image the payload refers to (UPDATE_FLAG_DELTA) */
+#define UPDATE_BEGIN_IMAGE_SIZE				(0U)
+#define UPDATE_BEGIN_PAYLOAD_SIZE			(4U)
+#define UPDATE_BEGIN_FLAGS					(8U)
+#define UPDATE_BEGIN_IMAGE_HASH				(9U)
+#define UPDATE_BEGIN_BASE_HASH				(UPDATE_BEGIN_IMAGE_HASH + HASH_SHA256_SIZE)
+#define UPDATE_BEGIN_SIZE					(UPDATE_BEGIN_BASE_HASH + HASH_SHA256_SIZE)
+#define UPDATE_FLAG_DELTA					(0x01U)
+
+/* Update payload - the new image as a sequence of operations, numbers as LEB128 varints (7 bits per byte, LSB first).
+   A full image is a single UPDATE_OP_DATA, a delta against the running image mostly UPDATE_OP_ADD: the code that
+   moved by a few bytes is the same except for the addresses in it, so the differences are a few sparse bytes */
+#define UPDATE_OP_DATA						(0x01U)		/* length, then the bytes of the new image */
+#define UPDATE_OP_ADD						(0x02U)		/* offset in the running image, length, then until length is covered:
+														   count of bytes equal to the running image, count of bytes that
+														   differ and their differences (new - running, mod 256) */
+#define UPDATE_VARINT_MAX_SHIFT				(28U)
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+	uint32_t updates;						/* updates staged (request written) */
+	uint32_t sectorsWritten;				/* download slot sectors erased and programmed */
+	uint32_t sectorsUnchanged;				/* sectors equal to the running image - not written, not swapped */
+	uint32_t rejectedFrames;				/* UPDATE_DATA out of sequence or while a motor runs */
+}UpdateStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern UpdateStats_t UpdateStats;
+extern BootState_t UpdateBootState;			/* as found at the boot */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void Update_Init(void);
+void Update_Poll(void);
+
+/* USB link commands */
+void Update_Info(void);
+void Update_Begin(const uint8_t *payload, uint32_t length);
+void Update_Data(const uint8_t *payload, uint32_t length);
+void Update_End(void);
+void Update_Abort(void);
+
+#endif /* UPDATE_H */
@@ -0,0 +1,75 @@
+#ifndef USBLINK_H
+#define USBLINK_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Host -> board frame: SYNC_1 SYNC_2 command length(16-bit LE) payload CRC-32(command, length, payload - 32-bit LE).
+   Board -> host: one text line per response, starting with USB_LINK_RESPONSE_MARK (prints may come in between) */
+#define USB_LINK_SYNC_1						(0x55U)
+#define USB_LINK_SYNC_2						(0xAAU)
+#define USB_LINK_HEADER_SIZE				(5U)
+#define USB_LINK_CRC_SIZE					(4U)
+#define USB_LINK_MAX_PAYLOAD				(4U + 1024U)	/* UPDATE_DATA - payload offset and up to 1KB of the update */
+#define USB_LINK_MAX_FRAME					(USB_LINK_HEADER_SIZE + USB_LINK_MAX_PAYLOAD + USB_LINK_CRC_SIZE)
+#define USB_LINK_MAX_RESPONSE				(128U)
+#define USB_LINK_RESPONSE_MARK				('#')
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	USB_LINK_CMD_INFO = 0x01,				/* -> #INFO <boot state> <attempts> <image size> <image SHA-256> */
+	USB_LINK_CMD_UPDATE_BEGIN = 0x10,		/* -> #ACK 0 | #ERR <reason> 0 */
+	USB_LINK_CMD_UPDATE_DATA = 0x11,		/* -> #ACK <payload bytes received> | #ERR <reason> <payload offset expected> */
+	USB_LINK_CMD_UPDATE_END = 0x12,			/* -> #DONE <sectors changed> <sectors> (and the reboot) | #ERR <reason> 0 */
+	USB_LINK_CMD_UPDATE_ABORT = 0x13,		/* -> #ACK 0 */
+	USB_LINK_CMD_TRACE_INFO = 0x20,			/* -> #TRACE <state> <bytes of the trace> (TRACE_ENABLED) */
+	USB_LINK_CMD_TRACE_START = 0x21,		/* -> #ACK 0 (and the reboot into the capture) | #ERR <reason> 0 */
+	USB_LINK_CMD_TRACE_READ = 0x22,			/* offset (32-bit LE) -> #TDATA <offset> <bytes of the trace area in hex> - none past the end */
+	USB_LINK_CMD_MOTOR = 0x30,				/* channel, MotorState_t -> #ACK 0 | #ERR <reason> 0 */
+	USB_LINK_CMD_MOTOR_INFO = 0x31,			/* -> #MOTOR <submitted> <applied> <coalesced> <preempted> <dropped> <expired> */
+	USB_LINK_CMD_POSITION = 0x32,			/* channel, position 1/1000 (16-bit LE) -> #ACK 0 | #ERR <reason> 0 (ENCODER_ENABLED) */
+	USB_LINK_CMD_POSITION_INFO = 0x33,		/* -> #POSITION <count> <position 1/1000> <moves> <missed> <corrections> <aborted> <stalls> <last error> <last us> <overrun us down> <up> */
+	USB_LINK_CMD_TIME_INFO = 0x40,			/* sequence -> #TIME <sequence> <DS1307 date> <time> <drift ppb> <corrected ms> <syncs> | #ERR <reason> 0 */
+	USB_LINK_CMD_TIME_SYNC = 0x41,			/* host UTC, link delay -> #SYNC <offset ms> <drift ppb> <interval s> | #ERR <reason> 0 */
+	USB_LINK_CMD_CYCLE_INFO = 0x50,			/* item -> #CYCLES <name> <count> <avg> <worst> <avg XIP misses> <worst> <at the worst cycles> | #ERR item 0 */
+	USB_LINK_CMD_CYCLE_RESET = 0x51,		/* -> #ACK 0 */
+	USB_LINK_CMD_DEBOUNCE_INFO = 0x60,		/* input -> #DEBOUNCE <channel> <input> <settle us> <samples> <p50 us> <p95 us> <longest us> | #ERR item 0 */
+	USB_LINK_CMD_BUS_INFO = 0x70,			/* -> #BUS <address> <groups> <leader> <rx frames> <other frames> <bad frames> <tx frames> <tx dropped> <moves> (NODE_BUS_ENABLED) */
+	USB_LINK_CMD_BUS_CONFIG = 0x71,			/* address, groups, leader -> #ACK 0 | #ERR <reason> 0 */
+	USB_LINK_CMD_BUS_MOVE = 0x72,			/* destination, channel mask, MotorState_t -> #ACK 0 | #ERR <reason> 0 */
+	USB_LINK_CMD_BUS_PING = 0x73,			/* address -> #PONG <address> <groups> <round trip us> | #ERR <reason> 0 */
+	USB_LINK_CMD_CONFIG_INFO = 0x80,		/* -> #CONFIG <flash|default> <version> <CRC> <state of the flash block> */
+	USB_LINK_CMD_CONFIG_READ = 0x81,		/* offset (32-bit LE) -> #CDATA <offset> <bytes of the block in use in hex> - none past the end */
+	USB_LINK_CMD_CONFIG_WRITE = 0x82,		/* SiteConfig_t -> #ACK 0 (and the reboot into it) | #ERR <reason> 0 */
+	USB_LINK_CMD_PROFILE_START = 0x90,		/* rate Hz (32-bit LE), 0 - stop -> #ACK 0 | #ERR <reason> 0 (PROFILER_ENABLED) */
+	USB_LINK_CMD_PROFILE_INFO = 0x91,		/* -> #PROFILE <state> <rate Hz> <period us> <samples> <late> <tasks> */
+	USB_LINK_CMD_PROFILE_READ = 0x92,		/* first sample (32-bit LE) -> #PDATA <first sample> <samples in hex> - none past the last one */
+	USB_LINK_CMD_PROFILE_TASK = 0x93,		/* task index -> #PTASK <index> <name> | #ERR item 0 */
+	USB_LINK_CMD_POWER_INFO = 0xA0			/* -> #POWER <supply mV> <lowest mV> <failures> <recoveries> <flushes> <flush errors> <last flush us>
+											   <longest flush us> <boot record 0|1> <its channel bytes in hex> <its count> <its span> <encoder restored 0|1>
+											   (POWER_MONITOR_ENABLED) */
+}UsbLinkCommand_t;
+
+typedef struct
+{
+	uint32_t frames;						/* valid frames received */
+	uint32_t badFrames;						/* dropped - CRC error or a length over USB_LINK_MAX_PAYLOAD */
+	uint32_t bytes;							/* all the bytes received */
+}UsbLinkStats_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern UsbLinkStats_t UsbLinkStats;
+extern SemaphoreHandle_t UsbLinkSemaphore;	/* given by the stdio driver when characters arrive */
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+void UsbLink_Init(void);
+void UsbLink_Respond(const char *format, ...);
+void UsbLinkTask(void *pvParameters);
+
+#endif /* USBLINK_H */
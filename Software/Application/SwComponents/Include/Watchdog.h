@@ -0,0 +1,85 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ElectronicBlinds_Main.h"
+#include "MotorControllerTask.h"
+
+/*--------------- MACROS ---------------*/
+
+/* Hardware watchdog - fed by the tick interrupt as long as every task checked in within its deadline */
+#define WATCHDOG_TIMEOUT_IN_MS				(100U)
+#define WATCHDOG_STABLE_RUN_IN_MS			(60000U)	/* after that long without a reset the consecutive reset count starts over */
+#define WATCHDOG_MAX_RESUMES				(2U)		/* consecutive resets that resume a move - a move that keeps crashing is aborted */
+#define WATCHDOG_FLASH_TIMEOUT_IN_MS		(1000U)		/* while the flash is erased/programmed (no tick interrupts) - sector erase 45ms typ, 400ms max */
+
+/* Check-in deadlines (ms) - a task that did not check in for that long is considered hung */
+#define WATCHDOG_DEADLINE_BUTTON			(3U * BUTTON_TASK_PERIOD)
+#define WATCHDOG_DEADLINE_MOTOR_CONTROLLER	(3U * MOTOR_CONTROLLER_TASK_PERIOD)
+#define WATCHDOG_DEADLINE_AUTOMATIC_CONTROL	(AUTOMATIC_CONTROL_TASK_PERIOD + 10000U)	/* a run of SolarWorkerTask with its I2C transfers, then the decision */
+#define WATCHDOG_DEADLINE_MOTION_SENSOR		(3U * MOTION_SENSOR_TASK_PERIOD)
+#define WATCHDOG_DEADLINE_USB_LINK			(3000U)		/* includes hashing a whole image (SHA-256 of a full slot takes ~1s) */
+#define WATCHDOG_DEADLINE_NODE_BUS			(100U * NODE_BUS_TASK_PERIOD)
+
+/* Watchdog scratch registers 0..3 (4..7 are used by the SDK for watchdog_reboot) - they survive the reset */
+#define WATCHDOG_SCRATCH_MAGIC_REG			(0U)
+#define WATCHDOG_SCRATCH_CAUSE_REG			(1U)	/* WatchdogCause_t | client << 8 | consecutive resets << 16 */
+#define WATCHDOG_SCRATCH_CHANNELS_REG		(2U)	/* WATCHDOG_CHANNEL_* byte per channel */
+#define WATCHDOG_SCRATCH_MAGIC				(0xB11D5AFEU)
+
+/* Channel byte of the scratch register - the motor state, the request it was heading for and where it came from */
+#define WATCHDOG_CHANNEL_STATE_MASK			(0x03U)
+#define WATCHDOG_CHANNEL_TARGET_SHIFT		(2U)
+#define WATCHDOG_CHANNEL_AUTOMATIC			(0x10U)	/* requested by AutomaticControlTask */
+#define WATCHDOG_CHANNEL_BACKOFF			(0x20U)	/* limit switch back-off in progress */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	WATCHDOG_CLIENT_BUTTON,
+	WATCHDOG_CLIENT_MOTOR_CONTROLLER,
+	WATCHDOG_CLIENT_AUTOMATIC_CONTROL,
+	WATCHDOG_CLIENT_MOTION_SENSOR,
+	WATCHDOG_CLIENT_USB_LINK,
+	WATCHDOG_CLIENT_NODE_BUS,
+	WATCHDOG_NUM_OF_CLIENTS
+}WatchdogClient_t;
+
+typedef enum
+{
+	WATCHDOG_CAUSE_NONE,
+	WATCHDOG_CAUSE_TIMEOUT,				/* not fed - the tick interrupt stopped (interrupts disabled, a hung handler) */
+	WATCHDOG_CAUSE_CHECKIN				/* a task missed its check-in deadline */
+}WatchdogCause_t;
+
+/* What the previous run recorded before the watchdog reset it */
+typedef struct
+{
+	bool valid;							/* the last reset was a watchdog reset with a valid record */
+	WatchdogCause_t cause;
+	uint32_t client;					/* WatchdogClient_t that missed its deadline (WATCHDOG_CAUSE_CHECKIN) */
+	uint32_t resets;					/* consecutive watchdog resets, including this one */
+	MotorState_t state[BLINDS_NUM_OF_CHANNELS];
+	MotorState_t target[BLINDS_NUM_OF_CHANNELS];
+	uint32_t automaticMoves;			/* one bit per channel */
+	uint32_t backoffActive;				/* one bit per channel */
+	uint32_t resumedMoves;				/* one bit per channel - moves restarted by Watchdog_ResumeMoves */
+}WatchdogRecord_t;
+
+/*--------------- GLOBAL VARIABLE DECLARATIONS (extern) ---------------*/
+extern WatchdogRecord_t WatchdogLastReset;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+bool Watchdog_ReadRecord(void);
+void Watchdog_Init(void);
+void Watchdog_ResumeMoves(void);
+void Watchdog_CheckIn(WatchdogClient_t client);
+void Watchdog_TickHook(void);
+void Watchdog_SetTimeout(uint32_t timeout_ms);
+void Watchdog_Reboot(void);
+uint32_t Watchdog_PackChannels(void);
+
+#endif /* WATCHDOG_H */
@@ -1,4 +1,6 @@
-/* AutomaticControlTask.c - source file for the OS Task which handles automatic control of the Window Blinds */
+/* AutomaticControlTask.c - source file for the OS Task which handles automatic control of the Window Blinds. The task only
+   decides - the clock, the schedule of the year and the sun of the day come from SolarWorker (a task below the buttons and
+   the motor) */
 
 /*---------------- INCLUDES ----------------------*/
 
@@ -21,11 +23,62 @@
 #include "ElectronicBlinds_Main.h"
 #include "MotorControllerTask.h"
 #include "ButtonTask.h"
+#include "Channels.h"
+#include "CycleCounter.h"
+#include "LightSensor.h"
+#include "Schedule.h"
+#include "SunTracker.h"
+#include "Watchdog.h"
+#include "Trace.h"
+#include "TimeSync.h"
+#include "Debounce.h"
+#include "NodeBus.h"
+#include "SiteConfig.h"
+#include "SolarWorker.h"
+#include "Encoder.h"
 
 /* Includes from the DS1307 library */
 #include "DS1307.h"
 #include "I2C_Driver.h"
 
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+#if (GLARE_CONTROL_ENABLED == 1)
+/* Estimated position of a blind - known after a move to a limit switch and after the timed moves of the glare control alone,
+   always on the channel with the encoder once it counted the travel between the switches */
+typedef struct
+{
+    float position;                 /* 0 - open, 1 - closed */
+    bool known;
+    bool moving;                    /* a move of AutomaticControlTask not seen finished yet */
+    bool toLimit;                   /* the move runs to a limit switch */
+    float target;
+    uint32_t starts;                /* MotorChannelStarts when the blind was last seen at rest (or the move was submitted) */
+}GlareChannel_t;
+#endif
+
+/* A move of the schedule - DS1307_REG_ADDR_IS_CLOSED takes its target when it is accepted, the state before it is kept until it
+   ended at the limit switches of every channel that took it. A power cut during the move writes that one back (PowerMonitor.c),
+   so the task starts the move again after the boot */
+typedef struct
+{
+    volatile bool running;
+    uint8_t isClosed;               /* the target */
+    uint8_t before;                 /* IS_CLOSED before the move */
+    uint32_t channels;              /* one bit per channel that took it */
+    uint32_t backoffs[BLINDS_NUM_OF_CHANNELS];  /* of the switch at its end when it was submitted */
+}AutomaticMove_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static AutomaticMove_t AutomaticMove;
+static volatile uint8_t AutomaticStoredClosed = BLINDS_UNKNOWN;
+
+#if (GLARE_CONTROL_ENABLED == 1)
+static SunTracker_t SunTrackerState;
+static GlareChannel_t GlareChannels[BLINDS_NUM_OF_CHANNELS];
+#endif
+
 /*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
 
 uint8_t ZellersCongruence(int year, int month, int day) 
@@ -120,9 +173,9 @@ uint32_t CalculateDayOfYear(uint32_t yearBCD, uint32_t monthBCD, uint32_t dayBCD
 
 /* Use https://gml.noaa.gov/grad/solcalc/ and the excel doc at: https://gml.noaa.gov/grad/solcalc/calcdetails.html 
    for reference/calibration of your sunset/sunrise functions! */
-/* The calculation will be accurate for DST time of the given time zone (Poland is E(east) + 2) */
-/* Function to calculate the sunrise and sunset times based on NOAA solar calculator */
-void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, int timeZone, double* sunrise, double* sunset) 
+/* Declination of the sun (in degrees) and the equation of time (in minutes) at the noon of the day, based on NOAA solar calculator -
+   the part of the sunrise/sunset calculation that does not depend on the site (SunTracker takes it as the base of the day) */
+void CalculateSolarDay(int dayOfYear, int timeZone, double* declination, double* eqOfTime)
 {
     // Define the time (12:00:00)
     double Time = 0.5; 
@@ -145,14 +198,12 @@ void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, in
     // Calculate the variable y
     double var_y = tan(degToRad(ObligCorr / 2)) * tan(degToRad(ObligCorr / 2));
     // Calculate the equation of time (in minutes)
-    double EqOfTime = 4 * radToDeg(var_y * sin(2 * degToRad(GeomMeanLongSun))
+    *eqOfTime = 4 * radToDeg(var_y * sin(2 * degToRad(GeomMeanLongSun))
                 - 2 * EccentEarthOrbit * sin(degToRad(GeomMeanAnomSun))
                 + 4 * EccentEarthOrbit * var_y * sin(degToRad(GeomMeanAnomSun)) * cos(2 * degToRad(GeomMeanLongSun))
                 - 0.5 * var_y * var_y * sin(4 * degToRad(GeomMeanLongSun))
                 - 1.25 * EccentEarthOrbit * EccentEarthOrbit * sin(2 * degToRad(GeomMeanAnomSun))); 
 
-    // Calculate the solar noon (in LST)
-    double SolarNoon = (720 - 4 * longitude - EqOfTime + timeZone * 60) / 1440; 
     // Calculate the Sun's equation of center  
     double SunEqOfCtr = sin(degToRad(GeomMeanAnomSun)) * (1.914602 - JulianCentury * (0.004817 + 0.000014 * JulianCentury))
                         + sin(degToRad(2 * GeomMeanAnomSun)) * (0.019993 - 0.000101 * JulianCentury)
@@ -162,7 +213,18 @@ void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, in
     // Calculate the Sun's apparent longitude (in degrees)
     double SunAppLong = SunTrueLong - 0.00569 - 0.00478 * sin(degToRad(125.04 - 1934.136 * JulianCentury)); 
     // Calculate the Sun's declination
-    double sunDeclin = radToDeg(asin(sin(degToRad(ObligCorr)) * sin(degToRad(SunAppLong))));
+    *declination = radToDeg(asin(sin(degToRad(ObligCorr)) * sin(degToRad(SunAppLong))));
+}
+
+/* The calculation will be accurate for DST time of the given time zone (Poland is E(east) + 2) */
+/* Function to calculate the sunrise and sunset times based on NOAA solar calculator */
+void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, int timeZone, double* sunrise, double* sunset) 
+{
+    double EqOfTime, sunDeclin;
+    CalculateSolarDay(dayOfYear, timeZone, &sunDeclin, &EqOfTime);
+
+    // Calculate the solar noon (in LST)
+    double SolarNoon = (720 - 4 * longitude - EqOfTime + timeZone * 60) / 1440; 
     // Calculate the hour angle for sunrise (in degrees)
     double HA_Sunrise = radToDeg(acos(cos(degToRad(90.833)) /
                         (cos(degToRad(latitude)) * cos(degToRad(sunDeclin)))
@@ -174,59 +236,247 @@ void CalculateSunriseSunset(double latitude, double longitude, int dayOfYear, in
     *sunset = ((SolarNoon * 1440 + HA_Sunrise * 4) / 1440) * 24;
 }
 
+/* State of the blinds in the RAM of the DS1307 - the one I2C transfer of the task, only when a move was accepted */
+void AutomaticSetClosed(uint8_t isClosed)
+{
+    AutomaticStoredClosed = isClosed;
+    (void)xSemaphoreTake(RtcMutex, portMAX_DELAY);
+    Trace_I2cWrite(DS1307_REG_ADDR_IS_CLOSED, isClosed);
+    xSemaphoreGive(RtcMutex);
+}
+
+/* Back-offs from the switch a move ends at - done or timed out (the motor stopped at the switch either way) */
+uint32_t AutomaticBackoffs(uint32_t channel, uint8_t isClosed)
+{
+    const LimitSwitchStats_t *stats = (isClosed == BLINDS_CLOSED) ? &BottomLimitStats[channel] : &TopLimitStats[channel];
+    return stats->count + stats->timeouts;
+}
+
+void AutomaticMoveSubmitted(uint8_t isClosed, uint8_t before, uint32_t channels)
+{
+    AutomaticMove.running = false;
+    AutomaticMove.isClosed = isClosed;
+    AutomaticMove.before = before;
+    AutomaticMove.channels = channels;
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        AutomaticMove.backoffs[channel] = AutomaticBackoffs(channel, isClosed);
+    }
+    AutomaticMove.running = true;
+}
+
+bool AutomaticMoveEnded(void)
+{
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        if((AutomaticMove.channels & CHANNEL_BIT(channel)) &&
+           (AutomaticBackoffs(channel, AutomaticMove.isClosed) == AutomaticMove.backoffs[channel]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if (GLARE_CONTROL_ENABLED == 1)
+/* Remembers a move of AutomaticControlTask - to a limit switch (target 0 or 1), or a timed one of the glare control */
+void GlareMoveSubmitted(uint32_t channel, float target, bool toLimit)
+{
+    GlareChannels[channel].moving = true;
+    GlareChannels[channel].toLimit = toLimit;
+    GlareChannels[channel].target = target;
+    GlareChannels[channel].starts = MotorChannelStarts[channel];
+}
+
+void GlareMoveToLimit(uint32_t channel, float target)
+{
+    MotorState_t state = (target > 0.0f) ? STATE_CLOCKWISE : STATE_ANTICLOCKWISE;
+    if(MotorCommand_Submit(channel, state, MOTOR_PRIORITY_AUTOMATIC, MOTOR_DEADLINE_AUTOMATIC_IN_US))
+    {
+        GlareMoveSubmitted(channel, target, true);
+    }
+}
+
+/* Partial positions of the channels with a window while the schedule keeps the blinds open - the sun tracker is stepped
+   to the minute of the clock from the base state of the day SolarWorker computed, a blind without a known position is
+   opened to the top switch first */
+void GlareControl(const SolarDay_t *day)
+{
+    if((SunTrackerState.dayOfYear != day->sunDay.dayOfYear) || (SunTrackerState.utcOffset_min != day->sunDay.utcOffset_min))
+    {
+        SunTrackerState = day->sunDay;
+    }
+    SunTracker_Advance(&SunTrackerState, (ConvertBCD(day->hourBCD, BCD_TO_DEC) * 60) + ConvertBCD(day->minuteBCD, BCD_TO_DEC));
+
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        GlareChannel_t *glare = &GlareChannels[channel];
+        /* Its own move still owns the channel at rest while a position move waits for the blind to stand after the brake */
+        if(!SunTrackerWindows[channel].enabled || (CurrentState[channel] != STATE_OFF) || MotorCommands[channel].pending ||
+           (MotorCommands[channel].priority == MOTOR_PRIORITY_AUTOMATIC))
+        {
+            continue;
+        }
+
+        /* At rest - a timed move is where it was aimed only if nobody else started the motor meanwhile (one start - its own) */
+        if(glare->moving)
+        {
+            glare->known = glare->toLimit || (MotorChannelStarts[channel] == (glare->starts + 1U));
+            glare->position = glare->target;
+            glare->moving = false;
+        }
+        else if(MotorChannelStarts[channel] != glare->starts)
+        {
+            glare->known = false;
+        }
+        glare->starts = MotorChannelStarts[channel];
+#if (ENCODER_ENABLED == 1)
+        bool counted = (channel == ENCODER_CHANNEL) && Encoder_Calibrated();
+        if(counted)
+        {
+            /* Wherever anybody left it */
+            glare->known = true;
+            glare->position = Encoder_PositionAt(Encoder_Read());
+        }
+#endif
+
+        /* The encoder reads the blind a little past a switch after the back-off - close enough is at the switch */
+        float target = SunTracker_GlarePosition(&SunTrackerState, channel);
+        LOG("glare %lu target %d%% position %d%% known %d\n", (unsigned long)channel, (int)(target * 100.0f), (int)(glare->position * 100.0f), (int)glare->known);
+        if(target >= GLARE_POSITION_CLOSED)
+        {
+            if(!glare->known || (glare->position < (1.0f - (GLARE_POSITION_STEP / 2.0f)))) GlareMoveToLimit(channel, 1.0f);
+        }
+        else if((target < GLARE_POSITION_STEP) || !glare->known)
+        {
+            if(!glare->known || (glare->position > (GLARE_POSITION_STEP / 2.0f))) GlareMoveToLimit(channel, 0.0f);
+        }
+        else if(fabsf(target - glare->position) >= GLARE_POSITION_STEP)
+        {
+#if (ENCODER_ENABLED == 1)
+            if(counted)
+            {
+                if(MotorCommand_SubmitPosition(channel, target, MOTOR_PRIORITY_AUTOMATIC, MOTOR_DEADLINE_AUTOMATIC_IN_US))
+                {
+                    GlareMoveSubmitted(channel, target, false);
+                }
+                continue;
+            }
+#endif
+            bool down = (target > glare->position);
+            float travel_ms = (float)(down ? BLIND_TRAVEL_DOWN_IN_MS : BLIND_TRAVEL_UP_IN_MS) * fabsf(target - glare->position);
+            if(MotorCommand_SubmitTimed(channel, down ? STATE_CLOCKWISE : STATE_ANTICLOCKWISE, MOTOR_PRIORITY_AUTOMATIC,
+                                        MOTOR_DEADLINE_AUTOMATIC_IN_US, (uint32_t)(travel_ms * 1000.0f)))
+            {
+                GlareMoveSubmitted(channel, target, false);
+            }
+        }
+    }
+}
+#endif
+
 /*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
 
+uint8_t AutomaticControl_ClosedToStore(void)
+{
+    if(AutomaticMove.running && !AutomaticMoveEnded())
+    {
+        return AutomaticMove.before;
+    }
+    return AutomaticStoredClosed;
+}
+
 /* TASK MAIN FUNCTION */
 void AutomaticControlTask( void *pvParameters )
 {
-    /* Set up task schedule */
-	TickType_t xTaskStartTime;
-	const TickType_t xTaskPeriod = pdMS_TO_TICKS(AUTOMATIC_CONTROL_TASK_PERIOD);
-	xTaskStartTime = xTaskGetTickCount();
+    SolarDay_t day;
 
-    /* Infinite task loop */
+    /* Infinite task loop - one decision per run of SolarWorker */
 	for( ;; )
 	{
-        /* Read current hour and minute (warning - will be incorrect during DST since it's adjusted at sunrise/sunset time) */
-        uint8_t hour = I2C_Register_Read(DS1307_REG_ADDR_HOURS);
-        uint8_t minute = I2C_Register_Read(DS1307_REG_ADDR_MINUTES);
-        /* Convert hour and minute to one double value - example: hour = 0x15, minute = 0x53 would be converted to time = 15.88*/
-        double time = ConvertBCD(hour, BCD_TO_DEC) + (ConvertBCD(minute, BCD_TO_DEC)/60.0);
-        /* Check if the blinds are currently closed (this is stored in RTC's RAM so it persists as long as RTC has power) */
-        uint8_t isClosed = I2C_Register_Read(DS1307_REG_ADDR_IS_CLOSED);
-
-        uint8_t day = I2C_Register_Read(DS1307_REG_ADDR_DAYS);
-        uint8_t month = I2C_Register_Read(DS1307_REG_ADDR_MONTHS);
-        uint8_t year = I2C_Register_Read(DS1307_REG_ADDR_YEARS);
-        uint32_t dayOfYear = CalculateDayOfYear(year, month, day);
+        (void)xSemaphoreTake(SolarDaySemaphore, portMAX_DELAY);
+        if(!SolarWorker_Read(&day))
+        {
+            continue;
+        }
+        Watchdog_CheckIn(WATCHDOG_CLIENT_AUTOMATIC_CONTROL);
+        CycleTimestamp_t jobStart = CycleCounter_TaskStart();
+        uint8_t isClosed = day.isClosed;
+        AutomaticStoredClosed = isClosed;
+        int32_t minuteOfYear = day.minuteOfYear;
 
-        double sunrise, sunset;
-        CalculateSunriseSunset(LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, dayOfYear, TIME_ZONE_PLUS_TO_E, &sunrise, &sunset);
+        int32_t narrow_min = 0;
+#if (LIGHT_SENSOR_ENABLED == 1)
+        /* Dark (overcast morning, storm) - open later and close earlier, bright - open earlier and close later */
+        if(LightLevel == LIGHT_LEVEL_DARK)
+        {
+            narrow_min = SCHEDULE_LIGHT_SHIFT_IN_MINUTES;
+        }
+        else if(LightLevel == LIGHT_LEVEL_BRIGHT)
+        {
+            narrow_min = -SCHEDULE_LIGHT_SHIFT_IN_MINUTES;
+        }
+        LOG("light = %lu level = %d \n", (unsigned long)LightFiltered, (int)LightLevel);
+#endif
+        bool isOpenTime = Schedule_IsOpen(minuteOfYear, narrow_min);
+#if (NODE_BUS_ENABLED == 1)
+        /* A follower on the node bus is moved by the schedule of the leader - its own one never asks for a change */
+        if(!NodeBusConfig.leader) isOpenTime = (isClosed == 0);
+#endif
 
-        /* Sunrise/sunset times are calculated according to DST time, so to compensate during non-DST period, substract an hour */
-        if(isDST(year, month, day) == false)
+        LOG("minuteOfYear = %ld open = %d \n", (long)minuteOfYear, (int)isOpenTime);
+        LOG("hour:%x minute:%x isClosed:%d \n", day.hourBCD, day.minuteBCD, isClosed);
+        if((isOpenTime == false) && (isClosed == 0)) /* Blinds closed */
         {
-            sunrise -= 1.0; 
-            sunset -= 1.0;
+            /* Close the blinds, the motor will stop when it hits bottom limitter. The starts of the channels are staggered by MotorControllerTask.
+               If every channel is held by a button (or a limit switch) the move is tried again in the next run */
+            uint32_t accepted = 0;
+            for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+            {
+                bool channelAccepted = MotorCommand_Submit(channel, STATE_CLOCKWISE, MOTOR_PRIORITY_AUTOMATIC, MOTOR_DEADLINE_AUTOMATIC_IN_US);
+#if (GLARE_CONTROL_ENABLED == 1)
+                if(channelAccepted) GlareMoveSubmitted(channel, 1.0f, true);
+#endif
+                if(channelAccepted) accepted |= CHANNEL_BIT(channel);
+            }
+            if(accepted != 0U)
+            {
+                AutomaticMoveSubmitted(BLINDS_CLOSED, isClosed, accepted);
+                AutomaticSetClosed(BLINDS_CLOSED); /* Change blinds current state to CLOSED */
+            }
+#if (NODE_BUS_ENABLED == 1)
+            /* The followers at once - sent again with every retry, the followers that already moved ignore it */
+            if(NodeBusConfig.leader) (void)NodeBus_Move(NODE_BUS_SCHEDULE_DESTINATION, NODE_BUS_ALL_CHANNELS, STATE_CLOCKWISE, MOTOR_PRIORITY_AUTOMATIC);
+#endif
         }
-        
-        LOG("sunrise = %lf \n", sunrise);
-        LOG("sunset = %lf \n", sunset);
-        LOG("time = %lf \n", time);
-        LOG("hour:%x minute:%x isClosed:%d \n", hour, minute, isClosed);
-        if(((time >= sunset) || (time < sunrise)) && (isClosed == 0)) /* Blinds closed */
+        else if((isOpenTime == true) && (isClosed == 1)) /* Blinds open */
         {
-            stateClockwise(); /* Close the blinds, the motor will stop when it hits bottom limitter */           
-            I2C_Register_Write(DS1307_REG_ADDR_IS_CLOSED, BLINDS_CLOSED); /* Change blinds current state to CLOSED */
+            /* Open the blinds, the motor will stop when it hits top limitter */
+            uint32_t accepted = 0;
+            for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+            {
+                bool channelAccepted = MotorCommand_Submit(channel, STATE_ANTICLOCKWISE, MOTOR_PRIORITY_AUTOMATIC, MOTOR_DEADLINE_AUTOMATIC_IN_US);
+#if (GLARE_CONTROL_ENABLED == 1)
+                if(channelAccepted) GlareMoveSubmitted(channel, 0.0f, true);
+#endif
+                if(channelAccepted) accepted |= CHANNEL_BIT(channel);
+            }
+            if(accepted != 0U)
+            {
+                AutomaticMoveSubmitted(BLINDS_OPEN, isClosed, accepted);
+                AutomaticSetClosed(BLINDS_OPEN); /* Change blinds current state to OPEN */
+            }
+#if (NODE_BUS_ENABLED == 1)
+            if(NodeBusConfig.leader) (void)NodeBus_Move(NODE_BUS_SCHEDULE_DESTINATION, NODE_BUS_ALL_CHANNELS, STATE_ANTICLOCKWISE, MOTOR_PRIORITY_AUTOMATIC);
+#endif
         }
-        else if((time >= sunrise && time < sunset) && (isClosed == 1)) /* Blinds open */
+#if (GLARE_CONTROL_ENABLED == 1)
+        else if((isOpenTime == true) && (isClosed == 0))
         {
-            stateAnticlockwise(); /* Open the blinds, the motor will stop when it hits top limitter */ 
-            I2C_Register_Write(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN); /* Change blinds current state to OPEN */
+            GlareControl(&day);
         }
+#endif
 
-        /* Delay until next cycle of the task */
-		vTaskDelayUntil(&xTaskStartTime, xTaskPeriod);
+        CycleCounter_TaskStop(CYCLES_TASK_AUTOMATIC_CONTROL, jobStart);
 	}
 }
-
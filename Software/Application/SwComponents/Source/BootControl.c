@@ -0,0 +1,323 @@
+/* BootControl.c - dual-slot firmware update: the boot control records, the swap of the slots and the roll-back */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <string.h>
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+/* Include files from other tasks */
+#include "BootControl.h"
+#include "Hash.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_FLASH_SAFE_TIMEOUT_IN_MS		(100U)	/* for the other core to get out of the way of the flash operation */
+#define BOOT_CONTROL_PAGE_OFFSET(page)		(BOOT_CONTROL_OFFSET + ((page) * FLASH_PAGE_SIZE))
+#define BOOT_REVERT_STARTED_BIT				(0U)	/* first bit of the revert page - the roll-back is decided, the steps follow */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+	uint32_t offset;
+	const uint8_t *data;					/* NULL - erase the sector at offset */
+	uint32_t length;
+}BootFlashOperation_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* End of the running image - provided by the linker script */
+extern char __flash_binary_end;
+
+/* The flash is not readable while it is programmed - the data of a page is always copied to RAM first */
+static uint8_t BootPageBuffer[FLASH_PAGE_SIZE];
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void BootControlFlashOperation(void *param);
+bool BootControlCopySector(uint32_t destination, uint32_t source);
+uint32_t BootControlBitsCleared(uint32_t page);
+bool BootControlClearBit(uint32_t page, uint32_t bit);
+uint32_t BootControlSwapSteps(const BootRequest_t *request);
+void BootControlSwap(const BootRequest_t *request, uint32_t progressPage, uint32_t firstBit);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Runs with the interrupts disabled and the other core parked (flash_safe_execute) */
+void BootControlFlashOperation(void *param)
+{
+	const BootFlashOperation_t *operation = param;
+
+	if(operation->data == NULL)
+	{
+		flash_range_erase(operation->offset, FLASH_SECTOR_SIZE);
+	}
+	else
+	{
+		flash_range_program(operation->offset, operation->data, operation->length);
+	}
+}
+
+bool BootControlCopySector(uint32_t destination, uint32_t source)
+{
+	bool ok = BootControl_Erase(destination);
+
+	for(uint32_t page = 0; ok && (page < FLASH_SECTOR_SIZE); page += FLASH_PAGE_SIZE)
+	{
+		memcpy(BootPageBuffer, BOOT_FLASH_PTR(source + page), FLASH_PAGE_SIZE);
+
+		/* The erased pages past the end of an image stay as they are */
+		bool erased = true;
+		for(uint32_t i = 0; erased && (i < FLASH_PAGE_SIZE); i++) erased = (BootPageBuffer[i] == 0xFFU);
+		if(!erased)
+		{
+			ok = BootControl_Program(destination + page, BootPageBuffer, FLASH_PAGE_SIZE);
+		}
+	}
+	return ok;
+}
+
+/* The bits of a progress page are cleared in order - the number of steps done is the position of the first bit still set */
+uint32_t BootControlBitsCleared(uint32_t page)
+{
+	const uint8_t *bitmap = BOOT_FLASH_PTR(BOOT_CONTROL_PAGE_OFFSET(page));
+	uint32_t count = 0;
+
+	for(uint32_t i = 0; i < FLASH_PAGE_SIZE; i++)
+	{
+		uint8_t bits = bitmap[i];
+		if(bits == 0U)
+		{
+			count += 8U;
+			continue;
+		}
+		while((bits & 1U) == 0U)
+		{
+			count++;
+			bits >>= 1;
+		}
+		break;
+	}
+	return count;
+}
+
+bool BootControlClearBit(uint32_t page, uint32_t bit)
+{
+	/* Programming only clears bits - the bits cleared before stay cleared */
+	memset(BootPageBuffer, 0xFF, FLASH_PAGE_SIZE);
+	BootPageBuffer[bit / 8U] = (uint8_t)~(1U << (bit % 8U));
+	return BootControl_Program(BOOT_CONTROL_PAGE_OFFSET(page), BootPageBuffer, FLASH_PAGE_SIZE);
+}
+
+uint32_t BootControlSwapSteps(const BootRequest_t *request)
+{
+	uint32_t steps = 0;
+
+	for(uint32_t sector = 0; sector < request->sectors; sector++)
+	{
+		if(BootControl_SectorChanged(request, sector)) steps += BOOT_SWAP_STEPS_PER_SECTOR;
+	}
+	return steps;
+}
+
+/* Swaps the changed sectors of slot A and slot B - the same swap again undoes it (roll-back) */
+void BootControlSwap(const BootRequest_t *request, uint32_t progressPage, uint32_t firstBit)
+{
+	uint32_t done = BootControlBitsCleared(progressPage) - firstBit;
+	uint32_t step = 0;
+
+	for(uint32_t sector = 0; sector < request->sectors; sector++)
+	{
+		if(!BootControl_SectorChanged(request, sector))
+		{
+			continue;
+		}
+
+		uint32_t slotA = BOOT_SLOT_A_OFFSET + (sector * FLASH_SECTOR_SIZE);
+		uint32_t slotB = BOOT_SLOT_B_OFFSET + (sector * FLASH_SECTOR_SIZE);
+		for(uint32_t sectorStep = 0; sectorStep < BOOT_SWAP_STEPS_PER_SECTOR; sectorStep++, step++)
+		{
+			if(step < done)
+			{
+				continue;
+			}
+
+			bool ok;
+			switch(sectorStep)
+			{
+				case 0:  ok = BootControlCopySector(BOOT_SCRATCH_OFFSET, slotA); break;
+				case 1:  ok = BootControlCopySector(slotA, slotB); break;
+				default: ok = BootControlCopySector(slotB, BOOT_SCRATCH_OFFSET); break;
+			}
+			if(!ok || !BootControlClearBit(progressPage, firstBit + step))
+			{
+				return;
+			}
+		}
+	}
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* One flash operation - also used by the field trace (Trace.c) for its own area */
+bool BootControl_Erase(uint32_t offset)
+{
+	BootFlashOperation_t operation = { offset, NULL, 0U };
+	return flash_safe_execute(BootControlFlashOperation, &operation, BOOT_FLASH_SAFE_TIMEOUT_IN_MS) == PICO_OK;
+}
+
+bool BootControl_Program(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+	BootFlashOperation_t operation = { offset, data, length };
+	return flash_safe_execute(BootControlFlashOperation, &operation, BOOT_FLASH_SAFE_TIMEOUT_IN_MS) == PICO_OK;
+}
+
+const BootRequest_t* BootControl_Request(void)
+{
+	const BootRequest_t *request = (const BootRequest_t *)BOOT_FLASH_PTR(BOOT_CONTROL_PAGE_OFFSET(BOOT_CONTROL_PAGE_REQUEST));
+
+	if((request->magic != BOOT_REQUEST_MAGIC) || (request->sectors > BOOT_SLOT_SECTORS) ||
+	   (request->crc != Hash_Crc32(request, offsetof(BootRequest_t, crc))))
+	{
+		return NULL;
+	}
+	return request;
+}
+
+BootState_t BootControl_GetState(void)
+{
+	const BootRequest_t *request = BootControl_Request();
+	if(request == NULL)
+	{
+		return BOOT_STATE_NONE;
+	}
+
+	uint32_t steps = BootControlSwapSteps(request);
+	if(BootControlBitsCleared(BOOT_CONTROL_PAGE_SWAP) < steps)
+	{
+		return BOOT_STATE_SWAPPING;
+	}
+
+	uint32_t reverted = BootControlBitsCleared(BOOT_CONTROL_PAGE_REVERT);
+	if(reverted > BOOT_REVERT_STARTED_BIT)
+	{
+		return (reverted >= (steps + 1U)) ? BOOT_STATE_REVERTED : BOOT_STATE_REVERTING;
+	}
+
+	const uint32_t *confirm = (const uint32_t *)BOOT_FLASH_PTR(BOOT_CONTROL_PAGE_OFFSET(BOOT_CONTROL_PAGE_CONFIRM));
+	return (*confirm == BOOT_CONFIRM_MAGIC) ? BOOT_STATE_CONFIRMED : BOOT_STATE_TESTING;
+}
+
+uint32_t BootControl_Attempts(void)
+{
+	return BootControlBitsCleared(BOOT_CONTROL_PAGE_ATTEMPTS);
+}
+
+bool BootControl_SectorChanged(const BootRequest_t *request, uint32_t sector)
+{
+	return (request->changedSectors[sector / 8U] >> (sector % 8U)) & 1U;
+}
+
+/* The new image as it will be in slot A after the swap */
+void BootControl_HashStagedImage(const BootRequest_t *request, uint8_t hash[HASH_SHA256_SIZE])
+{
+	HashSha256_t context;
+
+	Hash_Sha256Init(&context);
+	for(uint32_t sector = 0; sector < request->sectors; sector++)
+	{
+		uint32_t offset = sector * FLASH_SECTOR_SIZE;
+		uint32_t length = ((request->imageSize - offset) < FLASH_SECTOR_SIZE) ? (request->imageSize - offset) : FLASH_SECTOR_SIZE;
+		uint32_t slot = BootControl_SectorChanged(request, sector) ? BOOT_SLOT_B_OFFSET : BOOT_SLOT_A_OFFSET;
+		Hash_Sha256Update(&context, BOOT_FLASH_PTR(slot + offset), length);
+	}
+	Hash_Sha256Final(&context, hash);
+}
+
+uint32_t BootControl_RunningImageSize(void)
+{
+	return (uint32_t)((uintptr_t)&__flash_binary_end - (XIP_BASE + BOOT_SLOT_A_OFFSET));
+}
+
+void BootControl_HashRunningImage(uint8_t hash[HASH_SHA256_SIZE])
+{
+	HashSha256_t context;
+
+	Hash_Sha256Init(&context);
+	Hash_Sha256Update(&context, BOOT_FLASH_PTR(BOOT_SLOT_A_OFFSET), BootControl_RunningImageSize());
+	Hash_Sha256Final(&context, hash);
+}
+
+/* One sector of the download slot - data has to be in RAM */
+bool BootControl_WriteSector(uint32_t offset, const uint8_t *data)
+{
+	return BootControl_Erase(offset) && BootControl_Program(offset, data, FLASH_SECTOR_SIZE);
+}
+
+/* Commit point of an update - the stub swaps the staged image in at the next boot */
+bool BootControl_WriteRequest(const BootRequest_t *request)
+{
+	memset(BootPageBuffer, 0xFF, FLASH_PAGE_SIZE);
+	memcpy(BootPageBuffer, request, sizeof(*request));
+	return BootControl_Erase(BOOT_CONTROL_OFFSET) && BootControl_Program(BOOT_CONTROL_PAGE_OFFSET(BOOT_CONTROL_PAGE_REQUEST), BootPageBuffer, FLASH_PAGE_SIZE);
+}
+
+bool BootControl_Confirm(void)
+{
+	if(BootControl_GetState() != BOOT_STATE_TESTING)
+	{
+		return false;
+	}
+
+	const uint32_t magic = BOOT_CONFIRM_MAGIC;
+	memset(BootPageBuffer, 0xFF, FLASH_PAGE_SIZE);
+	memcpy(BootPageBuffer, &magic, sizeof(magic));
+	return BootControl_Program(BOOT_CONTROL_PAGE_OFFSET(BOOT_CONTROL_PAGE_CONFIRM), BootPageBuffer, FLASH_PAGE_SIZE);
+}
+
+void BootControl_Service(void)
+{
+	const BootRequest_t *request = BootControl_Request();
+	BootState_t state = BootControl_GetState();
+
+	if(state == BOOT_STATE_SWAPPING)
+	{
+		/* Nothing swapped yet - last check of the staged image, a request that does not match it is dropped */
+		if(BootControlBitsCleared(BOOT_CONTROL_PAGE_SWAP) == 0U)
+		{
+			uint8_t hash[HASH_SHA256_SIZE];
+			BootControl_HashStagedImage(request, hash);
+			if(memcmp(hash, request->hash, HASH_SHA256_SIZE) != 0)
+			{
+				memset(BootPageBuffer, 0xFF, FLASH_PAGE_SIZE);
+				memset(BootPageBuffer, 0x00, sizeof(request->magic));
+				(void)BootControl_Program(BOOT_CONTROL_PAGE_OFFSET(BOOT_CONTROL_PAGE_REQUEST), BootPageBuffer, FLASH_PAGE_SIZE);
+				return;
+			}
+		}
+
+		BootControlSwap(request, BOOT_CONTROL_PAGE_SWAP, 0U);
+		state = BootControl_GetState();
+	}
+
+	/* Every boot of the new image until it confirms itself takes one attempt */
+	if((state == BOOT_STATE_TESTING) && (BootControl_Attempts() < BOOT_MAX_ATTEMPTS))
+	{
+		(void)BootControlClearBit(BOOT_CONTROL_PAGE_ATTEMPTS, BootControl_Attempts());
+		return;
+	}
+
+	if((state == BOOT_STATE_TESTING) || (state == BOOT_STATE_REVERTING))
+	{
+		if(state == BOOT_STATE_TESTING)
+		{
+			(void)BootControlClearBit(BOOT_CONTROL_PAGE_REVERT, BOOT_REVERT_STARTED_BIT);
+		}
+		BootControlSwap(request, BOOT_CONTROL_PAGE_REVERT, BOOT_REVERT_STARTED_BIT + 1U);
+	}
+}
@@ -4,6 +4,7 @@
 
 /* Standard includes. */
 #include <stdio.h>
+#include <stdint.h>
 
 /* Kernel includes. */
 #include "FreeRTOS.h"
@@ -15,11 +16,20 @@
 #include "pico/binary_info.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
 
 /* Include files from other tasks */
 #include "ButtonTask.h"
+#include "Channels.h"
+#include "CycleCounter.h"
 #include "ElectronicBlinds_Main.h"
 #include "MotorControllerTask.h"
+#include "Watchdog.h"
+#include "Trace.h"
+#include "Debounce.h"
+#include "TimerService.h"
+#include "Encoder.h"
 
 /* Includes from the DS1307 library */
 #include "DS1307.h"
@@ -27,267 +37,513 @@
 
 /*---------------- LOCAL DATA TYPES ----------------------*/
 
-typedef enum gpio_irq_level gpioLevelType;
-typedef struct
+typedef enum
 {
-	uint32_t gpio;
-	uint32_t edge;
-	bool pending;
-}ButtonInfo_t;
+	TIMER_UPDOWNBUTTONS,
+	TIMER_LIMITSWITCHES,
+	TIMER_NUM_OF_TIMERS
+}TimerNum_t;
 
-typedef struct
+typedef enum
 {
-	gpioLevelType ButtonDown;
-	gpioLevelType ButtonUp;
-	gpioLevelType TopLimitSwitch;
-	gpioLevelType BottomLimitSwitch;
-}ExpectedEdge_t;
+	BACKOFF_IDLE,			/* No limit switch event in progress (or the press is being debounced) */
+	BACKOFF_WAIT_RELEASE,	/* Motor is reversing, waiting for the falling edge of the limit switch */
+	BACKOFF_EXTRA_TRAVEL	/* Limit switch released, motor keeps reversing for the configured extra travel */
+}BackoffPhase_t;
 
-typedef enum
+/* State of the inputs of all the channels - structure of arrays, indexed by the channel */
+typedef struct
 {
-	TIMER_UPDOWNBUTTONS,
-	TIMER_LIMITSWITCHES
-}TimerNum_t;
+	volatile uint8_t upDownPending[BLINDS_NUM_OF_CHANNELS];		/* Up/Down button event to be handled by the task */
+	uint8_t upDownGpio[BLINDS_NUM_OF_CHANNELS];					/* Up/Down button being debounced/held */
+	uint8_t upDownEdge[BLINDS_NUM_OF_CHANNELS];
+	uint8_t limitGpio[BLINDS_NUM_OF_CHANNELS];					/* Limit switch being debounced/backed off */
+	uint8_t backoffPhase[BLINDS_NUM_OF_CHANNELS];				/* BackoffPhase_t */
+	uint32_t limitPressTime_us[BLINDS_NUM_OF_CHANNELS];
+	uint32_t limitReleaseTime_us[BLINDS_NUM_OF_CHANNELS];
+	uint32_t backoffStartTime_us[BLINDS_NUM_OF_CHANNELS];
+	uint32_t settling[TIMER_NUM_OF_TIMERS];										/* one bit per channel - its press is still bouncing */
+	uint32_t settleStart_us[TIMER_NUM_OF_TIMERS][BLINDS_NUM_OF_CHANNELS];		/* first edge of the press */
+	uint32_t settleEdge_us[TIMER_NUM_OF_TIMERS][BLINDS_NUM_OF_CHANNELS];		/* last edge of its bounce so far */
+	uint8_t settleEdges[TIMER_NUM_OF_TIMERS][BLINDS_NUM_OF_CHANNELS];
+}ChannelInputs_t;
 
 /*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
 
-bool TopLimitReached, BottomLimitReached;
-MotorState_t MotorState_Requested = STATE_OFF;
+volatile uint32_t TopLimitReached, BottomLimitReached;
 SemaphoreHandle_t ButtonSemaphore;
-ButtonInfo_t UpDown_ButtonInfo, Limitter_ButtonInfo;
-ExpectedEdge_t ExpctdEdges;
-uint32_t Hysteresis;
+ChannelInputs_t Inputs;
+TimerService_Timer_t ChannelTimers[TIMER_NUM_OF_TIMERS][BLINDS_NUM_OF_CHANNELS];	/* every channel has its own deadline of each kind */
+volatile uint32_t LimitSwitchBackoffActive;
+LimitSwitchStats_t TopLimitStats[BLINDS_NUM_OF_CHANNELS], BottomLimitStats[BLINDS_NUM_OF_CHANNELS];
+io_irq_ctrl_hw_t *InputsIrqCtrl; /* Interrupt control registers of the core which handles the GPIO interrupts */
 
 /*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
 
+void InterruptsInit(void);
+void GpioInterruptHandler(void);
 void ButtonsInterruptCallback(uint gpio, uint32_t events);
-void TimerInit(uint32_t delay_us, TimerNum_t timerNum);
-void TimerHandler_UpDownButtons(void);
-void TimerHandler_LimitSwitches(void);
-void RecoveryMode(uint32_t button);
-void DisableAllInterrupts(void);
-void EnableAllInterrupts(void);
+void GpioIrqEnable(uint32_t gpio, uint32_t events);
+void GpioIrqDisable(uint32_t gpio, uint32_t events);
+void EnableUpDownInterrupts(uint32_t channel);
+void DisableUpDownInterrupts(uint32_t channel);
+void EnableChannelInterrupts(uint32_t channel);
+void DisableChannelInterrupts(uint32_t channel);
+void ChannelTimerStart(TimerNum_t timerNum, uint32_t channel, uint32_t delay_us);
+void SettleStart(TimerNum_t timerNum, uint32_t channel, uint32_t gpio);
+void SettleEdge(TimerNum_t timerNum, uint32_t channel, uint32_t gpio);
+void SettleEnd(TimerNum_t timerNum, uint32_t channel, uint32_t gpio, bool pressed);
+void TimerHandler_UpDownButtons(TimerService_Timer_t *timer, void *context);
+void TimerHandler_LimitSwitches(TimerService_Timer_t *timer, void *context);
+void UpDownDebounceElapsed(uint32_t channel, uint32_t inputs);
+void LimitTimerElapsed(uint32_t channel, uint32_t inputs);
+void RecoveryMode(uint32_t channel, uint32_t button);
+void StartLimitSwitchBackoff(uint32_t channel, uint32_t button);
+void LimitSwitchReleased(uint32_t channel);
+void FinishLimitSwitchBackoff(uint32_t channel);
 
 /*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
 
-void DisableAllInterrupts(void)
+void InterruptsInit(void)
 {
-	/* In Raspberry Pi Pico, only one callback function can be used for GPIO interrupts, even if multiple pins are used. 
-	This is because the interrupts are handled at the hardware level and there is only one interrupt handler for all the GPIO pins.*/
-	gpio_set_irq_enabled_with_callback(BUTTON_TOP_LIMIT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false, &ButtonsInterruptCallback);
-	gpio_set_irq_enabled(BUTTON_BOTTOM_LIMIT, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
-	gpio_set_irq_enabled(BUTTON_DOWN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
-	gpio_set_irq_enabled(BUTTON_UP, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);	
+	/* All the handlers are registered once here - afterwards the interrupts are only masked/unmasked at the register level,
+	   which takes a single store instead of going through the SDK (handler table lookups, per-pin loops) in every ISR */
+
+	/* The GPIO interrupt is taken by the core which enables it in its NVIC - remember which core's INTE/INTS to use,
+	   the tasks (and so the interrupt masking) may run on any core */
+	InputsIrqCtrl = (get_core_num() == 0U) ? &iobank0_hw->proc0_irq_ctrl : &iobank0_hw->proc1_irq_ctrl;
+	for(uint32_t reg = 0; reg < GPIO_IRQ_NUM_OF_REGS; reg++)
+	{
+		hw_clear_bits(&InputsIrqCtrl->inte[reg], ChannelLookup.upDownIrqBits[reg] | ChannelLookup.limitIrqBits[reg]);
+	}
+
+	/* In Raspberry Pi Pico, there is only one interrupt handler for all the GPIO pins - use our own instead of
+	   the SDK's callback dispatcher, it only has to look at the registers the inputs are in */
+	irq_set_exclusive_handler(IO_IRQ_BANK0, GpioInterruptHandler);
+	irq_set_enabled(IO_IRQ_BANK0, true);
+
+	/* The debounce and back-off deadlines of every channel go through the timer service (TimerService.h) - its alarm interrupt
+	   calls the handler of the channel whose deadline is due */
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		TimerService_Setup(&ChannelTimers[TIMER_UPDOWNBUTTONS][channel], TimerHandler_UpDownButtons, (void *)(uintptr_t)channel);
+		TimerService_Setup(&ChannelTimers[TIMER_LIMITSWITCHES][channel], TimerHandler_LimitSwitches, (void *)(uintptr_t)channel);
+	}
 }
 
-void EnableAllInterrupts(void)
+void HOT_PATH_FUNC(GpioIrqEnable)(uint32_t gpio, uint32_t events)
 {
-	/* In Raspberry Pi Pico, only one callback function can be used for GPIO interrupts, even if multiple pins are used. 
-	This is because the interrupts are handled at the hardware level and there is only one interrupt handler for all the GPIO pins.*/
-	gpio_set_irq_enabled_with_callback(BUTTON_TOP_LIMIT, ExpctdEdges.TopLimitSwitch, true, &ButtonsInterruptCallback);
-	gpio_set_irq_enabled(BUTTON_BOTTOM_LIMIT, ExpctdEdges.BottomLimitSwitch, true);
-	gpio_set_irq_enabled(BUTTON_DOWN, ExpctdEdges.ButtonDown, true);
-	gpio_set_irq_enabled(BUTTON_UP, ExpctdEdges.ButtonUp, true);
+	uint32_t irqBits = GPIO_IRQ_BITS(gpio, events);
+	/* Acknowledge the edges latched while the interrupt was masked (INTR is write-1-to-clear), otherwise they would fire right away */
+	iobank0_hw->intr[GPIO_IRQ_REG(gpio)] = irqBits;
+	hw_set_bits(&InputsIrqCtrl->inte[GPIO_IRQ_REG(gpio)], irqBits);
 }
 
-void RecoveryMode(uint32_t button)
+void HOT_PATH_FUNC(GpioIrqDisable)(uint32_t gpio, uint32_t events)
 {
-	/* Disable all interrupts until system is recovered (limit switches not pressed) */ 
-	DisableAllInterrupts();
+	hw_clear_bits(&InputsIrqCtrl->inte[GPIO_IRQ_REG(gpio)], GPIO_IRQ_BITS(gpio, events));
+}
 
-	/* Limit Switch has been cleared - back to normal operation */
-	if(button == BUTTON_TOP_LIMIT)
+void HOT_PATH_FUNC(EnableUpDownInterrupts)(uint32_t channel)
+{
+	GpioIrqEnable(ChannelLookup.inputGpio[CHANNEL_INPUT_DOWN][channel], GPIO_IRQ_EDGE_RISE);
+	GpioIrqEnable(ChannelLookup.inputGpio[CHANNEL_INPUT_UP][channel], GPIO_IRQ_EDGE_RISE);
+}
+
+void HOT_PATH_FUNC(DisableUpDownInterrupts)(uint32_t channel)
+{
+	GpioIrqDisable(ChannelLookup.inputGpio[CHANNEL_INPUT_DOWN][channel], GPIO_IRQ_BOTH_EDGES);
+	GpioIrqDisable(ChannelLookup.inputGpio[CHANNEL_INPUT_UP][channel], GPIO_IRQ_BOTH_EDGES);
+}
+
+void HOT_PATH_FUNC(EnableChannelInterrupts)(uint32_t channel)
+{
+	/* Expect all the buttons/switches of the channel to be released - only their rising edges stay enabled,
+	   everything else of the channel is masked in the same write (one per interrupt register) */
+	for(uint32_t reg = 0; reg < GPIO_IRQ_NUM_OF_REGS; reg++)
 	{
-		while(gpio_get(BUTTON_TOP_LIMIT)) // as long as limit is hit - back up
+		uint32_t channelBits = ChannelLookup.channelIrqBits[reg][channel];
+		if(channelBits != 0U)
 		{
-			stateClockwise();
+			uint32_t irqBits = channelBits & GPIO_IRQ_ALL_GPIOS(GPIO_IRQ_EDGE_RISE);
+			iobank0_hw->intr[reg] = irqBits;
+			hw_write_masked(&InputsIrqCtrl->inte[reg], irqBits, channelBits);
 		}
-		ExpctdEdges.TopLimitSwitch = GPIO_IRQ_EDGE_RISE;
+	}
+}
+
+void HOT_PATH_FUNC(DisableChannelInterrupts)(uint32_t channel)
+{
+	for(uint32_t reg = 0; reg < GPIO_IRQ_NUM_OF_REGS; reg++)
+	{
+		if(ChannelLookup.channelIrqBits[reg][channel] != 0U)
+		{
+			hw_clear_bits(&InputsIrqCtrl->inte[reg], ChannelLookup.channelIrqBits[reg][channel]);
+		}
+	}
+}
+
+void RecoveryMode(uint32_t channel, uint32_t button)
+{
+	/* Disable all interrupts of the channel until it is recovered (limit switches not pressed) */
+	DisableChannelInterrupts(channel);
+
+	/* Back up with the same closed-loop back-off as during normal operation - it stops the motor
+	   and re-enables the interrupts by itself once the Limit Switch has been cleared */
+	uint32_t irqStatus = save_and_disable_interrupts();
+	Inputs.limitPressTime_us[channel] = timer_hw->timerawl;
+	StartLimitSwitchBackoff(channel, button);
+	restore_interrupts(irqStatus);
+}
+
+void HOT_PATH_FUNC(StartLimitSwitchBackoff)(uint32_t channel, uint32_t button)
+{
+	Inputs.limitGpio[channel] = (uint8_t)button;
+	LimitSwitchBackoffActive |= CHANNEL_BIT(channel);
+	Inputs.backoffPhase[channel] = BACKOFF_WAIT_RELEASE;
+	Inputs.backoffStartTime_us[channel] = timer_hw->timerawl;
+	/* Reverse right away from the interrupt context - the safety command takes the channel over from the button or the
+	   automatic move (a start of theirs still waiting for the stagger must not drive the blinds back into the switch) */
+	if(ChannelLookup.input[button] == CHANNEL_INPUT_TOP_LIMIT)
+	{
+		TopLimitReached |= CHANNEL_BIT(channel);
+		(void)MotorCommand_Submit(channel, STATE_CLOCKWISE, MOTOR_PRIORITY_SAFETY, 0U);
 	}
 	else
 	{
-		while(gpio_get(BUTTON_BOTTOM_LIMIT)) // as long as limit is hit - back up
+		BottomLimitReached |= CHANNEL_BIT(channel);
+		(void)MotorCommand_Submit(channel, STATE_ANTICLOCKWISE, MOTOR_PRIORITY_SAFETY, 0U);
+	}
+#if (ENCODER_ENABLED == 1)
+	/* The switches are the ends of the travel the encoder counts - top is position 0, bottom 1 */
+	Encoder_LimitReached(channel, ChannelLookup.input[button] == CHANNEL_INPUT_TOP_LIMIT);
+#endif
+
+	/* Safety net in case the switch never releases (e.g. the blinds are jammed) */
+	ChannelTimerStart(TIMER_LIMITSWITCHES, channel, LIMIT_SWITCH_BACKOFF_TIMEOUT_IN_US);
+
+	/* Let the hardware tell us when the switch is released */
+	GpioIrqEnable(button, GPIO_IRQ_EDGE_FALL);
+
+	/* Enabling the interrupt discards the edges latched before - if the switch is already released handle it now */
+	if(!Trace_GpioGet(button))
+	{
+		LimitSwitchReleased(channel);
+	}
+}
+
+void HOT_PATH_FUNC(LimitSwitchReleased)(uint32_t channel)
+{
+	if(Inputs.backoffPhase[channel] == BACKOFF_WAIT_RELEASE)
+	{
+		Inputs.limitReleaseTime_us[channel] = timer_hw->timerawl;
+		GpioIrqDisable(Inputs.limitGpio[channel], GPIO_IRQ_BOTH_EDGES);
+
+		/* Keep reversing for a short, precisely timed distance so the switch is reliably cleared */
+		Inputs.backoffPhase[channel] = BACKOFF_EXTRA_TRAVEL;
+		if(ChannelLookup.input[Inputs.limitGpio[channel]] == CHANNEL_INPUT_TOP_LIMIT)
 		{
-			stateAnticlockwise();
+			ChannelTimerStart(TIMER_LIMITSWITCHES, channel, LIMIT_SWITCH_BACKOFF_TOP_IN_US);
+		}
+		else
+		{
+			ChannelTimerStart(TIMER_LIMITSWITCHES, channel, LIMIT_SWITCH_BACKOFF_BOTTOM_IN_US);
 		}
-		ExpctdEdges.BottomLimitSwitch = GPIO_IRQ_EDGE_RISE;
 	}
-	/* Limit Switches should be clear now, stop the motor */
-    stateOFF();
 }
 
-void TimerInit(uint32_t delay_us, TimerNum_t timerNum)
+void HOT_PATH_FUNC(FinishLimitSwitchBackoff)(uint32_t channel)
 {
-	/* Enabling interrupts in the timer hardware ensures that the timer will 
-		generate an interrupt signal when it reaches a certain condition (e.g., when the specified delay is reached) */
-    hw_set_bits(&timer_hw->inte, 1u << timerNum);
+	/* Back-off concluded - stop the motor and give the channel back */
+	MotorCommand_Release(channel, MOTOR_PRIORITY_SAFETY);
+
+	bool topLimit = (ChannelLookup.input[Inputs.limitGpio[channel]] == CHANNEL_INPUT_TOP_LIMIT);
+	LimitSwitchStats_t *stats = topLimit ? &TopLimitStats[channel] : &BottomLimitStats[channel];
+	uint32_t overshoot_us = Inputs.limitReleaseTime_us[channel] - Inputs.limitPressTime_us[channel];
+	uint32_t backoff_us = timer_hw->timerawl - Inputs.backoffStartTime_us[channel];
+
+	stats->count++;
+	stats->lastOvershoot_us = overshoot_us;
+	stats->sumOvershoot_us += overshoot_us;
+	if((stats->count == 1) || (overshoot_us < stats->minOvershoot_us)) stats->minOvershoot_us = overshoot_us;
+	if(overshoot_us > stats->maxOvershoot_us) stats->maxOvershoot_us = overshoot_us;
+	stats->lastBackoff_us = backoff_us;
+	if(backoff_us > stats->maxBackoff_us) stats->maxBackoff_us = backoff_us;
+
+	if(topLimit) TopLimitReached &= ~CHANNEL_BIT(channel);
+	else BottomLimitReached &= ~CHANNEL_BIT(channel);
+	Inputs.backoffPhase[channel] = BACKOFF_IDLE;
+	LimitSwitchBackoffActive &= ~CHANNEL_BIT(channel);
+
+	/* Re-enable the interrupts - assume all buttons/switches of the channel are released*/
+	EnableChannelInterrupts(channel);
+}
+
+void HOT_PATH_FUNC(ChannelTimerStart)(TimerNum_t timerNum, uint32_t channel, uint32_t delay_us)
+{
+	/* Replaces the deadline of the channel if it is still armed */
+	TimerService_Start(&ChannelTimers[timerNum][channel], delay_us);
+}
 
-	if(timerNum == TIMER_UPDOWNBUTTONS)
+void HOT_PATH_FUNC(SettleStart)(TimerNum_t timerNum, uint32_t channel, uint32_t gpio)
+{
+	uint32_t now = timer_hw->timerawl;
+	Inputs.settleStart_us[timerNum][channel] = now;
+	Inputs.settleEdge_us[timerNum][channel] = now;
+	Inputs.settleEdges[timerNum][channel] = 0U;
+	Inputs.settling[timerNum] |= CHANNEL_BIT(channel);
+
+	/* Every edge of the input restarts its settle window (Debounce.c) - the other inputs stay masked */
+	GpioIrqEnable(gpio, GPIO_IRQ_BOTH_EDGES);
+	ChannelTimerStart(timerNum, channel, Debounce_Settle(channel, ChannelLookup.input[gpio]));
+}
+
+void HOT_PATH_FUNC(SettleEdge)(TimerNum_t timerNum, uint32_t channel, uint32_t gpio)
+{
+	uint32_t input = ChannelLookup.input[gpio];
+	uint32_t now = timer_hw->timerawl;
+	uint32_t elapsed_us = now - Inputs.settleStart_us[timerNum][channel];
+	uint32_t settle_us = Debounce_Settle(channel, input);
+	uint32_t max_us = Debounce_Max(input);
+
+	Inputs.settleEdge_us[timerNum][channel] = now;
+	/* Quiet for the settle window from this edge on - but sampled no later than the fixed delay after the first edge,
+	   a contact that keeps chattering (or noise) is judged by its level then, as with the fixed delay alone */
+	if((elapsed_us + settle_us) > max_us)
 	{
-		/* Set up interrupt handler for the selected timer */
-    	irq_set_exclusive_handler(TIMER_IRQ_0, TimerHandler_UpDownButtons);
-		/* Enabling interrupt handling by the Interrupt Controller allows the software to catch and process those interrupts 
-		when they occur on the specified IRQ lines. This enables the software to respond to timer events or any other 
-		hardware events that trigger interrupts */
-		irq_set_enabled(TIMER_IRQ_0, true);
+		settle_us = (elapsed_us < max_us) ? (max_us - elapsed_us) : 0U;
 	}
-	else if(timerNum == TIMER_LIMITSWITCHES)
+	/* Too many edges - masked again for the rest of the fixed delay, so a chattering input can't flood the interrupt */
+	if(++Inputs.settleEdges[timerNum][channel] >= DEBOUNCE_MAX_EDGES)
 	{
-    	irq_set_exclusive_handler(TIMER_IRQ_1, TimerHandler_LimitSwitches);
-		irq_set_enabled(TIMER_IRQ_1, true);
+		GpioIrqDisable(gpio, GPIO_IRQ_BOTH_EDGES);
+		Inputs.settleEdge_us[timerNum][channel] = Inputs.settleStart_us[timerNum][channel] + max_us;
+		settle_us = (elapsed_us < max_us) ? (max_us - elapsed_us) : 0U;
 	}
-	else
+	ChannelTimerStart(timerNum, channel, settle_us);
+}
+
+void HOT_PATH_FUNC(SettleEnd)(TimerNum_t timerNum, uint32_t channel, uint32_t gpio, bool pressed)
+{
+	if((Inputs.settling[timerNum] & CHANNEL_BIT(channel)) == 0U)
 	{
-		/* Unhandled timer, do nothing */
-		LOG("Wrong timerNum - no handler function defined! \n");
+		return;
 	}
+	Inputs.settling[timerNum] &= ~CHANNEL_BIT(channel);
+	GpioIrqDisable(gpio, GPIO_IRQ_BOTH_EDGES);
 
-	/* Calculate the alarm time by adding the provided delay to the current time
-		THIS ASSUMES THE TIMER IS INCREMENTING BY 1 EACH MICROSECOND - TO BE VERIFIED WITH DOCUMENTATION */
-    uint64_t alarmTargetTime = timer_hw->timerawl + delay_us;
-	/* Everything is configured - now just set the alarm to the calculated target 
-		time and an interrupt will happen when it is reached */
-    timer_hw->alarm[timerNum] = (uint32_t)alarmTargetTime;
+	/* Only the stable presses are learned from - the bounce of noise says nothing about the contact */
+	if(pressed)
+	{
+		Debounce_Record(channel, ChannelLookup.input[gpio], Inputs.settleEdge_us[timerNum][channel] - Inputs.settleStart_us[timerNum][channel]);
+	}
 }
 
-void TimerHandler_UpDownButtons(void) 
+void HOT_PATH_FUNC(TimerHandler_UpDownButtons)(TimerService_Timer_t *timer, void *context)
 {
-	/* Clear interrupt in the timer hardware */
-    hw_clear_bits(&timer_hw->intr, 1u << TIMER_UPDOWNBUTTONS);
+	uint32_t startCycles = CycleCounter_Start();
+	XipSample_t startXip = CycleCounter_XipStart();
+
+	(void)timer;
+	UpDownDebounceElapsed((uint32_t)(uintptr_t)context, Trace_GpioGetAll());
+
+	CycleCounter_Stop(CYCLES_ISR_TIMER_UPDOWNBUTTONS, startCycles);
+	CycleCounter_XipStop(CYCLES_ISR_TIMER_UPDOWNBUTTONS, startXip);
+}
 
+void HOT_PATH_FUNC(UpDownDebounceElapsed)(uint32_t channel, uint32_t inputs)
+{
 	/* If the button is still high/low after debouncing delay, count it, otherwise it's treated as noise and ignored */
-	bool GPIO_State = gpio_get(UpDown_ButtonInfo.gpio);
-	if((GPIO_State) && (!TopLimitReached) && (!BottomLimitReached)) /* if top/bottom limit reached, do NOT react to button presses */
+	bool GPIO_State = (inputs >> Inputs.upDownGpio[channel]) & 1u;
+	SettleEnd(TIMER_UPDOWNBUTTONS, channel, Inputs.upDownGpio[channel], GPIO_State);
+	if((GPIO_State) && (((TopLimitReached | BottomLimitReached) & CHANNEL_BIT(channel)) == 0U)) /* if top/bottom limit reached, do NOT react to button presses */
 	{ /* Stable button press */
 		LOG("button stable \n");
 		/* Set button state as pending to be handled */
-		UpDown_ButtonInfo.pending = true;
+		Inputs.upDownPending[channel] = true;
 		/* Set a timer for another cycle to see if the button is still pressed (this is repeated until it's released) */
-		TimerInit(DEBOUNCING_DELAY_IN_US, TIMER_UPDOWNBUTTONS);
+		ChannelTimerStart(TIMER_UPDOWNBUTTONS, channel, Debounce_Max(CHANNEL_INPUT_UP));
 	}
 	else
 	{ /* Button has been released (or it was noise) */
 		LOG("button released or noise \n");
 		/* Set button state as pending to be handled as button release */
-		UpDown_ButtonInfo.edge = GPIO_IRQ_EDGE_FALL;
-		UpDown_ButtonInfo.pending = true;
+		Inputs.upDownEdge[channel] = GPIO_IRQ_EDGE_FALL;
+		Inputs.upDownPending[channel] = true;
 
-		/* Re-enable the interrupts - button press concluded */
-		gpio_set_irq_enabled_with_callback(BUTTON_DOWN, GPIO_IRQ_EDGE_RISE, true, &ButtonsInterruptCallback);
-		gpio_set_irq_enabled(BUTTON_UP, GPIO_IRQ_EDGE_RISE, true);
+		/* Re-enable the interrupts - button press concluded. Not while the limit switch of the channel
+		   is in control, it re-enables all the inputs of the channel once it's done */
+		if(((LimitSwitchBackoffActive & CHANNEL_BIT(channel)) == 0U) && !TimerService_IsArmed(&ChannelTimers[TIMER_LIMITSWITCHES][channel]))
+		{
+			EnableUpDownInterrupts(channel);
+		}
 	}
 }
 
-void TimerHandler_LimitSwitches(void) 
+void HOT_PATH_FUNC(TimerHandler_LimitSwitches)(TimerService_Timer_t *timer, void *context)
 {
-    /* Clear interrupt in the timer hardware */
-    hw_clear_bits(&timer_hw->intr, 1u << TIMER_LIMITSWITCHES);
-	
-	/* If the button is still high/low after debouncing delay, count it, otherwise it's treated as noise and ignored */
-	bool GPIO_State = gpio_get(Limitter_ButtonInfo.gpio);
-	if(GPIO_State)
-	{ /* Stable button press */
-		LOG("button stable \n");
-		Limitter_ButtonInfo.pending = true;
-		/* Set a timer for another cycle to see if the button is still pressed (this is repeated until it's released) */
-		if(Limitter_ButtonInfo.gpio == BUTTON_TOP_LIMIT)
-		{
-			Hysteresis = 10;
-			TopLimitReached = true;
-			TimerInit(LIMIT_SWITCH_REACTION_DURATION_IN_US, TIMER_LIMITSWITCHES);
-		}
-		else
-		{
-			Hysteresis = 1;
-			BottomLimitReached = true;
-			TimerInit(LIMIT_SWITCH_REACTION_DURATION_IN_US, TIMER_LIMITSWITCHES);
-		}	
-	}
-	else
-	{ /* Button has been released (or it was noise)*/
-		if(Hysteresis > 0) /* Delay the system response to releasing the limit switches */
-		{
-			Hysteresis--;
-			if(Hysteresis == 0)
-			{
-				if(Limitter_ButtonInfo.gpio == BUTTON_TOP_LIMIT) TopLimitReached = false; else BottomLimitReached = false;
-				
-				Limitter_ButtonInfo.pending = true;
-				Limitter_ButtonInfo.edge = GPIO_IRQ_EDGE_FALL;
-				/* Re-enable the interrupts - assume all buttons/switches are released*/
-				ExpctdEdges.ButtonDown = GPIO_IRQ_EDGE_RISE;
-				ExpctdEdges.ButtonUp = GPIO_IRQ_EDGE_RISE;
-				ExpctdEdges.TopLimitSwitch = GPIO_IRQ_EDGE_RISE;
-				ExpctdEdges.BottomLimitSwitch = GPIO_IRQ_EDGE_RISE;
-				EnableAllInterrupts();
+	uint32_t startCycles = CycleCounter_Start();
+	XipSample_t startXip = CycleCounter_XipStart();
+
+	(void)timer;
+	LimitTimerElapsed((uint32_t)(uintptr_t)context, Trace_GpioGetAll());
+
+	CycleCounter_Stop(CYCLES_ISR_TIMER_LIMITSWITCHES, startCycles);
+	CycleCounter_XipStop(CYCLES_ISR_TIMER_LIMITSWITCHES, startXip);
+}
+
+void HOT_PATH_FUNC(LimitTimerElapsed)(uint32_t channel, uint32_t inputs)
+{
+	uint32_t gpio = Inputs.limitGpio[channel];
+	bool GPIO_State = (inputs >> gpio) & 1u;
+	LimitSwitchStats_t *stats = (ChannelLookup.input[gpio] == CHANNEL_INPUT_TOP_LIMIT) ? &TopLimitStats[channel] : &BottomLimitStats[channel];
+
+	switch (Inputs.backoffPhase[channel])
+	{
+		case BACKOFF_IDLE: /* End of the debouncing delay */
+			SettleEnd(TIMER_LIMITSWITCHES, channel, gpio, GPIO_State);
+			/* If the button is still high/low after debouncing delay, count it, otherwise it's treated as noise and ignored */
+			if(GPIO_State)
+			{ /* Stable button press */
+				LOG("button stable \n");
+				StartLimitSwitchBackoff(channel, gpio);
+			}
+			else
+			{ /* Noise - the motor keeps going, if the blinds are at the switch its stable press follows */
+				/* Re-enable the interrupts - assume all buttons/switches of the channel are released*/
+				EnableChannelInterrupts(channel);
+			}
+			break;
+
+		case BACKOFF_WAIT_RELEASE: /* Switch did not release in time */
+			/* Stop the motor and keep waiting for the release - user input stays disabled until the jam is cleared,
+			   the stop keeps the channel so no automatic move starts it either */
+			LOG("limit switch not released - motor stopped! \n");
+			stats->timeouts++;
+			(void)MotorCommand_Submit(channel, STATE_OFF, MOTOR_PRIORITY_SAFETY, 0U);
+			break;
+
+		case BACKOFF_EXTRA_TRAVEL: /* End of the extra travel */
+			if(GPIO_State)
+			{ /* Switch got pressed again (contact bounce on release) - keep reversing until it's released for good */
+				stats->bounces++;
+				Inputs.backoffPhase[channel] = BACKOFF_WAIT_RELEASE;
+				ChannelTimerStart(TIMER_LIMITSWITCHES, channel, LIMIT_SWITCH_BACKOFF_TIMEOUT_IN_US);
+				GpioIrqEnable(gpio, GPIO_IRQ_EDGE_FALL);
+				if(!Trace_GpioGet(gpio))
+				{
+					LimitSwitchReleased(channel);
+				}
 			}
 			else
 			{
-				Limitter_ButtonInfo.pending = true;
-				Limitter_ButtonInfo.edge = GPIO_IRQ_EDGE_RISE;
-				TimerInit(LIMIT_SWITCH_REACTION_DURATION_IN_US, TIMER_LIMITSWITCHES);
+				FinishLimitSwitchBackoff(channel);
 			}
+			break;
+
+		default: break;
+	}
+}
+
+void HOT_PATH_FUNC(GpioInterruptHandler)(void)
+{
+	uint32_t startCycles = CycleCounter_Start();
+	XipSample_t startXip = CycleCounter_XipStart();
+
+	/* Only the interrupt registers with channel inputs are read - one read per register gives the pending events
+	   of all its inputs and one write acknowledges them (the inputs only use the edge interrupts) */
+	uint32_t usedIrqRegs = ChannelLookup.usedIrqRegs;
+	while(usedIrqRegs != 0U)
+	{
+		uint32_t reg = (uint32_t)__builtin_ctz(usedIrqRegs);
+		usedIrqRegs &= usedIrqRegs - 1U;
+
+		uint32_t pending = InputsIrqCtrl->ints[reg];
+		uint32_t limitEvents = pending & ChannelLookup.limitIrqBits[reg];
+		uint32_t upDownEvents = pending & ChannelLookup.upDownIrqBits[reg];
+		if((limitEvents | upDownEvents) == 0U)
+		{
+			continue;
 		}
-		else /* Hysteresis == 0 */
+		iobank0_hw->intr[reg] = limitEvents | upDownEvents;
+
+		/* Limit switches first - they take exclusive control of their channel and mask its buttons,
+		   whose events must then not be handled anymore */
+		while((limitEvents | upDownEvents) != 0U)
 		{
-			Limitter_ButtonInfo.pending = true;
-			Limitter_ButtonInfo.edge = GPIO_IRQ_EDGE_FALL;
-			/* Re-enable the interrupts - assume all buttons/switches are released*/
-			ExpctdEdges.ButtonDown = GPIO_IRQ_EDGE_RISE;
-			ExpctdEdges.ButtonUp = GPIO_IRQ_EDGE_RISE;
-			ExpctdEdges.TopLimitSwitch = GPIO_IRQ_EDGE_RISE;
-			ExpctdEdges.BottomLimitSwitch = GPIO_IRQ_EDGE_RISE;
-			EnableAllInterrupts();
+			uint32_t *events = (limitEvents != 0U) ? &limitEvents : &upDownEvents;
+			uint32_t shift = (uint32_t)__builtin_ctz(*events) & ~3U; /* 4 event bits per GPIO */
+			uint32_t gpioEvents = (*events >> shift) & GPIO_IRQ_BOTH_EDGES;
+			*events &= ~(0xFUL << shift);
+
+			ButtonsInterruptCallback((reg * 8U) + (shift / 4U), gpioEvents);
+			upDownEvents &= InputsIrqCtrl->inte[reg];
 		}
 	}
+
+	CycleCounter_Stop(CYCLES_ISR_GPIO, startCycles);
+	CycleCounter_XipStop(CYCLES_ISR_GPIO, startXip);
 }
 
-void ButtonsInterruptCallback(uint gpio, uint32_t events)
+void HOT_PATH_FUNC(ButtonsInterruptCallback)(uint gpio, uint32_t events)
 {
+	TRACE_RECORD(TRACE_GPIO_EDGE, gpio, events);
 	LOG("GPIO: %d, EVENT: %d \n", gpio, events);
-	if((gpio == BUTTON_DOWN) || (gpio == BUTTON_UP)) /* Check if the Up/Down buttons are the cause of this interrupt */
+	uint32_t channel = ChannelLookup.channel[gpio];
+	uint32_t input = ChannelLookup.input[gpio];
+
+	if(channel == CHANNEL_NONE)
+	{
+		LOG("Button unknown - interrupts not disabled! \n");
+	}
+	else if((input == CHANNEL_INPUT_DOWN) || (input == CHANNEL_INPUT_UP)) /* Check if the Up/Down buttons are the cause of this interrupt */
 	{
-		if(events == GPIO_IRQ_EDGE_RISE) /* system design to only work which button presses (release is never detected by interrupt) */
+		if(((Inputs.settling[TIMER_UPDOWNBUTTONS] & CHANNEL_BIT(channel)) != 0U) && (gpio == Inputs.upDownGpio[channel])) /* bounce of the press */
 		{
-			/* Disable the interrupts */ 
-			gpio_set_irq_enabled_with_callback(BUTTON_DOWN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false, &ButtonsInterruptCallback);
-			gpio_set_irq_enabled(BUTTON_UP, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+			SettleEdge(TIMER_UPDOWNBUTTONS, channel, gpio);
+		}
+		else if(events == GPIO_IRQ_EDGE_RISE) /* system design to only work which button presses (release is never detected by interrupt) */
+		{
+			/* Disable the interrupts of the Up/Down buttons of this channel */
+			DisableUpDownInterrupts(channel);
 
-			UpDown_ButtonInfo.pending = false;
-			UpDown_ButtonInfo.gpio = gpio;
-			UpDown_ButtonInfo.edge = GPIO_IRQ_EDGE_RISE;
+			Inputs.upDownPending[channel] = false;
+			Inputs.upDownGpio[channel] = (uint8_t)gpio;
+			Inputs.upDownEdge[channel] = GPIO_IRQ_EDGE_RISE;
 
-			/* Set a timer for debouncing delay - during that time interrupts are disabled - no button presses detected */
-			TimerInit(DEBOUNCING_DELAY_IN_US, TIMER_UPDOWNBUTTONS);
+			/* Set a timer for the settle window of the button - during that time only its own edges are seen, no other button presses detected */
+			SettleStart(TIMER_UPDOWNBUTTONS, channel, gpio);
 		}
 		else
 		{
-			LOG("INCORRECT LIMIT SWITCH EVENT!");
+			LOG("INCORRECT BUTTON EVENT!");
 		}
-
 	}
-	else if((gpio == BUTTON_BOTTOM_LIMIT) || (gpio == BUTTON_TOP_LIMIT)) /* Check if the Limit Switches are the cause of this interrupt */
+	else /* Limit Switches are the cause of this interrupt */
 	{
-		if(events == GPIO_IRQ_EDGE_RISE) /* system design to only work which limit switch presses (release is never detected by interrupt) */
+		if(((Inputs.settling[TIMER_LIMITSWITCHES] & CHANNEL_BIT(channel)) != 0U) && (gpio == Inputs.limitGpio[channel])) /* bounce of the press */
 		{
-			/* Disable all interrupts - when limit switch is hit the system takes exclusive control, no user input counts */ 
-			DisableAllInterrupts();
+			SettleEdge(TIMER_LIMITSWITCHES, channel, gpio);
+		}
+		else if(events == GPIO_IRQ_EDGE_RISE) /* system design to only work which limit switch presses (release is only detected by interrupt during the back-off) */
+		{
+			/* Disable all interrupts of the channel - when limit switch is hit the system takes exclusive control, no user input counts */
+			DisableChannelInterrupts(channel);
 
-			Limitter_ButtonInfo.pending = false;
-			Limitter_ButtonInfo.gpio = gpio;
-			Limitter_ButtonInfo.edge = GPIO_IRQ_EDGE_RISE;
+			Inputs.limitGpio[channel] = (uint8_t)gpio;
+			Inputs.limitPressTime_us[channel] = timer_hw->timerawl;
 
-			TimerInit(DEBOUNCING_DELAY_IN_US_LIMITTER, TIMER_LIMITSWITCHES);
+			SettleStart(TIMER_LIMITSWITCHES, channel, gpio);
+		}
+		else if(((events & GPIO_IRQ_EDGE_FALL) == GPIO_IRQ_EDGE_FALL) && (gpio == Inputs.limitGpio[channel])) /* Limit switch released during the back-off */
+		{
+			LimitSwitchReleased(channel);
 		}
 		else
 		{
 			LOG("INCORRECT LIMIT SWITCH EVENT!");
 		}
 	}
-	else
-	{
-		LOG("Button unknown - interrupts not disabled! \n");
-	}
 }
 
 /*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
@@ -295,127 +551,80 @@ void ButtonsInterruptCallback(uint gpio, uint32_t events)
 /* TASK MAIN FUNCTION */
 void ButtonTask( void *pvParameters )
 {
-	/* Create a binary semaphore */
-	/* Once created, a semaphore can be used with the xSemaphoreTake and xSemaphoreGive functions to control access to the shared resource */
-	/* Only one entity at the time can request to change the state of the motor */
- 	ButtonSemaphore = xSemaphoreCreateBinary();
-
-	/* Expect the button to be de-pressed at the start, i dont care if you're pressing it when turning on the system, just release it and press again */
-	ExpctdEdges.ButtonDown = GPIO_IRQ_EDGE_RISE;
-	ExpctdEdges.ButtonUp = GPIO_IRQ_EDGE_RISE;
-	/* If the Limit Switches are detected to be pressed at the start of the system - immedietaly react and roll the blinds to the working range */
-	buttonTopLimit_InitState ? (RecoveryMode(BUTTON_TOP_LIMIT)) : (ExpctdEdges.TopLimitSwitch = GPIO_IRQ_EDGE_RISE);
-	buttonBottomLimit_InitState ? (RecoveryMode(BUTTON_BOTTOM_LIMIT)) : (ExpctdEdges.BottomLimitSwitch = GPIO_IRQ_EDGE_RISE);
-	
-	EnableAllInterrupts();
+	InterruptsInit();
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		/* If the Limit Switches are detected to be pressed at the start of the system - immedietaly react and roll the blinds to the working range */
+		if(buttonTopLimit_InitState & CHANNEL_BIT(channel)) RecoveryMode(channel, ChannelLookup.inputGpio[CHANNEL_INPUT_TOP_LIMIT][channel]);
+		else if(buttonBottomLimit_InitState & CHANNEL_BIT(channel)) RecoveryMode(channel, ChannelLookup.inputGpio[CHANNEL_INPUT_BOTTOM_LIMIT][channel]);
+		/* Expect the button to be de-pressed at the start, i dont care if you're pressing it when turning on the system, just release it and press again.
+		   During recovery the interrupts are re-enabled by the back-off itself once the Limit Switch is cleared */
+		else EnableChannelInterrupts(channel);
+	}
 
 	/* Set up task schedule */
 	TickType_t xTaskStartTime;
 	const TickType_t xTaskPeriod = pdMS_TO_TICKS(BUTTON_TASK_PERIOD);
 	xTaskStartTime = xTaskGetTickCount();
+	uint32_t reportCounter = 0;
 
 	/* Infinite task loop */
 	for( ;; )
 	{
-		/* This if statement for the limit switches has to be executed first in this task, since there is only 1 semaphore to take for the state change,
-		   and limit switches shall have the priority to set the OFF State when limit is reached  */
-		/* Limit Switch was activated - needs to be handled */
-		if(Limitter_ButtonInfo.pending)
+		/* Worst-case execution times of the interrupt handlers and tasks (only printed if the prints are enabled, otherwise read them with the debugger) */
+		if(++reportCounter >= CYCLE_REPORT_PERIOD_IN_TASK_CYCLES)
 		{
-			/* If Limit Switch was released */
-			if((Limitter_ButtonInfo.edge & GPIO_IRQ_EDGE_FALL) == GPIO_IRQ_EDGE_FALL)
-			{
-				switch (Limitter_ButtonInfo.gpio)
-				{
-					case BUTTON_TOP_LIMIT:
-						if(xSemaphoreGive(ButtonSemaphore) == pdTRUE)
-						{
-							MotorState_Requested = STATE_OFF;
-						}
-						break;
-
-					case BUTTON_BOTTOM_LIMIT:
-						if(xSemaphoreGive(ButtonSemaphore) == pdTRUE)
-						{
-							MotorState_Requested = STATE_OFF;
-						}
-						break;
-					default: break;
-				}
-			}
-			/* If Limit Switch was pressed (debounced, stable) */
-			else if((Limitter_ButtonInfo.edge & GPIO_IRQ_EDGE_RISE) == GPIO_IRQ_EDGE_RISE)
-			{
-				switch (Limitter_ButtonInfo.gpio)
-				{
-					case BUTTON_TOP_LIMIT:
-						if(xSemaphoreGive(ButtonSemaphore) == pdTRUE)
-						{
-							MotorState_Requested = STATE_CLOCKWISE;
-						}
-						break;
-
-					case BUTTON_BOTTOM_LIMIT:
-						if(xSemaphoreGive(ButtonSemaphore) == pdTRUE)
-						{
-							MotorState_Requested = STATE_ANTICLOCKWISE;
-						}
-						break;
-					default: break;
-				}
-			}
-			/* Limit Switch state change was handled, no longer pending */
-			Limitter_ButtonInfo.pending = false;
+			reportCounter = 0;
+			CycleCounter_Report();
 		}
+		Watchdog_CheckIn(WATCHDOG_CLIENT_BUTTON);
+		CycleTimestamp_t jobStart = CycleCounter_TaskStart();
 
-		/* Up/Down Button was activated - needs to be handled */
-		if(UpDown_ButtonInfo.pending)
+		for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
 		{
-			/* If Up/Down Button was released */
-			if((UpDown_ButtonInfo.edge & GPIO_IRQ_EDGE_FALL) == GPIO_IRQ_EDGE_FALL)
+			/* The limit switches are handled entirely in the interrupt context - the back-off and the stops are safety commands */
+
+			/* Up/Down Button was activated - needs to be handled */
+			if(Inputs.upDownPending[channel])
 			{
-				switch (UpDown_ButtonInfo.gpio)
+				/* If Up/Down Button was released */
+				if((Inputs.upDownEdge[channel] & GPIO_IRQ_EDGE_FALL) == GPIO_IRQ_EDGE_FALL)
 				{
-					case BUTTON_UP:
-					case BUTTON_DOWN:
-						if(xSemaphoreGive(ButtonSemaphore) == pdTRUE)
-						{
-							MotorState_Requested = STATE_OFF;
-						}
-						break;
-					default: break;
+					MotorCommand_Release(channel, MOTOR_PRIORITY_MANUAL);
 				}
-			}
-			/* If Up/Down Button was pressed (debounced, stable) */
-			else if((UpDown_ButtonInfo.edge & GPIO_IRQ_EDGE_RISE) == GPIO_IRQ_EDGE_RISE)
-			{
-				switch (UpDown_ButtonInfo.gpio)
+				/* If Up/Down Button was pressed (debounced, stable) - sent again every debouncing delay while it's held, coalesced by the broker */
+				else if((Inputs.upDownEdge[channel] & GPIO_IRQ_EDGE_RISE) == GPIO_IRQ_EDGE_RISE)
 				{
-					case BUTTON_DOWN:
-						if((xSemaphoreGive(ButtonSemaphore) == pdTRUE) && (!BottomLimitReached))
-						{
-							MotorState_Requested = STATE_CLOCKWISE;
-						}
-						break;
-					case BUTTON_UP:
-						if((xSemaphoreGive(ButtonSemaphore) == pdTRUE) && (!TopLimitReached))
-						{
-							MotorState_Requested = STATE_ANTICLOCKWISE;
-						}
-						break;
-					default: break;
+					switch (ChannelLookup.input[Inputs.upDownGpio[channel]])
+					{
+						case CHANNEL_INPUT_DOWN:
+							if((BottomLimitReached & CHANNEL_BIT(channel)) == 0U)
+							{
+								(void)MotorCommand_Submit(channel, STATE_CLOCKWISE, MOTOR_PRIORITY_MANUAL, MOTOR_DEADLINE_MANUAL_IN_US);
+							}
+							break;
+						case CHANNEL_INPUT_UP:
+							if((TopLimitReached & CHANNEL_BIT(channel)) == 0U)
+							{
+								(void)MotorCommand_Submit(channel, STATE_ANTICLOCKWISE, MOTOR_PRIORITY_MANUAL, MOTOR_DEADLINE_MANUAL_IN_US);
+							}
+							break;
+						default: break;
+					}
 				}
+				/* Up/Down Button state change was handled, no longer pending */
+				Inputs.upDownPending[channel] = false;
 			}
-			/* Up/Down Button state change was handled, no longer pending */
-			UpDown_ButtonInfo.pending = false;
 		}
 
+		CycleCounter_TaskStop(CYCLES_TASK_BUTTON, jobStart);
 		/* Delay until next cycle of the task */
 		vTaskDelayUntil(&xTaskStartTime, xTaskPeriod);
 	}
 }
 
-/** 
+/**
  * 	TODO:
- * 
+ *
 */
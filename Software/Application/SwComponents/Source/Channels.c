@@ -0,0 +1,57 @@
+/* Channels.c - lookup tables of the GPIOs of the blinds (channels) driven by this board */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+
+/* Include files from other tasks */
+#include "Channels.h"
+#include "SiteConfig.h"
+
+_Static_assert((BLINDS_NUM_OF_CHANNELS >= 1U) && (BLINDS_NUM_OF_CHANNELS <= BLINDS_MAX_NUM_OF_CHANNELS), "Not enough GPIOs for that many channels");
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+ChannelLookup_t ChannelLookup;
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Channels_Init(void)
+{
+	const ChannelConfig_t *channels = &SiteConfig->channels;
+
+	for(uint32_t gpio = 0; gpio < CHANNEL_NUM_OF_GPIOS; gpio++)
+	{
+		ChannelLookup.channel[gpio] = CHANNEL_NONE;
+	}
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+		{
+			uint32_t gpio = channels->inputGpio[input][channel];
+			uint32_t reg = GPIO_IRQ_REG(gpio);
+			uint32_t irqBits = GPIO_IRQ_BITS(gpio, GPIO_IRQ_BOTH_EDGES);
+
+			ChannelLookup.channel[gpio] = (uint8_t)channel;
+			ChannelLookup.input[gpio] = (uint8_t)input;
+			ChannelLookup.inputGpio[input][channel] = (uint8_t)gpio;
+			ChannelLookup.channelIrqBits[reg][channel] |= irqBits;
+			if((input == CHANNEL_INPUT_UP) || (input == CHANNEL_INPUT_DOWN))
+			{
+				ChannelLookup.upDownIrqBits[reg] |= irqBits;
+			}
+			else
+			{
+				ChannelLookup.limitIrqBits[reg] |= irqBits;
+			}
+			ChannelLookup.usedIrqRegs |= (1UL << reg);
+			ChannelLookup.inputsMask |= (1UL << gpio);
+		}
+		ChannelLookup.motorControl1Mask[channel] = 1UL << channels->motorControl1Gpio[channel];
+		ChannelLookup.motorControl2Mask[channel] = 1UL << channels->motorControl2Gpio[channel];
+		ChannelLookup.motorOutputsMask |= ChannelLookup.motorControl1Mask[channel] | ChannelLookup.motorControl2Mask[channel];
+	}
+}
@@ -0,0 +1,86 @@
+/* CycleCounter.c - execution time measurement of the interrupt handlers and task jobs (in clk_sys cycles) and their misses
+   of the XIP flash cache */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/* Include files from other tasks */
+#include "CycleCounter.h"
+#include "ElectronicBlinds_Main.h"
+#include "UsbLink.h"
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+CycleStats_t CycleStats[CYCLES_NUM_OF_ITEMS];
+XipStats_t XipStats[CYCLES_NUM_OF_ITEMS];
+const char *const CycleItemNames[CYCLES_NUM_OF_ITEMS] = {"GPIO", "TIMER_UPDOWNBUTTONS", "TIMER_LIMITSWITCHES",
+														 "ButtonTask", "MotorControllerTask", "AutomaticControlTask",
+														 "SolarWorkerTask"};
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void CycleCounter_Reset(void)
+{
+	uint32_t irqStatus = save_and_disable_interrupts();
+	memset(CycleStats, 0, sizeof(CycleStats));
+	memset(XipStats, 0, sizeof(XipStats));
+	xip_ctrl_hw->ctr_acc = 0U;
+	xip_ctrl_hw->ctr_hit = 0U;
+	restore_interrupts(irqStatus);
+}
+
+void CycleCounter_Report(void)
+{
+#if(PRINTS_ENABLED == 1)
+	/* One line per item - the format is parsed by HostTools/ResponseTime (--measurements), keep them in sync */
+	for(uint32_t item = 0; item < CYCLES_NUM_OF_ITEMS; item++)
+	{
+		/* Copy with the interrupts disabled so the numbers are consistent */
+		uint32_t irqStatus = save_and_disable_interrupts();
+		CycleStats_t stats = CycleStats[item];
+		XipStats_t xip = XipStats[item];
+		restore_interrupts(irqStatus);
+
+		uint32_t average = (stats.count > 0U) ? (uint32_t)(stats.total / stats.count) : 0U;
+		LOG("CYCLES %s count=%lu last=%lu avg=%lu worst=%lu\n", CycleItemNames[item], (unsigned long)stats.count,
+			(unsigned long)stats.last, (unsigned long)average, (unsigned long)stats.worst);
+		uint32_t averageMisses = (stats.count > 0U) ? (uint32_t)(xip.misses / stats.count) : 0U;
+		LOG("XIP %s accesses=%llu misses=%llu avg=%lu worst=%lu atworst=%lu\n", CycleItemNames[item], (unsigned long long)xip.accesses,
+			(unsigned long long)xip.misses, (unsigned long)averageMisses, (unsigned long)xip.worst, (unsigned long)xip.atWorstCycles);
+	}
+#endif
+}
+
+/* USB link CYCLE_INFO command - item (8-bit), its counters in one line */
+void CycleCounter_Info(const uint8_t *payload, uint32_t length)
+{
+	if((length != 1U) || (payload[0] >= CYCLES_NUM_OF_ITEMS))
+	{
+		UsbLink_Respond("ERR item 0");
+		return;
+	}
+
+	uint32_t irqStatus = save_and_disable_interrupts();
+	CycleStats_t stats = CycleStats[payload[0]];
+	XipStats_t xip = XipStats[payload[0]];
+	restore_interrupts(irqStatus);
+
+	uint32_t average = (stats.count > 0U) ? (uint32_t)(stats.total / stats.count) : 0U;
+	uint32_t averageMisses = (stats.count > 0U) ? (uint32_t)(xip.misses / stats.count) : 0U;
+	UsbLink_Respond("CYCLES %s %lu %lu %lu %lu %lu %lu", CycleItemNames[payload[0]], (unsigned long)stats.count, (unsigned long)average,
+					(unsigned long)stats.worst, (unsigned long)averageMisses, (unsigned long)xip.worst, (unsigned long)xip.atWorstCycles);
+}
+
+/* USB link CYCLE_RESET command - a new measurement from now on (e.g. once the load to compare under runs) */
+void CycleCounter_ResetRemote(void)
+{
+	CycleCounter_Reset();
+	UsbLink_Respond("ACK 0");
+}
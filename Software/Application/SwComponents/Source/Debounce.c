@@ -0,0 +1,219 @@
+/* Debounce.c - the settle windows of the inputs learned from the bounce of their presses (see Debounce.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+/* Include files from other tasks */
+#include "Debounce.h"
+#include "Channels.h"
+#include "UsbLink.h"
+#include "Hash.h"
+#include "SiteConfig.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+	uint32_t bin_us;
+	uint32_t margin_us;
+	uint32_t min_us;
+	uint32_t max_us;
+}DebounceLimits_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+DebounceStats_t DebounceStats;
+
+/* Indexed by DebounceIsLimit - the buttons, the limit switches. The upper bounds (the fixed delays) of the site configuration
+   are copied in by Debounce_Init - the interrupt handlers read them from SRAM */
+DebounceLimits_t HOT_PATH_DATA DebounceLimits[2] =
+{
+	{ DEBOUNCE_BUTTON_BIN_IN_US, DEBOUNCE_BUTTON_MARGIN_IN_US, DEBOUNCE_BUTTON_MIN_IN_US, DEBOUNCE_BUTTON_MAX_IN_US },
+	{ DEBOUNCE_LIMIT_BIN_IN_US, DEBOUNCE_LIMIT_MARGIN_IN_US, DEBOUNCE_LIMIT_MIN_IN_US, DEBOUNCE_LIMIT_MAX_IN_US }
+};
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+uint32_t DebounceIsLimit(uint32_t input);
+uint32_t DebouncePercentile(uint32_t channel, uint32_t input, uint32_t percent);
+uint32_t DebounceClamp(uint32_t input, uint32_t settle_us);
+bool DebounceRead(uint8_t reg, uint8_t *data, uint32_t length);
+bool DebounceWrite(uint8_t reg, const uint8_t *data, uint32_t length);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t HOT_PATH_FUNC(DebounceIsLimit)(uint32_t input)
+{
+	return ((input == CHANNEL_INPUT_TOP_LIMIT) || (input == CHANNEL_INPUT_BOTTOM_LIMIT)) ? 1U : 0U;
+}
+
+/* Upper edge of the bin the percentile falls into - the last bin holds everything longer, so it stands for the maximum */
+uint32_t HOT_PATH_FUNC(DebouncePercentile)(uint32_t channel, uint32_t input, uint32_t percent)
+{
+	const DebounceLimits_t *limits = &DebounceLimits[DebounceIsLimit(input)];
+	const uint16_t *bins = DebounceStats.bins[input][channel];
+	uint32_t rank = ((DebounceStats.samples[input][channel] * percent) + 99U) / 100U;
+	uint32_t count = 0;
+
+	for(uint32_t bin = 0; bin < (DEBOUNCE_NUM_OF_BINS - 1U); bin++)
+	{
+		count += bins[bin];
+		if(count >= rank)
+		{
+			return (bin + 1U) * limits->bin_us;
+		}
+	}
+	return limits->max_us;
+}
+
+/* Whole storage units within the bounds of the input */
+uint32_t HOT_PATH_FUNC(DebounceClamp)(uint32_t input, uint32_t settle_us)
+{
+	const DebounceLimits_t *limits = &DebounceLimits[DebounceIsLimit(input)];
+
+	settle_us = ((settle_us + DEBOUNCE_STORE_UNIT_IN_US - 1U) / DEBOUNCE_STORE_UNIT_IN_US) * DEBOUNCE_STORE_UNIT_IN_US;
+	if(settle_us < limits->min_us) settle_us = limits->min_us;
+	if(settle_us > limits->max_us) settle_us = limits->max_us;
+	return settle_us;
+}
+
+/* Bursts on I2C0 - the register pointer of the DS1307 increments after every byte */
+bool DebounceRead(uint8_t reg, uint8_t *data, uint32_t length)
+{
+	return (i2c_write_timeout_us(i2c0, DEBOUNCE_DS1307_I2C_ADDRESS, &reg, 1U, true, DEBOUNCE_I2C_TIMEOUT_IN_US) == 1) &&
+		   (i2c_read_timeout_us(i2c0, DEBOUNCE_DS1307_I2C_ADDRESS, data, length, false, DEBOUNCE_I2C_TIMEOUT_IN_US) == (int)length);
+}
+
+bool DebounceWrite(uint8_t reg, const uint8_t *data, uint32_t length)
+{
+	uint8_t frame[1U + sizeof(DebounceState_t)];
+
+	frame[0] = reg;
+	memcpy(&frame[1], data, length);
+	return i2c_write_timeout_us(i2c0, DEBOUNCE_DS1307_I2C_ADDRESS, frame, length + 1U, false, DEBOUNCE_I2C_TIMEOUT_IN_US) == (int)(length + 1U);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Debounce_Init(void)
+{
+	DebounceState_t state;
+
+	DebounceLimits[0].max_us = SiteConfig->debounceButton_us;
+	DebounceLimits[1].max_us = SiteConfig->debounceLimit_us;
+
+	bool valid = DebounceRead(DEBOUNCE_NVRAM_ADDR, (uint8_t*)&state, sizeof(state)) && (state.magic == DEBOUNCE_MAGIC) &&
+				 (state.crc == Hash_Crc32(&state, offsetof(DebounceState_t, crc)));
+	for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+	{
+		for(uint32_t channel = 0; channel < BLINDS_MAX_NUM_OF_CHANNELS; channel++)
+		{
+			/* Nothing learned yet (or a value out of the bounds of this build) - the fixed delay */
+			DebounceStats.settle_us[input][channel] = Debounce_Max(input);
+			if(valid && (state.settle[input][channel] != 0U))
+			{
+				DebounceStats.settle_us[input][channel] = DebounceClamp(input, state.settle[input][channel] * DEBOUNCE_STORE_UNIT_IN_US);
+			}
+		}
+	}
+	LOG("Debounce: settle windows %s\n", valid ? "loaded" : "not learned yet");
+}
+
+uint32_t HOT_PATH_FUNC(Debounce_Settle)(uint32_t channel, uint32_t input)
+{
+	return DebounceStats.settle_us[input][channel];
+}
+
+uint32_t HOT_PATH_FUNC(Debounce_Max)(uint32_t input)
+{
+	return DebounceLimits[DebounceIsLimit(input)].max_us;
+}
+
+/* A stable press - from its first to its last edge */
+void HOT_PATH_FUNC(Debounce_Record)(uint32_t channel, uint32_t input, uint32_t bounce_us)
+{
+	const DebounceLimits_t *limits = &DebounceLimits[DebounceIsLimit(input)];
+	uint16_t *bins = DebounceStats.bins[input][channel];
+	uint32_t bin = bounce_us / limits->bin_us;
+
+	if(bounce_us > DebounceStats.longest_us[input][channel]) DebounceStats.longest_us[input][channel] = bounce_us;
+	if(DebounceStats.samples[input][channel] >= DEBOUNCE_AGING_SAMPLES)
+	{
+		uint32_t samples = 0;
+		for(uint32_t i = 0; i < DEBOUNCE_NUM_OF_BINS; i++)
+		{
+			bins[i] /= 2U;
+			samples += bins[i];
+		}
+		DebounceStats.samples[input][channel] = samples;
+	}
+	bins[(bin < DEBOUNCE_NUM_OF_BINS) ? bin : (DEBOUNCE_NUM_OF_BINS - 1U)]++;
+	DebounceStats.samples[input][channel]++;
+
+	if(DebounceStats.samples[input][channel] >= DEBOUNCE_MIN_SAMPLES)
+	{
+		uint32_t settle_us = DebounceClamp(input, DebouncePercentile(channel, input, DEBOUNCE_PERCENTILE) + limits->margin_us);
+		if(settle_us != DebounceStats.settle_us[input][channel])
+		{
+			DebounceStats.settle_us[input][channel] = settle_us;
+			DebounceStats.dirty = true;
+		}
+	}
+}
+
+void Debounce_Service(void)
+{
+	DebounceState_t state;
+
+	if(!DebounceStats.dirty)
+	{
+		return;
+	}
+	DebounceStats.dirty = false;
+
+	memset(&state, 0, sizeof(state));
+	state.magic = DEBOUNCE_MAGIC;
+	for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+	{
+		for(uint32_t channel = 0; channel < BLINDS_MAX_NUM_OF_CHANNELS; channel++)
+		{
+			state.settle[input][channel] = (uint8_t)(DebounceStats.settle_us[input][channel] / DEBOUNCE_STORE_UNIT_IN_US);
+		}
+	}
+	state.crc = Hash_Crc32(&state, offsetof(DebounceState_t, crc));
+	if(!DebounceWrite(DEBOUNCE_NVRAM_ADDR, (const uint8_t*)&state, sizeof(state)))
+	{
+		DebounceStats.dirty = true;	/* the next run */
+	}
+}
+
+void Debounce_Info(const uint8_t *payload, uint32_t length)
+{
+	if(length != DEBOUNCE_INFO_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	uint32_t channel = payload[0] / CHANNEL_NUM_OF_INPUTS;
+	uint32_t input = payload[0] % CHANNEL_NUM_OF_INPUTS;
+	if(channel >= BLINDS_NUM_OF_CHANNELS)
+	{
+		UsbLink_Respond("ERR item 0");
+		return;
+	}
+	uint32_t samples = DebounceStats.samples[input][channel];
+	UsbLink_Respond("DEBOUNCE %lu %lu %lu %lu %lu %lu %lu", (unsigned long)channel, (unsigned long)input,
+					(unsigned long)DebounceStats.settle_us[input][channel], (unsigned long)samples,
+					(unsigned long)((samples != 0U) ? DebouncePercentile(channel, input, 50U) : 0U),
+					(unsigned long)((samples != 0U) ? DebouncePercentile(channel, input, DEBOUNCE_PERCENTILE) : 0U),
+					(unsigned long)DebounceStats.longest_us[input][channel]);
+}
@@ -44,8 +44,24 @@
 
 /* Task includes */
 #include "ButtonTask.h"
+#include "Channels.h"
 #include "MotorControllerTask.h"
 #include "AutomaticControlTask.h"
+#include "SolarWorker.h"
+#include "LightSensor.h"
+#include "MotionSensor.h"
+#include "Watchdog.h"
+#include "UsbLink.h"
+#include "Update.h"
+#include "Trace.h"
+#include "TimeSync.h"
+#include "Debounce.h"
+#include "NodeBus.h"
+#include "SiteConfig.h"
+#include "Profiler.h"
+#include "TimerService.h"
+#include "Encoder.h"
+#include "PowerMonitor.h"
 
 /* Includes from the DS1307 library */
 #include "DS1307.h"
@@ -64,17 +80,27 @@ void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName );
 void vApplicationTickHook(void);
 
 /*--------------- GLOBAL VARIABLE DEFINITIONS ---------------*/
-bool buttonDown_InitState, buttonUp_InitState, buttonTopLimit_InitState, buttonBottomLimit_InitState;
+uint32_t buttonTopLimit_InitState, buttonBottomLimit_InitState;
 
 
 /*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
 void main(void)
 {
+    /* The configuration of this site (pins, location, delays) in place in the flash - or the build defaults */
+    SiteConfig_Init();
+
+    /* After a watchdog reset the system was already up and running - skip the startup delay and the RTC setup,
+       the H-bridge goes to the safe state (all off) by prvSetupHardware and the interrupted move is resumed or aborted */
+    bool fastBoot = Watchdog_ReadRecord();
+
     /* Startup delay - wait until the whole system is stabilized before starting */
-    sleep_ms(4000);
+    if(!fastBoot) sleep_ms(4000);
 
     /* Configure the Raspberry Pico hardware */
     prvSetupHardware();
+#if (TRACE_ENABLED == 1)
+    Trace_Init(fastBoot);
+#endif
     getInitialPinStates();
 
 	/* Reset the I2C0 controller to get a fresh clear state */
@@ -84,20 +110,83 @@ void main(void)
     I2C_Initialize(I2C_FAST_MODE);
 	(void)setupPinsI2C0();
 
-    /* Configure the DS1307 (RTC) module */
-	(void)Disable_DS1307_SquareWaveOutput();
-	(void)Enable_DS1307_Oscillator();
+    if(!fastBoot)
+    {
+        /* Configure the DS1307 (RTC) module */
+        (void)Disable_DS1307_SquareWaveOutput();
+        (void)Enable_DS1307_Oscillator();
+
+        /* The date and time are set at runtime over the USB link (TIME_SYNC - HostTools/FirmwareUpdate/UpdateSender --time-sync) */
+    }
+
+	/* Create a binary semaphore */
+	/* Once created, a semaphore can be used with the xSemaphoreTake and xSemaphoreGive functions to control access to the shared resource */
+	/* Created before the tasks - any of them may submit a motor command as soon as it runs */
+	ButtonSemaphore = xSemaphoreCreateBinary();
+	MotorCommand_Init();
+
+	/* Every software deadline (the debounce and back-off of ButtonTask) on alarm 0 - its interrupt taken by this core */
+	TimerService_Init();
+
+#if (ENCODER_ENABLED == 1)
+	/* Counting from the boot on - the limit switch presses of ButtonTask tell where the count is */
+	Encoder_Init();
+#endif
+
+#if (LIGHT_SENSOR_ENABLED == 1)
+	/* Wakes SolarWorkerTask (and the decision of AutomaticControlTask after it) when the ambient light level changes */
+	LightLevelSemaphore = xSemaphoreCreateBinary();
+	LightSensor_Init();
+#endif
+
+	/* Firmware update over USB - the boot state decides whether this image still has to confirm itself */
+	UsbLink_Init();
+	Update_Init();
+
+#if (PROFILER_ENABLED == 1)
+	/* The alarm interrupt of the profiler on this core - a capture is started over the USB link */
+	Profiler_Init();
+#endif
+
+	/* The DS1307 is shared by SolarWorkerTask, AutomaticControlTask and the time sync of the USB link */
+	TimeSync_Init();
+
+	/* Given by SolarWorkerTask after every run - AutomaticControlTask decides on the day it published */
+	SolarDaySemaphore = xSemaphoreCreateBinary();
+
+	/* Settle windows of the inputs learned before the reboot - ButtonTask debounces with them from its first press on */
+	Debounce_Init();
 
-    /* this code is activated with an additional build definition when date update is needed */
-    /* be careful to flash the DST time for this program to work properly */
-#if (SPECIAL_BUILD_FOR_SETTING_DATE == 1)
-	(void)SetCurrentDate((const char*)__DATE__, (const char*)__TIME__ ); 
+#if (POWER_MONITOR_ENABLED == 1)
+	/* The record of the power cut before this boot (the encoder travel comes from it), then the supply watched on a deadline
+	   of the timer service - the light sensor input is converted there too */
+	PowerMonitor_Init();
 #endif
 
+#if (NODE_BUS_ENABLED == 1)
+	/* The other controllers of the house on UART0 */
+	NodeBus_Init();
+#endif
+
+	/* Watchdog on before the tasks start - every task has to check in with it from its first run on */
+	Watchdog_Init();
+	Watchdog_ResumeMoves();
+
 	/* Create the OS tasks */
 	xTaskCreate( MotorControllerTask,"MotorControllerTask",configMINIMAL_STACK_SIZE,NULL,MOTOR_CONTROLLER_TASK_PRIORITY, NULL );								
 	xTaskCreate( ButtonTask, "ButtonTask", configMINIMAL_STACK_SIZE, NULL, BUTTON_TASK_PRIORITY, NULL );
     xTaskCreate( AutomaticControlTask, "AutomaticControlTask", configMINIMAL_STACK_SIZE, NULL, AUTOMATIC_CONTROL_TASK_PRIORITY, NULL );
+    xTaskCreate( SolarWorkerTask, "SolarWorkerTask", configMINIMAL_STACK_SIZE * 2, NULL, SOLAR_WORKER_TASK_PRIORITY, NULL );
+#if (MOTION_SENSOR_ENABLED == 1)
+	xTaskCreate( MotionSensorTask, "MotionSensorTask", configMINIMAL_STACK_SIZE, NULL, MOTION_SENSOR_TASK_PRIORITY, NULL );
+#endif
+	xTaskCreate( UsbLinkTask, "UsbLinkTask", configMINIMAL_STACK_SIZE * 2, NULL, USB_LINK_TASK_PRIORITY, NULL );
+#if (NODE_BUS_ENABLED == 1)
+	xTaskCreate( NodeBusTask, "NodeBusTask", configMINIMAL_STACK_SIZE, NULL, NODE_BUS_TASK_PRIORITY, NULL );
+#endif
+#if (POWER_MONITOR_ENABLED == 1)
+	xTaskCreate( PowerMonitorTask, "PowerMonitorTask", configMINIMAL_STACK_SIZE, NULL, POWER_MONITOR_TASK_PRIORITY, NULL );
+#endif
 
 	/* Start the FreeRTOS scheduler and system tick  */
 	vTaskStartScheduler();
@@ -117,17 +206,22 @@ void getInitialPinStates(void)
 {
     uint8_t consistentReads;
 
-	consistentReads = 0;
-	for(uint8_t i = 0; i < 100; i++ ){
-		gpio_get(BUTTON_TOP_LIMIT) ? consistentReads++ : 0;
-	}
-	buttonTopLimit_InitState = (consistentReads >= 70) ? 1 : 0;
-
-	consistentReads = 0;
-	for(uint8_t i = 0; i < 100; i++ ){
-		gpio_get(BUTTON_BOTTOM_LIMIT) ? consistentReads++ : 0;
+	buttonTopLimit_InitState = 0;
+	buttonBottomLimit_InitState = 0;
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		consistentReads = 0;
+		for(uint8_t i = 0; i < 100; i++ ){
+			Trace_GpioGet(SiteConfig->channels.inputGpio[CHANNEL_INPUT_TOP_LIMIT][channel]) ? consistentReads++ : 0;
+		}
+		if(consistentReads >= 70) buttonTopLimit_InitState |= CHANNEL_BIT(channel);
+
+		consistentReads = 0;
+		for(uint8_t i = 0; i < 100; i++ ){
+			Trace_GpioGet(SiteConfig->channels.inputGpio[CHANNEL_INPUT_BOTTOM_LIMIT][channel]) ? consistentReads++ : 0;
+		}
+		if(consistentReads >= 70) buttonBottomLimit_InitState |= CHANNEL_BIT(channel);
 	}
-	buttonBottomLimit_InitState = (consistentReads >= 70) ? 1 : 0;
 }
 
 /*-----------------------------------------------------------*/
@@ -140,6 +234,9 @@ void prvSetupHardware(void)
     gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
     gpio_put(PICO_DEFAULT_LED_PIN, 0);
 
+    Channels_Init();
+
+#if (BLINDS_NUM_OF_CHANNELS < 4U) /* channel 3 uses the 3.3V source pins as inputs */
     gpio_init(SOURCE_3V3_1);
     gpio_set_dir(SOURCE_3V3_1, GPIO_OUT);
     gpio_put(SOURCE_3V3_1, 1);
@@ -155,30 +252,25 @@ void prvSetupHardware(void)
     gpio_init(SOURCE_3V3_4);
     gpio_set_dir(SOURCE_3V3_4, GPIO_OUT);
     gpio_put(SOURCE_3V3_4, 1);
+#endif
 
-    gpio_init(BUTTON_UP);
-    gpio_set_dir(BUTTON_UP, GPIO_IN);
-    gpio_set_pulls(BUTTON_UP, false, true);
-
-    gpio_init(BUTTON_DOWN);
-    gpio_set_dir(BUTTON_DOWN, GPIO_IN);
-    gpio_set_pulls(BUTTON_DOWN, false, true);
-
-	gpio_init(BUTTON_TOP_LIMIT);
-    gpio_set_dir(BUTTON_TOP_LIMIT, GPIO_IN);
-    gpio_set_pulls(BUTTON_TOP_LIMIT, false, true);
-
-    gpio_init(BUTTON_BOTTOM_LIMIT);
-    gpio_set_dir(BUTTON_BOTTOM_LIMIT, GPIO_IN);
-    gpio_set_pulls(BUTTON_BOTTOM_LIMIT, false, true);
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+        {
+            gpio_init(SiteConfig->channels.inputGpio[input][channel]);
+            gpio_set_dir(SiteConfig->channels.inputGpio[input][channel], GPIO_IN);
+            gpio_set_pulls(SiteConfig->channels.inputGpio[input][channel], false, true);
+        }
 
-    gpio_init(MOTOR_CONTROL_1);
-    gpio_set_dir(MOTOR_CONTROL_1, GPIO_OUT);
-    gpio_put(MOTOR_CONTROL_1, 0);
+        gpio_init(SiteConfig->channels.motorControl1Gpio[channel]);
+        gpio_set_dir(SiteConfig->channels.motorControl1Gpio[channel], GPIO_OUT);
+        gpio_put(SiteConfig->channels.motorControl1Gpio[channel], 0);
 
-    gpio_init(MOTOR_CONTROL_2);
-    gpio_set_dir(MOTOR_CONTROL_2, GPIO_OUT);
-    gpio_put(MOTOR_CONTROL_2, 0);
+        gpio_init(SiteConfig->channels.motorControl2Gpio[channel]);
+        gpio_set_dir(SiteConfig->channels.motorControl2Gpio[channel], GPIO_OUT);
+        gpio_put(SiteConfig->channels.motorControl2Gpio[channel], 0);
+    }
 
 }
 /*-----------------------------------------------------------*/
@@ -233,6 +325,12 @@ void vApplicationTickHook(void)
     /* The vApplicationTickHook function is a user-defined callback function in FreeRTOS 
     that gets called by the FreeRTOS kernel each time a tick interrupt occurs */
 
-    /* Do nothing for now */
+#if (LIGHT_SENSOR_ENABLED == 1)
+    /* Light level filter - runs once a second on the back of the tick interrupt */
+    LightSensor_TickHook();
+#endif
+
+    /* Feeds the hardware watchdog while all the tasks check in */
+    Watchdog_TickHook();
 
 }
@@ -0,0 +1,191 @@
+/* Encoder.c - quadrature encoder on the blind shaft, counted by a PIO state machine (see Encoder.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <math.h>
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+
+/* Include files from other tasks */
+#include "Encoder.h"
+#include "ElectronicBlinds_Main.h"
+
+#if (ENCODER_ENABLED == 1)
+
+_Static_assert(ENCODER_B_GPIO == (ENCODER_A_GPIO + 1U), "The PIO program reads A and B as two consecutive pins");
+_Static_assert(BLINDS_NUM_OF_CHANNELS <= 2U, "The encoder pins are the Up/Down buttons of channel 2");
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define ENCODER_PIO							(pio0)
+/* Addresses in the program - the 16 entries of the jump table first (the last and the new levels of B:A as the index) */
+#define ENCODER_ADDR_DECREMENT				(14U)
+#define ENCODER_ADDR_UPDATE					(15U)		/* wrap target */
+#define ENCODER_ADDR_INCREMENT				(21U)
+#define ENCODER_ADDR_WRAP					(23U)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+EncoderState_t EncoderState;
+
+static uint16_t EncoderInstructions[ENCODER_PROGRAM_LENGTH];
+static int EncoderSm = -1;
+static spin_lock_t *EncoderLock;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void EncoderAssemble(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Counting up is the sequence 00 -> 10 -> 11 -> 01 of B:A (B leads) - the blind going down. Entry 14 is the decrement itself,
+   entry 15 the start of the loop, a jump between two levels that are not neighbours (a count missed) counts nothing */
+void EncoderAssemble(void)
+{
+	static const uint8_t table[14] =
+	{
+		ENCODER_ADDR_UPDATE, ENCODER_ADDR_DECREMENT, ENCODER_ADDR_INCREMENT, ENCODER_ADDR_UPDATE,		/* from 00 */
+		ENCODER_ADDR_INCREMENT, ENCODER_ADDR_UPDATE, ENCODER_ADDR_UPDATE, ENCODER_ADDR_DECREMENT,		/* from 01 */
+		ENCODER_ADDR_DECREMENT, ENCODER_ADDR_UPDATE, ENCODER_ADDR_UPDATE, ENCODER_ADDR_INCREMENT,		/* from 10 */
+		ENCODER_ADDR_UPDATE, ENCODER_ADDR_INCREMENT													/* from 11, 10 and 11 fall through */
+	};
+	uint32_t addr = 0;
+
+	for(; addr < sizeof(table); addr++)
+	{
+		EncoderInstructions[addr] = (uint16_t)pio_encode_jmp(table[addr]);
+	}
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_jmp_y_dec(ENCODER_ADDR_UPDATE);		/* Y-- whatever Y is */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_mov(pio_isr, pio_y);
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_push(false, false);					/* a full FIFO drops it, ISR cleared */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_out(pio_isr, 2U);					/* the last levels ... */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_in(pio_pins, 2U);					/* ... and the new ones below them */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_mov(pio_osr, pio_isr);				/* the new ones are the last ones next time */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_mov(pio_pc, pio_isr);
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_mov_not(pio_y, pio_y);				/* Y++ as ~(~Y - 1) */
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_jmp_y_dec(ENCODER_ADDR_WRAP);
+	EncoderInstructions[addr++] = (uint16_t)pio_encode_mov_not(pio_y, pio_y);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Encoder_Init(void)
+{
+	const pio_program_t program = { .instructions = EncoderInstructions, .length = ENCODER_PROGRAM_LENGTH, .origin = 0 };
+
+	EncoderLock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+	EncoderAssemble();
+	if(!pio_can_add_program(ENCODER_PIO, &program))
+	{
+		LOG("encoder: no room for the PIO program\n");
+		return;
+	}
+	(void)pio_add_program(ENCODER_PIO, &program);
+	EncoderSm = pio_claim_unused_sm(ENCODER_PIO, true);
+
+	/* Open collector outputs of the encoder - pulled up here */
+	pio_gpio_init(ENCODER_PIO, ENCODER_A_GPIO);
+	pio_gpio_init(ENCODER_PIO, ENCODER_B_GPIO);
+	gpio_pull_up(ENCODER_A_GPIO);
+	gpio_pull_up(ENCODER_B_GPIO);
+	pio_sm_set_consecutive_pindirs(ENCODER_PIO, (uint)EncoderSm, ENCODER_A_GPIO, 2U, false);
+
+	pio_sm_config config = pio_get_default_sm_config();
+	sm_config_set_wrap(&config, ENCODER_ADDR_UPDATE, ENCODER_ADDR_WRAP);
+	sm_config_set_in_pins(&config, ENCODER_A_GPIO);
+	sm_config_set_in_shift(&config, false, false, 32U);
+	sm_config_set_out_shift(&config, true, false, 32U);
+	sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+	pio_sm_init(ENCODER_PIO, (uint)EncoderSm, ENCODER_ADDR_UPDATE, &config);
+
+	/* Count 0, the levels of now as the last ones - no step counted for the levels the encoder rests at */
+	pio_sm_exec(ENCODER_PIO, (uint)EncoderSm, pio_encode_set(pio_y, 0U));
+	pio_sm_exec(ENCODER_PIO, (uint)EncoderSm, pio_encode_mov(pio_osr, pio_pins));
+	pio_sm_set_enabled(ENCODER_PIO, (uint)EncoderSm, true);
+}
+
+/* The FIFO is full of counts that were pushed before it filled up - they are thrown away, the one pushed after them is now */
+int32_t HOT_PATH_FUNC(Encoder_Read)(void)
+{
+	if(EncoderSm < 0)
+	{
+		return 0;
+	}
+
+	uint32_t save = spin_lock_blocking(EncoderLock);
+	uint32_t entries = pio_sm_get_rx_fifo_level(ENCODER_PIO, (uint)EncoderSm) + 1U;
+	uint32_t count = 0;
+	while(entries-- > 0U)
+	{
+		count = pio_sm_get_blocking(ENCODER_PIO, (uint)EncoderSm);
+	}
+	EncoderState.reads++;
+	spin_unlock(EncoderLock, save);
+	return (int32_t)count;
+}
+
+void HOT_PATH_FUNC(Encoder_LimitReached)(uint32_t channel, bool top)
+{
+	if(channel != ENCODER_CHANNEL)
+	{
+		return;
+	}
+
+	int32_t count = Encoder_Read();
+	uint32_t save = spin_lock_blocking(EncoderLock);
+	if(top)
+	{
+		EncoderState.topCount = count;
+		EncoderState.topSeen = true;
+	}
+	else
+	{
+		EncoderState.bottomCount = count;
+		EncoderState.bottomSeen = true;
+	}
+	spin_unlock(EncoderLock, save);
+}
+
+/* The travel between the switches from before a power cut - the count of the blind shaft then (from the top switch) is the count
+   of now, the blind stood still meanwhile. The next press of a switch corrects its end like after a count of its own */
+void Encoder_Restore(int32_t fromTop, int32_t span)
+{
+	int32_t count = Encoder_Read();
+	uint32_t save = spin_lock_blocking(EncoderLock);
+	EncoderState.topCount = count - fromTop;
+	EncoderState.bottomCount = EncoderState.topCount + span;
+	EncoderState.topSeen = true;
+	EncoderState.bottomSeen = true;
+	spin_unlock(EncoderLock, save);
+}
+
+bool Encoder_Calibrated(void)
+{
+	int32_t span = EncoderState.bottomCount - EncoderState.topCount;
+	return EncoderState.topSeen && EncoderState.bottomSeen && ((span >= ENCODER_MIN_SPAN) || (span <= -ENCODER_MIN_SPAN));
+}
+
+/* The encoder may be mounted either way round - the sign of the travel between the switches tells */
+int32_t Encoder_Travel(int32_t from, int32_t to)
+{
+	return (EncoderState.bottomCount >= EncoderState.topCount) ? (to - from) : (from - to);
+}
+
+int32_t Encoder_CountAt(float position)
+{
+	if(position < 0.0f) position = 0.0f;
+	if(position > 1.0f) position = 1.0f;
+	return EncoderState.topCount + (int32_t)lroundf(position * (float)(EncoderState.bottomCount - EncoderState.topCount));
+}
+
+float Encoder_PositionAt(int32_t count)
+{
+	return (float)(count - EncoderState.topCount) / (float)(EncoderState.bottomCount - EncoderState.topCount);
+}
+
+#endif /* ENCODER_ENABLED */
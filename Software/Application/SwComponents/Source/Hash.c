@@ -0,0 +1,172 @@
+/* Hash.c - CRC-32 of the USB link frames and boot records, SHA-256 of the firmware images */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <string.h>
+
+/* Include files from other tasks */
+#include "Hash.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define CRC32_POLYNOMIAL_REFLECTED			(0xEDB88320UL)
+
+#define ROTR(x, n)							(((x) >> (n)) | ((x) << (32U - (n))))
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* Half-byte table - 64 bytes of flash instead of the 1KB of the byte-wise table, 2 lookups per byte */
+static const uint32_t Crc32Table[16] =
+{
+	0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL, 0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+	0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL, 0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+};
+
+static const uint32_t Sha256K[64] =
+{
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void HashSha256Block(HashSha256_t *context, const uint8_t *block);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+void HashSha256Block(HashSha256_t *context, const uint8_t *block)
+{
+	uint32_t w[64];
+	uint32_t a = context->state[0], b = context->state[1], c = context->state[2], d = context->state[3];
+	uint32_t e = context->state[4], f = context->state[5], g = context->state[6], h = context->state[7];
+
+	for(uint32_t i = 0; i < 16U; i++)
+	{
+		w[i] = ((uint32_t)block[4U * i] << 24) | ((uint32_t)block[4U * i + 1U] << 16) | ((uint32_t)block[4U * i + 2U] << 8) | block[4U * i + 3U];
+	}
+	for(uint32_t i = 16; i < 64U; i++)
+	{
+		uint32_t s0 = ROTR(w[i - 15U], 7U) ^ ROTR(w[i - 15U], 18U) ^ (w[i - 15U] >> 3);
+		uint32_t s1 = ROTR(w[i - 2U], 17U) ^ ROTR(w[i - 2U], 19U) ^ (w[i - 2U] >> 10);
+		w[i] = w[i - 16U] + s0 + w[i - 7U] + s1;
+	}
+
+	for(uint32_t i = 0; i < 64U; i++)
+	{
+		uint32_t t1 = h + (ROTR(e, 6U) ^ ROTR(e, 11U) ^ ROTR(e, 25U)) + ((e & f) ^ (~e & g)) + Sha256K[i] + w[i];
+		uint32_t t2 = (ROTR(a, 2U) ^ ROTR(a, 13U) ^ ROTR(a, 22U)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	context->state[0] += a;
+	context->state[1] += b;
+	context->state[2] += c;
+	context->state[3] += d;
+	context->state[4] += e;
+	context->state[5] += f;
+	context->state[6] += g;
+	context->state[7] += h;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t Hash_Crc32Update(uint32_t crc, const void *data, size_t length)
+{
+	const uint8_t *bytes = data;
+
+	for(size_t i = 0; i < length; i++)
+	{
+		crc ^= bytes[i];
+		crc = (crc >> 4) ^ Crc32Table[crc & 0x0FU];
+		crc = (crc >> 4) ^ Crc32Table[crc & 0x0FU];
+	}
+	return crc;
+}
+
+uint32_t Hash_Crc32(const void *data, size_t length)
+{
+	return ~Hash_Crc32Update(HASH_CRC32_INIT, data, length);
+}
+
+void Hash_Sha256Init(HashSha256_t *context)
+{
+	static const uint32_t initialState[8] =
+	{
+		0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL, 0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+	};
+
+	memcpy(context->state, initialState, sizeof(context->state));
+	context->length = 0;
+	context->blockFill = 0;
+}
+
+void Hash_Sha256Update(HashSha256_t *context, const void *data, size_t length)
+{
+	const uint8_t *bytes = data;
+
+	context->length += length;
+	while(length > 0U)
+	{
+		/* Whole blocks straight from the source, the rest through the block buffer */
+		if((context->blockFill == 0U) && (length >= HASH_SHA256_BLOCK_SIZE))
+		{
+			HashSha256Block(context, bytes);
+			bytes += HASH_SHA256_BLOCK_SIZE;
+			length -= HASH_SHA256_BLOCK_SIZE;
+			continue;
+		}
+
+		size_t chunk = HASH_SHA256_BLOCK_SIZE - context->blockFill;
+		if(chunk > length) chunk = length;
+		memcpy(&context->block[context->blockFill], bytes, chunk);
+		context->blockFill += chunk;
+		bytes += chunk;
+		length -= chunk;
+		if(context->blockFill == HASH_SHA256_BLOCK_SIZE)
+		{
+			HashSha256Block(context, context->block);
+			context->blockFill = 0;
+		}
+	}
+}
+
+void Hash_Sha256Final(HashSha256_t *context, uint8_t digest[HASH_SHA256_SIZE])
+{
+	uint64_t bits = context->length * 8U;
+
+	/* Padding: 0x80, zeros up to 56 bytes of the last block, the length in bits (big endian) */
+	context->block[context->blockFill++] = 0x80U;
+	if(context->blockFill > (HASH_SHA256_BLOCK_SIZE - 8U))
+	{
+		memset(&context->block[context->blockFill], 0, HASH_SHA256_BLOCK_SIZE - context->blockFill);
+		HashSha256Block(context, context->block);
+		context->blockFill = 0;
+	}
+	memset(&context->block[context->blockFill], 0, (HASH_SHA256_BLOCK_SIZE - 8U) - context->blockFill);
+	for(uint32_t i = 0; i < 8U; i++)
+	{
+		context->block[HASH_SHA256_BLOCK_SIZE - 1U - i] = (uint8_t)(bits >> (8U * i));
+	}
+	HashSha256Block(context, context->block);
+
+	for(uint32_t i = 0; i < 8U; i++)
+	{
+		digest[4U * i] = (uint8_t)(context->state[i] >> 24);
+		digest[4U * i + 1U] = (uint8_t)(context->state[i] >> 16);
+		digest[4U * i + 2U] = (uint8_t)(context->state[i] >> 8);
+		digest[4U * i + 3U] = (uint8_t)context->state[i];
+	}
+}
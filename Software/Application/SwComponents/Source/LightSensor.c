@@ -0,0 +1,164 @@
+/* LightSensor.c - ambient light level from a photodiode/LDR divider on an ADC pin */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+
+/* Include files from other tasks */
+#include "LightSensor.h"
+#include "SiteConfig.h"
+#include "ElectronicBlinds_Main.h"
+
+#if (LIGHT_SENSOR_ENABLED == 1)
+
+_Static_assert((LIGHT_SENSOR_GPIO >= 26U) && (LIGHT_SENSOR_GPIO <= 28U), "The light sensor needs one of the ADC pins (GPIO 26-28)");
+_Static_assert(BLINDS_NUM_OF_CHANNELS <= 2U, "The ADC pins are used by the buttons/motors of channels 2 and 3");
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+volatile LightLevel_t LightLevel = LIGHT_LEVEL_NORMAL;
+volatile uint32_t LightFiltered;
+uint32_t LightLevelChanges;
+SemaphoreHandle_t LightLevelSemaphore;
+
+/* Written by the DMA only - the ring has to be aligned to its size */
+static volatile uint16_t LightSamples[LIGHT_SENSOR_BUFFER_SAMPLES] __attribute__((aligned(1U << LIGHT_SENSOR_BUFFER_RING_BITS)));
+static int32_t LightFilterState; /* Q12.16 */
+static bool LightFilterSeeded;
+static uint32_t LightTickCounter;
+#if (POWER_MONITOR_ENABLED == 1)
+static uint32_t LightSampleIndex;
+#else
+static uint32_t LightDmaChannel;
+#endif
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+LightLevel_t LightLevelWithHysteresis(LightLevel_t level, uint32_t filtered);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+LightLevel_t LightLevelWithHysteresis(LightLevel_t level, uint32_t filtered)
+{
+	/* Leaving a level takes a step of the hysteresis past its threshold - clouds passing by don't toggle the level */
+	uint32_t dark = SiteConfig->lightDarkThreshold, bright = SiteConfig->lightBrightThreshold, hysteresis = SiteConfig->lightHysteresis;
+
+	switch (level)
+	{
+		case LIGHT_LEVEL_DARK:
+			if(filtered > (dark + hysteresis)) level = LIGHT_LEVEL_NORMAL;
+			break;
+		case LIGHT_LEVEL_BRIGHT:
+			if(filtered < (bright - hysteresis)) level = LIGHT_LEVEL_NORMAL;
+			break;
+		default:
+			break;
+	}
+	if(level == LIGHT_LEVEL_NORMAL)
+	{
+		if(filtered < (dark - hysteresis)) level = LIGHT_LEVEL_DARK;
+		else if(filtered > (bright + hysteresis)) level = LIGHT_LEVEL_BRIGHT;
+	}
+	return level;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void LightSensor_Init(void)
+{
+#if (POWER_MONITOR_ENABLED == 1)
+	/* The supply monitor converts on demand and this input along (LightSensor_Sample) - the ADC itself is set up by PowerMonitor_Init */
+	adc_gpio_init(LIGHT_SENSOR_GPIO);
+#else
+	/* ADC free-running in round-robin mode (only the light input is in the mask, more inputs can be added to it),
+	   at the slowest rate it supports - the converter is busy ~0.15% of the time */
+	adc_init();
+	adc_gpio_init(LIGHT_SENSOR_GPIO);
+	adc_select_input(LIGHT_SENSOR_ADC_INPUT);
+	adc_set_round_robin(1U << LIGHT_SENSOR_ADC_INPUT);
+	adc_fifo_setup(true, true, 1, false, false); /* every sample requests the DMA, no error bit, 12-bit samples */
+	adc_set_clkdiv(LIGHT_SENSOR_ADC_CLKDIV);
+
+	/* The DMA moves every sample into a ring buffer - no interrupt, the CPU never touches the sampling */
+	LightDmaChannel = (uint32_t)dma_claim_unused_channel(true);
+	dma_channel_config config = dma_channel_get_default_config(LightDmaChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+	channel_config_set_read_increment(&config, false);
+	channel_config_set_write_increment(&config, true);
+	channel_config_set_ring(&config, true, LIGHT_SENSOR_BUFFER_RING_BITS);
+	channel_config_set_dreq(&config, DREQ_ADC);
+	dma_channel_configure(LightDmaChannel, &config, LightSamples, &adc_hw->fifo, UINT32_MAX, true);
+
+	adc_run(true);
+#endif
+}
+
+#if (POWER_MONITOR_ENABLED == 1)
+/* Called by the conversions of the supply monitor (interrupt context) every LIGHT_SENSOR_SAMPLE_PERIOD_IN_US - into the ring
+   in place of the DMA */
+void LightSensor_Sample(uint16_t sample)
+{
+	LightSamples[LightSampleIndex] = sample;
+	LightSampleIndex = (LightSampleIndex + 1U) % LIGHT_SENSOR_BUFFER_SAMPLES;
+}
+#endif
+
+/* Called by the FreeRTOS tick interrupt (vApplicationTickHook) - the filter runs in an interrupt that wakes the core anyway,
+   the tasks are only woken when the light level changes */
+void LightSensor_TickHook(void)
+{
+	if(++LightTickCounter < LIGHT_SENSOR_FILTER_PERIOD_IN_TICKS)
+	{
+		return;
+	}
+	LightTickCounter = 0;
+
+#if (POWER_MONITOR_ENABLED == 0)
+	/* The transfer count only lasts ~68 days at this rate - restart it when it's used up */
+	if(!dma_channel_is_busy(LightDmaChannel))
+	{
+		dma_channel_set_trans_count(LightDmaChannel, UINT32_MAX, true);
+	}
+#endif
+
+	/* Mean of the ring (the last ~90ms of samples) as the filter input - it also averages out the mains flicker of artificial light */
+	uint32_t sum = 0;
+	for(uint32_t i = 0; i < LIGHT_SENSOR_BUFFER_SAMPLES; i++)
+	{
+		sum += LightSamples[i] & 0xFFFU;
+	}
+	int32_t input = (int32_t)(sum << (LIGHT_SENSOR_FRACTION_BITS - LIGHT_SENSOR_BUFFER_SAMPLES_BITS));
+
+	/* First order IIR low-pass in fixed point: y += (x - y) / 2^LIGHT_SENSOR_FILTER_SHIFT */
+	if(!LightFilterSeeded)
+	{
+		LightFilterState = input;
+		LightFilterSeeded = true;
+	}
+	LightFilterState += (input - LightFilterState) >> LIGHT_SENSOR_FILTER_SHIFT;
+	LightFiltered = (uint32_t)LightFilterState >> LIGHT_SENSOR_FRACTION_BITS;
+
+	LightLevel_t level = LightLevelWithHysteresis(LightLevel, LightFiltered);
+	if(level != LightLevel)
+	{
+		LightLevel = level;
+		LightLevelChanges++;
+
+		BaseType_t higherPriorityTaskWoken = pdFALSE;
+		(void)xSemaphoreGiveFromISR(LightLevelSemaphore, &higherPriorityTaskWoken);
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+#endif /* LIGHT_SENSOR_ENABLED */
@@ -0,0 +1,251 @@
+/* MotionSensor.c - source file for the OS Task which watches the vibration of the gear case (MPU6050 accelerometer) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+
+/* Include files from other tasks */
+#include "MotionSensor.h"
+#include "ElectronicBlinds_Main.h"
+#include "MotorControllerTask.h"
+#include "ButtonTask.h"
+#include "Watchdog.h"
+
+#if (MOTION_SENSOR_ENABLED == 1)
+
+_Static_assert(BLINDS_NUM_OF_CHANNELS == 1U, "The I2C1 pins of the motion sensor are used by the limit switches of channel 1");
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MOTION_I2C							(i2c1)
+#define MOTION_FIFO_MAX_SAMPLES				(MPU6050_FIFO_SIZE / MPU6050_FIFO_SAMPLE_SIZE)
+
+_Static_assert(((1000U / (1U + MOTION_SENSOR_SAMPLE_RATE_DIVIDER)) * MOTION_SENSOR_TASK_PERIOD / 1000U) < MOTION_FIFO_MAX_SAMPLES,
+			   "The FIFO has to hold the samples of one task period");
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+MotionStats_t MotionStats = { .minEnergyMotorOn = UINT32_MAX };
+volatile bool MotionJamDetected;
+volatile bool MotionUnexpectedMovement;
+
+/* One burst read empties the FIFO - static, the task stack is only configMINIMAL_STACK_SIZE */
+static uint8_t FifoBuffer[MOTION_FIFO_MAX_SAMPLES * MPU6050_FIFO_SAMPLE_SIZE];
+static int32_t AxisMean[3];	/* DC of every axis, Q15.8 */
+static bool AxisMeanSeeded;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+bool MotionWriteRegister(uint8_t reg, uint8_t value);
+bool MotionReadRegisters(uint8_t reg, uint8_t *data, uint32_t length);
+bool MotionSensor_Init(void);
+uint32_t MotionAccumulateSamples(const uint8_t *data, uint32_t samples);
+bool MotionDrainFifo(uint32_t *energy);
+void MotionEvaluate(bool motorOn, uint32_t energy);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+bool MotionWriteRegister(uint8_t reg, uint8_t value)
+{
+	uint8_t frame[2] = { reg, value };
+
+	MotionStats.i2cTransactions++;
+	bool ok = (i2c_write_timeout_us(MOTION_I2C, MPU6050_I2C_ADDRESS, frame, sizeof(frame), false, MOTION_SENSOR_I2C_TIMEOUT_IN_US) == (int)sizeof(frame));
+	if(!ok) MotionStats.i2cErrors++;
+	return ok;
+}
+
+/* Register address write and a repeated start read - the registers auto-increment, FIFO_R_W pops the FIFO instead */
+bool MotionReadRegisters(uint8_t reg, uint8_t *data, uint32_t length)
+{
+	MotionStats.i2cTransactions++;
+	bool ok = (i2c_write_timeout_us(MOTION_I2C, MPU6050_I2C_ADDRESS, &reg, 1U, true, MOTION_SENSOR_I2C_TIMEOUT_IN_US) == 1) &&
+			  (i2c_read_timeout_us(MOTION_I2C, MPU6050_I2C_ADDRESS, data, length, false, MOTION_SENSOR_I2C_TIMEOUT_IN_US) == (int)length);
+	if(!ok) MotionStats.i2cErrors++;
+	return ok;
+}
+
+bool MotionSensor_Init(void)
+{
+	uint8_t whoAmI = 0;
+
+	i2c_init(MOTION_I2C, MOTION_SENSOR_I2C_BAUDRATE);
+	gpio_set_function(MOTION_SENSOR_SDA_GPIO, GPIO_FUNC_I2C);
+	gpio_set_function(MOTION_SENSOR_SCL_GPIO, GPIO_FUNC_I2C);
+	gpio_pull_up(MOTION_SENSOR_SDA_GPIO);
+	gpio_pull_up(MOTION_SENSOR_SCL_GPIO);
+
+	if(!MotionReadRegisters(MPU6050_REG_WHO_AM_I, &whoAmI, 1U) || (whoAmI != MPU6050_WHO_AM_I_VALUE))
+	{
+		LOG("MPU6050 not found\n");
+		return false;
+	}
+
+	/* Reset, then wake up on the internal oscillator with the gyroscope in standby */
+	(void)MotionWriteRegister(MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_DEVICE_RESET);
+	vTaskDelay(pdMS_TO_TICKS(100));
+
+	return MotionWriteRegister(MPU6050_REG_PWR_MGMT_1, 0x00U) &&
+		   MotionWriteRegister(MPU6050_REG_PWR_MGMT_2, MPU6050_PWR_MGMT_2_STBY_GYRO) &&
+		   MotionWriteRegister(MPU6050_REG_CONFIG, MPU6050_CONFIG_DLPF_184HZ) &&
+		   MotionWriteRegister(MPU6050_REG_SMPLRT_DIV, MOTION_SENSOR_SAMPLE_RATE_DIVIDER) &&
+		   MotionWriteRegister(MPU6050_REG_ACCEL_CONFIG, 0x00U) && /* +-2g */
+		   MotionWriteRegister(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET) &&
+		   MotionWriteRegister(MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_ACCEL) &&
+		   MotionWriteRegister(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+}
+
+/* Sum of the squared deviations from the DC of every axis, in (1/1024 g)^2 */
+uint32_t MotionAccumulateSamples(const uint8_t *data, uint32_t samples)
+{
+	uint32_t sum = 0;
+
+	for(uint32_t i = 0; i < samples; i++)
+	{
+		for(uint32_t axis = 0; axis < 3U; axis++)
+		{
+			/* Big endian, the high byte first */
+			int32_t value = (int32_t)(int16_t)(((uint16_t)data[0] << 8) | data[1]) * (1 << MOTION_DC_FRACTION_BITS);
+			data += 2;
+
+			if(!AxisMeanSeeded) AxisMean[axis] = value;
+			AxisMean[axis] += (value - AxisMean[axis]) >> MOTION_DC_FILTER_SHIFT;
+
+			int32_t deviation = (value - AxisMean[axis]) >> (MOTION_DC_FRACTION_BITS + MOTION_VIBRATION_SHIFT);
+			if(deviation > MOTION_VIBRATION_LIMIT) deviation = MOTION_VIBRATION_LIMIT;
+			if(deviation < -MOTION_VIBRATION_LIMIT) deviation = -MOTION_VIBRATION_LIMIT;
+			sum += (uint32_t)(deviation * deviation);
+		}
+		AxisMeanSeeded = true;
+	}
+	return sum;
+}
+
+/* Reads everything the FIFO collected since the last drain - one access for the count, one burst for the samples.
+   Returns false when there was nothing to evaluate */
+bool MotionDrainFifo(uint32_t *energy)
+{
+	uint8_t count[2];
+
+	MotionStats.drains++;
+	if(!MotionReadRegisters(MPU6050_REG_FIFO_COUNTH, count, sizeof(count)))
+	{
+		return false;
+	}
+
+	uint32_t bytes = ((uint32_t)count[0] << 8) | count[1];
+	if(bytes >= MPU6050_FIFO_SIZE)
+	{
+		/* Full - the oldest samples were overwritten and the sample boundary is lost, start over */
+		MotionStats.overflows++;
+		AxisMeanSeeded = false;
+		(void)MotionWriteRegister(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN | MPU6050_USER_CTRL_FIFO_RESET);
+		return false;
+	}
+
+	/* Whole samples only - a partially written one stays in the FIFO for the next drain */
+	uint32_t samples = bytes / MPU6050_FIFO_SAMPLE_SIZE;
+	if((samples == 0U) || !MotionReadRegisters(MPU6050_REG_FIFO_R_W, FifoBuffer, samples * MPU6050_FIFO_SAMPLE_SIZE))
+	{
+		return false;
+	}
+
+	MotionStats.samples += samples;
+	*energy = MotionAccumulateSamples(FifoBuffer, samples) / samples;
+	return true;
+}
+
+void MotionEvaluate(bool motorOn, uint32_t energy)
+{
+	static bool lastMotorOn;
+	static uint32_t settleWindows, suspectWindows;
+
+	/* The window around a start/stop mixes both states - skip it */
+	if(motorOn != lastMotorOn)
+	{
+		lastMotorOn = motorOn;
+		settleWindows = MOTION_SETTLE_WINDOWS;
+		suspectWindows = 0;
+		MotionUnexpectedMovement = false;
+	}
+	if(settleWindows > 0U)
+	{
+		settleWindows--;
+		return;
+	}
+
+	if(motorOn)
+	{
+		if(energy < MotionStats.minEnergyMotorOn) MotionStats.minEnergyMotorOn = energy;
+
+		/* Motor on and the gear case still - stalled motor, blind stuck, broken coupling */
+		suspectWindows = (energy < MOTION_ENERGY_STILL_THRESHOLD) ? suspectWindows + 1U : 0U;
+		if((suspectWindows >= MOTION_CONFIRM_WINDOWS) && !MotionJamDetected)
+		{
+			LOG("motor jammed, energy %lu\n", (unsigned long)energy);
+			MotionStats.jams++;
+			MotionJamDetected = true;
+			/* MotorControllerTask stops the motor - the source that drove it has to release the channel to start it again */
+			(void)xSemaphoreGive(ButtonSemaphore);
+		}
+	}
+	else
+	{
+		if(energy > MotionStats.maxEnergyMotorOff) MotionStats.maxEnergyMotorOff = energy;
+
+		/* Motor off and the gear case shaking - blind pulled by hand, brake slipping */
+		suspectWindows = (energy > MOTION_ENERGY_MOVING_THRESHOLD) ? suspectWindows + 1U : 0U;
+		if((suspectWindows >= MOTION_CONFIRM_WINDOWS) && !MotionUnexpectedMovement)
+		{
+			LOG("blind moving with the motor off, energy %lu\n", (unsigned long)energy);
+			MotionStats.unexpectedMoves++;
+			MotionUnexpectedMovement = true;
+		}
+		else if(suspectWindows == 0U)
+		{
+			MotionUnexpectedMovement = false;
+		}
+	}
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* TASK MAIN FUNCTION */
+void MotionSensorTask( void *pvParameters )
+{
+	/* The sensor samples into its FIFO on its own, the task only drains it once per period */
+	Watchdog_CheckIn(WATCHDOG_CLIENT_MOTION_SENSOR);
+	bool sensorPresent = MotionSensor_Init();
+
+	/* Set up task schedule */
+	TickType_t xTaskStartTime;
+	const TickType_t xTaskPeriod = pdMS_TO_TICKS(MOTION_SENSOR_TASK_PERIOD);
+	xTaskStartTime = xTaskGetTickCount();
+
+	/* Infinite task loop */
+	for( ;; )
+	{
+		Watchdog_CheckIn(WATCHDOG_CLIENT_MOTION_SENSOR);
+		uint32_t energy;
+		if(sensorPresent && MotionDrainFifo(&energy))
+		{
+			MotionStats.lastEnergy = energy;
+			MotionEvaluate(CurrentState[MOTION_SENSOR_CHANNEL] != STATE_OFF, energy);
+		}
+
+		/* Delay until next cycle of the task */
+		vTaskDelayUntil(&xTaskStartTime, xTaskPeriod);
+	}
+}
+
+#endif /* MOTION_SENSOR_ENABLED */
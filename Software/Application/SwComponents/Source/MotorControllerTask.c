@@ -1,9 +1,19 @@
-/* MotorControllerTask.c - source file for the OS Task which handles the state of the Motor Controller */
+/* MotorControllerTask.c - source file for the OS Task which handles the state of the Motor Controller
+
+   It is also the motor command broker - the limit switches, the buttons, the USB link and AutomaticControlTask submit
+   commands with their priority (MotorPriority_t) and the broker is the only one to drive the H-bridge outputs. Every
+   channel is owned by one command at a time: a command of a lower priority than the owner is dropped, a higher one takes
+   over (the owner is preempted) and the same command again is coalesced. Stops and the safety commands are applied right
+   away in the context of the caller, the other starts by the task - staggered, and dropped if that misses their deadline.
+   A timed move (the partial positions of the glare control) is stopped by the task once it ran for its time, a position move
+   (ENCODER_ENABLED) is stopped by the task from the encoder count - sampled every MOTOR_POSITION_PERIOD while it runs */
 
 /*---------------- INCLUDES ----------------------*/
 
 /* Standard includes. */
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 /* Kernel includes. */
 #include "FreeRTOS.h"
@@ -15,64 +25,560 @@
 #include "pico/binary_info.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
 
 /* Include files from other tasks */
 #include "ElectronicBlinds_Main.h"
 #include "MotorControllerTask.h"
 #include "ButtonTask.h"
+#include "Channels.h"
+#include "CycleCounter.h"
+#include "MotionSensor.h"
+#include "Watchdog.h"
+#include "UsbLink.h"
+#include "Trace.h"
+#include "Encoder.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MOTOR_POSITION_SETTLE_SAMPLES		(10U)		/* samples without a count after the brake - the blind stands */
+#define MOTOR_POSITION_MIN_LEARN_SPEED		(20)		/* counts/s at the brake - slower, the overrun says nothing */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    POSITION_IDLE,
+    POSITION_MOVING,                /* towards the target - braked once it is closer than the overrun */
+    POSITION_BRAKING                /* braked - waits for the blind to stand, then corrects or ends */
+} MotorPositionPhase_t;
+
+/* The position move of the channel with the encoder - only the task changes it, under MotorCommandLock */
+typedef struct
+{
+    MotorPositionPhase_t phase;
+    MotorPriority_t priority;
+    uint32_t deadline_us;           /* of the starts of its corrections */
+    uint32_t sequence;              /* of its last command - another one ends the move */
+    int32_t target;
+    int32_t lastCount;
+    uint32_t lastSample_us;
+    uint32_t lastMove_us;           /* when the count last changed */
+    uint32_t started_us;
+    int32_t speed;                  /* counts/s towards the target */
+    int32_t brakeCount;
+    int32_t brakeSpeed;
+    bool brakeDown;
+    uint32_t stillSamples;
+    uint32_t corrections;
+} MotorPosition_t;
 
 /*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
 
-MotorState_t CurrentState = STATE_OFF;
+MotorState_t CurrentState[BLINDS_NUM_OF_CHANNELS];
+MotorCommand_t MotorCommands[BLINDS_NUM_OF_CHANNELS];
+MotorCommandStats_t MotorCommandStats;
+uint32_t LastMotorStart_us, LastMotorStartChannel;
+uint32_t MotorStarts, MotorStartsDeferred;
+uint32_t MotorChannelStarts[BLINDS_NUM_OF_CHANNELS];
+MotorPositionStats_t MotorPositionStats = { .overrun_us = { MOTOR_POSITION_OVERRUN_IN_US, MOTOR_POSITION_OVERRUN_IN_US } };
+
+/* Commands come from both cores and from the interrupt handlers */
+static spin_lock_t *MotorCommandLock;
+/* Per channel and source - the command a source lost to a higher priority. The same command again is dropped until the source
+   releases the channel (or asks for another direction), so a button still held after a limit switch or a jam stop doesn't restart the motor */
+static MotorState_t MotorPreempted[BLINDS_NUM_OF_CHANNELS][MOTOR_NUM_OF_PRIORITIES];
+#if (ENCODER_ENABLED == 1)
+static MotorPosition_t MotorPosition;
+#endif
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void stateMachine(uint32_t channel, MotorState_t state);
+void stateOFF(uint32_t channel);
+void stateAnticlockwise(uint32_t channel);
+void stateClockwise(uint32_t channel);
+void setMotorOutputs(uint32_t channel, MotorState_t state, bool motorControl1, bool motorControl2);
+void MotorCommandApply(uint32_t channel);
+bool MotorStartHeldBack(uint32_t channel);
+bool MotorCommandSubmitLocked(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us, uint32_t run_us, bool *wakeTask);
+void MotorCommandReleaseLocked(uint32_t channel, MotorPriority_t priority);
+void MotorPositionControl(void);
+void MotorPositionMoving(MotorPosition_t *position, int32_t count, uint32_t now);
+void MotorPositionBraking(MotorPosition_t *position, int32_t count, uint32_t now);
+int32_t MotorPositionTolerance(void);
 
 /*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
 
 /* State machine function */
-void stateMachine(MotorState_t state) 
+void HOT_PATH_FUNC(stateMachine)(uint32_t channel, MotorState_t state)
 {
-    CurrentState = state;
-
     switch (state) 
     {
         case STATE_OFF:
-            stateOFF();
+            stateOFF(channel);
             break;
         case STATE_ANTICLOCKWISE:
-            stateAnticlockwise();
+            stateAnticlockwise(channel);
             break;
         case STATE_CLOCKWISE:
-            stateClockwise();
+            stateClockwise(channel);
             break;
         default:
             LOG("Invalid state!\n");
     }
 }
 
+/* State functions: */
+void HOT_PATH_FUNC(stateOFF)(uint32_t channel)
+{
+    LOG("OFF %lu\n", (unsigned long)channel);
+    setMotorOutputs(channel, STATE_OFF, 0, 0);
+}
+
+void HOT_PATH_FUNC(stateAnticlockwise)(uint32_t channel)
+{
+    LOG("anticlockwise %lu\n", (unsigned long)channel);
+    setMotorOutputs(channel, STATE_ANTICLOCKWISE, 0, 1);
+}
+
+void HOT_PATH_FUNC(stateClockwise)(uint32_t channel)
+{
+    LOG("clockwise %lu\n", (unsigned long)channel);
+    setMotorOutputs(channel, STATE_CLOCKWISE, 1, 0);
+}
+
+void HOT_PATH_FUNC(setMotorOutputs)(uint32_t channel, MotorState_t state, bool motorControl1, bool motorControl2)
+{
+    uint32_t motorControl1Mask = ChannelLookup.motorControl1Mask[channel];
+    uint32_t motorControl2Mask = ChannelLookup.motorControl2Mask[channel];
+
+    if((state != STATE_OFF) && (CurrentState[channel] != state))
+    {
+        /* Every start (or reversal) draws the inrush current - remembered for the staggering of the starts */
+        LastMotorStart_us = timer_hw->timerawl;
+        LastMotorStartChannel = channel;
+        MotorStarts++;
+        MotorChannelStarts[channel]++;
+    }
+    CurrentState[channel] = state;
+
+    /* Both H-bridge inputs change in one write - never both high in between when reversing */
+    gpio_put_masked(motorControl1Mask | motorControl2Mask, (motorControl1 ? motorControl1Mask : 0UL) | (motorControl2 ? motorControl2Mask : 0UL));
+    TRACE_MOTOR_OUTPUTS(channel, motorControl1, motorControl2);
+
+    /* LED shows that any of the motors is running */
+    bool anyRunning = false;
+    for(uint32_t i = 0; i < BLINDS_NUM_OF_CHANNELS; i++)
+    {
+        anyRunning = anyRunning || (CurrentState[i] != STATE_OFF);
+    }
+    gpio_put(PICO_DEFAULT_LED_PIN, anyRunning);
+}
+
+/* Called with MotorCommandLock held - drives the outputs to the command that owns the channel */
+void HOT_PATH_FUNC(MotorCommandApply)(uint32_t channel)
+{
+    MotorCommand_t *command = &MotorCommands[channel];
+
+    command->pending = false;
+    command->started_us = timer_hw->timerawl;
+    MotorCommandStats.applied++;
+    if(CurrentState[channel] != command->state)
+    {
+        stateMachine(channel, command->state);
+    }
+}
+
+/* Starting waits until the inrush of the previous start of another motor is over */
+bool MotorStartHeldBack(uint32_t channel)
+{
+    return (MotorStarts > 0U) && (LastMotorStartChannel != channel) && ((timer_hw->timerawl - LastMotorStart_us) < MOTOR_START_STAGGER_IN_US);
+}
+
+/* Called with MotorCommandLock held - the broker itself, see MotorCommand_SubmitTimed. wakeTask is set if the task has to apply it */
+bool HOT_PATH_FUNC(MotorCommandSubmitLocked)(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us, uint32_t run_us, bool *wakeTask)
+{
+    MotorCommand_t *command = &MotorCommands[channel];
+    bool accepted = true;
+
+    MotorCommandStats.submitted++;
+    if((priority < command->priority) || ((state != STATE_OFF) && (MotorPreempted[channel][priority] == state)))
+    {
+        MotorCommandStats.dropped++;
+        accepted = false;
+    }
+    else if((priority == command->priority) && (state == command->state))
+    {
+        MotorCommandStats.coalesced++;
+        command->sequence++;
+        command->run_us = run_us;
+        command->started_us = timer_hw->timerawl;
+    }
+    else
+    {
+        if((command->priority != MOTOR_PRIORITY_NONE) && (priority > command->priority))
+        {
+            MotorCommandStats.preempted++;
+            MotorPreempted[channel][command->priority] = command->state;
+        }
+        MotorPreempted[channel][priority] = STATE_OFF;
+        command->state = state;
+        command->priority = priority;
+        command->deadline_us = timer_hw->timerawl + deadline_us;
+        command->run_us = run_us;
+        command->pending = true;
+        command->sequence++;
+
+        /* Stopping is immediate, so is the reversal by a limit switch - waiting for the task would only drive the blinds further into it */
+        if((state == STATE_OFF) || (priority == MOTOR_PRIORITY_SAFETY))
+        {
+            MotorCommandApply(channel);
+        }
+        else
+        {
+            *wakeTask = true;
+        }
+    }
+    return accepted;
+}
+
+/* Called with MotorCommandLock held - see MotorCommand_Release */
+void HOT_PATH_FUNC(MotorCommandReleaseLocked)(uint32_t channel, MotorPriority_t priority)
+{
+    MotorCommand_t *command = &MotorCommands[channel];
+
+    MotorPreempted[channel][priority] = STATE_OFF;
+    if(command->priority == priority)
+    {
+        command->state = STATE_OFF;
+        command->priority = MOTOR_PRIORITY_NONE;
+        command->pending = false;
+        if(CurrentState[channel] != STATE_OFF)
+        {
+            stateOFF(channel);
+        }
+    }
+}
+
+#if (ENCODER_ENABLED == 1)
+/* The counts between the switches that count as "there" - at least one */
+int32_t MotorPositionTolerance(void)
+{
+    int32_t tolerance = (int32_t)((float)abs(EncoderState.bottomCount - EncoderState.topCount) * MOTOR_POSITION_TOLERANCE);
+    return (tolerance > 0) ? tolerance : 1;
+}
+
+/* A sample of the move towards the target - braked once the travel left is what the blind overruns at the speed it runs
+   (the overrun learned at the last stops, plus the travel of one sample period the brake may come late by) */
+void HOT_PATH_FUNC(MotorPositionMoving)(MotorPosition_t *position, int32_t count, uint32_t now)
+{
+    bool down = (CurrentState[ENCODER_CHANNEL] == STATE_CLOCKWISE);
+    int32_t remaining = Encoder_Travel(count, position->target);
+    int32_t moved = Encoder_Travel(position->lastCount, count);
+    uint32_t dt_us = now - position->lastSample_us;
+    bool wakeTask = false;
+
+    if(!down)
+    {
+        remaining = -remaining;
+        moved = -moved;
+    }
+    if(dt_us > 0U)
+    {
+        position->speed = (int32_t)(((int64_t)moved * 1000000) / (int64_t)dt_us);
+    }
+    if(moved != 0)
+    {
+        position->lastMove_us = now;
+    }
+    position->lastCount = count;
+    position->lastSample_us = now;
+
+    if((now - position->lastMove_us) >= MOTOR_POSITION_STALL_IN_US)
+    {
+        /* Driven but not turning - the move ends here, the source is told by the release */
+        MotorPositionStats.stalls++;
+        MotorCommandReleaseLocked(ENCODER_CHANNEL, position->priority);
+        position->phase = POSITION_IDLE;
+        return;
+    }
+
+    int64_t stopping = ((int64_t)position->speed * (int64_t)(MotorPositionStats.overrun_us[down] + (MOTOR_POSITION_PERIOD * 1000U))) / 1000000;
+    if(remaining <= stopping)
+    {
+        (void)MotorCommandSubmitLocked(ENCODER_CHANNEL, STATE_OFF, position->priority, 0U, 0U, &wakeTask);
+        position->sequence = MotorCommands[ENCODER_CHANNEL].sequence;
+        position->phase = POSITION_BRAKING;
+        position->brakeCount = count;
+        position->brakeSpeed = position->speed;
+        position->brakeDown = down;
+        position->stillSamples = 0U;
+    }
+}
+
+/* A sample after the brake - once the blind stands the overrun is learned and the move ends, or is corrected */
+void HOT_PATH_FUNC(MotorPositionBraking)(MotorPosition_t *position, int32_t count, uint32_t now)
+{
+    MotorCommand_t *command = &MotorCommands[ENCODER_CHANNEL];
+    bool wakeTask = false;
+
+    if(count != position->lastCount)
+    {
+        position->lastCount = count;
+        position->stillSamples = 0U;
+        return;
+    }
+    if(++position->stillSamples < MOTOR_POSITION_SETTLE_SAMPLES)
+    {
+        return;
+    }
+
+    int32_t overrun = Encoder_Travel(position->brakeCount, count);
+    if(!position->brakeDown) overrun = -overrun;
+    if((position->brakeSpeed >= MOTOR_POSITION_MIN_LEARN_SPEED) && (overrun >= 0))
+    {
+        uint32_t *learned = &MotorPositionStats.overrun_us[position->brakeDown];
+        uint32_t overrun_us = (uint32_t)(((int64_t)overrun * 1000000) / position->brakeSpeed);
+        *learned = ((*learned * 3U) + overrun_us) / 4U;
+    }
+
+    int32_t error = Encoder_Travel(position->target, count);
+    int32_t tolerance = MotorPositionTolerance();
+    MotorPositionStats.lastError = error;
+    if(((error <= tolerance) && (error >= -tolerance)) || (position->corrections >= MOTOR_POSITION_MAX_CORRECTIONS))
+    {
+        if((error <= tolerance) && (error >= -tolerance)) MotorPositionStats.moves++;
+        else MotorPositionStats.missed++;
+        MotorPositionStats.lastDuration_us = now - position->started_us;
+        MotorCommandReleaseLocked(ENCODER_CHANNEL, position->priority);
+        position->phase = POSITION_IDLE;
+        return;
+    }
+
+    /* Stopped short or overran - moved again from here, the task applies it right after this */
+    position->corrections++;
+    MotorPositionStats.corrections++;
+    if(MotorCommandSubmitLocked(ENCODER_CHANNEL, (error < 0) ? STATE_CLOCKWISE : STATE_ANTICLOCKWISE, position->priority, position->deadline_us, 0U, &wakeTask))
+    {
+        position->sequence = command->sequence;
+        position->phase = POSITION_MOVING;
+        position->lastSample_us = now;
+        position->lastMove_us = now;
+    }
+    else
+    {
+        position->phase = POSITION_IDLE;
+    }
+}
+
+/* Called by the task before it applies the pending starts - one sample of the position move, if one runs */
+void HOT_PATH_FUNC(MotorPositionControl)(void)
+{
+    MotorPosition_t *position = &MotorPosition;
+    MotorCommand_t *command = &MotorCommands[ENCODER_CHANNEL];
+    int32_t count = Encoder_Read();
+    uint32_t now = timer_hw->timerawl;
+
+    uint32_t save = spin_lock_blocking(MotorCommandLock);
+    if(position->phase == POSITION_IDLE)
+    {
+        /* Nothing to do */
+    }
+    else if((command->sequence != position->sequence) || (command->priority != position->priority))
+    {
+        /* Another command replaced the last one of the move, or the channel was released (or the start expired) */
+        MotorPositionStats.aborted++;
+        position->phase = POSITION_IDLE;
+    }
+    else if(command->pending)
+    {
+        /* Not started yet - the stagger */
+        position->lastCount = count;
+        position->lastSample_us = now;
+        position->lastMove_us = now;
+    }
+    else if(position->phase == POSITION_MOVING)
+    {
+        MotorPositionMoving(position, count, now);
+    }
+    else
+    {
+        MotorPositionBraking(position, count, now);
+    }
+    spin_unlock(MotorCommandLock, save);
+}
+#endif /* ENCODER_ENABLED */
+
 /*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
 
-/* State functions: */
-void stateOFF(void) 
+/* Called before anything can submit a command */
+void MotorCommand_Init(void)
+{
+    MotorCommandLock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+}
+
+/* Submits a command of a source - false if it was dropped. Stops and the safety commands are applied before this returns,
+   a start of the other sources within deadline_us (the start stagger) or it is dropped. The source keeps the channel until
+   it releases it or a higher priority takes it over - a stop (STATE_OFF) keeps the motor off as long as it owns the channel */
+bool HOT_PATH_FUNC(MotorCommand_Submit)(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us)
+{
+    return MotorCommand_SubmitTimed(channel, state, priority, deadline_us, 0U);
+}
+
+/* The same with the move stopped after run_us of running (0 - until a limit switch). The same command again runs for
+   run_us from now on */
+bool HOT_PATH_FUNC(MotorCommand_SubmitTimed)(uint32_t channel, MotorState_t state, MotorPriority_t priority, uint32_t deadline_us, uint32_t run_us)
+{
+    bool wakeTask = false;
+
+    uint32_t save = spin_lock_blocking(MotorCommandLock);
+    bool accepted = MotorCommandSubmitLocked(channel, state, priority, deadline_us, run_us, &wakeTask);
+    spin_unlock(MotorCommandLock, save);
+
+    if(wakeTask)
+    {
+        /* Binary semaphore - if it's already given, MotorControllerTask picks this command up in the same run */
+        (void)xSemaphoreGive(ButtonSemaphore);
+    }
+    return accepted;
+}
+
+/* A move to a position (0 - top switch, 1 - bottom switch) by the encoder count - false if it was dropped, or the channel has
+   no encoder that counted the travel between the switches yet. The source owns the channel until the move ends (then it is
+   released like by the source itself), the same as for its other commands */
+bool MotorCommand_SubmitPosition(uint32_t channel, float position, MotorPriority_t priority, uint32_t deadline_us)
+{
+#if (ENCODER_ENABLED == 1)
+    if((channel != ENCODER_CHANNEL) || !Encoder_Calibrated())
+    {
+        return false;
+    }
+
+    int32_t target = Encoder_CountAt(position);
+    int32_t count = Encoder_Read();
+    int32_t travel = Encoder_Travel(count, target);
+    int32_t tolerance = MotorPositionTolerance();
+    bool wakeTask = false;
+    if((travel <= tolerance) && (travel >= -tolerance))
+    {
+        return true;
+    }
+
+    uint32_t save = spin_lock_blocking(MotorCommandLock);
+    bool accepted = MotorCommandSubmitLocked(channel, (travel > 0) ? STATE_CLOCKWISE : STATE_ANTICLOCKWISE, priority, deadline_us, 0U, &wakeTask);
+    if(accepted)
+    {
+        uint32_t now = timer_hw->timerawl;
+        if(MotorPosition.phase != POSITION_IDLE)
+        {
+            MotorPositionStats.aborted++;
+        }
+        MotorPosition = (MotorPosition_t){ .phase = POSITION_MOVING, .priority = priority, .deadline_us = deadline_us,
+                                           .sequence = MotorCommands[channel].sequence, .target = target, .lastCount = count,
+                                           .lastSample_us = now, .lastMove_us = now, .started_us = now };
+    }
+    spin_unlock(MotorCommandLock, save);
+
+    if(wakeTask)
+    {
+        (void)xSemaphoreGive(ButtonSemaphore);
+    }
+    return accepted;
+#else
+    (void)channel; (void)position; (void)priority; (void)deadline_us;
+    return false;
+#endif
+}
+
+/* The source gives the channel up - the motor stops if the source still owned it */
+void HOT_PATH_FUNC(MotorCommand_Release)(uint32_t channel, MotorPriority_t priority)
+{
+    uint32_t save = spin_lock_blocking(MotorCommandLock);
+    MotorCommandReleaseLocked(channel, priority);
+    spin_unlock(MotorCommandLock, save);
+}
+
+/* USB link MOTOR command - channel, MotorState_t. A move runs until the limit switch, STATE_OFF releases the channel */
+void MotorCommand_Remote(const uint8_t *payload, uint32_t length)
+{
+    if((length != 2U) || (payload[0] >= BLINDS_NUM_OF_CHANNELS) || (payload[1] > (uint8_t)STATE_ANTICLOCKWISE))
+    {
+        UsbLink_Respond("ERR length 0");
+        return;
+    }
+
+    if(payload[1] == (uint8_t)STATE_OFF)
+    {
+        MotorCommand_Release(payload[0], MOTOR_PRIORITY_REMOTE);
+        UsbLink_Respond("ACK 0");
+    }
+    else if(MotorCommand_Submit(payload[0], (MotorState_t)payload[1], MOTOR_PRIORITY_REMOTE, MOTOR_DEADLINE_REMOTE_IN_US))
+    {
+        UsbLink_Respond("ACK 0");
+    }
+    else
+    {
+        UsbLink_Respond("ERR dropped 0");
+    }
+}
+
+/* USB link MOTOR_INFO command - the counters of the broker */
+void MotorCommand_Info(void)
 {
-    LOG("OFF\n");
-    gpio_put(PICO_DEFAULT_LED_PIN, 0);
-    gpio_put(MOTOR_CONTROL_1, 0);
-    gpio_put(MOTOR_CONTROL_2, 0);
+    UsbLink_Respond("MOTOR %lu %lu %lu %lu %lu %lu", (unsigned long)MotorCommandStats.submitted, (unsigned long)MotorCommandStats.applied,
+                    (unsigned long)MotorCommandStats.coalesced, (unsigned long)MotorCommandStats.preempted,
+                    (unsigned long)MotorCommandStats.dropped, (unsigned long)MotorCommandStats.expired);
 }
 
-void stateAnticlockwise(void) 
+#if (ENCODER_ENABLED == 1)
+/* USB link POSITION command - channel, position in 1/1000 of the travel from the top switch (16 bits, little endian) */
+void MotorCommand_RemotePosition(const uint8_t *payload, uint32_t length)
 {
-    LOG("anticlockwise.\n");
-    gpio_put(PICO_DEFAULT_LED_PIN, 1);
-    gpio_put(MOTOR_CONTROL_1, 0);
-    gpio_put(MOTOR_CONTROL_2, 1);
+    if((length != 3U) || (payload[0] >= BLINDS_NUM_OF_CHANNELS))
+    {
+        UsbLink_Respond("ERR length 0");
+        return;
+    }
+
+    uint32_t permille = (uint32_t)payload[1] | ((uint32_t)payload[2] << 8);
+    if((permille > 1000U) || (payload[0] != ENCODER_CHANNEL) || !Encoder_Calibrated())
+    {
+        UsbLink_Respond("ERR position 0");
+    }
+    else if(MotorCommand_SubmitPosition(payload[0], (float)permille / 1000.0f, MOTOR_PRIORITY_REMOTE, MOTOR_DEADLINE_REMOTE_IN_US))
+    {
+        UsbLink_Respond("ACK 0");
+    }
+    else
+    {
+        UsbLink_Respond("ERR dropped 0");
+    }
 }
 
-void stateClockwise(void) 
+/* USB link POSITION_INFO command - the count now, where that is (-1 before the switches were seen) and the position moves */
+void MotorCommand_PositionInfo(void)
 {
-    LOG("clockwise\n");
-    gpio_put(PICO_DEFAULT_LED_PIN, 1);
-    gpio_put(MOTOR_CONTROL_1, 1);
-    gpio_put(MOTOR_CONTROL_2, 0);
+    int32_t count = Encoder_Read();
+    long permille = Encoder_Calibrated() ? lroundf(Encoder_PositionAt(count) * 1000.0f) : -1L;
+
+    UsbLink_Respond("POSITION %ld %ld %lu %lu %lu %lu %lu %ld %lu %lu %lu", (long)count, permille,
+                    (unsigned long)MotorPositionStats.moves, (unsigned long)MotorPositionStats.missed,
+                    (unsigned long)MotorPositionStats.corrections, (unsigned long)MotorPositionStats.aborted,
+                    (unsigned long)MotorPositionStats.stalls, (long)MotorPositionStats.lastError,
+                    (unsigned long)MotorPositionStats.lastDuration_us, (unsigned long)MotorPositionStats.overrun_us[1],
+                    (unsigned long)MotorPositionStats.overrun_us[0]);
+}
+
+#endif /* ENCODER_ENABLED */
+
+/* The H-bridge safe state, whatever the commands are - no lock, used by the watchdog when a task may hold it */
+void HOT_PATH_FUNC(MotorOutputsOff)(void)
+{
+    gpio_put_masked(ChannelLookup.motorOutputsMask, 0U);
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        TRACE_MOTOR_OUTPUTS(channel, false, false);
+    }
 }
 
 /* TASK MAIN FUNCTION */
@@ -80,19 +586,83 @@ void MotorControllerTask( void *pvParameters )
 {
     /* Set up task schedule */
 	TickType_t xTaskStartTime;
-	const TickType_t xTaskPeriod = pdMS_TO_TICKS(BUTTON_TASK_PERIOD);
+	const TickType_t xTaskPeriod = pdMS_TO_TICKS(MOTOR_CONTROLLER_TASK_PERIOD);
 	xTaskStartTime = xTaskGetTickCount();
+    bool startDeferred = false, positioning = false;
 
 	/* Infinite task loop */
 	for( ;; )
 	{
-		/* Attempt to obtain the semaphore - if not available task is blocked for xBlockTime (second arg) */
-		BaseType_t SemaphoreObtained = xSemaphoreTake(ButtonSemaphore, portMAX_DELAY);
-        if((CurrentState != MotorState_Requested) && (SemaphoreObtained))
+		/* Attempt to obtain the semaphore - if not available task is blocked for xBlockTime (second arg).
+           A start still waiting for its slot is retried every period without waiting for a new command, so is a position move sampled.
+           The wait is limited so the task checks in with the watchdog while there are no commands */
+		if(!startDeferred && !positioning) (void)xSemaphoreTake(ButtonSemaphore, pdMS_TO_TICKS(MOTOR_CONTROLLER_TASK_PERIOD));
+		Watchdog_CheckIn(WATCHDOG_CLIENT_MOTOR_CONTROLLER);
+		CycleTimestamp_t jobStart = CycleCounter_TaskStart();
+
+#if (MOTION_SENSOR_ENABLED == 1)
+        /* A jammed motor is stopped like by a limit switch - the source that drove it has to release the channel before it
+           starts the motor again (a held button does so once released) */
+        if(MotionJamDetected)
         {
-            stateMachine(MotorState_Requested);
+            MotorCommand_Submit(MOTION_SENSOR_CHANNEL, STATE_OFF, MOTOR_PRIORITY_SAFETY, 0U);
+            MotorCommand_Release(MOTION_SENSOR_CHANNEL, MOTOR_PRIORITY_SAFETY);
+            MotionJamDetected = false;
         }
+#endif
+
+#if (ENCODER_ENABLED == 1)
+        MotorPositionControl();
+#endif
+
+        /* One pass over all the channels - the pending starts, in the order of the channels */
+        startDeferred = false;
+        for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+        {
+            MotorCommand_t *command = &MotorCommands[channel];
+
+            uint32_t save = spin_lock_blocking(MotorCommandLock);
+            if(command->pending)
+            {
+                if((int32_t)(timer_hw->timerawl - command->deadline_us) >= 0)
+                {
+                    /* Too late - the command is dropped and the channel stops */
+                    MotorCommandStats.expired++;
+                    command->state = STATE_OFF;
+                    command->priority = MOTOR_PRIORITY_NONE;
+                    command->pending = false;
+                    if(CurrentState[channel] != STATE_OFF) stateOFF(channel);
+                }
+                else if((CurrentState[channel] != command->state) && MotorStartHeldBack(channel))
+                {
+                    startDeferred = true;
+                    MotorStartsDeferred++;
+                }
+                else
+                {
+                    MotorCommandApply(channel);
+                }
+            }
+            else if((command->run_us != 0U) && (command->state != STATE_OFF) && ((timer_hw->timerawl - command->started_us) >= command->run_us))
+            {
+                /* A timed move ran for its time - the source gets the channel back like after its own release */
+                command->state = STATE_OFF;
+                command->priority = MOTOR_PRIORITY_NONE;
+                command->run_us = 0U;
+                if(CurrentState[channel] != STATE_OFF) stateOFF(channel);
+            }
+            spin_unlock(MotorCommandLock, save);
+        }
+
+        CycleCounter_TaskStop(CYCLES_TASK_MOTOR_CONTROLLER, jobStart);
+        TickType_t period = xTaskPeriod;
+#if (ENCODER_ENABLED == 1)
+        /* A position move is sampled at its own period - counted from its first run, not from the last run of the task */
+        if((MotorPosition.phase != POSITION_IDLE) && !positioning) xTaskStartTime = xTaskGetTickCount();
+        positioning = (MotorPosition.phase != POSITION_IDLE);
+        if(positioning) period = pdMS_TO_TICKS(MOTOR_POSITION_PERIOD);
+#endif
         /* Delay until next cycle of the task */
-		vTaskDelayUntil(&xTaskStartTime, xTaskPeriod);
+		vTaskDelayUntil(&xTaskStartTime, period);
 	}
 }
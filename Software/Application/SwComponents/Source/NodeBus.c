@@ -0,0 +1,456 @@
+/* NodeBus.c - multi-drop bus of the controllers on UART0 (RS-485 transceiver): addressed, group and broadcast frames */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+/* Include files from other tasks */
+#include "NodeBus.h"
+#include "MotorControllerTask.h"
+#include "Channels.h"
+#include "UsbLink.h"
+#include "Watchdog.h"
+#include "Hash.h"
+#include "SiteConfig.h"
+#include "ElectronicBlinds_Main.h"
+
+#if (NODE_BUS_ENABLED == 1)
+
+_Static_assert(BLINDS_NUM_OF_CHANNELS <= 2U, "The UART0 pins are the motor outputs of channel 3, the driver enable one of channel 2");
+
+#define NODE_BUS_UART						(uart0)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+	uint8_t address;						/* 0 - no ping pending */
+	uint8_t sequence;
+	uint8_t groups;
+	bool answered;
+	uint32_t sent_us;
+	uint32_t roundTrip_us;
+}NodeBusPing_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+NodeBusConfig_t NodeBusConfig;
+NodeBusStats_t NodeBusStats;
+
+/* Written by the DMA only - the ring has to be aligned to its size */
+static volatile uint8_t NodeBusRxRing[NODE_BUS_RX_RING_SIZE] __attribute__((aligned(NODE_BUS_RX_RING_SIZE)));
+static uint32_t NodeBusRxRead;
+static uint8_t NodeBusRxFrame[NODE_BUS_MAX_ENCODED];
+static uint32_t NodeBusRxFill;
+static bool NodeBusRxQuiet;							/* no byte since the previous poll */
+
+/* Encoded frames waiting for the bus - the DMA reads the one at the head */
+static uint8_t NodeBusTxQueue[NODE_BUS_TX_QUEUE_LENGTH][NODE_BUS_MAX_ENCODED];
+static uint32_t NodeBusTxLength[NODE_BUS_TX_QUEUE_LENGTH];
+static uint32_t NodeBusTxHead, NodeBusTxCount;
+static bool NodeBusTransmitting;
+static uint8_t NodeBusSequence;
+
+static uint32_t NodeBusRxDma, NodeBusTxDma;
+static spin_lock_t *NodeBusLock;
+static volatile NodeBusPing_t NodeBusPing;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+uint32_t NodeBusEncode(const uint8_t *frame, uint32_t length, uint8_t *encoded);
+uint32_t NodeBusDecode(const uint8_t *encoded, uint32_t length, uint8_t *frame);
+bool NodeBusAddressed(uint8_t destination);
+bool NodeBusQueue(uint8_t destination, uint8_t command, uint8_t sequence, const uint8_t *payload, uint32_t length);
+void NodeBusApplyMove(const uint8_t *payload, uint32_t length);
+void NodeBusDispatch(const uint8_t *frame, uint32_t length);
+void NodeBusReceive(void);
+void NodeBusTransmit(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* COBS - every 0x00 of the frame becomes the distance to the next one, the encoded frame ends with the delimiter. A frame is
+   shorter than the 254 bytes without a zero that would need an extra code byte */
+uint32_t NodeBusEncode(const uint8_t *frame, uint32_t length, uint8_t *encoded)
+{
+	uint32_t code = 0, out = 1;
+
+	for(uint32_t i = 0; i < length; i++)
+	{
+		if(frame[i] == 0x00U)
+		{
+			encoded[code] = (uint8_t)(out - code);
+			code = out++;
+		}
+		else
+		{
+			encoded[out++] = frame[i];
+		}
+	}
+	encoded[code] = (uint8_t)(out - code);
+	encoded[out++] = NODE_BUS_DELIMITER;
+	return out;
+}
+
+/* The frame without the delimiter - 0 if it is not valid COBS */
+uint32_t NodeBusDecode(const uint8_t *encoded, uint32_t length, uint8_t *frame)
+{
+	uint32_t in = 0, out = 0;
+
+	while(in < length)
+	{
+		uint32_t code = encoded[in++];
+		if((code == 0U) || ((in + code - 1U) > length))
+		{
+			return 0;
+		}
+		for(uint32_t i = 1; i < code; i++)
+		{
+			frame[out++] = encoded[in++];
+		}
+		if((code < 0xFFU) && (in < length))
+		{
+			frame[out++] = 0x00U;
+		}
+	}
+	return out;
+}
+
+bool NodeBusAddressed(uint8_t destination)
+{
+	if(destination == NODE_BUS_BROADCAST)
+	{
+		return true;
+	}
+	if((destination & NODE_BUS_GROUP_FLAG) != 0U)
+	{
+		return ((NodeBusConfig.groups >> (destination & (NODE_BUS_NUM_OF_GROUPS - 1U))) & 1U) != 0U;
+	}
+	return destination == NodeBusConfig.address;
+}
+
+/* Any task - the frame is encoded into the queue, NodeBusTask sends it once the bus is free */
+bool NodeBusQueue(uint8_t destination, uint8_t command, uint8_t sequence, const uint8_t *payload, uint32_t length)
+{
+	uint8_t frame[NODE_BUS_MAX_FRAME];
+	bool queued = false;
+
+	frame[0] = destination;
+	frame[1] = NodeBusConfig.address;
+	frame[2] = command;
+	frame[3] = sequence;
+	frame[4] = (uint8_t)length;
+	if(length > 0U)
+	{
+		memcpy(&frame[NODE_BUS_HEADER_SIZE], payload, length);
+	}
+	uint32_t crc = Hash_Crc32(frame, NODE_BUS_HEADER_SIZE + length);
+	for(uint32_t i = 0; i < NODE_BUS_CRC_SIZE; i++)
+	{
+		frame[NODE_BUS_HEADER_SIZE + length + i] = (uint8_t)(crc >> (8U * i));
+	}
+
+	uint32_t save = spin_lock_blocking(NodeBusLock);
+	if(NodeBusTxCount < NODE_BUS_TX_QUEUE_LENGTH)
+	{
+		uint32_t slot = (NodeBusTxHead + NodeBusTxCount) % NODE_BUS_TX_QUEUE_LENGTH;
+		NodeBusTxLength[slot] = NodeBusEncode(frame, NODE_BUS_HEADER_SIZE + length + NODE_BUS_CRC_SIZE, NodeBusTxQueue[slot]);
+		NodeBusTxCount++;
+		queued = true;
+	}
+	else
+	{
+		NodeBusStats.txDropped++;
+	}
+	spin_unlock(NodeBusLock, save);
+	return queued;
+}
+
+/* MOVE payload - a higher priority source on a channel (a button, a limit switch) keeps it */
+void NodeBusApplyMove(const uint8_t *payload, uint32_t length)
+{
+	if((length != 3U) || (payload[1] > (uint8_t)STATE_ANTICLOCKWISE) ||
+	   ((payload[2] != (uint8_t)MOTOR_PRIORITY_AUTOMATIC) && (payload[2] != (uint8_t)MOTOR_PRIORITY_REMOTE)))
+	{
+		return;
+	}
+	MotorPriority_t priority = (MotorPriority_t)payload[2];
+	uint32_t deadline_us = (priority == MOTOR_PRIORITY_AUTOMATIC) ? MOTOR_DEADLINE_AUTOMATIC_IN_US : MOTOR_DEADLINE_REMOTE_IN_US;
+
+	NodeBusStats.moves++;
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		if((payload[0] & CHANNEL_BIT(channel)) == 0U)
+		{
+			continue;
+		}
+		if(payload[1] == (uint8_t)STATE_OFF)
+		{
+			MotorCommand_Release(channel, priority);
+		}
+		else
+		{
+			(void)MotorCommand_Submit(channel, (MotorState_t)payload[1], priority, deadline_us);
+		}
+	}
+}
+
+void NodeBusDispatch(const uint8_t *frame, uint32_t length)
+{
+	uint32_t payloadLength = (length >= (NODE_BUS_HEADER_SIZE + NODE_BUS_CRC_SIZE)) ? frame[4] : 0U;
+	if((length < (NODE_BUS_HEADER_SIZE + NODE_BUS_CRC_SIZE)) || (payloadLength > NODE_BUS_MAX_PAYLOAD) ||
+	   (length != (NODE_BUS_HEADER_SIZE + payloadLength + NODE_BUS_CRC_SIZE)))
+	{
+		NodeBusStats.badFrames++;
+		return;
+	}
+	const uint8_t *crcBytes = &frame[NODE_BUS_HEADER_SIZE + payloadLength];
+	uint32_t crc = (uint32_t)crcBytes[0] | ((uint32_t)crcBytes[1] << 8) | ((uint32_t)crcBytes[2] << 16) | ((uint32_t)crcBytes[3] << 24);
+	if(crc != Hash_Crc32(frame, NODE_BUS_HEADER_SIZE + payloadLength))
+	{
+		NodeBusStats.badFrames++;
+		return;
+	}
+	if(!NodeBusAddressed(frame[0]))
+	{
+		NodeBusStats.otherFrames++;
+		return;
+	}
+	NodeBusStats.rxFrames++;
+
+	const uint8_t *payload = &frame[NODE_BUS_HEADER_SIZE];
+	switch(frame[2])
+	{
+		case NODE_BUS_CMD_MOVE:
+			NodeBusApplyMove(payload, payloadLength);
+			break;
+		case NODE_BUS_CMD_PING:
+			/* Only a ping to this node is answered - the answers to a broadcast would collide */
+			if(frame[0] == NodeBusConfig.address)
+			{
+				(void)NodeBusQueue(frame[1], NODE_BUS_CMD_PONG, frame[3], &NodeBusConfig.groups, 1U);
+			}
+			break;
+		case NODE_BUS_CMD_PONG:
+			if((payloadLength == 1U) && (frame[1] == NodeBusPing.address) && (frame[3] == NodeBusPing.sequence))
+			{
+				NodeBusPing.roundTrip_us = timer_hw->timerawl - NodeBusPing.sent_us;
+				NodeBusPing.groups = payload[0];
+				NodeBusPing.answered = true;
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/* The bytes the DMA wrote into the ring since the previous poll */
+void NodeBusReceive(void)
+{
+	uint32_t write = (uint32_t)(dma_channel_hw_addr(NodeBusRxDma)->write_addr - (uintptr_t)NodeBusRxRing) & (NODE_BUS_RX_RING_SIZE - 1U);
+
+	NodeBusRxQuiet = (write == NodeBusRxRead);
+	while(NodeBusRxRead != write)
+	{
+		uint8_t byte = NodeBusRxRing[NodeBusRxRead];
+		NodeBusRxRead = (NodeBusRxRead + 1U) & (NODE_BUS_RX_RING_SIZE - 1U);
+		if(byte == NODE_BUS_DELIMITER)
+		{
+			uint8_t frame[NODE_BUS_MAX_ENCODED];
+			uint32_t length = (NodeBusRxFill <= NODE_BUS_MAX_ENCODED) ? NodeBusDecode(NodeBusRxFrame, NodeBusRxFill, frame) : 0U;
+			if(NodeBusRxFill > 0U)
+			{
+				NodeBusDispatch(frame, length);
+			}
+			NodeBusRxFill = 0;
+		}
+		else if(NodeBusRxFill++ < NODE_BUS_MAX_ENCODED)
+		{
+			NodeBusRxFrame[NodeBusRxFill - 1U] = byte;
+		}
+	}
+
+	/* The transfer count runs out after 4G bytes - the ring goes on where it is */
+	if(!dma_channel_is_busy(NodeBusRxDma))
+	{
+		dma_channel_set_trans_count(NodeBusRxDma, UINT32_MAX, true);
+	}
+}
+
+/* The driver is on from the first byte until the last one left the shift register */
+void NodeBusTransmit(void)
+{
+	if(NodeBusTransmitting)
+	{
+		if(dma_channel_is_busy(NodeBusTxDma) || ((uart_get_hw(NODE_BUS_UART)->fr & UART_UARTFR_BUSY_BITS) != 0U))
+		{
+			return;
+		}
+		gpio_put(NODE_BUS_DE_GPIO, 0);
+		NodeBusTransmitting = false;
+		NodeBusStats.txFrames++;
+
+		uint32_t save = spin_lock_blocking(NodeBusLock);
+		NodeBusTxHead = (NodeBusTxHead + 1U) % NODE_BUS_TX_QUEUE_LENGTH;
+		NodeBusTxCount--;
+		spin_unlock(NodeBusLock, save);
+	}
+
+	/* Another node is sending - wait until it is done */
+	if((NodeBusTxCount == 0U) || !NodeBusRxQuiet || (NodeBusRxFill != 0U))
+	{
+		return;
+	}
+	gpio_put(NODE_BUS_DE_GPIO, 1);
+	NodeBusTransmitting = true;
+	dma_channel_set_read_addr(NodeBusTxDma, NodeBusTxQueue[NodeBusTxHead], false);
+	dma_channel_set_trans_count(NodeBusTxDma, NodeBusTxLength[NodeBusTxHead], true);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void NodeBus_Init(void)
+{
+	NodeBusConfig.address = SiteConfig->busAddress;
+	NodeBusConfig.groups = SiteConfig->busGroups;
+	NodeBusConfig.leader = (SiteConfig->busLeader == 1U);
+	NodeBusLock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+
+	gpio_init(NODE_BUS_DE_GPIO);
+	gpio_set_dir(NODE_BUS_DE_GPIO, GPIO_OUT);
+	gpio_put(NODE_BUS_DE_GPIO, 0);
+	(void)uart_init(NODE_BUS_UART, NODE_BUS_BAUD_RATE);
+	uart_set_format(NODE_BUS_UART, 8U, 1U, UART_PARITY_NONE);
+	uart_set_hw_flow(NODE_BUS_UART, false, false);
+	uart_set_fifo_enabled(NODE_BUS_UART, true);
+	gpio_set_function(NODE_BUS_TX_GPIO, GPIO_FUNC_UART);
+	gpio_set_function(NODE_BUS_RX_GPIO, GPIO_FUNC_UART);
+
+	/* Receive - the DMA moves every byte into a ring buffer, NodeBusTask follows its write address */
+	NodeBusRxDma = (uint32_t)dma_claim_unused_channel(true);
+	dma_channel_config config = dma_channel_get_default_config(NodeBusRxDma);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, false);
+	channel_config_set_write_increment(&config, true);
+	channel_config_set_ring(&config, true, NODE_BUS_RX_RING_BITS);
+	channel_config_set_dreq(&config, uart_get_dreq(NODE_BUS_UART, false));
+	dma_channel_configure(NodeBusRxDma, &config, NodeBusRxRing, &uart_get_hw(NODE_BUS_UART)->dr, UINT32_MAX, true);
+
+	/* Transmit - one encoded frame of the queue per transfer */
+	NodeBusTxDma = (uint32_t)dma_claim_unused_channel(true);
+	config = dma_channel_get_default_config(NodeBusTxDma);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_dreq(&config, uart_get_dreq(NODE_BUS_UART, true));
+	dma_channel_configure(NodeBusTxDma, &config, &uart_get_hw(NODE_BUS_UART)->dr, NodeBusTxQueue[0], 0U, false);
+}
+
+bool NodeBus_Move(uint8_t destination, uint32_t channelMask, MotorState_t state, MotorPriority_t priority)
+{
+	uint8_t payload[3] = { (uint8_t)channelMask, (uint8_t)state, (uint8_t)priority };
+	return NodeBusQueue(destination, NODE_BUS_CMD_MOVE, NodeBusSequence++, payload, sizeof(payload));
+}
+
+void NodeBusTask(void *pvParameters)
+{
+	for( ;; )
+	{
+		/* A frame takes ~1.5ms on the wire at 115200 - polled every tick, a move is applied within a frame time of its end */
+		vTaskDelay(pdMS_TO_TICKS(NODE_BUS_TASK_PERIOD));
+		Watchdog_CheckIn(WATCHDOG_CLIENT_NODE_BUS);
+		NodeBusReceive();
+		NodeBusTransmit();
+	}
+}
+
+/* USB link BUS_INFO command */
+void NodeBus_Info(void)
+{
+	UsbLink_Respond("BUS %u %u %u %lu %lu %lu %lu %lu %lu", (unsigned)NodeBusConfig.address, (unsigned)NodeBusConfig.groups,
+					(unsigned)NodeBusConfig.leader, (unsigned long)NodeBusStats.rxFrames, (unsigned long)NodeBusStats.otherFrames,
+					(unsigned long)NodeBusStats.badFrames, (unsigned long)NodeBusStats.txFrames, (unsigned long)NodeBusStats.txDropped,
+					(unsigned long)NodeBusStats.moves);
+}
+
+/* USB link BUS_CONFIG command - address, groups, leader */
+void NodeBus_Config(const uint8_t *payload, uint32_t length)
+{
+	if((length != 3U) || (payload[0] == 0U) || (payload[0] > NODE_BUS_MAX_ADDRESS) || (payload[2] > 1U))
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	NodeBusConfig.address = payload[0];
+	NodeBusConfig.groups = payload[1];
+	NodeBusConfig.leader = (payload[2] == 1U);
+	UsbLink_Respond("ACK 0");
+}
+
+/* USB link BUS_MOVE command - destination, channel mask, MotorState_t. The channels of this node move too if it is addressed */
+void NodeBus_RemoteMove(const uint8_t *payload, uint32_t length)
+{
+	if((length != 3U) || (payload[0] == 0U) || (payload[2] > (uint8_t)STATE_ANTICLOCKWISE))
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	if(!NodeBus_Move(payload[0], payload[1], (MotorState_t)payload[2], MOTOR_PRIORITY_REMOTE))
+	{
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+	if(NodeBusAddressed(payload[0]))
+	{
+		uint8_t move[3] = { payload[1], payload[2], (uint8_t)MOTOR_PRIORITY_REMOTE };
+		NodeBusApplyMove(move, sizeof(move));
+	}
+	UsbLink_Respond("ACK 0");
+}
+
+/* USB link BUS_PING command - address. Waits for the PONG (UsbLinkTask) */
+void NodeBus_RemotePing(const uint8_t *payload, uint32_t length)
+{
+	if((length != 1U) || (payload[0] == 0U) || (payload[0] > NODE_BUS_MAX_ADDRESS) || (payload[0] == NodeBusConfig.address))
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	uint8_t sequence = NodeBusSequence++;
+	NodeBusPing.answered = false;
+	NodeBusPing.sequence = sequence;
+	NodeBusPing.address = payload[0];
+	NodeBusPing.sent_us = timer_hw->timerawl;
+	if(!NodeBusQueue(payload[0], NODE_BUS_CMD_PING, sequence, NULL, 0U))
+	{
+		NodeBusPing.address = 0;
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+	for(uint32_t waited_ms = 0; (waited_ms < NODE_BUS_PING_TIMEOUT_IN_MS) && !NodeBusPing.answered; waited_ms++)
+	{
+		vTaskDelay(pdMS_TO_TICKS(1));
+	}
+	NodeBusPing.address = 0;
+	if(!NodeBusPing.answered)
+	{
+		UsbLink_Respond("ERR timeout 0");
+		return;
+	}
+	UsbLink_Respond("PONG %u %u %lu", (unsigned)payload[0], (unsigned)NodeBusPing.groups, (unsigned long)NodeBusPing.roundTrip_us);
+}
+
+#endif /* NODE_BUS_ENABLED */
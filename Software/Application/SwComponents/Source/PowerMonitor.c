@@ -0,0 +1,329 @@
+/* PowerMonitor.c - the falling edge of the 12V supply, and the state of the blinds flushed to the DS1307 before the board dies
+   (see PowerMonitor.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/i2c.h"
+#include "hardware/timer.h"
+
+/* Include files from other tasks */
+#include "PowerMonitor.h"
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "TimerService.h"
+#include "TimeSync.h"
+#include "Watchdog.h"
+#include "LightSensor.h"
+#include "Encoder.h"
+#include "UsbLink.h"
+#include "Hash.h"
+
+#if (POWER_MONITOR_ENABLED == 1)
+
+_Static_assert((POWER_MONITOR_GPIO >= 26U) && (POWER_MONITOR_GPIO <= 28U), "The supply divider needs one of the ADC pins (GPIO 26-28)");
+_Static_assert(BLINDS_NUM_OF_CHANNELS <= POWER_FAIL_RECORD_CHANNELS, "One byte per channel in the record, the ADC pin is a motor output of channel 2");
+_Static_assert(POWER_FAIL_NVRAM_ADDR == (DS1307_REG_ADDR_IS_CLOSED + 1U), "IS_CLOSED and the record are written in one burst");
+_Static_assert((POWER_FAIL_NVRAM_ADDR + POWER_FAIL_RECORD_SIZE) <= TIME_SYNC_NVRAM_ADDR, "The record ends before the time sync state");
+_Static_assert(POWER_MONITOR_FAIL_MV < POWER_MONITOR_GOOD_MV, "The hysteresis of the comparator");
+_Static_assert((((POWER_MONITOR_FAIL_SAMPLES + 1U) * POWER_MONITOR_PERIOD_IN_US) + ((POWER_MONITOR_RTC_WAIT_IN_MS + 1U) * 1000U) +
+				POWER_MONITOR_I2C_TIMEOUT_IN_US) < POWER_MONITOR_HOLD_UP_IN_US, "The slowest flush has to end before the regulator drops out");
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define POWER_MONITOR_LIGHT_DIVIDER			(LIGHT_SENSOR_SAMPLE_PERIOD_IN_US / POWER_MONITOR_PERIOD_IN_US)
+#define POWER_FAIL_CHECK					(0U)		/* offsets in the record */
+#define POWER_FAIL_CHANNELS					(1U)
+#define POWER_FAIL_COUNT					(3U)
+#define POWER_FAIL_SPAN						(5U)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+PowerMonitorStats_t PowerMonitorStats;
+
+static TimerService_Timer_t PowerMonitorTimer;
+static SemaphoreHandle_t PowerMonitorSemaphore;
+static volatile bool PowerFailing;
+static bool PowerFailRecordWritten;
+static uint32_t PowerMonitorBelow;
+static uint32_t PowerMonitorTicks;
+static uint32_t PowerMonitorFailCounts;		/* POWER_MONITOR_FAIL_MV and POWER_MONITOR_GOOD_MV in ADC counts */
+static uint32_t PowerMonitorGoodCounts;
+/* Taken in the interrupt at the edge - before the safety stop changes the states and the owners of the channels */
+static volatile uint32_t PowerFailChannels;
+static volatile uint8_t PowerFailClosed;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+uint32_t PowerMonitorCounts(uint32_t millivolts);
+uint32_t PowerMonitorConvert(void);
+void PowerMonitorFalling(void);
+void PowerMonitorCheck(TimerService_Timer_t *timer, void *context);
+uint8_t PowerFailCheckByte(const uint8_t record[POWER_FAIL_RECORD_SIZE]);
+int16_t PowerFailCount(int32_t count);
+bool PowerMonitorRead(uint8_t reg, uint8_t *data, uint32_t length);
+bool PowerMonitorWrite(uint8_t reg, const uint8_t *data, uint32_t length);
+void PowerMonitorFlush(void);
+void PowerMonitorClear(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* The fewest counts at or above the rail voltage - a conversion below them is below it */
+uint32_t PowerMonitorCounts(uint32_t millivolts)
+{
+	return (uint32_t)ceilf((float)millivolts * (float)POWER_MONITOR_ADC_COUNTS / ((float)POWER_MONITOR_ADC_REF_MV * POWER_MONITOR_DIVIDER));
+}
+
+uint32_t HOT_PATH_FUNC(PowerMonitorConvert)(void)
+{
+	adc_select_input(POWER_MONITOR_ADC_INPUT);
+	return adc_read();
+}
+
+/* The edge - the H-bridge off first (the motors are most of the load on the hold-up), then the channels taken over above the
+   safety commands so that nothing drives them again while the rail is still falling - not even a limit switch back-off */
+void HOT_PATH_FUNC(PowerMonitorFalling)(void)
+{
+	MotorOutputsOff();
+	PowerMonitorStats.lastDetect_us = timer_hw->timerawl;
+	PowerMonitorStats.failures++;
+	PowerFailChannels = Watchdog_PackChannels();
+	PowerFailClosed = AutomaticControl_ClosedToStore();
+	PowerFailing = true;
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		(void)MotorCommand_Submit(channel, STATE_OFF, MOTOR_PRIORITY_POWER_FAIL, 0U);
+	}
+}
+
+/* Timer service callback (interrupt context) every POWER_MONITOR_PERIOD_IN_US - the comparator with its hysteresis */
+void HOT_PATH_FUNC(PowerMonitorCheck)(TimerService_Timer_t *timer, void *context)
+{
+	(void)timer;
+	(void)context;
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	uint32_t supply = PowerMonitorConvert();
+
+	PowerMonitorStats.supply = (uint16_t)supply;
+	PowerMonitorStats.checks++;
+	if(supply < PowerMonitorStats.lowest) PowerMonitorStats.lowest = (uint16_t)supply;
+
+	if(!PowerFailing)
+	{
+		PowerMonitorBelow = (supply < PowerMonitorFailCounts) ? (PowerMonitorBelow + 1U) : 0U;
+		if(PowerMonitorBelow >= POWER_MONITOR_FAIL_SAMPLES)
+		{
+			PowerMonitorFalling();
+			(void)xSemaphoreGiveFromISR(PowerMonitorSemaphore, &higherPriorityTaskWoken);
+		}
+	}
+	else if(supply >= PowerMonitorGoodCounts)
+	{
+		/* A dip the board lived through - the blinds stay where they stopped, like after a press of a button. Only the claim
+		   of the monitor goes, a back-off or a jam stop holding its channel beneath it ends on its own */
+		PowerFailing = false;
+		PowerMonitorBelow = 0U;
+		PowerMonitorStats.recoveries++;
+		for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+		{
+			MotorCommand_Release(channel, MOTOR_PRIORITY_POWER_FAIL);
+		}
+		(void)xSemaphoreGiveFromISR(PowerMonitorSemaphore, &higherPriorityTaskWoken);
+	}
+
+#if (LIGHT_SENSOR_ENABLED == 1)
+	if(++PowerMonitorTicks >= POWER_MONITOR_LIGHT_DIVIDER)
+	{
+		PowerMonitorTicks = 0U;
+		adc_select_input(LIGHT_SENSOR_ADC_INPUT);
+		LightSensor_Sample(adc_read());
+	}
+#endif
+
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+uint8_t PowerFailCheckByte(const uint8_t record[POWER_FAIL_RECORD_SIZE])
+{
+	return (uint8_t)Hash_Crc32(&record[POWER_FAIL_CHANNELS], POWER_FAIL_RECORD_SIZE - 1U) ^ POWER_FAIL_RECORD_MAGIC;
+}
+
+int16_t PowerFailCount(int32_t count)
+{
+	return ((count > INT16_MIN) && (count <= INT16_MAX)) ? (int16_t)count : POWER_FAIL_NO_COUNT;
+}
+
+/* Bursts on I2C0 - the register pointer of the DS1307 increments after every byte */
+bool PowerMonitorRead(uint8_t reg, uint8_t *data, uint32_t length)
+{
+	return (i2c_write_timeout_us(i2c0, POWER_MONITOR_DS1307_I2C_ADDRESS, &reg, 1U, true, POWER_MONITOR_I2C_TIMEOUT_IN_US) == 1) &&
+		   (i2c_read_timeout_us(i2c0, POWER_MONITOR_DS1307_I2C_ADDRESS, data, length, false, POWER_MONITOR_I2C_TIMEOUT_IN_US) == (int)length);
+}
+
+bool PowerMonitorWrite(uint8_t reg, const uint8_t *data, uint32_t length)
+{
+	uint8_t frame[2U + POWER_FAIL_RECORD_SIZE];
+
+	frame[0] = reg;
+	memcpy(&frame[1], data, length);
+	return i2c_write_timeout_us(i2c0, POWER_MONITOR_DS1307_I2C_ADDRESS, frame, length + 1U, false, POWER_MONITOR_I2C_TIMEOUT_IN_US) == (int)(length + 1U);
+}
+
+/* IS_CLOSED and the record in one burst - a single write of 9 bytes, ~230us at 400kHz. Never without the mutex - a write into a
+   transfer of another task could scramble the clock registers or the record. Its owner inherits the priority of this task and
+   ends its transfers within the wait - a time sync waiting for the second of the DS1307 gives up at its next poll step. Should
+   the wait still run out, the flush is given up and the boot after the cut finds no record */
+void PowerMonitorFlush(void)
+{
+	uint8_t data[1U + POWER_FAIL_RECORD_SIZE];
+	uint8_t *record = &data[1];
+	int16_t count = POWER_FAIL_NO_COUNT, span = POWER_FAIL_NO_COUNT;
+
+#if (ENCODER_ENABLED == 1)
+	if(Encoder_Calibrated())
+	{
+		count = PowerFailCount(Encoder_Read() - EncoderState.topCount);
+		span = PowerFailCount(EncoderState.bottomCount - EncoderState.topCount);
+	}
+#endif
+	data[0] = PowerFailClosed;
+	record[POWER_FAIL_CHANNELS] = (uint8_t)PowerFailChannels;
+	record[POWER_FAIL_CHANNELS + 1U] = (uint8_t)(PowerFailChannels >> 8);
+	record[POWER_FAIL_COUNT] = (uint8_t)((uint16_t)count);
+	record[POWER_FAIL_COUNT + 1U] = (uint8_t)((uint16_t)count >> 8);
+	record[POWER_FAIL_SPAN] = (uint8_t)((uint16_t)span);
+	record[POWER_FAIL_SPAN + 1U] = (uint8_t)((uint16_t)span >> 8);
+	record[POWER_FAIL_CHECK] = PowerFailCheckByte(record);
+
+	if(xSemaphoreTake(RtcMutex, pdMS_TO_TICKS(POWER_MONITOR_RTC_WAIT_IN_MS)) == pdFALSE)
+	{
+		PowerMonitorStats.rtcBusy++;
+		return;
+	}
+
+	/* IS_CLOSED not read yet - nothing to write there, the record alone */
+	bool written = (PowerFailClosed == BLINDS_UNKNOWN) ? PowerMonitorWrite(POWER_FAIL_NVRAM_ADDR, record, POWER_FAIL_RECORD_SIZE) :
+														 PowerMonitorWrite(DS1307_REG_ADDR_IS_CLOSED, data, sizeof(data));
+	uint32_t flush_us = timer_hw->timerawl - PowerMonitorStats.lastDetect_us;
+
+	xSemaphoreGive(RtcMutex);
+
+	if(written)
+	{
+		PowerFailRecordWritten = true;
+		PowerMonitorStats.flushes++;
+		PowerMonitorStats.lastFlush_us = flush_us;
+		if(flush_us > PowerMonitorStats.longestFlush_us) PowerMonitorStats.longestFlush_us = flush_us;
+	}
+	else
+	{
+		PowerMonitorStats.flushErrors++;
+	}
+}
+
+/* The check byte inverted - the record describes the boot after a power cut only (not a watchdog reset after a dip) */
+void PowerMonitorClear(void)
+{
+	uint8_t check = 0;
+
+	if(PowerMonitorRead(POWER_FAIL_NVRAM_ADDR, &check, 1U))
+	{
+		check = (uint8_t)~check;
+		(void)PowerMonitorWrite(POWER_FAIL_NVRAM_ADDR, &check, 1U);
+	}
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void PowerMonitor_Init(void)
+{
+	uint8_t record[POWER_FAIL_RECORD_SIZE];
+	PowerFailRecord_t *boot = &PowerMonitorStats.bootRecord;
+
+	boot->valid = PowerMonitorRead(POWER_FAIL_NVRAM_ADDR, record, sizeof(record)) &&
+				  (record[POWER_FAIL_CHECK] == PowerFailCheckByte(record));
+	if(boot->valid)
+	{
+		boot->channels[0] = record[POWER_FAIL_CHANNELS];
+		boot->channels[1] = record[POWER_FAIL_CHANNELS + 1U];
+		boot->count = (int16_t)((uint16_t)record[POWER_FAIL_COUNT] | ((uint16_t)record[POWER_FAIL_COUNT + 1U] << 8));
+		boot->span = (int16_t)((uint16_t)record[POWER_FAIL_SPAN] | ((uint16_t)record[POWER_FAIL_SPAN + 1U] << 8));
+#if (ENCODER_ENABLED == 1)
+		if((boot->count != POWER_FAIL_NO_COUNT) && (boot->span != POWER_FAIL_NO_COUNT))
+		{
+			Encoder_Restore(boot->count, boot->span);
+			PowerMonitorStats.encoderRestored = Encoder_Calibrated();
+		}
+#endif
+		PowerMonitorClear();
+	}
+	LOG("PowerMonitor: %s\n", boot->valid ? "booted after a power cut" : "no power cut recorded");
+
+	/* The ADC converts on demand - the light sensor input is converted here too (LightSensor_Init only sets its pin up) */
+	adc_init();
+	adc_gpio_init(POWER_MONITOR_GPIO);
+	PowerMonitorFailCounts = PowerMonitorCounts(POWER_MONITOR_FAIL_MV);
+	PowerMonitorGoodCounts = PowerMonitorCounts(POWER_MONITOR_GOOD_MV);
+	PowerMonitorStats.lowest = UINT16_MAX;
+	PowerMonitorSemaphore = xSemaphoreCreateBinary();
+	TimerService_Setup(&PowerMonitorTimer, PowerMonitorCheck, NULL);
+	TimerService_StartPeriodic(&PowerMonitorTimer, POWER_MONITOR_PERIOD_IN_US);
+}
+
+/* Above every other task - woken by the edges only. The record of a dip the board lived through is cleared again */
+void PowerMonitorTask(void *pvParameters)
+{
+	for( ;; )
+	{
+		(void)xSemaphoreTake(PowerMonitorSemaphore, portMAX_DELAY);
+		if(PowerFailing)
+		{
+			PowerMonitorFlush();
+		}
+		else if(PowerFailRecordWritten)
+		{
+			(void)xSemaphoreTake(RtcMutex, portMAX_DELAY);
+			PowerMonitorClear();
+			xSemaphoreGive(RtcMutex);
+			PowerFailRecordWritten = false;
+		}
+	}
+}
+
+uint32_t PowerMonitor_Millivolts(uint32_t counts)
+{
+	return (uint32_t)((float)(counts * POWER_MONITOR_ADC_REF_MV) * POWER_MONITOR_DIVIDER / (float)POWER_MONITOR_ADC_COUNTS);
+}
+
+bool PowerMonitor_Failing(void)
+{
+	return PowerFailing;
+}
+
+/* USB link POWER command */
+void PowerMonitor_Info(void)
+{
+	const PowerFailRecord_t *boot = &PowerMonitorStats.bootRecord;
+
+	UsbLink_Respond("POWER %lu %lu %lu %lu %lu %lu %lu %lu %u %02x%02x %d %d %u", (unsigned long)PowerMonitor_Millivolts(PowerMonitorStats.supply),
+					(unsigned long)PowerMonitor_Millivolts(PowerMonitorStats.lowest), (unsigned long)PowerMonitorStats.failures,
+					(unsigned long)PowerMonitorStats.recoveries, (unsigned long)PowerMonitorStats.flushes,
+					(unsigned long)PowerMonitorStats.flushErrors, (unsigned long)PowerMonitorStats.lastFlush_us,
+					(unsigned long)PowerMonitorStats.longestFlush_us, boot->valid ? 1U : 0U, boot->channels[1], boot->channels[0],
+					boot->count, boot->span, PowerMonitorStats.encoderRestored ? 1U : 0U);
+}
+
+#endif /* POWER_MONITOR_ENABLED */
@@ -0,0 +1,252 @@
+/* Profiler.c - statistical profiler: the code and the task the spare hardware alarm interrupts, sampled into RAM and read over
+   the USB link (see Profiler.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+/* Include files from other tasks */
+#include "Profiler.h"
+#include "UsbLink.h"
+#include "ElectronicBlinds_Main.h"
+
+#if (PROFILER_ENABLED == 1)
+
+#if !defined(__arm__)
+#include "HostSim.h"
+#endif
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define PROFILER_FRAME_WORDS				(8U)			/* exception frame - r0-r3, r12, lr, pc, xpsr */
+#define PROFILER_FRAME_PC					(6U)
+#define PROFILER_EXC_RETURN_HANDLER			(0xFFFFFFF1U)	/* the alarm interrupted another interrupt handler */
+#define PROFILER_EXC_RETURN_THREAD_PSP		(0xFFFFFFFDU)	/* ... a task */
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+volatile ProfilerState_t ProfilerState;
+ProfilerStats_t ProfilerStats;
+
+static uint32_t ProfilerPcs[PROFILER_MAX_SAMPLES];
+static uint8_t ProfilerTaskOf[PROFILER_MAX_SAMPLES];
+static TaskHandle_t ProfilerTasks[PROFILER_MAX_TASKS];		/* the tasks seen by the captures since the boot - never deleted */
+static uint32_t ProfilerNumOfTasks;
+static uint32_t ProfilerPeriod_us;
+static uint32_t ProfilerTarget;								/* timerawl of the alarm armed last */
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void ProfilerAlarmHandler(void);
+void ProfilerSample(const uint32_t *frame, uint32_t excReturn);
+uint8_t ProfilerTaskIndex(TaskHandle_t task);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+#if defined(__arm__)
+/* Entered straight from the vector table, nothing is pushed on top of the exception frame yet - bit 2 of EXC_RETURN (in LR)
+   tells the stack it is on: the PSP of a task or the MSP of an interrupt handler (and of main() before the scheduler).
+   ProfilerSample gets the frame and EXC_RETURN, and returns from the exception itself */
+void __attribute__((naked)) ProfilerAlarmHandler(void)
+{
+	__asm volatile(
+		"movs r0, #4			\n"
+		"mov r1, lr				\n"
+		"tst r0, r1				\n"
+		"beq 1f					\n"
+		"mrs r0, psp			\n"
+		"b 2f					\n"
+		"1:						\n"
+		"mrs r0, msp			\n"
+		"2:						\n"
+		"ldr r2, 3f				\n"
+		"bx r2					\n"
+		".align 2				\n"
+		"3: .word ProfilerSample	\n"
+	);
+}
+#else
+/* HostSim - no exception frame, the simulation tells the code the alarm interrupted (0 - the core was idle) */
+void ProfilerAlarmHandler(void)
+{
+	uint32_t frame[PROFILER_FRAME_WORDS] = { 0 };
+	frame[PROFILER_FRAME_PC] = HostSim_InterruptedPc();
+	ProfilerSample(frame, PROFILER_EXC_RETURN_THREAD_PSP);
+}
+#endif
+
+void ProfilerSample(const uint32_t *frame, uint32_t excReturn)
+{
+	hw_clear_bits(&timer_hw->intr, 1u << PROFILER_ALARM_NUM);
+	if(ProfilerState != PROFILER_STATE_CAPTURING)
+	{
+		/* Stopped - the alarm is not armed again */
+		return;
+	}
+
+	uint32_t sample = ProfilerStats.samples;
+	ProfilerPcs[sample] = frame[PROFILER_FRAME_PC];
+	ProfilerTaskOf[sample] = (excReturn == PROFILER_EXC_RETURN_HANDLER) ? PROFILER_TASK_NONE : ProfilerTaskIndex(xTaskGetCurrentTaskHandle());
+	ProfilerStats.samples = sample + 1U;
+	if(ProfilerStats.samples >= PROFILER_MAX_SAMPLES)
+	{
+		ProfilerState = PROFILER_STATE_DONE;
+		return;
+	}
+
+	/* A period after the alarm was due, not after it was taken - the rate stays exact whatever the latency of the entry. The
+	   alarm only fires on an exact match, a target already passed is moved to a period from now */
+	uint32_t target = ProfilerTarget + ProfilerPeriod_us;
+	if((int32_t)(target - timer_hw->timerawl) <= 0)
+	{
+		ProfilerStats.late++;
+		target = timer_hw->timerawl + ProfilerPeriod_us;
+	}
+	ProfilerTarget = target;
+	timer_hw->alarm[PROFILER_ALARM_NUM] = target;
+}
+
+/* Index of the task in ProfilerTasks - added when it is seen for the first time */
+uint8_t ProfilerTaskIndex(TaskHandle_t task)
+{
+	if(task == NULL)
+	{
+		return PROFILER_TASK_NONE;
+	}
+	for(uint32_t i = 0; i < ProfilerNumOfTasks; i++)
+	{
+		if(ProfilerTasks[i] == task) return (uint8_t)i;
+	}
+	if(ProfilerNumOfTasks >= PROFILER_MAX_TASKS)
+	{
+		return PROFILER_TASK_NONE;
+	}
+	ProfilerTasks[ProfilerNumOfTasks] = task;
+	return (uint8_t)ProfilerNumOfTasks++;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Profiler_Init(void)
+{
+	/* Reserved - hardware_alarm_claim_unused of any SDK component gets another one */
+	hardware_alarm_claim(PROFILER_ALARM_NUM);
+	irq_set_exclusive_handler(PROFILER_IRQ, ProfilerAlarmHandler);
+	irq_set_priority(PROFILER_IRQ, PICO_HIGHEST_IRQ_PRIORITY);
+	hw_set_bits(&timer_hw->inte, 1u << PROFILER_ALARM_NUM);
+	irq_set_enabled(PROFILER_IRQ, true);
+}
+
+bool Profiler_Start(uint32_t rate_hz)
+{
+	if((rate_hz == 0U) || (rate_hz > PROFILER_MAX_RATE_HZ))
+	{
+		return false;
+	}
+
+	uint32_t irqStatus = save_and_disable_interrupts();
+	ProfilerStats.samples = 0;
+	ProfilerStats.late = 0;
+	ProfilerPeriod_us = 1000000U / rate_hz;
+	ProfilerState = PROFILER_STATE_CAPTURING;
+	ProfilerTarget = timer_hw->timerawl + ProfilerPeriod_us;
+	timer_hw->alarm[PROFILER_ALARM_NUM] = ProfilerTarget;
+	restore_interrupts(irqStatus);
+	return true;
+}
+
+void Profiler_Stop(void)
+{
+	if(ProfilerState == PROFILER_STATE_CAPTURING)
+	{
+		ProfilerState = PROFILER_STATE_DONE;
+	}
+}
+
+/* USB link PROFILE_START command - rate in Hz (32-bit LE), 0 stops the capture */
+void Profiler_StartRemote(const uint8_t *payload, uint32_t length)
+{
+	if(length != PROFILER_START_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR size 0");
+		return;
+	}
+	uint32_t rate_hz = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	if(rate_hz == 0U)
+	{
+		Profiler_Stop();
+	}
+	else if(!Profiler_Start(rate_hz))
+	{
+		UsbLink_Respond("ERR rate 0");
+		return;
+	}
+	UsbLink_Respond("ACK 0");
+}
+
+/* USB link PROFILE_INFO command - the state of the capture, its rate (what the period in whole us gives) and the samples taken */
+void Profiler_Info(void)
+{
+	static const char *const ProfilerStateNames[] = { "off", "capturing", "done" };
+
+	uint32_t irqStatus = save_and_disable_interrupts();
+	ProfilerStats_t stats = ProfilerStats;
+	ProfilerState_t state = ProfilerState;
+	uint32_t tasks = ProfilerNumOfTasks;
+	restore_interrupts(irqStatus);
+
+	uint32_t rate_hz = (ProfilerPeriod_us > 0U) ? (1000000U / ProfilerPeriod_us) : 0U;
+	UsbLink_Respond("PROFILE %s %lu %lu %lu %lu %lu", ProfilerStateNames[state], (unsigned long)rate_hz, (unsigned long)ProfilerPeriod_us,
+					(unsigned long)stats.samples, (unsigned long)stats.late, (unsigned long)tasks);
+}
+
+/* USB link PROFILE_READ command - first sample (32-bit LE) -> #PDATA <first sample> <up to PROFILER_DATA_CHUNK samples in hex>,
+   none past the last one taken */
+void Profiler_Read(const uint8_t *payload, uint32_t length)
+{
+	char hex[(2U * PROFILER_SAMPLE_SIZE * PROFILER_DATA_CHUNK) + 1U];
+
+	if(length != PROFILER_READ_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR size 0");
+		return;
+	}
+	uint32_t first = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	uint32_t total = ProfilerStats.samples;
+	uint32_t count = (first < total) ? (total - first) : 0U;
+	count = (count > PROFILER_DATA_CHUNK) ? PROFILER_DATA_CHUNK : count;
+
+	char *out = hex;
+	for(uint32_t i = first; i < (first + count); i++)
+	{
+		uint32_t pc = ProfilerPcs[i];
+		out += snprintf(out, 11U, "%02x%02x%02x%02x%02x", (unsigned)(pc & 0xFFU), (unsigned)((pc >> 8) & 0xFFU),
+						(unsigned)((pc >> 16) & 0xFFU), (unsigned)(pc >> 24), (unsigned)ProfilerTaskOf[i]);
+	}
+	*out = '\0';
+	UsbLink_Respond("PDATA %lu %s", (unsigned long)first, hex);
+}
+
+/* USB link PROFILE_TASK command - task index (8-bit) of the samples -> #PTASK <index> <name> | #ERR item 0 */
+void Profiler_Task(const uint8_t *payload, uint32_t length)
+{
+	if((length != 1U) || (payload[0] >= ProfilerNumOfTasks))
+	{
+		UsbLink_Respond("ERR item 0");
+		return;
+	}
+	UsbLink_Respond("PTASK %u %s", (unsigned)payload[0], pcTaskGetName(ProfilerTasks[payload[0]]));
+}
+
+#endif /* PROFILER_ENABLED */
@@ -0,0 +1,279 @@
+/* Schedule.c - rules of the automatic control compiled into a table of open/close transitions for the whole year.
+   AutomaticControlTask looks the state up with one binary search (mostly not even that - the current interval is cached).
+   Two tables - SolarWorker compiles into the one not in use and publishes it with one store, the lookups never wait */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <math.h>
+
+/* SDK includes */
+#include "hardware/sync.h"
+
+/* Include files from other tasks */
+#include "Schedule.h"
+#include "AutomaticControlTask.h"
+#include "ElectronicBlinds_Main.h"
+#include "SiteConfig.h"
+
+/* Includes from the DS1307 library */
+#include "DS1307.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define SCHEDULE_NUM_OF_ELEMENTS(array)		(sizeof(array) / sizeof((array)[0]))
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+#if (SCHEDULE_RULES_ENABLED == 1)
+static const ScheduleRule_t ScheduleRules[] =
+{
+	/* Summer - close 20 minutes before sunset */
+	{ SCHEDULE_DAYS_ALL, SCHEDULE_MMDD(6, 21), SCHEDULE_MMDD(9, 22),
+	  { SCHEDULE_REF_NONE, 0, SCHEDULE_BOUND_NONE, 0 }, { SCHEDULE_REF_SUNSET, -20, SCHEDULE_BOUND_NONE, 0 } },
+	/* Weekdays - open at sunrise, but not before 06:30 */
+	{ SCHEDULE_DAYS_WEEKDAYS, 0, 0,
+	  { SCHEDULE_REF_SUNRISE, 0, SCHEDULE_BOUND_NOT_BEFORE, SCHEDULE_HHMM(6, 30) }, { SCHEDULE_REF_NONE, 0, SCHEDULE_BOUND_NONE, 0 } },
+	/* Weekends and holidays - open 45 minutes after sunrise */
+	{ SCHEDULE_DAYS_WEEKEND | SCHEDULE_DAY_HOLIDAY, 0, 0,
+	  { SCHEDULE_REF_SUNRISE, 45, SCHEDULE_BOUND_NONE, 0 }, { SCHEDULE_REF_NONE, 0, SCHEDULE_BOUND_NONE, 0 } },
+};
+
+/* Public holidays in Poland */
+static const ScheduleHoliday_t ScheduleHolidays[] =
+{
+	{ 1, 1 }, { 1, 6 }, { SCHEDULE_EASTER, 0 }, { SCHEDULE_EASTER, 1 }, { 5, 1 }, { 5, 3 }, { SCHEDULE_EASTER, 49 },
+	{ SCHEDULE_EASTER, 60 }, { 8, 15 }, { 11, 1 }, { 11, 11 }, { 12, 24 }, { 12, 25 }, { 12, 26 },
+};
+
+const ScheduleConfig_t ScheduleConfig = { ScheduleRules, SCHEDULE_NUM_OF_ELEMENTS(ScheduleRules), ScheduleHolidays, SCHEDULE_NUM_OF_ELEMENTS(ScheduleHolidays) };
+#else
+/* Closed between sunset and sunrise, every day */
+const ScheduleConfig_t ScheduleConfig = { NULL, 0U, NULL, 0U };
+#endif
+
+/* Open/close pairs, sorted by time - the blinds are closed before the first transition and after the last one. The table
+   of ScheduleActive is read, the other one is written by the next Schedule_Compile - a year later, so a lookup preempted
+   in the middle is long done before its table is written again */
+static uint32_t ScheduleTables[2][SCHEDULE_MAX_TRANSITIONS];
+static uint32_t ScheduleLengths[2];
+static uint32_t ScheduleYears[2];
+static volatile uint32_t ScheduleActive;
+static volatile uint32_t ScheduleGeneration;	/* number of the compiled tables - the reader drops its cache when it changes */
+
+/* Tables of the current lookup (set by Lookup) */
+static const uint32_t *ScheduleTable = ScheduleTables[0];
+static uint32_t ScheduleLength;
+
+/* Last lookup - the transition in effect and the next one (the lookup is not repeated until the time gets past it) */
+static uint32_t ScheduleCachedGeneration;
+static int32_t ScheduleCachedIndex = -1;
+static int32_t ScheduleCachedFrom = INT32_MIN;
+static int32_t ScheduleCachedUntil = INT32_MIN;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+static uint32_t EasterDayOfYear(uint32_t year);
+static bool IsHoliday(const ScheduleConfig_t *config, uint32_t year, uint32_t month, uint32_t day, uint32_t dayOfYear);
+static bool RuleMatches(const ScheduleRule_t *rule, uint8_t dayBit, uint32_t month, uint32_t day);
+static int32_t EvaluateTime(const ScheduleTime_t *time, int32_t sunrise, int32_t sunset);
+static int32_t Lookup(int32_t minuteOfYear);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Anonymous Gregorian algorithm (Meeus) */
+static uint32_t EasterDayOfYear(uint32_t year)
+{
+	uint32_t a = year % 19U;
+	uint32_t b = year / 100U;
+	uint32_t c = year % 100U;
+	uint32_t d = b / 4U;
+	uint32_t e = b % 4U;
+	uint32_t f = (b + 8U) / 25U;
+	uint32_t g = (b - f + 1U) / 3U;
+	uint32_t h = ((19U * a) + b - d - g + 15U) % 30U;
+	uint32_t i = c / 4U;
+	uint32_t k = c % 4U;
+	uint32_t l = (32U + (2U * e) + (2U * i) - h - k) % 7U;
+	uint32_t m = (a + (11U * h) + (22U * l)) / 451U;
+	uint32_t month = (h + l - (7U * m) + 114U) / 31U;
+	uint32_t day = ((h + l - (7U * m) + 114U) % 31U) + 1U;
+
+	/* March or April */
+	return ((month == 3U) ? 31U : 62U) + (isLeapYear(year) ? 29U : 28U) + day;
+}
+
+static bool IsHoliday(const ScheduleConfig_t *config, uint32_t year, uint32_t month, uint32_t day, uint32_t dayOfYear)
+{
+	for(uint32_t i = 0; i < config->numOfHolidays; i++)
+	{
+		const ScheduleHoliday_t *holiday = &config->holidays[i];
+		if(holiday->month == SCHEDULE_EASTER)
+		{
+			if((int32_t)dayOfYear == ((int32_t)EasterDayOfYear(year) + holiday->day)) return true;
+		}
+		else if((holiday->month == month) && ((uint32_t)holiday->day == day))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool RuleMatches(const ScheduleRule_t *rule, uint8_t dayBit, uint32_t month, uint32_t day)
+{
+	if((rule->days & dayBit) == 0U) return false;
+	if((rule->from == 0U) && (rule->to == 0U)) return true;
+
+	uint16_t date = SCHEDULE_MMDD(month, day);
+	if(rule->from <= rule->to) return (date >= rule->from) && (date <= rule->to);
+	return (date >= rule->from) || (date <= rule->to);
+}
+
+static int32_t EvaluateTime(const ScheduleTime_t *time, int32_t sunrise, int32_t sunset)
+{
+	int32_t minute = time->offset;
+	if(time->ref == SCHEDULE_REF_SUNRISE) minute += sunrise;
+	else if(time->ref == SCHEDULE_REF_SUNSET) minute += sunset;
+
+	if((time->bound == SCHEDULE_BOUND_NOT_BEFORE) && (minute < time->boundMinute)) minute = time->boundMinute;
+	else if((time->bound == SCHEDULE_BOUND_NOT_AFTER) && (minute > time->boundMinute)) minute = time->boundMinute;
+
+	if(minute < 0) minute = 0;
+	if(minute > SCHEDULE_MINUTES_PER_DAY) minute = SCHEDULE_MINUTES_PER_DAY;
+	return minute;
+}
+
+/* Index of the last transition at or before the minute, -1 if there is none */
+static int32_t Lookup(int32_t minuteOfYear)
+{
+	/* The table published last - the index after the generation, the table after the index */
+	uint32_t generation = ScheduleGeneration;
+	__dmb();
+	uint32_t active = ScheduleActive;
+	__dmb();
+	ScheduleTable = ScheduleTables[active];
+	ScheduleLength = ScheduleLengths[active];
+	if(generation != ScheduleCachedGeneration)
+	{
+		ScheduleCachedGeneration = generation;
+		ScheduleCachedFrom = INT32_MIN;
+		ScheduleCachedUntil = INT32_MIN;
+	}
+
+	if((minuteOfYear >= ScheduleCachedFrom) && (minuteOfYear < ScheduleCachedUntil)) return ScheduleCachedIndex;
+
+	int32_t low = 0, high = (int32_t)ScheduleLength;	/* the first transition after the minute is in [low, high] */
+	while(low < high)
+	{
+		int32_t middle = (low + high) / 2;
+		if(SCHEDULE_TRANSITION_MINUTE(ScheduleTable[middle]) <= minuteOfYear) low = middle + 1;
+		else high = middle;
+	}
+
+	ScheduleCachedIndex = low - 1;
+	ScheduleCachedFrom = (low > 0) ? SCHEDULE_TRANSITION_MINUTE(ScheduleTable[low - 1]) : INT32_MIN;
+	ScheduleCachedUntil = (low < (int32_t)ScheduleLength) ? SCHEDULE_TRANSITION_MINUTE(ScheduleTable[low]) : INT32_MAX;
+	return ScheduleCachedIndex;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Schedule_Compile(const ScheduleConfig_t *config, uint32_t year)
+{
+	uint32_t daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	if(isLeapYear(year)) daysInMonth[2] = 29;
+
+	/* Into the table not in use - published when it is complete */
+	uint32_t back = (ScheduleGeneration == 0U) ? ScheduleActive : (ScheduleActive ^ 1U);
+	uint32_t *table = ScheduleTables[back];
+	uint32_t length = 0;
+	uint32_t dayOfYear = 0;
+	for(uint32_t month = 1; month <= 12U; month++)
+	{
+		for(uint32_t day = 1; day <= daysInMonth[month]; day++)
+		{
+			dayOfYear++;
+
+			/* Same sunrise/sunset as before the rules - DST time, an hour less outside of DST. Minutes from the first minute
+			   at or after the event, like the comparison of the RTC time with it did */
+			double sunriseHours, sunsetHours;
+			CalculateSunriseSunset(SiteConfig->latitude, SiteConfig->longitude, (int)dayOfYear, SiteConfig->timeZone, &sunriseHours, &sunsetHours);
+			if(isDST(ConvertBCD((uint8_t)(year - 2000U), DEC_TO_BCD), ConvertBCD((uint8_t)month, DEC_TO_BCD), ConvertBCD((uint8_t)day, DEC_TO_BCD)) == false)
+			{
+				sunriseHours -= 1.0;
+				sunsetHours -= 1.0;
+			}
+			int32_t sunrise = (int32_t)ceil(sunriseHours * 60.0);
+			int32_t sunset = (int32_t)ceil(sunsetHours * 60.0);
+
+			uint8_t dayBit = IsHoliday(config, year, month, day, dayOfYear) ? SCHEDULE_DAY_HOLIDAY
+			                 : (uint8_t)(1U << ZellersCongruence((int)year, (int)month, (int)day));
+
+			const ScheduleTime_t *openTime = NULL, *closeTime = NULL;
+			for(uint32_t r = 0; (r < config->numOfRules) && ((openTime == NULL) || (closeTime == NULL)); r++)
+			{
+				const ScheduleRule_t *rule = &config->rules[r];
+				if(!RuleMatches(rule, dayBit, month, day)) continue;
+				if((openTime == NULL) && (rule->open.ref != SCHEDULE_REF_NONE)) openTime = &rule->open;
+				if((closeTime == NULL) && (rule->close.ref != SCHEDULE_REF_NONE)) closeTime = &rule->close;
+			}
+			int32_t open = (openTime != NULL) ? EvaluateTime(openTime, sunrise, sunset) : sunrise;
+			int32_t close = (closeTime != NULL) ? EvaluateTime(closeTime, sunrise, sunset) : sunset;
+
+			if(open < close)
+			{
+				int32_t dayStart = (int32_t)(dayOfYear - 1U) * SCHEDULE_MINUTES_PER_DAY;
+				table[length++] = SCHEDULE_TRANSITION(dayStart + open, true);
+				table[length++] = SCHEDULE_TRANSITION(dayStart + close, false);
+			}
+		}
+	}
+
+	ScheduleLengths[back] = length;
+	ScheduleYears[back] = year;
+	__dmb();
+	ScheduleActive = back;
+	__dmb();
+	ScheduleGeneration = ScheduleGeneration + 1U;
+}
+
+uint32_t Schedule_Year(void)
+{
+	return (ScheduleGeneration == 0U) ? 0U : ScheduleYears[ScheduleActive];
+}
+
+uint32_t Schedule_Transitions(const uint32_t **transitions)
+{
+	uint32_t active = ScheduleActive;
+	*transitions = ScheduleTables[active];
+	return ScheduleLengths[active];
+}
+
+bool Schedule_IsOpen(int32_t minuteOfYear, int32_t narrow_min)
+{
+	/* The table alternates open (even index) and close (odd index) transitions */
+	if(narrow_min >= 0)
+	{
+		/* Open if the open transition is narrow_min behind and its close transition is more than narrow_min ahead */
+		int32_t index = Lookup(minuteOfYear - narrow_min);
+		return (index >= 0) && ((index & 1) == 0) && (SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index + 1]) > (minuteOfYear + narrow_min));
+	}
+
+	/* Widened - open if an open transition is at most -narrow_min ahead or the close transition less than -narrow_min behind */
+	int32_t index = Lookup(minuteOfYear - narrow_min);
+	return (index >= 0) && (((index & 1) == 0) || (SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index]) > (minuteOfYear + narrow_min)));
+}
+
+bool Schedule_Day(uint32_t dayOfYear, int32_t *open, int32_t *close)
+{
+	int32_t dayStart = (int32_t)(dayOfYear - 1U) * SCHEDULE_MINUTES_PER_DAY;
+	int32_t index = Lookup(dayStart + SCHEDULE_MINUTES_PER_DAY - 1);
+	if((index < 0) || (SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index]) < dayStart)) return false;
+
+	/* The close transition of a day can be 00:00 of the next day - the open one is always within the day */
+	if((index & 1) == 0) index++;
+	else if(SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index - 1]) < dayStart) return false;
+	*open = SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index - 1]) - dayStart;
+	*close = SCHEDULE_TRANSITION_MINUTE(ScheduleTable[index]) - dayStart;
+	return true;
+}
@@ -0,0 +1,231 @@
+/* SiteConfig.c - the site configuration block in the flash, read in place through the XIP window (see SiteConfig.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+/* Include files from other tasks */
+#include "SiteConfig.h"
+#include "BootControl.h"
+#include "UsbLink.h"
+#include "Watchdog.h"
+#include "Update.h"
+#include "Hash.h"
+#include "Debounce.h"
+#include "LightSensor.h"
+#include "NodeBus.h"
+#include "MotorControllerTask.h"
+#include "AutomaticControlTask.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define SITE_CONFIG_MAX_DEBOUNCE_IN_US		(255U * DEBOUNCE_STORE_UNIT_IN_US)	/* the learned windows are kept in a byte */
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* The build defaults - the CRC is not checked for them */
+const SiteConfig_t SiteConfigDefault =
+{
+	.magic = SITE_CONFIG_MAGIC,
+	.version = SITE_CONFIG_VERSION,
+	.size = SITE_CONFIG_SIZE,
+	.latitude = LATITUDE_SIEROSZEWICE_NOWA_10,
+	.longitude = LONGITUDE_SIEROSZEWICE_NOWA_10,
+	.timeZone = TIME_ZONE_PLUS_TO_E,
+	.automaticControlPeriod_ms = AUTOMATIC_CONTROL_TASK_PERIOD,
+	.debounceButton_us = DEBOUNCING_DELAY_IN_US,
+	.debounceLimit_us = DEBOUNCING_DELAY_IN_US_LIMITTER,
+	.channels =
+	{
+		.inputGpio =
+		{
+			[CHANNEL_INPUT_UP]           = {BUTTON_UP,           CH1_BUTTON_UP,           CH2_BUTTON_UP,           CH3_BUTTON_UP},
+			[CHANNEL_INPUT_DOWN]         = {BUTTON_DOWN,         CH1_BUTTON_DOWN,         CH2_BUTTON_DOWN,         CH3_BUTTON_DOWN},
+			[CHANNEL_INPUT_TOP_LIMIT]    = {BUTTON_TOP_LIMIT,    CH1_BUTTON_TOP_LIMIT,    CH2_BUTTON_TOP_LIMIT,    CH3_BUTTON_TOP_LIMIT},
+			[CHANNEL_INPUT_BOTTOM_LIMIT] = {BUTTON_BOTTOM_LIMIT, CH1_BUTTON_BOTTOM_LIMIT, CH2_BUTTON_BOTTOM_LIMIT, CH3_BUTTON_BOTTOM_LIMIT},
+		},
+		.motorControl1Gpio = {MOTOR_CONTROL_1, CH1_MOTOR_CONTROL_1, CH2_MOTOR_CONTROL_1, CH3_MOTOR_CONTROL_1},
+		.motorControl2Gpio = {MOTOR_CONTROL_2, CH1_MOTOR_CONTROL_2, CH2_MOTOR_CONTROL_2, CH3_MOTOR_CONTROL_2},
+	},
+	.lightDarkThreshold = LIGHT_LEVEL_DARK_THRESHOLD,
+	.lightBrightThreshold = LIGHT_LEVEL_BRIGHT_THRESHOLD,
+	.lightHysteresis = LIGHT_LEVEL_HYSTERESIS,
+	.busAddress = NODE_BUS_ADDRESS,
+	.busGroups = NODE_BUS_GROUPS,
+	.busLeader = NODE_BUS_LEADER,
+};
+
+const SiteConfig_t *SiteConfig = &SiteConfigDefault;
+
+static const char *SiteConfigFlashState = "erased";		/* why the block in the flash is not used, "ok" if it is */
+static uint8_t SiteConfigPage[FLASH_PAGE_SIZE] __attribute__((aligned(8)));
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+bool SiteConfigGpiosValid(const ChannelConfig_t *channels);
+bool SiteConfigMotorsOff(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Every pin of the channels this build drives on a GPIO of its own, none of them reserved */
+bool SiteConfigGpiosValid(const ChannelConfig_t *channels)
+{
+	uint32_t used = SITE_CONFIG_RESERVED_GPIOS;
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		uint32_t gpios[CHANNEL_NUM_OF_INPUTS + 2U];
+		for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+		{
+			gpios[input] = channels->inputGpio[input][channel];
+		}
+		gpios[CHANNEL_NUM_OF_INPUTS] = channels->motorControl1Gpio[channel];
+		gpios[CHANNEL_NUM_OF_INPUTS + 1U] = channels->motorControl2Gpio[channel];
+
+		for(uint32_t i = 0; i < (CHANNEL_NUM_OF_INPUTS + 2U); i++)
+		{
+			if((gpios[i] >= SITE_CONFIG_NUM_OF_GPIOS) || ((used & (1UL << gpios[i])) != 0U)) return false;
+			used |= (1UL << gpios[i]);
+		}
+	}
+	return true;
+}
+
+/* The flash operations stop both cores - not while a motor runs (limit switch response time) */
+bool SiteConfigMotorsOff(void)
+{
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		if(CurrentState[channel] != STATE_OFF) return false;
+	}
+	return true;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void SiteConfig_Init(void)
+{
+	const SiteConfig_t *flash = (const SiteConfig_t *)BOOT_FLASH_PTR(BOOT_CONFIG_OFFSET);
+	const char *problem = SiteConfig_Check(flash);
+
+	if(problem == NULL)
+	{
+		SiteConfig = flash;
+		SiteConfigFlashState = "ok";
+	}
+	else
+	{
+		SiteConfigFlashState = problem;
+	}
+	LOG("SiteConfig: %s (flash block %s)\n", (SiteConfig == flash) ? "flash" : "defaults", SiteConfigFlashState);
+}
+
+const char* SiteConfig_Check(const SiteConfig_t *config)
+{
+	if(config->magic != SITE_CONFIG_MAGIC) return (config->magic == 0xFFFFFFFFU) ? "erased" : "magic";
+	if(config->version != SITE_CONFIG_VERSION) return "version";
+	if(config->size != sizeof(SiteConfig_t)) return "size";
+	if(config->crc != Hash_Crc32(config, offsetof(SiteConfig_t, crc))) return "crc";
+
+	/* The comparisons are false for a NaN as well */
+	if(!(fabs(config->latitude) <= SITE_CONFIG_MAX_LATITUDE)) return "latitude";
+	if(!(fabs(config->longitude) <= 180.0)) return "longitude";
+	if((config->timeZone < SITE_CONFIG_MIN_TIME_ZONE) || (config->timeZone > SITE_CONFIG_MAX_TIME_ZONE)) return "timezone";
+	if((config->automaticControlPeriod_ms < SITE_CONFIG_MIN_PERIOD_IN_MS) || (config->automaticControlPeriod_ms > AUTOMATIC_CONTROL_TASK_PERIOD))
+	{
+		return "period";
+	}
+	if((config->debounceButton_us < DEBOUNCE_BUTTON_MIN_IN_US) || (config->debounceButton_us > SITE_CONFIG_MAX_DEBOUNCE_IN_US)) return "debounce";
+	if((config->debounceLimit_us < DEBOUNCE_LIMIT_MIN_IN_US) || (config->debounceLimit_us > SITE_CONFIG_MAX_DEBOUNCE_IN_US)) return "debounce";
+	if(!SiteConfigGpiosValid(&config->channels)) return "gpio";
+
+	/* LightLevelWithHysteresis - the bands around the thresholds neither overlap nor wrap */
+	uint32_t dark = config->lightDarkThreshold, bright = config->lightBrightThreshold, hysteresis = config->lightHysteresis;
+	if((hysteresis > dark) || ((dark + hysteresis) >= (bright - hysteresis)) || ((bright + hysteresis) > SITE_CONFIG_MAX_LIGHT_LEVEL))
+	{
+		return "light";
+	}
+	if((config->busAddress == 0U) || (config->busAddress > NODE_BUS_MAX_ADDRESS) || (config->busLeader > 1U)) return "bus";
+	return NULL;
+}
+
+/* USB link CONFIG_INFO command -> #CONFIG <flash|default> <version> <CRC of the block in use> <state of the flash block> */
+void SiteConfig_Info(void)
+{
+	UsbLink_Respond("CONFIG %s %u %08lx %s", (SiteConfig == &SiteConfigDefault) ? "default" : "flash", (unsigned)SiteConfig->version,
+					(unsigned long)Hash_Crc32(SiteConfig, offsetof(SiteConfig_t, crc)), SiteConfigFlashState);
+}
+
+/* Payload: offset (32-bit LE) in the block in use -> #CDATA <offset> <up to SITE_CONFIG_DATA_CHUNK bytes in hex>, none at the end */
+void SiteConfig_Read(const uint8_t *payload, uint32_t length)
+{
+	char hex[(2U * SITE_CONFIG_DATA_CHUNK) + 1U];
+
+	if(length < SITE_CONFIG_READ_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR size 0");
+		return;
+	}
+	uint32_t offset = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	uint32_t count = (offset < sizeof(SiteConfig_t)) ? (sizeof(SiteConfig_t) - offset) : 0U;
+	count = (count > SITE_CONFIG_DATA_CHUNK) ? SITE_CONFIG_DATA_CHUNK : count;
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		snprintf(&hex[2U * i], 3U, "%02x", ((const uint8_t *)SiteConfig)[offset + i]);
+	}
+	hex[2U * count] = '\0';
+	UsbLink_Respond("CDATA %lu %s", (unsigned long)offset, hex);
+}
+
+/* Payload: the whole block, its CRC included - checked like at the boot, programmed into the config sector, the board reboots into it */
+void SiteConfig_Write(const uint8_t *payload, uint32_t length)
+{
+	if(length != sizeof(SiteConfig_t))
+	{
+		UsbLink_Respond("ERR size 0");
+		return;
+	}
+	memset(SiteConfigPage, 0xFF, sizeof(SiteConfigPage));
+	memcpy(SiteConfigPage, payload, length);
+	const char *problem = SiteConfig_Check((const SiteConfig_t *)SiteConfigPage);
+	if(problem != NULL)
+	{
+		UsbLink_Respond("ERR %s 0", problem);
+		return;
+	}
+	if(!SiteConfigMotorsOff())
+	{
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+
+	/* Nothing reads the sector while it is erased - the build defaults until the reboot (or for good if the write fails) */
+	SiteConfig = &SiteConfigDefault;
+	SiteConfigFlashState = "erased";
+	Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+	bool ok = BootControl_Erase(BOOT_CONFIG_OFFSET) && BootControl_Program(BOOT_CONFIG_OFFSET, SiteConfigPage, FLASH_PAGE_SIZE);
+	Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+	Watchdog_CheckIn(WATCHDOG_CLIENT_USB_LINK);
+	if(!ok || (memcmp(BOOT_FLASH_PTR(BOOT_CONFIG_OFFSET), SiteConfigPage, length) != 0))
+	{
+		UsbLink_Respond("ERR flash 0");
+		return;
+	}
+	/* The modules took their configuration at the boot - all of them take the new one with the reboot */
+	UsbLink_Respond("ACK 0");
+	vTaskDelay(pdMS_TO_TICKS(UPDATE_REBOOT_DELAY_IN_MS));
+	Watchdog_Reboot();
+}
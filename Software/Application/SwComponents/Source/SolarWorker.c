@@ -0,0 +1,147 @@
+/* SolarWorker.c - background task of the automatic control: reads the clock, computes the schedule of the year and the sun of
+   the day, and publishes them for AutomaticControlTask (see SolarWorker.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/* Include files from other tasks */
+#include "SolarWorker.h"
+#include "AutomaticControlTask.h"
+#include "ElectronicBlinds_Main.h"
+#include "CycleCounter.h"
+#include "LightSensor.h"
+#include "Schedule.h"
+#include "SunTracker.h"
+#include "Trace.h"
+#include "TimeSync.h"
+#include "Debounce.h"
+#include "SiteConfig.h"
+
+/* Includes from the DS1307 library */
+#include "DS1307.h"
+#include "I2C_Driver.h"
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+SemaphoreHandle_t SolarDaySemaphore;
+SolarWorkerStats_t SolarWorkerStats;
+
+/* The latch - readers take SolarDays[SolarSequence & 1], the worker writes the other copy */
+static SolarDay_t SolarDays[2];
+static volatile uint32_t SolarSequence;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+void SolarWorkerPublish(const SolarDay_t *day)
+{
+	/* Readers to the second copy, the first one written - then back to the first one, the second one written */
+	SolarSequence = SolarSequence + 1U;
+	__dmb();
+	SolarDays[0] = *day;
+	__dmb();
+	SolarSequence = SolarSequence + 1U;
+	__dmb();
+	SolarDays[1] = *day;
+	__dmb();
+	SolarWorkerStats.publishes++;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+bool SolarWorker_Read(SolarDay_t *day)
+{
+	for(uint32_t tries = 0; tries < SOLAR_WORKER_MAX_READ_TRIES; tries++)
+	{
+		uint32_t sequence = SolarSequence;
+		__dmb();
+		*day = SolarDays[sequence & 1U];
+		__dmb();
+		if(SolarSequence == sequence)
+		{
+			return day->run != 0U;
+		}
+		SolarWorkerStats.readRetries++;
+	}
+	return false;
+}
+
+/* TASK MAIN FUNCTION */
+void SolarWorkerTask( void *pvParameters )
+{
+	/* Set up task schedule */
+	TickType_t xTaskStartTime;
+	const TickType_t xTaskPeriod = pdMS_TO_TICKS(SiteConfig->automaticControlPeriod_ms);	/* at most AUTOMATIC_CONTROL_TASK_PERIOD (SiteConfig_Check) */
+	xTaskStartTime = xTaskGetTickCount();
+	SolarDay_t day = { 0 };
+
+	/* Infinite task loop */
+	for( ;; )
+	{
+		/* The RTC is not set by the USB link in the middle of a run - the drift correction first, it may step the clock */
+		(void)xSemaphoreTake(RtcMutex, portMAX_DELAY);
+		TimeSync_Service();
+		Debounce_Service();
+		CycleTimestamp_t jobStart = CycleCounter_TaskStart();
+		/* Read current hour and minute (warning - will be incorrect during DST since it's adjusted at sunrise/sunset time) */
+		day.hourBCD = Trace_I2cRead(DS1307_REG_ADDR_HOURS);
+		day.minuteBCD = Trace_I2cRead(DS1307_REG_ADDR_MINUTES);
+		/* Check if the blinds are currently closed (this is stored in RTC's RAM so it persists as long as RTC has power) */
+		day.isClosed = Trace_I2cRead(DS1307_REG_ADDR_IS_CLOSED);
+
+		day.dayBCD = Trace_I2cRead(DS1307_REG_ADDR_DAYS);
+		day.monthBCD = Trace_I2cRead(DS1307_REG_ADDR_MONTHS);
+		day.yearBCD = Trace_I2cRead(DS1307_REG_ADDR_YEARS);
+		xSemaphoreGive(RtcMutex);
+		day.dayOfYear = CalculateDayOfYear(day.yearBCD, day.monthBCD, day.dayBCD);
+
+		/* The sunrise/sunset (with the DST correction) and the rules of every day are in the compiled table - the first run and
+		   the new year compile it, the table in use stays untouched until the new one is complete */
+		uint32_t year = ConvertBCD(day.yearBCD, BCD_TO_DEC) + 2000U;
+		if(Schedule_Year() != year)
+		{
+			Schedule_Compile(&ScheduleConfig, year);
+			SolarWorkerStats.compiles++;
+		}
+		day.minuteOfYear = ((int32_t)(day.dayOfYear - 1U) * SCHEDULE_MINUTES_PER_DAY) + (ConvertBCD(day.hourBCD, BCD_TO_DEC) * 60) + ConvertBCD(day.minuteBCD, BCD_TO_DEC);
+
+#if (GLARE_CONTROL_ENABLED == 1)
+		/* The declination and the equation of time of the day - once a day, and when the DST starts or ends */
+		int32_t utcOffset_min = (SiteConfig->timeZone - (isDST(day.yearBCD, day.monthBCD, day.dayBCD) ? 0 : 1)) * 60;
+		if((day.run == 0U) || (day.sunDay.dayOfYear != day.dayOfYear) || (day.sunDay.utcOffset_min != utcOffset_min))
+		{
+			SunTracker_BeginDay(&day.sunDay, SiteConfig->latitude, SiteConfig->longitude, day.dayOfYear, utcOffset_min);
+			SolarWorkerStats.sunDays++;
+		}
+#endif
+
+		day.run++;
+		SolarWorkerPublish(&day);
+		CycleCounter_TaskStop(CYCLES_TASK_SOLAR_WORKER, jobStart);
+		xSemaphoreGive(SolarDaySemaphore);
+
+#if (LIGHT_SENSOR_ENABLED == 1)
+		/* Delay until next cycle of the task - a change of the light level wakes the task up earlier (the period stays the same) */
+		TickType_t xNextRunTime = xTaskStartTime + xTaskPeriod;
+		TickType_t xTimeNow = xTaskGetTickCount();
+		TickType_t xBlockTime = ((int32_t)(xNextRunTime - xTimeNow) > 0) ? (xNextRunTime - xTimeNow) : 0U;
+		if(xSemaphoreTake(LightLevelSemaphore, xBlockTime) == pdFALSE)
+		{
+			xTaskStartTime = xNextRunTime;
+		}
+#else
+		/* Delay until next cycle of the task */
+		vTaskDelayUntil(&xTaskStartTime, xTaskPeriod);
+#endif
+	}
+}
@@ -0,0 +1,124 @@
+/* SunTracker.c - position of the sun stepped minute by minute from a base state of the day, and the blind position
+   that keeps its direct light out of the room (see SunTracker.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <math.h>
+
+/* Include files from other tasks */
+#include "SunTracker.h"
+#include "AutomaticControlTask.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define SUN_TRACKER_COS_STEP				(0.99999048f)	/* cos(SUN_TRACKER_STEP_DEG) */
+#define SUN_TRACKER_SIN_STEP				(0.00436331f)	/* sin(SUN_TRACKER_STEP_DEG) */
+#define SUN_TRACKER_DEG_TO_RAD				((float)M_PI / 180.0f)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+#if (GLARE_CONTROL_ENABLED == 1)
+const SunTrackerWindow_t SunTrackerWindows[BLINDS_MAX_NUM_OF_CHANNELS] =
+{
+	/* South window under a 30cm eave - the sun may reach half a meter past the sill */
+	[0] = { true, 180.0f, 1200.0f, 300.0f, 200.0f, 500.0f },
+};
+#else
+const SunTrackerWindow_t SunTrackerWindows[BLINDS_MAX_NUM_OF_CHANNELS];
+#endif
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void SunTracker_BeginDay(SunTracker_t *tracker, double latitude, double longitude, uint32_t dayOfYear, int32_t utcOffset_min)
+{
+	double declination, eqOfTime;
+	CalculateSolarDay((int)dayOfYear, (int)(utcOffset_min / 60), &declination, &eqOfTime);
+
+	float sinLat = (float)sin(degToRad(latitude)), cosLat = (float)cos(degToRad(latitude));
+	float sinDecl = (float)sin(degToRad(declination)), cosDecl = (float)cos(degToRad(declination));
+	tracker->dayOfYear = dayOfYear;
+	tracker->utcOffset_min = utcOffset_min;
+	tracker->solarOffset_min = (float)((4.0 * longitude) + eqOfTime - (double)utcOffset_min);
+	tracker->sinLatSinDecl = sinLat * sinDecl;
+	tracker->cosLatCosDecl = cosLat * cosDecl;
+	tracker->cosLatSinDecl = cosLat * sinDecl;
+	tracker->sinLatCosDecl = sinLat * cosDecl;
+	tracker->cosDecl = cosDecl;
+	for(uint32_t channel = 0; channel < BLINDS_MAX_NUM_OF_CHANNELS; channel++)
+	{
+		tracker->windowEast[channel] = sinf(SunTrackerWindows[channel].azimuth_deg * SUN_TRACKER_DEG_TO_RAD);
+		tracker->windowNorth[channel] = cosf(SunTrackerWindows[channel].azimuth_deg * SUN_TRACKER_DEG_TO_RAD);
+	}
+	tracker->minute = -1;
+}
+
+void SunTracker_Seek(SunTracker_t *tracker, int32_t minute)
+{
+	/* Hour angle - 0 at the true solar noon, a quarter of a degree per minute */
+	float hourAngle = ((((float)minute + tracker->solarOffset_min) * SUN_TRACKER_STEP_DEG) - 180.0f) * SUN_TRACKER_DEG_TO_RAD;
+	tracker->cosHourAngle = cosf(hourAngle);
+	tracker->sinHourAngle = sinf(hourAngle);
+	tracker->minute = minute;
+}
+
+void SunTracker_Advance(SunTracker_t *tracker, int32_t minute)
+{
+	if((tracker->minute < 0) || (minute < tracker->minute) || ((minute - tracker->minute) > SUN_TRACKER_MAX_STEPS))
+	{
+		SunTracker_Seek(tracker, minute);
+		return;
+	}
+
+	/* Rotation of (cos H, sin H) by the step - the rounding errors of a day of steps stay below 1e-4 */
+	float cosHourAngle = tracker->cosHourAngle, sinHourAngle = tracker->sinHourAngle;
+	for(; tracker->minute < minute; tracker->minute++)
+	{
+		float cosNext = (cosHourAngle * SUN_TRACKER_COS_STEP) - (sinHourAngle * SUN_TRACKER_SIN_STEP);
+		sinHourAngle = (sinHourAngle * SUN_TRACKER_COS_STEP) + (cosHourAngle * SUN_TRACKER_SIN_STEP);
+		cosHourAngle = cosNext;
+	}
+	tracker->cosHourAngle = cosHourAngle;
+	tracker->sinHourAngle = sinHourAngle;
+}
+
+void SunTracker_Direction(const SunTracker_t *tracker, float *east, float *north, float *up)
+{
+	*east = -tracker->cosDecl * tracker->sinHourAngle;
+	*north = tracker->cosLatSinDecl - (tracker->sinLatCosDecl * tracker->cosHourAngle);
+	*up = tracker->sinLatSinDecl + (tracker->cosLatCosDecl * tracker->cosHourAngle);
+}
+
+void SunTracker_ElevationAzimuth(const SunTracker_t *tracker, float *elevation_deg, float *azimuth_deg)
+{
+	float east, north, up;
+	SunTracker_Direction(tracker, &east, &north, &up);
+	*elevation_deg = asinf(fminf(fmaxf(up, -1.0f), 1.0f)) / SUN_TRACKER_DEG_TO_RAD;
+	*azimuth_deg = atan2f(east, north) / SUN_TRACKER_DEG_TO_RAD;
+	if(*azimuth_deg < 0.0f) *azimuth_deg += 360.0f;
+}
+
+float SunTracker_GlarePosition(const SunTracker_t *tracker, uint32_t channel)
+{
+	const SunTrackerWindow_t *window = &SunTrackerWindows[channel];
+	float east, north, up;
+
+	SunTracker_Direction(tracker, &east, &north, &up);
+	float towardWindow = (east * tracker->windowEast[channel]) + (north * tracker->windowNorth[channel]);
+	if(!window->enabled || (up <= 0.0f) || (towardWindow <= 0.0f))
+	{
+		return 0.0f;
+	}
+
+	/* Tangent of the profile angle - the elevation of the sun in the vertical plane across the window. The overhang
+	   shades the glass down to its shadow line, the light through the glass at a height reaches that height / tan into the room */
+	float tanProfile = up / towardWindow;
+	float shadow_mm = (window->overhangDepth_mm * tanProfile) - window->overhangGap_mm;
+	float litTop_mm = window->height_mm - ((shadow_mm > 0.0f) ? shadow_mm : 0.0f);
+	float allowed_mm = window->penetration_mm * tanProfile;
+	if((litTop_mm <= 0.0f) || (allowed_mm >= litTop_mm))
+	{
+		return 0.0f;
+	}
+	return (window->height_mm - allowed_mm) / window->height_mm;
+}
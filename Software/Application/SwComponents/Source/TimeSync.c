@@ -0,0 +1,385 @@
+/* TimeSync.c - the DS1307 set over the USB link from the UTC of the host, and the correction of its drift between the syncs
+   (see TimeSync.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+/* Include files from other tasks */
+#include "TimeSync.h"
+#include "AutomaticControlTask.h"
+#include "UsbLink.h"
+#include "Watchdog.h"
+#include "Hash.h"
+#include "ElectronicBlinds_Main.h"
+#include "SiteConfig.h"
+#include "PowerMonitor.h"
+
+/* Includes from the DS1307 library */
+#include "DS1307.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define TIME_SYNC_NUM_OF_TIME_REGISTERS		(7U)	/* seconds .. years */
+#define TIME_SYNC_SECONDS_PER_DAY			(86400U)
+#define TIME_SYNC_MAX_SECONDS				(36524U * TIME_SYNC_SECONDS_PER_DAY)	/* 2000 .. 2099 - the years of the DS1307 */
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+TimeSyncState_t TimeSyncState;
+TimeSyncStats_t TimeSyncStats;
+SemaphoreHandle_t RtcMutex;
+
+static bool TimeSyncStateLoaded;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+bool TimeSyncRead(uint8_t reg, uint8_t *data, uint32_t length);
+bool TimeSyncWrite(uint8_t reg, const uint8_t *data, uint32_t length);
+uint32_t TimeSyncDaysBeforeYear(uint32_t year);
+uint32_t TimeSyncSeconds(const uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS]);
+void TimeSyncRegisters(uint32_t seconds, uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS]);
+uint32_t TimeSyncLocal(uint32_t utcSeconds, int32_t *utcOffset_min);
+bool TimeSyncValid(void);
+void TimeSyncLoadState(void);
+bool TimeSyncSaveState(void);
+bool TimeSyncPause(void);
+bool TimeSyncWaitForEdge(uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS], uint64_t *edge_us);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Bursts on I2C0 - the register pointer of the DS1307 increments after every byte, the time registers are latched at the START */
+bool TimeSyncRead(uint8_t reg, uint8_t *data, uint32_t length)
+{
+	return (i2c_write_timeout_us(i2c0, TIME_SYNC_DS1307_I2C_ADDRESS, &reg, 1U, true, TIME_SYNC_I2C_TIMEOUT_IN_US) == 1) &&
+		   (i2c_read_timeout_us(i2c0, TIME_SYNC_DS1307_I2C_ADDRESS, data, length, false, TIME_SYNC_I2C_TIMEOUT_IN_US) == (int)length);
+}
+
+bool TimeSyncWrite(uint8_t reg, const uint8_t *data, uint32_t length)
+{
+	uint8_t frame[1U + sizeof(TimeSyncState_t)];
+
+	frame[0] = reg;
+	memcpy(&frame[1], data, length);
+	return i2c_write_timeout_us(i2c0, TIME_SYNC_DS1307_I2C_ADDRESS, frame, length + 1U, false, TIME_SYNC_I2C_TIMEOUT_IN_US) == (int)(length + 1U);
+}
+
+/* 2000 .. 2099 - every 4th year is a leap year */
+uint32_t TimeSyncDaysBeforeYear(uint32_t year)
+{
+	return ((year - 2000U) * 365U) + ((year - 2000U + 3U) / 4U);
+}
+
+/* Time registers -> seconds since 2000 */
+uint32_t TimeSyncSeconds(const uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS])
+{
+	uint32_t year = ConvertBCD(registers[DS1307_REG_ADDR_YEARS], BCD_TO_DEC) + 2000U;
+	uint32_t day = TimeSyncDaysBeforeYear(year) + CalculateDayOfYear(registers[DS1307_REG_ADDR_YEARS], registers[DS1307_REG_ADDR_MONTHS],
+																	 registers[DS1307_REG_ADDR_DAYS]) - 1U;
+	return (day * TIME_SYNC_SECONDS_PER_DAY) + (ConvertBCD(registers[DS1307_REG_ADDR_HOURS] & 0x3FU, BCD_TO_DEC) * 3600U) +
+		   (ConvertBCD(registers[DS1307_REG_ADDR_MINUTES], BCD_TO_DEC) * 60U) + ConvertBCD(registers[DS1307_REG_ADDR_SECONDS] & 0x7FU, BCD_TO_DEC);
+}
+
+/* Seconds since 2000 -> time registers (24h mode, the oscillator running) */
+void TimeSyncRegisters(uint32_t seconds, uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS])
+{
+	uint32_t daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	uint32_t days = seconds / TIME_SYNC_SECONDS_PER_DAY, secondOfDay = seconds % TIME_SYNC_SECONDS_PER_DAY;
+	uint32_t year = 2000U, month = 1U;
+
+	while(days >= (TimeSyncDaysBeforeYear(year + 1U) - TimeSyncDaysBeforeYear(year)))
+	{
+		days -= TimeSyncDaysBeforeYear(year + 1U) - TimeSyncDaysBeforeYear(year);
+		year++;
+	}
+	if(isLeapYear(year))
+	{
+		daysInMonth[2] = 29;
+	}
+	while(days >= daysInMonth[month])
+	{
+		days -= daysInMonth[month];
+		month++;
+	}
+
+	registers[DS1307_REG_ADDR_SECONDS] = ConvertBCD((uint8_t)(secondOfDay % 60U), DEC_TO_BCD);
+	registers[DS1307_REG_ADDR_MINUTES] = ConvertBCD((uint8_t)((secondOfDay / 60U) % 60U), DEC_TO_BCD);
+	registers[DS1307_REG_ADDR_HOURS] = ConvertBCD((uint8_t)(secondOfDay / 3600U), DEC_TO_BCD);
+	registers[3] = (uint8_t)(ZellersCongruence((int)year, (int)month, (int)days + 1) + 1U);	/* day of the week, 1 - Monday */
+	registers[DS1307_REG_ADDR_DAYS] = ConvertBCD((uint8_t)(days + 1U), DEC_TO_BCD);
+	registers[DS1307_REG_ADDR_MONTHS] = ConvertBCD((uint8_t)month, DEC_TO_BCD);
+	registers[DS1307_REG_ADDR_YEARS] = ConvertBCD((uint8_t)(year - 2000U), DEC_TO_BCD);
+}
+
+/* Local civil time of a UTC - the standard time of the zone, an hour more on the days isDST takes as DST (like the schedule does) */
+uint32_t TimeSyncLocal(uint32_t utcSeconds, int32_t *utcOffset_min)
+{
+	uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS];
+
+	*utcOffset_min = (SiteConfig->timeZone - 1) * 60;
+	TimeSyncRegisters(utcSeconds + (uint32_t)(*utcOffset_min * 60), registers);
+	if(isDST(registers[DS1307_REG_ADDR_YEARS], registers[DS1307_REG_ADDR_MONTHS], registers[DS1307_REG_ADDR_DAYS]))
+	{
+		*utcOffset_min += 60;
+	}
+	return utcSeconds + (uint32_t)(*utcOffset_min * 60);
+}
+
+bool TimeSyncValid(void)
+{
+	return (TimeSyncState.magic == TIME_SYNC_MAGIC) && (TimeSyncState.crc == Hash_Crc32(&TimeSyncState, offsetof(TimeSyncState_t, crc)));
+}
+
+/* Read once - afterwards the RAM copy is the state (RtcMutex taken) */
+void TimeSyncLoadState(void)
+{
+	if(!TimeSyncStateLoaded && TimeSyncRead(TIME_SYNC_NVRAM_ADDR, (uint8_t*)&TimeSyncState, sizeof(TimeSyncState)))
+	{
+		TimeSyncStateLoaded = true;
+	}
+}
+
+bool TimeSyncSaveState(void)
+{
+	TimeSyncState.magic = TIME_SYNC_MAGIC;
+	TimeSyncState.crc = Hash_Crc32(&TimeSyncState, offsetof(TimeSyncState_t, crc));
+	return TimeSyncWrite(TIME_SYNC_NVRAM_ADDR, (const uint8_t*)&TimeSyncState, sizeof(TimeSyncState));
+}
+
+/* One poll step of a wait with the RTC taken - false once the supply fails. The flush of the supply monitor then gets the mutex
+   within a step instead of waiting out the rest of the second (and giving up) */
+bool TimeSyncPause(void)
+{
+	vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_EDGE_POLL_IN_MS));
+#if (POWER_MONITOR_ENABLED == 1)
+	return !PowerMonitor_Failing();
+#else
+	return true;
+#endif
+}
+
+/* Polls the seconds register until it changes - the time registers of the new second and the time of the change
+   (halfway between the last two polls) */
+bool TimeSyncWaitForEdge(uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS], uint64_t *edge_us)
+{
+	uint8_t first, seconds;
+
+	uint64_t before_us = time_us_64();
+	if(!TimeSyncRead(DS1307_REG_ADDR_SECONDS, &first, 1U))
+	{
+		return false;
+	}
+	for(uint32_t poll = 0; poll < (TIME_SYNC_EDGE_TIMEOUT_IN_MS / TIME_SYNC_EDGE_POLL_IN_MS); poll++)
+	{
+		if(!TimeSyncPause())
+		{
+			return false;
+		}
+		uint64_t now_us = time_us_64();
+		if(!TimeSyncRead(DS1307_REG_ADDR_SECONDS, &seconds, 1U))
+		{
+			return false;
+		}
+		if(seconds != first)
+		{
+			*edge_us = (before_us + now_us) / 2U;
+			return TimeSyncRead(DS1307_REG_ADDR_SECONDS, registers, TIME_SYNC_NUM_OF_TIME_REGISTERS) && (registers[DS1307_REG_ADDR_SECONDS] == seconds);
+		}
+		before_us = now_us;
+	}
+	return false;	/* the oscillator is halted */
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void TimeSync_Init(void)
+{
+	RtcMutex = xSemaphoreCreateMutex();
+}
+
+void TimeSync_Service(void)
+{
+	uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS];
+
+	TimeSyncLoadState();
+	if(!TimeSyncValid() || (TimeSyncState.drift_ppb == 0) || !TimeSyncRead(DS1307_REG_ADDR_SECONDS, registers, TIME_SYNC_NUM_OF_TIME_REGISTERS))
+	{
+		return;
+	}
+
+	/* A fast clock is stepped back - the correction due grows with the time the clock has run since the sync */
+	int64_t elapsed_s = (int64_t)TimeSyncSeconds(registers) - (int64_t)TimeSyncState.syncSeconds;
+	int64_t due_ms = -((int64_t)TimeSyncState.drift_ppb * elapsed_s) / 1000000;
+	int64_t pending_ms = due_ms - TimeSyncState.corrected_ms;
+	if((elapsed_s <= 0) || ((pending_ms < TIME_SYNC_STEP_THRESHOLD_IN_MS) && (pending_ms > -TIME_SYNC_STEP_THRESHOLD_IN_MS)))
+	{
+		return;
+	}
+
+	/* Right after the edge, so the restart of the divider chain keeps the phase of the second - never into the next minute or back
+	   into the previous one (the next run then) */
+	uint64_t edge_us;
+	int32_t step = (pending_ms > 0) ? 1 : -1;
+	if(!TimeSyncWaitForEdge(registers, &edge_us))
+	{
+		return;
+	}
+	uint8_t second = ConvertBCD(registers[DS1307_REG_ADDR_SECONDS] & 0x7FU, BCD_TO_DEC);
+	if((second < 1U) || (second > 58U))
+	{
+		return;
+	}
+	uint8_t stepped = ConvertBCD((uint8_t)((int32_t)second + step), DEC_TO_BCD);
+	if(TimeSyncWrite(DS1307_REG_ADDR_SECONDS, &stepped, 1U))
+	{
+		TimeSyncState.corrected_ms += step * 1000;
+		(void)TimeSyncSaveState();
+		TimeSyncStats.steps++;
+		LOG("time sync: stepped %+ld s, %ld ms since the sync\n", (long)step, (long)TimeSyncState.corrected_ms);
+	}
+}
+
+/* Payload: sequence (32-bit LE) -> #TIME <sequence> <local date and time of the DS1307> <drift ppb> <corrected ms> <syncs> */
+void TimeSync_Info(const uint8_t *payload, uint32_t length)
+{
+	uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS];
+
+	if(length != TIME_INFO_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	uint32_t sequence = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	if(xSemaphoreTake(RtcMutex, pdMS_TO_TICKS(TIME_SYNC_MUTEX_WAIT_IN_MS)) == pdFALSE)
+	{
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+	TimeSyncLoadState();
+	bool ok = TimeSyncRead(DS1307_REG_ADDR_SECONDS, registers, TIME_SYNC_NUM_OF_TIME_REGISTERS);
+	bool valid = TimeSyncValid();
+	xSemaphoreGive(RtcMutex);
+	if(!ok)
+	{
+		UsbLink_Respond("ERR rtc 0");
+		return;
+	}
+	UsbLink_Respond("TIME %lu 20%02x-%02x-%02x %02x:%02x:%02x %ld %ld %lu", (unsigned long)sequence, registers[DS1307_REG_ADDR_YEARS],
+					registers[DS1307_REG_ADDR_MONTHS], registers[DS1307_REG_ADDR_DAYS], registers[DS1307_REG_ADDR_HOURS] & 0x3FU,
+					registers[DS1307_REG_ADDR_MINUTES], registers[DS1307_REG_ADDR_SECONDS] & 0x7FU, valid ? (long)TimeSyncState.drift_ppb : 0L,
+					valid ? (long)TimeSyncState.corrected_ms : 0L, (unsigned long)TimeSyncStats.syncs);
+}
+
+/* Payload: host UTC in us since 1970 (64-bit LE), link delay in us (32-bit LE) -> #SYNC <offset ms> <drift ppb> <interval s> -
+   the offset of the DS1307 before the sync (0 - no earlier sync) and the interval of the drift, 0 when it was kept */
+void TimeSync_Sync(const uint8_t *payload, uint32_t length)
+{
+	uint64_t received_us = time_us_64();
+	uint8_t registers[TIME_SYNC_NUM_OF_TIME_REGISTERS];
+
+	if(length != TIME_SYNC_PAYLOAD_SIZE)
+	{
+		UsbLink_Respond("ERR length 0");
+		return;
+	}
+	uint64_t hostUtc_us = 0;
+	for(uint32_t i = 0; i < 8U; i++)
+	{
+		hostUtc_us |= (uint64_t)payload[i] << (8U * i);
+	}
+	uint32_t delay_us = (uint32_t)payload[8] | ((uint32_t)payload[9] << 8) | ((uint32_t)payload[10] << 16) | ((uint32_t)payload[11] << 24);
+
+	/* UTC (us since 2000) of the time_us_64 clock - the frame was in at received_us */
+	int64_t utcBase_us = (int64_t)hostUtc_us + (int64_t)delay_us - (TIME_SYNC_UNIX_2000_IN_S * 1000000LL) - (int64_t)received_us;
+	int64_t utcNow_us = utcBase_us + (int64_t)received_us;
+	if((utcNow_us < 0) || (utcNow_us >= ((int64_t)(TIME_SYNC_MAX_SECONDS - TIME_SYNC_SECONDS_PER_DAY) * 1000000LL)))
+	{
+		UsbLink_Respond("ERR time 0");
+		return;
+	}
+	if(xSemaphoreTake(RtcMutex, pdMS_TO_TICKS(TIME_SYNC_MUTEX_WAIT_IN_MS)) == pdFALSE)
+	{
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+
+	/* Offset of the clock running since the previous sync - its seconds edge against the UTC, in the UTC offset it was set with */
+	int32_t offset_ms = 0;
+	uint32_t interval_s = 0;
+	TimeSyncLoadState();
+	bool valid = TimeSyncValid();
+	int32_t drift_ppb = valid ? TimeSyncState.drift_ppb : 0;
+	uint64_t edge_us;
+	if(valid && TimeSyncWaitForEdge(registers, &edge_us))
+	{
+		int64_t rtcUtc_ms = ((int64_t)TimeSyncSeconds(registers) - ((int64_t)TimeSyncState.utcOffset_min * 60)) * 1000;
+		int64_t edgeUtc_ms = (utcBase_us + (int64_t)edge_us) / 1000;
+		int64_t interval = (edgeUtc_ms / 1000) - ((int64_t)TimeSyncState.syncSeconds - ((int64_t)TimeSyncState.utcOffset_min * 60));
+		int64_t offset = rtcUtc_ms - edgeUtc_ms;
+		int64_t drift = (interval > 0) ? (((offset - TimeSyncState.corrected_ms) * 1000000) / interval) : 0;
+		if((offset < INT32_MAX) && (offset > -INT32_MAX))
+		{
+			offset_ms = (int32_t)offset;
+		}
+		if((interval >= (int64_t)TIME_SYNC_MIN_INTERVAL_IN_S) && (drift <= TIME_SYNC_MAX_DRIFT_PPB) && (drift >= -TIME_SYNC_MAX_DRIFT_PPB))
+		{
+			interval_s = (uint32_t)interval;
+			drift_ppb = (int32_t)drift;
+		}
+	}
+	Watchdog_CheckIn(WATCHDOG_CLIENT_USB_LINK);
+
+	/* The next whole second far enough ahead - waited for in the poll steps, then the last microseconds with no other task switched
+	   in. A supply failing meanwhile ends the sync, the clock is left as it was */
+	int64_t second = ((utcBase_us + (int64_t)time_us_64() + TIME_SYNC_MIN_LEAD_IN_US) / 1000000LL) + 1;
+	uint64_t writeAt_us = (uint64_t)((second * 1000000LL) - utcBase_us) - TIME_SYNC_WRITE_LEAD_IN_US;
+	int32_t utcOffset_min;
+	uint32_t local = TimeSyncLocal((uint32_t)second, &utcOffset_min);
+	TimeSyncRegisters(local, registers);
+	bool ok = true;
+	while(ok && (writeAt_us > (time_us_64() + 2000U)))
+	{
+		ok = TimeSyncPause();
+	}
+	if(ok)
+	{
+		vTaskSuspendAll();
+		uint64_t now_us = time_us_64();
+		if(writeAt_us > now_us)
+		{
+			busy_wait_us_32((uint32_t)(writeAt_us - now_us));
+		}
+		ok = TimeSyncWrite(DS1307_REG_ADDR_SECONDS, registers, TIME_SYNC_NUM_OF_TIME_REGISTERS);
+		(void)xTaskResumeAll();
+	}
+
+	if(ok)
+	{
+		TimeSyncState.syncSeconds = local;
+		TimeSyncState.utcOffset_min = utcOffset_min;
+		TimeSyncState.drift_ppb = drift_ppb;
+		TimeSyncState.corrected_ms = 0;
+		ok = TimeSyncSaveState();
+	}
+	xSemaphoreGive(RtcMutex);
+	if(!ok)
+	{
+		UsbLink_Respond("ERR rtc 0");
+		return;
+	}
+	TimeSyncStats.syncs++;
+	TimeSyncStats.lastOffset_ms = offset_ms;
+	LOG("time sync: offset %ld ms over %lu s, drift %ld ppb\n", (long)offset_ms, (unsigned long)interval_s, (long)drift_ppb);
+	UsbLink_Respond("SYNC %ld %ld %lu", (long)offset_ms, (long)drift_ppb, (unsigned long)interval_s);
+}
@@ -0,0 +1,253 @@
+/* TimerService.c - every software deadline on one hardware alarm, through a hierarchical timing wheel (see TimerService.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stddef.h>
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+/* Include files from other tasks */
+#include "TimerService.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define TIMER_SERVICE_SLOT_MASK				(TIMER_SERVICE_SLOTS - 1U)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+TimerServiceStats_t TimerServiceStats;
+
+static TimerService_Timer_t *TimerWheel[TIMER_SERVICE_LEVELS][TIMER_SERVICE_SLOTS] HOT_PATH_DATA;
+static uint32_t TimerOccupied[TIMER_SERVICE_LEVELS] HOT_PATH_DATA;		/* one bit per slot with a deadline in it */
+static uint64_t TimerWheelTime HOT_PATH_DATA;		/* every deadline in the wheel is at or after it */
+static uint32_t TimerArmedCount;
+static spin_lock_t *TimerLock;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void TimerServiceLink(TimerService_Timer_t **head, TimerService_Timer_t *timer);
+void TimerServiceUnlink(TimerService_Timer_t *timer);
+void TimerServiceInsert(TimerService_Timer_t *timer);
+bool TimerServiceNext(uint32_t *level, uint32_t *slot, uint64_t *event_us);
+void TimerServiceProgram(void);
+void TimerServiceArm(TimerService_Timer_t *timer, uint32_t delay_us, uint32_t period_us);
+void TimerServiceAlarmHandler(void);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+void HOT_PATH_FUNC(TimerServiceLink)(TimerService_Timer_t **head, TimerService_Timer_t *timer)
+{
+	timer->next = *head;
+	if(timer->next != NULL) timer->next->pprev = &timer->next;
+	timer->pprev = head;
+	*head = timer;
+}
+
+/* Out of its slot - the slot loses its occupancy bit with its last deadline */
+void HOT_PATH_FUNC(TimerServiceUnlink)(TimerService_Timer_t *timer)
+{
+	*timer->pprev = timer->next;
+	if(timer->next != NULL) timer->next->pprev = timer->pprev;
+	if(TimerWheel[timer->level][timer->slot] == NULL)
+	{
+		TimerOccupied[timer->level] &= ~(1u << timer->slot);
+	}
+	timer->pprev = NULL;
+	timer->next = NULL;
+	TimerArmedCount--;
+}
+
+/* The level of the highest bit the deadline differs in from the time of the wheel, the slot of its bits there. Every deadline
+   of a level-0 slot is the same microsecond, a slot of a higher level starts after every slot below it */
+void HOT_PATH_FUNC(TimerServiceInsert)(TimerService_Timer_t *timer)
+{
+	uint64_t at_us = (timer->deadline_us > TimerWheelTime) ? timer->deadline_us : TimerWheelTime;
+	uint64_t differ = at_us ^ TimerWheelTime;
+	uint32_t level = (differ == 0U) ? 0U : ((63U - (uint32_t)__builtin_clzll(differ)) / TIMER_SERVICE_SLOT_BITS);
+	uint32_t slot = (uint32_t)(at_us >> (level * TIMER_SERVICE_SLOT_BITS)) & TIMER_SERVICE_SLOT_MASK;
+
+	timer->level = (uint8_t)level;
+	timer->slot = (uint8_t)slot;
+	TimerServiceLink(&TimerWheel[level][slot], timer);
+	TimerOccupied[level] |= 1u << slot;
+	TimerArmedCount++;
+}
+
+/* The earliest slot - the first one taken in the lowest level with any, and the microsecond it starts at */
+bool HOT_PATH_FUNC(TimerServiceNext)(uint32_t *level, uint32_t *slot, uint64_t *event_us)
+{
+	for(uint32_t l = 0; l < TIMER_SERVICE_LEVELS; l++)
+	{
+		if(TimerOccupied[l] == 0U) continue;
+
+		uint32_t shift = l * TIMER_SERVICE_SLOT_BITS;
+		uint32_t above = shift + TIMER_SERVICE_SLOT_BITS;
+		uint64_t base = (above >= 64U) ? 0U : ((TimerWheelTime >> above) << above);
+		*level = l;
+		*slot = (uint32_t)__builtin_ctz(TimerOccupied[l]);
+		*event_us = base | ((uint64_t)*slot << shift);
+		return true;
+	}
+	return false;
+}
+
+/* The alarm to the earliest slot (nothing armed - a stale alarm just finds nothing due). It compares the lower 32 bits only,
+   a slot further away is reached in steps of TIMER_SERVICE_MAX_ALARM_US */
+void HOT_PATH_FUNC(TimerServiceProgram)(void)
+{
+	uint32_t level, slot;
+	uint64_t event_us;
+	if(!TimerServiceNext(&level, &slot, &event_us))
+	{
+		return;
+	}
+
+	/* A slot already due (a delay of 0) - the interrupt right away, an alarm set in the past would only match after the wrap */
+	uint64_t now = time_us_64();
+	if(event_us <= now)
+	{
+		hw_set_bits(&timer_hw->intf, 1u << TIMER_SERVICE_ALARM_NUM);
+		return;
+	}
+
+	uint32_t target = (uint32_t)event_us;
+	if((event_us - now) > TIMER_SERVICE_MAX_ALARM_US)
+	{
+		target = (uint32_t)now + TIMER_SERVICE_MAX_ALARM_US;
+	}
+	timer_hw->alarm[TIMER_SERVICE_ALARM_NUM] = target;
+	/* The alarm only fires on an exact match - if the target passed while it was set, force the interrupt */
+	if((int32_t)(target - timer_hw->timerawl) <= 0)
+	{
+		hw_set_bits(&timer_hw->intf, 1u << TIMER_SERVICE_ALARM_NUM);
+	}
+}
+
+void HOT_PATH_FUNC(TimerServiceArm)(TimerService_Timer_t *timer, uint32_t delay_us, uint32_t period_us)
+{
+	uint32_t save = spin_lock_blocking(TimerLock);
+	uint64_t now = time_us_64();
+
+	if(timer->pprev != NULL) TimerServiceUnlink(timer);
+	/* An empty wheel starts from now - no slots of the higher levels to go through for the time it was idle */
+	if(TimerArmedCount == 0U) TimerWheelTime = now;
+	timer->deadline_us = now + delay_us;
+	timer->period_us = period_us;
+	TimerServiceInsert(timer);
+	TimerServiceStats.starts++;
+	TimerServiceProgram();
+	spin_unlock(TimerLock, save);
+}
+
+void HOT_PATH_FUNC(TimerServiceAlarmHandler)(void)
+{
+	/* Clear interrupt in the timer hardware (and the forced one) */
+	hw_clear_bits(&timer_hw->intr, 1u << TIMER_SERVICE_ALARM_NUM);
+	hw_clear_bits(&timer_hw->intf, 1u << TIMER_SERVICE_ALARM_NUM);
+
+	uint64_t now = time_us_64();
+	uint32_t save = spin_lock_blocking(TimerLock);
+
+	/* The wheel up to now, slot by slot in the order of their time - the slots of the higher levels reached are spread over the
+	   levels below, the deadlines of a due level-0 slot expire one at a time, their callbacks without the lock (a callback may
+	   start or cancel any timer, the other ones of its slot too) */
+	uint32_t level, slot;
+	uint64_t event_us;
+	while(TimerServiceNext(&level, &slot, &event_us) && (event_us <= now))
+	{
+		TimerWheelTime = event_us;
+		if(level != 0U)
+		{
+			/* The whole slot down at once - a deadline left behind in it would wait for the ones moved below it */
+			while(TimerWheel[level][slot] != NULL)
+			{
+				TimerService_Timer_t *timer = TimerWheel[level][slot];
+				TimerServiceUnlink(timer);
+				TimerServiceInsert(timer);
+				TimerServiceStats.cascades++;
+			}
+			continue;
+		}
+
+		TimerService_Timer_t *timer = TimerWheel[level][slot];
+		TimerServiceUnlink(timer);
+
+		uint32_t late_us = (uint32_t)(now - timer->deadline_us);
+		if(late_us > TimerServiceStats.maxLate_us) TimerServiceStats.maxLate_us = late_us;
+		TimerServiceStats.expiries++;
+		if(timer->period_us != 0U)
+		{
+			/* Periodic - the next deadline from this one, not from now (no drift), the periods missed meanwhile skipped */
+			timer->deadline_us += timer->period_us;
+			if(timer->deadline_us <= now)
+			{
+				timer->deadline_us += (((now - timer->deadline_us) / timer->period_us) + 1U) * timer->period_us;
+			}
+			TimerServiceInsert(timer);
+		}
+		spin_unlock(TimerLock, save);
+		timer->callback(timer, timer->context);
+		save = spin_lock_blocking(TimerLock);
+	}
+
+	TimerServiceProgram();
+	spin_unlock(TimerLock, save);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void TimerService_Init(void)
+{
+	TimerLock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+	TimerWheelTime = time_us_64();
+
+	/* Reserved - hardware_alarm_claim_unused of any SDK component gets another one */
+	hardware_alarm_claim(TIMER_SERVICE_ALARM_NUM);
+
+	/* The handler is registered and the interrupt enabled once - afterwards only the alarm register is written */
+	hw_set_bits(&timer_hw->inte, 1u << TIMER_SERVICE_ALARM_NUM);
+	irq_set_exclusive_handler(TIMER_SERVICE_IRQ, TimerServiceAlarmHandler);
+	irq_set_enabled(TIMER_SERVICE_IRQ, true);
+}
+
+void TimerService_Setup(TimerService_Timer_t *timer, TimerService_Callback_t callback, void *context)
+{
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->period_us = 0U;
+	timer->callback = callback;
+	timer->context = context;
+}
+
+void HOT_PATH_FUNC(TimerService_Start)(TimerService_Timer_t *timer, uint32_t delay_us)
+{
+	TimerServiceArm(timer, delay_us, 0U);
+}
+
+void HOT_PATH_FUNC(TimerService_StartPeriodic)(TimerService_Timer_t *timer, uint32_t period_us)
+{
+	TimerServiceArm(timer, period_us, period_us);
+}
+
+void HOT_PATH_FUNC(TimerService_Cancel)(TimerService_Timer_t *timer)
+{
+	uint32_t save = spin_lock_blocking(TimerLock);
+	if(timer->pprev != NULL)
+	{
+		TimerServiceUnlink(timer);
+		TimerServiceStats.cancels++;
+	}
+	timer->period_us = 0U;
+	spin_unlock(TimerLock, save);
+}
+
+bool HOT_PATH_FUNC(TimerService_IsArmed)(const TimerService_Timer_t *timer)
+{
+	return (timer->pprev != NULL);
+}
@@ -0,0 +1,353 @@
+/* Trace.c - field trace: the GPIO edges, input reads and DS1307 register accesses the firmware takes from the outside world
+   and the motor outputs it drives, recorded into the flash for a replay in the host build (HostTools/TraceReplay) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/flash.h"
+
+/* Include files from other tasks */
+#include "Trace.h"
+#include "BootControl.h"
+#include "UsbLink.h"
+#include "Watchdog.h"
+#include "MotorControllerTask.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define TRACE_NUM_OF_REGISTERS				(64U)	/* DS1307 registers and RAM */
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+volatile TraceState_t TraceState;
+uint64_t TraceOrigin_us;
+
+static spin_lock_t *TraceLock;						/* Trace_Record runs on both cores and in the interrupt handlers */
+static TraceHeader_t TraceHeader;
+static bool TraceHeaderWritten;
+static uint8_t TraceRing[TRACE_RAM_SIZE];			/* the records from TraceProgrammed on, at their offset modulo TRACE_RAM_SIZE */
+static uint32_t TraceWritten;						/* bytes of records */
+static uint32_t TraceProgrammed;					/* bytes in the completely programmed pages */
+static uint32_t TraceFlushed;						/* bytes programmed, including a partly filled page */
+static TickType_t TraceLastFlush;
+static uint64_t TraceLast_us;
+static uint8_t TracePage[FLASH_PAGE_SIZE];
+
+/* What the trace has shown so far - the unchanged values are not recorded again */
+static uint32_t TraceInputs;
+static uint8_t TraceMotorOutputs[BLINDS_NUM_OF_CHANNELS];
+static uint8_t TraceRegisters[TRACE_NUM_OF_REGISTERS];
+static uint64_t TraceRegistersKnown;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+bool TraceMotorsOff(void);
+bool TraceChanged(TraceType_t type, uint32_t id, uint32_t value);
+uint32_t TraceVarint(uint8_t *bytes, uint64_t value);
+bool TraceProgramPage(uint32_t offset, uint32_t length);
+void TraceProgram(bool partial);
+uint32_t TraceRecordSize(const uint8_t *record, uint32_t available);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* The flash operations stop both cores - not while a motor runs (limit switch response time) */
+bool TraceMotorsOff(void)
+{
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		if(CurrentState[channel] != STATE_OFF) return false;
+	}
+	return true;
+}
+
+/* Called with TraceLock held - updates what the trace has shown */
+bool TraceChanged(TraceType_t type, uint32_t id, uint32_t value)
+{
+	switch(type)
+	{
+		case TRACE_GPIO_EDGE:
+			/* One edge tells the new level, both edges (a glitch) leave it to the next read */
+			if(value == GPIO_IRQ_EDGE_RISE) TraceInputs |= (1UL << id);
+			if(value == GPIO_IRQ_EDGE_FALL) TraceInputs &= ~(1UL << id);
+			return true;
+
+		case TRACE_INPUTS:
+			if(value == TraceInputs) return false;
+			TraceInputs = value;
+			return true;
+
+		case TRACE_I2C_READ:
+		case TRACE_I2C_WRITE:
+		{
+			uint32_t reg = id % TRACE_NUM_OF_REGISTERS;
+			bool known = ((TraceRegistersKnown >> reg) & 1U) != 0U;
+			if((type == TRACE_I2C_READ) && known && (TraceRegisters[reg] == value)) return false;
+			TraceRegisters[reg] = (uint8_t)value;
+			TraceRegistersKnown |= (1ULL << reg);
+			return true;
+		}
+
+		case TRACE_MOTOR:
+			if((id >= BLINDS_NUM_OF_CHANNELS) || (TraceMotorOutputs[id] == value)) return false;
+			TraceMotorOutputs[id] = (uint8_t)value;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+uint32_t TraceVarint(uint8_t *bytes, uint64_t value)
+{
+	uint32_t length = 0;
+	do
+	{
+		bytes[length] = (uint8_t)(value & 0x7FU);
+		value >>= 7;
+		if(value != 0U) bytes[length] |= 0x80U;
+		length++;
+	} while(value != 0U);
+	return length;
+}
+
+/* One page of records (at data offset, padded like the erased flash) - a partly filled page is programmed again
+   when more records come, the bytes already there do not change */
+bool TraceProgramPage(uint32_t offset, uint32_t length)
+{
+	memcpy(TracePage, &TraceRing[offset % TRACE_RAM_SIZE], length);
+	memset(&TracePage[length], 0xFF, FLASH_PAGE_SIZE - length);
+
+	Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+	bool ok = BootControl_Program(TRACE_DATA_OFFSET + offset, TracePage, FLASH_PAGE_SIZE);
+	Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+	return ok;
+}
+
+/* The header with the first records, the completely filled pages, and the last partly filled one if asked for */
+void TraceProgram(bool partial)
+{
+	uint32_t save = spin_lock_blocking(TraceLock);
+	uint32_t written = TraceWritten;
+	spin_unlock(TraceLock, save);
+
+	if(!TraceHeaderWritten)
+	{
+		memset(TracePage, 0xFF, sizeof(TracePage));
+		memcpy(TracePage, &TraceHeader, sizeof(TraceHeader));
+		Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+		TraceHeaderWritten = BootControl_Program(BOOT_TRACE_OFFSET, TracePage, FLASH_PAGE_SIZE);
+		Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+		if(!TraceHeaderWritten) return;
+	}
+
+	while((written - TraceProgrammed) >= FLASH_PAGE_SIZE)
+	{
+		if(!TraceProgramPage(TraceProgrammed, FLASH_PAGE_SIZE)) return;
+		save = spin_lock_blocking(TraceLock);
+		TraceProgrammed += FLASH_PAGE_SIZE;		/* the ring space of the page is free again */
+		spin_unlock(TraceLock, save);
+		TraceFlushed = TraceProgrammed;
+	}
+
+	if(partial)
+	{
+		if((written != TraceFlushed) && TraceProgramPage(TraceProgrammed, written - TraceProgrammed))
+		{
+			TraceFlushed = written;
+		}
+		TraceLastFlush = xTaskGetTickCount();
+	}
+}
+
+/* Size of the record at the start of the bytes, 0 at the end of the records (or a record cut by the end of the area) */
+uint32_t TraceRecordSize(const uint8_t *record, uint32_t available)
+{
+	if((available < 2U) || (record[0] == TRACE_END_OF_RECORDS)) return 0U;
+
+	uint32_t size = 2U;
+	for(uint32_t varint = 0; varint < 2U; varint++)
+	{
+		do
+		{
+			if(size >= available) return 0U;
+		} while((record[size++] & 0x80U) != 0U);
+	}
+	return size;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Right after the hardware setup - the inputs read from there on are recorded */
+void Trace_Init(bool fastBoot)
+{
+	const TraceHeader_t *header = (const TraceHeader_t *)BOOT_FLASH_PTR(BOOT_TRACE_OFFSET);
+
+	TraceState = TRACE_STATE_OFF;
+	if(fastBoot || (header->magic != 0xFFFFFFFFU))
+	{
+		return;
+	}
+
+	TraceLock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+	TraceOrigin_us = time_us_64();
+	TraceLast_us = TraceOrigin_us;
+	TraceHeader.magic = TRACE_MAGIC;
+	TraceHeader.version = TRACE_VERSION;
+	TraceHeader.channels = BLINDS_NUM_OF_CHANNELS;
+	TraceHeader.features = TRACE_FEATURES;
+	TraceHeader.origin_us = TraceOrigin_us;
+	TraceState = TRACE_STATE_CAPTURING;
+}
+
+void Trace_Record(TraceType_t type, uint32_t id, uint32_t value)
+{
+	uint8_t record[TRACE_MAX_RECORD_SIZE];
+
+	if(TraceState != TRACE_STATE_CAPTURING)
+	{
+		return;
+	}
+
+	uint32_t save = spin_lock_blocking(TraceLock);
+	if((TraceState == TRACE_STATE_CAPTURING) && TraceChanged(type, id, value))
+	{
+		uint64_t now = time_us_64();
+		uint32_t size = 0;
+		record[size++] = (uint8_t)type;
+		record[size++] = (uint8_t)id;
+		size += TraceVarint(&record[size], now - TraceLast_us);
+		size += TraceVarint(&record[size], value);
+
+		if((TraceWritten + size) > TRACE_DATA_SIZE)
+		{
+			TraceState = TRACE_STATE_FULL;
+		}
+		else if((TraceWritten + size - TraceProgrammed) > TRACE_RAM_SIZE)
+		{
+			TraceState = TRACE_STATE_OVERFLOW;
+		}
+		else
+		{
+			for(uint32_t i = 0; i < size; i++)
+			{
+				TraceRing[(TraceWritten + i) % TRACE_RAM_SIZE] = record[i];
+			}
+			TraceWritten += size;
+			TraceLast_us = now;
+		}
+	}
+	spin_unlock(TraceLock, save);
+}
+
+/* The full pages go to the flash as soon as the motors are off, the last partly filled one every TRACE_FLUSH_PERIOD_IN_MS */
+void Trace_Service(void)
+{
+	if((TraceLock != NULL) && TraceMotorsOff())
+	{
+		TraceProgram((xTaskGetTickCount() - TraceLastFlush) >= pdMS_TO_TICKS(TRACE_FLUSH_PERIOD_IN_MS));
+	}
+}
+
+void Trace_Flush(void)
+{
+	if(TraceLock != NULL)
+	{
+		TraceProgram(true);
+	}
+}
+
+/* While capturing, what is in the flash already - the trace of an earlier boot is scanned once */
+uint32_t Trace_Length(void)
+{
+	static bool scanned;
+	static uint32_t length;
+	const TraceHeader_t *header = (const TraceHeader_t *)BOOT_FLASH_PTR(BOOT_TRACE_OFFSET);
+	const uint8_t *records = BOOT_FLASH_PTR(TRACE_DATA_OFFSET);
+	uint32_t size;
+
+	if(TraceLock != NULL)
+	{
+		return TraceHeaderWritten ? (FLASH_PAGE_SIZE + TraceFlushed) : 0U;
+	}
+	if(!scanned && (header->magic == TRACE_MAGIC) && (header->version == TRACE_VERSION))
+	{
+		length = FLASH_PAGE_SIZE;
+		while((size = TraceRecordSize(&records[length - FLASH_PAGE_SIZE], TRACE_DATA_SIZE - (length - FLASH_PAGE_SIZE))) != 0U)
+		{
+			length += size;
+		}
+	}
+	scanned = true;
+	return length;
+}
+
+/* -> #TRACE <state> <bytes of the trace in the flash> */
+void Trace_Info(void)
+{
+	static const char *const TraceStateNames[] = { "off", "capturing", "full", "overflow" };
+
+	if(TraceMotorsOff())
+	{
+		Trace_Flush();
+	}
+	UsbLink_Respond("TRACE %s %lu", TraceStateNames[TraceState], (unsigned long)Trace_Length());
+}
+
+/* Erases the trace area and reboots - the capture runs in the cold boot that follows */
+void Trace_Start(void)
+{
+	if(!TraceMotorsOff())
+	{
+		UsbLink_Respond("ERR busy 0");
+		return;
+	}
+
+	TraceState = TRACE_STATE_OFF;
+	for(uint32_t offset = 0; offset < BOOT_TRACE_SIZE; offset += FLASH_SECTOR_SIZE)
+	{
+		Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+		bool ok = BootControl_Erase(BOOT_TRACE_OFFSET + offset);
+		Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+		Watchdog_CheckIn(WATCHDOG_CLIENT_USB_LINK);
+		if(!ok)
+		{
+			UsbLink_Respond("ERR flash 0");
+			return;
+		}
+	}
+	UsbLink_Respond("ACK 0");
+	Watchdog_Reboot();
+}
+
+/* Payload: offset (32-bit LE) in the trace area -> #TDATA <offset> <up to TRACE_DATA_CHUNK bytes in hex>, none at the end */
+void Trace_Read(const uint8_t *payload, uint32_t length)
+{
+	char hex[(2U * TRACE_DATA_CHUNK) + 1U];
+
+	if(length < 4U)
+	{
+		UsbLink_Respond("ERR size 0");
+		return;
+	}
+	uint32_t offset = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	uint32_t total = Trace_Length();
+	uint32_t count = (offset < total) ? (total - offset) : 0U;
+	count = (count > TRACE_DATA_CHUNK) ? TRACE_DATA_CHUNK : count;
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		snprintf(&hex[2U * i], 3U, "%02x", BOOT_FLASH_PTR(BOOT_TRACE_OFFSET + offset)[i]);
+	}
+	hex[2U * count] = '\0';
+	UsbLink_Respond("TDATA %lu %s", (unsigned long)offset, hex);
+}
@@ -0,0 +1,431 @@
+/* Update.c - firmware update over the USB link: the payload (full image or delta against the running image) is decoded
+   into the download slot sector by sector, verified and handed to the boot stub, which swaps it in at the next boot */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+/* Include files from other tasks */
+#include "Update.h"
+#include "BootControl.h"
+#include "UsbLink.h"
+#include "Watchdog.h"
+#include "MotorControllerTask.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+	UPDATE_DECODE_OP,
+	UPDATE_DECODE_DATA_LENGTH,
+	UPDATE_DECODE_DATA,
+	UPDATE_DECODE_ADD_OFFSET,
+	UPDATE_DECODE_ADD_LENGTH,
+	UPDATE_DECODE_ADD_SAME,
+	UPDATE_DECODE_ADD_DIFF_COUNT,
+	UPDATE_DECODE_ADD_DIFF
+}UpdateDecodeState_t;
+
+typedef struct
+{
+	bool active;
+	bool resync;							/* a gap was reported - frames are dropped quietly until the expected one comes */
+	uint32_t payloadSize;
+	uint32_t payloadOffset;					/* payload bytes decoded */
+	uint8_t hash[HASH_SHA256_SIZE];
+	UpdateDecodeState_t state;
+	uint32_t varint;
+	uint32_t varintShift;
+	uint32_t opRemaining;					/* bytes of the new image the current operation still produces */
+	uint32_t runRemaining;					/* differing bytes of the current UPDATE_OP_ADD run */
+	uint32_t baseOffset;					/* position in the running image */
+	uint32_t outputOffset;					/* bytes of the new image produced */
+	BootRequest_t request;
+}UpdateSession_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+UpdateStats_t UpdateStats;
+BootState_t UpdateBootState;
+
+static UpdateSession_t UpdateSession;
+static uint8_t UpdateSector[FLASH_SECTOR_SIZE];	/* the sector of the new image being decoded */
+static uint8_t UpdateRunningHash[HASH_SHA256_SIZE];
+static bool UpdateRunningHashValid;
+static bool UpdateConfirmPending;
+
+static const char *const UpdateBootStateNames[] = { "none", "swapping", "testing", "confirmed", "reverting", "reverted" };
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+uint32_t UpdateRead32(const uint8_t *bytes);
+bool UpdateMotorsOff(void);
+const uint8_t* UpdateGetRunningHash(void);
+void UpdateFail(const char *reason);
+bool UpdateFlushSector(uint32_t sector);
+bool UpdateOutput(uint8_t byte);
+bool UpdateDecodeNumber(uint32_t value);
+bool UpdateDecode(uint8_t byte);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t UpdateRead32(const uint8_t *bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/* The flash operations stop both cores for up to a sector erase - not while a motor runs (limit switch response time) */
+bool UpdateMotorsOff(void)
+{
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		if(CurrentState[channel] != STATE_OFF) return false;
+	}
+	return true;
+}
+
+const uint8_t* UpdateGetRunningHash(void)
+{
+	/* Hashed once per boot - the running image does not change */
+	if(!UpdateRunningHashValid)
+	{
+		BootControl_HashRunningImage(UpdateRunningHash);
+		UpdateRunningHashValid = true;
+	}
+	return UpdateRunningHash;
+}
+
+void UpdateFail(const char *reason)
+{
+	UpdateSession.active = false;
+	UsbLink_Respond("ERR %s 0", reason);
+}
+
+/* Only the sectors that differ from the running image go to the download slot (and get swapped later) */
+bool UpdateFlushSector(uint32_t sector)
+{
+	uint32_t offset = sector * FLASH_SECTOR_SIZE;
+
+	if(memcmp(UpdateSector, BOOT_FLASH_PTR(BOOT_SLOT_A_OFFSET + offset), FLASH_SECTOR_SIZE) == 0)
+	{
+		UpdateStats.sectorsUnchanged++;
+		return true;
+	}
+
+	Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+	bool ok = BootControl_WriteSector(BOOT_SLOT_B_OFFSET + offset, UpdateSector);
+	Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+
+	UpdateSession.request.changedSectors[sector / 8U] |= (uint8_t)(1U << (sector % 8U));
+	UpdateStats.sectorsWritten++;
+	return ok;
+}
+
+bool UpdateOutput(uint8_t byte)
+{
+	UpdateSector[UpdateSession.outputOffset % FLASH_SECTOR_SIZE] = byte;
+	UpdateSession.outputOffset++;
+	if((UpdateSession.outputOffset % FLASH_SECTOR_SIZE) == 0U)
+	{
+		return UpdateFlushSector((UpdateSession.outputOffset / FLASH_SECTOR_SIZE) - 1U);
+	}
+	return true;
+}
+
+/* A complete varint of the current operation */
+bool UpdateDecodeNumber(uint32_t value)
+{
+	UpdateSession_t *session = &UpdateSession;
+	uint32_t imageLeft = session->request.imageSize - session->outputOffset;
+
+	switch(session->state)
+	{
+		case UPDATE_DECODE_DATA_LENGTH:
+			if((value == 0U) || (value > imageLeft)) return false;
+			session->opRemaining = value;
+			session->state = UPDATE_DECODE_DATA;
+			return true;
+
+		case UPDATE_DECODE_ADD_OFFSET:
+			session->baseOffset = value;
+			session->state = UPDATE_DECODE_ADD_LENGTH;
+			return true;
+
+		case UPDATE_DECODE_ADD_LENGTH:
+			if((value == 0U) || (value > imageLeft) || (session->baseOffset > BootControl_RunningImageSize()) ||
+			   (value > (BootControl_RunningImageSize() - session->baseOffset))) return false;
+			session->opRemaining = value;
+			session->state = UPDATE_DECODE_ADD_SAME;
+			return true;
+
+		case UPDATE_DECODE_ADD_SAME:
+			if(value > session->opRemaining) return false;
+			for(uint32_t i = 0; i < value; i++)
+			{
+				if(!UpdateOutput(BOOT_FLASH_PTR(BOOT_SLOT_A_OFFSET)[session->baseOffset++])) return false;
+			}
+			session->opRemaining -= value;
+			session->state = (session->opRemaining == 0U) ? UPDATE_DECODE_OP : UPDATE_DECODE_ADD_DIFF_COUNT;
+			return true;
+
+		case UPDATE_DECODE_ADD_DIFF_COUNT:
+			if((value == 0U) || (value > session->opRemaining)) return false;
+			session->runRemaining = value;
+			session->state = UPDATE_DECODE_ADD_DIFF;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool UpdateDecode(uint8_t byte)
+{
+	UpdateSession_t *session = &UpdateSession;
+
+	switch(session->state)
+	{
+		case UPDATE_DECODE_OP:
+			if(byte == UPDATE_OP_DATA) session->state = UPDATE_DECODE_DATA_LENGTH;
+			else if(byte == UPDATE_OP_ADD) session->state = UPDATE_DECODE_ADD_OFFSET;
+			else return false;
+			session->varint = 0;
+			session->varintShift = 0;
+			return true;
+
+		case UPDATE_DECODE_DATA:
+			session->opRemaining--;
+			if(session->opRemaining == 0U) session->state = UPDATE_DECODE_OP;
+			return UpdateOutput(byte);
+
+		case UPDATE_DECODE_ADD_DIFF:
+			session->opRemaining--;
+			session->runRemaining--;
+			if(session->runRemaining == 0U) session->state = (session->opRemaining == 0U) ? UPDATE_DECODE_OP : UPDATE_DECODE_ADD_SAME;
+			return UpdateOutput((uint8_t)(BOOT_FLASH_PTR(BOOT_SLOT_A_OFFSET)[session->baseOffset++] + byte));
+
+		default:
+			/* LEB128 number */
+			if(session->varintShift > UPDATE_VARINT_MAX_SHIFT) return false;
+			session->varint |= (uint32_t)(byte & 0x7FU) << session->varintShift;
+			session->varintShift += 7U;
+			if(byte & 0x80U)
+			{
+				return true;
+			}
+			uint32_t value = session->varint;
+			session->varint = 0;
+			session->varintShift = 0;
+			return UpdateDecodeNumber(value);
+	}
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Update_Init(void)
+{
+	UpdateBootState = BootControl_GetState();
+	UpdateConfirmPending = (UpdateBootState == BOOT_STATE_TESTING);
+	LOG("boot state %s\n", UpdateBootStateNames[UpdateBootState]);
+}
+
+/* Called by UsbLinkTask at least every USB_LINK_TASK_PERIOD */
+void Update_Poll(void)
+{
+	if(UpdateConfirmPending && (xTaskGetTickCount() >= pdMS_TO_TICKS(UPDATE_CONFIRM_DELAY_IN_MS)))
+	{
+		UpdateConfirmPending = false;
+		Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+		(void)BootControl_Confirm();
+		Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+	}
+}
+
+void Update_Info(void)
+{
+	const uint8_t *hash = UpdateGetRunningHash();
+	char hex[(2U * HASH_SHA256_SIZE) + 1U];
+
+	for(uint32_t i = 0; i < HASH_SHA256_SIZE; i++)
+	{
+		snprintf(&hex[2U * i], 3U, "%02x", hash[i]);
+	}
+	UsbLink_Respond("INFO %s %lu %lu %s", UpdateBootStateNames[BootControl_GetState()], (unsigned long)BootControl_Attempts(),
+					(unsigned long)BootControl_RunningImageSize(), hex);
+}
+
+void Update_Begin(const uint8_t *payload, uint32_t length)
+{
+	UpdateSession_t *session = &UpdateSession;
+	BootState_t state = BootControl_GetState();
+
+	session->active = false;
+	if(length != UPDATE_BEGIN_SIZE)
+	{
+		UpdateFail("format");
+		return;
+	}
+	/* Slot B holds the previous image until the new one is confirmed - the roll-back needs it */
+	if((state == BOOT_STATE_SWAPPING) || (state == BOOT_STATE_TESTING) || (state == BOOT_STATE_REVERTING))
+	{
+		UpdateFail("state");
+		return;
+	}
+	uint32_t imageSize = UpdateRead32(&payload[UPDATE_BEGIN_IMAGE_SIZE]);
+	if((imageSize == 0U) || (imageSize > BOOT_SLOT_SIZE))
+	{
+		UpdateFail("size");
+		return;
+	}
+	if((payload[UPDATE_BEGIN_FLAGS] & UPDATE_FLAG_DELTA) &&
+	   (memcmp(&payload[UPDATE_BEGIN_BASE_HASH], UpdateGetRunningHash(), HASH_SHA256_SIZE) != 0))
+	{
+		UpdateFail("base");
+		return;
+	}
+	if(!UpdateMotorsOff())
+	{
+		UpdateFail("busy");
+		return;
+	}
+
+	memset(session, 0, sizeof(*session));
+	session->active = true;
+	session->payloadSize = UpdateRead32(&payload[UPDATE_BEGIN_PAYLOAD_SIZE]);
+	session->state = UPDATE_DECODE_OP;
+	session->request.imageSize = imageSize;
+	session->request.sectors = (imageSize + FLASH_SECTOR_SIZE - 1U) / FLASH_SECTOR_SIZE;
+	memcpy(session->hash, &payload[UPDATE_BEGIN_IMAGE_HASH], HASH_SHA256_SIZE);
+	UsbLink_Respond("ACK 0");
+}
+
+void Update_Data(const uint8_t *payload, uint32_t length)
+{
+	UpdateSession_t *session = &UpdateSession;
+
+	if(!session->active)
+	{
+		UsbLink_Respond("ERR idle 0");
+		return;
+	}
+
+	uint32_t offset = (length >= 4U) ? UpdateRead32(payload) : UINT32_MAX;
+	if(offset != session->payloadOffset)
+	{
+		/* One response per gap - the frames that were in flight behind the lost one are dropped quietly */
+		UpdateStats.rejectedFrames++;
+		if(!session->resync)
+		{
+			session->resync = true;
+			UsbLink_Respond("ERR sequence %lu", (unsigned long)session->payloadOffset);
+		}
+		return;
+	}
+	session->resync = false;
+	if(!UpdateMotorsOff())
+	{
+		/* The sender retries the same frame later */
+		UpdateStats.rejectedFrames++;
+		session->resync = true;
+		UsbLink_Respond("ERR busy %lu", (unsigned long)session->payloadOffset);
+		return;
+	}
+
+	uint32_t count = length - 4U;
+	if(count > (session->payloadSize - session->payloadOffset))
+	{
+		UpdateFail("size");
+		return;
+	}
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(!UpdateDecode(payload[4U + i]))
+		{
+			UpdateFail("payload");
+			return;
+		}
+	}
+	session->payloadOffset += count;
+	UsbLink_Respond("ACK %lu", (unsigned long)session->payloadOffset);
+}
+
+void Update_End(void)
+{
+	UpdateSession_t *session = &UpdateSession;
+	BootRequest_t *request = &session->request;
+
+	if(!session->active)
+	{
+		UsbLink_Respond("ERR idle 0");
+		return;
+	}
+	if((session->payloadOffset != session->payloadSize) || (session->state != UPDATE_DECODE_OP) ||
+	   (session->outputOffset != request->imageSize))
+	{
+		UpdateFail("incomplete");
+		return;
+	}
+
+	/* The last sector padded like the erased flash */
+	uint32_t fill = session->outputOffset % FLASH_SECTOR_SIZE;
+	if(fill != 0U)
+	{
+		memset(&UpdateSector[fill], 0xFF, FLASH_SECTOR_SIZE - fill);
+		if(!UpdateFlushSector(session->outputOffset / FLASH_SECTOR_SIZE))
+		{
+			UpdateFail("flash");
+			return;
+		}
+	}
+
+	uint8_t hash[HASH_SHA256_SIZE];
+	request->magic = BOOT_REQUEST_MAGIC;
+	memcpy(request->hash, session->hash, HASH_SHA256_SIZE);
+	request->crc = Hash_Crc32(request, offsetof(BootRequest_t, crc));
+	BootControl_HashStagedImage(request, hash);
+	if(memcmp(hash, session->hash, HASH_SHA256_SIZE) != 0)
+	{
+		UpdateFail("hash");
+		return;
+	}
+
+	Watchdog_SetTimeout(WATCHDOG_FLASH_TIMEOUT_IN_MS);
+	bool ok = BootControl_WriteRequest(request);
+	Watchdog_SetTimeout(WATCHDOG_TIMEOUT_IN_MS);
+	if(!ok)
+	{
+		UpdateFail("flash");
+		return;
+	}
+
+	uint32_t changed = 0;
+	for(uint32_t sector = 0; sector < request->sectors; sector++)
+	{
+		if(BootControl_SectorChanged(request, sector)) changed++;
+	}
+	session->active = false;
+	UpdateStats.updates++;
+	UsbLink_Respond("DONE %lu %lu", (unsigned long)changed, (unsigned long)request->sectors);
+
+	/* The boot stub swaps the new image in */
+	vTaskDelay(pdMS_TO_TICKS(UPDATE_REBOOT_DELAY_IN_MS));
+	Watchdog_Reboot();
+}
+
+void Update_Abort(void)
+{
+	UpdateSession.active = false;
+	UsbLink_Respond("ACK 0");
+}
@@ -0,0 +1,260 @@
+/* UsbLink.c - command link with the host over the USB CDC stdio (firmware update, field trace, motor commands, time sync,
+   execution times, node bus, profiler) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdarg.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+
+/* Include files from other tasks */
+#include "UsbLink.h"
+#include "Update.h"
+#include "Trace.h"
+#include "MotorControllerTask.h"
+#include "TimeSync.h"
+#include "CycleCounter.h"
+#include "Debounce.h"
+#include "NodeBus.h"
+#include "SiteConfig.h"
+#include "Profiler.h"
+#include "PowerMonitor.h"
+#include "Watchdog.h"
+#include "Hash.h"
+#include "ElectronicBlinds_Main.h"
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+UsbLinkStats_t UsbLinkStats;
+SemaphoreHandle_t UsbLinkSemaphore;
+
+static uint8_t UsbLinkFrame[USB_LINK_MAX_FRAME];
+static uint32_t UsbLinkFrameFill;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+void UsbLinkCharsAvailable(void *param);
+void UsbLinkReceive(uint8_t byte);
+void UsbLinkDispatch(uint8_t command, const uint8_t *payload, uint32_t length);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Called by the stdio driver (USB interrupt) */
+void UsbLinkCharsAvailable(void *param)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+	(void)param;
+	xSemaphoreGiveFromISR(UsbLinkSemaphore, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void UsbLinkReceive(uint8_t byte)
+{
+	UsbLinkStats.bytes++;
+
+	/* Hunt for the sync bytes - anything else in between is dropped */
+	if(((UsbLinkFrameFill == 0U) && (byte != USB_LINK_SYNC_1)) ||
+	   ((UsbLinkFrameFill == 1U) && (byte != USB_LINK_SYNC_2)))
+	{
+		UsbLinkFrameFill = (byte == USB_LINK_SYNC_1) ? 1U : 0U;
+		return;
+	}
+	UsbLinkFrame[UsbLinkFrameFill++] = byte;
+	if(UsbLinkFrameFill < USB_LINK_HEADER_SIZE)
+	{
+		return;
+	}
+
+	uint32_t length = (uint32_t)UsbLinkFrame[3] | ((uint32_t)UsbLinkFrame[4] << 8);
+	if(length > USB_LINK_MAX_PAYLOAD)
+	{
+		UsbLinkStats.badFrames++;
+		UsbLinkFrameFill = 0;
+		return;
+	}
+	if(UsbLinkFrameFill < (USB_LINK_HEADER_SIZE + length + USB_LINK_CRC_SIZE))
+	{
+		return;
+	}
+
+	/* Complete frame - a damaged one is dropped without a response, the payload offsets let the sender notice the gap */
+	const uint8_t *crcBytes = &UsbLinkFrame[USB_LINK_HEADER_SIZE + length];
+	uint32_t crc = (uint32_t)crcBytes[0] | ((uint32_t)crcBytes[1] << 8) | ((uint32_t)crcBytes[2] << 16) | ((uint32_t)crcBytes[3] << 24);
+	UsbLinkFrameFill = 0;
+	if(crc != Hash_Crc32(&UsbLinkFrame[2], (USB_LINK_HEADER_SIZE - 2U) + length))
+	{
+		UsbLinkStats.badFrames++;
+		return;
+	}
+	UsbLinkStats.frames++;
+	UsbLinkDispatch(UsbLinkFrame[2], &UsbLinkFrame[USB_LINK_HEADER_SIZE], length);
+}
+
+void UsbLinkDispatch(uint8_t command, const uint8_t *payload, uint32_t length)
+{
+	switch(command)
+	{
+		case USB_LINK_CMD_INFO:
+			Update_Info();
+			break;
+		case USB_LINK_CMD_UPDATE_BEGIN:
+			Update_Begin(payload, length);
+			break;
+		case USB_LINK_CMD_UPDATE_DATA:
+			Update_Data(payload, length);
+			break;
+		case USB_LINK_CMD_UPDATE_END:
+			Update_End();
+			break;
+		case USB_LINK_CMD_UPDATE_ABORT:
+			Update_Abort();
+			break;
+#if (TRACE_ENABLED == 1)
+		case USB_LINK_CMD_TRACE_INFO:
+			Trace_Info();
+			break;
+		case USB_LINK_CMD_TRACE_START:
+			Trace_Start();
+			break;
+		case USB_LINK_CMD_TRACE_READ:
+			Trace_Read(payload, length);
+			break;
+#endif
+		case USB_LINK_CMD_MOTOR:
+			MotorCommand_Remote(payload, length);
+			break;
+		case USB_LINK_CMD_MOTOR_INFO:
+			MotorCommand_Info();
+			break;
+#if (ENCODER_ENABLED == 1)
+		case USB_LINK_CMD_POSITION:
+			MotorCommand_RemotePosition(payload, length);
+			break;
+		case USB_LINK_CMD_POSITION_INFO:
+			MotorCommand_PositionInfo();
+			break;
+#endif
+		case USB_LINK_CMD_TIME_INFO:
+			TimeSync_Info(payload, length);
+			break;
+		case USB_LINK_CMD_TIME_SYNC:
+			TimeSync_Sync(payload, length);
+			break;
+		case USB_LINK_CMD_CYCLE_INFO:
+			CycleCounter_Info(payload, length);
+			break;
+		case USB_LINK_CMD_CYCLE_RESET:
+			CycleCounter_ResetRemote();
+			break;
+		case USB_LINK_CMD_DEBOUNCE_INFO:
+			Debounce_Info(payload, length);
+			break;
+#if (NODE_BUS_ENABLED == 1)
+		case USB_LINK_CMD_BUS_INFO:
+			NodeBus_Info();
+			break;
+		case USB_LINK_CMD_BUS_CONFIG:
+			NodeBus_Config(payload, length);
+			break;
+		case USB_LINK_CMD_BUS_MOVE:
+			NodeBus_RemoteMove(payload, length);
+			break;
+		case USB_LINK_CMD_BUS_PING:
+			NodeBus_RemotePing(payload, length);
+			break;
+#endif
+		case USB_LINK_CMD_CONFIG_INFO:
+			SiteConfig_Info();
+			break;
+		case USB_LINK_CMD_CONFIG_READ:
+			SiteConfig_Read(payload, length);
+			break;
+		case USB_LINK_CMD_CONFIG_WRITE:
+			SiteConfig_Write(payload, length);
+			break;
+#if (PROFILER_ENABLED == 1)
+		case USB_LINK_CMD_PROFILE_START:
+			Profiler_StartRemote(payload, length);
+			break;
+		case USB_LINK_CMD_PROFILE_INFO:
+			Profiler_Info();
+			break;
+		case USB_LINK_CMD_PROFILE_READ:
+			Profiler_Read(payload, length);
+			break;
+		case USB_LINK_CMD_PROFILE_TASK:
+			Profiler_Task(payload, length);
+			break;
+#endif
+#if (POWER_MONITOR_ENABLED == 1)
+		case USB_LINK_CMD_POWER_INFO:
+			PowerMonitor_Info();
+			break;
+#endif
+		default:
+			UsbLink_Respond("ERR command 0");
+			break;
+	}
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void UsbLink_Init(void)
+{
+	UsbLinkSemaphore = xSemaphoreCreateBinary();
+	stdio_set_chars_available_callback(UsbLinkCharsAvailable, NULL);
+}
+
+/* One response line - written raw (no CR/LF translation) and flushed right away */
+void UsbLink_Respond(const char *format, ...)
+{
+	char line[USB_LINK_MAX_RESPONSE];
+	va_list args;
+
+	line[0] = USB_LINK_RESPONSE_MARK;
+	va_start(args, format);
+	int length = vsnprintf(&line[1], sizeof(line) - 2U, format, args);
+	va_end(args);
+	if(length < 0)
+	{
+		return;
+	}
+	length = (length > (int)(sizeof(line) - 3U)) ? (int)(sizeof(line) - 3U) : length;
+	line[1 + length] = '\n';
+
+	for(int i = 0; i < length + 2; i++)
+	{
+		putchar_raw(line[i]);
+	}
+	stdio_flush();
+}
+
+void UsbLinkTask(void *pvParameters)
+{
+	for( ;; )
+	{
+		/* Woken by the arriving characters, at least every task period for the watchdog and the update housekeeping */
+		(void)xSemaphoreTake(UsbLinkSemaphore, pdMS_TO_TICKS(USB_LINK_TASK_PERIOD));
+		Watchdog_CheckIn(WATCHDOG_CLIENT_USB_LINK);
+
+		int character;
+		while((character = getchar_timeout_us(0U)) >= 0)
+		{
+			UsbLinkReceive((uint8_t)character);
+		}
+
+		Update_Poll();
+#if (TRACE_ENABLED == 1)
+		Trace_Service();
+#endif
+	}
+}
@@ -0,0 +1,204 @@
+/* Watchdog.c - hardware watchdog fed on behalf of the tasks, and the record of the state it reset the system in */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SDK includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/watchdog.h"
+
+/* Include files from other tasks */
+#include "Watchdog.h"
+#include "ElectronicBlinds_Main.h"
+#include "MotorControllerTask.h"
+#include "ButtonTask.h"
+#include "Channels.h"
+
+_Static_assert(BLINDS_NUM_OF_CHANNELS <= 4U, "One byte per channel in a 32-bit scratch register");
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+WatchdogRecord_t WatchdogLastReset;
+
+static const uint32_t WatchdogDeadline_ms[WATCHDOG_NUM_OF_CLIENTS] =
+{
+	[WATCHDOG_CLIENT_BUTTON]            = WATCHDOG_DEADLINE_BUTTON,
+	[WATCHDOG_CLIENT_MOTOR_CONTROLLER]  = WATCHDOG_DEADLINE_MOTOR_CONTROLLER,
+	[WATCHDOG_CLIENT_AUTOMATIC_CONTROL] = WATCHDOG_DEADLINE_AUTOMATIC_CONTROL,
+	[WATCHDOG_CLIENT_MOTION_SENSOR]     = WATCHDOG_DEADLINE_MOTION_SENSOR,
+	[WATCHDOG_CLIENT_USB_LINK]          = WATCHDOG_DEADLINE_USB_LINK,
+	[WATCHDOG_CLIENT_NODE_BUS]          = WATCHDOG_DEADLINE_NODE_BUS,
+};
+
+/* A client is only monitored from its first check-in on - the tasks that are not created (optional features) never are */
+static volatile TickType_t WatchdogLastCheckIn[WATCHDOG_NUM_OF_CLIENTS];
+static volatile bool WatchdogClientActive[WATCHDOG_NUM_OF_CLIENTS];
+static bool WatchdogFailed;
+static uint32_t WatchdogResets;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+uint32_t WatchdogPackCause(WatchdogCause_t cause, uint32_t client);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t WatchdogPackCause(WatchdogCause_t cause, uint32_t client)
+{
+	return (uint32_t)cause | (client << 8) | (WatchdogResets << 16);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* The WATCHDOG_CHANNEL_* byte of every channel - from the tick hook here, and for the record of a falling supply (PowerMonitor.c) */
+uint32_t Watchdog_PackChannels(void)
+{
+	uint32_t packed = 0;
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		uint32_t byte = ((uint32_t)CurrentState[channel] & WATCHDOG_CHANNEL_STATE_MASK) |
+						(((uint32_t)MotorCommands[channel].state & WATCHDOG_CHANNEL_STATE_MASK) << WATCHDOG_CHANNEL_TARGET_SHIFT);
+		if(MotorCommands[channel].priority == MOTOR_PRIORITY_AUTOMATIC) byte |= WATCHDOG_CHANNEL_AUTOMATIC;
+		if(LimitSwitchBackoffActive & CHANNEL_BIT(channel)) byte |= WATCHDOG_CHANNEL_BACKOFF;
+		packed |= byte << (8U * channel);
+	}
+	return packed;
+}
+
+/* Called first thing after the reset - decides between the normal start-up and the fast path */
+bool Watchdog_ReadRecord(void)
+{
+	WatchdogLastReset.valid = watchdog_caused_reboot() && (watchdog_hw->scratch[WATCHDOG_SCRATCH_MAGIC_REG] == WATCHDOG_SCRATCH_MAGIC);
+	if(!WatchdogLastReset.valid)
+	{
+		return false;
+	}
+
+	uint32_t cause = watchdog_hw->scratch[WATCHDOG_SCRATCH_CAUSE_REG];
+	uint32_t channels = watchdog_hw->scratch[WATCHDOG_SCRATCH_CHANNELS_REG];
+	WatchdogLastReset.cause = (WatchdogCause_t)(cause & 0xFFU);
+	WatchdogLastReset.client = (cause >> 8) & 0xFFU;
+	WatchdogLastReset.resets = ((cause >> 16) & 0xFFU) + 1U;
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		uint32_t byte = (channels >> (8U * channel)) & 0xFFU;
+		WatchdogLastReset.state[channel] = (MotorState_t)(byte & WATCHDOG_CHANNEL_STATE_MASK);
+		WatchdogLastReset.target[channel] = (MotorState_t)((byte >> WATCHDOG_CHANNEL_TARGET_SHIFT) & WATCHDOG_CHANNEL_STATE_MASK);
+		if(byte & WATCHDOG_CHANNEL_AUTOMATIC) WatchdogLastReset.automaticMoves |= CHANNEL_BIT(channel);
+		if(byte & WATCHDOG_CHANNEL_BACKOFF) WatchdogLastReset.backoffActive |= CHANNEL_BIT(channel);
+	}
+	LOG("watchdog reset %lu, cause %d client %lu\n", (unsigned long)WatchdogLastReset.resets, (int)WatchdogLastReset.cause, (unsigned long)WatchdogLastReset.client);
+	return true;
+}
+
+void Watchdog_Init(void)
+{
+	WatchdogResets = WatchdogLastReset.valid ? WatchdogLastReset.resets : 0U;
+
+	/* Until the tick hook records a missed check-in, a reset can only come from the watchdog not being fed at all */
+	watchdog_hw->scratch[WATCHDOG_SCRATCH_MAGIC_REG] = WATCHDOG_SCRATCH_MAGIC;
+	watchdog_hw->scratch[WATCHDOG_SCRATCH_CAUSE_REG] = WatchdogPackCause(WATCHDOG_CAUSE_TIMEOUT, 0U);
+	watchdog_hw->scratch[WATCHDOG_SCRATCH_CHANNELS_REG] = Watchdog_PackChannels();
+
+	watchdog_enable(WATCHDOG_TIMEOUT_IN_MS, true);
+}
+
+/* Restarts the automatic moves the reset interrupted - called before the scheduler starts, so MotorControllerTask
+   drives the motors right in its first run. Manual moves are aborted (the button edge is gone, the user presses again),
+   so are the back-offs (the limit switch state is checked again by ButtonTask) and moves that keep crashing */
+void Watchdog_ResumeMoves(void)
+{
+	if(!WatchdogLastReset.valid)
+	{
+		return;
+	}
+
+	for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+	{
+		MotorState_t target = WatchdogLastReset.target[channel];
+		if(target == STATE_OFF)
+		{
+			continue;
+		}
+
+		if((WatchdogLastReset.automaticMoves & CHANNEL_BIT(channel)) && !(WatchdogLastReset.backoffActive & CHANNEL_BIT(channel)) &&
+		   (WatchdogLastReset.resets <= WATCHDOG_MAX_RESUMES))
+		{
+			LOG("resuming move %d of channel %lu\n", (int)target, (unsigned long)channel);
+			(void)MotorCommand_Submit(channel, target, MOTOR_PRIORITY_AUTOMATIC, MOTOR_DEADLINE_AUTOMATIC_IN_US);
+			WatchdogLastReset.resumedMoves |= CHANNEL_BIT(channel);
+		}
+		else
+		{
+			LOG("aborted move %d of channel %lu\n", (int)target, (unsigned long)channel);
+		}
+	}
+}
+
+void Watchdog_CheckIn(WatchdogClient_t client)
+{
+	WatchdogLastCheckIn[client] = xTaskGetTickCount();
+	WatchdogClientActive[client] = true;
+}
+
+/* Called by the FreeRTOS tick interrupt (vApplicationTickHook) - the scratch record is refreshed every tick,
+   so even a reset by a timeout (no tick interrupts any more) knows the motor state of at most 1 tick before */
+void Watchdog_TickHook(void)
+{
+	if(WatchdogFailed)
+	{
+		/* Waiting for the reset - whatever the hung task does, the H-bridge stays off */
+		MotorOutputsOff();
+		return;
+	}
+
+	TickType_t now = xTaskGetTickCountFromISR();
+	for(uint32_t client = 0; client < WATCHDOG_NUM_OF_CLIENTS; client++)
+	{
+		if(WatchdogClientActive[client] && ((now - WatchdogLastCheckIn[client]) > pdMS_TO_TICKS(WatchdogDeadline_ms[client])))
+		{
+			/* Record the state before the outputs are cut, then stop feeding - the reset follows in WATCHDOG_TIMEOUT_IN_MS */
+			watchdog_hw->scratch[WATCHDOG_SCRATCH_CAUSE_REG] = WatchdogPackCause(WATCHDOG_CAUSE_CHECKIN, client);
+			WatchdogFailed = true;
+			MotorOutputsOff();
+			return;
+		}
+	}
+
+	watchdog_hw->scratch[WATCHDOG_SCRATCH_CHANNELS_REG] = Watchdog_PackChannels();
+	if((WatchdogResets > 0U) && (now >= pdMS_TO_TICKS(WATCHDOG_STABLE_RUN_IN_MS)))
+	{
+		WatchdogResets = 0;
+		watchdog_hw->scratch[WATCHDOG_SCRATCH_CAUSE_REG] = WatchdogPackCause(WATCHDOG_CAUSE_TIMEOUT, 0U);
+	}
+	watchdog_update();
+}
+
+/* Longer timeout around the operations which keep the interrupts (and with them the tick hook) off for a while - the flash
+   erase/program, back to WATCHDOG_TIMEOUT_IN_MS afterwards. A missed check-in is not undone by it */
+void Watchdog_SetTimeout(uint32_t timeout_ms)
+{
+	if(!WatchdogFailed)
+	{
+		watchdog_enable(timeout_ms, true);
+	}
+}
+
+/* Deliberate reset (e.g. to start a new firmware image) - not a crash, so the next boot takes the normal path */
+void Watchdog_Reboot(void)
+{
+	watchdog_hw->scratch[WATCHDOG_SCRATCH_MAGIC_REG] = 0U;
+	watchdog_reboot(0U, 0U, 0U);
+	for( ;; )
+	{
+		tight_loop_contents();
+	}
+}
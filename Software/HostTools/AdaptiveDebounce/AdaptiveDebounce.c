@@ -0,0 +1,343 @@
+/* AdaptiveDebounce.c - the settle windows the firmware learns from the bounce of its inputs (Debounce.c, ButtonTask.c).
+
+   Every scenario models one contact - its bounce (a random duration per press, random edges at the given rate) - and presses
+   it PRESSES times in a freshly booted firmware image (own process). The settle window starts at the fixed delay of
+   ElectronicBlinds_Main.h and is learned from the DEBOUNCE_MIN_SAMPLES-th press on. Then the power is cut and the next image
+   boots with the DS1307 (and its battery backed RAM) as it was: the contact is pressed again and glitches shorter than the
+   learned window are injected, none of which may move the motor. The buttons are pressed and held, the latency is the first
+   edge until the motor runs (the polling of ButtonTask and MotorControllerTask included), the limit switches are pressed with
+   the motor off - the latency is the first edge until the back-off runs the motor. The settle windows are read over the USB
+   link like UpdateSender --debounce does.
+
+   Usage: AdaptiveDebounce
+   Exits with 1 if a press is missed or doubled, a glitch moves the motor, the settle window learned is out of its bounds or
+   not shorter than the fixed delay for a good contact, the latency of the presses after the learning is over the bound
+   (bounce + settle window + polling) or the settle window is not the same after the reboot. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+#include "Debounce.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (6000000ULL)
+#define SAVE_SETTLE_US          (60000000ULL)   /* AutomaticControlTask saves the settle windows once per run */
+#define PRESSES                 (16U)
+#define PRESSES_AFTER_REBOOT    (4U)
+#define LATENCY_PRESSES         (4U)            /* averaged - the first ones (fixed delay) and the last ones (learned) */
+#define GLITCHES                (20U)
+#define HOLD_US                 (400000U)
+#define GAP_US                  (400000U)
+#define REACTION_SLACK_US       (2000U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    const char *name;
+    uint32_t gpio;
+    uint32_t bounceMin_us, bounceMax_us;    /* of a press, the release bounces as long */
+    uint32_t edgeRate_hz;
+    bool good;                              /* the settle window has to end up below the fixed delay */
+}Scenario_t;
+
+typedef struct
+{
+    bool reset;                             /* boot 0 ended with the power cut */
+    HostSim_PersistentState_t state;
+    uint32_t presses, starts, invalid;      /* motor starts - one per press */
+    uint32_t falseStarts;                   /* of the glitches */
+    double before_us, after_us, worst_us;   /* latency of the first presses, of the last ones and the worst of the last ones */
+    bool info;
+    UpdateDebounceStats_t debounce;
+}Result_t;
+
+/* What the process of a boot gets */
+typedef struct
+{
+    const Scenario_t *scenario;
+    uint32_t boot;
+    const HostSim_PersistentState_t *state;     /* NULL on the first boot */
+}BootRun_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* name            gpio                 bounce us       rate Hz  good */
+    { "good_button",   BUTTON_UP,           200,   1500,    5000,    true  },
+    { "bad_button",    BUTTON_DOWN,         8000,  20000,   1500,    true  },
+    { "worn_button",   BUTTON_UP,           60000, 90000,   500,     false },
+    { "good_limit",    BUTTON_BOTTOM_LIMIT, 50,    400,     20000,   true  },
+    { "bad_limit",     BUTTON_TOP_LIMIT,    2000,  6000,    5000,    true  },
+};
+
+static uint64_t RandomState = 0x2545F4914F6CDD1DULL;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t Random(void)
+{
+    /* xorshift64* - deterministic */
+    RandomState ^= RandomState >> 12;
+    RandomState ^= RandomState << 25;
+    RandomState ^= RandomState >> 27;
+    return (uint32_t)((RandomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/* Toggles the input at a random interval around 1/rate for the given duration and leaves it at finalLevel */
+static void Bounce(uint32_t gpio, uint32_t rate_hz, uint32_t duration_us, bool finalLevel)
+{
+    uint64_t end = HostSim_NowUs() + duration_us;
+    uint32_t meanInterval_us = 1000000U / rate_hz;
+
+    HostSim_SetInput(gpio, true);
+    for(;;)
+    {
+        uint32_t interval = (meanInterval_us / 2U) + (Random() % (meanInterval_us + 1U));
+        if(HostSim_NowUs() + interval >= end) break;
+        HostSim_RunForUs(interval);
+        HostSim_SetInput(gpio, !HostSim_GetPin(gpio));
+    }
+    HostSim_RunUntilUs(end);
+    HostSim_SetInput(gpio, finalLevel);
+}
+
+static void SimWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    HostSim_UsbWrite(data, length);
+}
+
+static bool SimReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    (void)context;
+    return HostSim_UsbReadLine(line, size, timeout_ms * 1000ULL);
+}
+
+static void SimSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    HostSim_RunForUs(ms * 1000ULL);
+}
+
+/* ChannelInput_t of a GPIO of channel 0 - from the table, the lookup of the firmware is built at its boot */
+static uint32_t InputOf(uint32_t gpio)
+{
+    for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+    {
+        if(SiteConfig->channels.inputGpio[input][0] == gpio) return input;
+    }
+    return CHANNEL_NUM_OF_INPUTS;
+}
+
+/* Settle window of the input of the scenario over the USB link */
+static bool ReadDebounce(const Scenario_t *scenario, UpdateDebounceStats_t *debounce)
+{
+    UpdateTransport_t transport = { NULL, SimWrite, SimReadLine, SimSleep };
+    UpdateDebounceStats_t items[CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS];
+
+    uint32_t count = UpdateProtocol_DebounceInfo(&transport, items, CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if((items[i].channel == 0U) && (items[i].input == InputOf(scenario->gpio)))
+        {
+            *debounce = items[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/* First motor start at or after the given time, 0 - none */
+static uint64_t MotorStart(uint32_t logStart, uint64_t since_us, uint64_t until_us)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    for(uint32_t i = logStart; i < length; i++)
+    {
+        if((log[i].time_us >= since_us) && (log[i].time_us < until_us) && (log[i].motorControl1 || log[i].motorControl2))
+        {
+            return log[i].time_us;
+        }
+    }
+    return 0U;
+}
+
+/* Motor starts (off -> on) and invalid outputs (both on) from the given log entry on */
+static void CountStarts(uint32_t logStart, Result_t *result)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    bool on = false;
+    for(uint32_t i = logStart; i < length; i++)
+    {
+        bool nowOn = log[i].motorControl1 || log[i].motorControl2;
+        if(log[i].motorControl1 && log[i].motorControl2) result->invalid++;
+        if(nowOn && !on) result->starts++;
+        on = nowOn;
+    }
+}
+
+static void Run(const Scenario_t *scenario, uint32_t boot, const HostSim_PersistentState_t *state, Result_t *result)
+{
+    uint64_t latency_us[PRESSES];
+    uint32_t presses = (boot == 0U) ? PRESSES : PRESSES_AFTER_REBOOT;
+
+    RandomState ^= boot;
+    if(boot == 0U)
+    {
+        /* Midday in June with the blinds open - AutomaticControlTask leaves the motor alone */
+        HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+        HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    }
+    else
+    {
+        HostSim_RestoreState(state);
+    }
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    const HostSim_MotorEvent_t *log;
+    uint32_t logStart = HostSim_GetMotorLog(&log);
+    for(uint32_t press = 0; press < presses; press++)
+    {
+        uint32_t bounce_us = scenario->bounceMin_us + (Random() % (scenario->bounceMax_us - scenario->bounceMin_us + 1U));
+
+        uint64_t start_us = HostSim_NowUs();
+        Bounce(scenario->gpio, scenario->edgeRate_hz, bounce_us, true);
+        HostSim_RunForUs(HOLD_US);
+        Bounce(scenario->gpio, scenario->edgeRate_hz, bounce_us, false);
+        HostSim_RunForUs(GAP_US);
+
+        uint64_t motor_us = MotorStart(logStart, start_us, HostSim_NowUs());
+        latency_us[press] = (motor_us != 0U) ? (motor_us - start_us) : 0U;
+    }
+    result->presses = presses;
+    CountStarts(logStart, result);
+
+    uint32_t averaged = (presses < LATENCY_PRESSES) ? presses : LATENCY_PRESSES;
+    for(uint32_t i = 0; i < averaged; i++)
+    {
+        uint64_t last_us = latency_us[presses - averaged + i];
+        result->before_us += (double)latency_us[i] / averaged;
+        result->after_us += (double)last_us / averaged;
+        if((double)last_us > result->worst_us) result->worst_us = (double)last_us;
+    }
+    result->info = ReadDebounce(scenario, &result->debounce);
+
+    if(boot == 0U)
+    {
+        /* Until the settle windows are in the DS1307 - then the power cut */
+        HostSim_RunForUs(SAVE_SETTLE_US);
+        HostSim_SaveState(&result->state);
+        result->reset = true;
+        return;
+    }
+
+    /* Glitches shorter than the window learned and bursts of noise that end released - none is a press */
+    uint32_t settle_us = result->debounce.settle_us;
+    logStart = HostSim_GetMotorLog(&log);
+    for(uint32_t glitch = 0; glitch < GLITCHES; glitch++)
+    {
+        uint32_t width_us = (settle_us / 5U) + (Random() % ((settle_us * 3U) / 5U));
+        if((glitch % 4U) == 3U)
+        {
+            Bounce(scenario->gpio, scenario->edgeRate_hz, width_us, false);
+        }
+        else
+        {
+            HostSim_SetInput(scenario->gpio, true);
+            HostSim_RunForUs(width_us);
+            HostSim_SetInput(scenario->gpio, false);
+        }
+        HostSim_RunForUs(GAP_US);
+    }
+    Result_t glitches;
+    memset(&glitches, 0, sizeof(glitches));
+    CountStarts(logStart, &glitches);
+    result->falseStarts = glitches.starts;
+}
+
+/* The process of a boot */
+static void RunBootProcess(const void *context, void *output)
+{
+    const BootRun_t *run = context;
+    Result_t *result = output;
+
+    memset(result, 0, sizeof(*result));
+    Run(run->scenario, run->boot, run->state, result);
+}
+
+static bool RunBoot(const Scenario_t *scenario, uint32_t boot, const HostSim_PersistentState_t *state, Result_t *result)
+{
+    BootRun_t run = { scenario, boot, state };
+    return HostSim_RunIsolated(RunBootProcess, &run, result, sizeof(*result));
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-12s %13s %9s %10s %8s %8s %10s %10s %9s %10s %7s %7s  %s\n", "scenario", "bounce ms", "fixed ms", "learned ms", "p95 ms",
+           "presses", "before ms", "after ms", "worst ms", "reboot ms", "missed", "glitch", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+        Result_t learn, reboot;
+
+        if(!RunBoot(scenario, 0U, NULL, &learn) || !learn.reset || !RunBoot(scenario, 1U, &learn.state, &reboot))
+        {
+            printf("%-12s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+        if(!learn.info || !reboot.info)
+        {
+            printf("%-12s no #DEBOUNCE from the board\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        bool limit = (InputOf(scenario->gpio) == CHANNEL_INPUT_TOP_LIMIT) || (InputOf(scenario->gpio) == CHANNEL_INPUT_BOTTOM_LIMIT);
+        uint32_t fixed_us = limit ? DEBOUNCE_LIMIT_MAX_IN_US : DEBOUNCE_BUTTON_MAX_IN_US;
+        uint32_t min_us = limit ? DEBOUNCE_LIMIT_MIN_IN_US : DEBOUNCE_BUTTON_MIN_IN_US;
+        uint32_t settle_us = learn.debounce.settle_us;
+
+        /* The last edge of a press at most its bounce after the first one, then the settle window and the polling of the tasks */
+        double bound_us = (double)scenario->bounceMax_us + settle_us + REACTION_SLACK_US;
+        if(!limit) bound_us += (BUTTON_TASK_PERIOD + MOTOR_CONTROLLER_TASK_PERIOD) * 1000.0;
+
+        uint32_t missed = (learn.presses - learn.starts) + (reboot.presses - reboot.starts);
+        bool ok = (learn.starts == learn.presses) && (reboot.starts == reboot.presses) && (learn.invalid == 0U) && (reboot.invalid == 0U) &&
+                  (reboot.falseStarts == 0U) && (settle_us >= min_us) && (settle_us <= fixed_us) && (!scenario->good || (settle_us < fixed_us)) &&
+                  (learn.worst_us <= bound_us) && (reboot.worst_us <= bound_us) && (reboot.debounce.settle_us == settle_us);
+        if(!ok) failures++;
+
+        char bounce[16];
+        snprintf(bounce, sizeof(bounce), "%.2f-%.2f", scenario->bounceMin_us / 1000.0, scenario->bounceMax_us / 1000.0);
+        printf("%-12s %13s %9.1f %10.1f %8.1f %8u %10.1f %10.1f %9.1f %10.1f %7d %7u  %s\n", scenario->name, bounce, fixed_us / 1000.0,
+               settle_us / 1000.0, learn.debounce.p95_us / 1000.0, (unsigned)learn.debounce.samples, learn.before_us / 1000.0,
+               learn.after_us / 1000.0, learn.worst_us / 1000.0, reboot.after_us / 1000.0, (int)missed, (unsigned)reboot.falseStarts,
+               ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,478 @@
+/* BounceStorm.c - GPIO bounce-storm stress benchmark of the interrupt path (ButtonsInterruptCallback,
+   TimerInit, TimerHandler_UpDownButtons, TimerHandler_LimitSwitches) running in HostSim.
+
+   Every scenario replays a synthetic contact bounce pattern into the simulated GPIOs of a freshly booted
+   firmware and reports:
+     - ISR entry counts (GPIO bank, alarm 0, alarm 1) and the total/worst ISR time (host time)
+     - worst-case cycles of each handler as measured by the firmware itself (CycleCounter, host clock scaled to clk_sys)
+     - missed and duplicated logical events, judged from the sequence of H-bridge output states
+     - latency from the first edge of a press to the motor reacting
+     - consistency of the final state once all inputs are released
+
+   Usage: BounceStorm [--seed N] [--scenario NAME] [--csv FILE] [--label TEXT] [--verbose]
+   With --csv one line per scenario is appended to FILE, so results can be tracked over time.
+   With --verbose the expected and observed motor state sequences are printed to stderr. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "CycleCounter.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_OBSERVED_STATES     (256U)
+#define BOOT_SETTLE_US          (6000000ULL)
+#define FINAL_SETTLE_US         (5000000ULL)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    MOTOR_OFF,
+    MOTOR_CW,
+    MOTOR_ACW,
+    MOTOR_INVALID
+}MotorOutput_t;
+
+typedef enum
+{
+    SCENARIO_BUTTON,        /* Press (with bounce), hold, release (with bounce) */
+    SCENARIO_NOISE,         /* Chatter only - no intended press */
+    SCENARIO_LIMIT,         /* Move held by a button, the limit switch chatters when it's hit */
+    SCENARIO_BOTH_BUTTONS   /* Both buttons chatter, then one of them is held */
+}ScenarioKind_t;
+
+typedef struct
+{
+    const char *name;
+    ScenarioKind_t kind;
+    uint32_t gpio;              /* Button (or the button driving the move for SCENARIO_LIMIT) */
+    uint32_t limitGpio;         /* Limit switch hit during SCENARIO_LIMIT */
+    uint32_t edgeRate_hz;       /* Mean rate of the chatter edges */
+    uint32_t pressBounce_us;    /* Chatter when the contact closes */
+    uint32_t hold_us;           /* Stable contact after the chatter */
+    uint32_t releaseBounce_us;  /* Chatter when the contact opens */
+    uint32_t repeats;
+    uint32_t gap_us;            /* Idle time between the repeats */
+    MotorOutput_t expected[4];  /* Expected motor states for one repeat */
+    uint32_t expectedCount;
+}Scenario_t;
+
+typedef struct
+{
+    uint32_t edges;
+    uint32_t gpioIsrEntries;
+    uint32_t alarm0IsrEntries;
+    uint32_t alarm1IsrEntries;
+    uint64_t isrTotal_ns;
+    uint64_t isrMax_ns;
+    uint32_t worstCycles[CYCLES_NUM_OF_ITEMS];
+    uint32_t expectedEvents;
+    uint32_t observedEvents;
+    uint32_t missed;
+    uint32_t duplicated;
+    uint64_t latencySum_us;
+    uint64_t latencyMax_us;
+    uint32_t latencyCount;
+    uint32_t inconsistencies;
+    char finalState[128];
+}Result_t;
+
+/* What the process of a scenario gets */
+typedef struct
+{
+    const Scenario_t *scenario;
+    uint64_t randomMix;         /* Mixed into the random sequence - every scenario of a seed draws a different one */
+}ScenarioRun_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* Firmware state checked at the end of every scenario */
+extern volatile uint32_t TopLimitReached, BottomLimitReached;	/* one bit per channel */
+extern volatile uint32_t LimitSwitchBackoffActive;
+
+static const Scenario_t Scenarios[] =
+{
+    /* name                kind                    gpio         limitGpio            rate    pressB  hold     relB   rep gap      expected                     n */
+    { "clean_press",       SCENARIO_BUTTON,        BUTTON_UP,   0,                   0,      0,      500000,  0,     3,  300000, {MOTOR_ACW, MOTOR_OFF},        2 },
+    { "chatter_2k",        SCENARIO_BUTTON,        BUTTON_DOWN, 0,                   2000,   5000,   500000,  5000,  3,  300000, {MOTOR_CW, MOTOR_OFF},         2 },
+    { "cold_morning_10k",  SCENARIO_BUTTON,        BUTTON_UP,   0,                   10000,  30000,  500000,  30000, 5,  300000, {MOTOR_ACW, MOTOR_OFF},        2 },
+    { "short_tap_5k",      SCENARIO_BUTTON,        BUTTON_DOWN, 0,                   5000,   20000,  50000,   5000,  5,  300000, {MOTOR_OFF},                   0 },
+    { "noise_burst_5k",    SCENARIO_NOISE,         BUTTON_UP,   0,                   5000,   200000, 0,       0,     5,  500000, {MOTOR_OFF},                   0 },
+    { "limit_bottom_10k",  SCENARIO_LIMIT,         BUTTON_DOWN, BUTTON_BOTTOM_LIMIT, 10000,  20000,  150000,  10000, 3,  500000, {MOTOR_CW, MOTOR_ACW, MOTOR_OFF}, 3 },
+    { "limit_top_10k",     SCENARIO_LIMIT,         BUTTON_UP,   BUTTON_TOP_LIMIT,    10000,  20000,  150000,  10000, 3,  500000, {MOTOR_ACW, MOTOR_CW, MOTOR_OFF}, 3 },
+    { "limit_storm_20k",   SCENARIO_LIMIT,         BUTTON_DOWN, BUTTON_BOTTOM_LIMIT, 20000,  100000, 150000,  100000, 3, 500000, {MOTOR_CW, MOTOR_ACW, MOTOR_OFF}, 3 },
+    { "both_buttons_5k",   SCENARIO_BOTH_BUTTONS,  BUTTON_DOWN, 0,                   5000,   100000, 500000,  5000,  3,  300000, {MOTOR_CW, MOTOR_OFF},         2 },
+};
+
+static uint64_t RandomState = 0x2545F4914F6CDD1DULL;
+static uint32_t EdgeCount;
+static bool Verbose;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t Random(void)
+{
+    /* xorshift64* - deterministic for a given seed */
+    RandomState ^= RandomState >> 12;
+    RandomState ^= RandomState << 25;
+    RandomState ^= RandomState >> 27;
+    return (uint32_t)((RandomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void Edge(uint32_t gpio, bool level)
+{
+    if(HostSim_GetPin(gpio) != level)
+    {
+        HostSim_SetInput(gpio, level);
+        EdgeCount++;
+    }
+}
+
+/* Toggles the input at a random interval around 1/rate for the given duration and leaves it at finalLevel */
+static void Chatter(uint32_t gpio, uint32_t rate_hz, uint32_t duration_us, bool finalLevel)
+{
+    uint64_t end = HostSim_NowUs() + duration_us;
+    if((rate_hz > 0U) && (duration_us > 0U))
+    {
+        uint32_t meanInterval_us = 1000000U / rate_hz;
+        for(;;)
+        {
+            uint32_t interval = (meanInterval_us / 2U) + (Random() % (meanInterval_us + 1U));
+            if(interval == 0U) interval = 1U;
+            if(HostSim_NowUs() + interval >= end) break;
+            HostSim_RunForUs(interval);
+            Edge(gpio, !HostSim_GetPin(gpio));
+        }
+    }
+    HostSim_RunUntilUs(end);
+    Edge(gpio, finalLevel);
+}
+
+/* Two inputs chattering at the same time */
+static void ChatterPair(uint32_t gpioA, uint32_t gpioB, uint32_t rate_hz, uint32_t duration_us)
+{
+    uint64_t end = HostSim_NowUs() + duration_us;
+    uint32_t meanInterval_us = 1000000U / rate_hz;
+    for(;;)
+    {
+        uint32_t interval = (meanInterval_us / 2U) + (Random() % (meanInterval_us + 1U));
+        if(interval == 0U) interval = 1U;
+        if(HostSim_NowUs() + interval >= end) break;
+        HostSim_RunForUs(interval);
+        uint32_t gpio = (Random() & 1u) ? gpioA : gpioB;
+        Edge(gpio, !HostSim_GetPin(gpio));
+    }
+    HostSim_RunUntilUs(end);
+}
+
+static MotorOutput_t DecodeMotor(uint8_t motorControl1, uint8_t motorControl2)
+{
+    if(!motorControl1 && !motorControl2) return MOTOR_OFF;
+    if(motorControl1 && !motorControl2) return MOTOR_CW;
+    if(!motorControl1 && motorControl2) return MOTOR_ACW;
+    return MOTOR_INVALID;
+}
+
+static uint32_t LongestCommonSubsequence(const MotorOutput_t *a, uint32_t lenA, const MotorOutput_t *b, uint32_t lenB)
+{
+    static uint32_t table[MAX_OBSERVED_STATES + 1U][MAX_OBSERVED_STATES + 1U];
+    for(uint32_t i = 0; i <= lenA; i++)
+    {
+        for(uint32_t j = 0; j <= lenB; j++)
+        {
+            if((i == 0U) || (j == 0U)) table[i][j] = 0U;
+            else if(a[i - 1U] == b[j - 1U]) table[i][j] = table[i - 1U][j - 1U] + 1U;
+            else table[i][j] = (table[i - 1U][j] > table[i][j - 1U]) ? table[i - 1U][j] : table[i][j - 1U];
+        }
+    }
+    return table[lenA][lenB];
+}
+
+static void CheckFinalState(Result_t *result)
+{
+    char *text = result->finalState;
+    size_t size = sizeof(result->finalState);
+    text[0] = '\0';
+
+    const uint32_t inputs[] = {BUTTON_UP, BUTTON_DOWN, BUTTON_TOP_LIMIT, BUTTON_BOTTOM_LIMIT};
+    for(uint32_t i = 0; i < 4U; i++)
+    {
+        if(HostSim_GetGpioIrqMask(inputs[i]) != GPIO_IRQ_EDGE_RISE)
+        {
+            snprintf(text + strlen(text), size - strlen(text), "irq%u=%x ", (unsigned)inputs[i], (unsigned)HostSim_GetGpioIrqMask(inputs[i]));
+            result->inconsistencies++;
+        }
+    }
+    if(HostSim_GetPin(MOTOR_CONTROL_1) || HostSim_GetPin(MOTOR_CONTROL_2))
+    {
+        snprintf(text + strlen(text), size - strlen(text), "motor_on ");
+        result->inconsistencies++;
+    }
+    if(TopLimitReached || BottomLimitReached || LimitSwitchBackoffActive)
+    {
+        snprintf(text + strlen(text), size - strlen(text), "limit_latched ");
+        result->inconsistencies++;
+    }
+    if(HostSim_IsAlarmArmed(0) || HostSim_IsAlarmArmed(1))
+    {
+        snprintf(text + strlen(text), size - strlen(text), "alarm_armed ");
+        result->inconsistencies++;
+    }
+    if(result->inconsistencies == 0U)
+    {
+        snprintf(text, size, "ok");
+    }
+}
+
+static void RunScenario(const Scenario_t *scenario, Result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+
+    /* Midday in June with the blinds open - AutomaticControlTask leaves the motor alone */
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    const HostSim_MotorEvent_t *log;
+    uint32_t logStart = HostSim_GetMotorLog(&log);
+    HostSim_ResetIsrStats();
+    CycleCounter_Reset();
+    EdgeCount = 0;
+
+    uint64_t pressStart[64];
+    uint32_t repeats = (scenario->repeats < 64U) ? scenario->repeats : 64U;
+
+    for(uint32_t r = 0; r < repeats; r++)
+    {
+        pressStart[r] = HostSim_NowUs();
+        switch(scenario->kind)
+        {
+            case SCENARIO_BUTTON:
+                Chatter(scenario->gpio, scenario->edgeRate_hz, scenario->pressBounce_us, true);
+                HostSim_RunForUs(scenario->hold_us);
+                Chatter(scenario->gpio, scenario->edgeRate_hz, scenario->releaseBounce_us, false);
+                break;
+
+            case SCENARIO_NOISE:
+                Chatter(scenario->gpio, scenario->edgeRate_hz, scenario->pressBounce_us, false);
+                break;
+
+            case SCENARIO_LIMIT:
+                /* The user starts the move, the blinds reach the limit switch, the back-off clears it */
+                Edge(scenario->gpio, true);
+                HostSim_RunForUs(300000);
+                Chatter(scenario->limitGpio, scenario->edgeRate_hz, scenario->pressBounce_us, true);
+                HostSim_RunForUs(scenario->hold_us);
+                Chatter(scenario->limitGpio, scenario->edgeRate_hz, scenario->releaseBounce_us, false);
+                HostSim_RunForUs(300000);
+                Edge(scenario->gpio, false);
+                break;
+
+            case SCENARIO_BOTH_BUTTONS:
+                ChatterPair(BUTTON_UP, BUTTON_DOWN, scenario->edgeRate_hz, scenario->pressBounce_us);
+                Edge(BUTTON_UP, false);
+                Edge(scenario->gpio, true);
+                HostSim_RunForUs(scenario->hold_us);
+                Chatter(scenario->gpio, scenario->edgeRate_hz, scenario->releaseBounce_us, false);
+                break;
+
+            default: break;
+        }
+        HostSim_RunForUs(scenario->gap_us);
+    }
+    HostSim_RunForUs(FINAL_SETTLE_US);
+
+    /* ISR statistics */
+    const uint32_t irqs[] = {IO_IRQ_BANK0, TIMER_IRQ_0, TIMER_IRQ_1};
+    for(uint32_t i = 0; i < 3U; i++)
+    {
+        const HostSim_IsrStats_t *stats = HostSim_GetIsrStats(irqs[i]);
+        result->isrTotal_ns += stats->total_ns;
+        if(stats->max_ns > result->isrMax_ns) result->isrMax_ns = stats->max_ns;
+    }
+    result->gpioIsrEntries = HostSim_GetIsrStats(IO_IRQ_BANK0)->entries;
+    result->alarm0IsrEntries = HostSim_GetIsrStats(TIMER_IRQ_0)->entries;
+    result->alarm1IsrEntries = HostSim_GetIsrStats(TIMER_IRQ_1)->entries;
+    for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+    {
+        result->worstCycles[i] = CycleStats[i].worst;
+    }
+    result->edges = EdgeCount;
+
+    /* Logical events - the sequence of motor states compared with the expected one */
+    MotorOutput_t expected[MAX_OBSERVED_STATES], observed[MAX_OBSERVED_STATES];
+    uint32_t expectedCount = 0, observedCount = 0;
+    for(uint32_t r = 0; r < repeats; r++)
+    {
+        for(uint32_t i = 0; (i < scenario->expectedCount) && (expectedCount < MAX_OBSERVED_STATES); i++)
+        {
+            expected[expectedCount++] = scenario->expected[i];
+        }
+    }
+
+    uint32_t logEnd = HostSim_GetMotorLog(&log);
+    uint32_t nextPress = 0;
+    for(uint32_t i = logStart; (i < logEnd) && (observedCount < MAX_OBSERVED_STATES); i++)
+    {
+        MotorOutput_t state = DecodeMotor(log[i].motorControl1, log[i].motorControl2);
+        if((observedCount == 0U) || (observed[observedCount - 1U] != state))
+        {
+            observed[observedCount++] = state;
+        }
+
+        /* Latency - first edge of the press until the motor starts */
+        if(state != MOTOR_OFF)
+        {
+            while((nextPress + 1U < repeats) && (log[i].time_us >= pressStart[nextPress + 1U])) nextPress++;
+            if((nextPress < repeats) && (log[i].time_us >= pressStart[nextPress]))
+            {
+                uint64_t latency = log[i].time_us - pressStart[nextPress];
+                result->latencySum_us += latency;
+                if(latency > result->latencyMax_us) result->latencyMax_us = latency;
+                result->latencyCount++;
+                nextPress = repeats;
+            }
+        }
+        else if(nextPress >= repeats)
+        {
+            /* Motor stopped - the next start belongs to the next press */
+            nextPress = 0;
+            while((nextPress < repeats) && (pressStart[nextPress] <= log[i].time_us)) nextPress++;
+        }
+    }
+
+    if(Verbose)
+    {
+        static const char stateNames[] = "-CA?";
+        fprintf(stderr, "%s: expected ", scenario->name);
+        for(uint32_t i = 0; i < expectedCount; i++) fputc(stateNames[expected[i]], stderr);
+        fprintf(stderr, " observed ");
+        for(uint32_t i = 0; i < observedCount; i++) fputc(stateNames[observed[i]], stderr);
+        fprintf(stderr, "\n");
+        for(uint32_t i = logStart; i < logEnd; i++)
+        {
+            fprintf(stderr, "  %10.3f ms %c\n", (double)log[i].time_us / 1000.0, stateNames[DecodeMotor(log[i].motorControl1, log[i].motorControl2)]);
+        }
+    }
+
+    uint32_t common = LongestCommonSubsequence(expected, expectedCount, observed, observedCount);
+    result->expectedEvents = expectedCount;
+    result->observedEvents = observedCount;
+    result->missed = expectedCount - common;
+    result->duplicated = observedCount - common;
+
+    CheckFinalState(result);
+}
+
+/* The process of a scenario - with a random sequence of its own */
+static void RunScenarioProcess(const void *context, void *result)
+{
+    const ScenarioRun_t *run = context;
+    RandomState ^= run->randomMix;
+    RunScenario(run->scenario, result);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    const char *csvPath = NULL;
+    const char *label = "local";
+    const char *only = NULL;
+    uint64_t seed = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) seed = strtoull(argv[++i], NULL, 0);
+        else if((strcmp(argv[i], "--csv") == 0) && (i + 1 < argc)) csvPath = argv[++i];
+        else if((strcmp(argv[i], "--label") == 0) && (i + 1 < argc)) label = argv[++i];
+        else if((strcmp(argv[i], "--scenario") == 0) && (i + 1 < argc)) only = argv[++i];
+        else if(strcmp(argv[i], "--verbose") == 0) Verbose = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--seed N] [--scenario NAME] [--csv FILE] [--label TEXT] [--verbose]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *csv = NULL;
+    if(csvPath != NULL)
+    {
+        bool newFile = (access(csvPath, F_OK) != 0);
+        csv = fopen(csvPath, "a");
+        if(csv == NULL)
+        {
+            perror(csvPath);
+            return 1;
+        }
+        if(newFile)
+        {
+            fprintf(csv, "date,label,seed,scenario,edges,gpio_isr,alarm0_isr,alarm1_isr,isr_total_ns,isr_max_ns,gpio_worst_cycles,alarm0_worst_cycles,alarm1_worst_cycles,expected,observed,missed,duplicated,latency_mean_us,latency_max_us,final_state\n");
+        }
+    }
+
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    printf("%-18s %7s %8s %7s %7s %12s %10s %19s %4s %4s %6s %4s %10s %10s  %s\n",
+           "scenario", "edges", "gpio_isr", "alarm0", "alarm1", "isr_total_us", "isr_max_ns", "worst_cyc(io/a0/a1)",
+           "exp", "obs", "missed", "dup", "lat_avg_ms", "lat_max_ms", "final state");
+
+    uint32_t failures = 0;
+    for(size_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+        if((only != NULL) && (strcmp(only, scenario->name) != 0)) continue;
+
+        Result_t result;
+        ScenarioRun_t run = { scenario, seed * 0x9E3779B97F4A7C15ULL + s };
+        if(!HostSim_RunIsolated(RunScenarioProcess, &run, &result, sizeof(result)))
+        {
+            printf("%-18s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        double latencyMean_ms = (result.latencyCount > 0U) ? ((double)result.latencySum_us / result.latencyCount / 1000.0) : 0.0;
+        char worstCycles[32];
+        snprintf(worstCycles, sizeof(worstCycles), "%u/%u/%u", result.worstCycles[CYCLES_ISR_GPIO],
+                 result.worstCycles[CYCLES_ISR_TIMER_UPDOWNBUTTONS], result.worstCycles[CYCLES_ISR_TIMER_LIMITSWITCHES]);
+        printf("%-18s %7u %8u %7u %7u %12.1f %10llu %19s %4u %4u %6u %4u %10.1f %10.1f  %s\n",
+               scenario->name, result.edges, result.gpioIsrEntries, result.alarm0IsrEntries, result.alarm1IsrEntries,
+               (double)result.isrTotal_ns / 1000.0, (unsigned long long)result.isrMax_ns, worstCycles,
+               result.expectedEvents, result.observedEvents, result.missed, result.duplicated,
+               latencyMean_ms, (double)result.latencyMax_us / 1000.0, result.finalState);
+
+        if(csv != NULL)
+        {
+            fprintf(csv, "%s,%s,%llu,%s,%u,%u,%u,%u,%llu,%llu,%u,%u,%u,%u,%u,%u,%u,%.0f,%llu,%s\n",
+                    date, label, (unsigned long long)seed, scenario->name, result.edges, result.gpioIsrEntries,
+                    result.alarm0IsrEntries, result.alarm1IsrEntries, (unsigned long long)result.isrTotal_ns,
+                    (unsigned long long)result.isrMax_ns, result.worstCycles[CYCLES_ISR_GPIO],
+                    result.worstCycles[CYCLES_ISR_TIMER_UPDOWNBUTTONS], result.worstCycles[CYCLES_ISR_TIMER_LIMITSWITCHES],
+                    result.expectedEvents, result.observedEvents, result.missed,
+                    result.duplicated, latencyMean_ms * 1000.0, (unsigned long long)result.latencyMax_us, result.finalState);
+        }
+        if((result.missed > 0U) || (result.duplicated > 0U) || (result.inconsistencies > 0U)) failures++;
+    }
+
+    if(csv != NULL) fclose(csv);
+    printf("%u scenario(s) with missed/duplicated events or an inconsistent final state\n", failures);
+    return 0;
+}
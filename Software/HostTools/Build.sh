@@ -0,0 +1,27 @@
+#!/bin/bash
+
+echo "########## HostTools Build.sh - start ##########"
+echo "Building the host tools with CMake"
+
+if [ ! -d "build" ]; then
+    mkdir build
+    echo "Created build directory"
+else
+    echo "Build directory already exists"
+fi
+
+#configure build directory
+echo Configuring the build directory...
+cd build
+cmake ..
+
+#build the project
+echo Building...
+cmake --build .
+if [ $? -eq 0 ]; then
+    echo "Build successful"
+    exit 0
+else
+    echo "Build failed"
+    exit 1
+fi
@@ -0,0 +1,164 @@
+/* ChannelScaling.c - cost of the multi-channel controller per number of channels.
+
+   Built once per channel count (ChannelScaling_1 .. ChannelScaling_4, each linked against HostSim built with that
+   BLINDS_NUM_OF_CHANNELS). All the channels get the same workload at the same instant - the sunrise opening by
+   AutomaticControlTask, the top limit switches hit together, and the Up/Down buttons of all the channels pressed
+   together - so every interrupt and task job handles as many channels as it can.
+
+   Reported: average/worst execution time of every interrupt handler and task job (CycleCounter), the GPIO interrupt
+   entries, and the smallest gap between two motor starts of different channels against MOTOR_START_STAGGER_IN_US.
+   Exits with 1 if the starts were not staggered or a channel did not end up stopped with its inputs re-enabled. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+#include "CycleCounter.h"
+#include "MotorControllerTask.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (100000ULL)
+#define WORKLOAD_ROUNDS         (8U)
+#define LIMIT_PRESS_US          (40000ULL)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* Firmware state checked at the end of the run */
+extern volatile uint32_t TopLimitReached, BottomLimitReached;	/* one bit per channel */
+extern volatile uint32_t LimitSwitchBackoffActive;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void SetAllChannels(ChannelInput_t input, bool level)
+{
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        HostSim_SetInput(SiteConfig->channels.inputGpio[input][channel], level);
+    }
+}
+
+/* Top limit switches of all the channels hit together, released again after the back-off reversed the motors */
+static void HitTopLimits(void)
+{
+    SetAllChannels(CHANNEL_INPUT_TOP_LIMIT, true);
+    HostSim_RunForUs(LIMIT_PRESS_US);
+    SetAllChannels(CHANNEL_INPUT_TOP_LIMIT, false);
+    HostSim_RunForUs(500000);
+}
+
+static bool MotorRunning(uint32_t outputs, uint32_t channel)
+{
+    return (outputs & ((1UL << SiteConfig->channels.motorControl1Gpio[channel]) | (1UL << SiteConfig->channels.motorControl2Gpio[channel]))) != 0U;
+}
+
+/* Smallest time between a motor starting from standstill and the previous such start of another channel
+   (the back-off reversals are driven from the interrupts and are not staggered) */
+static uint64_t MinimumStartGap(uint32_t *starts)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    uint64_t minimumGap_us = UINT64_MAX;
+    uint64_t lastStart_us = 0;
+    uint32_t lastStartChannel = CHANNEL_NONE;
+    uint32_t previous = 0;
+
+    *starts = 0;
+    for(uint32_t i = 0; i < length; i++)
+    {
+        for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+        {
+            if(!MotorRunning(previous, channel) && MotorRunning(log[i].outputs, channel))
+            {
+                if((lastStartChannel != CHANNEL_NONE) && (lastStartChannel != channel) && ((log[i].time_us - lastStart_us) < minimumGap_us))
+                {
+                    minimumGap_us = log[i].time_us - lastStart_us;
+                }
+                lastStart_us = log[i].time_us;
+                lastStartChannel = channel;
+                (*starts)++;
+            }
+        }
+        previous = log[i].outputs;
+    }
+    return minimumGap_us;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    /* Midday with the blinds closed - AutomaticControlTask opens all of them right after the boot */
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_CLOSED);
+    HostSim_Boot();
+    HostSim_SetMotorLogMask(ChannelLookup.motorOutputsMask);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    HostSim_ResetIsrStats();
+
+    /* Opening - the starts are staggered, every motor runs until its top limit switch */
+    HostSim_RunForUs(BLINDS_NUM_OF_CHANNELS * MOTOR_START_STAGGER_IN_US + 500000ULL);
+    HitTopLimits();
+
+    for(uint32_t round = 0; round < WORKLOAD_ROUNDS; round++)
+    {
+        /* Shift every round by a prime number of microseconds so the presses sample different task phases */
+        HostSim_RunForUs(7919ULL * round);
+
+        /* Down on all the channels together */
+        SetAllChannels(CHANNEL_INPUT_DOWN, true);
+        HostSim_RunForUs(1500000);
+        SetAllChannels(CHANNEL_INPUT_DOWN, false);
+        HostSim_RunForUs(500000);
+
+        /* Up on all the channels together until the top limit switches are hit */
+        SetAllChannels(CHANNEL_INPUT_UP, true);
+        HostSim_RunForUs(BLINDS_NUM_OF_CHANNELS * MOTOR_START_STAGGER_IN_US + 500000ULL);
+        HitTopLimits();
+        SetAllChannels(CHANNEL_INPUT_UP, false);
+        HostSim_RunForUs(500000);
+    }
+
+    printf("channels: %u\n\n", (unsigned)BLINDS_NUM_OF_CHANNELS);
+    printf("%-28s %8s %10s %10s\n", "interrupt/task job", "count", "avg [cyc]", "worst [cyc]");
+    for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+    {
+        const CycleStats_t *stats = &CycleStats[i];
+        printf("%-28s %8u %10.0f %10u\n", CycleItemNames[i], (unsigned)stats->count,
+               (stats->count > 0U) ? (double)stats->total / stats->count : 0.0, (unsigned)stats->worst);
+    }
+    printf("\nGPIO interrupt entries: %u\n", (unsigned)HostSim_GetIsrStats(IO_IRQ_BANK0)->entries);
+
+    uint32_t starts;
+    uint64_t minimumGap_us = MinimumStartGap(&starts);
+    bool staggered = (minimumGap_us == UINT64_MAX) || (minimumGap_us >= MOTOR_START_STAGGER_IN_US);
+    printf("motor starts: %u (deferred by the stagger %u times), ", (unsigned)starts, (unsigned)MotorStartsDeferred);
+    if(minimumGap_us == UINT64_MAX) printf("minimum gap between channels: -");
+    else printf("minimum gap between channels: %llu us", (unsigned long long)minimumGap_us);
+    printf(" (stagger %u us) %s\n", (unsigned)MOTOR_START_STAGGER_IN_US, staggered ? "ok" : "NOT STAGGERED");
+
+    /* Every channel stopped, no limit switch still latched, the rising edges of all inputs enabled */
+    bool consistent = ((TopLimitReached | BottomLimitReached | LimitSwitchBackoffActive) == 0U);
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        consistent = consistent && (CurrentState[channel] == STATE_OFF) && !MotorRunning(gpio_get_all(), channel);
+        for(uint32_t input = 0; input < CHANNEL_NUM_OF_INPUTS; input++)
+        {
+            consistent = consistent && (HostSim_GetGpioIrqMask(SiteConfig->channels.inputGpio[input][channel]) == GPIO_IRQ_EDGE_RISE);
+        }
+    }
+    printf("final state: %s\n", consistent ? "ok" : "INCONSISTENT");
+
+    return (staggered && consistent) ? 0 : 1;
+}
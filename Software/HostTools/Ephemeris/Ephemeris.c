@@ -0,0 +1,93 @@
+/* Ephemeris.c - lookup in the solar ephemeris blob of the fleet provisioning (format in Ephemeris.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <string.h>
+
+/* Include files from other tasks */
+#include "Ephemeris.h"
+#include "Hash.h"
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+const EphemerisHeader_t* EphemerisHeader(const uint8_t *blob);
+const EphemerisSite_t* EphemerisSites(const uint8_t *blob);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+const EphemerisHeader_t* EphemerisHeader(const uint8_t *blob)
+{
+	return (const EphemerisHeader_t*)blob;
+}
+
+const EphemerisSite_t* EphemerisSites(const uint8_t *blob)
+{
+	return (const EphemerisSite_t*)(blob + sizeof(EphemerisHeader_t));
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t Ephemeris_Size(uint32_t numOfSites, uint32_t numOfYears)
+{
+	return (uint32_t)sizeof(EphemerisHeader_t) + (numOfSites * (uint32_t)sizeof(EphemerisSite_t)) +
+	       (numOfSites * numOfYears * EPHEMERIS_DAYS_PER_YEAR * EPHEMERIS_DAY_SIZE);
+}
+
+bool Ephemeris_Check(const uint8_t *blob, uint32_t length)
+{
+	EphemerisHeader_t header;
+
+	if(length < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, blob, sizeof(header));
+	if((header.magic != EPHEMERIS_MAGIC) || (header.version != EPHEMERIS_VERSION) || (header.size > length) ||
+	   (header.size != Ephemeris_Size(header.numOfSites, header.numOfYears)))
+	{
+		return false;
+	}
+	return Hash_Crc32(blob + sizeof(header), header.size - sizeof(header)) == header.crc;
+}
+
+int32_t Ephemeris_FindSite(const uint8_t *blob, uint32_t id)
+{
+	const EphemerisSite_t *sites = EphemerisSites(blob);
+
+	/* A board looks its site up once - no index needed */
+	for(uint32_t site = 0; site < EphemerisHeader(blob)->numOfSites; site++)
+	{
+		if(sites[site].id == id)
+		{
+			return (int32_t)site;
+		}
+	}
+	return -1;
+}
+
+bool Ephemeris_Day(const uint8_t *blob, uint32_t site, uint32_t year, uint32_t dayOfYear, int16_t minutes[EPHEMERIS_NUM_OF_EVENTS])
+{
+	const EphemerisHeader_t *header = EphemerisHeader(blob);
+
+	if((site >= header->numOfSites) || (year < header->firstYear) || (year >= (uint32_t)(header->firstYear + header->numOfYears)) ||
+	   (dayOfYear < 1U) || (dayOfYear > EPHEMERIS_DAYS_PER_YEAR))
+	{
+		return false;
+	}
+
+	uint32_t day = (((site * header->numOfYears) + (year - header->firstYear)) * EPHEMERIS_DAYS_PER_YEAR) + (dayOfYear - 1U);
+	const uint8_t *fields = blob + sizeof(EphemerisHeader_t) + (header->numOfSites * sizeof(EphemerisSite_t)) + (day * EPHEMERIS_DAY_SIZE);
+	uint64_t packed = 0;
+	for(uint32_t i = 0; i < EPHEMERIS_DAY_SIZE; i++)
+	{
+		packed |= (uint64_t)fields[i] << (8U * i);
+	}
+	for(uint32_t event = 0; event < EPHEMERIS_NUM_OF_EVENTS; event++)
+	{
+		uint32_t field = (uint32_t)(packed >> (12U * event)) & 0xFFFU;
+		minutes[event] = (field == EPHEMERIS_NO_EVENT) ? EPHEMERIS_NONE : (int16_t)((int32_t)field - EPHEMERIS_MINUTE_BIAS);
+	}
+	return true;
+}
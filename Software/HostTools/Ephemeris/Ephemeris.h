@@ -0,0 +1,75 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------- MACROS ---------------*/
+
+/* Solar ephemeris of a fleet of sites - generated on the host (HostTools/Ephemeris) with the NOAA algorithm of
+   CalculateSunriseSunset, so a board would not need its coordinates compiled in. Host only for now - the flash layout of the
+   firmware (BootControl.h) has no region for the blob, so the reader is not linked into the image. Little-endian, in this order:
+     EphemerisHeader_t
+     EphemerisSite_t of every site
+     EPHEMERIS_DAYS_PER_YEAR days of every year of the first site, then of the next site...
+   A day is EPHEMERIS_NUM_OF_EVENTS packed 12-bit fields (the first one in the low bits of the first byte): the minute of
+   the event in the local standard time of the site (DST not applied) plus EPHEMERIS_MINUTE_BIAS, or EPHEMERIS_NO_EVENT
+   when the sun does not get to that altitude (polar day/night). Day 366 of a common year is all EPHEMERIS_NO_EVENT */
+#define EPHEMERIS_MAGIC						(0x4D485045U)	/* "EPHM" */
+#define EPHEMERIS_VERSION					(1U)
+#define EPHEMERIS_DAYS_PER_YEAR				(366U)
+#define EPHEMERIS_DAY_SIZE					(6U)			/* 4 x 12 bits */
+#define EPHEMERIS_MINUTE_BIAS				(1024)			/* an event may fall before the local midnight */
+#define EPHEMERIS_NO_EVENT					(0xFFFU)
+#define EPHEMERIS_NONE						(INT16_MIN)		/* decoded EPHEMERIS_NO_EVENT */
+
+#define EPHEMERIS_ZENITH_SUNRISE			(90.833)		/* refraction and the radius of the sun - as CalculateSunriseSunset */
+#define EPHEMERIS_ZENITH_CIVIL				(96.0)			/* civil twilight, the sun 6 degrees below the horizon */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef enum
+{
+	EPHEMERIS_CIVIL_DAWN,
+	EPHEMERIS_SUNRISE,
+	EPHEMERIS_SUNSET,
+	EPHEMERIS_CIVIL_DUSK,
+	EPHEMERIS_NUM_OF_EVENTS
+}EphemerisEvent_t;
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t numOfSites;
+	uint16_t firstYear;
+	uint16_t numOfYears;
+	uint32_t size;				/* of the whole blob */
+	uint32_t crc;				/* CRC-32 of everything after the header */
+}EphemerisHeader_t;
+
+typedef struct
+{
+	uint32_t id;				/* assigned by the provisioning, unique in the blob */
+	int32_t latitude_udeg;		/* in micro degrees, north positive */
+	int32_t longitude_udeg;		/* east positive */
+	int16_t utcOffset_min;		/* standard time of the site */
+	uint16_t reserved;
+}EphemerisSite_t;
+
+/*--------------- GLOBAL FUNCTION DECLARTIONS ---------------*/
+
+/* Size of a blob with the given sites and years */
+uint32_t Ephemeris_Size(uint32_t numOfSites, uint32_t numOfYears);
+
+/* Magic, version, size and CRC of a blob (e.g. in the flash) - the other functions expect a checked one */
+bool Ephemeris_Check(const uint8_t *blob, uint32_t length);
+
+/* Index of the site with the given id, -1 if the blob has none */
+int32_t Ephemeris_FindSite(const uint8_t *blob, uint32_t id);
+
+/* Minutes of the events (EphemerisEvent_t) of the day (1..366) - false if the blob does not cover the year */
+bool Ephemeris_Day(const uint8_t *blob, uint32_t site, uint32_t year, uint32_t dayOfYear, int16_t minutes[EPHEMERIS_NUM_OF_EVENTS]);
+
+#endif /* EPHEMERIS_H */
@@ -0,0 +1,43 @@
+/* EphemerisKernel.c - the days of a year in SIMD lanes. Built with -ffast-math -fopenmp-simd (see CMakeLists.txt), so the
+   sin/cos/tan/asin/acos calls of the loop go to the vector variants of the glibc vector math library (libmvec). The parts
+   that do not vectorise without SSE4.1 (the fmod, the rounding to int) run before and after it */
+
+/*---------------- INCLUDES ----------------------*/
+#include "EphemerisKernel.h"
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void EphemerisKernel_Year(double latitude, double longitude, int32_t utcOffset_min, uint32_t year,
+                          int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS])
+{
+    double julianCentury[EPHEMERIS_DAYS_PER_YEAR], geomMeanLongSun[EPHEMERIS_DAYS_PER_YEAR];
+    double cosSunrise[EPHEMERIS_DAYS_PER_YEAR], cosCivil[EPHEMERIS_DAYS_PER_YEAR];
+    double hours[EPHEMERIS_NUM_OF_EVENTS][EPHEMERIS_DAYS_PER_YEAR];
+    bool leap = ((year % 4U) == 0U) && (((year % 100U) != 0U) || ((year % 400U) == 0U));
+    int32_t days = leap ? 366 : 365;
+    double firstDate = EphemerisKernel_Date(year, 1U);
+
+    for(int32_t day = 0; day < days; day++)
+    {
+        EphemerisKernel_Noon(firstDate + (double)day, &julianCentury[day], &geomMeanLongSun[day]);
+    }
+
+#pragma omp simd
+    for(int32_t day = 0; day < days; day++)
+    {
+        EphemerisKernel_Events(latitude, longitude, (double)utcOffset_min, julianCentury[day], geomMeanLongSun[day], &cosSunrise[day], &cosCivil[day],
+                               &hours[EPHEMERIS_CIVIL_DAWN][day], &hours[EPHEMERIS_SUNRISE][day], &hours[EPHEMERIS_SUNSET][day], &hours[EPHEMERIS_CIVIL_DUSK][day]);
+    }
+
+    for(int32_t day = 0; day < days; day++)
+    {
+        minutes[day][EPHEMERIS_CIVIL_DAWN] = EphemerisKernel_Minute(hours[EPHEMERIS_CIVIL_DAWN][day], cosCivil[day]);
+        minutes[day][EPHEMERIS_SUNRISE] = EphemerisKernel_Minute(hours[EPHEMERIS_SUNRISE][day], cosSunrise[day]);
+        minutes[day][EPHEMERIS_SUNSET] = EphemerisKernel_Minute(hours[EPHEMERIS_SUNSET][day], cosSunrise[day]);
+        minutes[day][EPHEMERIS_CIVIL_DUSK] = EphemerisKernel_Minute(hours[EPHEMERIS_CIVIL_DUSK][day], cosCivil[day]);
+    }
+    for(int32_t event = 0; (event < (int32_t)EPHEMERIS_NUM_OF_EVENTS) && !leap; event++)
+    {
+        minutes[EPHEMERIS_DAYS_PER_YEAR - 1U][event] = EPHEMERIS_NONE;
+    }
+}
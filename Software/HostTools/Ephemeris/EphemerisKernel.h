@@ -0,0 +1,109 @@
+#ifndef EPHEMERISKERNEL_H
+#define EPHEMERISKERNEL_H
+
+/* EphemerisKernel - the NOAA sunrise/sunset algorithm of CalculateSunriseSunset (AutomaticControlTask.c) for whole years of a
+   site, with the day number of the year taken into account and the civil twilight added. The days of a year are computed
+   in SIMD lanes (EphemerisKernel.c is built with the vector math library), EphemerisKernel_Day is the same formula for a
+   single day compiled like the firmware - the reference of the vectorised one */
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <math.h>
+#include "Ephemeris.h"
+
+/*--------------- MACROS ---------------*/
+#define EPHEMERIS_KERNEL_DEG_TO_RAD     (M_PI / 180.0)
+#define EPHEMERIS_KERNEL_RAD_TO_DEG     (180.0 / M_PI)
+
+/*--------------- GLOBAL FUNCTION DEFINITIONS (inline) ---------------*/
+
+/* Date of CalculateSunriseSunset (44927 + dayOfYear for 2023), moved by the whole days between 2023 and the year */
+static inline double EphemerisKernel_Date(uint32_t year, uint32_t dayOfYear)
+{
+    int32_t days = 0;
+    for(uint32_t y = 2023U; y < year; y++) days += ((y % 4U == 0U) && ((y % 100U != 0U) || (y % 400U == 0U))) ? 366 : 365;
+    for(uint32_t y = year; y < 2023U; y++) days -= ((y % 4U == 0U) && ((y % 100U != 0U) || (y % 400U == 0U))) ? 366 : 365;
+    return (double)(44927 + days + (int32_t)dayOfYear);
+}
+
+/* Julian century and the geometric mean longitude of the sun (reduced to 0..360 degrees like the fmod of
+   CalculateSunriseSunset) at the noon of the day - the scalar part, no trigonometry. The noon is taken at the site, the
+   time zone ignored like the integer division of CalculateSunriseSunset does */
+static inline void EphemerisKernel_Noon(double date, double *julianCentury, double *geomMeanLongSun)
+{
+    double julianDay = date + 2415018.5 + 0.5;
+    *julianCentury = (julianDay - 2451545.0) / 36525.0;
+    *geomMeanLongSun = fmod(280.46646 + *julianCentury * (36000.76983 + *julianCentury * 0.0003032), 360.0);
+}
+
+/* Cosine of the hour angle of the sun at the zenith angle - out of -1..1 when the sun never gets there */
+static inline double EphemerisKernel_CosHourAngle(double zenith, double latitude, double declination)
+{
+    return (cos(zenith * EPHEMERIS_KERNEL_DEG_TO_RAD) / (cos(latitude * EPHEMERIS_KERNEL_DEG_TO_RAD) * cos(declination * EPHEMERIS_KERNEL_DEG_TO_RAD))) -
+           (tan(latitude * EPHEMERIS_KERNEL_DEG_TO_RAD) * tan(declination * EPHEMERIS_KERNEL_DEG_TO_RAD));
+}
+
+/* Hours of the event from the solar noon and the cosine of its hour angle (clamped - see EphemerisKernel_Minute) */
+static inline double EphemerisKernel_Hours(double solarNoon, double cosHourAngle, double sign)
+{
+    double hourAngle = acos(fmin(fmax(cosHourAngle, -1.0), 1.0)) * EPHEMERIS_KERNEL_RAD_TO_DEG;
+    return (((solarNoon * 1440.0) + (sign * hourAngle * 4.0)) / 1440.0) * 24.0;
+}
+
+/* The trigonometric part - solar noon and the cosines of the hour angles of the sunrise/sunset and of the civil twilight,
+   the hours of the events (EphemerisEvent_t) */
+static inline void EphemerisKernel_Events(double latitude, double longitude, double utcOffset_min, double julianCentury, double geomMeanLongSun,
+                                          double *cosSunrise, double *cosCivil, double *civilDawn, double *sunrise, double *sunset, double *civilDusk)
+{
+    double eccentEarthOrbit = 0.016708634 - julianCentury * (0.000042037 + 0.0000001267 * julianCentury);
+    double geomMeanAnomSun = 357.52911 + julianCentury * (35999.05029 - 0.0001537 * julianCentury);
+    double meanObliqEcliptic = 23.0 + (26.0 + ((21.448 - julianCentury * (46.815 + julianCentury * (0.00059 - julianCentury * 0.001813)))) / 60.0) / 60.0;
+    double obliqCorr = meanObliqEcliptic + 0.00256 * cos((125.04 - 1934.136 * julianCentury) * EPHEMERIS_KERNEL_DEG_TO_RAD);
+    double varY = tan((obliqCorr / 2.0) * EPHEMERIS_KERNEL_DEG_TO_RAD) * tan((obliqCorr / 2.0) * EPHEMERIS_KERNEL_DEG_TO_RAD);
+    double eqOfTime = 4.0 * EPHEMERIS_KERNEL_RAD_TO_DEG * (varY * sin(2.0 * geomMeanLongSun * EPHEMERIS_KERNEL_DEG_TO_RAD)
+                      - 2.0 * eccentEarthOrbit * sin(geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD)
+                      + 4.0 * eccentEarthOrbit * varY * sin(geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD) * cos(2.0 * geomMeanLongSun * EPHEMERIS_KERNEL_DEG_TO_RAD)
+                      - 0.5 * varY * varY * sin(4.0 * geomMeanLongSun * EPHEMERIS_KERNEL_DEG_TO_RAD)
+                      - 1.25 * eccentEarthOrbit * eccentEarthOrbit * sin(2.0 * geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD));
+    double solarNoon = (720.0 - 4.0 * longitude - eqOfTime + utcOffset_min) / 1440.0;
+    double sunEqOfCtr = sin(geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD) * (1.914602 - julianCentury * (0.004817 + 0.000014 * julianCentury))
+                        + sin(2.0 * geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD) * (0.019993 - 0.000101 * julianCentury)
+                        + sin(3.0 * geomMeanAnomSun * EPHEMERIS_KERNEL_DEG_TO_RAD) * 0.000289;
+    double sunAppLong = geomMeanLongSun + sunEqOfCtr - 0.00569 - 0.00478 * sin((125.04 - 1934.136 * julianCentury) * EPHEMERIS_KERNEL_DEG_TO_RAD);
+    double declination = asin(sin(obliqCorr * EPHEMERIS_KERNEL_DEG_TO_RAD) * sin(sunAppLong * EPHEMERIS_KERNEL_DEG_TO_RAD)) * EPHEMERIS_KERNEL_RAD_TO_DEG;
+
+    *cosSunrise = EphemerisKernel_CosHourAngle(EPHEMERIS_ZENITH_SUNRISE, latitude, declination);
+    *cosCivil = EphemerisKernel_CosHourAngle(EPHEMERIS_ZENITH_CIVIL, latitude, declination);
+    *civilDawn = EphemerisKernel_Hours(solarNoon, *cosCivil, -1.0);
+    *sunrise = EphemerisKernel_Hours(solarNoon, *cosSunrise, -1.0);
+    *sunset = EphemerisKernel_Hours(solarNoon, *cosSunrise, 1.0);
+    *civilDusk = EphemerisKernel_Hours(solarNoon, *cosCivil, 1.0);
+}
+
+/* Minute of the event - the rounding of Schedule_Compile (the first minute at or after it), EPHEMERIS_NONE when the sun
+   does not get to the altitude that day */
+static inline int32_t EphemerisKernel_Minute(double hours, double cosHourAngle)
+{
+    return ((cosHourAngle > 1.0) || (cosHourAngle < -1.0)) ? (int32_t)EPHEMERIS_NONE : (int32_t)ceil(hours * 60.0);
+}
+
+/* Events of one day at the site - the reference of the vectorised EphemerisKernel_Year */
+static inline void EphemerisKernel_Day(double latitude, double longitude, double utcOffset_min, double date, int32_t minutes[EPHEMERIS_NUM_OF_EVENTS])
+{
+    double julianCentury, geomMeanLongSun, cosSunrise, cosCivil, hours[EPHEMERIS_NUM_OF_EVENTS];
+    EphemerisKernel_Noon(date, &julianCentury, &geomMeanLongSun);
+    EphemerisKernel_Events(latitude, longitude, utcOffset_min, julianCentury, geomMeanLongSun, &cosSunrise, &cosCivil,
+                           &hours[EPHEMERIS_CIVIL_DAWN], &hours[EPHEMERIS_SUNRISE], &hours[EPHEMERIS_SUNSET], &hours[EPHEMERIS_CIVIL_DUSK]);
+    minutes[EPHEMERIS_CIVIL_DAWN] = EphemerisKernel_Minute(hours[EPHEMERIS_CIVIL_DAWN], cosCivil);
+    minutes[EPHEMERIS_SUNRISE] = EphemerisKernel_Minute(hours[EPHEMERIS_SUNRISE], cosSunrise);
+    minutes[EPHEMERIS_SUNSET] = EphemerisKernel_Minute(hours[EPHEMERIS_SUNSET], cosSunrise);
+    minutes[EPHEMERIS_CIVIL_DUSK] = EphemerisKernel_Minute(hours[EPHEMERIS_CIVIL_DUSK], cosCivil);
+}
+
+/*--------------- GLOBAL FUNCTION DECLARATIONS ---------------*/
+
+/* Events of all the days of the year (365 or 366) at the site, vectorised across the days */
+void EphemerisKernel_Year(double latitude, double longitude, int32_t utcOffset_min, uint32_t year,
+                          int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS]);
+
+#endif /* EPHEMERISKERNEL_H */
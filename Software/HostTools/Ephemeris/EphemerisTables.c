@@ -0,0 +1,457 @@
+/* EphemerisTables.c - solar ephemeris blob of a fleet of sites (format in Ephemeris.h) for the provisioning.
+
+   Every site gets the civil dawn, sunrise, sunset and civil dusk of every day of the years, in its local standard time,
+   from the NOAA algorithm of CalculateSunriseSunset. The days of a year are computed in SIMD lanes (EphemerisKernel.c),
+   the sites are split between threads, every thread packs its site-years straight into the blob.
+
+   Checked every run:
+     - the blob with Ephemeris_Check/Ephemeris_FindSite/Ephemeris_Day (Ephemeris.c) - every day of every site-year
+       decodes to what the kernel computed
+     - the vectorised kernel against the scalar formula (EphemerisKernel_Day) for a sample of the site-years
+     - the home site in 2023 (UTC+1) against CalculateSunriseSunset of the firmware with the hour Schedule_Compile takes
+       away outside of the DST
+
+   Without --sites a synthetic fleet (the home site and FLEET_SITES sites spread over the inhabited latitudes, the polar
+   circles included) is generated as a benchmark: single thread scalar, single thread SIMD and the threads.
+
+   Sites file - a site per line, "id latitude longitude utcOffsetMinutes" (degrees, north/east positive), # comments.
+
+   Usage: EphemerisTables [--sites FILE] [--first-year YEAR] [--years N] [--threads N] [--out FILE]
+   Exits with 1 if the blob does not decode to the computed tables, the kernel differs from the reference or from the firmware,
+   or an event does not fit in the 12-bit field. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* Firmware includes */
+#include "AutomaticControlTask.h"
+#include "Ephemeris.h"
+#include "Hash.h"
+
+#include "EphemerisKernel.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define DEFAULT_FIRST_YEAR      (2026U)
+#define DEFAULT_YEARS           (10U)
+#define MAX_SITES               (UINT16_MAX)
+#define MAX_THREADS             (64U)
+#define FLEET_SITES             (1000U)
+#define HOME_SITE_ID            (1U)
+#define HOME_UTC_OFFSET_MIN     ((TIME_ZONE_PLUS_TO_E - 1) * 60)     /* CET - the firmware takes an hour away outside of the DST */
+#define REFERENCE_STRIDE        (7U)            /* every 7th site-year is compared with the scalar formula */
+#define FIRMWARE_YEAR           (2023U)         /* the year of the dates of CalculateSunriseSunset */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    const EphemerisSite_t *sites;
+    uint32_t numOfSites;
+    uint32_t firstYear;
+    uint32_t numOfYears;
+    uint8_t *days;                      /* the day fields of the blob */
+    atomic_uint nextSite;
+    atomic_uint outOfRange;             /* events which do not fit in the field */
+}Job_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *EventNames[EPHEMERIS_NUM_OF_EVENTS] = { "dawn", "sunrise", "sunset", "dusk" };
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static double Latitude(const EphemerisSite_t *site)
+{
+    return (double)site->latitude_udeg * 1e-6;
+}
+
+static double Longitude(const EphemerisSite_t *site)
+{
+    return (double)site->longitude_udeg * 1e-6;
+}
+
+static void PutUint16(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void PutUint32(uint8_t *p, uint32_t value)
+{
+    PutUint16(p, value);
+    PutUint16(p + 2, value >> 16);
+}
+
+/* Packs a day - false if an event does not fit in its field */
+static bool PackDay(uint8_t *fields, const int32_t minutes[EPHEMERIS_NUM_OF_EVENTS])
+{
+    uint64_t packed = 0;
+    bool fits = true;
+    for(uint32_t event = 0; event < EPHEMERIS_NUM_OF_EVENTS; event++)
+    {
+        uint32_t field = EPHEMERIS_NO_EVENT;
+        if(minutes[event] != EPHEMERIS_NONE)
+        {
+            int32_t biased = minutes[event] + EPHEMERIS_MINUTE_BIAS;
+            if((biased >= 0) && (biased < (int32_t)EPHEMERIS_NO_EVENT)) field = (uint32_t)biased;
+            else fits = false;
+        }
+        packed |= (uint64_t)field << (12U * event);
+    }
+    for(uint32_t i = 0; i < EPHEMERIS_DAY_SIZE; i++)
+    {
+        fields[i] = (uint8_t)(packed >> (8U * i));
+    }
+    return fits;
+}
+
+static void *Worker(void *arg)
+{
+    Job_t *job = (Job_t *)arg;
+    int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS];
+
+    /* A site at a time from the shared counter - the sites near the poles are not slower, but the threads stay busy anyway */
+    for(uint32_t site = atomic_fetch_add(&job->nextSite, 1U); site < job->numOfSites; site = atomic_fetch_add(&job->nextSite, 1U))
+    {
+        const EphemerisSite_t *s = &job->sites[site];
+        for(uint32_t y = 0; y < job->numOfYears; y++)
+        {
+            EphemerisKernel_Year(Latitude(s), Longitude(s), s->utcOffset_min, job->firstYear + y, minutes);
+            uint8_t *fields = job->days + ((((site * job->numOfYears) + y) * EPHEMERIS_DAYS_PER_YEAR) * EPHEMERIS_DAY_SIZE);
+            for(uint32_t day = 0; day < EPHEMERIS_DAYS_PER_YEAR; day++)
+            {
+                if(!PackDay(fields + (day * EPHEMERIS_DAY_SIZE), minutes[day])) atomic_fetch_add(&job->outOfRange, 1U);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Blob of the sites - the header, the sites and the days (computed by the threads), then the CRC */
+static uint8_t *Generate(const EphemerisSite_t *sites, uint32_t numOfSites, uint32_t firstYear, uint32_t numOfYears, uint32_t threads,
+                         uint32_t *size, uint32_t *outOfRange)
+{
+    *size = Ephemeris_Size(numOfSites, numOfYears);
+    uint8_t *blob = calloc(1, *size);
+    if(blob == NULL) return NULL;
+
+    uint8_t *p = blob + sizeof(EphemerisHeader_t);
+    for(uint32_t site = 0; site < numOfSites; site++, p += sizeof(EphemerisSite_t))
+    {
+        PutUint32(p, sites[site].id);
+        PutUint32(p + 4, (uint32_t)sites[site].latitude_udeg);
+        PutUint32(p + 8, (uint32_t)sites[site].longitude_udeg);
+        PutUint16(p + 12, (uint32_t)(uint16_t)sites[site].utcOffset_min);
+        PutUint16(p + 14, 0U);
+    }
+
+    Job_t job = { .sites = sites, .numOfSites = numOfSites, .firstYear = firstYear, .numOfYears = numOfYears, .days = p };
+    atomic_init(&job.nextSite, 0U);
+    atomic_init(&job.outOfRange, 0U);
+    pthread_t workers[MAX_THREADS];
+    for(uint32_t t = 1; t < threads; t++)
+    {
+        pthread_create(&workers[t], NULL, Worker, &job);
+    }
+    Worker(&job);
+    for(uint32_t t = 1; t < threads; t++)
+    {
+        pthread_join(workers[t], NULL);
+    }
+    *outOfRange = atomic_load(&job.outOfRange);
+
+    PutUint32(blob, EPHEMERIS_MAGIC);
+    PutUint16(blob + 4, EPHEMERIS_VERSION);
+    PutUint16(blob + 6, numOfSites);
+    PutUint16(blob + 8, firstYear);
+    PutUint16(blob + 10, numOfYears);
+    PutUint32(blob + 12, *size);
+    PutUint32(blob + 16, Hash_Crc32(blob + sizeof(EphemerisHeader_t), *size - sizeof(EphemerisHeader_t)));
+    return blob;
+}
+
+/* Every day of every site-year decoded by Ephemeris.c against the kernel, a sample against the scalar formula - returns
+   the mismatches */
+static uint32_t Verify(const uint8_t *blob, uint32_t size, const EphemerisSite_t *sites, uint32_t numOfSites, uint32_t firstYear, uint32_t numOfYears,
+                       uint32_t *referenceChecked)
+{
+    int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS];
+    uint32_t mismatches = 0;
+
+    *referenceChecked = 0;
+    if(!Ephemeris_Check(blob, size))
+    {
+        printf("MISMATCH: Ephemeris_Check rejects the blob\n");
+        return 1;
+    }
+    for(uint32_t site = 0; site < numOfSites; site++)
+    {
+        const EphemerisSite_t *s = &sites[site];
+        int32_t index = Ephemeris_FindSite(blob, s->id);
+        if(index != (int32_t)site)
+        {
+            if(mismatches++ == 0U) printf("MISMATCH: site %u found at %d\n", (unsigned)s->id, (int)index);
+            continue;
+        }
+        for(uint32_t y = 0; y < numOfYears; y++)
+        {
+            uint32_t year = firstYear + y;
+            bool reference = ((((site * numOfYears) + y) % REFERENCE_STRIDE) == 0U);
+            EphemerisKernel_Year(Latitude(s), Longitude(s), s->utcOffset_min, year, minutes);
+            for(uint32_t day = 0; day < EPHEMERIS_DAYS_PER_YEAR; day++)
+            {
+                int16_t decoded[EPHEMERIS_NUM_OF_EVENTS];
+                int32_t scalar[EPHEMERIS_NUM_OF_EVENTS];
+                bool valid = isLeapYear(year) || (day < (EPHEMERIS_DAYS_PER_YEAR - 1U));
+                if(reference && valid) EphemerisKernel_Day(Latitude(s), Longitude(s), s->utcOffset_min, EphemerisKernel_Date(year, day + 1U), scalar);
+                if(!Ephemeris_Day(blob, site, year, day + 1U, decoded))
+                {
+                    if(mismatches++ == 0U) printf("MISMATCH: Ephemeris_Day refuses site %u %u day %u\n", (unsigned)s->id, (unsigned)year, (unsigned)(day + 1U));
+                    continue;
+                }
+                for(uint32_t event = 0; event < EPHEMERIS_NUM_OF_EVENTS; event++)
+                {
+                    bool same = (decoded[event] == minutes[day][event]);
+                    if(reference && valid) same = same && (scalar[event] == minutes[day][event]);
+                    if(!same && (mismatches++ == 0U))
+                    {
+                        printf("MISMATCH: site %u %u day %u %s: blob %d, kernel %d, reference %d\n", (unsigned)s->id, (unsigned)year,
+                               (unsigned)(day + 1U), EventNames[event], (int)decoded[event], (int)minutes[day][event],
+                               (reference && valid) ? (int)scalar[event] : (int)minutes[day][event]);
+                    }
+                }
+                if(reference && valid) (*referenceChecked)++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+/* The home site against the firmware - the same rounding as Schedule_Compile, the hour away (standard time) */
+static uint32_t CompareFirmware(void)
+{
+    int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS];
+    uint32_t mismatches = 0;
+    uint32_t days = isLeapYear(FIRMWARE_YEAR) ? 366U : 365U;
+
+    EphemerisKernel_Year(LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, HOME_UTC_OFFSET_MIN, FIRMWARE_YEAR, minutes);
+    for(uint32_t day = 0; day < days; day++)
+    {
+        double sunriseHours, sunsetHours;
+        CalculateSunriseSunset(LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, (int)(day + 1U), TIME_ZONE_PLUS_TO_E, &sunriseHours, &sunsetHours);
+        int32_t sunrise = (int32_t)ceil((sunriseHours - 1.0) * 60.0);
+        int32_t sunset = (int32_t)ceil((sunsetHours - 1.0) * 60.0);
+        if((sunrise != minutes[day][EPHEMERIS_SUNRISE]) || (sunset != minutes[day][EPHEMERIS_SUNSET]))
+        {
+            if(mismatches++ == 0U)
+            {
+                printf("MISMATCH: day %u firmware %d-%d, kernel %d-%d\n", (unsigned)(day + 1U), (int)sunrise, (int)sunset,
+                       (int)minutes[day][EPHEMERIS_SUNRISE], (int)minutes[day][EPHEMERIS_SUNSET]);
+            }
+        }
+    }
+    printf("home site %u against CalculateSunriseSunset: %u days, %u mismatches\n", (unsigned)FIRMWARE_YEAR, (unsigned)days, (unsigned)mismatches);
+    return mismatches;
+}
+
+static uint32_t ReadSites(const char *path, EphemerisSite_t *sites)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    uint32_t numOfSites = 0;
+
+    if(file == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    while((fgets(line, sizeof(line), file) != NULL) && (numOfSites < MAX_SITES))
+    {
+        unsigned id;
+        double latitude, longitude;
+        int utcOffset;
+        char *comment = strchr(line, '#');
+        if(comment != NULL) *comment = '\0';
+        if(sscanf(line, "%u %lf %lf %d", &id, &latitude, &longitude, &utcOffset) != 4) continue;
+        sites[numOfSites].id = id;
+        sites[numOfSites].latitude_udeg = (int32_t)lround(latitude * 1e6);
+        sites[numOfSites].longitude_udeg = (int32_t)lround(longitude * 1e6);
+        sites[numOfSites].utcOffset_min = (int16_t)utcOffset;
+        numOfSites++;
+    }
+    fclose(file);
+    return numOfSites;
+}
+
+/* The home site and sites from 60S to 75N, every longitude, the standard time of the nearest whole hour zone */
+static uint32_t SyntheticFleet(EphemerisSite_t *sites)
+{
+    sites[0].id = HOME_SITE_ID;
+    sites[0].latitude_udeg = (int32_t)lround(LATITUDE_SIEROSZEWICE_NOWA_10 * 1e6);
+    sites[0].longitude_udeg = (int32_t)lround(LONGITUDE_SIEROSZEWICE_NOWA_10 * 1e6);
+    sites[0].utcOffset_min = HOME_UTC_OFFSET_MIN;
+    for(uint32_t i = 1; i <= FLEET_SITES; i++)
+    {
+        double latitude = -60.0 + (135.0 * (double)i / (double)FLEET_SITES);
+        double longitude = -180.0 + fmod(137.508 * (double)i, 360.0);
+        sites[i].id = HOME_SITE_ID + i;
+        sites[i].latitude_udeg = (int32_t)lround(latitude * 1e6);
+        sites[i].longitude_udeg = (int32_t)lround(longitude * 1e6);
+        sites[i].utcOffset_min = (int16_t)(lround(longitude / 15.0) * 60);
+    }
+    return FLEET_SITES + 1U;
+}
+
+/* Single thread: the scalar formula per day, then the SIMD kernel per year - the time of one site-year */
+static void BenchmarkKernel(const EphemerisSite_t *sites, uint32_t numOfSites, uint32_t firstYear, uint32_t numOfYears)
+{
+    static int32_t minutes[EPHEMERIS_DAYS_PER_YEAR][EPHEMERIS_NUM_OF_EVENTS];
+    volatile int32_t sink = 0;
+
+    double start = NowNs();
+    for(uint32_t site = 0; site < numOfSites; site++)
+    {
+        for(uint32_t y = 0; y < numOfYears; y++)
+        {
+            for(uint32_t day = 0; day < 365U; day++)
+            {
+                EphemerisKernel_Day(Latitude(&sites[site]), Longitude(&sites[site]), sites[site].utcOffset_min,
+                                    EphemerisKernel_Date(firstYear + y, day + 1U), minutes[day]);
+            }
+            sink += minutes[180][EPHEMERIS_SUNRISE];
+        }
+    }
+    double scalar_ns = (NowNs() - start) / (double)(numOfSites * numOfYears);
+
+    start = NowNs();
+    for(uint32_t site = 0; site < numOfSites; site++)
+    {
+        for(uint32_t y = 0; y < numOfYears; y++)
+        {
+            EphemerisKernel_Year(Latitude(&sites[site]), Longitude(&sites[site]), sites[site].utcOffset_min, firstYear + y, minutes);
+            sink += minutes[180][EPHEMERIS_SUNRISE];
+        }
+    }
+    double simd_ns = (NowNs() - start) / (double)(numOfSites * numOfYears);
+    (void)sink;
+
+    printf("one site-year, single thread: scalar %.1fus, SIMD %.1fus (%.2fx)\n", scalar_ns / 1e3, simd_ns / 1e3, scalar_ns / simd_ns);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    static EphemerisSite_t sites[MAX_SITES];
+    const char *sitesPath = NULL, *outPath = NULL;
+    uint32_t firstYear = DEFAULT_FIRST_YEAR, numOfYears = DEFAULT_YEARS;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threads = (processors > 0) ? (uint32_t)processors : 1U;
+    uint32_t failures = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--sites") == 0) && ((i + 1) < argc)) sitesPath = argv[++i];
+        else if((strcmp(argv[i], "--first-year") == 0) && ((i + 1) < argc)) firstYear = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if((strcmp(argv[i], "--years") == 0) && ((i + 1) < argc)) numOfYears = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if((strcmp(argv[i], "--threads") == 0) && ((i + 1) < argc)) threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if((strcmp(argv[i], "--out") == 0) && ((i + 1) < argc)) outPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--sites FILE] [--first-year YEAR] [--years N] [--threads N] [--out FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(threads < 1U) threads = 1U;
+    if(threads > MAX_THREADS) threads = MAX_THREADS;
+    if((numOfYears < 1U) || (numOfYears > UINT16_MAX) || (firstYear > UINT16_MAX) ||
+       ((uint64_t)Ephemeris_Size(MAX_SITES, 1U) * numOfYears > UINT32_MAX))
+    {
+        fprintf(stderr, "first year/years out of range\n");
+        return 1;
+    }
+
+    uint32_t numOfSites = (sitesPath != NULL) ? ReadSites(sitesPath, sites) : SyntheticFleet(sites);
+    if(numOfSites == 0U)
+    {
+        fprintf(stderr, "no sites\n");
+        return 1;
+    }
+    printf("%u sites x %u years (%u-%u) = %u site-years, %u threads\n", (unsigned)numOfSites, (unsigned)numOfYears, (unsigned)firstYear,
+           (unsigned)(firstYear + numOfYears - 1U), (unsigned)(numOfSites * numOfYears), (unsigned)threads);
+
+    if(sitesPath == NULL) BenchmarkKernel(sites, numOfSites, firstYear, numOfYears);
+
+    uint32_t size, outOfRange;
+    double start = NowNs();
+    uint8_t *blob = Generate(sites, numOfSites, firstYear, numOfYears, threads, &size, &outOfRange);
+    double generate_ms = (NowNs() - start) / 1e6;
+    if(blob == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("generated in %.1fms (%.1fus per site-year), blob %u bytes (%u per site-year)\n", generate_ms,
+           generate_ms * 1e3 / (double)(numOfSites * numOfYears), (unsigned)size, (unsigned)(EPHEMERIS_DAYS_PER_YEAR * EPHEMERIS_DAY_SIZE));
+    if(outOfRange > 0U)
+    {
+        printf("MISMATCH: %u events out of the range of the field (site too far from its time zone?)\n", (unsigned)outOfRange);
+        failures++;
+    }
+
+    uint32_t referenceChecked;
+    uint32_t mismatches = Verify(blob, size, sites, numOfSites, firstYear, numOfYears, &referenceChecked);
+    printf("blob decoded by Ephemeris.c: %u site-days, %u compared with the scalar formula, %u mismatches\n",
+           (unsigned)(numOfSites * numOfYears * EPHEMERIS_DAYS_PER_YEAR), (unsigned)referenceChecked, (unsigned)mismatches);
+    if(mismatches > 0U) failures++;
+    if(CompareFirmware() > 0U) failures++;
+
+    /* Some days of the first site */
+    printf("\nsite %u (%.4f, %.4f, UTC%+d min), %u:\n", (unsigned)sites[0].id, Latitude(&sites[0]), Longitude(&sites[0]),
+           (int)sites[0].utcOffset_min, (unsigned)firstYear);
+    printf("%-5s %7s %7s %7s %7s\n", "day", EventNames[0], EventNames[1], EventNames[2], EventNames[3]);
+    for(uint32_t day = 1; day <= 365U; day += 61U)
+    {
+        int16_t decoded[EPHEMERIS_NUM_OF_EVENTS];
+        (void)Ephemeris_Day(blob, 0U, firstYear, day, decoded);
+        printf("%-5u", (unsigned)day);
+        for(uint32_t event = 0; event < EPHEMERIS_NUM_OF_EVENTS; event++)
+        {
+            if(decoded[event] == EPHEMERIS_NONE) printf("       -");
+            else printf("   %02d:%02d", (int)(decoded[event] / 60), (int)(decoded[event] % 60));
+        }
+        printf("\n");
+    }
+
+    if(outPath != NULL)
+    {
+        FILE *file = fopen(outPath, "wb");
+        bool written = (file != NULL) && (fwrite(blob, 1, size, file) == size);
+        if(file != NULL) written = (fclose(file) == 0) && written;
+        if(written) printf("written to %s\n", outPath);
+        else
+        {
+            perror(outPath);
+            failures++;
+        }
+    }
+    free(blob);
+
+    printf("\n%s\n", (failures == 0U) ? "ok" : "FAILED");
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,525 @@
+/* FirmwareUpdate.c - firmware update scenarios over the USB link: delta/full transfer, swap by the boot stub, confirmation,
+   roll-back of an image that keeps crashing and power cuts in the middle of the swap.
+
+   The images are synthetic but built like firmware: functions with relative calls (Thumb BL) between them, literal pools
+   with the absolute addresses of functions and data, linked to slot A. A change is made in the program and the image is
+   linked again - an inserted function body moves everything behind it, which changes the calls across the insertion and
+   the addresses in all the literal pools. The old image is in slot A of the flash model, the tool talks to the firmware as
+   the USB host (UpdateProtocol.c, same as UpdateSender) and every chip reset boots a fresh process from the same flash,
+   running the boot stub part (BootControl_Service) first.
+
+   Reported per scenario: the payload, the frames, the transfer time (UPDATE_BEGIN until #DONE), the time the firmware spent
+   in flash operations, the sectors changed, the swap time of the boot stub, the total time until the new image runs, and
+   what was in slot A and the boot state at the end (the new image confirms itself after UPDATE_CONFIRM_DELAY_IN_MS).
+
+   Usage: FirmwareUpdate
+   Exits with 1 if a scenario did not end with the expected image and boot state. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "hardware/watchdog.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "BootControl.h"
+#include "Update.h"
+#include "UsbLink.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_BOOTS               (8U)
+#define NUM_FUNCTIONS           (600U)
+#define MAX_CODE                (512U)
+#define MAX_CALLS               (12U)
+#define MAX_LITERALS            (8U)
+#define INSERT_SIZE             (96U)       /* bytes of code added to one function */
+#define DATA_SIZE               (16U * 1024U)
+#define VECTORS                 (48U)
+#define DATA_REF                (0x8000U)   /* literal target: data offset / 4 instead of a function */
+#define MAX_IMAGE               (256U * 1024U)
+#define SESSION_START_US        (5000000ULL)    /* after the start-up delay of the firmware */
+#define BOOT_RUN_US             (40000000ULL)   /* past UPDATE_CONFIRM_DELAY_IN_MS */
+#define HANG_AFTER_BOOT_US      (6000000ULL)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    CHANGE_NONE,
+    CHANGE_CONSTANT,                /* one literal of one function */
+    CHANGE_INSERT,                  /* code inserted into a function at a third of the image */
+    CHANGE_NEW                      /* a different program */
+}Change_t;
+
+typedef enum
+{
+    IMAGE_OLD,
+    IMAGE_NEW,
+    IMAGE_OTHER
+}SlotImage_t;
+
+typedef struct
+{
+    uint32_t size;
+    uint32_t numCalls;
+    uint16_t callAt[MAX_CALLS];
+    uint16_t callTarget[MAX_CALLS];
+    uint32_t numLiterals;
+    uint16_t literalTarget[MAX_LITERALS];
+    uint8_t code[MAX_CODE + INSERT_SIZE];
+}SynthFunction_t;
+
+typedef struct
+{
+    const char *name;
+    Change_t change;
+    bool full;
+    uint32_t corruptEvery;          /* every n-th UPDATE_DATA frame damaged on the way */
+    bool hangNewImage;              /* the new image hangs in every boot - never confirms */
+    uint32_t powerFailBoot;         /* boot with a power cut (0 - none) */
+    uint32_t powerFailOps;          /* flash operations before the cut */
+    SlotImage_t expectedImage;
+    BootState_t expectedState;
+}Scenario_t;
+
+typedef struct
+{
+    bool reset;
+    HostSim_PersistentState_t state;
+    uint64_t bootStart_us;
+    uint64_t stubEnd_us;
+    bool stubDone;                  /* false - the reset came in the boot stub */
+    SlotImage_t slotImage;
+    BootState_t stubState;          /* after the boot stub */
+    uint32_t attempts;
+    BootState_t endState;
+    bool sessionRun;
+    bool sessionOk;
+    UpdateSessionStats_t session;
+    uint32_t payloadSize;
+    uint64_t sessionStart_us;
+    uint64_t sessionDone_us;
+    HostSim_FlashStats_t flash;
+}BootResult_t;
+
+/* What the process of a boot gets */
+typedef struct
+{
+    const Scenario_t *scenario;
+    uint32_t boot;
+    const HostSim_PersistentState_t *state;     /* of the boot before, unused by the first */
+}BootRun_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    { "constant_delta",   CHANGE_CONSTANT, false, 0, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "insert_delta",     CHANGE_INSERT,   false, 0, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "insert_full",      CHANGE_INSERT,   true,  0, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "new_program",      CHANGE_NEW,      false, 0, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "identical",        CHANGE_NONE,     false, 0, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "noisy_link",       CHANGE_INSERT,   false, 4, false, 0, 0,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "rollback",         CHANGE_INSERT,   false, 0, true,  0, 0,    IMAGE_OLD, BOOT_STATE_REVERTED },
+    { "power_download",   CHANGE_INSERT,   false, 0, false, 0, 12,   IMAGE_OLD, BOOT_STATE_NONE },
+    { "power_swap_1",     CHANGE_INSERT,   false, 0, false, 1, 1,    IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "power_swap_150",   CHANGE_INSERT,   false, 0, false, 1, 150,  IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "power_swap_777",   CHANGE_INSERT,   false, 0, false, 1, 777,  IMAGE_NEW, BOOT_STATE_CONFIRMED },
+    { "power_revert_100", CHANGE_INSERT,   false, 0, true,  4, 100,  IMAGE_OLD, BOOT_STATE_REVERTED },
+};
+
+static const char *const StateNames[] = { "none", "swapping", "testing", "confirmed", "reverting", "reverted" };
+static const char *const ImageNames[] = { "old", "new", "OTHER" };
+
+static SynthFunction_t Functions[NUM_FUNCTIONS];
+static uint8_t Data[DATA_SIZE];
+static uint8_t OldImage[MAX_IMAGE], NewImage[MAX_IMAGE];
+static uint32_t OldSize, NewSize;
+
+static BootResult_t Result;
+static uint32_t FramesWritten, CorruptEvery;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- Synthetic firmware ---- */
+
+static uint32_t Random(uint32_t *state)
+{
+    /* xorshift32 */
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void Generate(uint32_t seed)
+{
+    uint32_t rng = seed;
+
+    for(uint32_t f = 0; f < NUM_FUNCTIONS; f++)
+    {
+        SynthFunction_t *function = &Functions[f];
+        function->size = 32U + ((Random(&rng) % ((MAX_CODE - 32U) / 4U)) * 2U);
+        for(uint32_t i = 0; i < function->size; i += 2U)
+        {
+            /* Halfwords of a small instruction set */
+            uint16_t instruction = (uint16_t)(0x2000U + ((Random(&rng) % 24U) << 8) + (Random(&rng) & 0xFFU));
+            function->code[i] = (uint8_t)instruction;
+            function->code[i + 1U] = (uint8_t)(instruction >> 8);
+        }
+        function->numCalls = 0;
+        for(uint32_t at = 8U + ((Random(&rng) % 8U) * 2U); ((at + 4U) <= function->size) && (function->numCalls < MAX_CALLS); at += 24U + ((Random(&rng) % 16U) * 2U))
+        {
+            function->callAt[function->numCalls] = (uint16_t)at;
+            function->callTarget[function->numCalls] = (uint16_t)(Random(&rng) % NUM_FUNCTIONS);
+            function->numCalls++;
+        }
+        function->numLiterals = 1U + (Random(&rng) % MAX_LITERALS);
+        for(uint32_t l = 0; l < function->numLiterals; l++)
+        {
+            function->literalTarget[l] = (Random(&rng) & 1U) ? (uint16_t)(Random(&rng) % NUM_FUNCTIONS)
+                                                             : (uint16_t)(DATA_REF + (Random(&rng) % (DATA_SIZE / 4U)));
+        }
+    }
+    for(uint32_t i = 0; i < DATA_SIZE; i++) Data[i] = (uint8_t)Random(&rng);
+}
+
+static void Put32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+/* Thumb-2 BL - the offset from pc + 4 in halfwords, split over the two halfwords of the instruction */
+static void PutBl(uint8_t *bytes, uint32_t pc, uint32_t target)
+{
+    int32_t offset = ((int32_t)target - (int32_t)(pc + 4U)) >> 1;
+    uint32_t s = ((uint32_t)offset >> 23) & 1U;
+    uint32_t i1 = ((uint32_t)offset >> 22) & 1U, i2 = ((uint32_t)offset >> 21) & 1U;
+    uint32_t j1 = (i1 ^ 1U) ^ s, j2 = (i2 ^ 1U) ^ s;
+    uint16_t first = (uint16_t)(0xF000U | (s << 10) | (((uint32_t)offset >> 11) & 0x3FFU));
+    uint16_t second = (uint16_t)(0xD000U | (j1 << 13) | (j2 << 11) | ((uint32_t)offset & 0x7FFU));
+    bytes[0] = (uint8_t)first;
+    bytes[1] = (uint8_t)(first >> 8);
+    bytes[2] = (uint8_t)second;
+    bytes[3] = (uint8_t)(second >> 8);
+}
+
+static uint32_t Link(uint8_t *image)
+{
+    static uint32_t address[NUM_FUNCTIONS];
+    const uint32_t base = 0x10000000U + BOOT_SLOT_A_OFFSET;
+    uint32_t offset = BOOT_APP_VECTOR_OFFSET + (VECTORS * 4U);
+
+    for(uint32_t f = 0; f < NUM_FUNCTIONS; f++)
+    {
+        address[f] = base + offset;
+        offset += ((Functions[f].size + 3U) & ~3U) + (Functions[f].numLiterals * 4U);
+    }
+    uint32_t dataAddress = base + offset;
+
+    /* boot2 copy, vector table */
+    for(uint32_t i = 0; i < BOOT_APP_VECTOR_OFFSET; i++) image[i] = (uint8_t)(i * 37U);
+    Put32(&image[BOOT_APP_VECTOR_OFFSET], 0x20042000U);
+    for(uint32_t v = 1; v < VECTORS; v++) Put32(&image[BOOT_APP_VECTOR_OFFSET + (v * 4U)], address[(v * 7U) % NUM_FUNCTIONS] | 1U);
+
+    offset = BOOT_APP_VECTOR_OFFSET + (VECTORS * 4U);
+    for(uint32_t f = 0; f < NUM_FUNCTIONS; f++)
+    {
+        const SynthFunction_t *function = &Functions[f];
+        uint32_t size = (function->size + 3U) & ~3U;
+        memset(&image[offset], 0, size);
+        memcpy(&image[offset], function->code, function->size);
+        for(uint32_t c = 0; c < function->numCalls; c++)
+        {
+            PutBl(&image[offset + function->callAt[c]], address[f] + function->callAt[c], address[function->callTarget[c]]);
+        }
+        for(uint32_t l = 0; l < function->numLiterals; l++)
+        {
+            uint16_t target = function->literalTarget[l];
+            uint32_t value = (target >= DATA_REF) ? (dataAddress + ((uint32_t)(target - DATA_REF) * 4U)) : (address[target] | 1U);
+            Put32(&image[offset + size + (l * 4U)], value);
+        }
+        offset += size + (function->numLiterals * 4U);
+    }
+    memcpy(&image[offset], Data, DATA_SIZE);
+    return offset + DATA_SIZE;
+}
+
+static void BuildImages(Change_t change)
+{
+    Generate(0x1234567U);
+    OldSize = Link(OldImage);
+
+    SynthFunction_t *function = &Functions[NUM_FUNCTIONS / 3U];
+    switch(change)
+    {
+        case CHANGE_CONSTANT:
+            function->literalTarget[0] = (uint16_t)(DATA_REF + 17U);
+            break;
+        case CHANGE_INSERT:
+        {
+            uint32_t at = (function->size / 2U) & ~1U;
+            memmove(&function->code[at + INSERT_SIZE], &function->code[at], function->size - at);
+            for(uint32_t i = 0; i < INSERT_SIZE; i++) function->code[at + i] = (uint8_t)(0x40U + i);
+            function->size += INSERT_SIZE;
+            for(uint32_t c = 0; c < function->numCalls; c++)
+            {
+                if(function->callAt[c] >= at) function->callAt[c] += INSERT_SIZE;
+            }
+            break;
+        }
+        case CHANGE_NEW:
+            Generate(0x7654321U);
+            break;
+        default:
+            break;
+    }
+    NewSize = Link(NewImage);
+}
+
+static SlotImage_t IdentifySlotA(void)
+{
+    const uint8_t *slot = &HostSim_Flash()[BOOT_SLOT_A_OFFSET];
+    if(memcmp(slot, NewImage, NewSize) == 0) return IMAGE_NEW;
+    if(memcmp(slot, OldImage, OldSize) == 0) return IMAGE_OLD;
+    return IMAGE_OTHER;
+}
+
+/* ---- USB host side ---- */
+
+static void SimWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    static uint8_t frame[USB_LINK_MAX_FRAME];
+    (void)context;
+
+    memcpy(frame, data, length);
+    if((frame[2] == USB_LINK_CMD_UPDATE_DATA) && (CorruptEvery != 0U) && ((++FramesWritten % CorruptEvery) == 0U))
+    {
+        /* Damaged on the way - the board drops it (CRC) */
+        frame[USB_LINK_HEADER_SIZE + 8U] ^= 0x10U;
+    }
+    HostSim_UsbWrite(frame, length);
+}
+
+static bool SimReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    (void)context;
+    return HostSim_UsbReadLine(line, size, timeout_ms * 1000ULL);
+}
+
+static void SimSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    HostSim_RunForUs(ms * 1000ULL);
+}
+
+/* ---- Boots ---- */
+
+static void SendResult(void)
+{
+    Result.flash = *HostSim_GetFlashStats();
+    HostSim_IsolatedResult(&Result);
+}
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    Result.reset = true;
+    Result.state = *state;
+    Result.endState = BootControl_GetState();
+    SendResult();
+}
+
+static void RunSession(const Scenario_t *scenario)
+{
+    static uint8_t payload[2U * MAX_IMAGE];
+    uint8_t baseHash[HASH_SHA256_SIZE];
+    UpdateTransport_t transport = { NULL, SimWrite, SimReadLine, SimSleep };
+    char state[32];
+    uint32_t attempts, runningSize;
+
+    CorruptEvery = scenario->corruptEvery;
+    HostSim_RunUntilUs(SESSION_START_US);
+    Result.sessionRun = true;
+    Result.sessionStart_us = HostSim_NowUs();
+
+    /* Same as UpdateSender: a delta against the image the board reports, unless the full image is smaller */
+    if(!UpdateProtocol_Info(&transport, state, sizeof(state), &attempts, &runningSize, baseHash))
+    {
+        snprintf(Result.session.failure, sizeof(Result.session.failure), "no #INFO");
+        return;
+    }
+    bool delta = !scenario->full;
+    uint32_t payloadSize = delta ? UpdateProtocol_EncodeDelta(OldImage, OldSize, NewImage, NewSize, payload, sizeof(payload)) : 0U;
+    if(!delta || (payloadSize >= NewSize))
+    {
+        delta = false;
+        payloadSize = UpdateProtocol_EncodeFull(NewImage, NewSize, payload, sizeof(payload));
+    }
+    Result.payloadSize = payloadSize;
+    Result.sessionOk = UpdateProtocol_Send(&transport, NewImage, NewSize, payload, payloadSize, delta ? baseHash : NULL, &Result.session);
+    Result.sessionDone_us = HostSim_NowUs();
+}
+
+/* One boot in its own process, the flash is shared - the result in Result, sent at the end or by the reboot hook */
+static void RunBoot(const void *context, void *output)
+{
+    const BootRun_t *run = context;
+    const Scenario_t *scenario = run->scenario;
+    uint32_t boot = run->boot;
+
+    (void)output;
+    memset(&Result, 0, sizeof(Result));
+    if(boot == 0U)
+    {
+        HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+        HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    }
+    else
+    {
+        HostSim_RestoreState(run->state);
+    }
+    HostSim_SetRebootHook(RebootHook);
+    if((scenario->powerFailOps != 0U) && (boot == scenario->powerFailBoot))
+    {
+        HostSim_FlashPowerFailAfter(scenario->powerFailOps);
+    }
+    Result.bootStart_us = HostSim_NowUs();
+
+    /* Boot stub (BootStub.c) */
+    BootControl_Service();
+    Result.stubEnd_us = HostSim_NowUs();
+    Result.stubDone = true;
+    Result.stubState = BootControl_GetState();
+    Result.attempts = BootControl_Attempts();
+    if(Result.stubState == BOOT_STATE_TESTING)
+    {
+        watchdog_enable(BOOT_TEST_WATCHDOG_IN_MS, true);
+    }
+
+    Result.slotImage = IdentifySlotA();
+    HostSim_SetFlashBinaryEnd(BOOT_SLOT_A_OFFSET + ((Result.slotImage == IMAGE_NEW) ? NewSize : OldSize));
+    if(scenario->hangNewImage && (Result.slotImage == IMAGE_NEW))
+    {
+        HostSim_HangTask("ButtonTask", Result.bootStart_us + HANG_AFTER_BOOT_US);
+    }
+    HostSim_Boot();
+
+    if(boot == 0U)
+    {
+        RunSession(scenario);
+        if(Result.sessionOk)
+        {
+            /* The firmware reboots right after #DONE */
+            HostSim_RunForUs(1000000ULL);
+        }
+    }
+    else
+    {
+        HostSim_RunUntilUs(Result.bootStart_us + BOOT_RUN_US);
+    }
+
+    Result.reset = false;
+    Result.endState = BootControl_GetState();
+    SendResult();
+}
+
+static bool RunBootProcess(const Scenario_t *scenario, uint32_t boot, const HostSim_PersistentState_t *state, BootResult_t *result)
+{
+    BootRun_t run = { scenario, boot, state };
+    return HostSim_RunIsolated(RunBoot, &run, result, sizeof(*result));
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-17s %8s %8s %7s %9s %8s %8s %9s %9s %5s  %-16s\n", "scenario", "image", "payload", "frames", "transfer", "flash",
+           "sectors", "stub swap", "total", "boots", "end");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+        HostSim_PersistentState_t state;
+        BootResult_t result, session;
+        char trail[256] = "";
+        uint64_t stubSwap_us = 0, newImageStart_us = 0;
+        uint32_t boots = 0;
+        bool ok = true;
+
+        /* Fresh flash with the old image in slot A, as flashed with the debug probe */
+        BuildImages(scenario->change);
+        memset(HostSim_Flash(), 0xFF, HOSTSIM_FLASH_SIZE);
+        HostSim_FlashLoad(BOOT_SLOT_A_OFFSET, OldImage, OldSize);
+        memset(&session, 0, sizeof(session));
+
+        for(uint32_t boot = 0; boot < MAX_BOOTS; boot++)
+        {
+            if(!RunBootProcess(scenario, boot, &state, &result))
+            {
+                snprintf(&trail[strlen(trail)], sizeof(trail) - strlen(trail), " CRASH");
+                ok = false;
+                break;
+            }
+            boots++;
+            if(boot == 0U) session = result;
+            stubSwap_us += (result.stubDone ? result.stubEnd_us : result.state.time_us) - result.bootStart_us;
+            if(result.stubDone && (result.slotImage == IMAGE_NEW) && (newImageStart_us == 0U)) newImageStart_us = result.stubEnd_us;
+
+            /* Boot state after the stub/image in slot A#attempts, how the boot ended */
+            if(result.stubDone)
+            {
+                snprintf(&trail[strlen(trail)], sizeof(trail) - strlen(trail), "%s%s/%s#%u%s", (boot == 0U) ? "" : " > ",
+                         StateNames[result.stubState], ImageNames[result.slotImage], (unsigned)result.attempts,
+                         !result.reset ? "" : (result.state.watchdogReset ? " rst" : " POWER"));
+            }
+            else
+            {
+                snprintf(&trail[strlen(trail)], sizeof(trail) - strlen(trail), "%sstub %s", (boot == 0U) ? "" : " > ",
+                         result.state.watchdogReset ? "rst" : "POWER");
+            }
+            if(!result.reset) break;
+            state = result.state;
+        }
+
+        bool sent = session.sessionRun && session.sessionOk;
+        ok = ok && (result.slotImage == scenario->expectedImage) && (result.endState == scenario->expectedState) && !result.reset &&
+             (sent || (scenario->powerFailBoot == 0U && scenario->powerFailOps != 0U));
+        if((scenario->expectedImage == IMAGE_NEW) && (memcmp(&HostSim_Flash()[BOOT_SLOT_A_OFFSET], NewImage, NewSize) != 0)) ok = false;
+
+        printf("%-17s %8u %8u %3u/%-3u", scenario->name, (unsigned)NewSize, (unsigned)session.payloadSize, (unsigned)session.session.frames,
+               (unsigned)session.session.repeatedFrames);
+        if(sent)
+        {
+            printf(" %8.2fs %7.2fs %3u/%-4u", (session.sessionDone_us - session.sessionStart_us) / 1e6, session.flash.busy_us / 1e6,
+                   (unsigned)session.session.changedSectors, (unsigned)session.session.sectors);
+        }
+        else
+        {
+            printf(" %9s %8s %8s", "-", "-", "-");
+        }
+        printf(" %8.2fs", stubSwap_us / 1e6);
+        if(sent && (newImageStart_us != 0U)) printf(" %8.2fs", (newImageStart_us - session.sessionStart_us) / 1e6);
+        else printf(" %9s", "-");
+        printf(" %5u  %s/%s %s\n", (unsigned)boots, ImageNames[result.slotImage], StateNames[result.endState], ok ? "ok" : "UNEXPECTED");
+        printf("    boots: %s\n", trail);
+        if(!sent && (session.session.failure[0] != '\0')) printf("    session: %s\n", session.session.failure);
+        if(!ok) failures++;
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
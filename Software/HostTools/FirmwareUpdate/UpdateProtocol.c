@@ -0,0 +1,893 @@
+/* UpdateProtocol.c - delta encoder, frames and sender session of the firmware update over the USB link */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Firmware includes (protocol definitions) */
+#include "UsbLink.h"
+#include "Update.h"
+#include "TimeSync.h"
+#include "Trace.h"
+#include "SiteConfig.h"
+#include "Profiler.h"
+#include "Hash.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define HASH_WINDOW         (16U)       /* bytes hashed per position of the base image */
+#define HASH_BITS           (20U)
+#define MAX_CANDIDATES      (16U)       /* positions of the hash chain tried per position of the new image */
+#define EXTEND_GIVE_UP      (512U)      /* approximate extension ends that far behind the best score */
+#define NO_POSITION         (UINT32_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    uint8_t *data;
+    uint32_t length;
+    uint32_t maxLength;
+    bool overflow;
+}Output_t;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void PutByte(Output_t *out, uint8_t byte)
+{
+    if(out->length >= out->maxLength)
+    {
+        out->overflow = true;
+        return;
+    }
+    out->data[out->length++] = byte;
+}
+
+static void PutVarint(Output_t *out, uint32_t value)
+{
+    while(value >= 0x80U)
+    {
+        PutByte(out, (uint8_t)(value | 0x80U));
+        value >>= 7;
+    }
+    PutByte(out, (uint8_t)value);
+}
+
+static void PutData(Output_t *out, const uint8_t *bytes, uint32_t length)
+{
+    if(length == 0U) return;
+    PutByte(out, UPDATE_OP_DATA);
+    PutVarint(out, length);
+    for(uint32_t i = 0; i < length; i++) PutByte(out, bytes[i]);
+}
+
+/* Equal bytes as counts, the differing ones as differences - a differing run ends at two equal bytes in a row */
+static void PutAdd(Output_t *out, const uint8_t *base, uint32_t baseOffset, const uint8_t *image, uint32_t length)
+{
+    uint32_t i = 0;
+
+    PutByte(out, UPDATE_OP_ADD);
+    PutVarint(out, baseOffset);
+    PutVarint(out, length);
+    while(i < length)
+    {
+        uint32_t same = 0;
+        while(((i + same) < length) && (image[i + same] == base[baseOffset + i + same])) same++;
+        PutVarint(out, same);
+        i += same;
+        if(i >= length) break;
+
+        uint32_t diff = 0;
+        while((i + diff) < length)
+        {
+            if(((i + diff + 1U) < length) && (image[i + diff] == base[baseOffset + i + diff]) &&
+               (image[i + diff + 1U] == base[baseOffset + i + diff + 1U])) break;
+            diff++;
+        }
+        PutVarint(out, diff);
+        for(uint32_t k = 0; k < diff; k++) PutByte(out, (uint8_t)(image[i + k] - base[baseOffset + i + k]));
+        i += diff;
+    }
+}
+
+static uint32_t WindowHash(const uint8_t *bytes)
+{
+    uint32_t hash = 2166136261U;
+    for(uint32_t i = 0; i < HASH_WINDOW; i++) hash = (hash ^ bytes[i]) * 16777619U;
+    return hash >> (32U - HASH_BITS);
+}
+
+static uint32_t ExactMatch(const uint8_t *base, uint32_t baseSize, uint32_t baseOffset, const uint8_t *image, uint32_t imageSize, uint32_t offset)
+{
+    uint32_t length = 0;
+    while(((baseOffset + length) < baseSize) && ((offset + length) < imageSize) && (base[baseOffset + length] == image[offset + length])) length++;
+    return length;
+}
+
+/* Like bsdiff - the match goes on as long as more than half of the bytes are equal (code that moved: only the addresses differ) */
+static uint32_t ExtendMatch(const uint8_t *base, uint32_t baseSize, uint32_t baseOffset, const uint8_t *image, uint32_t imageSize, uint32_t offset)
+{
+    int64_t score = 0, bestScore = 0;
+    uint32_t bestLength = 0;
+
+    for(uint32_t k = 0; ((baseOffset + k) < baseSize) && ((offset + k) < imageSize); k++)
+    {
+        score += (base[baseOffset + k] == image[offset + k]) ? 1 : -1;
+        if(score > bestScore)
+        {
+            bestScore = score;
+            bestLength = k + 1U;
+        }
+        else if((bestScore - score) > (int64_t)EXTEND_GIVE_UP)
+        {
+            break;
+        }
+    }
+    return bestLength;
+}
+
+static bool ParseResponse(const char *line, const char *word, char *reason, uint32_t reasonSize, uint32_t *value)
+{
+    char first[16], second[32];
+    unsigned long number = 0;
+
+    if(line[0] != USB_LINK_RESPONSE_MARK) return false;
+    int fields = sscanf(&line[1], "%15s %31s %lu", first, second, &number);
+    if((fields < 2) || (strcmp(first, word) != 0)) return false;
+    if(fields == 2)
+    {
+        /* #ACK <n>, #DONE <c> <s> */
+        if(reason != NULL) reason[0] = '\0';
+        if(value != NULL) *value = (uint32_t)strtoul(second, NULL, 10);
+        return true;
+    }
+    if(reason != NULL) snprintf(reason, reasonSize, "%s", second);
+    if(value != NULL) *value = (uint32_t)number;
+    return true;
+}
+
+static void SendFrame(const UpdateTransport_t *transport, uint8_t command, const uint8_t *payload, uint32_t length, UpdateSessionStats_t *stats)
+{
+    static uint8_t frame[USB_LINK_MAX_FRAME];
+    uint32_t size = UpdateProtocol_Frame(command, payload, length, frame);
+    transport->write(transport->context, frame, size);
+    stats->wireBytes += size;
+}
+
+static void Put32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+uint32_t UpdateProtocol_EncodeFull(const uint8_t *image, uint32_t imageSize, uint8_t *payload, uint32_t maxLength)
+{
+    Output_t out = { payload, 0U, maxLength, false };
+    PutData(&out, image, imageSize);
+    return out.overflow ? 0U : out.length;
+}
+
+uint32_t UpdateProtocol_EncodeDelta(const uint8_t *base, uint32_t baseSize, const uint8_t *image, uint32_t imageSize,
+                                    uint8_t *payload, uint32_t maxLength)
+{
+    Output_t out = { payload, 0U, maxLength, false };
+    uint32_t *head = malloc(sizeof(uint32_t) << HASH_BITS);
+    uint32_t *chain = malloc(sizeof(uint32_t) * ((baseSize > 0U) ? baseSize : 1U));
+
+    /* Hash chains of all the positions of the base image, the latest position first */
+    memset(head, 0xFF, sizeof(uint32_t) << HASH_BITS);
+    for(uint32_t i = 0; (i + HASH_WINDOW) <= baseSize; i++)
+    {
+        uint32_t hash = WindowHash(&base[i]);
+        chain[i] = head[hash];
+        head[hash] = i;
+    }
+
+    uint32_t literalStart = 0, offset = 0;
+    uint32_t expectedBase = NO_POSITION;    /* where the previous match would go on - an insertion does not move the rest */
+    while(offset < imageSize)
+    {
+        uint32_t bestBase = NO_POSITION, bestLength = 0;
+
+        if((offset + HASH_WINDOW) <= imageSize)
+        {
+            uint32_t candidates = 0;
+            if((expectedBase != NO_POSITION) && (expectedBase < baseSize))
+            {
+                bestLength = ExactMatch(base, baseSize, expectedBase, image, imageSize, offset);
+                bestBase = expectedBase;
+            }
+            for(uint32_t position = head[WindowHash(&image[offset])]; (position != NO_POSITION) && (candidates < MAX_CANDIDATES);
+                position = chain[position], candidates++)
+            {
+                uint32_t length = ExactMatch(base, baseSize, position, image, imageSize, offset);
+                if(length > bestLength)
+                {
+                    bestLength = length;
+                    bestBase = position;
+                }
+            }
+        }
+
+        if(bestLength < UPDATE_PROTOCOL_MIN_MATCH)
+        {
+            offset++;
+            if(expectedBase != NO_POSITION) expectedBase++;
+            continue;
+        }
+
+        uint32_t length = ExtendMatch(base, baseSize, bestBase, image, imageSize, offset);
+        PutData(&out, &image[literalStart], offset - literalStart);
+        PutAdd(&out, base, bestBase, &image[offset], length);
+        offset += length;
+        literalStart = offset;
+        expectedBase = bestBase + length;
+    }
+    PutData(&out, &image[literalStart], imageSize - literalStart);
+
+    free(head);
+    free(chain);
+    return out.overflow ? 0U : out.length;
+}
+
+bool UpdateProtocol_Decode(const uint8_t *base, uint32_t baseSize, const uint8_t *payload, uint32_t payloadSize,
+                           uint8_t *image, uint32_t imageSize)
+{
+    uint32_t in = 0, out = 0;
+
+#define GET_VARINT(value) do { uint32_t shift_ = 0; (value) = 0; for(;;) { if((in >= payloadSize) || (shift_ > UPDATE_VARINT_MAX_SHIFT)) return false; \
+                               uint8_t b_ = payload[in++]; (value) |= (uint32_t)(b_ & 0x7FU) << shift_; shift_ += 7U; if(!(b_ & 0x80U)) break; } } while(0)
+
+    while(in < payloadSize)
+    {
+        uint8_t op = payload[in++];
+        uint32_t length, baseOffset;
+        if(op == UPDATE_OP_DATA)
+        {
+            GET_VARINT(length);
+            if((length == 0U) || (length > (imageSize - out)) || (length > (payloadSize - in))) return false;
+            memcpy(&image[out], &payload[in], length);
+            in += length;
+            out += length;
+        }
+        else if(op == UPDATE_OP_ADD)
+        {
+            GET_VARINT(baseOffset);
+            GET_VARINT(length);
+            if((length == 0U) || (length > (imageSize - out)) || (baseOffset > baseSize) || (length > (baseSize - baseOffset))) return false;
+            while(length > 0U)
+            {
+                uint32_t same, diff;
+                GET_VARINT(same);
+                if(same > length) return false;
+                memcpy(&image[out], &base[baseOffset], same);
+                out += same;
+                baseOffset += same;
+                length -= same;
+                if(length == 0U) break;
+                GET_VARINT(diff);
+                if((diff == 0U) || (diff > length) || (diff > (payloadSize - in))) return false;
+                for(uint32_t k = 0; k < diff; k++) image[out++] = (uint8_t)(base[baseOffset++] + payload[in++]);
+                length -= diff;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+#undef GET_VARINT
+    return out == imageSize;
+}
+
+uint32_t UpdateProtocol_Frame(uint8_t command, const uint8_t *payload, uint32_t length, uint8_t *frame)
+{
+    frame[0] = USB_LINK_SYNC_1;
+    frame[1] = USB_LINK_SYNC_2;
+    frame[2] = command;
+    frame[3] = (uint8_t)length;
+    frame[4] = (uint8_t)(length >> 8);
+    if(length > 0U) memcpy(&frame[USB_LINK_HEADER_SIZE], payload, length);
+    Put32(&frame[USB_LINK_HEADER_SIZE + length], Hash_Crc32(&frame[2], (USB_LINK_HEADER_SIZE - 2U) + length));
+    return USB_LINK_HEADER_SIZE + length + USB_LINK_CRC_SIZE;
+}
+
+bool UpdateProtocol_Info(const UpdateTransport_t *transport, char *state, uint32_t stateSize, uint32_t *attempts,
+                         uint32_t *imageSize, uint8_t imageHash[HASH_SHA256_SIZE])
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    char stateName[32], hex[(2U * HASH_SHA256_SIZE) + 1U];
+    unsigned long count, size;
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_INFO, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_DONE_TIMEOUT_MS))
+    {
+        if((line[0] != USB_LINK_RESPONSE_MARK) ||
+           (sscanf(&line[1], "INFO %31s %lu %lu %64s", stateName, &count, &size, hex) != 4) || (strlen(hex) != (2U * HASH_SHA256_SIZE)))
+        {
+            continue;
+        }
+        snprintf(state, stateSize, "%s", stateName);
+        *attempts = (uint32_t)count;
+        *imageSize = (uint32_t)size;
+        for(uint32_t i = 0; i < HASH_SHA256_SIZE; i++)
+        {
+            unsigned int byte;
+            sscanf(&hex[2U * i], "%2x", &byte);
+            imageHash[i] = (uint8_t)byte;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool UpdateProtocol_Send(const UpdateTransport_t *transport, const uint8_t *image, uint32_t imageSize,
+                         const uint8_t *payload, uint32_t payloadSize, const uint8_t *baseHash, UpdateSessionStats_t *stats)
+{
+    uint8_t begin[UPDATE_BEGIN_SIZE];
+    uint8_t data[4U + UPDATE_PROTOCOL_CHUNK];
+    char line[UPDATE_PROTOCOL_MAX_LINE], reason[32];
+    HashSha256_t context;
+    uint32_t value, retries = 0;
+
+    memset(stats, 0, sizeof(*stats));
+
+    /* UPDATE_BEGIN */
+    memset(begin, 0, sizeof(begin));
+    Put32(&begin[UPDATE_BEGIN_IMAGE_SIZE], imageSize);
+    Put32(&begin[UPDATE_BEGIN_PAYLOAD_SIZE], payloadSize);
+    begin[UPDATE_BEGIN_FLAGS] = (baseHash != NULL) ? UPDATE_FLAG_DELTA : 0U;
+    Hash_Sha256Init(&context);
+    Hash_Sha256Update(&context, image, imageSize);
+    Hash_Sha256Final(&context, &begin[UPDATE_BEGIN_IMAGE_HASH]);
+    if(baseHash != NULL) memcpy(&begin[UPDATE_BEGIN_BASE_HASH], baseHash, HASH_SHA256_SIZE);
+    for(;;)
+    {
+        SendFrame(transport, USB_LINK_CMD_UPDATE_BEGIN, begin, sizeof(begin), stats);
+        bool answered = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            if(ParseResponse(line, "ACK", NULL, 0U, &value)) answered = true;
+            else if(ParseResponse(line, "ERR", reason, sizeof(reason), &value))
+            {
+                if((strcmp(reason, "busy") != 0) || (++retries > UPDATE_PROTOCOL_MAX_RETRIES))
+                {
+                    snprintf(stats->failure, sizeof(stats->failure), "UPDATE_BEGIN refused: %s", reason);
+                    return false;
+                }
+                stats->errors++;
+                transport->sleep(transport->context, UPDATE_PROTOCOL_BUSY_WAIT_MS);
+                break;
+            }
+        }
+        if(answered) break;
+        if(++retries > UPDATE_PROTOCOL_MAX_RETRIES)
+        {
+            snprintf(stats->failure, sizeof(stats->failure), "no answer to UPDATE_BEGIN");
+            return false;
+        }
+    }
+
+    /* UPDATE_DATA - a window of frames ahead of the last ACK */
+    uint32_t sent = 0, acked = 0;
+    retries = 0;
+    while(acked < payloadSize)
+    {
+        while((sent < payloadSize) && ((sent - acked) < UPDATE_PROTOCOL_WINDOW))
+        {
+            uint32_t chunk = ((payloadSize - sent) < UPDATE_PROTOCOL_CHUNK) ? (payloadSize - sent) : UPDATE_PROTOCOL_CHUNK;
+            Put32(data, sent);
+            memcpy(&data[4], &payload[sent], chunk);
+            SendFrame(transport, USB_LINK_CMD_UPDATE_DATA, data, 4U + chunk, stats);
+            stats->frames++;
+            sent += chunk;
+        }
+
+        if(!transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            /* Lost frame or lost ACK - everything from the last ACK again */
+            stats->timeouts++;
+            stats->repeatedFrames += (sent - acked + UPDATE_PROTOCOL_CHUNK - 1U) / UPDATE_PROTOCOL_CHUNK;
+            sent = acked;
+            if(++retries > UPDATE_PROTOCOL_MAX_RETRIES)
+            {
+                snprintf(stats->failure, sizeof(stats->failure), "no ACK after %u retries", (unsigned)UPDATE_PROTOCOL_MAX_RETRIES);
+                return false;
+            }
+            continue;
+        }
+        if(ParseResponse(line, "ACK", NULL, 0U, &value))
+        {
+            if(value > acked) acked = value;
+            if(sent < acked) sent = acked;
+            retries = 0;
+        }
+        else if(ParseResponse(line, "ERR", reason, sizeof(reason), &value))
+        {
+            if((strcmp(reason, "sequence") != 0) && (strcmp(reason, "busy") != 0))
+            {
+                snprintf(stats->failure, sizeof(stats->failure), "UPDATE_DATA refused: %s", reason);
+                return false;
+            }
+            /* The board drops the frames until the one it expects - from there on again */
+            stats->errors++;
+            if(strcmp(reason, "busy") == 0) transport->sleep(transport->context, UPDATE_PROTOCOL_BUSY_WAIT_MS);
+            stats->repeatedFrames += (sent - value + UPDATE_PROTOCOL_CHUNK - 1U) / UPDATE_PROTOCOL_CHUNK;
+            acked = value;
+            sent = value;
+            if(++retries > UPDATE_PROTOCOL_MAX_RETRIES)
+            {
+                snprintf(stats->failure, sizeof(stats->failure), "UPDATE_DATA refused %u times", (unsigned)retries);
+                return false;
+            }
+        }
+    }
+
+    /* UPDATE_END - the board verifies the staged image and reboots into the boot stub */
+    SendFrame(transport, USB_LINK_CMD_UPDATE_END, NULL, 0U, stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_DONE_TIMEOUT_MS))
+    {
+        unsigned long changed, sectors;
+        if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "DONE %lu %lu", &changed, &sectors) == 2))
+        {
+            stats->changedSectors = (uint32_t)changed;
+            stats->sectors = (uint32_t)sectors;
+            return true;
+        }
+        if(ParseResponse(line, "ERR", reason, sizeof(reason), &value))
+        {
+            snprintf(stats->failure, sizeof(stats->failure), "UPDATE_END refused: %s", reason);
+            return false;
+        }
+    }
+    snprintf(stats->failure, sizeof(stats->failure), "no answer to UPDATE_END");
+    return false;
+}
+
+bool UpdateProtocol_TraceInfo(const UpdateTransport_t *transport, char *state, uint32_t stateSize, uint32_t *size)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], stateName[32];
+    unsigned long bytes;
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_TRACE_INFO, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_DONE_TIMEOUT_MS))
+    {
+        if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "TRACE %31s %lu", stateName, &bytes) == 2))
+        {
+            snprintf(state, stateSize, "%s", stateName);
+            *size = (uint32_t)bytes;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UpdateProtocol_TraceStart(const UpdateTransport_t *transport, char *reason, uint32_t reasonSize)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+
+    memset(&stats, 0, sizeof(stats));
+    snprintf(reason, reasonSize, "timeout");
+    SendFrame(transport, USB_LINK_CMD_TRACE_START, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_DONE_TIMEOUT_MS))
+    {
+        if(ParseResponse(line, "ACK", NULL, 0U, NULL)) return true;
+        if(ParseResponse(line, "ERR", reason, reasonSize, NULL)) return false;
+    }
+    return false;
+}
+
+uint32_t UpdateProtocol_TraceRead(const UpdateTransport_t *transport, uint8_t *trace, uint32_t maxLength)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], hex[(2U * TRACE_DATA_CHUNK) + 1U];
+    uint8_t request[4];
+    uint32_t length = 0, retries = 0;
+    unsigned long offset;
+
+    memset(&stats, 0, sizeof(stats));
+    while((length < maxLength) && (retries < UPDATE_PROTOCOL_MAX_RETRIES))
+    {
+        Put32(request, length);
+        SendFrame(transport, USB_LINK_CMD_TRACE_READ, request, sizeof(request), &stats);
+
+        bool answered = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            hex[0] = '\0';
+            int fields = (line[0] == USB_LINK_RESPONSE_MARK) ? sscanf(&line[1], "TDATA %lu %96s", &offset, hex) : 0;
+            answered = (fields >= 1) && (offset == length);
+        }
+        if(!answered)
+        {
+            retries++;
+            continue;
+        }
+
+        uint32_t count = (uint32_t)strlen(hex) / 2U;
+        if(count == 0U) break;
+        for(uint32_t i = 0; (i < count) && (length < maxLength); i++)
+        {
+            unsigned int byte;
+            sscanf(&hex[2U * i], "%2x", &byte);
+            trace[length++] = (uint8_t)byte;
+        }
+    }
+    return (retries < UPDATE_PROTOCOL_MAX_RETRIES) ? length : 0U;
+}
+
+bool UpdateProtocol_TimeSync(const UpdateTransport_t *transport, int64_t (*utcNow_us)(void *context), UpdateTimeSyncStats_t *stats)
+{
+    UpdateSessionStats_t session;
+    char line[UPDATE_PROTOCOL_MAX_LINE], reason[32], date[16], time[16];
+    uint8_t payload[TIME_SYNC_PAYLOAD_SIZE];
+    unsigned long sequence;
+    long offset, drift;
+    uint32_t retries = 0;
+
+    memset(&session, 0, sizeof(session));
+    memset(stats, 0, sizeof(*stats));
+    stats->bestRoundTrip_us = UINT32_MAX;
+    int64_t start_us = utcNow_us(transport->context);
+
+    /* Round trips - a response to an earlier request (came after its timeout) is not counted */
+    for(uint32_t trip = 0; (trip < UPDATE_PROTOCOL_ROUND_TRIPS) && (retries < UPDATE_PROTOCOL_MAX_RETRIES); trip++)
+    {
+        Put32(payload, trip);
+        int64_t sent_us = utcNow_us(transport->context);
+        SendFrame(transport, USB_LINK_CMD_TIME_INFO, payload, TIME_INFO_PAYLOAD_SIZE, &session);
+        bool answered = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "TIME %lu %15s %15s", &sequence, date, time) == 3) && (sequence == trip))
+            {
+                uint32_t roundTrip_us = (uint32_t)(utcNow_us(transport->context) - sent_us);
+                if(stats->roundTrips == 0U) snprintf(stats->rtcBefore, sizeof(stats->rtcBefore), "%s %s", date, time);
+                stats->roundTrips++;
+                stats->bestRoundTrip_us = (roundTrip_us < stats->bestRoundTrip_us) ? roundTrip_us : stats->bestRoundTrip_us;
+                stats->worstRoundTrip_us = (roundTrip_us > stats->worstRoundTrip_us) ? roundTrip_us : stats->worstRoundTrip_us;
+                answered = true;
+            }
+            else if(ParseResponse(line, "ERR", reason, sizeof(reason), NULL))
+            {
+                /* busy - AutomaticControlTask is stepping the clock */
+                transport->sleep(transport->context, UPDATE_PROTOCOL_BUSY_WAIT_MS);
+                trip--;
+                retries++;
+                answered = true;
+            }
+        }
+        if(!answered) retries++;
+    }
+    if(stats->roundTrips == 0U)
+    {
+        snprintf(stats->failure, sizeof(stats->failure), "no #TIME");
+        return false;
+    }
+
+    while(retries < UPDATE_PROTOCOL_MAX_RETRIES)
+    {
+        int64_t utc_us = utcNow_us(transport->context);
+        for(uint32_t i = 0; i < 8U; i++)
+        {
+            payload[i] = (uint8_t)((uint64_t)utc_us >> (8U * i));
+        }
+        Put32(&payload[8], stats->bestRoundTrip_us / 2U);
+        SendFrame(transport, USB_LINK_CMD_TIME_SYNC, payload, TIME_SYNC_PAYLOAD_SIZE, &session);
+
+        /* The board waits for its clock edge and the next whole second - up to two seconds */
+        while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_DONE_TIMEOUT_MS))
+        {
+            if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "SYNC %ld %ld %lu", &offset, &drift, &sequence) == 3))
+            {
+                stats->offset_ms = (int32_t)offset;
+                stats->drift_ppb = (int32_t)drift;
+                stats->interval_s = (uint32_t)sequence;
+                stats->duration_us = (uint64_t)(utcNow_us(transport->context) - start_us);
+                return true;
+            }
+            if(ParseResponse(line, "ERR", reason, sizeof(reason), NULL))
+            {
+                snprintf(stats->failure, sizeof(stats->failure), "#ERR %s", reason);
+                if(strcmp(reason, "busy") != 0) return false;
+                break;
+            }
+        }
+        transport->sleep(transport->context, UPDATE_PROTOCOL_BUSY_WAIT_MS);
+        retries++;
+    }
+    if(stats->failure[0] == '\0') snprintf(stats->failure, sizeof(stats->failure), "no #SYNC");
+    return false;
+}
+
+uint32_t UpdateProtocol_CycleInfo(const UpdateTransport_t *transport, UpdateCycleStats_t *items, uint32_t maxItems)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint32_t count = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    while(count < maxItems)
+    {
+        uint8_t item = (uint8_t)count;
+        SendFrame(transport, USB_LINK_CMD_CYCLE_INFO, &item, 1U, &stats);
+
+        bool answered = false, end = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            UpdateCycleStats_t *entry = &items[count];
+            unsigned long values[6];
+            if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "CYCLES %31s %lu %lu %lu %lu %lu %lu", entry->name, &values[0], &values[1],
+                                                              &values[2], &values[3], &values[4], &values[5]) == 7))
+            {
+                entry->count = (uint32_t)values[0];
+                entry->averageCycles = (uint32_t)values[1];
+                entry->worstCycles = (uint32_t)values[2];
+                entry->averageMisses = (uint32_t)values[3];
+                entry->worstMisses = (uint32_t)values[4];
+                entry->missesAtWorst = (uint32_t)values[5];
+                answered = true;
+            }
+            else if(ParseResponse(line, "ERR", NULL, 0U, NULL))
+            {
+                answered = end = true;      /* past the last item */
+            }
+        }
+        if(!answered) return 0U;
+        if(end) break;
+        count++;
+    }
+    return count;
+}
+
+bool UpdateProtocol_CycleReset(const UpdateTransport_t *transport)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_CYCLE_RESET, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if(ParseResponse(line, "ACK", NULL, 0U, NULL)) return true;
+    }
+    return false;
+}
+
+uint32_t UpdateProtocol_DebounceInfo(const UpdateTransport_t *transport, UpdateDebounceStats_t *items, uint32_t maxItems)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint32_t count = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    while(count < maxItems)
+    {
+        uint8_t item = (uint8_t)count;
+        SendFrame(transport, USB_LINK_CMD_DEBOUNCE_INFO, &item, 1U, &stats);
+
+        bool answered = false, end = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            unsigned long values[7];
+            if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "DEBOUNCE %lu %lu %lu %lu %lu %lu %lu", &values[0], &values[1],
+                                                              &values[2], &values[3], &values[4], &values[5], &values[6]) == 7))
+            {
+                UpdateDebounceStats_t *entry = &items[count];
+                entry->channel = (uint32_t)values[0];
+                entry->input = (uint32_t)values[1];
+                entry->settle_us = (uint32_t)values[2];
+                entry->samples = (uint32_t)values[3];
+                entry->p50_us = (uint32_t)values[4];
+                entry->p95_us = (uint32_t)values[5];
+                entry->longest_us = (uint32_t)values[6];
+                answered = true;
+            }
+            else if(ParseResponse(line, "ERR", NULL, 0U, NULL))
+            {
+                answered = end = true;      /* past the last channel */
+            }
+        }
+        if(!answered) return 0U;
+        if(end) break;
+        count++;
+    }
+    return count;
+}
+
+bool UpdateProtocol_ConfigInfo(const UpdateTransport_t *transport, char *source, uint32_t sourceSize, char *flashState, uint32_t flashStateSize)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], sourceName[32], stateName[32];
+    unsigned int version;
+    unsigned long crc;
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_CONFIG_INFO, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "CONFIG %31s %u %lx %31s", sourceName, &version, &crc, stateName) == 4))
+        {
+            snprintf(source, sourceSize, "%s", sourceName);
+            snprintf(flashState, flashStateSize, "%s", stateName);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t UpdateProtocol_ConfigRead(const UpdateTransport_t *transport, uint8_t *block, uint32_t maxLength)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], hex[(2U * SITE_CONFIG_DATA_CHUNK) + 1U];
+    uint8_t request[SITE_CONFIG_READ_PAYLOAD_SIZE];
+    uint32_t length = 0, retries = 0;
+    unsigned long offset;
+
+    memset(&stats, 0, sizeof(stats));
+    while((length < maxLength) && (retries < UPDATE_PROTOCOL_MAX_RETRIES))
+    {
+        Put32(request, length);
+        SendFrame(transport, USB_LINK_CMD_CONFIG_READ, request, sizeof(request), &stats);
+
+        bool answered = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            hex[0] = '\0';
+            int fields = (line[0] == USB_LINK_RESPONSE_MARK) ? sscanf(&line[1], "CDATA %lu %96s", &offset, hex) : 0;
+            answered = (fields >= 1) && (offset == length);
+        }
+        if(!answered)
+        {
+            retries++;
+            continue;
+        }
+
+        uint32_t count = (uint32_t)strlen(hex) / 2U;
+        if(count == 0U) break;
+        for(uint32_t i = 0; (i < count) && (length < maxLength); i++)
+        {
+            unsigned int byte;
+            sscanf(&hex[2U * i], "%2x", &byte);
+            block[length++] = (uint8_t)byte;
+        }
+    }
+    return (retries < UPDATE_PROTOCOL_MAX_RETRIES) ? length : 0U;
+}
+
+bool UpdateProtocol_ConfigWrite(const UpdateTransport_t *transport, const uint8_t *block, uint32_t length, char *reason, uint32_t reasonSize)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+
+    memset(&stats, 0, sizeof(stats));
+    snprintf(reason, reasonSize, "timeout");
+    SendFrame(transport, USB_LINK_CMD_CONFIG_WRITE, block, length, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if(ParseResponse(line, "ACK", NULL, 0U, NULL)) return true;
+        if(ParseResponse(line, "ERR", reason, reasonSize, NULL)) return false;
+    }
+    return false;
+}
+
+bool UpdateProtocol_ProfileStart(const UpdateTransport_t *transport, uint32_t rate_hz, char *reason, uint32_t reasonSize)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint8_t request[PROFILER_START_PAYLOAD_SIZE];
+
+    memset(&stats, 0, sizeof(stats));
+    snprintf(reason, reasonSize, "timeout");
+    Put32(request, rate_hz);
+    SendFrame(transport, USB_LINK_CMD_PROFILE_START, request, sizeof(request), &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if(ParseResponse(line, "ACK", NULL, 0U, NULL)) return true;
+        if(ParseResponse(line, "ERR", reason, reasonSize, NULL)) return false;
+    }
+    return false;
+}
+
+bool UpdateProtocol_ProfileInfo(const UpdateTransport_t *transport, UpdateProfileInfo_t *info)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], state[16];
+    unsigned long values[5];
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_PROFILE_INFO, NULL, 0U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "PROFILE %15s %lu %lu %lu %lu %lu", state, &values[0], &values[1],
+                                                          &values[2], &values[3], &values[4]) == 6))
+        {
+            snprintf(info->state, sizeof(info->state), "%s", state);
+            info->rate_hz = (uint32_t)values[0];
+            info->period_us = (uint32_t)values[1];
+            info->samples = (uint32_t)values[2];
+            info->late = (uint32_t)values[3];
+            info->tasks = (uint32_t)values[4];
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t UpdateProtocol_ProfileRead(const UpdateTransport_t *transport, uint32_t *pcs, uint8_t *tasks, uint32_t maxSamples)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], hex[(2U * PROFILER_SAMPLE_SIZE * PROFILER_DATA_CHUNK) + 1U];
+    uint8_t request[PROFILER_READ_PAYLOAD_SIZE];
+    uint32_t count = 0, retries = 0;
+    unsigned long first;
+
+    memset(&stats, 0, sizeof(stats));
+    while((count < maxSamples) && (retries < UPDATE_PROTOCOL_MAX_RETRIES))
+    {
+        Put32(request, count);
+        SendFrame(transport, USB_LINK_CMD_PROFILE_READ, request, sizeof(request), &stats);
+
+        bool answered = false;
+        while(!answered && transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+        {
+            hex[0] = '\0';
+            int fields = (line[0] == USB_LINK_RESPONSE_MARK) ? sscanf(&line[1], "PDATA %lu %90s", &first, hex) : 0;
+            answered = (fields >= 1) && (first == count);
+        }
+        if(!answered)
+        {
+            retries++;
+            continue;
+        }
+
+        uint32_t received = (uint32_t)strlen(hex) / (2U * PROFILER_SAMPLE_SIZE);
+        if(received == 0U) break;
+        for(uint32_t i = 0; (i < received) && (count < maxSamples); i++)
+        {
+            unsigned int bytes[PROFILER_SAMPLE_SIZE];
+            for(uint32_t b = 0; b < PROFILER_SAMPLE_SIZE; b++)
+            {
+                sscanf(&hex[(2U * PROFILER_SAMPLE_SIZE * i) + (2U * b)], "%2x", &bytes[b]);
+            }
+            pcs[count] = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+            tasks[count] = (uint8_t)bytes[4];
+            count++;
+        }
+    }
+    return (retries < UPDATE_PROTOCOL_MAX_RETRIES) ? count : 0U;
+}
+
+bool UpdateProtocol_ProfileTask(const UpdateTransport_t *transport, uint32_t index, char *name, uint32_t nameSize)
+{
+    UpdateSessionStats_t stats;
+    char line[UPDATE_PROTOCOL_MAX_LINE], taskName[32];
+    uint8_t request = (uint8_t)index;
+    unsigned int answeredIndex;
+
+    memset(&stats, 0, sizeof(stats));
+    SendFrame(transport, USB_LINK_CMD_PROFILE_TASK, &request, 1U, &stats);
+    while(transport->readLine(transport->context, line, sizeof(line), UPDATE_PROTOCOL_ACK_TIMEOUT_MS))
+    {
+        if((line[0] == USB_LINK_RESPONSE_MARK) && (sscanf(&line[1], "PTASK %u %31s", &answeredIndex, taskName) == 2) && (answeredIndex == index))
+        {
+            snprintf(name, nameSize, "%s", taskName);
+            return true;
+        }
+        if(ParseResponse(line, "ERR", NULL, 0U, NULL)) return false;
+    }
+    return false;
+}
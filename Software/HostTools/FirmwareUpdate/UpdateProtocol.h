@@ -0,0 +1,146 @@
+#ifndef UPDATEPROTOCOL_H
+#define UPDATEPROTOCOL_H
+
+/* UpdateProtocol - host side of the firmware update over the USB link (see UsbLink.h and Update.h of the firmware):
+   the delta encoder, the frames and the sender session, the download of the field trace (Trace.h), the time sync (TimeSync.h),
+   the site configuration (SiteConfig.h) and the profiler (Profiler.h).
+   Used by UpdateSender (serial port) and FirmwareUpdate (HostSim) */
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "Hash.h"
+
+/*--------------- MACROS ---------------*/
+#define UPDATE_PROTOCOL_CHUNK           (1024U)     /* update bytes per UPDATE_DATA frame */
+#define UPDATE_PROTOCOL_WINDOW          (2048U)     /* update bytes sent ahead of the last ACK */
+#define UPDATE_PROTOCOL_ACK_TIMEOUT_MS  (2000U)     /* covers a few sector writes on the board */
+#define UPDATE_PROTOCOL_DONE_TIMEOUT_MS (10000U)    /* the board hashes the staged image and writes the request */
+#define UPDATE_PROTOCOL_BUSY_WAIT_MS    (1000U)     /* a motor runs - retried after that */
+#define UPDATE_PROTOCOL_MAX_RETRIES     (20U)
+#define UPDATE_PROTOCOL_MIN_MATCH       (32U)       /* exact match that starts an UPDATE_OP_ADD */
+#define UPDATE_PROTOCOL_MAX_LINE        (160U)
+#define UPDATE_PROTOCOL_ROUND_TRIPS     (8U)        /* TIME_INFO round trips before a TIME_SYNC - the shortest one is used */
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Byte stream to the board and its response lines (the text lines without USB_LINK_RESPONSE_MARK are skipped) */
+typedef struct
+{
+    void *context;
+    void (*write)(void *context, const uint8_t *data, uint32_t length);
+    bool (*readLine)(void *context, char *line, uint32_t size, uint32_t timeout_ms);  /* false on timeout */
+    void (*sleep)(void *context, uint32_t ms);
+}UpdateTransport_t;
+
+typedef struct
+{
+    uint32_t frames;                /* UPDATE_DATA frames sent, including the repeated ones */
+    uint32_t repeatedFrames;
+    uint32_t timeouts;
+    uint32_t errors;                /* #ERR sequence/busy responses */
+    uint64_t wireBytes;             /* all the frames sent, framing included */
+    uint32_t changedSectors;        /* from the #DONE response */
+    uint32_t sectors;
+    char failure[UPDATE_PROTOCOL_MAX_LINE];
+}UpdateSessionStats_t;
+
+typedef struct
+{
+    char rtcBefore[32];             /* date and time of the DS1307 from the first #TIME */
+    uint32_t roundTrips;
+    uint32_t bestRoundTrip_us;
+    uint32_t worstRoundTrip_us;
+    int32_t offset_ms;              /* from the #SYNC - the DS1307 against the host before the sync, 0 - no earlier sync */
+    int32_t drift_ppb;
+    uint32_t interval_s;            /* the drift was measured over, 0 - kept */
+    uint64_t duration_us;           /* of the whole exchange */
+    char failure[UPDATE_PROTOCOL_MAX_LINE];
+}UpdateTimeSyncStats_t;
+
+/* One #CYCLES response - an interrupt handler or task job of CycleCounter */
+typedef struct
+{
+    char name[32];
+    uint32_t count;
+    uint32_t averageCycles, worstCycles;
+    uint32_t averageMisses, worstMisses;    /* XIP cache misses per run */
+    uint32_t missesAtWorst;                 /* of the run with the worst cycles */
+}UpdateCycleStats_t;
+
+/* One #DEBOUNCE response - the settle window of an input and the bounce of its presses (Debounce.c) */
+typedef struct
+{
+    uint32_t channel, input;
+    uint32_t settle_us;
+    uint32_t samples;
+    uint32_t p50_us, p95_us;        /* of the bounce in the histogram, 0 - no samples */
+    uint32_t longest_us;            /* since the boot */
+}UpdateDebounceStats_t;
+
+/* #PROFILE response - the capture of the profiler (Profiler.h) */
+typedef struct
+{
+    char state[16];                 /* off, capturing, done */
+    uint32_t rate_hz;
+    uint32_t period_us;
+    uint32_t samples;
+    uint32_t late;
+    uint32_t tasks;                 /* names to read with UpdateProtocol_ProfileTask */
+}UpdateProfileInfo_t;
+
+/*--------------- GLOBAL FUNCTION DECLARATIONS ---------------*/
+
+/* Update payloads - the size of the payload (0 if it does not fit into maxLength) */
+uint32_t UpdateProtocol_EncodeFull(const uint8_t *image, uint32_t imageSize, uint8_t *payload, uint32_t maxLength);
+uint32_t UpdateProtocol_EncodeDelta(const uint8_t *base, uint32_t baseSize, const uint8_t *image, uint32_t imageSize,
+                                    uint8_t *payload, uint32_t maxLength);
+
+/* Applies a payload like the firmware does - false if it is malformed or does not produce imageSize bytes */
+bool UpdateProtocol_Decode(const uint8_t *base, uint32_t baseSize, const uint8_t *payload, uint32_t payloadSize,
+                           uint8_t *image, uint32_t imageSize);
+
+/* One frame to the board - returns its size */
+uint32_t UpdateProtocol_Frame(uint8_t command, const uint8_t *payload, uint32_t length, uint8_t *frame);
+
+/* #INFO of the board - boot state, attempts, size and SHA-256 of the running image */
+bool UpdateProtocol_Info(const UpdateTransport_t *transport, char *state, uint32_t stateSize, uint32_t *attempts,
+                         uint32_t *imageSize, uint8_t imageHash[HASH_SHA256_SIZE]);
+
+/* Whole update: UPDATE_BEGIN, the payload in a window of frames (rewound on #ERR and on a timeout), UPDATE_END.
+   baseHash is NULL for a full image. True once the board answered #DONE (it reboots into the boot stub then) */
+bool UpdateProtocol_Send(const UpdateTransport_t *transport, const uint8_t *image, uint32_t imageSize,
+                         const uint8_t *payload, uint32_t payloadSize, const uint8_t *baseHash, UpdateSessionStats_t *stats);
+
+/* Field trace of a TRACE_ENABLED image - #TRACE state and size, the start of a capture (the board erases the trace area and
+   reboots into it, reason of an #ERR otherwise) and the download of the trace area (its size, 0 on a timeout) */
+bool UpdateProtocol_TraceInfo(const UpdateTransport_t *transport, char *state, uint32_t stateSize, uint32_t *size);
+bool UpdateProtocol_TraceStart(const UpdateTransport_t *transport, char *reason, uint32_t reasonSize);
+uint32_t UpdateProtocol_TraceRead(const UpdateTransport_t *transport, uint8_t *trace, uint32_t maxLength);
+
+/* DS1307 of the board set to the UTC of the host (utcNow_us - us since 1970, called with the context of the transport): TIME_INFO
+   round trips, then TIME_SYNC with half of the shortest one as the link delay. True once the board answered #SYNC */
+bool UpdateProtocol_TimeSync(const UpdateTransport_t *transport, int64_t (*utcNow_us)(void *context), UpdateTimeSyncStats_t *stats);
+
+/* Execution times and XIP cache misses measured by the board (CycleCounter) - the number of items read, 0 on a timeout. The
+   reset starts a new measurement */
+uint32_t UpdateProtocol_CycleInfo(const UpdateTransport_t *transport, UpdateCycleStats_t *items, uint32_t maxItems);
+bool UpdateProtocol_CycleReset(const UpdateTransport_t *transport);
+
+/* Settle windows of the inputs of all the channels the board drives (channel * 4 + input) - the number read, 0 on a timeout */
+uint32_t UpdateProtocol_DebounceInfo(const UpdateTransport_t *transport, UpdateDebounceStats_t *items, uint32_t maxItems);
+
+/* Site configuration (SiteConfig.h) - #CONFIG source ("flash", "default") and state of the flash block, the download of the
+   block in use (its size, 0 on a timeout) and the write of a block (the board reboots into it, reason of an #ERR otherwise) */
+bool UpdateProtocol_ConfigInfo(const UpdateTransport_t *transport, char *source, uint32_t sourceSize, char *flashState, uint32_t flashStateSize);
+uint32_t UpdateProtocol_ConfigRead(const UpdateTransport_t *transport, uint8_t *block, uint32_t maxLength);
+bool UpdateProtocol_ConfigWrite(const UpdateTransport_t *transport, const uint8_t *block, uint32_t length, char *reason, uint32_t reasonSize);
+
+/* Profiler of a PROFILER_ENABLED image (Profiler.h) - the start of a capture (rate 0 stops it, reason of an #ERR otherwise),
+   its state, the download of the samples (PC and task index each - the number read, 0 on a timeout) and the name of a task */
+bool UpdateProtocol_ProfileStart(const UpdateTransport_t *transport, uint32_t rate_hz, char *reason, uint32_t reasonSize);
+bool UpdateProtocol_ProfileInfo(const UpdateTransport_t *transport, UpdateProfileInfo_t *info);
+uint32_t UpdateProtocol_ProfileRead(const UpdateTransport_t *transport, uint32_t *pcs, uint8_t *tasks, uint32_t maxSamples);
+bool UpdateProtocol_ProfileTask(const UpdateTransport_t *transport, uint32_t index, char *name, uint32_t nameSize);
+
+#endif /* UPDATEPROTOCOL_H */
@@ -0,0 +1,676 @@
+/* UpdateSender.c - sends a firmware image to the board over its USB serial port (the USB link of the firmware).
+
+   The image is the .bin of the build (build/SwComponents/ElectronicBlinds_Main.bin - linked to slot A). With --base (the .bin
+   of the image that runs on the board) the update goes as a delta, if the board confirms that it runs that image (#INFO hash).
+   After #DONE the board reboots, the boot stub swaps the image in and the new image confirms itself after 30s.
+
+   An image built with TRACE_ENABLED=1 also keeps a field trace (Trace.h): --trace-start erases the trace area and reboots
+   the board into the capture, --trace-read saves the trace area to a file for HostTools/TraceReplay.
+
+   --time-sync sets the DS1307 of the board to the system clock of this host (keep it synchronized - NTP). The board takes the
+   UTC and writes its local civil time, DST included. From the second sync on the board also measures the drift of the DS1307
+   and corrects it until the next sync.
+
+   --cycles shows the execution times of the interrupt handlers and task jobs the board measured (CycleCounter) with their misses
+   of the XIP flash cache, --cycles-reset starts a new measurement - e.g. to compare an image built with RAM_HOT_PATHS_ENABLED
+   under the same load.
+
+   --debounce shows the settle windows the board learned for its inputs (Debounce.c) with the bounce of their presses.
+
+   --config shows the site configuration of the board (SiteConfig.h) - the block in its flash or the build defaults. Every
+   --config-set NAME=VALUE changes one field of it (the names as --config shows them, the pins as ch<channel>.<input>), the
+   block goes back with a new CRC and the board reboots into it.
+
+   An image built with PROFILER_ENABLED=1 samples the code it runs (Profiler.h): --profile-start RATE starts a capture at RATE Hz
+   (0 stops it), --profile-read saves the capture to a file for HostTools/Profiler/ProfileReport (with the .elf of the image).
+
+   Usage: UpdateSender --port /dev/ttyACM0 --image new.bin [--base old.bin] [--full]
+          UpdateSender --port /dev/ttyACM0 --info
+          UpdateSender --port /dev/ttyACM0 --trace-start
+          UpdateSender --port /dev/ttyACM0 --trace-read trace.bin
+          UpdateSender --port /dev/ttyACM0 --time-sync
+          UpdateSender --port /dev/ttyACM0 --cycles | --cycles-reset
+          UpdateSender --port /dev/ttyACM0 --debounce
+          UpdateSender --port /dev/ttyACM0 --config [--config-set NAME=VALUE]...
+          UpdateSender --port /dev/ttyACM0 --profile-start RATE | --profile-read profile.txt
+          UpdateSender --diff old.bin new.bin      (payload sizes only, no board)
+   Exits with 1 if the update did not get to #DONE (the trace, time, cycles, debounce, config or profile command did not
+   succeed). */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Firmware includes */
+#include "BootControl.h"
+#include "Hash.h"
+#include "CycleCounter.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+
+#include "UpdateProtocol.h"
+#include "Profile.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_CONFIG_SETS     (64U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    int fd;
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint32_t fill;
+}SerialPort_t;
+
+typedef enum
+{
+    FIELD_DOUBLE,
+    FIELD_INT32,
+    FIELD_UINT32,
+    FIELD_UINT16,
+    FIELD_UINT8
+}FieldType_t;
+
+typedef struct
+{
+    const char *name;
+    FieldType_t type;
+    size_t offset;
+}ConfigField_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* The fields of SiteConfig_t that --config-set changes - the pins follow as ch<channel>.<input> */
+static const ConfigField_t ConfigFields[] =
+{
+    { "latitude",           FIELD_DOUBLE, offsetof(SiteConfig_t, latitude) },
+    { "longitude",          FIELD_DOUBLE, offsetof(SiteConfig_t, longitude) },
+    { "time-zone",          FIELD_INT32,  offsetof(SiteConfig_t, timeZone) },
+    { "period-ms",          FIELD_UINT32, offsetof(SiteConfig_t, automaticControlPeriod_ms) },
+    { "debounce-button-us", FIELD_UINT32, offsetof(SiteConfig_t, debounceButton_us) },
+    { "debounce-limit-us",  FIELD_UINT32, offsetof(SiteConfig_t, debounceLimit_us) },
+    { "light-dark",         FIELD_UINT16, offsetof(SiteConfig_t, lightDarkThreshold) },
+    { "light-bright",       FIELD_UINT16, offsetof(SiteConfig_t, lightBrightThreshold) },
+    { "light-hysteresis",   FIELD_UINT16, offsetof(SiteConfig_t, lightHysteresis) },
+    { "bus-address",        FIELD_UINT8,  offsetof(SiteConfig_t, busAddress) },
+    { "bus-groups",         FIELD_UINT8,  offsetof(SiteConfig_t, busGroups) },
+    { "bus-leader",         FIELD_UINT8,  offsetof(SiteConfig_t, busLeader) },
+};
+
+/* ChannelInput_t, then the two motor outputs */
+static const char *PinNames[CHANNEL_NUM_OF_INPUTS + 2U] = { "up", "down", "top-limit", "bottom-limit", "motor1", "motor2" };
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint8_t* ReadFile(const char *path, uint32_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc((length > 0) ? (size_t)length : 1U);
+    if((length <= 0) || (fread(data, 1, (size_t)length, file) != (size_t)length))
+    {
+        fprintf(stderr, "%s: empty or unreadable\n", path);
+        fclose(file);
+        free(data);
+        return NULL;
+    }
+    fclose(file);
+    *size = (uint32_t)length;
+    return data;
+}
+
+static uint64_t NowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000ULL) + ((uint64_t)ts.tv_nsec / 1000000ULL);
+}
+
+static int64_t UtcNowUs(void *context)
+{
+    struct timespec ts;
+    (void)context;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((int64_t)ts.tv_sec * 1000000LL) + ((int64_t)ts.tv_nsec / 1000LL);
+}
+
+static void SerialWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    SerialPort_t *port = context;
+    while(length > 0U)
+    {
+        ssize_t written = write(port->fd, data, length);
+        if(written < 0)
+        {
+            if(errno == EINTR) continue;
+            perror("write");
+            exit(1);
+        }
+        data += written;
+        length -= (uint32_t)written;
+    }
+}
+
+static bool SerialReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    SerialPort_t *port = context;
+    uint64_t deadline = NowMs() + timeout_ms;
+
+    for(;;)
+    {
+        uint64_t now = NowMs();
+        if(now >= deadline) return false;
+
+        struct pollfd pfd = { port->fd, POLLIN, 0 };
+        if(poll(&pfd, 1, (int)(deadline - now)) <= 0) continue;
+        char c;
+        if(read(port->fd, &c, 1) != 1) continue;
+        if(c == '\r') continue;
+        if(c != '\n')
+        {
+            if(port->fill < (sizeof(port->line) - 1U)) port->line[port->fill++] = c;
+            continue;
+        }
+        port->line[port->fill] = '\0';
+        port->fill = 0;
+        snprintf(line, size, "%s", port->line);
+        return true;
+    }
+}
+
+static void SerialSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    usleep(ms * 1000U);
+}
+
+static int OpenPort(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if(fd < 0)
+    {
+        perror(path);
+        return -1;
+    }
+    /* Raw - the CDC link ignores the baud rate */
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static void PrintHash(const uint8_t hash[HASH_SHA256_SIZE])
+{
+    for(uint32_t i = 0; i < HASH_SHA256_SIZE; i++) printf("%02x", hash[i]);
+}
+
+static void ImageHash(const uint8_t *image, uint32_t size, uint8_t hash[HASH_SHA256_SIZE])
+{
+    HashSha256_t context;
+    Hash_Sha256Init(&context);
+    Hash_Sha256Update(&context, image, size);
+    Hash_Sha256Final(&context, hash);
+}
+
+/* The capture (--trace-start) or the download of the trace area (--trace-read) */
+static int TraceCommand(const UpdateTransport_t *transport, bool start, const char *path)
+{
+    char state[32];
+    uint32_t size;
+
+    if(!UpdateProtocol_TraceInfo(transport, state, sizeof(state), &size))
+    {
+        fprintf(stderr, "No #TRACE from the board - not built with TRACE_ENABLED=1?\n");
+        return 1;
+    }
+    printf("trace: %s, %u bytes\n", state, (unsigned)size);
+
+    if(start)
+    {
+        char reason[32];
+        if(!UpdateProtocol_TraceStart(transport, reason, sizeof(reason)))
+        {
+            fprintf(stderr, "trace start failed: %s\n", reason);
+            return 1;
+        }
+        printf("trace area erased - the board reboots into the capture\n");
+        return 0;
+    }
+
+    uint8_t *trace = malloc(BOOT_TRACE_SIZE);
+    uint64_t start_ms = NowMs();
+    uint32_t length = UpdateProtocol_TraceRead(transport, trace, BOOT_TRACE_SIZE);
+    FILE *file = (length > 0U) ? fopen(path, "wb") : NULL;
+    if((file == NULL) || (fwrite(trace, 1, length, file) != length))
+    {
+        fprintf(stderr, "%s: %s\n", path, (length > 0U) ? "write failed" : "no trace read from the board");
+        if(file != NULL) fclose(file);
+        return 1;
+    }
+    fclose(file);
+    printf("%u bytes saved to %s in %.1fs\n", (unsigned)length, path, (NowMs() - start_ms) / 1000.0);
+    return 0;
+}
+
+static int TimeSyncCommand(const UpdateTransport_t *transport)
+{
+    UpdateTimeSyncStats_t stats;
+
+    if(!UpdateProtocol_TimeSync(transport, UtcNowUs, &stats))
+    {
+        fprintf(stderr, "time sync failed: %s\n", stats.failure);
+        return 1;
+    }
+    printf("board clock was %s, round trip %.2f..%.2fms over %u tries, synchronized in %.2fs\n", stats.rtcBefore,
+           stats.bestRoundTrip_us / 1000.0, stats.worstRoundTrip_us / 1000.0, (unsigned)stats.roundTrips, stats.duration_us / 1e6);
+    if(stats.interval_s > 0U)
+    {
+        printf("offset %+.3fs after %.1f days, drift %+.2fppm (%+.2fs/day) - corrected until the next sync\n", stats.offset_ms / 1000.0,
+               stats.interval_s / 86400.0, stats.drift_ppb / 1000.0, (stats.drift_ppb * 86400.0) / 1e9);
+    }
+    else if(stats.offset_ms != 0)
+    {
+        printf("offset %+.3fs - too soon after the previous sync for a drift, kept %+.2fppm\n", stats.offset_ms / 1000.0, stats.drift_ppb / 1000.0);
+    }
+    return 0;
+}
+
+static int CyclesCommand(const UpdateTransport_t *transport, bool reset)
+{
+    UpdateCycleStats_t items[CYCLES_NUM_OF_ITEMS];
+
+    if(reset)
+    {
+        if(!UpdateProtocol_CycleReset(transport))
+        {
+            fprintf(stderr, "No answer to CYCLE_RESET\n");
+            return 1;
+        }
+        printf("measurement restarted\n");
+        return 0;
+    }
+
+    uint32_t count = UpdateProtocol_CycleInfo(transport, items, CYCLES_NUM_OF_ITEMS);
+    if(count == 0U)
+    {
+        fprintf(stderr, "No #CYCLES from the board\n");
+        return 1;
+    }
+    printf("%-22s %10s %10s %10s %12s %12s %14s\n", "item", "count", "avg us", "worst us", "avg misses", "worst misses",
+           "misses@worst");
+    for(uint32_t i = 0; i < count; i++)
+    {
+        printf("%-22s %10u %10.2f %10.2f %12u %12u %14u\n", items[i].name, (unsigned)items[i].count,
+               items[i].averageCycles / (double)CYCLE_COUNTER_CLK_SYS_MHZ, items[i].worstCycles / (double)CYCLE_COUNTER_CLK_SYS_MHZ,
+               (unsigned)items[i].averageMisses, (unsigned)items[i].worstMisses, (unsigned)items[i].missesAtWorst);
+    }
+    return 0;
+}
+
+static int DebounceCommand(const UpdateTransport_t *transport)
+{
+    static const char *inputNames[CHANNEL_NUM_OF_INPUTS] = { "up", "down", "top limit", "bottom limit" };
+    UpdateDebounceStats_t items[CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS];
+
+    uint32_t count = UpdateProtocol_DebounceInfo(transport, items, CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS);
+    if(count == 0U)
+    {
+        fprintf(stderr, "No #DEBOUNCE from the board\n");
+        return 1;
+    }
+    printf("%-8s %-13s %10s %8s %8s %8s %11s\n", "channel", "input", "settle ms", "presses", "p50 ms", "p95 ms", "longest ms");
+    for(uint32_t i = 0; i < count; i++)
+    {
+        printf("%-8u %-13s %10.1f %8u %8.1f %8.1f %11.1f\n", (unsigned)items[i].channel,
+               (items[i].input < CHANNEL_NUM_OF_INPUTS) ? inputNames[items[i].input] : "?", items[i].settle_us / 1000.0,
+               (unsigned)items[i].samples, items[i].p50_us / 1000.0, items[i].p95_us / 1000.0, items[i].longest_us / 1000.0);
+    }
+    return 0;
+}
+
+/* Offset of a pin (ch<channel>.<pin name>) in the block, 0 - not a pin */
+static size_t PinOffset(const char *name)
+{
+    unsigned int channel;
+    char pin[32];
+
+    if((sscanf(name, "ch%u.%31s", &channel, pin) != 2) || (channel >= BLINDS_MAX_NUM_OF_CHANNELS)) return 0U;
+    for(uint32_t i = 0; i < (CHANNEL_NUM_OF_INPUTS + 2U); i++)
+    {
+        if(strcmp(pin, PinNames[i]) != 0) continue;
+        if(i < CHANNEL_NUM_OF_INPUTS)
+        {
+            return offsetof(SiteConfig_t, channels) + offsetof(ChannelConfig_t, inputGpio) + (i * BLINDS_MAX_NUM_OF_CHANNELS) + channel;
+        }
+        return offsetof(SiteConfig_t, channels) + ((i == CHANNEL_NUM_OF_INPUTS) ? offsetof(ChannelConfig_t, motorControl1Gpio)
+                                                                                : offsetof(ChannelConfig_t, motorControl2Gpio)) + channel;
+    }
+    return 0U;
+}
+
+static void PrintField(const SiteConfig_t *config, const ConfigField_t *field)
+{
+    const uint8_t *at = (const uint8_t *)config + field->offset;
+    double d;
+    int32_t i32;
+    uint32_t u32;
+    uint16_t u16;
+
+    switch(field->type)
+    {
+        case FIELD_DOUBLE: memcpy(&d, at, sizeof(d)); printf("%-20s %.6f\n", field->name, d); break;
+        case FIELD_INT32: memcpy(&i32, at, sizeof(i32)); printf("%-20s %d\n", field->name, (int)i32); break;
+        case FIELD_UINT32: memcpy(&u32, at, sizeof(u32)); printf("%-20s %u\n", field->name, (unsigned)u32); break;
+        case FIELD_UINT16: memcpy(&u16, at, sizeof(u16)); printf("%-20s %u\n", field->name, (unsigned)u16); break;
+        default: printf("%-20s %u\n", field->name, (unsigned)*at); break;
+    }
+}
+
+/* NAME=VALUE into the block - false for an unknown name or a value that is not a number */
+static bool SetField(SiteConfig_t *config, const char *assignment)
+{
+    char name[32], *end;
+    const char *value = strchr(assignment, '=');
+
+    if((value == NULL) || ((size_t)(value - assignment) >= sizeof(name))) return false;
+    memcpy(name, assignment, (size_t)(value - assignment));
+    name[value - assignment] = '\0';
+    value++;
+
+    uint8_t *block = (uint8_t *)config;
+    size_t pin = PinOffset(name);
+    if(pin != 0U)
+    {
+        unsigned long gpio = strtoul(value, &end, 0);
+        if((*value == '\0') || (*end != '\0') || (gpio > UINT8_MAX)) return false;
+        block[pin] = (uint8_t)gpio;
+        return true;
+    }
+    for(uint32_t i = 0; i < sizeof(ConfigFields) / sizeof(ConfigFields[0]); i++)
+    {
+        const ConfigField_t *field = &ConfigFields[i];
+        if(strcmp(name, field->name) != 0) continue;
+
+        uint8_t *at = block + field->offset;
+        if(field->type == FIELD_DOUBLE)
+        {
+            double d = strtod(value, &end);
+            if((*value == '\0') || (*end != '\0')) return false;
+            memcpy(at, &d, sizeof(d));
+            return true;
+        }
+        long number = strtol(value, &end, 0);
+        if((*value == '\0') || (*end != '\0')) return false;
+        int32_t i32 = (int32_t)number;
+        uint32_t u32 = (uint32_t)number;
+        uint16_t u16 = (uint16_t)number;
+        switch(field->type)
+        {
+            case FIELD_INT32: memcpy(at, &i32, sizeof(i32)); break;
+            case FIELD_UINT32: memcpy(at, &u32, sizeof(u32)); break;
+            case FIELD_UINT16: memcpy(at, &u16, sizeof(u16)); break;
+            default: *at = (uint8_t)number; break;
+        }
+        return true;
+    }
+    return false;
+}
+
+/* The site configuration of the board (--config), changed and written back with --config-set */
+static int ConfigCommand(const UpdateTransport_t *transport, const char **sets, uint32_t numOfSets)
+{
+    char source[32], flashState[32];
+    SiteConfig_t config;
+
+    if(!UpdateProtocol_ConfigInfo(transport, source, sizeof(source), flashState, sizeof(flashState)) ||
+       (UpdateProtocol_ConfigRead(transport, (uint8_t *)&config, sizeof(config)) != sizeof(config)))
+    {
+        fprintf(stderr, "No #CONFIG from the board\n");
+        return 1;
+    }
+    printf("config: %s (flash block: %s), version %u\n", source, flashState, (unsigned)config.version);
+
+    if(numOfSets == 0U)
+    {
+        for(uint32_t i = 0; i < sizeof(ConfigFields) / sizeof(ConfigFields[0]); i++)
+        {
+            PrintField(&config, &ConfigFields[i]);
+        }
+        for(uint32_t channel = 0; channel < BLINDS_MAX_NUM_OF_CHANNELS; channel++)
+        {
+            printf("ch%u.%-16s %u %u %u %u %u %u\n", (unsigned)channel, "pins", (unsigned)config.channels.inputGpio[CHANNEL_INPUT_UP][channel],
+                   (unsigned)config.channels.inputGpio[CHANNEL_INPUT_DOWN][channel], (unsigned)config.channels.inputGpio[CHANNEL_INPUT_TOP_LIMIT][channel],
+                   (unsigned)config.channels.inputGpio[CHANNEL_INPUT_BOTTOM_LIMIT][channel], (unsigned)config.channels.motorControl1Gpio[channel],
+                   (unsigned)config.channels.motorControl2Gpio[channel]);
+        }
+        printf("(pins: up down top-limit bottom-limit motor1 motor2)\n");
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < numOfSets; i++)
+    {
+        if(!SetField(&config, sets[i]))
+        {
+            fprintf(stderr, "%s: unknown field or not a number\n", sets[i]);
+            return 1;
+        }
+    }
+    config.magic = SITE_CONFIG_MAGIC;
+    config.version = SITE_CONFIG_VERSION;
+    config.size = SITE_CONFIG_SIZE;
+    memset(config.reserved, 0, sizeof(config.reserved));
+    config.crc = Hash_Crc32(&config, offsetof(SiteConfig_t, crc));
+
+    char reason[32];
+    if(!UpdateProtocol_ConfigWrite(transport, (const uint8_t *)&config, sizeof(config), reason, sizeof(reason)))
+    {
+        fprintf(stderr, "config write failed: %s\n", reason);
+        return 1;
+    }
+    printf("config written - the board reboots into it\n");
+    return 0;
+}
+
+/* A capture of the profiler - started at a rate (--profile-start, 0 stops it) or saved to a file (--profile-read) */
+static int ProfileCommand(const UpdateTransport_t *transport, const char *rate, const char *path)
+{
+    if(rate != NULL)
+    {
+        char reason[32], *end;
+        unsigned long rate_hz = strtoul(rate, &end, 0);
+        if((*rate == '\0') || (*end != '\0') || !UpdateProtocol_ProfileStart(transport, (uint32_t)rate_hz, reason, sizeof(reason)))
+        {
+            fprintf(stderr, "profile start failed: %s\n", (*end != '\0') ? "not a number" : reason);
+            return 1;
+        }
+        if(rate_hz == 0U) printf("profile stopped\n");
+        else printf("profile started at %lu Hz\n", rate_hz);
+        return 0;
+    }
+
+    static Profile_t profile;
+    if(!Profile_Download(transport, &profile))
+    {
+        fprintf(stderr, "No profile from the board (not a PROFILER_ENABLED image?)\n");
+        return 1;
+    }
+    if(!Profile_Save(&profile, path))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    printf("profile: %u samples at %u Hz, %u late, %u tasks - saved to %s\n", (unsigned)profile.numOfSamples, (unsigned)profile.rate_hz,
+           (unsigned)profile.late, (unsigned)profile.numOfTasks, path);
+    return 0;
+}
+
+static int Diff(const char *basePath, const char *imagePath)
+{
+    uint32_t baseSize, imageSize;
+    uint8_t *base = ReadFile(basePath, &baseSize);
+    uint8_t *image = ReadFile(imagePath, &imageSize);
+    if((base == NULL) || (image == NULL)) return 1;
+
+    uint8_t *payload = malloc(imageSize * 2U + 64U);
+    uint8_t *decoded = malloc(imageSize);
+    uint32_t full = UpdateProtocol_EncodeFull(image, imageSize, payload, imageSize * 2U + 64U);
+    uint32_t delta = UpdateProtocol_EncodeDelta(base, baseSize, image, imageSize, payload, imageSize * 2U + 64U);
+    bool ok = UpdateProtocol_Decode(base, baseSize, payload, delta, decoded, imageSize) && (memcmp(decoded, image, imageSize) == 0);
+
+    uint32_t sectors = (imageSize + FLASH_SECTOR_SIZE - 1U) / FLASH_SECTOR_SIZE, changed = 0;
+    for(uint32_t sector = 0; sector < sectors; sector++)
+    {
+        uint32_t offset = sector * FLASH_SECTOR_SIZE;
+        uint32_t length = ((imageSize - offset) < FLASH_SECTOR_SIZE) ? (imageSize - offset) : FLASH_SECTOR_SIZE;
+        if((offset + length > baseSize) || (memcmp(&base[offset], &image[offset], length) != 0)) changed++;
+    }
+    printf("image %u bytes, full payload %u bytes, delta payload %u bytes (%.1f%%), sectors changed %u of %u, round trip %s\n",
+           (unsigned)imageSize, (unsigned)full, (unsigned)delta, (100.0 * delta) / full, (unsigned)changed, (unsigned)sectors, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    const char *portPath = NULL, *imagePath = NULL, *basePath = NULL, *tracePath = NULL, *profileRate = NULL, *profilePath = NULL;
+    bool full = false, info = false, traceStart = false, timeSync = false, cycles = false, cyclesReset = false, debounce = false, config = false;
+    const char *configSets[MAX_CONFIG_SETS];
+    uint32_t numOfConfigSets = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--port") == 0) && ((i + 1) < argc)) portPath = argv[++i];
+        else if((strcmp(argv[i], "--image") == 0) && ((i + 1) < argc)) imagePath = argv[++i];
+        else if((strcmp(argv[i], "--base") == 0) && ((i + 1) < argc)) basePath = argv[++i];
+        else if(strcmp(argv[i], "--full") == 0) full = true;
+        else if(strcmp(argv[i], "--info") == 0) info = true;
+        else if(strcmp(argv[i], "--trace-start") == 0) traceStart = true;
+        else if(strcmp(argv[i], "--time-sync") == 0) timeSync = true;
+        else if(strcmp(argv[i], "--cycles") == 0) cycles = true;
+        else if(strcmp(argv[i], "--cycles-reset") == 0) cyclesReset = true;
+        else if(strcmp(argv[i], "--debounce") == 0) debounce = true;
+        else if(strcmp(argv[i], "--config") == 0) config = true;
+        else if((strcmp(argv[i], "--config-set") == 0) && ((i + 1) < argc) && (numOfConfigSets < MAX_CONFIG_SETS)) configSets[numOfConfigSets++] = argv[++i];
+        else if((strcmp(argv[i], "--trace-read") == 0) && ((i + 1) < argc)) tracePath = argv[++i];
+        else if((strcmp(argv[i], "--profile-start") == 0) && ((i + 1) < argc)) profileRate = argv[++i];
+        else if((strcmp(argv[i], "--profile-read") == 0) && ((i + 1) < argc)) profilePath = argv[++i];
+        else if((strcmp(argv[i], "--diff") == 0) && ((i + 2) < argc)) return Diff(argv[i + 1], argv[i + 2]);
+        else
+        {
+            fprintf(stderr, "Usage: %s --port DEVICE (--info | --image NEW.bin [--base OLD.bin] [--full] | --trace-start | --trace-read FILE | --time-sync | --cycles | --cycles-reset | --debounce | --config [--config-set NAME=VALUE]... | --profile-start RATE | --profile-read FILE) | --diff OLD.bin NEW.bin\n", argv[0]);
+            return 1;
+        }
+    }
+    if((portPath == NULL) || (!info && !traceStart && !timeSync && !cycles && !cyclesReset && !debounce && !config && (numOfConfigSets == 0U) && (tracePath == NULL) &&
+       (profileRate == NULL) && (profilePath == NULL) && (imagePath == NULL)))
+    {
+        fprintf(stderr, "Usage: %s --port DEVICE (--info | --image NEW.bin [--base OLD.bin] [--full] | --trace-start | --trace-read FILE | --time-sync | --cycles | --cycles-reset | --debounce | --config [--config-set NAME=VALUE]... | --profile-start RATE | --profile-read FILE) | --diff OLD.bin NEW.bin\n", argv[0]);
+        return 1;
+    }
+
+    SerialPort_t port = { OpenPort(portPath), { 0 }, 0U };
+    if(port.fd < 0) return 1;
+    UpdateTransport_t transport = { &port, SerialWrite, SerialReadLine, SerialSleep };
+    if(traceStart || (tracePath != NULL))
+    {
+        return TraceCommand(&transport, traceStart, tracePath);
+    }
+    if(timeSync)
+    {
+        return TimeSyncCommand(&transport);
+    }
+    if(cycles || cyclesReset)
+    {
+        return CyclesCommand(&transport, cyclesReset);
+    }
+    if(debounce)
+    {
+        return DebounceCommand(&transport);
+    }
+    if(config || (numOfConfigSets > 0U))
+    {
+        return ConfigCommand(&transport, configSets, numOfConfigSets);
+    }
+    if((profileRate != NULL) || (profilePath != NULL))
+    {
+        return ProfileCommand(&transport, profileRate, profilePath);
+    }
+
+    char state[32];
+    uint32_t attempts, runningSize;
+    uint8_t runningHash[HASH_SHA256_SIZE];
+    if(!UpdateProtocol_Info(&transport, state, sizeof(state), &attempts, &runningSize, runningHash))
+    {
+        fprintf(stderr, "No #INFO from the board\n");
+        return 1;
+    }
+    printf("board: %s, attempts %u, image %u bytes, ", state, (unsigned)attempts, (unsigned)runningSize);
+    PrintHash(runningHash);
+    printf("\n");
+    if(info) return 0;
+
+    uint32_t imageSize, baseSize = 0;
+    uint8_t *image = ReadFile(imagePath, &imageSize);
+    uint8_t *base = (basePath != NULL) ? ReadFile(basePath, &baseSize) : NULL;
+    if((image == NULL) || ((basePath != NULL) && (base == NULL))) return 1;
+
+    /* A delta only against the image the board really runs */
+    uint8_t baseHash[HASH_SHA256_SIZE];
+    bool delta = false;
+    if(!full && (base != NULL))
+    {
+        ImageHash(base, baseSize, baseHash);
+        delta = (baseSize == runningSize) && (memcmp(baseHash, runningHash, HASH_SHA256_SIZE) == 0);
+        if(!delta) printf("the board does not run %s - full image\n", basePath);
+    }
+
+    uint32_t maxPayload = imageSize * 2U + 64U;
+    uint8_t *payload = malloc(maxPayload);
+    uint32_t payloadSize = delta ? UpdateProtocol_EncodeDelta(base, baseSize, image, imageSize, payload, maxPayload)
+                                 : UpdateProtocol_EncodeFull(image, imageSize, payload, maxPayload);
+    if(delta && (payloadSize >= imageSize))
+    {
+        /* Nothing in common - the full image is smaller */
+        delta = false;
+        payloadSize = UpdateProtocol_EncodeFull(image, imageSize, payload, maxPayload);
+    }
+    printf("sending %s: image %u bytes, payload %u bytes\n", delta ? "delta" : "full image", (unsigned)imageSize, (unsigned)payloadSize);
+
+    UpdateSessionStats_t stats;
+    uint64_t start = NowMs();
+    bool ok = UpdateProtocol_Send(&transport, image, imageSize, payload, payloadSize, delta ? baseHash : NULL, &stats);
+    uint64_t elapsed = NowMs() - start;
+    if(!ok)
+    {
+        fprintf(stderr, "update failed: %s\n", stats.failure);
+        return 1;
+    }
+    printf("done in %.1fs: %u of %u sectors changed, %u frames (%u repeated), %u timeouts - the board reboots into the new image\n",
+           elapsed / 1000.0, (unsigned)stats.changedSectors, (unsigned)stats.sectors, (unsigned)stats.frames,
+           (unsigned)stats.repeatedFrames, (unsigned)stats.timeouts);
+    return 0;
+}
@@ -0,0 +1,377 @@
+/* GlareControl.c - the sun tracker of the glare control (SunTracker.c) against the full NOAA calculation, and the partial
+   positions it drives on the plant model (Plant/Plant.h) in the firmware built with GLARE_CONTROL_ENABLED.
+
+   Tracker - every minute of every day of a year at the home site, stepped like AutomaticControlTask does it (the base state
+   once a day, a rotation of the hour angle per minute), compared with the NOAA calculation of that exact minute (the
+   Julian century of the minute, not of the noon). Reported: the largest elevation/azimuth error with the sun up, the cost
+   of a minute against the full calculation (host ns) and the glare target of the window of channel 0 through some days.
+
+   Closed loop - every scenario boots a fresh firmware image (own process) with the plant model on channel 0 and runs a whole
+   day. Every minute the position of the model (travel from the top switch over the travel between the switches) is compared
+   with the target of the tracker while the schedule keeps the blind open. Reported: the timed and the limit switch moves,
+   the mean/95th percentile/largest error of the position, the minutes the blind was closed more than needed and less.
+
+   Usage: GlareControl
+   Exits with 1 if the tracker is off by more than MAX_TRACKER_ERROR_DEG, or a scenario misses its positions by more than
+   MAX_MEAN_ERROR on average or by more than GLARE_POSITION_STEP at the end, or the motor stalls. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "SunTracker.h"
+
+#include "Plant.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define YEAR                    (2026U)
+#define MAX_TRACKER_ERROR_DEG   (0.5)
+#define MAX_MEAN_ERROR          (GLARE_POSITION_STEP)
+#define TIMING_MINUTES          (1000000U)
+#define MINUTE_US               (60000000ULL)
+#define BOOT_SETTLE_US          (6000000ULL)
+#define LOOP_MINUTES            (24U * 60U)
+#define MAX_ERRORS              (LOOP_MINUTES)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    uint32_t timedMoves;            /* timed starts of the glare control */
+    uint32_t limitMoves;            /* top + bottom switch presses */
+    uint32_t glareMinutes;          /* minutes with a target above 0 while open */
+    uint32_t openMinutes;
+    uint32_t overMinutes;           /* closed more than GLARE_POSITION_STEP over the target */
+    uint32_t underMinutes;          /* less */
+    double meanError;
+    double p95Error;
+    double maxError;
+    double finalPosition;
+    double finalTarget;
+    double stalled_s;
+    uint8_t isClosed;
+}Result_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t month, day;
+}Scenario_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* High sun - the eave keeps it off the glass all day */
+    { "summer_day",  6, 21 },
+    /* The sun moves in the plane of the equator - about the same partial position all day */
+    { "equinox_day", 9, 23 },
+    /* Low sun - the blind goes down far, fully in the morning */
+    { "winter_day", 12, 21 },
+};
+
+static volatile float Sink;     /* keeps the timed loops */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static uint8_t Bcd(uint32_t value)
+{
+    return (uint8_t)(((value / 10U) << 4) | (value % 10U));
+}
+
+static int32_t UtcOffset(uint32_t year, uint32_t month, uint32_t day)
+{
+    return (TIME_ZONE_PLUS_TO_E - (isDST(Bcd(year - 2000U), Bcd(month), Bcd(day)) ? 0 : 1)) * 60;
+}
+
+/* NOAA calculation of the exact minute (the date numbering of CalculateSolarDay), no refraction like the tracker */
+static void Reference(uint32_t dayOfYear, int32_t utcOffset_min, int32_t minute, double *elevation_deg, double *azimuth_deg)
+{
+    double julianDay = (44927.0 + (double)dayOfYear) + 2415018.5 + (((double)minute - (double)utcOffset_min) / 1440.0);
+    double t = (julianDay - 2451545.0) / 36525.0;
+    double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+    double l = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360.0);
+    double m = 357.52911 + t * (35999.05029 - 0.0001537 * t);
+    double obliq = 23.0 + (26.0 + ((21.448 - t * (46.815 + t * (0.00059 - t * 0.001813)))) / 60.0) / 60.0;
+    obliq += 0.00256 * cos(degToRad(125.04 - 1934.136 * t));
+    double y = tan(degToRad(obliq / 2.0)) * tan(degToRad(obliq / 2.0));
+    double eqOfTime = 4.0 * radToDeg(y * sin(2.0 * degToRad(l)) - 2.0 * e * sin(degToRad(m)) + 4.0 * e * y * sin(degToRad(m)) * cos(2.0 * degToRad(l))
+                                     - 0.5 * y * y * sin(4.0 * degToRad(l)) - 1.25 * e * e * sin(2.0 * degToRad(m)));
+    double center = sin(degToRad(m)) * (1.914602 - t * (0.004817 + 0.000014 * t)) + sin(degToRad(2.0 * m)) * (0.019993 - 0.000101 * t)
+                    + sin(degToRad(3.0 * m)) * 0.000289;
+    double appLong = l + center - 0.00569 - 0.00478 * sin(degToRad(125.04 - 1934.136 * t));
+    double declination = asin(sin(degToRad(obliq)) * sin(degToRad(appLong)));
+
+    double trueSolar = (double)minute + eqOfTime + (4.0 * LONGITUDE_SIEROSZEWICE_NOWA_10) - (double)utcOffset_min;
+    double hourAngle = degToRad((trueSolar / 4.0) - 180.0);
+    double latitude = degToRad(LATITUDE_SIEROSZEWICE_NOWA_10);
+    double east = -cos(declination) * sin(hourAngle);
+    double north = (cos(latitude) * sin(declination)) - (sin(latitude) * cos(declination) * cos(hourAngle));
+    double up = (sin(latitude) * sin(declination)) + (cos(latitude) * cos(declination) * cos(hourAngle));
+    *elevation_deg = radToDeg(asin(up));
+    *azimuth_deg = radToDeg(atan2(east, north));
+    if(*azimuth_deg < 0.0) *azimuth_deg += 360.0;
+}
+
+static bool TrackerAccuracy(void)
+{
+    uint32_t daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    double maxElevation = 0.0, maxAzimuth = 0.0;
+    uint32_t dayOfYear = 0, worstDay = 0, seeks = 0, steps = 0;
+    SunTracker_t tracker;
+
+    for(uint32_t month = 1; month <= 12U; month++)
+    {
+        for(uint32_t day = 1; day <= daysInMonth[month]; day++)
+        {
+            dayOfYear++;
+            int32_t utcOffset_min = UtcOffset(YEAR, month, day);
+            SunTracker_BeginDay(&tracker, LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, dayOfYear, utcOffset_min);
+            for(int32_t minute = 0; minute < (int32_t)LOOP_MINUTES; minute++)
+            {
+                if(tracker.minute < 0) seeks++;
+                else steps++;
+                SunTracker_Advance(&tracker, minute);
+
+                double elevation, azimuth;
+                float trackerElevation, trackerAzimuth;
+                Reference(dayOfYear, utcOffset_min, minute, &elevation, &azimuth);
+                SunTracker_ElevationAzimuth(&tracker, &trackerElevation, &trackerAzimuth);
+                if(elevation <= 0.0) continue;
+                double azimuthError = fabs(azimuth - (double)trackerAzimuth);
+                if(azimuthError > 180.0) azimuthError = 360.0 - azimuthError;
+                if(fabs(elevation - (double)trackerElevation) > maxElevation)
+                {
+                    maxElevation = fabs(elevation - (double)trackerElevation);
+                    worstDay = dayOfYear;
+                }
+                if(azimuthError > maxAzimuth) maxAzimuth = azimuthError;
+            }
+        }
+    }
+    printf("tracker, every minute of %u with the sun up: largest error elevation %.3f deg (day %u), azimuth %.3f deg, %u steps, %u seeks\n",
+           (unsigned)YEAR, maxElevation, (unsigned)worstDay, maxAzimuth, (unsigned)steps, (unsigned)seeks);
+    return (maxElevation <= MAX_TRACKER_ERROR_DEG) && (maxAzimuth <= MAX_TRACKER_ERROR_DEG);
+}
+
+static void TrackerCost(void)
+{
+    SunTracker_t tracker;
+    double elevation = 0.0, azimuth = 0.0;
+    float target = 0.0f;
+
+    SunTracker_BeginDay(&tracker, LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, 172U, 120);
+    SunTracker_Seek(&tracker, 0);
+    double start = NowNs();
+    for(uint32_t i = 0; i < TIMING_MINUTES; i++)
+    {
+        SunTracker_Advance(&tracker, (int32_t)(i % LOOP_MINUTES));
+        target += SunTracker_GlarePosition(&tracker, 0U);
+    }
+    double minute_ns = (NowNs() - start) / TIMING_MINUTES;
+    Sink = target;
+
+    start = NowNs();
+    for(uint32_t i = 0; i < (TIMING_MINUTES / 10U); i++)
+    {
+        Reference(172U, 120, (int32_t)(i % LOOP_MINUTES), &elevation, &azimuth);
+    }
+    double reference_ns = (NowNs() - start) / (TIMING_MINUTES / 10U);
+    Sink = (float)(elevation + azimuth);
+
+    start = NowNs();
+    for(uint32_t i = 0; i < (TIMING_MINUTES / 10U); i++)
+    {
+        SunTracker_BeginDay(&tracker, LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, 1U + (i % 365U), 120);
+    }
+    double day_ns = (NowNs() - start) / (TIMING_MINUTES / 10U);
+    Sink = tracker.cosDecl;
+
+    printf("cost (host): a minute step + glare target %.1f ns, the full calculation of a minute %.1f ns (%.0fx), the base of a day %.1f ns\n",
+           minute_ns, reference_ns, reference_ns / minute_ns, day_ns);
+}
+
+static void TargetDays(void)
+{
+    static const uint32_t days[][2] = { {3, 21}, {6, 21}, {9, 23}, {12, 21} };
+    SunTracker_t tracker;
+
+    printf("\nglare target of channel 0 (azimuth %.0f, glass %.0f mm, eave %.0f mm at %.0f mm, sun %.0f mm into the room), %% closed:\n",
+           (double)SunTrackerWindows[0].azimuth_deg, (double)SunTrackerWindows[0].height_mm, (double)SunTrackerWindows[0].overhangDepth_mm,
+           (double)SunTrackerWindows[0].overhangGap_mm, (double)SunTrackerWindows[0].penetration_mm);
+    printf("%-6s", "date");
+    for(uint32_t hour = 6; hour <= 20U; hour += 2U) printf("  %02u:00", (unsigned)hour);
+    printf("  minutes\n");
+    for(uint32_t d = 0; d < sizeof(days) / sizeof(days[0]); d++)
+    {
+        uint32_t month = days[d][0], day = days[d][1];
+        uint32_t dayOfYear = CalculateDayOfYear(Bcd(YEAR - 2000U), Bcd(month), Bcd(day));
+        uint32_t glareMinutes = 0;
+        SunTracker_BeginDay(&tracker, LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, dayOfYear, UtcOffset(YEAR, month, day));
+        printf("%02u-%02u ", (unsigned)month, (unsigned)day);
+        for(int32_t minute = 0; minute < (int32_t)LOOP_MINUTES; minute++)
+        {
+            SunTracker_Advance(&tracker, minute);
+            float target = SunTracker_GlarePosition(&tracker, 0U);
+            if(target > 0.0f) glareMinutes++;
+            if(((minute % 120) == 0) && (minute >= 360) && (minute <= 1200)) printf("  %5.0f", (double)target * 100.0);
+        }
+        printf("  %7u\n", (unsigned)glareMinutes);
+    }
+}
+
+/* Whole day from 12:00 - the position of the model against the target of the tracker every minute */
+static void RunDay(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+    static double errors[MAX_ERRORS];
+    Plant_Params_t params;
+    Plant_t plant;
+    SunTracker_t tracker;
+    uint32_t numOfErrors = 0;
+    double errorSum = 0.0;
+
+    memset(result, 0, sizeof(*result));
+    Plant_DefaultParams(&params);
+    Plant_Init(&plant, &params, 0.02, 0U);
+    HostSim_RtcSetTime(YEAR, scenario->month, scenario->day, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    Plant_Attach(&plant, MOTOR_CONTROL_1, MOTOR_CONTROL_2, BUTTON_TOP_LIMIT, BUTTON_BOTTOM_LIMIT);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    tracker.dayOfYear = 0U;
+
+    uint32_t startsBefore = MotorChannelStarts[0];
+    uint32_t pressesBefore = plant.stats.topPresses + plant.stats.bottomPresses;
+    for(uint32_t m = 0; m < LOOP_MINUTES; m++)
+    {
+        HostSim_RunForUs(MINUTE_US);
+        (void)Plant_Advance(&plant, HostSim_NowUs());
+
+        uint32_t year = ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_YEARS), BCD_TO_DEC) + 2000U;
+        uint32_t month = ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_MONTHS), BCD_TO_DEC);
+        uint32_t day = ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_DAYS), BCD_TO_DEC);
+        int32_t minute = (ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_HOURS), BCD_TO_DEC) * 60) +
+                         ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_MINUTES), BCD_TO_DEC);
+        uint32_t dayOfYear = CalculateDayOfYear(Bcd(year - 2000U), Bcd(month), Bcd(day));
+        if(tracker.dayOfYear != dayOfYear)
+        {
+            SunTracker_BeginDay(&tracker, LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, dayOfYear, UtcOffset(year, month, day));
+        }
+        SunTracker_Advance(&tracker, minute);
+        if(HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED) != BLINDS_OPEN) continue;
+
+        /* Travel between the positions of the blind at the switches (just past them after the back-off) */
+        double position = (plant.position_m - params.topSwitch_m) / (params.bottomSwitch_m - params.topSwitch_m);
+        double target = (double)SunTracker_GlarePosition(&tracker, 0U);
+        if(target >= (double)GLARE_POSITION_CLOSED) target = 1.0;
+        else if(target < (double)GLARE_POSITION_STEP) target = 0.0;
+        double error = fabs(position - target);
+        result->finalPosition = position;
+        result->finalTarget = target;
+        result->openMinutes++;
+        if(target > 0.0) result->glareMinutes++;
+        if((position - target) > (double)GLARE_POSITION_STEP) result->overMinutes++;
+        if((target - position) > (double)GLARE_POSITION_STEP) result->underMinutes++;
+        errors[numOfErrors++] = error;
+        errorSum += error;
+        if(error > result->maxError) result->maxError = error;
+    }
+    (void)Plant_Advance(&plant, HostSim_NowUs());
+
+    /* Every start of the motor that is not a move to a switch (or the back-off from it) is a timed one */
+    result->limitMoves = (plant.stats.topPresses + plant.stats.bottomPresses) - pressesBefore;
+    result->timedMoves = (MotorChannelStarts[0] - startsBefore) - (2U * result->limitMoves);
+    result->meanError = (numOfErrors > 0U) ? (errorSum / numOfErrors) : 0.0;
+    for(uint32_t i = 1; i < numOfErrors; i++)
+    {
+        double value = errors[i];
+        uint32_t j = i;
+        for(; (j > 0U) && (errors[j - 1U] > value); j--) errors[j] = errors[j - 1U];
+        errors[j] = value;
+    }
+    result->p95Error = (numOfErrors > 0U) ? errors[(numOfErrors * 95U) / 100U] : 0.0;
+    result->stalled_s = (double)plant.stats.stalled_us / 1e6;
+    result->isClosed = HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED);
+}
+
+/* Full travel of the plant model at the supply voltage - what BLIND_TRAVEL_DOWN/UP_IN_MS should be for it */
+static void PlantTravel(void)
+{
+    Plant_Params_t params;
+    Plant_t plant;
+    double travel_s[2];
+
+    Plant_DefaultParams(&params);
+    for(uint32_t down = 0; down < 2U; down++)
+    {
+        Plant_Init(&plant, &params, down ? params.topSwitch_m : params.bottomSwitch_m, 0U);
+        Plant_SetBridge(&plant, down != 0U, down == 0U);
+        while(down ? (plant.position_m < params.bottomSwitch_m) : (plant.position_m > params.topSwitch_m))
+        {
+            Plant_Step(&plant);
+        }
+        travel_s[down] = (double)plant.time_us / 1e6;
+    }
+    printf("plant model between the switches: down %.1f s, up %.1f s (BLIND_TRAVEL_DOWN_IN_MS %u, BLIND_TRAVEL_UP_IN_MS %u)\n",
+           travel_s[1], travel_s[0], (unsigned)BLIND_TRAVEL_DOWN_IN_MS, (unsigned)BLIND_TRAVEL_UP_IN_MS);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    if(!TrackerAccuracy()) failures++;
+    TrackerCost();
+    TargetDays();
+
+    printf("\nClosed loop (firmware with GLARE_CONTROL_ENABLED in HostSim, plant model on channel 0, from 12:00 for a day)\n");
+    PlantTravel();
+    printf("%-12s %6s %6s %6s %6s %6s %6s %6s %6s %6s %7s %6s %6s  %s\n", "scenario", "timed", "limit", "open", "glare", "over", "under",
+           "mean", "p95", "max", "stall s", "end", "target", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(RunDay, scenario, &result, sizeof(result)))
+        {
+            printf("%-12s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        bool ok = (result.meanError <= (double)MAX_MEAN_ERROR) && (result.stalled_s == 0.0) && (result.isClosed == BLINDS_OPEN) &&
+                  (fabs(result.finalPosition - result.finalTarget) <= (double)GLARE_POSITION_STEP);
+        if(!ok) failures++;
+        printf("%-12s %6u %6u %6u %6u %6u %6u %6.3f %6.3f %6.3f %7.2f %6.3f %6.3f  %s\n", scenario->name, (unsigned)result.timedMoves,
+               (unsigned)result.limitMoves, (unsigned)result.openMinutes, (unsigned)result.glareMinutes, (unsigned)result.overMinutes,
+               (unsigned)result.underMinutes, result.meanError, result.p95Error, result.maxError, result.stalled_s,
+               result.finalPosition, result.finalTarget, ok ? "ok" : "FAILED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
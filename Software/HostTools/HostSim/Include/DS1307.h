@@ -0,0 +1,17 @@
+#ifndef HOSTSIM_DS1307_H
+#define HOSTSIM_DS1307_H
+
+/* HostSim replacement of the Pico_DS1307_HAL DS1307.h - backed by the RTC fake in HostSim_Rtc.c */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BCD_TO_DEC (0U)
+#define DEC_TO_BCD (1U)
+
+uint8_t ConvertBCD(uint8_t value, uint8_t conversionType);
+bool SetCurrentDate(const char* date, const char* time);
+bool Disable_DS1307_SquareWaveOutput(void);
+bool Enable_DS1307_Oscillator(void);
+
+#endif /* HOSTSIM_DS1307_H */
@@ -0,0 +1,39 @@
+#ifndef HOSTSIM_FREERTOS_H
+#define HOSTSIM_FREERTOS_H
+
+/* HostSim replacement of FreeRTOS.h - only the part of the kernel API the firmware uses.
+   Tasks run as coroutines in virtual time, see HostSim_Rtos.c */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define portBASE_TYPE   long
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+
+#define pdFALSE         ((BaseType_t)0)
+#define pdTRUE          ((BaseType_t)1)
+#define pdFAIL          (pdFALSE)
+#define pdPASS          (pdTRUE)
+
+#include "FreeRTOSConfig.h"
+
+#ifndef configMAX_TASK_NAME_LEN
+#define configMAX_TASK_NAME_LEN 16
+#endif
+
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+
+void HostSim_YieldFromIsr(BaseType_t xHigherPriorityTaskWoken);
+#define portYIELD_FROM_ISR(x)       HostSim_YieldFromIsr(x)
+#define portEND_SWITCHING_ISR(x)    HostSim_YieldFromIsr(x)
+
+size_t xPortGetFreeHeapSize(void);
+
+#endif /* HOSTSIM_FREERTOS_H */
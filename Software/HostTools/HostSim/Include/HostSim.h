@@ -0,0 +1,239 @@
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+/* HostSim - runs the unmodified firmware sources on a Linux host. The Pico SDK, FreeRTOS and DS1307 headers
+   in this directory replace the real ones, time is virtual (1 tick = 1us of target time) and the OS tasks run
+   as coroutines scheduled by priority. Nothing here is compiled into the target image. */
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*--------------- MACROS ---------------*/
+#define HOSTSIM_NUM_GPIOS           (30U)
+#define HOSTSIM_NUM_IRQS            (32U)
+#define HOSTSIM_MOTOR_LOG_LENGTH    (4096U)
+#define HOSTSIM_CLK_SYS_HZ          (125000000U)
+#define HOSTSIM_FLASH_SIZE          (2U * 1024U * 1024U)
+#define HOSTSIM_FLASH_ERASE_US      (45000U)     /* sector erase, typical */
+#define HOSTSIM_FLASH_PROGRAM_US    (400U)       /* page program, typical */
+#define HOSTSIM_USB_PACKET_SIZE     (64U)
+#define HOSTSIM_USB_RX_FIFO_SIZE    (256U)       /* stdio_usb buffer of the received characters */
+#define HOSTSIM_USB_LATENCY_US      (1000U)      /* board -> host, one USB frame */
+#define HOSTSIM_PLANT_AT_REST       (UINT64_MAX)
+
+/*--------------- DATA TYPES ---------------*/
+
+/* Per-IRQ dispatch statistics (ISR duration measured in host time) */
+typedef struct
+{
+    uint32_t entries;
+    uint64_t total_ns;
+    uint64_t max_ns;
+}HostSim_IsrStats_t;
+
+/* One change of the H-bridge outputs - MOTOR_CONTROL_1/MOTOR_CONTROL_2 of the first channel, and all the
+   logged outputs (HostSim_SetMotorLogMask) as a GPIO bitmask */
+typedef struct
+{
+    uint64_t time_us;
+    uint8_t motorControl1;
+    uint8_t motorControl2;
+    uint32_t outputs;
+}HostSim_MotorEvent_t;
+
+/* Hook called for every I2C register access of the DS1307 fake (used by trace tools) */
+typedef void (*HostSim_I2cHook_t)(bool write, uint8_t reg, uint8_t value);
+
+/* Replaces the DS1307 fake for the register reads it returns true for (used by the trace replay) */
+typedef bool (*HostSim_I2cReadSource_t)(uint8_t reg, uint8_t *value);
+
+/* What survives a chip reset - the virtual time, the outside world (input levels, the battery backed DS1307)
+   and the watchdog scratch registers */
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t inputLevels;
+    int64_t rtcSeconds;
+    uint8_t rtcRegisters[64];
+    uint32_t watchdogScratch[8];
+    bool watchdogReset;
+}HostSim_PersistentState_t;
+
+/* UART statistics - the bytes that left the shift register, the ones received and the ones lost to a full RX FIFO */
+typedef struct
+{
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t overruns;
+    uint64_t lastRx_us;                     /* virtual time the last byte was received */
+}HostSim_UartStats_t;
+
+/* Flash statistics - operations and the virtual time spent in them */
+typedef struct
+{
+    uint32_t erases;
+    uint32_t programs;
+    uint64_t busy_us;
+}HostSim_FlashStats_t;
+
+/* PIO statistics - the instructions the state machines ran, the RX FIFO pushes and the ones lost to a full FIFO, and the runs
+   after an input change */
+typedef struct
+{
+    uint64_t instructions;
+    uint64_t pushes;
+    uint64_t droppedPushes;
+    uint64_t settles;
+}HostSim_PioStats_t;
+
+/* Called when the chip resets (watchdog, power cut) - must not return. A tool boots the next firmware image in a fresh
+   process (the firmware globals start from zero again) and restores the state there with HostSim_RestoreState */
+typedef void (*HostSim_RebootHook_t)(const HostSim_PersistentState_t *state);
+
+/* A scenario run by HostSim_RunIsolated - fills the result (which holds what the caller put there, an input as well) */
+typedef void (*HostSim_IsolatedRun_t)(const void *context, void *result);
+
+/* Plant model (motor, gear case, blinds - see Plant/Plant.h) stepped along with the virtual time - advances the model to
+   now_us, drives the inputs it owns and returns the time it has to be called again (HOSTSIM_PLANT_AT_REST while nothing
+   moves - a change of the outputs calls it again right away) */
+typedef uint64_t (*HostSim_PlantHook_t)(uint64_t now_us);
+
+/*--------------- GLOBAL FUNCTION DECLARATIONS ---------------*/
+
+/* Boots the firmware (its main() up to vTaskStartScheduler) with the inputs set up beforehand */
+void HostSim_Boot(void);
+
+/* Runs the simulation (tasks, alarms, interrupts) until the given virtual time */
+void HostSim_RunUntilUs(uint64_t time_us);
+void HostSim_RunForUs(uint64_t duration_us);
+uint64_t HostSim_NowUs(void);
+
+/* Inputs/outputs of the simulated board */
+void HostSim_SetInput(uint32_t gpio, bool level);
+bool HostSim_GetPin(uint32_t gpio);
+uint32_t HostSim_GetGpioIrqMask(uint32_t gpio);
+bool HostSim_IsAlarmArmed(uint32_t alarmNum);
+
+/* Statistics */
+const HostSim_IsrStats_t* HostSim_GetIsrStats(uint32_t irqNum);
+void HostSim_ResetIsrStats(void);
+uint32_t HostSim_GetMotorLog(const HostSim_MotorEvent_t **log);
+void HostSim_SetMotorLogMask(uint32_t mask); /* GPIOs logged as motor outputs, MOTOR_CONTROL_1/2 by default */
+void HostSim_SetPlantHook(HostSim_PlantHook_t hook);
+
+/* ADC fake - input voltages as 12-bit ADC counts (input 0..3 = GPIO 26..29, 4 = temperature sensor) */
+void HostSim_SetAdcInput(uint32_t input, uint16_t value);
+uint64_t HostSim_GetAdcConversions(void);
+
+/* MPU6050 model on I2C1 - vibration (rms, on top of the sensor noise) of the gear case while the motor of the first
+   channel runs and while it is off, and the I2C transactions (register address writes) and data bytes it saw */
+void HostSim_SetVibration(double motorOn_mg, double motorOff_mg);
+uint64_t HostSim_GetMpu6050Transactions(void);
+uint64_t HostSim_GetMpu6050Bytes(void);
+uint64_t HostSim_GetMpu6050Overflows(void);
+
+/* PIO model (hardware/pio.h) - the programs of the firmware on an interpreter of the PIO instruction set, fed by the GPIO inputs */
+const HostSim_PioStats_t* HostSim_GetPioStats(void);
+
+/* Chip resets - the state to boot a fresh firmware image with (call before HostSim_Boot), and a task that hangs
+   (busy loop, e.g. in a driver call) the next time it would block at or after the given time - or stalls there for a while */
+void HostSim_SetRebootHook(HostSim_RebootHook_t hook);
+void HostSim_SaveState(HostSim_PersistentState_t *state);
+void HostSim_RestoreState(const HostSim_PersistentState_t *state);
+void HostSim_HangTask(const char *name, uint64_t time_us);
+void HostSim_StallTask(const char *name, uint64_t time_us, uint64_t duration_us);
+
+/* Every scenario runs in its own process - a fresh firmware image every time (forked from the harness, which never boots the
+   firmware itself). The result comes back when run returns, or from HostSim_IsolatedResult in that process (a reboot hook, the
+   end of a capture) which ends it there. False if the process died before it sent the whole result */
+bool HostSim_RunIsolated(HostSim_IsolatedRun_t run, const void *context, void *result, size_t size);
+void HostSim_IsolatedResult(const void *result);
+
+/* Preemption of the busy loops - a task busy-waiting (a blocking driver, a hang) gives the CPU to a higher priority task
+   that becomes ready, as the FreeRTOS scheduler does on the target. Off by default - the task runs until it blocks */
+void HostSim_SetPreemption(bool enabled);
+
+/* Code the CPU is in when an interrupt comes - task code takes no virtual time, so it is always a busy wait: the address its
+   caller returns to, relative to the load address of the executable (the value of a symbol in its ELF file). 0 while no busy
+   wait runs - the core idles. The profiler of the firmware (Profiler.c) samples it in place of the PC of the exception frame */
+uint32_t HostSim_InterruptedPc(void);
+
+/* Flash model - the memory is shared with the processes forked after its first use, so it survives the chip resets of a
+   tool that boots every image in a fresh process (the tool touches it before the first fork). A power cut after the given
+   number of erase/program operations leaves that operation half done and resets the chip (reboot hook, no watchdog) */
+uint8_t* HostSim_Flash(void);
+void HostSim_FlashLoad(uint32_t offset, const uint8_t *data, uint32_t length);
+void HostSim_SetFlashBinaryEnd(uint32_t offset);
+void HostSim_FlashPowerFailAfter(uint32_t operations);
+const HostSim_FlashStats_t* HostSim_GetFlashStats(void);
+
+/* USB CDC model - host -> board at the given rate in 64-byte packets (flow controlled by the stdio buffer of the board),
+   board -> host with one USB frame of latency. The latencies can be changed (a host with a slow USB stack or a hub) */
+void HostSim_UsbSetRate(uint32_t bytesPerSecond);
+void HostSim_UsbSetLatency(uint32_t hostToBoard_us, uint32_t boardToHost_us);
+void HostSim_UsbWrite(const uint8_t *data, uint32_t length);
+uint32_t HostSim_UsbRead(uint8_t *data, uint32_t maxLength);
+uint32_t HostSim_UsbPendingWrite(void);
+
+/* The next line of the board over the USB link (without the '\n', cut to the size) - the firmware runs until it came, false if
+   none came within the timeout. A response line (USB_LINK_RESPONSE_MARK, the mark dropped) skips the log lines before it */
+bool HostSim_UsbReadLine(char *line, uint32_t size, uint64_t timeout_us);
+bool HostSim_UsbReadResponse(char *line, uint32_t size, uint64_t timeout_us);
+
+/* UART model (hardware/uart.h) - the line of a UART is a file descriptor of the host (non-blocking, e.g. a pseudo-terminal
+   that links several simulated boards), -1 detaches it */
+void HostSim_UartAttach(uint32_t uart, int fd);
+const HostSim_UartStats_t* HostSim_GetUartStats(uint32_t uart);
+
+/* Real-time mode - from now on the virtual time follows CLOCK_MONOTONIC of the host (virtual us = (host ns - hostNsAtZero) / 1000)
+   and the simulation sleeps until its next event or a byte on an attached UART line. Processes that pass the same hostNsAtZero
+   share one time base. The virtual time never goes back - a simulation ahead of the host clock waits for it */
+void HostSim_SetRealTime(uint64_t hostNsAtZero);
+
+/* DS1307 fake - wall clock (local time) at virtual time 0 and direct access to its registers/RAM. The firmware reaches it through
+   the Pico_DS1307_HAL API and as a device on I2C0 (bursts). Drift of its oscillator in ppm (positive - fast) from now on, and
+   its exact time in us since 2000 (the time registers show the whole seconds of it) */
+void HostSim_RtcSetTime(uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second);
+void HostSim_RtcSetDrift(double ppm);
+int64_t HostSim_RtcTimeUs(void);
+uint8_t HostSim_RtcReadRegister(uint8_t reg);
+void HostSim_RtcWriteRegister(uint8_t reg, uint8_t value);
+void HostSim_SetI2cHook(HostSim_I2cHook_t hook);
+void HostSim_SetI2cReadSource(HostSim_I2cReadSource_t source);
+
+/* Internal interface between the HostSim modules */
+void HostSim_ServiceInterrupts(void);
+void HostSim_BusyWaitUs(uint64_t duration_us);
+void HostSim_OnTimeAdvanced(void);
+void HostSim_AdcUpdate(void);
+void HostSim_PioUpdate(void);
+void HostSim_Mpu6050Update(void);
+void HostSim_WatchdogUpdate(void);
+void HostSim_ChipReset(const HostSim_PersistentState_t *state);
+void HostSim_WatchdogSaveState(HostSim_PersistentState_t *state);
+void HostSim_WatchdogRestoreState(const HostSim_PersistentState_t *state);
+void HostSim_RtcSaveState(HostSim_PersistentState_t *state);
+void HostSim_RtcRestoreState(const HostSim_PersistentState_t *state);
+uint32_t HostSim_RtcI2cWrite(const uint8_t *src, uint32_t len);
+uint32_t HostSim_RtcI2cRead(uint8_t *dst, uint32_t len);
+uint64_t HostSim_RtosNextTickUs(void);
+bool HostSim_InterruptsMasked(void);
+uint64_t HostSim_UsbNextEventUs(void);
+void HostSim_UsbUpdate(void);
+void HostSim_RtosServiceTicks(void);
+uint64_t HostSim_NextAlarmUs(void);
+void HostSim_FireAlarms(void);
+void HostSim_RtosRunReadyTasks(void);
+uint64_t HostSim_RtosNextWakeUs(void);
+void HostSim_RtosPreempt(void);
+void HostSim_RtosWakeTasks(void);
+bool HostSim_DmaWrite(uint32_t dreq, uint32_t data);
+bool HostSim_DmaRead(uint32_t dreq, uint32_t *data);
+bool HostSim_DmaPending(uint32_t dreq);
+uint64_t HostSim_UartNextEventUs(void);
+void HostSim_UartUpdate(void);
+bool HostSim_UartWaitUs(uint64_t timeout_us);
+
+#endif /* HOSTSIM_H */
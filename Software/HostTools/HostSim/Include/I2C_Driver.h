@@ -0,0 +1,18 @@
+#ifndef HOSTSIM_I2C_DRIVER_H
+#define HOSTSIM_I2C_DRIVER_H
+
+/* HostSim replacement of the Pico_DS1307_HAL I2C_Driver.h - register accesses go to the RTC fake in HostSim_Rtc.c */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define I2C_STANDARD_MODE (100000U)
+#define I2C_FAST_MODE (400000U)
+
+void Reset_I2C0(void);
+void I2C_Initialize(uint32_t speed);
+bool setupPinsI2C0(void);
+uint8_t I2C_Register_Read(uint8_t reg);
+bool I2C_Register_Write(uint8_t reg, uint8_t data);
+
+#endif /* HOSTSIM_I2C_DRIVER_H */
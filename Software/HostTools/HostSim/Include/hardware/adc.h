@@ -0,0 +1,36 @@
+#ifndef HOSTSIM_HARDWARE_ADC_H
+#define HOSTSIM_HARDWARE_ADC_H
+
+/* HostSim replacement of hardware/adc.h - the ADC free-runs at the rate set by the clock divider (48MHz ADC clock),
+   the input voltages are set with HostSim_SetAdcInput and the samples go to the FIFO or a DMA channel paced by DREQ_ADC */
+
+#include "hardware/address_mapped.h"
+
+#define NUM_ADC_CHANNELS 5
+
+typedef struct
+{
+    io_rw_32 cs;
+    io_ro_32 result;
+    io_rw_32 fcs;
+    io_ro_32 fifo;
+    io_rw_32 div;
+    io_ro_32 intr;
+    io_rw_32 inte;
+    io_rw_32 intf;
+    io_ro_32 ints;
+}adc_hw_t;
+
+adc_hw_t* HostSim_AdcHw(void);
+#define adc_hw (HostSim_AdcHw())
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+void adc_set_round_robin(uint input_mask);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_set_clkdiv(float clkdiv);
+void adc_run(bool run);
+uint16_t adc_read(void);
+
+#endif /* HOSTSIM_HARDWARE_ADC_H */
@@ -0,0 +1,17 @@
+#ifndef HOSTSIM_HARDWARE_ADDRESS_MAPPED_H
+#define HOSTSIM_HARDWARE_ADDRESS_MAPPED_H
+
+/* HostSim replacement of hardware/address_mapped.h - the atomic set/clear aliases become plain read-modify-write */
+
+#include "pico/types.h"
+
+typedef volatile uint32_t io_rw_32;
+typedef volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+static inline void hw_set_bits(io_rw_32 *addr, uint32_t mask) { *addr |= mask; }
+static inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask) { *addr &= ~mask; }
+static inline void hw_xor_bits(io_rw_32 *addr, uint32_t mask) { *addr ^= mask; }
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t write_mask) { *addr = (*addr & ~write_mask) | (values & write_mask); }
+
+#endif /* HOSTSIM_HARDWARE_ADDRESS_MAPPED_H */
@@ -0,0 +1,58 @@
+#ifndef HOSTSIM_HARDWARE_DMA_H
+#define HOSTSIM_HARDWARE_DMA_H
+
+/* HostSim replacement of hardware/dma.h - only the transfers paced by a peripheral are simulated (DREQ_ADC - see hardware/adc.h,
+   DREQ_UARTn_TX/RX - see hardware/uart.h). The peripheral is the one of the DREQ, the address on its side is not used */
+
+#include <stdint.h>
+#include "hardware/address_mapped.h"
+
+#define NUM_DMA_CHANNELS 12
+#define DREQ_UART0_TX 20
+#define DREQ_UART0_RX 21
+#define DREQ_UART1_TX 22
+#define DREQ_UART1_RX 23
+#define DREQ_ADC 36
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct
+{
+    enum dma_channel_transfer_size size;
+    bool readIncrement;
+    bool writeIncrement;
+    bool ringWrite;
+    uint ringSizeBits;
+    uint dreq;
+}dma_channel_config;
+
+/* The registers of a channel as the firmware reads them - the addresses are pointers of the host */
+typedef struct
+{
+    volatile uintptr_t read_addr;
+    volatile uintptr_t write_addr;
+    io_rw_32 transfer_count;
+    io_rw_32 ctrl_trig;
+}dma_channel_hw_t;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_abort(uint channel);
+dma_channel_hw_t* dma_channel_hw_addr(uint channel);
+
+#endif /* HOSTSIM_HARDWARE_DMA_H */
@@ -0,0 +1,23 @@
+#ifndef HOSTSIM_HARDWARE_FLASH_H
+#define HOSTSIM_HARDWARE_FLASH_H
+
+/* HostSim replacement of hardware/flash.h - the 2MB QSPI flash as host memory (see HostSim_Flash.c). XIP_BASE is where
+   that memory is mapped, so the firmware reads the flash through it like through the XIP window */
+
+#include "pico/types.h"
+
+#define FLASH_PAGE_SIZE         (1u << 8)
+#define FLASH_SECTOR_SIZE       (1u << 12)
+#define PICO_FLASH_SIZE_BYTES   (2u * 1024u * 1024u)
+
+uint8_t* HostSim_Flash(void);
+char* HostSim_FlashBinaryEnd(void);
+#define XIP_BASE                ((uintptr_t)HostSim_Flash())
+
+/* Linker symbol of the image end - set by the tool (HostSim_SetFlashBinaryEnd) */
+#define __flash_binary_end      (*HostSim_FlashBinaryEnd())
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif /* HOSTSIM_HARDWARE_FLASH_H */
@@ -0,0 +1,71 @@
+#ifndef HOSTSIM_HARDWARE_GPIO_H
+#define HOSTSIM_HARDWARE_GPIO_H
+
+/* HostSim replacement of hardware/gpio.h - the IO_BANK0 interrupt registers follow the RP2040 layout
+   (4 event bits per GPIO, 8 GPIOs per register), edges are latched in HostSim */
+
+#include "hardware/address_mapped.h"
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+enum gpio_function
+{
+    GPIO_FUNC_XIP = 0,
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_GPCK = 8,
+    GPIO_FUNC_USB = 9,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+typedef struct
+{
+    io_rw_32 inte[4];
+    io_rw_32 intf[4];
+    io_ro_32 ints[4];
+}io_irq_ctrl_hw_t;
+
+typedef struct
+{
+    io_rw_32 intr[4];
+    io_irq_ctrl_hw_t proc0_irq_ctrl;
+    io_irq_ctrl_hw_t proc1_irq_ctrl;
+    io_irq_ctrl_hw_t dormant_wake_irq_ctrl;
+}iobank0_hw_t;
+
+iobank0_hw_t* HostSim_IoBank0Hw(void);
+#define iobank0_hw (HostSim_IoBank0Hw())
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+void gpio_set_irq_callback(gpio_irq_callback_t callback);
+void gpio_acknowledge_irq(uint gpio, uint32_t events);
+
+#endif /* HOSTSIM_HARDWARE_GPIO_H */
@@ -0,0 +1,27 @@
+#ifndef HOSTSIM_HARDWARE_I2C_H
+#define HOSTSIM_HARDWARE_I2C_H
+
+/* HostSim replacement of hardware/i2c.h - the SDK I2C driver with an MPU6050 model on I2C1 (see HostSim_Mpu6050.c).
+   A transfer busy-waits for its time on the bus (9 clocks per byte) */
+
+#include <stddef.h>
+#include "pico/types.h"
+#include "pico/error.h"
+
+typedef struct
+{
+    uint32_t index;
+    uint32_t baudrate;
+}i2c_inst_t;
+
+extern i2c_inst_t HostSim_I2c0, HostSim_I2c1;
+#define i2c0 (&HostSim_I2c0)
+#define i2c1 (&HostSim_I2c1)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us);
+
+#endif /* HOSTSIM_HARDWARE_I2C_H */
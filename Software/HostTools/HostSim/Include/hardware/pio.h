@@ -0,0 +1,76 @@
+#ifndef HOSTSIM_HARDWARE_PIO_H
+#define HOSTSIM_HARDWARE_PIO_H
+
+/* HostSim replacement of hardware/pio.h - the programs run on an interpreter of the PIO instruction set (HostSim_Pio.c).
+   A state machine runs at clk_sys, far faster than anything the simulation drives its pins with: it is run whenever an input
+   changes until it has settled on the new levels, and while the firmware waits for its RX FIFO. The inputs are the GPIO levels,
+   outputs (OUT/SET PINS, side-set), autopush/autopull, delays, IRQ flags and the TX FIFO are not modelled */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "hardware/pio_instructions.h"
+
+#define NUM_PIOS 2u
+#define NUM_PIO_STATE_MACHINES 4u
+#define PIO_INSTRUCTION_COUNT 32u
+
+enum pio_fifo_join
+{
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+typedef struct
+{
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;                          /* -1 - anywhere */
+}pio_program_t;
+
+typedef struct
+{
+    uint inBase;
+    uint jmpPin;
+    uint wrapTarget;
+    uint wrap;
+    bool inShiftRight;
+    bool outShiftRight;
+    uint pushThreshold;
+    enum pio_fifo_join join;
+    float clkdiv;
+}pio_sm_config;
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+
+pio_hw_t* HostSim_PioHw(uint index);
+#define pio0 (HostSim_PioHw(0u))
+#define pio1 (HostSim_PioHw(1u))
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin);
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+void sm_config_set_clkdiv(pio_sm_config *c, float div);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+
+#endif /* HOSTSIM_HARDWARE_PIO_H */
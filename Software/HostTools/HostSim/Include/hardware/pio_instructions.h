@@ -0,0 +1,69 @@
+#ifndef HOSTSIM_HARDWARE_PIO_INSTRUCTIONS_H
+#define HOSTSIM_HARDWARE_PIO_INSTRUCTIONS_H
+
+/* HostSim replacement of hardware/pio_instructions.h - the instruction encodings of the RP2040 datasheet (3.4), so a program
+   assembled with them at run time is the same 16-bit words on the target and in HostSim_Pio.c */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+/* The 3-bit source/destination field in the low bits, the rest only tells the names with the same field apart */
+enum pio_src_dest
+{
+    pio_pins = 0u,
+    pio_x = 1u,
+    pio_y = 2u,
+    pio_null = 3u,
+    pio_pindirs = 4u | 0x10u,
+    pio_exec_mov = 4u | 0x20u,
+    pio_status = 5u | 0x10u,
+    pio_pc = 5u | 0x20u,
+    pio_isr = 6u,
+    pio_osr = 7u | 0x10u,
+    pio_exec_out = 7u | 0x20u,
+};
+
+enum pio_instr_bits
+{
+    pio_instr_bits_jmp = 0x0000,
+    pio_instr_bits_wait = 0x2000,
+    pio_instr_bits_in = 0x4000,
+    pio_instr_bits_out = 0x6000,
+    pio_instr_bits_push = 0x8000,
+    pio_instr_bits_pull = 0x8080,
+    pio_instr_bits_mov = 0xa000,
+    pio_instr_bits_irq = 0xc000,
+    pio_instr_bits_set = 0xe000,
+};
+
+static inline uint pio_encode_instr_and_args(enum pio_instr_bits bits, uint arg1, uint arg2)
+{
+    return (uint)bits | ((arg1 & 7u) << 5) | (arg2 & 0x1fu);
+}
+
+static inline uint pio_encode_jmp(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 0u, addr); }
+static inline uint pio_encode_jmp_not_x(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 1u, addr); }
+static inline uint pio_encode_jmp_x_dec(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 2u, addr); }
+static inline uint pio_encode_jmp_not_y(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 3u, addr); }
+static inline uint pio_encode_jmp_y_dec(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 4u, addr); }
+static inline uint pio_encode_jmp_x_ne_y(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 5u, addr); }
+static inline uint pio_encode_jmp_pin(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 6u, addr); }
+static inline uint pio_encode_jmp_not_osre(uint addr) { return pio_encode_instr_and_args(pio_instr_bits_jmp, 7u, addr); }
+
+static inline uint pio_encode_wait_gpio(bool polarity, uint gpio) { return pio_encode_instr_and_args(pio_instr_bits_wait, polarity ? 4u : 0u, gpio); }
+static inline uint pio_encode_wait_pin(bool polarity, uint pin) { return pio_encode_instr_and_args(pio_instr_bits_wait, polarity ? 5u : 1u, pin); }
+
+static inline uint pio_encode_in(enum pio_src_dest src, uint count) { return pio_encode_instr_and_args(pio_instr_bits_in, (uint)src, count); }
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) { return pio_encode_instr_and_args(pio_instr_bits_out, (uint)dest, count); }
+static inline uint pio_encode_push(bool if_full, bool block) { return (uint)pio_instr_bits_push | (if_full ? 0x40u : 0u) | (block ? 0x20u : 0u); }
+static inline uint pio_encode_pull(bool if_empty, bool block) { return (uint)pio_instr_bits_pull | (if_empty ? 0x40u : 0u) | (block ? 0x20u : 0u); }
+
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) { return pio_encode_instr_and_args(pio_instr_bits_mov, (uint)dest, (uint)src & 7u); }
+static inline uint pio_encode_mov_not(enum pio_src_dest dest, enum pio_src_dest src) { return pio_encode_instr_and_args(pio_instr_bits_mov, (uint)dest, (1u << 3) | ((uint)src & 7u)); }
+static inline uint pio_encode_mov_reverse(enum pio_src_dest dest, enum pio_src_dest src) { return pio_encode_instr_and_args(pio_instr_bits_mov, (uint)dest, (2u << 3) | ((uint)src & 7u)); }
+
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) { return pio_encode_instr_and_args(pio_instr_bits_set, (uint)dest, value); }
+static inline uint pio_encode_nop(void) { return pio_encode_mov(pio_y, pio_y); }
+
+#endif /* HOSTSIM_HARDWARE_PIO_INSTRUCTIONS_H */
@@ -0,0 +1,19 @@
+#ifndef HOSTSIM_HARDWARE_STRUCTS_SYSTICK_H
+#define HOSTSIM_HARDWARE_STRUCTS_SYSTICK_H
+
+/* HostSim replacement of hardware/structs/systick.h - CVR counts down at clk_sys derived from the host clock */
+
+#include "hardware/address_mapped.h"
+
+typedef struct
+{
+    io_rw_32 csr;
+    io_rw_32 rvr;
+    io_rw_32 cvr;
+    io_ro_32 calib;
+}systick_hw_t;
+
+systick_hw_t* HostSim_SysTickHw(void);
+#define systick_hw (HostSim_SysTickHw())
+
+#endif /* HOSTSIM_HARDWARE_STRUCTS_SYSTICK_H */
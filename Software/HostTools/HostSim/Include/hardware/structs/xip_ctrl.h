@@ -0,0 +1,23 @@
+#ifndef HOSTSIM_HARDWARE_STRUCTS_XIP_CTRL_H
+#define HOSTSIM_HARDWARE_STRUCTS_XIP_CTRL_H
+
+/* HostSim replacement of hardware/structs/xip_ctrl.h - the simulation has no flash cache, the counters stay as written */
+
+#include "hardware/address_mapped.h"
+
+typedef struct
+{
+    io_rw_32 ctrl;
+    io_rw_32 flush;
+    io_ro_32 stat;
+    io_rw_32 ctr_hit;
+    io_rw_32 ctr_acc;
+    io_rw_32 stream_addr;
+    io_rw_32 stream_ctr;
+    io_ro_32 stream_fifo;
+}xip_ctrl_hw_t;
+
+extern xip_ctrl_hw_t HostSim_XipCtrlRegs;
+#define xip_ctrl_hw (&HostSim_XipCtrlRegs)
+
+#endif /* HOSTSIM_HARDWARE_STRUCTS_XIP_CTRL_H */
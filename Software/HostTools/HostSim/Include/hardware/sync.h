@@ -0,0 +1,26 @@
+#ifndef HOSTSIM_HARDWARE_SYNC_H
+#define HOSTSIM_HARDWARE_SYNC_H
+
+/* HostSim replacement of hardware/sync.h */
+
+#include "hardware/address_mapped.h"
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+/* One simulated core - a spin lock only masks the interrupts */
+typedef volatile uint32_t spin_lock_t;
+static inline spin_lock_t *spin_lock_instance(uint lock_num) { static spin_lock_t locks[32]; return &locks[lock_num % 32U]; }
+static inline int spin_lock_claim_unused(bool required) { static int next; (void)required; return next++; }
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) { (void)lock; return save_and_disable_interrupts(); }
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) { (void)lock; restore_interrupts(saved_irq); }
+
+static inline void __dmb(void) { __sync_synchronize(); }
+static inline void __dsb(void) { __sync_synchronize(); }
+static inline void __isb(void) { __sync_synchronize(); }
+static inline void __compiler_memory_barrier(void) { __asm__ volatile ("" : : : "memory"); }
+static inline void __wfi(void) { }
+static inline void __wfe(void) { }
+static inline void __sev(void) { }
+
+#endif /* HOSTSIM_HARDWARE_SYNC_H */
@@ -0,0 +1,42 @@
+#ifndef HOSTSIM_HARDWARE_TIMER_H
+#define HOSTSIM_HARDWARE_TIMER_H
+
+/* HostSim replacement of hardware/timer.h - the register block follows the RP2040 TIMER layout.
+   Every access through timer_hw synchronises the registers with the virtual time first, 
+   a write to alarm[n] arms that alarm like on the real hardware */
+
+#include "hardware/address_mapped.h"
+
+#define NUM_TIMERS 4
+
+typedef struct
+{
+    io_wo_32 timehw;
+    io_wo_32 timelw;
+    io_ro_32 timehr;
+    io_ro_32 timelr;
+    io_rw_32 alarm[NUM_TIMERS];
+    io_rw_32 armed;
+    io_ro_32 timerawh;
+    io_ro_32 timerawl;
+    io_rw_32 dbgpause;
+    io_rw_32 pause;
+    io_rw_32 intr;
+    io_rw_32 inte;
+    io_rw_32 intf;
+    io_ro_32 ints;
+}timer_hw_t;
+
+timer_hw_t* HostSim_TimerHw(void);
+#define timer_hw (HostSim_TimerHw())
+
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+
+/* Claims of the alarms like the SDK - claiming one twice ends the process (a panic on the target) */
+void hardware_alarm_claim(uint alarm_num);
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_unclaim(uint alarm_num);
+bool hardware_alarm_is_claimed(uint alarm_num);
+
+#endif /* HOSTSIM_HARDWARE_TIMER_H */
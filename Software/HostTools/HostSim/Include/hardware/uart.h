@@ -0,0 +1,52 @@
+#ifndef HOSTSIM_HARDWARE_UART_H
+#define HOSTSIM_HARDWARE_UART_H
+
+/* HostSim replacement of hardware/uart.h - 8N1 only, a byte leaves the shift register 10 bit times after it started, the
+   FIFOs are 32 bytes deep and served by the DMA (DREQ_UARTn_TX/RX). The line is a file descriptor of the host (a pseudo-terminal,
+   HostSim_UartAttach) - the bytes are written to it as they leave the shift register, the ones read from it go to the RX FIFO */
+
+#include "pico/types.h"
+#include "hardware/address_mapped.h"
+
+#define UART_UARTFR_BUSY_BITS 0x00000008u
+#define UART_UARTFR_RXFE_BITS 0x00000010u
+#define UART_UARTFR_TXFF_BITS 0x00000020u
+#define UART_UARTFR_RXFF_BITS 0x00000040u
+#define UART_UARTFR_TXFE_BITS 0x00000080u
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+}uart_parity_t;
+
+typedef struct
+{
+    io_rw_32 dr;
+    io_rw_32 rsr;
+    uint32_t _pad0[4];
+    io_ro_32 fr;
+}uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t HostSim_Uart0, HostSim_Uart1;
+#define uart0 (&HostSim_Uart0)
+#define uart1 (&HostSim_Uart1)
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_deinit(uart_inst_t *uart);
+uint uart_get_index(uart_inst_t *uart);
+uart_hw_t* uart_get_hw(uart_inst_t *uart);
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+bool uart_is_writable(uart_inst_t *uart);
+bool uart_is_readable(uart_inst_t *uart);
+void uart_putc_raw(uart_inst_t *uart, char c);
+char uart_getc(uart_inst_t *uart);
+void uart_tx_wait_blocking(uart_inst_t *uart);
+
+#endif /* HOSTSIM_HARDWARE_UART_H */
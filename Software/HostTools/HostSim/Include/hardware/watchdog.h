@@ -0,0 +1,26 @@
+#ifndef HOSTSIM_HARDWARE_WATCHDOG_H
+#define HOSTSIM_HARDWARE_WATCHDOG_H
+
+/* HostSim replacement of hardware/watchdog.h - the watchdog counts down in virtual time, when it is not fed in time
+   the chip reset is handed to the reboot hook of the tool (HostSim_SetRebootHook) with the scratch registers kept */
+
+#include "hardware/address_mapped.h"
+
+typedef struct
+{
+    io_rw_32 ctrl;
+    io_wo_32 load;
+    io_ro_32 reason;
+    io_rw_32 scratch[8];
+    io_ro_32 tick;
+}watchdog_hw_t;
+
+watchdog_hw_t* HostSim_WatchdogHw(void);
+#define watchdog_hw (HostSim_WatchdogHw())
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void watchdog_update(void);
+bool watchdog_caused_reboot(void);
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+
+#endif /* HOSTSIM_HARDWARE_WATCHDOG_H */
@@ -0,0 +1,8 @@
+#ifndef HOSTSIM_PICO_BINARY_INFO_H
+#define HOSTSIM_PICO_BINARY_INFO_H
+
+/* HostSim replacement of pico/binary_info.h - binary info is only meaningful in the target image */
+
+#define bi_decl(...)
+
+#endif /* HOSTSIM_PICO_BINARY_INFO_H */
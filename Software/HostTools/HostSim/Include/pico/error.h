@@ -0,0 +1,18 @@
+#ifndef HOSTSIM_PICO_ERROR_H
+#define HOSTSIM_PICO_ERROR_H
+
+/* HostSim replacement of pico/error.h - same values as the SDK */
+
+enum pico_error_codes
+{
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3,
+    PICO_ERROR_NOT_PERMITTED = -4,
+    PICO_ERROR_INVALID_ARG = -5,
+    PICO_ERROR_IO = -6,
+};
+
+#endif /* HOSTSIM_PICO_ERROR_H */
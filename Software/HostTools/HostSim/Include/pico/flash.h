@@ -0,0 +1,11 @@
+#ifndef HOSTSIM_PICO_FLASH_H
+#define HOSTSIM_PICO_FLASH_H
+
+/* HostSim replacement of pico/flash.h - there is no other core to park, the function runs with the interrupts disabled */
+
+#include "pico/types.h"
+#include "pico/error.h"
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#endif /* HOSTSIM_PICO_FLASH_H */
@@ -0,0 +1,16 @@
+#ifndef HOSTSIM_PICO_PLATFORM_H
+#define HOSTSIM_PICO_PLATFORM_H
+
+/* HostSim replacement of pico/platform.h - the simulation runs everything on core 0 */
+
+#include "pico/types.h"
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) __attribute__((noinline)) func_name
+
+static inline uint get_core_num(void) { return 0U; }
+static inline void tight_loop_contents(void) { }
+
+#endif /* HOSTSIM_PICO_PLATFORM_H */
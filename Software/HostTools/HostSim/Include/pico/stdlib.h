@@ -0,0 +1,31 @@
+#ifndef HOSTSIM_PICO_STDLIB_H
+#define HOSTSIM_PICO_STDLIB_H
+
+/* HostSim replacement of pico/stdlib.h */
+
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/platform.h"
+#include "pico/error.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+
+#define PICO_DEFAULT_LED_PIN 25
+
+bool stdio_init_all(void);
+
+/* stdio over the USB CDC model (HostSim_Usb.c) - what the firmware writes is readable by the tool with HostSim_UsbRead,
+   what the tool writes with HostSim_UsbWrite arrives in 64-byte USB packets */
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+void stdio_flush(void);
+void stdio_set_chars_available_callback(void (*fn)(void*), void *param);
+
+/* Sleeps busy-wait in virtual time (interrupts still fire, no other task runs) */
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void busy_wait_us_32(uint32_t delay_us);
+
+#endif /* HOSTSIM_PICO_STDLIB_H */
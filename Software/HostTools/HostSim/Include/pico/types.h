@@ -0,0 +1,12 @@
+#ifndef HOSTSIM_PICO_TYPES_H
+#define HOSTSIM_PICO_TYPES_H
+
+/* HostSim replacement of pico/types.h */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#endif /* HOSTSIM_PICO_TYPES_H */
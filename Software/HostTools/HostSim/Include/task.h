@@ -0,0 +1,36 @@
+#ifndef HOSTSIM_TASK_H
+#define HOSTSIM_TASK_H
+
+/* HostSim replacement of task.h */
+
+#include "FreeRTOS.h"
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+
+typedef struct HostSim_Task* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, configSTACK_DEPTH_TYPE usStackDepth, 
+                       void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask);
+void vTaskStartScheduler(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement);
+BaseType_t xTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(const TaskHandle_t xTask);
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority);
+char* pcTaskGetName(TaskHandle_t xTaskToQuery);
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+
+void HostSim_EnterCritical(void);
+void HostSim_ExitCritical(void);
+#define taskENTER_CRITICAL()        HostSim_EnterCritical()
+#define taskEXIT_CRITICAL()         HostSim_ExitCritical()
+#define taskDISABLE_INTERRUPTS()    HostSim_EnterCritical()
+#define taskENABLE_INTERRUPTS()     HostSim_ExitCritical()
+#define taskYIELD()                 vTaskDelay(0)
+
+#endif /* HOSTSIM_TASK_H */
@@ -0,0 +1,783 @@
+/* HostSim.c - virtual time, GPIO, TIMER and interrupt controller of the simulated RP2040 */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#define _GNU_SOURCE                         /* dl_iterate_phdr */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <link.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+
+/* FreeRTOS replacement includes (tick rate) */
+#include "FreeRTOS.h"
+
+/* Firmware includes (pin mapping) */
+#include "ElectronicBlinds_Main.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+
+/* An interrupt handler which does not clear its source would keep the simulation in the same instant forever */
+#define MAX_ISR_ENTRIES_PER_INSTANT (100000U)
+
+#define NO_ALARM (UINT64_MAX)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static uint64_t Now_us;
+
+timer_hw_t HostSim_TimerRegs;
+systick_hw_t HostSim_SysTickRegs;
+xip_ctrl_hw_t HostSim_XipCtrlRegs;
+static uint32_t AlarmShadow[NUM_TIMERS];
+static uint64_t AlarmTarget_us[NUM_TIMERS];
+static uint32_t AlarmsClaimed;
+
+iobank0_hw_t HostSim_IoBank0Regs;
+static uint32_t LatchedEdges[4];
+static uint32_t InputLevels, OutputLevels, OutputEnable;
+static gpio_irq_callback_t GpioCallback;
+
+static irq_handler_t IrqHandlers[HOSTSIM_NUM_IRQS];
+static uint8_t IrqPriorities[HOSTSIM_NUM_IRQS];
+static uint32_t IrqEnabled, IrqForced;
+static bool PrimaskSet, InIsr;
+static uint32_t CriticalNesting;
+
+static HostSim_IsrStats_t IsrStats[HOSTSIM_NUM_IRQS];
+
+static HostSim_MotorEvent_t MotorLog[HOSTSIM_MOTOR_LOG_LENGTH];
+static uint32_t MotorLogLength;
+static uint32_t MotorLogMask = (1u << MOTOR_CONTROL_1) | (1u << MOTOR_CONTROL_2);
+
+static HostSim_PlantHook_t PlantHook;
+static uint64_t PlantNext_us = HOSTSIM_PLANT_AT_REST;
+static bool InPlantHook, PlantOutputsChanged;
+
+static uintptr_t BusyWaitCaller;           /* 0 - no busy wait in progress */
+static uintptr_t LoadBias;
+
+static bool RealTime;
+static uint64_t RealTimeZero_ns;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint64_t HostNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/* Real-time mode - the next event once the host clock reached it, earlier when a byte came in on a UART line */
+static uint64_t RealTimePace(uint64_t next)
+{
+    if(!RealTime)
+    {
+        return next;
+    }
+    for( ;; )
+    {
+        int64_t host_us = (int64_t)(HostNs() - RealTimeZero_ns) / 1000;
+        if(host_us >= (int64_t)next)
+        {
+            return next;
+        }
+        if(HostSim_UartWaitUs(next - (uint64_t)((host_us > 0) ? host_us : 0)))
+        {
+            host_us = (int64_t)(HostNs() - RealTimeZero_ns) / 1000;
+            return (host_us < (int64_t)next) ? ((host_us > (int64_t)Now_us) ? (uint64_t)host_us : Now_us) : next;
+        }
+    }
+}
+
+static int FindLoadBias(struct dl_phdr_info *info, size_t size, void *data)
+{
+    /* The executable comes first - its load address (0 unless it is position independent) */
+    (void)size;
+    *(uintptr_t *)data = (uintptr_t)info->dlpi_addr;
+    return 1;
+}
+
+static void SyncTimerWrites(void)
+{
+    /* A write to ALARMn arms the alarm - it fires when the lower 32 bits of the timer match */
+    for(uint32_t n = 0; n < NUM_TIMERS; n++)
+    {
+        if(HostSim_TimerRegs.alarm[n] != AlarmShadow[n])
+        {
+            uint32_t delta = HostSim_TimerRegs.alarm[n] - (uint32_t)Now_us;
+            AlarmShadow[n] = HostSim_TimerRegs.alarm[n];
+            AlarmTarget_us[n] = Now_us + ((delta == 0U) ? (1ULL << 32) : delta);
+            HostSim_TimerRegs.armed |= (1u << n);
+        }
+    }
+}
+
+static void UpdateGpioLevelStatus(void)
+{
+    /* INTR is write-1-to-clear - a value written by the firmware acknowledges those edges.
+       Reading INTR always returns 0 in the simulation, the interrupt state is visible through INTS */
+    for(uint32_t reg = 0; reg < 4U; reg++)
+    {
+        LatchedEdges[reg] &= ~(HostSim_IoBank0Regs.intr[reg] & 0xCCCCCCCCu);
+        HostSim_IoBank0Regs.intr[reg] = 0U;
+    }
+
+    /* Level bits always follow the pin, edge bits are latched until acknowledged */
+    uint32_t levels = gpio_get_all();
+    for(uint32_t reg = 0; reg < 4U; reg++)
+    {
+        uint32_t value = LatchedEdges[reg];
+        for(uint32_t i = 0; i < 8U; i++)
+        {
+            uint32_t gpio = (reg * 8U) + i;
+            if(gpio >= HOSTSIM_NUM_GPIOS) break;
+            value |= (((levels >> gpio) & 1u) ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW) << (4U * i);
+        }
+        HostSim_IoBank0Regs.proc0_irq_ctrl.ints[reg] = (value & HostSim_IoBank0Regs.proc0_irq_ctrl.inte[reg]) | HostSim_IoBank0Regs.proc0_irq_ctrl.intf[reg];
+    }
+}
+
+static void LatchEdge(uint32_t gpio, bool newLevel)
+{
+    uint32_t edge = newLevel ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    LatchedEdges[gpio / 8U] |= edge << (4U * (gpio % 8U));
+}
+
+static void GpioDefaultIrqHandler(void)
+{
+    /* Same dispatch as the SDK's gpio_default_irq_handler */
+    for(uint32_t gpio = 0; gpio < HOSTSIM_NUM_GPIOS; gpio += 8U)
+    {
+        UpdateGpioLevelStatus();
+        uint32_t events8 = HostSim_IoBank0Regs.proc0_irq_ctrl.ints[gpio >> 3u];
+        for(uint32_t i = gpio; (events8 != 0U) && (i < gpio + 8U); i++)
+        {
+            uint32_t events = events8 & 0xFu;
+            if(events)
+            {
+                gpio_acknowledge_irq(i, events);
+                if(GpioCallback != NULL)
+                {
+                    GpioCallback(i, events);
+                }
+            }
+            events8 >>= 4;
+        }
+    }
+}
+
+static bool IrqPending(uint32_t num)
+{
+    if((IrqForced >> num) & 1u)
+    {
+        return true;
+    }
+    if(num <= TIMER_IRQ_3)
+    {
+        return (((HostSim_TimerRegs.intr | HostSim_TimerRegs.intf) & HostSim_TimerRegs.inte) >> num) & 1u;
+    }
+    if(num == IO_IRQ_BANK0)
+    {
+        UpdateGpioLevelStatus();
+        for(uint32_t reg = 0; reg < 4U; reg++)
+        {
+            if(HostSim_IoBank0Regs.proc0_irq_ctrl.ints[reg] != 0U) return true;
+        }
+    }
+    return false;
+}
+
+static void RecordMotorOutputs(void)
+{
+    uint8_t m1 = (OutputLevels >> MOTOR_CONTROL_1) & 1u;
+    uint8_t m2 = (OutputLevels >> MOTOR_CONTROL_2) & 1u;
+    uint32_t outputs = OutputLevels & MotorLogMask;
+
+    /* Changes within the same instant (e.g. the two gpio_put calls of a direction change) are one event */
+    if((MotorLogLength > 0U) && (MotorLog[MotorLogLength - 1U].time_us == Now_us))
+    {
+        MotorLogLength--;
+    }
+    if((MotorLogLength > 0U) && (MotorLog[MotorLogLength - 1U].outputs == outputs))
+    {
+        return;
+    }
+    if(MotorLogLength < HOSTSIM_MOTOR_LOG_LENGTH)
+    {
+        MotorLog[MotorLogLength].time_us = Now_us;
+        MotorLog[MotorLogLength].motorControl1 = m1;
+        MotorLog[MotorLogLength].motorControl2 = m2;
+        MotorLog[MotorLogLength].outputs = outputs;
+        MotorLogLength++;
+    }
+}
+
+static void OutputsChanged(void)
+{
+    /* The plant sees the new H-bridge state in the same instant */
+    if(InPlantHook)
+    {
+        PlantOutputsChanged = true;
+    }
+    else if(PlantHook != NULL)
+    {
+        PlantNext_us = Now_us;
+    }
+}
+
+static void PlantUpdate(void)
+{
+    if((PlantHook != NULL) && (PlantNext_us <= Now_us) && !InPlantHook)
+    {
+        /* The inputs the plant drives may run interrupt handlers which switch the motor - the plant is called again then */
+        InPlantHook = true;
+        do
+        {
+            PlantOutputsChanged = false;
+            PlantNext_us = PlantHook(Now_us);
+        }while(PlantOutputsChanged);
+        InPlantHook = false;
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- Interrupt controller ---- */
+
+void HostSim_ServiceInterrupts(void)
+{
+    uint32_t entriesThisInstant = 0;
+
+    if(InIsr || PrimaskSet || (CriticalNesting > 0U))
+    {
+        return;
+    }
+
+    for(;;)
+    {
+        SyncTimerWrites();
+
+        /* Highest priority (lowest value) first, lowest IRQ number among equal priorities - same as the NVIC */
+        int32_t selected = -1;
+        for(uint32_t num = 0; num < HOSTSIM_NUM_IRQS; num++)
+        {
+            if(((IrqEnabled >> num) & 1u) && (IrqHandlers[num] != NULL) && IrqPending(num))
+            {
+                if((selected < 0) || (IrqPriorities[num] < IrqPriorities[selected]))
+                {
+                    selected = (int32_t)num;
+                }
+            }
+        }
+        if(selected < 0)
+        {
+            break;
+        }
+
+        if(++entriesThisInstant > MAX_ISR_ENTRIES_PER_INSTANT)
+        {
+            fprintf(stderr, "HostSim: IRQ %d keeps firing without its source being cleared\n", selected);
+            abort();
+        }
+
+        IrqForced &= ~(1u << selected);
+        InIsr = true;
+        uint64_t start = HostNs();
+        IrqHandlers[selected]();
+        uint64_t duration = HostNs() - start;
+        InIsr = false;
+
+        IsrStats[selected].entries++;
+        IsrStats[selected].total_ns += duration;
+        if(duration > IsrStats[selected].max_ns) IsrStats[selected].max_ns = duration;
+    }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    IrqHandlers[num] = handler;
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num)
+{
+    return IrqHandlers[num];
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if(enabled) IrqEnabled |= (1u << num); else IrqEnabled &= ~(1u << num);
+    HostSim_ServiceInterrupts();
+}
+
+bool irq_is_enabled(uint num)
+{
+    return (IrqEnabled >> num) & 1u;
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority)
+{
+    IrqPriorities[num] = hardware_priority;
+}
+
+void irq_set_pending(uint num)
+{
+    IrqForced |= (1u << num);
+    HostSim_ServiceInterrupts();
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    uint32_t status = PrimaskSet ? 1U : 0U;
+    PrimaskSet = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    PrimaskSet = (status != 0U);
+    HostSim_ServiceInterrupts();
+}
+
+bool HostSim_InterruptsMasked(void)
+{
+    return PrimaskSet || (CriticalNesting > 0U);
+}
+
+void HostSim_EnterCritical(void)
+{
+    CriticalNesting++;
+}
+
+void HostSim_ExitCritical(void)
+{
+    if(CriticalNesting > 0U) CriticalNesting--;
+    HostSim_ServiceInterrupts();
+}
+
+const HostSim_IsrStats_t* HostSim_GetIsrStats(uint32_t irqNum)
+{
+    return &IsrStats[irqNum];
+}
+
+void HostSim_ResetIsrStats(void)
+{
+    memset(IsrStats, 0, sizeof(IsrStats));
+}
+
+/* ---- Timer ---- */
+
+systick_hw_t* HostSim_SysTickHw(void)
+{
+    /* SysTick counts down at clk_sys (125 MHz) - the simulation derives it from the host clock */
+    if(HostSim_SysTickRegs.rvr == 0U)
+    {
+        HostSim_SysTickRegs.rvr = (HOSTSIM_CLK_SYS_HZ / configTICK_RATE_HZ) - 1U;
+    }
+    uint64_t cycles = (HostNs() * (HOSTSIM_CLK_SYS_HZ / 1000000U)) / 1000U;
+    HostSim_SysTickRegs.cvr = HostSim_SysTickRegs.rvr - (uint32_t)(cycles % (HostSim_SysTickRegs.rvr + 1U));
+    return &HostSim_SysTickRegs;
+}
+
+timer_hw_t* HostSim_TimerHw(void)
+{
+    SyncTimerWrites();
+    HostSim_TimerRegs.timerawl = (uint32_t)Now_us;
+    HostSim_TimerRegs.timerawh = (uint32_t)(Now_us >> 32);
+    HostSim_TimerRegs.timelr = (uint32_t)Now_us;
+    HostSim_TimerRegs.timehr = (uint32_t)(Now_us >> 32);
+    HostSim_TimerRegs.ints = HostSim_TimerRegs.intr & HostSim_TimerRegs.inte;
+    return &HostSim_TimerRegs;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)Now_us;
+}
+
+uint64_t time_us_64(void)
+{
+    return Now_us;
+}
+
+void hardware_alarm_claim(uint alarm_num)
+{
+    if(hardware_alarm_is_claimed(alarm_num))
+    {
+        fprintf(stderr, "HostSim: hardware alarm %u already claimed\n", alarm_num);
+        abort();
+    }
+    AlarmsClaimed |= (1u << alarm_num);
+}
+
+int hardware_alarm_claim_unused(bool required)
+{
+    for(uint n = 0; n < NUM_TIMERS; n++)
+    {
+        if(!hardware_alarm_is_claimed(n))
+        {
+            AlarmsClaimed |= (1u << n);
+            return (int)n;
+        }
+    }
+    if(required)
+    {
+        fprintf(stderr, "HostSim: no hardware alarm left\n");
+        abort();
+    }
+    return -1;
+}
+
+void hardware_alarm_unclaim(uint alarm_num)
+{
+    AlarmsClaimed &= ~(1u << alarm_num);
+}
+
+bool hardware_alarm_is_claimed(uint alarm_num)
+{
+    return (AlarmsClaimed >> alarm_num) & 1u;
+}
+
+uint64_t HostSim_NextAlarmUs(void)
+{
+    uint64_t next = NO_ALARM;
+    SyncTimerWrites();
+    for(uint32_t n = 0; n < NUM_TIMERS; n++)
+    {
+        if(((HostSim_TimerRegs.armed >> n) & 1u) && (AlarmTarget_us[n] < next))
+        {
+            next = AlarmTarget_us[n];
+        }
+    }
+    return next;
+}
+
+void HostSim_FireAlarms(void)
+{
+    SyncTimerWrites();
+    for(uint32_t n = 0; n < NUM_TIMERS; n++)
+    {
+        if(((HostSim_TimerRegs.armed >> n) & 1u) && (AlarmTarget_us[n] <= Now_us))
+        {
+            HostSim_TimerRegs.armed &= ~(1u << n);
+            HostSim_TimerRegs.intr |= (1u << n);
+        }
+    }
+    HostSim_ServiceInterrupts();
+}
+
+bool HostSim_IsAlarmArmed(uint32_t alarmNum)
+{
+    SyncTimerWrites();
+    return (HostSim_TimerRegs.armed >> alarmNum) & 1u;
+}
+
+/* ---- Virtual time ---- */
+
+uint64_t HostSim_NowUs(void)
+{
+    return Now_us;
+}
+
+void HostSim_BusyWaitUs(uint64_t duration_us)
+{
+    uint64_t target = Now_us + duration_us;
+    uintptr_t outerCaller = BusyWaitCaller;
+    BusyWaitCaller = (uintptr_t)__builtin_return_address(0);
+    while(Now_us < target)
+    {
+        /* The tick interrupt keeps coming while a task busy-waits */
+        uint64_t next = HostSim_NextAlarmUs();
+        uint64_t tick = HostSim_RtosNextTickUs();
+        uint64_t usb = HostSim_UsbNextEventUs();
+        uint64_t uart = HostSim_UartNextEventUs();
+        if(tick < next) next = tick;
+        if(usb < next) next = usb;
+        if(uart < next) next = uart;
+        if(PlantNext_us < next) next = PlantNext_us;
+        next = RealTimePace((next < target) ? next : target);
+        Now_us = (next > Now_us) ? next : Now_us;
+        HostSim_OnTimeAdvanced();
+        HostSim_AdcUpdate();
+        HostSim_Mpu6050Update();
+        HostSim_WatchdogUpdate();
+        PlantUpdate();
+        HostSim_UsbUpdate();
+        HostSim_UartUpdate();
+        HostSim_FireAlarms();
+        HostSim_RtosServiceTicks();
+        if(!InIsr && !HostSim_InterruptsMasked())
+        {
+            HostSim_RtosPreempt();
+        }
+    }
+    BusyWaitCaller = outerCaller;
+}
+
+uint32_t HostSim_InterruptedPc(void)
+{
+    if(BusyWaitCaller == 0U)
+    {
+        return 0U;
+    }
+    if(LoadBias == 0U)
+    {
+        (void)dl_iterate_phdr(FindLoadBias, &LoadBias);
+    }
+    return (uint32_t)(BusyWaitCaller - LoadBias);
+}
+
+void HostSim_RunUntilUs(uint64_t time_us)
+{
+    HostSim_RtosRunReadyTasks();
+    while(Now_us < time_us)
+    {
+        uint64_t next = time_us;
+        uint64_t alarm = HostSim_NextAlarmUs();
+        uint64_t wake = HostSim_RtosNextWakeUs();
+        uint64_t usb = HostSim_UsbNextEventUs();
+        uint64_t uart = HostSim_UartNextEventUs();
+        if(alarm < next) next = alarm;
+        if(wake < next) next = wake;
+        if(usb < next) next = usb;
+        if(uart < next) next = uart;
+        if(PlantNext_us < next) next = PlantNext_us;
+        next = RealTimePace(next);
+        if(next > Now_us)
+        {
+            Now_us = next;
+            HostSim_OnTimeAdvanced();
+            HostSim_AdcUpdate();
+            HostSim_Mpu6050Update();
+            HostSim_WatchdogUpdate();
+        }
+        PlantUpdate();
+        HostSim_UsbUpdate();
+        HostSim_UartUpdate();
+        HostSim_FireAlarms();
+        HostSim_RtosWakeTasks();
+        HostSim_RtosRunReadyTasks();
+    }
+}
+
+void HostSim_RunForUs(uint64_t duration_us)
+{
+    HostSim_RunUntilUs(Now_us + duration_us);
+}
+
+void HostSim_SetRealTime(uint64_t hostNsAtZero)
+{
+    RealTime = true;
+    RealTimeZero_ns = hostNsAtZero;
+}
+
+void __attribute__((weak)) HostSim_OnTimeAdvanced(void)
+{
+    /* Hook for tools which follow every advance of the virtual time */
+}
+
+void HostSim_SetPlantHook(HostSim_PlantHook_t hook)
+{
+    PlantHook = hook;
+    PlantNext_us = (hook != NULL) ? Now_us : HOSTSIM_PLANT_AT_REST;
+}
+
+void sleep_ms(uint32_t ms)
+{
+    HostSim_BusyWaitUs((uint64_t)ms * 1000U);
+}
+
+void sleep_us(uint64_t us)
+{
+    HostSim_BusyWaitUs(us);
+}
+
+void busy_wait_us_32(uint32_t delay_us)
+{
+    HostSim_BusyWaitUs(delay_us);
+}
+
+
+/* ---- Chip reset ---- */
+
+void HostSim_SaveState(HostSim_PersistentState_t *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->time_us = Now_us;
+    state->inputLevels = InputLevels;
+    HostSim_RtcSaveState(state);
+    HostSim_WatchdogSaveState(state);
+}
+
+void HostSim_RestoreState(const HostSim_PersistentState_t *state)
+{
+    Now_us = state->time_us;
+    InputLevels = state->inputLevels;
+    HostSim_RtcRestoreState(state);
+    HostSim_WatchdogRestoreState(state);
+}
+
+/* ---- GPIO ---- */
+
+void HostSim_SetInput(uint32_t gpio, bool level)
+{
+    bool oldLevel = (InputLevels >> gpio) & 1u;
+    if(oldLevel != level)
+    {
+        if(level) InputLevels |= (1u << gpio); else InputLevels &= ~(1u << gpio);
+        if(!((OutputEnable >> gpio) & 1u))
+        {
+            LatchEdge(gpio, level);
+            HostSim_PioUpdate();
+            HostSim_ServiceInterrupts();
+        }
+    }
+}
+
+bool HostSim_GetPin(uint32_t gpio)
+{
+    return (gpio_get_all() >> gpio) & 1u;
+}
+
+iobank0_hw_t* HostSim_IoBank0Hw(void)
+{
+    UpdateGpioLevelStatus();
+    return &HostSim_IoBank0Regs;
+}
+
+uint32_t HostSim_GetGpioIrqMask(uint32_t gpio)
+{
+    return (HostSim_IoBank0Regs.proc0_irq_ctrl.inte[gpio / 8U] >> (4U * (gpio % 8U))) & 0xFu;
+}
+
+void HostSim_SetMotorLogMask(uint32_t mask)
+{
+    MotorLogMask = mask;
+}
+
+uint32_t HostSim_GetMotorLog(const HostSim_MotorEvent_t **log)
+{
+    *log = MotorLog;
+    return MotorLogLength;
+}
+
+void gpio_init(uint gpio)
+{
+    OutputEnable &= ~(1u << gpio);
+    OutputLevels &= ~(1u << gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    if(out) OutputEnable |= (1u << gpio); else OutputEnable &= ~(1u << gpio);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+    (void)gpio;
+    (void)up;
+    (void)down;
+}
+
+void gpio_pull_up(uint gpio)
+{
+    gpio_set_pulls(gpio, true, false);
+}
+
+void gpio_pull_down(uint gpio)
+{
+    gpio_set_pulls(gpio, false, true);
+}
+
+void gpio_disable_pulls(uint gpio)
+{
+    gpio_set_pulls(gpio, false, false);
+}
+
+uint32_t gpio_get_all(void)
+{
+    return (InputLevels & ~OutputEnable) | (OutputLevels & OutputEnable);
+}
+
+bool gpio_get(uint gpio)
+{
+    return (gpio_get_all() >> gpio) & 1u;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    uint32_t oldLevels = OutputLevels;
+    if(value) OutputLevels |= (1u << gpio); else OutputLevels &= ~(1u << gpio);
+    if(OutputLevels != oldLevels)
+    {
+        OutputsChanged();
+    }
+    if(MotorLogMask & (1u << gpio))
+    {
+        RecordMotorOutputs();
+    }
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value)
+{
+    uint32_t oldLevels = OutputLevels;
+    OutputLevels = (OutputLevels & ~mask) | (value & mask);
+    if(OutputLevels != oldLevels)
+    {
+        OutputsChanged();
+    }
+    if(mask & MotorLogMask)
+    {
+        RecordMotorOutputs();
+    }
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t events)
+{
+    /* Only the edge events are latched */
+    LatchedEdges[gpio / 8U] &= ~((events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)) << (4U * (gpio % 8U)));
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    /* Like the SDK - clear stale events which might cause immediate spurious handler entry */
+    gpio_acknowledge_irq(gpio, events);
+
+    io_rw_32 *en_reg = &HostSim_IoBank0Regs.proc0_irq_ctrl.inte[gpio / 8U];
+    events <<= 4U * (gpio % 8U);
+    if(enabled) hw_set_bits(en_reg, events); else hw_clear_bits(en_reg, events);
+
+    HostSim_ServiceInterrupts();
+}
+
+void gpio_set_irq_callback(gpio_irq_callback_t callback)
+{
+    GpioCallback = callback;
+    IrqHandlers[IO_IRQ_BANK0] = GpioDefaultIrqHandler;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    gpio_set_irq_enabled(gpio, events, enabled);
+    gpio_set_irq_callback(callback);
+    if(enabled) irq_set_enabled(IO_IRQ_BANK0, true);
+}
@@ -0,0 +1,134 @@
+/* HostSim_Adc.c - ADC model of the host simulation (free-running ADC, the samples to the FIFO or the DMA - HostSim_Dma.c) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define ADC_CLOCK_HZ            (48000000.0)
+#define ADC_CONVERSION_CYCLES   (96.0)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static adc_hw_t HostSim_AdcRegs;
+static uint16_t AdcInputs[NUM_ADC_CHANNELS];
+static uint32_t AdcInput, AdcRoundRobinMask;
+static bool AdcRunning, AdcDreqEnabled;
+static double AdcClkdiv;
+static double NextConversion_us;
+static uint64_t AdcConversions;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double ConversionPeriodUs(void)
+{
+    /* A conversion takes 96 ADC clocks, the divider only slows the free-running mode down (RP2040 datasheet, ADC DIV) */
+    double cycles = (AdcClkdiv + 1.0 > ADC_CONVERSION_CYCLES) ? AdcClkdiv + 1.0 : ADC_CONVERSION_CYCLES;
+    return cycles * 1000000.0 / ADC_CLOCK_HZ;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_SetAdcInput(uint32_t input, uint16_t value)
+{
+    AdcInputs[input] = value & 0xFFFu;
+}
+
+uint64_t HostSim_GetAdcConversions(void)
+{
+    return AdcConversions;
+}
+
+void HostSim_AdcUpdate(void)
+{
+    double now_us = (double)HostSim_NowUs();
+    while(AdcRunning && (NextConversion_us <= now_us))
+    {
+        uint16_t sample = AdcInputs[AdcInput];
+        HostSim_AdcRegs.result = sample;
+        AdcConversions++;
+        if(AdcDreqEnabled) (void)HostSim_DmaWrite(DREQ_ADC, sample);
+
+        /* Round-robin - the next input in the mask */
+        if(AdcRoundRobinMask != 0U)
+        {
+            do
+            {
+                AdcInput = (AdcInput + 1U) % NUM_ADC_CHANNELS;
+            }while(((AdcRoundRobinMask >> AdcInput) & 1u) == 0U);
+        }
+        NextConversion_us += ConversionPeriodUs();
+    }
+}
+
+/* ---- ADC ---- */
+
+adc_hw_t* HostSim_AdcHw(void)
+{
+    HostSim_AdcRegs.fifo = HostSim_AdcRegs.result;
+    return &HostSim_AdcRegs;
+}
+
+void adc_init(void)
+{
+    memset(&HostSim_AdcRegs, 0, sizeof(HostSim_AdcRegs));
+    AdcRunning = false;
+    AdcRoundRobinMask = 0;
+}
+
+void adc_gpio_init(uint gpio)
+{
+    (void)gpio;
+}
+
+void adc_select_input(uint input)
+{
+    AdcInput = input;
+}
+
+void adc_set_round_robin(uint input_mask)
+{
+    AdcRoundRobinMask = input_mask;
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+    (void)en;
+    (void)dreq_thresh;
+    (void)err_in_fifo;
+    (void)byte_shift;
+    AdcDreqEnabled = dreq_en;
+}
+
+void adc_set_clkdiv(float clkdiv)
+{
+    AdcClkdiv = clkdiv;
+}
+
+void adc_run(bool run)
+{
+    if(run && !AdcRunning)
+    {
+        NextConversion_us = (double)HostSim_NowUs() + ConversionPeriodUs();
+    }
+    AdcRunning = run;
+}
+
+/* A single conversion on demand (the supply monitor of PowerMonitor.c) */
+uint16_t adc_read(void)
+{
+    AdcConversions++;
+    return AdcInputs[AdcInput];
+}
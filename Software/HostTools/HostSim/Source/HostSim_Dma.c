@@ -0,0 +1,211 @@
+/* HostSim_Dma.c - DMA model of the host simulation: the transfers paced by the DREQ of a peripheral (ADC, UART) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define CTRL_TRIG_BUSY          (1u << 24)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    bool claimed;
+    bool busy;
+    dma_channel_config config;
+    uintptr_t readAddress;
+    uintptr_t writeAddress;
+    uint32_t transCount;
+}DmaChannel_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static DmaChannel_t DmaChannels[NUM_DMA_CHANNELS];
+static dma_channel_hw_t DmaChannelRegs[NUM_DMA_CHANNELS];
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* The first busy channel paced by the DREQ - the one the hardware would serve */
+static DmaChannel_t* DmaChannelOf(uint32_t dreq)
+{
+    for(uint32_t channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        if(DmaChannels[channel].busy && (DmaChannels[channel].config.dreq == dreq))
+        {
+            return &DmaChannels[channel];
+        }
+    }
+    return NULL;
+}
+
+/* Only the low ring bits of the address change - wraps inside the aligned buffer */
+static uintptr_t NextAddress(const DmaChannel_t *dma, uintptr_t address, bool ring)
+{
+    uintptr_t next = address + (1u << dma->config.size);
+    if(ring && (dma->config.ringSizeBits > 0U))
+    {
+        uintptr_t ringMask = ((uintptr_t)1 << dma->config.ringSizeBits) - 1U;
+        next = (address & ~ringMask) | (next & ringMask);
+    }
+    return next;
+}
+
+static void TransferDone(DmaChannel_t *dma)
+{
+    if(--dma->transCount == 0U)
+    {
+        dma->busy = false;
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+bool HostSim_DmaWrite(uint32_t dreq, uint32_t data)
+{
+    DmaChannel_t *dma = DmaChannelOf(dreq);
+    if(dma == NULL)
+    {
+        return false;
+    }
+
+    memcpy((void*)dma->writeAddress, &data, 1u << dma->config.size);
+    if(dma->config.writeIncrement)
+    {
+        dma->writeAddress = NextAddress(dma, dma->writeAddress, dma->config.ringWrite);
+    }
+    TransferDone(dma);
+    return true;
+}
+
+bool HostSim_DmaRead(uint32_t dreq, uint32_t *data)
+{
+    DmaChannel_t *dma = DmaChannelOf(dreq);
+    if(dma == NULL)
+    {
+        return false;
+    }
+
+    *data = 0;
+    memcpy(data, (const void*)dma->readAddress, 1u << dma->config.size);
+    if(dma->config.readIncrement)
+    {
+        dma->readAddress = NextAddress(dma, dma->readAddress, !dma->config.ringWrite);
+    }
+    TransferDone(dma);
+    return true;
+}
+
+bool HostSim_DmaPending(uint32_t dreq)
+{
+    return DmaChannelOf(dreq) != NULL;
+}
+
+/* ---- DMA ---- */
+
+int dma_claim_unused_channel(bool required)
+{
+    for(uint32_t channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        if(!DmaChannels[channel].claimed)
+        {
+            DmaChannels[channel].claimed = true;
+            return (int)channel;
+        }
+    }
+    if(required)
+    {
+        fprintf(stderr, "HostSim: no free DMA channel\n");
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    DmaChannels[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    (void)channel;
+    dma_channel_config config = { DMA_SIZE_32, true, false, false, 0U, 0x3fU };
+    return config;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->readIncrement = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->writeIncrement = incr;
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{
+    c->ringWrite = write;
+    c->ringSizeBits = size_bits;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    DmaChannels[channel].config = *config;
+    DmaChannels[channel].readAddress = (uintptr_t)read_addr;
+    DmaChannels[channel].writeAddress = (uintptr_t)write_addr;
+    DmaChannels[channel].transCount = transfer_count;
+    DmaChannels[channel].busy = trigger && (transfer_count > 0U);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger)
+{
+    DmaChannels[channel].readAddress = (uintptr_t)read_addr;
+    if(trigger) DmaChannels[channel].busy = (DmaChannels[channel].transCount > 0U);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger)
+{
+    DmaChannels[channel].transCount = trans_count;
+    if(trigger) DmaChannels[channel].busy = (trans_count > 0U);
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    return DmaChannels[channel].busy;
+}
+
+void dma_channel_abort(uint channel)
+{
+    DmaChannels[channel].busy = false;
+}
+
+dma_channel_hw_t* dma_channel_hw_addr(uint channel)
+{
+    dma_channel_hw_t *regs = &DmaChannelRegs[channel];
+    regs->read_addr = DmaChannels[channel].readAddress;
+    regs->write_addr = DmaChannels[channel].writeAddress;
+    regs->transfer_count = DmaChannels[channel].transCount;
+    regs->ctrl_trig = DmaChannels[channel].busy ? CTRL_TRIG_BUSY : 0U;
+    return regs;
+}
@@ -0,0 +1,161 @@
+/* HostSim_Flash.c - QSPI flash model of the host simulation (NOR semantics, erase/program times, power cuts) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define NO_POWER_FAIL (UINT32_MAX)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static uint8_t *Flash;
+static uint32_t FlashBinaryEnd;
+static uint32_t PowerFailAfter = NO_POWER_FAIL;
+static HostSim_FlashStats_t FlashStats;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void CheckRange(uint32_t offset, size_t count, uint32_t alignment)
+{
+    if(((offset % alignment) != 0U) || ((count % alignment) != 0U) || (offset > HOSTSIM_FLASH_SIZE) || (count > (HOSTSIM_FLASH_SIZE - offset)))
+    {
+        fprintf(stderr, "HostSim: flash operation at 0x%06x (%zu bytes) not aligned to %u or out of range\n", (unsigned)offset, count, (unsigned)alignment);
+        abort();
+    }
+}
+
+/* Every erase/program operation counts - the one the power cut hits is left half done */
+static bool PowerCut(void)
+{
+    if(PowerFailAfter == NO_POWER_FAIL)
+    {
+        return false;
+    }
+    if(PowerFailAfter > 0U)
+    {
+        PowerFailAfter--;
+        return false;
+    }
+    return true;
+}
+
+static void PowerFail(void)
+{
+    HostSim_PersistentState_t state;
+
+    PowerFailAfter = NO_POWER_FAIL;
+    HostSim_SaveState(&state);
+    state.watchdogReset = false;
+    HostSim_ChipReset(&state);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+uint8_t* HostSim_Flash(void)
+{
+    if(Flash == NULL)
+    {
+        /* Shared - the flash content survives the reset into the next process forked from the same parent */
+        Flash = mmap(NULL, HOSTSIM_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(Flash == MAP_FAILED)
+        {
+            perror("HostSim: mmap");
+            abort();
+        }
+        memset(Flash, 0xFF, HOSTSIM_FLASH_SIZE);
+    }
+    return Flash;
+}
+
+void HostSim_FlashLoad(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    /* Like the debug probe - erased sectors, then the data */
+    uint32_t start = offset - (offset % FLASH_SECTOR_SIZE);
+    uint32_t end = ((offset + length + FLASH_SECTOR_SIZE - 1U) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+    memset(&HostSim_Flash()[start], 0xFF, end - start);
+    memcpy(&HostSim_Flash()[offset], data, length);
+}
+
+char* HostSim_FlashBinaryEnd(void)
+{
+    return (char*)&HostSim_Flash()[FlashBinaryEnd];
+}
+
+void HostSim_SetFlashBinaryEnd(uint32_t offset)
+{
+    FlashBinaryEnd = offset;
+}
+
+void HostSim_FlashPowerFailAfter(uint32_t operations)
+{
+    PowerFailAfter = operations;
+}
+
+const HostSim_FlashStats_t* HostSim_GetFlashStats(void)
+{
+    return &FlashStats;
+}
+
+/* ---- Flash ---- */
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    CheckRange(flash_offs, count, FLASH_SECTOR_SIZE);
+    for(uint32_t sector = 0; sector < count; sector += FLASH_SECTOR_SIZE)
+    {
+        bool cut = PowerCut();
+        HostSim_BusyWaitUs(cut ? (HOSTSIM_FLASH_ERASE_US / 2U) : HOSTSIM_FLASH_ERASE_US);
+        memset(&HostSim_Flash()[flash_offs + sector], 0xFF, cut ? (FLASH_SECTOR_SIZE / 2U) : FLASH_SECTOR_SIZE);
+        if(cut) PowerFail();
+        FlashStats.erases++;
+        FlashStats.busy_us += HOSTSIM_FLASH_ERASE_US;
+    }
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    CheckRange(flash_offs, count, FLASH_PAGE_SIZE);
+    if((data >= HostSim_Flash()) && (data < (HostSim_Flash() + HOSTSIM_FLASH_SIZE)))
+    {
+        /* The XIP window is not readable while the flash is programmed */
+        fprintf(stderr, "HostSim: flash programmed from the flash itself (offset 0x%06x)\n", (unsigned)(data - HostSim_Flash()));
+        abort();
+    }
+    for(uint32_t page = 0; page < count; page += FLASH_PAGE_SIZE)
+    {
+        bool cut = PowerCut();
+        HostSim_BusyWaitUs(cut ? (HOSTSIM_FLASH_PROGRAM_US / 2U) : HOSTSIM_FLASH_PROGRAM_US);
+        /* NOR flash - programming only clears bits */
+        for(uint32_t i = 0; i < (cut ? (FLASH_PAGE_SIZE / 2U) : FLASH_PAGE_SIZE); i++)
+        {
+            HostSim_Flash()[flash_offs + page + i] &= data[page + i];
+        }
+        if(cut) PowerFail();
+        FlashStats.programs++;
+        FlashStats.busy_us += HOSTSIM_FLASH_PROGRAM_US;
+    }
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+{
+    (void)enter_exit_timeout_ms;
+    uint32_t status = save_and_disable_interrupts();
+    func(param);
+    restore_interrupts(status);
+    return PICO_OK;
+}
@@ -0,0 +1,281 @@
+/* HostSim_Mpu6050.c - SDK I2C driver and the MPU6050 model of the host simulation (accelerometer samples into the FIFO),
+   the DS1307 on I2C0 is the fake of HostSim_Rtc.c */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+#include "HostSim.h"
+
+/* Firmware includes - the register map and the pins of the motor the sensor sits on */
+#include "ElectronicBlinds_Main.h"
+#include "MotionSensor.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MPU_NUM_OF_REGISTERS        (128U)
+#define MPU_PWR_MGMT_1_SLEEP        (0x40U)
+#define MPU_LSB_PER_MG              (16.384)    /* +-2g full scale */
+#define MPU_NOISE_MG                (2.0)       /* sensor noise (rms) - the gear case standing still */
+#define I2C_CLOCKS_PER_BYTE         (9U)
+#define DS1307_I2C_ADDRESS          (0x68U)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+i2c_inst_t HostSim_I2c0 = { 0U, 0U }, HostSim_I2c1 = { 1U, 0U };
+
+static uint8_t MpuRegisters[MPU_NUM_OF_REGISTERS];
+static uint8_t MpuPointer;
+static uint8_t MpuFifo[MPU6050_FIFO_SIZE];
+static uint32_t MpuFifoHead, MpuFifoCount;
+static uint64_t MpuNextSample_us;
+static bool MpuSampling;
+static uint32_t MpuRandom = 0x2545F491u;
+static double VibrationMotorOn_mg, VibrationMotorOff_mg;
+static uint64_t MpuTransactions, MpuBytes, MpuSamples, MpuOverflows;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void MpuReset(void)
+{
+    memset(MpuRegisters, 0, sizeof(MpuRegisters));
+    MpuRegisters[MPU6050_REG_PWR_MGMT_1] = MPU_PWR_MGMT_1_SLEEP;
+    MpuRegisters[MPU6050_REG_WHO_AM_I] = MPU6050_WHO_AM_I_VALUE;
+    MpuFifoHead = 0;
+    MpuFifoCount = 0;
+}
+
+static uint64_t MpuSamplePeriodUs(void)
+{
+    /* Gyroscope output rate 8kHz with the DLPF off, 1kHz with it on, divided by 1 + SMPLRT_DIV */
+    uint32_t dlpf = MpuRegisters[MPU6050_REG_CONFIG] & 0x07U;
+    uint32_t rate_hz = ((dlpf == 0U) || (dlpf == 7U)) ? 8000U : 1000U;
+    return (1000000ULL * (1U + MpuRegisters[MPU6050_REG_SMPLRT_DIV])) / rate_hz;
+}
+
+static bool MpuFifoSampling(void)
+{
+    return ((MpuRegisters[MPU6050_REG_PWR_MGMT_1] & MPU_PWR_MGMT_1_SLEEP) == 0U) &&
+           ((MpuRegisters[MPU6050_REG_USER_CTRL] & MPU6050_USER_CTRL_FIFO_EN) != 0U) &&
+           ((MpuRegisters[MPU6050_REG_FIFO_EN] & MPU6050_FIFO_EN_ACCEL) != 0U);
+}
+
+/* Uniform noise with the given rms (xorshift32 - the same sequence in every run) */
+static double Noise(double rms)
+{
+    MpuRandom ^= MpuRandom << 13;
+    MpuRandom ^= MpuRandom >> 17;
+    MpuRandom ^= MpuRandom << 5;
+    return ((double)MpuRandom / 4294967295.0 * 2.0 - 1.0) * 1.7320508 * rms;
+}
+
+static void MpuFifoPush(uint8_t value)
+{
+    if(MpuFifoCount == MPU6050_FIFO_SIZE)
+    {
+        /* Full - the oldest byte is overwritten */
+        MpuFifoHead = (MpuFifoHead + 1U) % MPU6050_FIFO_SIZE;
+        MpuFifoCount--;
+        MpuOverflows++;
+    }
+    MpuFifo[(MpuFifoHead + MpuFifoCount) % MPU6050_FIFO_SIZE] = value;
+    MpuFifoCount++;
+}
+
+static uint8_t MpuFifoPop(void)
+{
+    if(MpuFifoCount == 0U) return 0U;
+    uint8_t value = MpuFifo[MpuFifoHead];
+    MpuFifoHead = (MpuFifoHead + 1U) % MPU6050_FIFO_SIZE;
+    MpuFifoCount--;
+    return value;
+}
+
+static void MpuSample(void)
+{
+    bool motorOn = HostSim_GetPin(MOTOR_CONTROL_1) || HostSim_GetPin(MOTOR_CONTROL_2);
+    double vibration_mg = motorOn ? VibrationMotorOn_mg : VibrationMotorOff_mg;
+    double gravity_mg[3] = { 0.0, 0.0, 1000.0 };
+
+    for(uint32_t axis = 0; axis < 3U; axis++)
+    {
+        double value_mg = gravity_mg[axis] + Noise(MPU_NOISE_MG) + Noise(vibration_mg);
+        double lsb = value_mg * MPU_LSB_PER_MG;
+        int16_t value = (lsb > 32767.0) ? 32767 : (lsb < -32768.0) ? -32768 : (int16_t)lsb;
+        MpuFifoPush((uint8_t)((uint16_t)value >> 8));
+        MpuFifoPush((uint8_t)value);
+    }
+    MpuSamples++;
+}
+
+static void MpuWriteRegister(uint8_t reg, uint8_t value)
+{
+    if((reg == MPU6050_REG_PWR_MGMT_1) && ((value & MPU6050_PWR_MGMT_1_DEVICE_RESET) != 0U))
+    {
+        MpuReset();
+        return;
+    }
+    if((reg == MPU6050_REG_USER_CTRL) && ((value & MPU6050_USER_CTRL_FIFO_RESET) != 0U))
+    {
+        MpuFifoHead = 0;
+        MpuFifoCount = 0;
+        value &= (uint8_t)~MPU6050_USER_CTRL_FIFO_RESET; /* self-clearing */
+    }
+    if(reg < MPU_NUM_OF_REGISTERS) MpuRegisters[reg] = value;
+}
+
+static uint8_t MpuReadRegister(uint8_t reg)
+{
+    switch(reg)
+    {
+        case MPU6050_REG_FIFO_COUNTH:
+            return (uint8_t)(MpuFifoCount >> 8);
+        case MPU6050_REG_FIFO_COUNTH + 1U:
+            return (uint8_t)MpuFifoCount;
+        case MPU6050_REG_FIFO_R_W:
+            return MpuFifoPop();
+        default:
+            return (reg < MPU_NUM_OF_REGISTERS) ? MpuRegisters[reg] : 0U;
+    }
+}
+
+/* The time the transfer takes on the bus - address byte and the data bytes */
+static void I2cBusTime(const i2c_inst_t *i2c, size_t len)
+{
+    uint32_t baudrate = (i2c->baudrate > 0U) ? i2c->baudrate : 100000U;
+    HostSim_BusyWaitUs(((uint64_t)(len + 1U) * I2C_CLOCKS_PER_BYTE * 1000000ULL) / baudrate);
+    if(i2c == i2c1) MpuBytes += len;
+}
+
+static bool MpuAddressed(const i2c_inst_t *i2c, uint8_t addr)
+{
+    return (i2c == i2c1) && (addr == MPU6050_I2C_ADDRESS);
+}
+
+static bool RtcAddressed(const i2c_inst_t *i2c, uint8_t addr)
+{
+    return (i2c == i2c0) && (addr == DS1307_I2C_ADDRESS);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_SetVibration(double motorOn_mg, double motorOff_mg)
+{
+    VibrationMotorOn_mg = motorOn_mg;
+    VibrationMotorOff_mg = motorOff_mg;
+}
+
+uint64_t HostSim_GetMpu6050Transactions(void)
+{
+    return MpuTransactions;
+}
+
+uint64_t HostSim_GetMpu6050Bytes(void)
+{
+    return MpuBytes;
+}
+
+uint64_t HostSim_GetMpu6050Overflows(void)
+{
+    return MpuOverflows;
+}
+
+void HostSim_Mpu6050Update(void)
+{
+    bool sampling = MpuFifoSampling();
+    uint64_t now_us = HostSim_NowUs();
+
+    if(sampling && !MpuSampling)
+    {
+        MpuNextSample_us = now_us + MpuSamplePeriodUs();
+    }
+    MpuSampling = sampling;
+    while(sampling && (MpuNextSample_us <= now_us))
+    {
+        MpuSample();
+        MpuNextSample_us += MpuSamplePeriodUs();
+    }
+}
+
+/* ---- I2C ---- */
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    i2c->baudrate = baudrate;
+    if(i2c == i2c1) MpuReset();
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    (void)nostop;
+    if(RtcAddressed(i2c, addr) && (len > 1U))
+    {
+        /* The divider chain restarts once the seconds byte is in (the register pointer before it) */
+        I2cBusTime(i2c, 2U);
+        HostSim_RtcI2cWrite(src, (uint32_t)len);
+        if(len > 2U) I2cBusTime(i2c, len - 3U);
+        return (int)len;
+    }
+    I2cBusTime(i2c, len);
+    if(RtcAddressed(i2c, addr)) return (int)HostSim_RtcI2cWrite(src, (uint32_t)len);
+    if(!MpuAddressed(i2c, addr)) return PICO_ERROR_GENERIC;
+
+    /* Every transaction starts with the register address */
+    HostSim_Mpu6050Update();
+    MpuTransactions++;
+    if(len == 0U) return 0;
+    MpuPointer = src[0];
+    for(size_t i = 1; i < len; i++)
+    {
+        MpuWriteRegister(MpuPointer++, src[i]);
+    }
+    HostSim_Mpu6050Update();
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    (void)nostop;
+    if(RtcAddressed(i2c, addr))
+    {
+        uint32_t count = HostSim_RtcI2cRead(dst, (uint32_t)len);
+        I2cBusTime(i2c, len);
+        return (int)count;
+    }
+    if(!MpuAddressed(i2c, addr))
+    {
+        I2cBusTime(i2c, 0U);
+        return PICO_ERROR_GENERIC;
+    }
+
+    /* The data is latched when the read starts, the bus time follows */
+    HostSim_Mpu6050Update();
+    for(size_t i = 0; i < len; i++)
+    {
+        dst[i] = MpuReadRegister(MpuPointer);
+        if(MpuPointer != MPU6050_REG_FIFO_R_W) MpuPointer++;
+    }
+    I2cBusTime(i2c, len);
+    return (int)len;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us)
+{
+    (void)timeout_us;
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us)
+{
+    (void)timeout_us;
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
@@ -0,0 +1,522 @@
+/* HostSim_Pio.c - PIO model of the host simulation (an interpreter of the PIO instruction set - see hardware/pio.h) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+
+/* Instructions a state machine runs after an input change - a loop that samples its pins takes a few, so it has seen the
+   new levels (and pushed what it made of them) long before that */
+#define PIO_SETTLE_INSTRUCTIONS     (64U)
+/* A blocking read of a state machine that never pushes would hang the target - here it gives up after that many */
+#define PIO_READ_INSTRUCTIONS       (100000U)
+#define PIO_FIFO_DEPTH              (4U)
+
+#define PIO_INSTR_JMP               (0U)
+#define PIO_INSTR_WAIT              (1U)
+#define PIO_INSTR_IN                (2U)
+#define PIO_INSTR_OUT               (3U)
+#define PIO_INSTR_PUSH_PULL         (4U)
+#define PIO_INSTR_MOV               (5U)
+#define PIO_INSTR_IRQ               (6U)
+#define PIO_INSTR_SET               (7U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    bool claimed;
+    bool enabled;
+    pio_sm_config config;
+    uint32_t pc;
+    uint32_t x, y;
+    uint32_t isr, osr;
+    uint32_t isrCount;                      /* bits shifted into the ISR */
+    uint32_t osrCount;                      /* bits shifted out of the OSR - 32, empty */
+    uint32_t rxFifo[2U * PIO_FIFO_DEPTH];
+    uint32_t rxHead, rxLevel;
+}PioStateMachine_t;
+
+struct pio_hw
+{
+    uint16_t instructions[PIO_INSTRUCTION_COUNT];
+    uint32_t usedMask;
+    PioStateMachine_t sm[NUM_PIO_STATE_MACHINES];
+};
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static pio_hw_t Pios[NUM_PIOS];
+static HostSim_PioStats_t PioStats;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+static bool PioExecute(pio_hw_t *pio, PioStateMachine_t *sm, uint32_t instr, bool advance);
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t PioPins(const PioStateMachine_t *sm)
+{
+    uint32_t levels = gpio_get_all();
+    uint32_t base = sm->config.inBase & 31U;
+    return (base == 0U) ? levels : ((levels >> base) | (levels << (32U - base)));
+}
+
+static uint32_t PioRxDepth(const PioStateMachine_t *sm)
+{
+    return (sm->config.join == PIO_FIFO_JOIN_RX) ? (2U * PIO_FIFO_DEPTH) : PIO_FIFO_DEPTH;
+}
+
+static uint32_t PioBitMask(uint32_t count)
+{
+    return (count >= 32U) ? 0xFFFFFFFFu : ((1u << count) - 1U);
+}
+
+static uint32_t PioReverse(uint32_t value)
+{
+    uint32_t reversed = 0;
+    for(uint32_t bit = 0; bit < 32U; bit++)
+    {
+        reversed = (reversed << 1) | ((value >> bit) & 1u);
+    }
+    return reversed;
+}
+
+static uint32_t PioSource(const PioStateMachine_t *sm, uint32_t source)
+{
+    switch(source)
+    {
+        case 0U: return PioPins(sm);
+        case 1U: return sm->x;
+        case 2U: return sm->y;
+        case 6U: return sm->isr;
+        case 7U: return sm->osr;
+        default: return 0U;                  /* NULL, and STATUS (not modelled) */
+    }
+}
+
+static void PioShiftIn(PioStateMachine_t *sm, uint32_t data, uint32_t count)
+{
+    data &= PioBitMask(count);
+    if(count >= 32U)
+    {
+        sm->isr = data;
+    }
+    else if(sm->config.inShiftRight)
+    {
+        sm->isr = (sm->isr >> count) | (data << (32U - count));
+    }
+    else
+    {
+        sm->isr = (sm->isr << count) | data;
+    }
+    sm->isrCount = ((sm->isrCount + count) > 32U) ? 32U : (sm->isrCount + count);
+}
+
+static uint32_t PioShiftOut(PioStateMachine_t *sm, uint32_t count)
+{
+    uint32_t data;
+    if(count >= 32U)
+    {
+        data = sm->osr;
+        sm->osr = 0U;
+    }
+    else if(sm->config.outShiftRight)
+    {
+        data = sm->osr & PioBitMask(count);
+        sm->osr >>= count;
+    }
+    else
+    {
+        data = sm->osr >> (32U - count);
+        sm->osr <<= count;
+    }
+    sm->osrCount = ((sm->osrCount + count) > 32U) ? 32U : (sm->osrCount + count);
+    return data;
+}
+
+/* PUSH - a full FIFO stalls a blocking push, a non-blocking one is lost. The ISR is cleared either way */
+static bool PioPush(PioStateMachine_t *sm, bool block)
+{
+    if(sm->rxLevel >= PioRxDepth(sm))
+    {
+        if(block) return false;
+        PioStats.droppedPushes++;
+    }
+    else
+    {
+        sm->rxFifo[(sm->rxHead + sm->rxLevel) % PioRxDepth(sm)] = sm->isr;
+        sm->rxLevel++;
+        PioStats.pushes++;
+    }
+    sm->isr = 0U;
+    sm->isrCount = 0U;
+    return true;
+}
+
+/* One instruction - false if the state machine stalls on it (the PC stays). The PC is advanced (with the wrap) unless the
+   instruction wrote it or it came from outside the program (pio_sm_exec) */
+static bool PioExecute(pio_hw_t *pio, PioStateMachine_t *sm, uint32_t instr, bool advance)
+{
+    uint32_t opcode = (instr >> 13) & 7U;
+    uint32_t arg1 = (instr >> 5) & 7U;
+    uint32_t arg2 = instr & 0x1FU;
+    bool jumped = false;
+
+    PioStats.instructions++;
+    switch(opcode)
+    {
+        case PIO_INSTR_JMP:
+        {
+            bool condition;
+            switch(arg1)
+            {
+                case 1U: condition = (sm->x == 0U); break;
+                case 2U: condition = (sm->x != 0U); sm->x--; break;
+                case 3U: condition = (sm->y == 0U); break;
+                case 4U: condition = (sm->y != 0U); sm->y--; break;
+                case 5U: condition = (sm->x != sm->y); break;
+                case 6U: condition = gpio_get(sm->config.jmpPin); break;
+                case 7U: condition = (sm->osrCount < 32U); break;
+                default: condition = true; break;
+            }
+            if(condition)
+            {
+                sm->pc = arg2;
+                jumped = true;
+            }
+            break;
+        }
+        case PIO_INSTR_WAIT:
+        {
+            bool polarity = ((arg1 & 4U) != 0U);
+            uint32_t source = arg1 & 3U;
+            bool level = polarity;
+            if(source == 0U) level = gpio_get(arg2);
+            else if(source == 1U) level = ((PioPins(sm) >> arg2) & 1u) != 0U;
+            if(level != polarity) return false;
+            break;
+        }
+        case PIO_INSTR_IN:
+            PioShiftIn(sm, PioSource(sm, arg1), (arg2 == 0U) ? 32U : arg2);
+            break;
+        case PIO_INSTR_OUT:
+        {
+            uint32_t count = (arg2 == 0U) ? 32U : arg2;
+            uint32_t data = PioShiftOut(sm, count);
+            switch(arg1)
+            {
+                case 1U: sm->x = data; break;
+                case 2U: sm->y = data; break;
+                case 5U: sm->pc = data & 0x1FU; jumped = true; break;
+                case 6U: sm->isr = data; sm->isrCount = count; break;
+                case 7U: return PioExecute(pio, sm, data & 0xFFFFU, advance);
+                default: break;               /* PINS, NULL, PINDIRS */
+            }
+            break;
+        }
+        case PIO_INSTR_PUSH_PULL:
+        {
+            bool pull = ((instr & 0x80U) != 0U);
+            bool ifFullEmpty = ((instr & 0x40U) != 0U);
+            bool block = ((instr & 0x20U) != 0U);
+            if(pull)
+            {
+                /* No TX FIFO - a pull finds it empty: a blocking one stalls, the other one copies X */
+                if(ifFullEmpty && (sm->osrCount < 32U)) break;
+                if(block) return false;
+                sm->osr = sm->x;
+                sm->osrCount = 0U;
+            }
+            else
+            {
+                if(ifFullEmpty && (sm->isrCount < sm->config.pushThreshold)) break;
+                if(!PioPush(sm, block)) return false;
+            }
+            break;
+        }
+        case PIO_INSTR_MOV:
+        {
+            uint32_t op = (instr >> 3) & 3U;
+            uint32_t value = PioSource(sm, instr & 7U);
+            if(op == 1U) value = ~value;
+            else if(op == 2U) value = PioReverse(value);
+            switch(arg1)
+            {
+                case 1U: sm->x = value; break;
+                case 2U: sm->y = value; break;
+                case 4U: return PioExecute(pio, sm, value & 0xFFFFU, advance);
+                case 5U: sm->pc = value & 0x1FU; jumped = true; break;
+                case 6U: sm->isr = value; sm->isrCount = 0U; break;
+                case 7U: sm->osr = value; sm->osrCount = 0U; break;
+                default: break;               /* PINS */
+            }
+            break;
+        }
+        case PIO_INSTR_SET:
+            if(arg1 == 1U) sm->x = arg2;
+            else if(arg1 == 2U) sm->y = arg2;
+            break;
+        default:                              /* IRQ */
+            break;
+    }
+
+    if(!jumped && advance)
+    {
+        sm->pc = (sm->pc == sm->config.wrap) ? sm->config.wrapTarget : ((sm->pc + 1U) & 0x1FU);
+    }
+    return true;
+}
+
+/* Runs a state machine for up to the given number of instructions - stops early when it stalls or, with untilPush, once it
+   pushed */
+static void PioRun(pio_hw_t *pio, PioStateMachine_t *sm, uint32_t instructions, bool untilPush)
+{
+    uint32_t level = sm->rxLevel;
+    for(uint32_t i = 0; i < instructions; i++)
+    {
+        if(!PioExecute(pio, sm, pio->instructions[sm->pc], true)) break;
+        if(untilPush && (sm->rxLevel > level)) break;
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_PioUpdate(void)
+{
+    for(uint32_t p = 0; p < NUM_PIOS; p++)
+    {
+        for(uint32_t s = 0; s < NUM_PIO_STATE_MACHINES; s++)
+        {
+            if(Pios[p].sm[s].enabled)
+            {
+                PioStats.settles++;
+                PioRun(&Pios[p], &Pios[p].sm[s], PIO_SETTLE_INSTRUCTIONS, false);
+            }
+        }
+    }
+}
+
+const HostSim_PioStats_t* HostSim_GetPioStats(void)
+{
+    return &PioStats;
+}
+
+/* ---- PIO ---- */
+
+pio_hw_t* HostSim_PioHw(uint index)
+{
+    return &Pios[index];
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program)
+{
+    uint32_t mask = PioBitMask(program->length);
+    if(program->origin >= 0)
+    {
+        return ((uint32_t)program->origin + program->length <= PIO_INSTRUCTION_COUNT) && ((pio->usedMask & (mask << program->origin)) == 0U);
+    }
+    for(int32_t offset = (int32_t)(PIO_INSTRUCTION_COUNT - program->length); offset >= 0; offset--)
+    {
+        if((pio->usedMask & (mask << offset)) == 0U) return true;
+    }
+    return false;
+}
+
+/* Loaded like the SDK does it - at the origin or the highest free offset, the JMP targets moved by the offset */
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+    uint32_t mask = PioBitMask(program->length);
+    int32_t offset = program->origin;
+    if(offset < 0)
+    {
+        for(offset = (int32_t)(PIO_INSTRUCTION_COUNT - program->length); offset >= 0; offset--)
+        {
+            if((pio->usedMask & (mask << offset)) == 0U) break;
+        }
+    }
+    if((offset < 0) || ((pio->usedMask & (mask << offset)) != 0U))
+    {
+        fprintf(stderr, "HostSim: no room for the PIO program\n");
+        return 0U;
+    }
+    for(uint32_t i = 0; i < program->length; i++)
+    {
+        uint16_t instr = program->instructions[i];
+        if(((instr >> 13) & 7U) == PIO_INSTR_JMP) instr = (uint16_t)((instr & ~0x1FU) | ((instr + (uint32_t)offset) & 0x1FU));
+        pio->instructions[(uint32_t)offset + i] = instr;
+    }
+    pio->usedMask |= mask << offset;
+    return (uint)offset;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    for(uint32_t s = 0; s < NUM_PIO_STATE_MACHINES; s++)
+    {
+        if(!pio->sm[s].claimed)
+        {
+            memset(&pio->sm[s], 0, sizeof(pio->sm[s]));
+            pio->sm[s].claimed = true;
+            return (int)s;
+        }
+    }
+    if(required)
+    {
+        fprintf(stderr, "HostSim: no free PIO state machine\n");
+    }
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm)
+{
+    pio->sm[sm].claimed = false;
+    pio->sm[sm].enabled = false;
+}
+
+void pio_gpio_init(PIO pio, uint pin)
+{
+    (void)pio;
+    gpio_set_function(pin, GPIO_FUNC_PIO0);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out)
+{
+    (void)pio;
+    (void)sm;
+    (void)pin_base;
+    (void)pin_count;
+    (void)is_out;
+}
+
+pio_sm_config pio_get_default_sm_config(void)
+{
+    pio_sm_config c;
+    memset(&c, 0, sizeof(c));
+    c.wrap = PIO_INSTRUCTION_COUNT - 1U;
+    c.inShiftRight = true;
+    c.outShiftRight = true;
+    c.pushThreshold = 32U;
+    c.clkdiv = 1.0f;
+    return c;
+}
+
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base)
+{
+    c->inBase = in_base;
+}
+
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin)
+{
+    c->jmpPin = pin;
+}
+
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap)
+{
+    c->wrapTarget = wrap_target;
+    c->wrap = wrap;
+}
+
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold)
+{
+    (void)autopush;
+    c->inShiftRight = shift_right;
+    c->pushThreshold = (push_threshold == 0U) ? 32U : push_threshold;
+}
+
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    (void)autopull;
+    (void)pull_threshold;
+    c->outShiftRight = shift_right;
+}
+
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join)
+{
+    c->join = join;
+}
+
+void sm_config_set_clkdiv(pio_sm_config *c, float div)
+{
+    c->clkdiv = div;
+}
+
+/* Disabled, configured, FIFOs cleared, ISR and OSR empty, at the initial PC - X and Y keep their values like on the chip */
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config)
+{
+    PioStateMachine_t *machine = &pio->sm[sm];
+    machine->enabled = false;
+    machine->config = *config;
+    machine->pc = initial_pc & 0x1FU;
+    machine->isr = 0U;
+    machine->isrCount = 0U;
+    machine->osr = 0U;
+    machine->osrCount = 32U;
+    machine->rxHead = 0U;
+    machine->rxLevel = 0U;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    pio->sm[sm].enabled = enabled;
+    if(enabled)
+    {
+        PioRun(pio, &pio->sm[sm], PIO_SETTLE_INSTRUCTIONS, false);
+    }
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr)
+{
+    (void)PioExecute(pio, &pio->sm[sm], instr & 0xFFFFU, false);
+}
+
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm)
+{
+    return pio->sm[sm].rxLevel;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm)
+{
+    return (pio->sm[sm].rxLevel == 0U);
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm)
+{
+    PioStateMachine_t *machine = &pio->sm[sm];
+    if(machine->rxLevel == 0U)
+    {
+        return 0U;
+    }
+    uint32_t value = machine->rxFifo[machine->rxHead];
+    machine->rxHead = (machine->rxHead + 1U) % PioRxDepth(machine);
+    machine->rxLevel--;
+    return value;
+}
+
+/* The state machine goes on while the firmware waits - until it pushes */
+uint32_t pio_sm_get_blocking(PIO pio, uint sm)
+{
+    PioStateMachine_t *machine = &pio->sm[sm];
+    if((machine->rxLevel == 0U) && machine->enabled)
+    {
+        PioRun(pio, machine, PIO_READ_INSTRUCTIONS, true);
+    }
+    if(machine->rxLevel == 0U)
+    {
+        fprintf(stderr, "HostSim: blocking read of a PIO state machine that does not push\n");
+    }
+    return pio_sm_get(pio, sm);
+}
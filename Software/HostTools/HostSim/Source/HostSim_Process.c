@@ -0,0 +1,67 @@
+/* HostSim_Process.c - the scenarios of a tool in processes of their own (a fresh firmware image every time) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "HostSim.h"
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* Write end of the pipe and the size of the result - valid in the process of the scenario only */
+static int ResultFd = -1;
+static size_t ResultSize;
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+bool HostSim_RunIsolated(HostSim_IsolatedRun_t run, const void *context, void *result, size_t size)
+{
+    int fds[2];
+    if(pipe(fds) != 0) return false;
+    fflush(NULL);                           /* else the output buffered so far is written by both processes */
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if(pid == 0)
+    {
+        close(fds[0]);
+        ResultFd = fds[1];
+        ResultSize = size;
+        run(context, result);
+        HostSim_IsolatedResult(result);
+    }
+    close(fds[1]);
+
+    /* A result larger than the pipe buffer comes in pieces */
+    size_t received = 0;
+    while(received < size)
+    {
+        ssize_t got = read(fds[0], (char*)result + received, size - received);
+        if(got <= 0) break;
+        received += (size_t)got;
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return (received == size) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+void HostSim_IsolatedResult(const void *result)
+{
+    if(ResultFd < 0)
+    {
+        fprintf(stderr, "HostSim: result sent outside of HostSim_RunIsolated\n");
+        abort();
+    }
+    ssize_t written = write(ResultFd, result, ResultSize);
+    _exit((written == (ssize_t)ResultSize) ? 0 : 1);
+}
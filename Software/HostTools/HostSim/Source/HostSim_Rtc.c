@@ -0,0 +1,300 @@
+/* HostSim_Rtc.c - DS1307 fake behind the Pico_DS1307_HAL API and on I2C0 (time registers follow the virtual time, with a drift) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* DS1307 library replacement includes */
+#include "DS1307.h"
+#include "I2C_Driver.h"
+
+/* SDK replacement includes */
+#include "hardware/i2c.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define DS1307_NUM_REGISTERS    (64U)
+#define SECONDS_PER_DAY         (86400LL)
+#define TIME_REGISTERS          (7U)
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+/* Wall clock in us since 2000-01-01 00:00:00 at the virtual time ClockBase_us, running ClockRate times as fast as the virtual time */
+static int64_t ClockBase_wall_us;
+static uint64_t ClockBase_us;
+static double ClockRate = 1.0;
+static uint8_t Pointer;                 /* register pointer of the I2C0 transfers */
+static uint8_t Registers[DS1307_NUM_REGISTERS];
+static HostSim_I2cHook_t I2cHook;
+static HostSim_I2cReadSource_t I2cReadSource;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Days since 2000-01-01 of a civil date (proleptic Gregorian) */
+static int64_t DaysFromCivil(int64_t y, uint32_t m, uint32_t d)
+{
+    y -= (m <= 2U) ? 1 : 0;
+    int64_t era = ((y >= 0) ? y : (y - 399)) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153U * (m + ((m > 2U) ? (uint32_t)-3 : 9U)) + 2U) / 5U + d - 1U;
+    uint32_t doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+    return era * 146097 + (int64_t)doe - 730425;
+}
+
+static void CivilFromDays(int64_t z, uint32_t *year, uint32_t *month, uint32_t *day)
+{
+    z += 730425;
+    int64_t era = ((z >= 0) ? z : (z - 146096)) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+    uint32_t doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+    uint32_t mp = (5U * doy + 2U) / 153U;
+    *day = doy - (153U * mp + 2U) / 5U + 1U;
+    *month = (mp < 10U) ? (mp + 3U) : (mp - 9U);
+    *year = (uint32_t)((int64_t)yoe + era * 400 + ((*month <= 2U) ? 1 : 0));
+}
+
+static int64_t CurrentUs(void)
+{
+    return ClockBase_wall_us + (int64_t)((double)(HostSim_NowUs() - ClockBase_us) * ClockRate);
+}
+
+static int64_t CurrentSeconds(void)
+{
+    int64_t wall_us = CurrentUs();
+    return (wall_us >= 0) ? (wall_us / 1000000LL) : (((wall_us + 1) / 1000000LL) - 1);
+}
+
+/* The divider chain restarts - the second starts now */
+static void SetSeconds(int64_t seconds)
+{
+    ClockBase_wall_us = seconds * 1000000LL;
+    ClockBase_us = HostSim_NowUs();
+}
+
+static uint8_t ReadRegister(uint8_t reg)
+{
+    if(reg > 6U)
+    {
+        return Registers[reg % DS1307_NUM_REGISTERS];
+    }
+
+    int64_t seconds = CurrentSeconds();
+    int64_t days = seconds / SECONDS_PER_DAY;
+    uint32_t secondOfDay = (uint32_t)(seconds % SECONDS_PER_DAY);
+    uint32_t year, month, day;
+    CivilFromDays(days, &year, &month, &day);
+
+    switch(reg)
+    {
+        case 0: return ConvertBCD(secondOfDay % 60U, DEC_TO_BCD);
+        case 1: return ConvertBCD((secondOfDay / 60U) % 60U, DEC_TO_BCD);
+        case 2: return ConvertBCD(secondOfDay / 3600U, DEC_TO_BCD); /* 24h mode */
+        case 3: return (uint8_t)(((days + 5) % 7) + 1); /* 2000-01-01 was a Saturday, 1 = Monday */
+        case 4: return ConvertBCD(day, DEC_TO_BCD);
+        case 5: return ConvertBCD(month, DEC_TO_BCD);
+        default: return ConvertBCD(year % 100U, DEC_TO_BCD);
+    }
+}
+
+/* Consecutive registers from reg on (wrapping at the end of the RAM) - the time registers of a burst take effect together */
+static void WriteRegisters(uint8_t reg, const uint8_t *values, uint32_t count)
+{
+    int64_t seconds = CurrentSeconds();
+    int64_t days = seconds / SECONDS_PER_DAY;
+    uint32_t secondOfDay = (uint32_t)(seconds % SECONDS_PER_DAY);
+    uint32_t year, month, day;
+    uint32_t hour = secondOfDay / 3600U, minute = (secondOfDay / 60U) % 60U, second = secondOfDay % 60U;
+    bool timeWritten = false;
+    CivilFromDays(days, &year, &month, &day);
+
+    for(uint32_t i = 0; i < count; i++, reg = (uint8_t)((reg + 1U) % DS1307_NUM_REGISTERS))
+    {
+        uint8_t value = values[i];
+        uint8_t dec = ConvertBCD(value & 0x7Fu, BCD_TO_DEC);
+        if(reg >= TIME_REGISTERS)
+        {
+            Registers[reg] = value;
+            continue;
+        }
+        switch(reg)
+        {
+            case 0: second = dec; break;
+            case 1: minute = dec; break;
+            case 2: hour = ConvertBCD(value & 0x3Fu, BCD_TO_DEC); break;
+            case 3: continue;
+            case 4: day = dec; break;
+            case 5: month = dec; break;
+            default: year = 2000U + ConvertBCD(value, BCD_TO_DEC); break;
+        }
+        timeWritten = true;
+    }
+    if(timeWritten)
+    {
+        SetSeconds(DaysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second);
+    }
+}
+
+static void WriteRegister(uint8_t reg, uint8_t value)
+{
+    WriteRegisters(reg % DS1307_NUM_REGISTERS, &value, 1U);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_RtcSetTime(uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second)
+{
+    SetSeconds(DaysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second);
+}
+
+void HostSim_RtcSetDrift(double ppm)
+{
+    ClockBase_wall_us = CurrentUs();
+    ClockBase_us = HostSim_NowUs();
+    ClockRate = 1.0 + (ppm * 1e-6);
+}
+
+int64_t HostSim_RtcTimeUs(void)
+{
+    return CurrentUs();
+}
+
+uint8_t HostSim_RtcReadRegister(uint8_t reg)
+{
+    return ReadRegister(reg);
+}
+
+void HostSim_RtcWriteRegister(uint8_t reg, uint8_t value)
+{
+    WriteRegister(reg, value);
+}
+
+void HostSim_RtcSaveState(HostSim_PersistentState_t *state)
+{
+    state->rtcSeconds = CurrentSeconds();
+    memcpy(state->rtcRegisters, Registers, sizeof(state->rtcRegisters));
+}
+
+void HostSim_RtcRestoreState(const HostSim_PersistentState_t *state)
+{
+    SetSeconds(state->rtcSeconds);
+    memcpy(Registers, state->rtcRegisters, sizeof(Registers));
+}
+
+/* I2C0 transfers addressed to the DS1307 - the first byte written sets the register pointer. The time registers are latched when
+   a read starts, a write of the seconds register restarts the divider chain */
+uint32_t HostSim_RtcI2cWrite(const uint8_t *src, uint32_t len)
+{
+    if(len > 0U)
+    {
+        Pointer = src[0] % DS1307_NUM_REGISTERS;
+        WriteRegisters(Pointer, &src[1], len - 1U);
+        Pointer = (uint8_t)((Pointer + len - 1U) % DS1307_NUM_REGISTERS);
+    }
+    return len;
+}
+
+uint32_t HostSim_RtcI2cRead(uint8_t *dst, uint32_t len)
+{
+    for(uint32_t i = 0; i < len; i++)
+    {
+        dst[i] = ReadRegister(Pointer);
+        Pointer = (uint8_t)((Pointer + 1U) % DS1307_NUM_REGISTERS);
+    }
+    return len;
+}
+
+void HostSim_SetI2cHook(HostSim_I2cHook_t hook)
+{
+    I2cHook = hook;
+}
+
+void HostSim_SetI2cReadSource(HostSim_I2cReadSource_t source)
+{
+    I2cReadSource = source;
+}
+
+/* ---- Pico_DS1307_HAL API ---- */
+
+uint8_t ConvertBCD(uint8_t value, uint8_t conversionType)
+{
+    if(conversionType == BCD_TO_DEC)
+    {
+        return (uint8_t)(((value >> 4) * 10U) + (value & 0x0Fu));
+    }
+    return (uint8_t)(((value / 10U) << 4) | (value % 10U));
+}
+
+bool SetCurrentDate(const char* date, const char* time)
+{
+    /* Same format as __DATE__ ("Oct 18 2026") and __TIME__ ("12:34:56") */
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char monthName[4] = {0};
+    unsigned int day, year, hour, minute, second;
+
+    if((sscanf(date, "%3s %u %u", monthName, &day, &year) != 3) || (sscanf(time, "%u:%u:%u", &hour, &minute, &second) != 3))
+    {
+        return false;
+    }
+    const char *found = strstr(months, monthName);
+    if(found == NULL)
+    {
+        return false;
+    }
+    HostSim_RtcSetTime(year, (uint32_t)((found - months) / 3) + 1U, day, hour, minute, second);
+    return true;
+}
+
+bool Disable_DS1307_SquareWaveOutput(void)
+{
+    Registers[7] = 0U;
+    return true;
+}
+
+bool Enable_DS1307_Oscillator(void)
+{
+    return true;
+}
+
+void Reset_I2C0(void)
+{
+}
+
+void I2C_Initialize(uint32_t speed)
+{
+    i2c0->baudrate = speed;
+}
+
+bool setupPinsI2C0(void)
+{
+    return true;
+}
+
+uint8_t I2C_Register_Read(uint8_t reg)
+{
+    uint8_t value;
+    if((I2cReadSource == NULL) || !I2cReadSource(reg, &value))
+    {
+        value = ReadRegister(reg);
+    }
+    if(I2cHook != NULL)
+    {
+        I2cHook(false, reg, value);
+    }
+    return value;
+}
+
+bool I2C_Register_Write(uint8_t reg, uint8_t data)
+{
+    WriteRegister(reg, data);
+    if(I2cHook != NULL)
+    {
+        I2cHook(true, reg, data);
+    }
+    return true;
+}
@@ -0,0 +1,534 @@
+/* HostSim_Rtos.c - FreeRTOS replacement running the firmware tasks as coroutines in virtual time
+
+   The highest priority ready task runs until it blocks (delay, semaphore) or wakes a higher priority task.
+   Task code takes no virtual time - only delays, timeouts, alarms and the harness advance the clock. With the preemption
+   on (HostSim_SetPreemption) a task busy-waiting gives the CPU to a higher priority task that became ready meanwhile. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+/* FreeRTOS replacement includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_TASKS               (16U)
+#define TASK_STACK_SIZE         (256U * 1024U)
+#define US_PER_TICK             (1000000ULL / configTICK_RATE_HZ)
+#define NO_WAKE                 (UINT64_MAX)
+#define HANG_LIMIT_US           (120000000ULL)   /* twice the longest watchdog deadline of a task (AutomaticControlTask) */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    TASK_READY,
+    TASK_DELAYED,
+    TASK_BLOCKED,
+    TASK_DELETED
+}TaskState_t;
+
+struct HostSim_Semaphore
+{
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+struct HostSim_Task
+{
+    ucontext_t context;
+    void *stack;
+    TaskFunction_t function;
+    void *parameters;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    TaskState_t state;
+    uint64_t wake_us;
+    struct HostSim_Semaphore *waitingFor;
+    bool semaphoreObtained;
+    uint64_t lastRun;
+};
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static struct HostSim_Task Tasks[MAX_TASKS];
+static uint32_t NumTasks;
+static struct HostSim_Task *CurrentTask;
+static ucontext_t HarnessContext, BootContext;
+static void *BootStack;
+static uint64_t RunCounter;
+static bool SchedulerStarted;
+static uint64_t NextTick_us;
+static const char *HangTaskName;
+static uint64_t HangTime_us;
+static const char *StallTaskName;
+static uint64_t StallTime_us, StallDuration_us;
+static bool Preemption;
+static uint32_t SuspendNesting;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Firmware main() - renamed in the host build */
+void ElectronicBlinds_FirmwareMain(void);
+void vApplicationTickHook(void);
+
+static uint64_t NowTick(void)
+{
+    return HostSim_NowUs() / US_PER_TICK;
+}
+
+static void SwitchToScheduler(void)
+{
+    struct HostSim_Task *task = CurrentTask;
+    swapcontext(&task->context, &HarnessContext);
+}
+
+static void TaskEntry(void)
+{
+    struct HostSim_Task *task = CurrentTask;
+    task->function(task->parameters);
+
+    /* FreeRTOS tasks must never return */
+    fprintf(stderr, "HostSim: task %s returned\n", task->name);
+    task->state = TASK_DELETED;
+    SwitchToScheduler();
+}
+
+static void BootEntry(void)
+{
+    ElectronicBlinds_FirmwareMain();
+}
+
+static void BlockUntil(uint64_t wake_us, TaskState_t state)
+{
+    if((HangTaskName != NULL) && (HostSim_NowUs() >= HangTime_us) && (strncmp(CurrentTask->name, HangTaskName, sizeof(CurrentTask->name) - 1U) == 0))
+    {
+        /* Injected hang - the task never gets to block again, the interrupts (and the watchdog) keep running */
+        for(uint64_t hung_us = 0; hung_us < HANG_LIMIT_US; hung_us += US_PER_TICK)
+        {
+            HostSim_BusyWaitUs(US_PER_TICK);
+        }
+        fprintf(stderr, "HostSim: task %s hung for %llu us without a reset\n", CurrentTask->name, (unsigned long long)HANG_LIMIT_US);
+        exit(4);
+    }
+    if((StallTaskName != NULL) && (HostSim_NowUs() >= StallTime_us) && (strncmp(CurrentTask->name, StallTaskName, sizeof(CurrentTask->name) - 1U) == 0))
+    {
+        /* Injected stall - a busy loop of the given length once, then the task blocks as it would have */
+        StallTaskName = NULL;
+        HostSim_BusyWaitUs(StallDuration_us);
+    }
+    CurrentTask->state = state;
+    CurrentTask->wake_us = wake_us;
+    SwitchToScheduler();
+}
+
+static void YieldIfPreempted(UBaseType_t wokenPriority)
+{
+    if((CurrentTask != NULL) && (wokenPriority > CurrentTask->priority))
+    {
+        CurrentTask->state = TASK_READY;
+        SwitchToScheduler();
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_Boot(void)
+{
+    BootStack = malloc(TASK_STACK_SIZE);
+    getcontext(&BootContext);
+    BootContext.uc_stack.ss_sp = BootStack;
+    BootContext.uc_stack.ss_size = TASK_STACK_SIZE;
+    BootContext.uc_link = &HarnessContext;
+    makecontext(&BootContext, BootEntry, 0);
+
+    /* Returns once the firmware starts the scheduler */
+    swapcontext(&HarnessContext, &BootContext);
+    HostSim_RtosRunReadyTasks();
+}
+
+void HostSim_RtosRunReadyTasks(void)
+{
+    if(!SchedulerStarted)
+    {
+        return;
+    }
+
+    for(;;)
+    {
+        /* Highest priority first, round-robin among tasks of equal priority */
+        struct HostSim_Task *selected = NULL;
+        for(uint32_t i = 0; i < NumTasks; i++)
+        {
+            struct HostSim_Task *task = &Tasks[i];
+            if(task->state != TASK_READY) continue;
+            if((selected == NULL) || (task->priority > selected->priority) ||
+               ((task->priority == selected->priority) && (task->lastRun < selected->lastRun)))
+            {
+                selected = task;
+            }
+        }
+        if(selected == NULL)
+        {
+            break;
+        }
+
+        selected->lastRun = ++RunCounter;
+        CurrentTask = selected;
+        swapcontext(&HarnessContext, &selected->context);
+        CurrentTask = NULL;
+        HostSim_ServiceInterrupts();
+    }
+}
+
+uint64_t HostSim_RtosNextWakeUs(void)
+{
+    uint64_t next = NO_WAKE;
+#if (configUSE_TICK_HOOK == 1)
+    /* Every tick interrupt calls the tick hook - held off while the interrupts are disabled */
+    if(SchedulerStarted && !HostSim_InterruptsMasked()) next = NextTick_us;
+#endif
+    for(uint32_t i = 0; i < NumTasks; i++)
+    {
+        if(((Tasks[i].state == TASK_DELAYED) || (Tasks[i].state == TASK_BLOCKED)) && (Tasks[i].wake_us < next))
+        {
+            next = Tasks[i].wake_us;
+        }
+    }
+    return next;
+}
+
+uint64_t HostSim_RtosNextTickUs(void)
+{
+#if (configUSE_TICK_HOOK == 1)
+    if(SchedulerStarted && !HostSim_InterruptsMasked()) return NextTick_us;
+#endif
+    return NO_WAKE;
+}
+
+void HostSim_RtosServiceTicks(void)
+{
+#if (configUSE_TICK_HOOK == 1)
+    while(SchedulerStarted && !HostSim_InterruptsMasked() && (NextTick_us <= HostSim_NowUs()))
+    {
+        vApplicationTickHook();
+        NextTick_us += US_PER_TICK;
+    }
+#endif
+}
+
+void HostSim_HangTask(const char *name, uint64_t time_us)
+{
+    HangTaskName = name;
+    HangTime_us = time_us;
+}
+
+void HostSim_StallTask(const char *name, uint64_t time_us, uint64_t duration_us)
+{
+    StallTaskName = name;
+    StallTime_us = time_us;
+    StallDuration_us = duration_us;
+}
+
+void HostSim_SetPreemption(bool enabled)
+{
+    Preemption = enabled;
+}
+
+/* Called by the busy waits of a task (not in an interrupt, not with the interrupts off) */
+void HostSim_RtosPreempt(void)
+{
+    if(!Preemption || (CurrentTask == NULL) || (SuspendNesting > 0U))
+    {
+        return;
+    }
+    HostSim_RtosWakeTasks();
+    UBaseType_t highest = 0U;
+    for(uint32_t i = 0; i < NumTasks; i++)
+    {
+        if((Tasks[i].state == TASK_READY) && (&Tasks[i] != CurrentTask) && (Tasks[i].priority > highest))
+        {
+            highest = Tasks[i].priority;
+        }
+    }
+    YieldIfPreempted(highest);
+}
+
+void HostSim_RtosWakeTasks(void)
+{
+    HostSim_RtosServiceTicks();
+    for(uint32_t i = 0; i < NumTasks; i++)
+    {
+        struct HostSim_Task *task = &Tasks[i];
+        if(((task->state == TASK_DELAYED) || (task->state == TASK_BLOCKED)) && (task->wake_us <= HostSim_NowUs()))
+        {
+            /* Timeout of a blocked task - it did not get the semaphore */
+            task->state = TASK_READY;
+            task->waitingFor = NULL;
+            task->semaphoreObtained = false;
+        }
+    }
+}
+
+void HostSim_YieldFromIsr(BaseType_t xHigherPriorityTaskWoken)
+{
+    /* The scheduler runs the highest priority ready task as soon as the interrupt returns */
+    (void)xHigherPriorityTaskWoken;
+}
+
+/* ---- Tasks ---- */
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, configSTACK_DEPTH_TYPE usStackDepth,
+                       void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+    (void)usStackDepth;
+
+    if(NumTasks >= MAX_TASKS)
+    {
+        return pdFAIL;
+    }
+
+    struct HostSim_Task *task = &Tasks[NumTasks++];
+    memset(task, 0, sizeof(*task));
+    task->function = pxTaskCode;
+    task->parameters = pvParameters;
+    task->priority = uxPriority;
+    task->state = TASK_READY;
+    strncpy(task->name, pcName, sizeof(task->name) - 1U);
+
+    task->stack = malloc(TASK_STACK_SIZE);
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = TASK_STACK_SIZE;
+    task->context.uc_link = &HarnessContext;
+    makecontext(&task->context, TaskEntry, 0);
+
+    if(pxCreatedTask != NULL)
+    {
+        *pxCreatedTask = task;
+    }
+    return pdPASS;
+}
+
+void vTaskStartScheduler(void)
+{
+    /* Hand control back to the harness - the boot code never continues (same as on the target) */
+    SchedulerStarted = true;
+    NextTick_us = ((HostSim_NowUs() / US_PER_TICK) + 1U) * US_PER_TICK;
+    swapcontext(&BootContext, &HarnessContext);
+    for( ;; );
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    if(xTicksToDelay == 0U)
+    {
+        CurrentTask->state = TASK_READY;
+        SwitchToScheduler();
+    }
+    else
+    {
+        BlockUntil((NowTick() + xTicksToDelay) * US_PER_TICK, TASK_DELAYED);
+    }
+}
+
+BaseType_t xTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+    TickType_t now = (TickType_t)NowTick();
+    TickType_t wakeTime = *pxPreviousWakeTime + xTimeIncrement;
+    TickType_t remaining = wakeTime - now;
+    *pxPreviousWakeTime = wakeTime;
+
+    /* Wake time already passed (the task overran its period) - don't block */
+    if((remaining == 0U) || (remaining > (portMAX_DELAY / 2U)))
+    {
+        return pdFALSE;
+    }
+
+    BlockUntil((NowTick() + remaining) * US_PER_TICK, TASK_DELAYED);
+    return pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+    (void)xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)NowTick();
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return (TickType_t)NowTick();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return CurrentTask;
+}
+
+UBaseType_t uxTaskPriorityGet(const TaskHandle_t xTask)
+{
+    return (xTask != NULL) ? xTask->priority : CurrentTask->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority)
+{
+    ((xTask != NULL) ? xTask : CurrentTask)->priority = uxNewPriority;
+}
+
+char* pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+    return ((xTaskToQuery != NULL) ? xTaskToQuery : CurrentTask)->name;
+}
+
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery)
+{
+    for(uint32_t i = 0; i < NumTasks; i++)
+    {
+        if(strncmp(Tasks[i].name, pcNameToQuery, sizeof(Tasks[i].name) - 1U) == 0) return &Tasks[i];
+    }
+    return NULL;
+}
+
+void vTaskSuspendAll(void)
+{
+    /* Tasks are never preempted by time in the simulation - only the busy waits with the preemption on */
+    SuspendNesting++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    if(SuspendNesting > 0U) SuspendNesting--;
+    return pdFALSE;
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+    return configTOTAL_HEAP_SIZE;
+}
+
+/* ---- Semaphores ---- */
+
+static SemaphoreHandle_t CreateSemaphore(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    struct HostSim_Semaphore *semaphore = calloc(1, sizeof(struct HostSim_Semaphore));
+    semaphore->maxCount = maxCount;
+    semaphore->count = initialCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return CreateSemaphore(1U, 0U);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return CreateSemaphore(uxMaxCount, uxInitialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return CreateSemaphore(1U, 1U);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    if(xSemaphore->count > 0U)
+    {
+        xSemaphore->count--;
+        return pdTRUE;
+    }
+    if((xBlockTime == 0U) || (CurrentTask == NULL))
+    {
+        return pdFALSE;
+    }
+
+    CurrentTask->waitingFor = xSemaphore;
+    CurrentTask->semaphoreObtained = false;
+    BlockUntil((xBlockTime == portMAX_DELAY) ? NO_WAKE : ((NowTick() + xBlockTime) * US_PER_TICK), TASK_BLOCKED);
+    return CurrentTask->semaphoreObtained ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t GiveSemaphore(SemaphoreHandle_t xSemaphore, UBaseType_t *wokenPriority)
+{
+    *wokenPriority = 0U;
+    if(xSemaphore->count >= xSemaphore->maxCount)
+    {
+        return pdFALSE;
+    }
+
+    /* Hand the semaphore directly to the highest priority waiting task */
+    struct HostSim_Task *waiter = NULL;
+    for(uint32_t i = 0; i < NumTasks; i++)
+    {
+        if((Tasks[i].state == TASK_BLOCKED) && (Tasks[i].waitingFor == xSemaphore) && ((waiter == NULL) || (Tasks[i].priority > waiter->priority)))
+        {
+            waiter = &Tasks[i];
+        }
+    }
+
+    if(waiter != NULL)
+    {
+        waiter->state = TASK_READY;
+        waiter->waitingFor = NULL;
+        waiter->semaphoreObtained = true;
+        *wokenPriority = waiter->priority;
+    }
+    else
+    {
+        xSemaphore->count++;
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    UBaseType_t wokenPriority;
+    BaseType_t result = GiveSemaphore(xSemaphore, &wokenPriority);
+    if(result == pdTRUE)
+    {
+        YieldIfPreempted(wokenPriority);
+    }
+    return result;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    UBaseType_t wokenPriority;
+    BaseType_t result = GiveSemaphore(xSemaphore, &wokenPriority);
+    if((pxHigherPriorityTaskWoken != NULL) && (wokenPriority > 0U))
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    return result;
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    (void)pxHigherPriorityTaskWoken;
+    if(xSemaphore->count > 0U)
+    {
+        xSemaphore->count--;
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+    return xSemaphore->count;
+}
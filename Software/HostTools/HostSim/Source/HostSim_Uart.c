@@ -0,0 +1,330 @@
+/* HostSim_Uart.c - UART model of the host simulation: 8N1 at the set baud rate, the line attached to a file descriptor of the host */
+
+/*---------------- INCLUDES ----------------------*/
+
+#define _GNU_SOURCE                         /* ppoll */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "hardware/dma.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define NO_EVENT                (UINT64_MAX)
+#define NUM_UARTS               (2U)
+#define FIFO_SIZE               (32U)
+#define BITS_PER_BYTE           (10U)       /* start, 8 data, stop */
+#define READ_CHUNK              (256U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+struct uart_inst
+{
+    uint32_t index;
+    uint32_t baudrate;
+    uint64_t byte_ns;
+    int fd;                                 /* the line, -1 - not attached */
+
+    uint8_t txFifo[FIFO_SIZE];
+    uint32_t txHead, txCount;
+    bool shifting;
+    uint8_t shiftByte;
+    uint64_t txDone_ns;                     /* the byte in the shift register is out */
+
+    uint8_t rxFifo[FIFO_SIZE];
+    uint32_t rxHead, rxCount;
+
+    uart_hw_t regs;
+    HostSim_UartStats_t stats;
+};
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+uart_inst_t HostSim_Uart0 = { .index = 0U, .fd = -1 }, HostSim_Uart1 = { .index = 1U, .fd = -1 };
+static uart_inst_t* const Uarts[NUM_UARTS] = { &HostSim_Uart0, &HostSim_Uart1 };
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint64_t NowNs(void)
+{
+    return HostSim_NowUs() * 1000ULL;
+}
+
+static void LineWrite(uart_inst_t *uart, uint8_t byte)
+{
+    uart->stats.txBytes++;
+    if(uart->fd >= 0)
+    {
+        /* A pseudo-terminal takes a few KB before it blocks - the other end is read all the time */
+        while((write(uart->fd, &byte, 1U) < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+        {
+        }
+    }
+}
+
+static void RxPush(uart_inst_t *uart, uint8_t byte)
+{
+    uart->stats.rxBytes++;
+    uart->stats.lastRx_us = HostSim_NowUs();
+    if(uart->rxCount == FIFO_SIZE)
+    {
+        uart->stats.overruns++;
+        return;
+    }
+    uart->rxFifo[(uart->rxHead + uart->rxCount) % FIFO_SIZE] = byte;
+    uart->rxCount++;
+}
+
+static uint8_t RxPop(uart_inst_t *uart)
+{
+    uint8_t byte = uart->rxFifo[uart->rxHead];
+    uart->rxHead = (uart->rxHead + 1U) % FIFO_SIZE;
+    uart->rxCount--;
+    return byte;
+}
+
+static void TxRefill(uart_inst_t *uart)
+{
+    uint32_t data;
+    while((uart->txCount < FIFO_SIZE) && HostSim_DmaRead(uart_get_dreq(uart, true), &data))
+    {
+        uart->txFifo[(uart->txHead + uart->txCount) % FIFO_SIZE] = (uint8_t)data;
+        uart->txCount++;
+    }
+}
+
+static void TxStart(uart_inst_t *uart, uint64_t start_ns)
+{
+    uart->shiftByte = uart->txFifo[uart->txHead];
+    uart->txHead = (uart->txHead + 1U) % FIFO_SIZE;
+    uart->txCount--;
+    uart->shifting = true;
+    uart->txDone_ns = start_ns + uart->byte_ns;
+}
+
+/* The bytes out by now, back to back as long as the FIFO (and the DMA behind it) has more */
+static void TxUpdate(uart_inst_t *uart)
+{
+    for( ;; )
+    {
+        TxRefill(uart);
+        if(!uart->shifting)
+        {
+            if(uart->txCount == 0U) return;
+            TxStart(uart, NowNs());
+        }
+        if(uart->txDone_ns > NowNs()) return;
+
+        LineWrite(uart, uart->shiftByte);
+        uart->shifting = false;
+        TxRefill(uart);
+        if(uart->txCount > 0U)
+        {
+            TxStart(uart, uart->txDone_ns);
+        }
+    }
+}
+
+static void RxUpdate(uart_inst_t *uart)
+{
+    if(uart->fd >= 0)
+    {
+        uint8_t chunk[READ_CHUNK];
+        ssize_t length;
+        while((length = read(uart->fd, chunk, sizeof(chunk))) > 0)
+        {
+            for(ssize_t i = 0; i < length; i++)
+            {
+                RxPush(uart, chunk[i]);
+                /* The DMA keeps the FIFO empty - the chunk came in over many byte times */
+                while((uart->rxCount > 0U) && HostSim_DmaWrite(uart_get_dreq(uart, false), uart->rxFifo[uart->rxHead]))
+                {
+                    (void)RxPop(uart);
+                }
+            }
+        }
+    }
+    while((uart->rxCount > 0U) && HostSim_DmaWrite(uart_get_dreq(uart, false), uart->rxFifo[uart->rxHead]))
+    {
+        (void)RxPop(uart);
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_UartAttach(uint32_t index, int fd)
+{
+    Uarts[index]->fd = fd;
+}
+
+const HostSim_UartStats_t* HostSim_GetUartStats(uint32_t index)
+{
+    return &Uarts[index]->stats;
+}
+
+uint64_t HostSim_UartNextEventUs(void)
+{
+    uint64_t next = NO_EVENT;
+    for(uint32_t index = 0; index < NUM_UARTS; index++)
+    {
+        uart_inst_t *uart = Uarts[index];
+        uint64_t event = NO_EVENT;
+        if(uart->baudrate == 0U)
+        {
+            continue;
+        }
+        if(uart->shifting)
+        {
+            event = (uart->txDone_ns + 999U) / 1000U;
+        }
+        else if((uart->txCount > 0U) || HostSim_DmaPending(uart_get_dreq(uart, true)))
+        {
+            event = HostSim_NowUs();
+        }
+        if((uart->rxCount > 0U) && HostSim_DmaPending(uart_get_dreq(uart, false)))
+        {
+            event = HostSim_NowUs();
+        }
+        if(event < next) next = event;
+    }
+    return next;
+}
+
+void HostSim_UartUpdate(void)
+{
+    for(uint32_t index = 0; index < NUM_UARTS; index++)
+    {
+        if(Uarts[index]->baudrate != 0U)
+        {
+            TxUpdate(Uarts[index]);
+            RxUpdate(Uarts[index]);
+        }
+    }
+}
+
+/* Real-time pacing - sleeps until the timeout or a byte on an attached line, true for the byte */
+bool HostSim_UartWaitUs(uint64_t timeout_us)
+{
+    struct pollfd fds[NUM_UARTS];
+    nfds_t count = 0;
+    for(uint32_t index = 0; index < NUM_UARTS; index++)
+    {
+        if(Uarts[index]->fd >= 0)
+        {
+            fds[count].fd = Uarts[index]->fd;
+            fds[count].events = POLLIN;
+            count++;
+        }
+    }
+    struct timespec timeout = { (time_t)(timeout_us / 1000000U), (long)((timeout_us % 1000000U) * 1000U) };
+    return ppoll(fds, count, &timeout, NULL) > 0;
+}
+
+/* ---- UART ---- */
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    uart->baudrate = baudrate;
+    uart->byte_ns = ((uint64_t)BITS_PER_BYTE * 1000000000ULL) / baudrate;
+    uart->txCount = 0;
+    uart->rxCount = 0;
+    uart->shifting = false;
+    return baudrate;
+}
+
+void uart_deinit(uart_inst_t *uart)
+{
+    uart->baudrate = 0;
+}
+
+uint uart_get_index(uart_inst_t *uart)
+{
+    return uart->index;
+}
+
+uart_hw_t* uart_get_hw(uart_inst_t *uart)
+{
+    uart->regs.fr = (uart->shifting || (uart->txCount > 0U)) ? UART_UARTFR_BUSY_BITS : 0U;
+    uart->regs.fr |= (uart->txCount == 0U) ? UART_UARTFR_TXFE_BITS : 0U;
+    uart->regs.fr |= (uart->txCount == FIFO_SIZE) ? UART_UARTFR_TXFF_BITS : 0U;
+    uart->regs.fr |= (uart->rxCount == 0U) ? UART_UARTFR_RXFE_BITS : 0U;
+    uart->regs.fr |= (uart->rxCount == FIFO_SIZE) ? UART_UARTFR_RXFF_BITS : 0U;
+    return &uart->regs;
+}
+
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx)
+{
+    return (uart->index == 0U) ? (is_tx ? DREQ_UART0_TX : DREQ_UART0_RX) : (is_tx ? DREQ_UART1_TX : DREQ_UART1_RX);
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+    /* 8N1 only */
+    (void)uart;
+    (void)data_bits;
+    (void)stop_bits;
+    (void)parity;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+    (void)uart;
+    (void)enabled;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+    (void)uart;
+    (void)cts;
+    (void)rts;
+}
+
+bool uart_is_writable(uart_inst_t *uart)
+{
+    return uart->txCount < FIFO_SIZE;
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    RxUpdate(uart);
+    return uart->rxCount > 0U;
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c)
+{
+    while(!uart_is_writable(uart))
+    {
+        HostSim_BusyWaitUs(1U);
+    }
+    uart->txFifo[(uart->txHead + uart->txCount) % FIFO_SIZE] = (uint8_t)c;
+    uart->txCount++;
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    while(!uart_is_readable(uart))
+    {
+        HostSim_BusyWaitUs(1U);
+    }
+    return (char)RxPop(uart);
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart)
+{
+    while(uart->shifting || (uart->txCount > 0U))
+    {
+        HostSim_BusyWaitUs(1U);
+    }
+}
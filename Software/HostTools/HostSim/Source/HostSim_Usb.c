@@ -0,0 +1,276 @@
+/* HostSim_Usb.c - USB CDC (stdio_usb) model of the host simulation: the tool is the USB host */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+/* Firmware includes (response mark) */
+#include "UsbLink.h"
+
+#include "HostSim.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define NO_EVENT                (UINT64_MAX)
+#define DEFAULT_RATE            (500000U)   /* bytes/s host -> board - a full speed CDC link in practice */
+#define MAX_LINE                (160U)      /* the longest line of the USB link protocol, with its terminator */
+#define READ_STEP_US            (20U)       /* poll of a reader while nothing is on its way - the round trip resolution */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    uint8_t byte;
+    uint64_t visible_us;
+}UsbOutByte_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static uint32_t Rate = DEFAULT_RATE;
+static uint32_t HostLatency_us, BoardLatency_us = HOSTSIM_USB_LATENCY_US;
+
+/* Host -> board: written by the tool, not sent yet */
+static uint8_t *HostQueue;
+static uint32_t HostQueueSize, HostQueueHead, HostQueueTail;
+static uint64_t LinkFree_us;                /* the previous packet is in */
+static bool Stalled;                        /* the next packet does not fit into the buffer of the board */
+
+/* Received by the board, not read by the firmware yet */
+static uint8_t RxFifo[HOSTSIM_USB_RX_FIFO_SIZE];
+static uint32_t RxHead, RxCount;
+
+/* Board -> host */
+static UsbOutByte_t *OutQueue;
+static uint32_t OutQueueSize, OutQueueHead, OutQueueTail;
+
+/* Line being read by the host */
+static char LineBuffer[MAX_LINE];
+static uint32_t LineFill;
+
+static void (*CharsAvailable)(void*);
+static void *CharsAvailableParam;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t HostPending(void)
+{
+    return HostQueueTail - HostQueueHead;
+}
+
+static uint32_t NextPacketSize(void)
+{
+    return (HostPending() < HOSTSIM_USB_PACKET_SIZE) ? HostPending() : HOSTSIM_USB_PACKET_SIZE;
+}
+
+static uint64_t PacketTimeUs(uint32_t size)
+{
+    return (((uint64_t)size * 1000000ULL) + Rate - 1U) / Rate;
+}
+
+static void UsbIrqHandler(void)
+{
+    if(CharsAvailable != NULL)
+    {
+        CharsAvailable(CharsAvailableParam);
+    }
+}
+
+/* The next line of the board, only a response (the mark dropped) or any */
+static bool ReadLine(char *line, uint32_t size, uint64_t timeout_us, bool response)
+{
+    uint64_t deadline = HostSim_NowUs() + timeout_us;
+
+    for(;;)
+    {
+        uint8_t c;
+        while(HostSim_UsbRead(&c, 1U) == 1U)
+        {
+            if(c != '\n')
+            {
+                if(LineFill < (sizeof(LineBuffer) - 1U)) LineBuffer[LineFill++] = (char)c;
+                continue;
+            }
+            LineBuffer[LineFill] = '\0';
+            LineFill = 0;
+            if(!response)
+            {
+                snprintf(line, size, "%s", LineBuffer);
+                return true;
+            }
+            if(LineBuffer[0] == USB_LINK_RESPONSE_MARK)
+            {
+                snprintf(line, size, "%s", &LineBuffer[1]);
+                return true;
+            }
+        }
+        uint64_t now_us = HostSim_NowUs();
+        if(now_us >= deadline) return false;
+
+        /* Straight to the next byte on its way, else a poll step on */
+        uint64_t next_us = (OutQueueHead < OutQueueTail) ? OutQueue[OutQueueHead].visible_us : (now_us + READ_STEP_US);
+        HostSim_RunUntilUs((next_us < deadline) ? next_us : deadline);
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_UsbSetRate(uint32_t bytesPerSecond)
+{
+    Rate = bytesPerSecond;
+}
+
+void HostSim_UsbSetLatency(uint32_t hostToBoard_us, uint32_t boardToHost_us)
+{
+    HostLatency_us = hostToBoard_us;
+    BoardLatency_us = boardToHost_us;
+}
+
+void HostSim_UsbWrite(const uint8_t *data, uint32_t length)
+{
+    if(HostPending() == 0U)
+    {
+        HostQueueHead = 0;
+        HostQueueTail = 0;
+        if(LinkFree_us < HostSim_NowUs()) LinkFree_us = HostSim_NowUs() + HostLatency_us;
+    }
+    if((HostQueueTail + length) > HostQueueSize)
+    {
+        /* Compact, then grow */
+        memmove(HostQueue, &HostQueue[HostQueueHead], HostPending());
+        HostQueueTail -= HostQueueHead;
+        HostQueueHead = 0;
+        if((HostQueueTail + length) > HostQueueSize)
+        {
+            HostQueueSize = (HostQueueTail + length) * 2U;
+            HostQueue = realloc(HostQueue, HostQueueSize);
+        }
+    }
+    memcpy(&HostQueue[HostQueueTail], data, length);
+    HostQueueTail += length;
+}
+
+uint32_t HostSim_UsbRead(uint8_t *data, uint32_t maxLength)
+{
+    uint32_t count = 0;
+    while((count < maxLength) && (OutQueueHead < OutQueueTail) && (OutQueue[OutQueueHead].visible_us <= HostSim_NowUs()))
+    {
+        data[count++] = OutQueue[OutQueueHead++].byte;
+    }
+    return count;
+}
+
+uint32_t HostSim_UsbPendingWrite(void)
+{
+    return HostPending() + RxCount;
+}
+
+bool HostSim_UsbReadLine(char *line, uint32_t size, uint64_t timeout_us)
+{
+    return ReadLine(line, size, timeout_us, false);
+}
+
+bool HostSim_UsbReadResponse(char *line, uint32_t size, uint64_t timeout_us)
+{
+    return ReadLine(line, size, timeout_us, true);
+}
+
+uint64_t HostSim_UsbNextEventUs(void)
+{
+    if((HostPending() == 0U) || ((HOSTSIM_USB_RX_FIFO_SIZE - RxCount) < NextPacketSize()))
+    {
+        return NO_EVENT;
+    }
+    return LinkFree_us + PacketTimeUs(NextPacketSize());
+}
+
+void HostSim_UsbUpdate(void)
+{
+    bool received = false;
+
+    while((HostPending() > 0U) && (HostSim_UsbNextEventUs() <= HostSim_NowUs()))
+    {
+        uint32_t size = NextPacketSize();
+        LinkFree_us += PacketTimeUs(size);
+        for(uint32_t i = 0; i < size; i++)
+        {
+            RxFifo[(RxHead + RxCount) % HOSTSIM_USB_RX_FIFO_SIZE] = HostQueue[HostQueueHead++];
+            RxCount++;
+        }
+        received = true;
+    }
+    Stalled = (HostPending() > 0U) && ((HOSTSIM_USB_RX_FIFO_SIZE - RxCount) < NextPacketSize());
+
+    if(received && (CharsAvailable != NULL))
+    {
+        irq_set_pending(USBCTRL_IRQ);
+    }
+}
+
+/* ---- stdio ---- */
+
+bool stdio_init_all(void)
+{
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    uint64_t deadline = HostSim_NowUs() + timeout_us;
+    while(RxCount == 0U)
+    {
+        if(HostSim_NowUs() >= deadline)
+        {
+            return PICO_ERROR_TIMEOUT;
+        }
+        HostSim_BusyWaitUs(1U);
+    }
+
+    int c = RxFifo[RxHead];
+    RxHead = (RxHead + 1U) % HOSTSIM_USB_RX_FIFO_SIZE;
+    RxCount--;
+    if(Stalled && ((HOSTSIM_USB_RX_FIFO_SIZE - RxCount) >= NextPacketSize()))
+    {
+        /* Room again - the host sends the next packet from now on */
+        Stalled = false;
+        if(LinkFree_us < HostSim_NowUs()) LinkFree_us = HostSim_NowUs();
+    }
+    return c;
+}
+
+int putchar_raw(int c)
+{
+    if(OutQueueHead == OutQueueTail)
+    {
+        OutQueueHead = 0;
+        OutQueueTail = 0;
+    }
+    if(OutQueueTail >= OutQueueSize)
+    {
+        OutQueueSize = (OutQueueSize == 0U) ? 1024U : (OutQueueSize * 2U);
+        OutQueue = realloc(OutQueue, OutQueueSize * sizeof(UsbOutByte_t));
+    }
+    OutQueue[OutQueueTail].byte = (uint8_t)c;
+    OutQueue[OutQueueTail].visible_us = HostSim_NowUs() + BoardLatency_us;
+    OutQueueTail++;
+    return c;
+}
+
+void stdio_flush(void)
+{
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void*), void *param)
+{
+    CharsAvailable = fn;
+    CharsAvailableParam = param;
+    irq_set_exclusive_handler(USBCTRL_IRQ, UsbIrqHandler);
+    irq_set_enabled(USBCTRL_IRQ, true);
+}
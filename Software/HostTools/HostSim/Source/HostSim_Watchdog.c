@@ -0,0 +1,105 @@
+/* HostSim_Watchdog.c - watchdog model of the host simulation (chip reset handed to the reboot hook of the tool) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* SDK replacement includes */
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+
+#include "HostSim.h"
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static watchdog_hw_t HostSim_WatchdogRegs;
+static bool WatchdogEnabled, WatchdogCausedReboot;
+static uint32_t WatchdogDelay_us;
+static uint64_t WatchdogDeadline_us;
+static HostSim_RebootHook_t RebootHook;
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- HostSim interface ---- */
+
+void HostSim_SetRebootHook(HostSim_RebootHook_t hook)
+{
+    RebootHook = hook;
+}
+
+void HostSim_WatchdogSaveState(HostSim_PersistentState_t *state)
+{
+    memcpy(state->watchdogScratch, (const void*)HostSim_WatchdogRegs.scratch, sizeof(state->watchdogScratch));
+}
+
+void HostSim_WatchdogRestoreState(const HostSim_PersistentState_t *state)
+{
+    memcpy((void*)HostSim_WatchdogRegs.scratch, state->watchdogScratch, sizeof(state->watchdogScratch));
+    WatchdogCausedReboot = state->watchdogReset;
+}
+
+void HostSim_WatchdogUpdate(void)
+{
+    if(!WatchdogEnabled || (HostSim_NowUs() < WatchdogDeadline_us))
+    {
+        return;
+    }
+
+    /* Chip reset - only what survives it goes to the next boot */
+    HostSim_PersistentState_t state;
+    WatchdogEnabled = false;
+    HostSim_SaveState(&state);
+    state.watchdogReset = true;
+    HostSim_ChipReset(&state);
+}
+
+void HostSim_ChipReset(const HostSim_PersistentState_t *state)
+{
+    if(RebootHook == NULL)
+    {
+        fprintf(stderr, "HostSim: %s reset at %llu us\n", state->watchdogReset ? "watchdog" : "power-on",
+                (unsigned long long)state->time_us);
+        exit(3);
+    }
+    RebootHook(state);
+    fprintf(stderr, "HostSim: the reboot hook returned\n");
+    abort();
+}
+
+/* ---- Watchdog ---- */
+
+watchdog_hw_t* HostSim_WatchdogHw(void)
+{
+    return &HostSim_WatchdogRegs;
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+    (void)pause_on_debug;
+    WatchdogDelay_us = delay_ms * 1000U;
+    WatchdogEnabled = true;
+    watchdog_update();
+}
+
+void watchdog_update(void)
+{
+    WatchdogDeadline_us = HostSim_NowUs() + WatchdogDelay_us;
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+{
+    (void)pc;
+    (void)sp;
+    WatchdogDelay_us = delay_ms * 1000U;
+    WatchdogEnabled = true;
+    watchdog_update();
+    HostSim_WatchdogUpdate();
+}
+
+bool watchdog_caused_reboot(void)
+{
+    return WatchdogCausedReboot;
+}
@@ -0,0 +1,160 @@
+/* LightSensor.c - ambient light scenarios for the light sensor controlled schedule (firmware built with LIGHT_SENSOR_ENABLED).
+
+   Every scenario boots a fresh firmware image (own process) at a given wall clock time, drives the ADC input with a light
+   profile and reports when AutomaticControlTask moved the blinds compared to the computed sunrise/sunset, how often the
+   light level changed and how often the task ran. The samples are taken by the ADC/DMA model of HostSim, the filter
+   runs in the tick hook.
+
+   Usage: LightSensor
+   Exits with 1 if a scenario moved the blinds outside of its expected window. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "CycleCounter.h"
+#include "LightSensor.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define STEP_US                 (1000000ULL)
+#define MAX_PHASES              (4U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+/* Light profile - constant ADC counts from the given second of the scenario on */
+typedef struct
+{
+    uint32_t fromSecond;
+    uint16_t adcCounts;
+}LightPhase_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t startHour, startMinute;
+    uint8_t isClosed;               /* blinds state stored in the RTC at the start */
+    uint32_t duration_s;
+    LightPhase_t phases[MAX_PHASES];
+    uint32_t numOfPhases;
+    bool expectOpen;                /* expected move - open (anticlockwise) or close (clockwise) */
+    double expectedFrom_h;          /* expected window of the move in hours relative to the computed sunrise (open) or sunset (close) */
+    double expectedTo_h;
+}Scenario_t;
+
+typedef struct
+{
+    double move_h;                  /* wall clock time of the first motor start, -1 if none */
+    double sunrise, sunset;
+    uint32_t levelChanges;
+    uint32_t finalFiltered;
+    uint32_t automaticJobs;
+    uint64_t adcConversions;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Overcast morning - dark until 05:00, the blinds stay closed past sunrise until the light comes up */
+    { "overcast_morning", 4, 0, BLINDS_CLOSED, 5400, { {0, 150}, {3600, 1500} }, 2, true, 0.5, 1.0 },
+    /* Headlights - 3s of bright light in a dark morning must not count as daylight, the blinds open at the latest shifted time */
+    { "headlights",       4, 0, BLINDS_CLOSED, 5400, { {0, 150}, {600, 4000}, {603, 150} }, 3, true, 0.99, 1.02 },
+    /* Clear morning - normal light, the blinds open at sunrise */
+    { "clear_morning",    4, 0, BLINDS_CLOSED, 2700, { {0, 1500} }, 1, true, 0.0, 0.02 },
+    /* Bright evening - the blinds stay open past sunset until it gets dark */
+    { "bright_evening",  20, 30, BLINDS_OPEN,  5400, { {0, 3500}, {3000, 100} }, 2, false, 0.0, 1.0 },
+};
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint16_t LightAt(const Scenario_t *scenario, uint32_t second)
+{
+    uint16_t adcCounts = scenario->phases[0].adcCounts;
+    for(uint32_t p = 0; p < scenario->numOfPhases; p++)
+    {
+        if(second >= scenario->phases[p].fromSecond) adcCounts = scenario->phases[p].adcCounts;
+    }
+    return adcCounts;
+}
+
+static void RunScenario(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+    HostSim_RtcSetTime(2026, 6, 15, scenario->startHour, scenario->startMinute, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, scenario->isClosed);
+    HostSim_SetAdcInput(LIGHT_SENSOR_ADC_INPUT, LightAt(scenario, 0));
+    HostSim_Boot();
+
+    for(uint32_t second = 0; second < scenario->duration_s; second++)
+    {
+        HostSim_SetAdcInput(LIGHT_SENSOR_ADC_INPUT, LightAt(scenario, second));
+        HostSim_RunForUs(STEP_US);
+    }
+
+    /* Same calculation and DST correction as AutomaticControlTask (June - DST) */
+    CalculateSunriseSunset(LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, 166, TIME_ZONE_PLUS_TO_E, &result->sunrise, &result->sunset);
+
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    result->move_h = -1.0;
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if(log[i].motorControl1 || log[i].motorControl2)
+        {
+            result->move_h = scenario->startHour + (scenario->startMinute / 60.0) + (log[i].time_us / 3600e6);
+            bool opened = log[i].motorControl2;
+            if(opened != scenario->expectOpen) result->move_h = -2.0;
+            break;
+        }
+    }
+    result->levelChanges = LightLevelChanges;
+    result->finalFiltered = LightFiltered;
+    result->automaticJobs = CycleStats[CYCLES_TASK_AUTOMATIC_CONTROL].count;
+    result->adcConversions = HostSim_GetAdcConversions();
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-18s %9s %9s %9s %9s %7s %9s %6s %12s  %s\n", "scenario", "sunrise", "sunset", "moved", "vs sched", "levels", "filtered", "jobs", "adc samples", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(RunScenario, scenario, &result, sizeof(result)))
+        {
+            printf("%-18s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        double reference_h = scenario->expectOpen ? result.sunrise : result.sunset;
+        double offset_h = result.move_h - reference_h;
+        bool ok = (result.move_h >= 0.0) && (offset_h >= scenario->expectedFrom_h) && (offset_h <= scenario->expectedTo_h);
+        if(!ok) failures++;
+
+        char moved[16];
+        if(result.move_h >= 0.0) snprintf(moved, sizeof(moved), "%02d:%02d", (int)result.move_h, (int)((result.move_h - (int)result.move_h) * 60.0));
+        else snprintf(moved, sizeof(moved), "%s", (result.move_h < -1.5) ? "wrong" : "-");
+        printf("%-18s %6d:%02d %6d:%02d %9s %+8.0fm %7u %9u %6u %12llu  %s\n", scenario->name,
+               (int)result.sunrise, (int)((result.sunrise - (int)result.sunrise) * 60.0),
+               (int)result.sunset, (int)((result.sunset - (int)result.sunset) * 60.0),
+               moved, (result.move_h >= 0.0) ? offset_h * 60.0 : 0.0, (unsigned)result.levelChanges, (unsigned)result.finalFiltered,
+               (unsigned)result.automaticJobs, (unsigned long long)result.adcConversions, ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
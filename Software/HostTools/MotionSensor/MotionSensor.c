@@ -0,0 +1,157 @@
+/* MotionSensor.c - vibration scenarios of the MPU6050 motion sensor (firmware built with MOTION_SENSOR_ENABLED).
+
+   Every scenario boots a fresh firmware image (own process) at midday with the blinds open (no automatic move), sets the
+   vibration of the gear case with the motor on/off and holds the Down button for a while. Reported: how long the motor
+   ran, the jam/unexpected movement events of MotionSensorTask, the vibration energy it measured with the motor on/off,
+   and the I2C transactions with the sensor - during the button press (one motor run) and in total.
+
+   Usage: MotionSensor
+   Exits with 1 if a scenario reported the wrong events or a motor run took more than MAX_TRANSACTIONS_PER_RUN. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotionSensor.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US              (3000000ULL)
+#define STEP_US                     (10000ULL)
+#define MAX_TRANSACTIONS_PER_RUN    (64U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    const char *name;
+    double motorOn_mg, motorOff_mg;     /* vibration of the gear case */
+    uint32_t press_s;                   /* Down button held for that long (0 - not pressed) */
+    uint32_t after_s;                   /* run time after the release */
+    uint32_t expectedJams;
+    bool expectUnexpectedMove;
+    double maxMotorOn_s;                /* the motor has to stop before that (jam), or run the whole press */
+}Scenario_t;
+
+typedef struct
+{
+    double motorOn_s;
+    uint32_t jams, unexpectedMoves;
+    uint32_t minEnergyMotorOn, maxEnergyMotorOff;
+    uint64_t runTransactions, totalTransactions, bytes, overflows;
+    uint32_t firmwareTransactions, i2cErrors, samples;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Normal run - the gear case shakes while the motor runs and is still otherwise */
+    { "normal_run",     60.0,  0.0, 20, 10, 0, false, 21.0 },
+    /* Jam - the motor is powered but nothing turns, it is stopped after the settle and confirm windows */
+    { "jam",             0.0,  0.0, 20, 10, 1, false,  4.5 },
+    /* Slipping brake - the blind keeps moving after the motor stopped */
+    { "slipping",       60.0, 40.0, 10, 10, 0, true,  11.0 },
+    /* Idle - nothing moves, only the sensor noise */
+    { "idle",            0.0,  0.0,  0, 30, 0, false,  0.0 },
+};
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double MotorOnTime(void)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    double on_s = 0.0;
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if(log[i].motorControl1 || log[i].motorControl2)
+        {
+            uint64_t end_us = (i + 1U < length) ? log[i + 1U].time_us : HostSim_NowUs();
+            on_s += (end_us - log[i].time_us) / 1e6;
+        }
+    }
+    return on_s;
+}
+
+static void RunScenario(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    HostSim_SetVibration(scenario->motorOn_mg, scenario->motorOff_mg);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    uint64_t pressTransactions = HostSim_GetMpu6050Transactions();
+    if(scenario->press_s > 0U)
+    {
+        HostSim_SetInput(BUTTON_DOWN, true);
+        HostSim_RunForUs(scenario->press_s * 1000000ULL);
+        HostSim_SetInput(BUTTON_DOWN, false);
+    }
+    result->runTransactions = HostSim_GetMpu6050Transactions() - pressTransactions;
+    HostSim_RunForUs(scenario->after_s * 1000000ULL);
+
+    result->motorOn_s = MotorOnTime();
+    result->jams = MotionStats.jams;
+    result->unexpectedMoves = MotionStats.unexpectedMoves;
+    result->minEnergyMotorOn = MotionStats.minEnergyMotorOn;
+    result->maxEnergyMotorOff = MotionStats.maxEnergyMotorOff;
+    result->totalTransactions = HostSim_GetMpu6050Transactions();
+    result->bytes = HostSim_GetMpu6050Bytes();
+    result->overflows = HostSim_GetMpu6050Overflows();
+    result->firmwareTransactions = MotionStats.i2cTransactions;
+    result->i2cErrors = MotionStats.i2cErrors;
+    result->samples = MotionStats.samples;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-12s %8s %5s %6s %10s %10s %9s %9s %8s %8s %6s  %s\n", "scenario", "motor", "jams", "moves", "min E on", "max E off",
+           "i2c/run", "i2c/all", "bytes", "samples", "ovfl", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(RunScenario, scenario, &result, sizeof(result)))
+        {
+            printf("%-12s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        /* A normal run lasts the whole press (minus the button debouncing), a jammed one ends early */
+        bool ranAsExpected = (result.motorOn_s <= scenario->maxMotorOn_s) &&
+                             ((scenario->expectedJams > 0U) || (result.motorOn_s >= scenario->press_s * 0.9));
+        bool ok = ranAsExpected && (result.jams == scenario->expectedJams) &&
+                  ((result.unexpectedMoves > 0U) == scenario->expectUnexpectedMove) &&
+                  (result.runTransactions <= MAX_TRANSACTIONS_PER_RUN) && (result.overflows == 0U) && (result.i2cErrors == 0U) &&
+                  (result.firmwareTransactions == result.totalTransactions);
+        if(!ok) failures++;
+
+        char minEnergy[16];
+        if(result.minEnergyMotorOn == UINT32_MAX) snprintf(minEnergy, sizeof(minEnergy), "-");
+        else snprintf(minEnergy, sizeof(minEnergy), "%u", (unsigned)result.minEnergyMotorOn);
+        printf("%-12s %7.1fs %5u %6u %10s %10u %9llu %9llu %8llu %8u %6llu  %s\n", scenario->name, result.motorOn_s,
+               (unsigned)result.jams, (unsigned)result.unexpectedMoves, minEnergy, (unsigned)result.maxEnergyMotorOff,
+               (unsigned long long)result.runTransactions, (unsigned long long)result.totalTransactions,
+               (unsigned long long)result.bytes, (unsigned)result.samples, (unsigned long long)result.overflows, ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/* MotorArbitration.c - conflict scenarios of the motor command broker (MotorControllerTask.c), firmware built with 2 channels.
+
+   Every scenario boots a fresh firmware image (own process) and lets the sources of the commands - the buttons, the limit
+   switches, the USB link and AutomaticControlTask - fight over the motors. Reported: the motor states every channel went
+   through (C - clockwise, A - anticlockwise, - - off), the responses of the USB link and the counters of the broker, which
+   are also read back over the USB link (MOTOR_INFO).
+
+   Usage: MotorArbitration
+   Exits with 1 if a channel went through other states than expected or a counter stayed below its expected minimum. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+#include "UsbLink.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (3000000ULL)
+#define USB_RESPONSE_US         (20000ULL)
+#define MAX_SEQUENCE            (32U)
+#define MAX_RESPONSES           (64U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    char sequence[BLINDS_NUM_OF_CHANNELS][MAX_SEQUENCE];   /* motor states after the boot */
+    char responses[MAX_RESPONSES];                          /* of the MOTOR commands - A (#ACK) or D (#ERR dropped) */
+    MotorCommandStats_t stats;
+    bool infoMatches;                                       /* the MOTOR_INFO response shows the counters of the firmware */
+}Result_t;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(Result_t *result);
+    const char *expected[BLINDS_NUM_OF_CHANNELS];           /* NULL - not checked */
+    const char *expectedResponses;
+    MotorCommandStats_t minimum;                            /* counters: submitted, applied, coalesced, preempted, dropped, expired */
+}Scenario_t;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+static void ManualOverAutomatic(Result_t *result);
+static void AutomaticWhileHeld(Result_t *result);
+static void LimitWithHeldButton(Result_t *result);
+static void UsbRemote(Result_t *result);
+static void StaleStart(Result_t *result);
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Closing at night - the Up button takes channel 0 over from the automatic move, channel 1 keeps closing */
+    { "manual_over_automatic", ManualOverAutomatic, { "CA-", "C" }, "", { 0, 0, 0, 1, 0, 0 } },
+    /* The automatic close comes while the Up button of channel 0 is held - dropped there, channel 1 closes */
+    { "automatic_while_held",  AutomaticWhileHeld,  { "A-", "C" },  "", { 0, 0, 1, 0, 1, 0 } },
+    /* Down held into the bottom limit switch - the back-off takes over, the held button doesn't start the motor again */
+    { "limit_with_held_button", LimitWithHeldButton, { "CA-C-", "" }, "", { 0, 0, 1, 1, 0, 0 } },
+    /* Host moves channel 0, the Up button takes over - the host has to release before its next move is obeyed */
+    { "usb_remote",            UsbRemote,           { "CA-C-", "" }, "ADAAA", { 0, 0, 0, 1, 1, 0 } },
+    /* Host keeps reversing channel 0 - the start of channel 1 never gets its stagger slot and expires */
+    { "stale_start",           StaleStart,          { NULL, "" },   NULL, { 0, 0, 0, 0, 0, 1 } },
+};
+
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void Boot(uint32_t hour, uint8_t isClosed)
+{
+    uint32_t mask = 0;
+    for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+    {
+        mask |= (1u << SiteConfig->channels.motorControl1Gpio[channel]) | (1u << SiteConfig->channels.motorControl2Gpio[channel]);
+    }
+    HostSim_SetMotorLogMask(mask);
+    HostSim_RtcSetTime(2026, 6, 15, hour, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, isClosed);
+    HostSim_Boot();
+}
+
+static void Press(uint32_t gpio, uint64_t hold_us)
+{
+    HostSim_SetInput(gpio, true);
+    HostSim_RunForUs(hold_us);
+    HostSim_SetInput(gpio, false);
+}
+
+static void Remote(Result_t *result, uint8_t channel, MotorState_t state)
+{
+    uint8_t payload[2] = { channel, (uint8_t)state }, frame[USB_LINK_MAX_FRAME];
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame(USB_LINK_CMD_MOTOR, payload, sizeof(payload), frame));
+    char response = '?';
+    if(HostSim_UsbReadResponse(line, sizeof(line), USB_RESPONSE_US))
+    {
+        if(strncmp(line, "ACK", 3) == 0) response = 'A';
+        else if(strncmp(line, "ERR dropped", 11) == 0) response = 'D';
+    }
+    size_t length = strlen(result->responses);
+    if(length < (sizeof(result->responses) - 1U))
+    {
+        result->responses[length] = response;
+        result->responses[length + 1U] = '\0';
+    }
+}
+
+static void ReadInfo(Result_t *result)
+{
+    uint8_t frame[USB_LINK_MAX_FRAME];
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    unsigned long counters[6];
+
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame(USB_LINK_CMD_MOTOR_INFO, NULL, 0U, frame));
+    result->infoMatches = HostSim_UsbReadResponse(line, sizeof(line), USB_RESPONSE_US) &&
+                          (sscanf(line, "MOTOR %lu %lu %lu %lu %lu %lu", &counters[0], &counters[1], &counters[2], &counters[3],
+                                  &counters[4], &counters[5]) == 6);
+    /* The MOTOR_INFO command itself changes nothing */
+    result->stats = MotorCommandStats;
+    result->infoMatches = result->infoMatches && (counters[0] == MotorCommandStats.submitted) && (counters[1] == MotorCommandStats.applied) &&
+                          (counters[2] == MotorCommandStats.coalesced) && (counters[3] == MotorCommandStats.preempted) &&
+                          (counters[4] == MotorCommandStats.dropped) && (counters[5] == MotorCommandStats.expired);
+}
+
+/* Motor states of every channel from the output log */
+static void Sequences(Result_t *result)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    char last[BLINDS_NUM_OF_CHANNELS];
+
+    memset(last, '-', sizeof(last));
+    for(uint32_t i = 0; i < length; i++)
+    {
+        for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+        {
+            bool mc1 = (log[i].outputs >> SiteConfig->channels.motorControl1Gpio[channel]) & 1u;
+            bool mc2 = (log[i].outputs >> SiteConfig->channels.motorControl2Gpio[channel]) & 1u;
+            char state = (mc1 && mc2) ? '!' : (mc1 ? 'C' : (mc2 ? 'A' : '-'));
+            size_t fill = strlen(result->sequence[channel]);
+            if((state != last[channel]) && (fill < (MAX_SEQUENCE - 1U)))
+            {
+                result->sequence[channel][fill] = state;
+                last[channel] = state;
+            }
+        }
+    }
+}
+
+/* The process of a scenario - the broker of a fresh firmware image, the motor states from the output log */
+static void RunScenario(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+
+    memset(result, 0, sizeof(*result));
+    scenario->run(result);
+    Sequences(result);
+}
+
+/* ---- Scenarios ---- */
+
+static void ManualOverAutomatic(Result_t *result)
+{
+    Boot(23, BLINDS_OPEN);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    Press(BUTTON_UP, 2000000ULL);
+    HostSim_RunForUs(2000000ULL);
+    ReadInfo(result);
+}
+
+static void AutomaticWhileHeld(Result_t *result)
+{
+    Boot(23, BLINDS_CLOSED);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    HostSim_SetInput(BUTTON_UP, true);
+    HostSim_RunForUs(1000000ULL);
+    /* Open again - the next run of AutomaticControlTask closes */
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    HostSim_RunForUs((AUTOMATIC_CONTROL_TASK_PERIOD * 1000ULL) + 2000000ULL);
+    HostSim_SetInput(BUTTON_UP, false);
+    HostSim_RunForUs(2000000ULL);
+    ReadInfo(result);
+}
+
+static void LimitWithHeldButton(Result_t *result)
+{
+    Boot(12, BLINDS_OPEN);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    HostSim_SetInput(BUTTON_DOWN, true);
+    HostSim_RunForUs(1000000ULL);
+    Press(BUTTON_BOTTOM_LIMIT, 300000ULL);
+    HostSim_RunForUs(3000000ULL);
+    HostSim_SetInput(BUTTON_DOWN, false);
+    HostSim_RunForUs(1000000ULL);
+    Press(BUTTON_DOWN, 1000000ULL);
+    HostSim_RunForUs(1000000ULL);
+    ReadInfo(result);
+}
+
+static void UsbRemote(Result_t *result)
+{
+    Boot(12, BLINDS_OPEN);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    Remote(result, 0U, STATE_CLOCKWISE);
+    HostSim_RunForUs(1000000ULL);
+    Press(BUTTON_UP, 1000000ULL);
+    HostSim_RunForUs(1000000ULL);
+    Remote(result, 0U, STATE_CLOCKWISE);
+    HostSim_RunForUs(1000000ULL);
+    Remote(result, 0U, STATE_OFF);
+    Remote(result, 0U, STATE_CLOCKWISE);
+    HostSim_RunForUs(1000000ULL);
+    Remote(result, 0U, STATE_OFF);
+    HostSim_RunForUs(1000000ULL);
+    ReadInfo(result);
+}
+
+static void StaleStart(Result_t *result)
+{
+    Boot(12, BLINDS_OPEN);
+    HostSim_RunForUs(BOOT_SETTLE_US);
+    Remote(result, 0U, STATE_CLOCKWISE);
+    Remote(result, 1U, STATE_CLOCKWISE);
+    for(uint32_t i = 0; i < 10U; i++)
+    {
+        HostSim_RunForUs(200000ULL);
+        Remote(result, 0U, ((i & 1U) == 0U) ? STATE_ANTICLOCKWISE : STATE_CLOCKWISE);
+    }
+    Remote(result, 0U, STATE_OFF);
+    HostSim_RunForUs(1000000ULL);
+    ReadInfo(result);
+}
+
+static bool StatsReached(const MotorCommandStats_t *stats, const MotorCommandStats_t *minimum)
+{
+    return (stats->submitted >= minimum->submitted) && (stats->applied >= minimum->applied) && (stats->coalesced >= minimum->coalesced) &&
+           (stats->preempted >= minimum->preempted) && (stats->dropped >= minimum->dropped) && (stats->expired >= minimum->expired);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-23s %-10s %-10s %-14s %6s %6s %6s %6s %6s %6s  %s\n", "scenario", "channel 0", "channel 1", "usb", "submit", "apply",
+           "coalsc", "preemp", "drop", "expire", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(RunScenario, scenario, &result, sizeof(result)))
+        {
+            printf("%-23s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        bool ok = result.infoMatches && StatsReached(&result.stats, &scenario->minimum) &&
+                  ((scenario->expectedResponses == NULL) || (strcmp(result.responses, scenario->expectedResponses) == 0));
+        for(uint32_t channel = 0; channel < BLINDS_NUM_OF_CHANNELS; channel++)
+        {
+            ok = ok && ((scenario->expected[channel] == NULL) || (strcmp(result.sequence[channel], scenario->expected[channel]) == 0));
+        }
+        if(!ok) failures++;
+
+        printf("%-23s %-10s %-10s %-14s %6u %6u %6u %6u %6u %6u  %s\n", scenario->name, result.sequence[0], result.sequence[1],
+               result.responses, (unsigned)result.stats.submitted, (unsigned)result.stats.applied, (unsigned)result.stats.coalesced,
+               (unsigned)result.stats.preempted, (unsigned)result.stats.dropped, (unsigned)result.stats.expired, ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,477 @@
+/* NodeBus.c - controllers of a house on the node bus (NodeBus.c of the firmware, built with NODE_BUS_ENABLED=1).
+
+   Every node is a firmware image in its own process, paced to the clock of the host (HostSim_SetRealTime), with its UART0 on a
+   pseudo-terminal. The parent is the RS-485 line: every byte a node sends goes to all the other nodes as soon as it is read.
+   All the nodes boot unpaced to the same virtual time and are paced from a common host time on, so the virtual times of the
+   motor logs of different nodes are comparable (up to the scheduling of the host, all the nodes share its processors).
+
+   Per number of nodes: the USB link of node 1 moves the south group (the odd addresses), stops it with a broadcast, moves the
+   last node alone (unicast) and pings it. Then the schedule of a leader closes the blinds of all the nodes at night. Reported:
+   the time from the frame in to the start of the motors on the clock of every node (the firmware alone), from the frame out of
+   node 1 (the line and the scheduling of the host too), the spread of the motor starts, the round trip of the ping, the frames
+   every node saw and the bad ones (collisions, lost bytes). All the nodes boot at the same time, their ticks are in phase.
+
+   Usage: NodeBus [max nodes]   (2..16, 16 by default)
+   Exits with 1 if a node moved when it was not addressed, did not move when it was, started later than a frame time after the
+   frame came in, the ping was not answered or a frame was lost. */
+
+/*---------------- INCLUDES ----------------------*/
+
+#define _GNU_SOURCE                         /* posix_openpt, ptsname, cfmakeraw */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "NodeBus.h"
+#include "UsbLink.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MIN_NODES               (2U)
+#define MAX_NODES               (16U)
+#define GROUP_SOUTH             (0U)
+#define GROUP_NORTH             (1U)
+#define USB_RESPONSE_US         (100000ULL)
+#define FRAME_WAIT_US           (20000ULL)
+#define BOOT_BUDGET_NS          (400000000ULL)      /* host time of the unpaced boot of a node */
+
+/* Virtual times - the remote moves at noon (the schedule leaves the blinds open), the leader at night */
+#define REMOTE_START_US         (10000000ULL)
+#define GROUP_MOVE_US           (REMOTE_START_US + 200000ULL)
+#define STOP_US                 (REMOTE_START_US + 500000ULL)
+#define UNICAST_MOVE_US         (REMOTE_START_US + 800000ULL)
+#define PING_US                 (REMOTE_START_US + 1100000ULL)
+#define REMOTE_END_US           (REMOTE_START_US + 1400000ULL)
+#define SCHEDULE_START_US       (53000000ULL)       /* the second run of AutomaticControlTask is 50s after the boot */
+#define SCHEDULE_END_US         (55500000ULL)
+
+/* MOVE frame on the wire - header, 3 bytes of payload and the CRC, COBS overhead byte and delimiter */
+#define MOVE_FRAME_BYTES        (NODE_BUS_HEADER_SIZE + 3U + NODE_BUS_CRC_SIZE + 2U)
+#define MOVE_FRAME_US           ((MOVE_FRAME_BYTES * 10U * 1000000U) / NODE_BUS_BAUD_RATE)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    PHASE_GROUP,                            /* node 1 moves the south group */
+    PHASE_UNICAST,                          /* node 1 moves the last node */
+    PHASE_SCHEDULE,                         /* the leader closes at night */
+    NUM_OF_PHASES
+}Phase_t;
+
+typedef struct
+{
+    bool done;
+    uint64_t motorOn_us[NUM_OF_PHASES];     /* first motor start of the phase, 0 - none */
+    uint32_t starts[NUM_OF_PHASES];         /* motor starts in the phase */
+    uint64_t frameEnd_us[NUM_OF_PHASES];    /* the sender: last byte of the MOVE frame out of the UART */
+    uint64_t frameIn_us[NUM_OF_PHASES];     /* the receivers: last byte of the MOVE frame in (the clock of the node) */
+    bool acked;                             /* the sender: all its USB commands answered with #ACK */
+    bool pinged;                            /* the sender: #PONG of the last node */
+    uint32_t roundTrip_us;
+    unsigned long info[9];                  /* BUS_INFO - address groups leader rx other bad tx dropped moves */
+    HostSim_UartStats_t uart;
+}NodeResult_t;
+
+typedef struct
+{
+    uint64_t start_ns;                      /* CLOCK_MONOTONIC of the common virtual start */
+    uint64_t hubBytes;
+    NodeResult_t nodes[MAX_NODES];
+}Shared_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static Shared_t *Shared;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint64_t MonotonicNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+static uint8_t GroupsOf(uint32_t node)
+{
+    /* Addresses 1, 3, 5... face south */
+    return (uint8_t)(1u << (((node % 2U) == 0U) ? GROUP_SOUTH : GROUP_NORTH));
+}
+
+static bool Command(UsbLinkCommand_t command, const uint8_t *payload, uint32_t length, char *line, uint32_t size)
+{
+    uint8_t frame[USB_LINK_MAX_FRAME];
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame(command, payload, length, frame));
+    return HostSim_UsbReadResponse(line, size, USB_RESPONSE_US);
+}
+
+/* BUS_MOVE over the USB link of this node - the time the last byte of the frame left the UART */
+static bool RemoteMove(uint8_t destination, MotorState_t state, uint64_t *frameEnd_us)
+{
+    uint8_t payload[3] = { destination, (uint8_t)NODE_BUS_ALL_CHANNELS, (uint8_t)state };
+    uint8_t frame[USB_LINK_MAX_FRAME];
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint64_t sent = HostSim_GetUartStats(0U)->txBytes + MOVE_FRAME_BYTES;
+    uint64_t deadline = HostSim_NowUs() + FRAME_WAIT_US;
+
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame(USB_LINK_CMD_BUS_MOVE, payload, sizeof(payload), frame));
+    while((HostSim_GetUartStats(0U)->txBytes < sent) && (HostSim_NowUs() < deadline))
+    {
+        HostSim_RunForUs(10U);
+    }
+    *frameEnd_us = HostSim_NowUs();
+    return HostSim_UsbReadResponse(line, sizeof(line), USB_RESPONSE_US) && (strncmp(line, "ACK", 3) == 0);
+}
+
+static void LoggedStarts(NodeResult_t *result, Phase_t phase, uint64_t from_us, uint64_t to_us)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t count = HostSim_GetMotorLog(&log);
+    bool on = false;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        bool running = (log[i].motorControl1 != 0U) || (log[i].motorControl2 != 0U);
+        if((log[i].time_us >= from_us) && (log[i].time_us < to_us) && running && !on)
+        {
+            if(result->starts[phase]++ == 0U) result->motorOn_us[phase] = log[i].time_us;
+        }
+        on = running;
+    }
+}
+
+/* Runs until the bytes of the frame are in or the time - the time its last byte came in, 0 if it did not */
+static uint64_t FrameIn(uint64_t rxBytes, uint64_t until_us)
+{
+    while((HostSim_GetUartStats(0U)->rxBytes < rxBytes) && (HostSim_NowUs() < until_us))
+    {
+        HostSim_RunForUs(100U);
+    }
+    return (HostSim_GetUartStats(0U)->rxBytes >= rxBytes) ? HostSim_GetUartStats(0U)->lastRx_us : 0U;
+}
+
+/* Boots unpaced to the start, then runs paced by the host clock from the common start time with UART0 on the line */
+static void Node(uint32_t node, uint32_t nodes, int line, bool night)
+{
+    NodeResult_t *result = &Shared->nodes[node];
+    uint64_t start_us = night ? SCHEDULE_START_US : REMOTE_START_US;
+    uint64_t end_us = night ? SCHEDULE_END_US : REMOTE_END_US;
+    char response[UPDATE_PROTOCOL_MAX_LINE];
+
+    HostSim_RtcSetTime(2026, 6, 15, night ? 23 : 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, 0U);
+    HostSim_Boot();
+    HostSim_RunUntilUs(start_us - 1000000ULL);
+
+    /* Node 1 leads the schedule */
+    uint8_t config[3] = { (uint8_t)(node + 1U), GroupsOf(node), (night && (node == 0U)) ? 1U : 0U };
+    result->acked = Command(USB_LINK_CMD_BUS_CONFIG, config, sizeof(config), response, sizeof(response)) &&
+                    (strncmp(response, "ACK", 3) == 0);
+
+    HostSim_UartAttach(0U, line);
+    HostSim_SetRealTime(Shared->start_ns - (start_us * 1000ULL));
+    HostSim_RunUntilUs(start_us);
+
+    if(night)
+    {
+        /* Only the frame of the leader on the line */
+        result->frameIn_us[PHASE_SCHEDULE] = FrameIn(MOVE_FRAME_BYTES, end_us);
+        HostSim_RunUntilUs(end_us);
+    }
+    else
+    {
+        bool sender = (node == 0U);
+        HostSim_RunUntilUs(GROUP_MOVE_US);
+        if(sender) result->acked = RemoteMove(NODE_BUS_GROUP_FLAG | GROUP_SOUTH, STATE_CLOCKWISE, &result->frameEnd_us[PHASE_GROUP]) &&
+                                   result->acked;
+        /* The receivers get every frame - the group move, the stop, the unicast move */
+        if(!sender) result->frameIn_us[PHASE_GROUP] = FrameIn(MOVE_FRAME_BYTES, STOP_US);
+        HostSim_RunUntilUs(STOP_US);
+        uint64_t unused;
+        if(sender) result->acked = RemoteMove(NODE_BUS_BROADCAST, STATE_OFF, &unused) && result->acked;
+        HostSim_RunUntilUs(UNICAST_MOVE_US);
+        if(sender) result->acked = RemoteMove((uint8_t)nodes, STATE_ANTICLOCKWISE, &result->frameEnd_us[PHASE_UNICAST]) && result->acked;
+        if(!sender) result->frameIn_us[PHASE_UNICAST] = FrameIn(3U * MOVE_FRAME_BYTES, PING_US);
+        HostSim_RunUntilUs(PING_US);
+        if(sender)
+        {
+            uint8_t address = (uint8_t)nodes;
+            unsigned long pong[3];
+            result->pinged = Command(USB_LINK_CMD_BUS_PING, &address, 1U, response, sizeof(response)) &&
+                             (sscanf(response, "PONG %lu %lu %lu", &pong[0], &pong[1], &pong[2]) == 3) && (pong[0] == nodes);
+            result->roundTrip_us = result->pinged ? (uint32_t)pong[2] : 0U;
+        }
+        HostSim_RunUntilUs(end_us);
+    }
+
+    result->acked = Command(USB_LINK_CMD_BUS_INFO, NULL, 0U, response, sizeof(response)) &&
+                    (sscanf(response, "BUS %lu %lu %lu %lu %lu %lu %lu %lu %lu", &result->info[0], &result->info[1], &result->info[2],
+                            &result->info[3], &result->info[4], &result->info[5], &result->info[6], &result->info[7],
+                            &result->info[8]) == 9) && result->acked;
+    if(night)
+    {
+        LoggedStarts(result, PHASE_SCHEDULE, start_us, end_us);
+    }
+    else
+    {
+        LoggedStarts(result, PHASE_GROUP, GROUP_MOVE_US, STOP_US);
+        LoggedStarts(result, PHASE_UNICAST, UNICAST_MOVE_US, PING_US);
+    }
+    result->uart = *HostSim_GetUartStats(0U);
+    result->done = true;
+}
+
+/* The line - every chunk read from a node is written to all the others */
+static void Hub(const int *masters, uint32_t nodes, const pid_t *pids)
+{
+    struct pollfd fds[MAX_NODES];
+    uint32_t running = nodes;
+
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        fds[node].fd = masters[node];
+        fds[node].events = POLLIN;
+    }
+    while(running > 0U)
+    {
+        if(poll(fds, nodes, 10) > 0)
+        {
+            for(uint32_t node = 0; node < nodes; node++)
+            {
+                if((fds[node].revents & POLLIN) == 0) continue;
+                uint8_t chunk[256];
+                ssize_t length = read(masters[node], chunk, sizeof(chunk));
+                if(length <= 0) continue;
+                Shared->hubBytes += (uint64_t)length;
+                for(uint32_t other = 0; other < nodes; other++)
+                {
+                    if(other == node) continue;
+                    ssize_t written = 0;
+                    while(written < length)
+                    {
+                        ssize_t n = write(masters[other], &chunk[written], (size_t)(length - written));
+                        if(n > 0) written += n;
+                        else if((errno != EINTR) && (errno != EAGAIN)) break;
+                    }
+                }
+            }
+        }
+        for(uint32_t node = 0; node < nodes; node++)
+        {
+            if((pids[node] > 0) && (waitpid(pids[node], NULL, WNOHANG) == pids[node]))
+            {
+                running--;
+            }
+        }
+    }
+}
+
+/* One run of the nodes on the line - false if the simulation failed */
+static bool RunBus(uint32_t nodes, bool night)
+{
+    int masters[MAX_NODES], slaves[MAX_NODES];
+    pid_t pids[MAX_NODES] = { 0 };
+
+    memset(Shared, 0, sizeof(*Shared));
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        masters[node] = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if((masters[node] < 0) || (grantpt(masters[node]) != 0) || (unlockpt(masters[node]) != 0))
+        {
+            perror("posix_openpt");
+            return false;
+        }
+        /* Raw 8-bit line, the parent keeps the slave open (no hang-up when a node exits first) */
+        slaves[node] = open(ptsname(masters[node]), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        struct termios tio;
+        if((slaves[node] < 0) || (tcgetattr(slaves[node], &tio) != 0))
+        {
+            perror("pseudo-terminal");
+            return false;
+        }
+        cfmakeraw(&tio);
+        tcsetattr(slaves[node], TCSANOW, &tio);
+    }
+
+    Shared->start_ns = MonotonicNs() + (BOOT_BUDGET_NS * nodes);
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        pids[node] = fork();
+        if(pids[node] == 0)
+        {
+            for(uint32_t other = 0; other < nodes; other++)
+            {
+                close(masters[other]);
+                if(other != node) close(slaves[other]);
+            }
+            Node(node, nodes, slaves[node], night);
+            _exit(0);
+        }
+    }
+    Hub(masters, nodes, pids);
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        close(masters[node]);
+        close(slaves[node]);
+    }
+
+    bool done = true;
+    for(uint32_t node = 0; node < nodes; node++) done = done && Shared->nodes[node].done;
+    return done;
+}
+
+static bool Addressed(Phase_t phase, uint32_t node, uint32_t nodes)
+{
+    switch(phase)
+    {
+        case PHASE_GROUP:   return (GroupsOf(node) & (1u << GROUP_SOUTH)) != 0U;
+        case PHASE_UNICAST: return (node + 1U) == nodes;
+        default:            return true;
+    }
+}
+
+/* Checks a phase, prints its line - false if a node moved when it should not have, missed a move or was late */
+static bool ReportPhase(const char *name, Phase_t phase, uint32_t nodes)
+{
+    /* The remote moves from the end of the frame node 1 sent, the schedule from the start of the leader */
+    uint64_t reference = (phase == PHASE_SCHEDULE) ? Shared->nodes[0].motorOn_us[phase] : Shared->nodes[0].frameEnd_us[phase];
+    uint64_t first = UINT64_MAX, last = 0;
+    int64_t minLocal = INT64_MAX, maxLocal = INT64_MIN, minLine = INT64_MAX, maxLine = INT64_MIN;
+    uint32_t moved = 0, wrong = 0, addressed = 0;
+
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        const NodeResult_t *result = &Shared->nodes[node];
+        bool shouldMove = Addressed(phase, node, nodes);
+        addressed += shouldMove ? 1U : 0U;
+        if(result->starts[phase] == 0U)
+        {
+            wrong += shouldMove ? 1U : 0U;
+            continue;
+        }
+        if(!shouldMove || (result->starts[phase] != 1U)) wrong++;
+        if(!shouldMove) continue;
+        moved++;
+        /* The sender applies its own remote move before the frame is out - not on the bus */
+        if((node == 0U) && (phase != PHASE_SCHEDULE)) continue;
+        if(result->motorOn_us[phase] < first) first = result->motorOn_us[phase];
+        if(result->motorOn_us[phase] > last) last = result->motorOn_us[phase];
+        if(node == 0U) continue;
+
+        /* From the frame in on the clock of the node - the firmware alone, and from the frame out of the sender - the host too */
+        int64_t local = (int64_t)(result->motorOn_us[phase] - result->frameIn_us[phase]);
+        int64_t line = (int64_t)(result->motorOn_us[phase] - reference);
+        if(local < minLocal) minLocal = local;
+        if(local > maxLocal) maxLocal = local;
+        if(line < minLine) minLine = line;
+        if(line > maxLine) maxLine = line;
+    }
+
+    /* A poll period of NodeBusTask and the wake-up of MotorControllerTask - within a frame time of the frame */
+    bool ok = (wrong == 0U) && (moved == addressed) && (reference != 0U) &&
+              ((maxLocal == INT64_MIN) || ((minLocal >= 0) && (maxLocal <= (int64_t)MOVE_FRAME_US)));
+    printf("%5u  %-9s %5u/%-3u %6lld %6lld %6lld %6lld %6llu  %s\n", (unsigned)nodes, name, (unsigned)moved, (unsigned)addressed,
+           (long long)((minLocal == INT64_MAX) ? 0 : minLocal), (long long)((maxLocal == INT64_MIN) ? 0 : maxLocal),
+           (long long)((minLine == INT64_MAX) ? 0 : minLine), (long long)((maxLine == INT64_MIN) ? 0 : maxLine),
+           (unsigned long long)((first <= last) ? (last - first) : 0U), ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/* Frames and the line of every node - false on a bad frame, an overrun, a lost frame or an unanswered command */
+static bool ReportFrames(uint32_t nodes, unsigned long expected)
+{
+    unsigned long minRx = ULONG_MAX, bad = 0, overruns = 0;
+    bool acked = true;
+
+    for(uint32_t node = 0; node < nodes; node++)
+    {
+        const NodeResult_t *result = &Shared->nodes[node];
+        /* Frames seen - for this node and for the others */
+        unsigned long seen = result->info[3] + result->info[4] + result->info[6];
+        if(seen < minRx) minRx = seen;
+        bad += result->info[5];
+        overruns += result->uart.overruns;
+        acked = acked && result->acked;
+    }
+    bool ok = acked && (bad == 0U) && (overruns == 0U) && (minRx >= expected);
+    printf("%5u  frames    seen %lu of %lu (least of the nodes), bad %lu, overruns %lu, hub %llu bytes  %s\n", (unsigned)nodes,
+           minRx, expected, bad, overruns, (unsigned long long)Shared->hubBytes, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char *argv[])
+{
+    uint32_t maxNodes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : MAX_NODES;
+    uint32_t failures = 0;
+
+    if((maxNodes < MIN_NODES) || (maxNodes > MAX_NODES))
+    {
+        fprintf(stderr, "Usage: %s [max nodes]   (%u..%u)\n", argv[0], MIN_NODES, MAX_NODES);
+        return 1;
+    }
+    Shared = mmap(NULL, sizeof(*Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(Shared == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("MOVE frame %u bytes, %uus on the wire at %u baud. Motor starts after the frame came in (the clock of the node) and after\n"
+           "the frame left node 1 (the remote moves) or the leader started its own motor (the schedule), spread of the starts\n",
+           MOVE_FRAME_BYTES, (unsigned)MOVE_FRAME_US, (unsigned)NODE_BUS_BAUD_RATE);
+    printf("%5s  %-9s %9s %13s %13s %6s\n", "nodes", "move", "moved", "in->start us", "out->start us", "spread");
+    for(uint32_t nodes = MIN_NODES; nodes <= maxNodes; nodes *= 2U)
+    {
+        if(!RunBus(nodes, false))
+        {
+            printf("%5u  simulation crashed\n", (unsigned)nodes);
+            failures++;
+            continue;
+        }
+        failures += ReportPhase("group", PHASE_GROUP, nodes) ? 0U : 1U;
+        failures += ReportPhase("unicast", PHASE_UNICAST, nodes) ? 0U : 1U;
+        bool pinged = Shared->nodes[0].pinged;
+        printf("%5u  ping      node %u round trip %uus  %s\n", (unsigned)nodes, (unsigned)nodes,
+               (unsigned)Shared->nodes[0].roundTrip_us, pinged ? "ok" : "UNEXPECTED");
+        failures += pinged ? 0U : 1U;
+        /* group move, stop, unicast move, ping and pong */
+        failures += ReportFrames(nodes, 5U) ? 0U : 1U;
+
+        if(!RunBus(nodes, true))
+        {
+            printf("%5u  simulation crashed\n", (unsigned)nodes);
+            failures++;
+            continue;
+        }
+        failures += ReportPhase("schedule", PHASE_SCHEDULE, nodes) ? 0U : 1U;
+        failures += ReportFrames(nodes, 1U) ? 0U : 1U;
+    }
+    printf("Standalone schedules: every node on its own DS1307, up to a period of AutomaticControlTask (%us) plus the drift apart\n",
+           (unsigned)(AUTOMATIC_CONTROL_TASK_PERIOD / 1000U));
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+/* Plant.c - motor, gear case and blind model stepped at a fixed timestep (see Plant.h)
+
+   H-bridge and motor - H-bridge_circuit_FALSTAD_EXPORT.txt:
+     - the MOSFETs (f ... 1.5 0.02): threshold 1.5V, beta 0.02A/V^2, the gates driven to 0V/12V by the NPN level shifters,
+       so a conducting MOSFET is 1 / (beta * (12V - 1.5V)) = 4.76 Ohm and there are two of them in the motor circuit
+     - the DC motor (415 ... 0.5 1 0.15 0.15 0.02 0.05): 0.5H, 1 Ohm, 0.15Nm/A, 0.15Vs/rad, 0.02kgm^2, 0.05Nms
+   The MOSFET switching and the body diodes are not modelled - the gate pull-ups switch in microseconds, the bridge never
+   leaves the motor open, so the current always has the path through the bridge.
+
+   Gear case and blind - not recorded anywhere but in the printed parts (GearCase.stl, BlindsShaftAdapter.stl), so the
+   defaults are assumed: a 4:1 reduction, a 20mm roller with 1.2m of fabric. The friction holds the blind at any position
+   with the motor off, like the real one does. The defaults give 80s (down) to 2 minutes (up) for the full travel. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <math.h>
+#include <string.h>
+
+#include "Plant.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define GRAVITY_MPS2                (9.81)
+#define CURRENT_AT_REST_A           (1e-6)      /* a decaying current below this is zero - lets the model come to rest */
+#define TWO_PI                      (6.283185307179586)
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t Random(Plant_t *plant)
+{
+    /* xorshift32 - the contact chatter is the same in every run */
+    plant->random ^= plant->random << 13;
+    plant->random ^= plant->random >> 17;
+    plant->random ^= plant->random << 5;
+    return plant->random;
+}
+
+static double GravityTorque(const Plant_t *plant, double position_m)
+{
+    double hanging_m = (position_m > 0.0) ? position_m : 0.0;
+    return plant->barTorque_Nm + (plant->fabricTorquePerM_Nm * hanging_m);
+}
+
+/* Contact of a switch from the position (with the hysteresis) and its input level (with the chatter after a change) */
+static void UpdateSwitch(Plant_t *plant, bool nowPressed, bool *pressed, bool *level, uint64_t *bounceEnd_us, uint32_t *presses)
+{
+    if(nowPressed != *pressed)
+    {
+        *pressed = nowPressed;
+        *bounceEnd_us = plant->time_us + plant->params.switchBounce_us;
+        if(nowPressed) (*presses)++;
+    }
+    bool newLevel = (plant->time_us < *bounceEnd_us) ? ((Random(plant) & 1u) != 0U) : *pressed;
+    if(newLevel != *level)
+    {
+        *level = newLevel;
+        plant->stats.switchEdges++;
+    }
+}
+
+/* Count of the encoder at the position of the blind and its A/B levels - B:A goes 00, 10, 11, 01 counting up */
+static void UpdateEncoder(Plant_t *plant)
+{
+    if(plant->params.encoderCountsPerTurn == 0U)
+    {
+        return;
+    }
+    static const uint8_t phases[4] = { 0x0u, 0x2u, 0x3u, 0x1u };
+    double metersPerCount = (TWO_PI * plant->params.rollerRadius_m) / (double)plant->params.encoderCountsPerTurn;
+    plant->encoderCount = (int32_t)floor(plant->position_m / metersPerCount);
+
+    uint8_t phase = phases[(uint32_t)plant->encoderCount & 3U];
+    bool a = (phase & 1u) != 0U, b = (phase & 2u) != 0U;
+    if((a != plant->encoderA) || (b != plant->encoderB))
+    {
+        plant->stats.encoderEdges += ((a != plant->encoderA) ? 1U : 0U) + ((b != plant->encoderB) ? 1U : 0U);
+        plant->encoderA = a;
+        plant->encoderB = b;
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Plant_DefaultParams(Plant_Params_t *params)
+{
+    memset(params, 0, sizeof(*params));
+
+    params->supply_V = 12.0;
+    params->switchOn_ohm = 1.0 / (0.02 * (12.0 - 1.5));
+    params->series_ohm = 0.0;
+
+    params->inductance_H = 0.5;
+    params->resistance_ohm = 1.0;
+    params->torqueConstant_NmPerA = 0.15;
+    params->backEmfConstant_VsPerRad = 0.15;
+    params->rotorInertia_kgm2 = 0.02;
+    params->viscousFriction_Nms = 0.05;
+
+    params->gearRatio = 4.0;
+
+    params->rollerRadius_m = 0.02;
+    params->rollerInertia_kgm2 = 0.0005;
+    params->barMass_kg = 0.3;
+    params->fabricMass_kg = 0.4;
+    params->staticFriction_Nm = 0.2;
+    params->kineticFriction_Nm = 0.15;
+
+    params->bottomStop_m = 1.2;
+    params->topSwitch_m = 0.01;
+    params->bottomSwitch_m = 1.19;
+    params->switchHysteresis_m = 0.001;
+    params->switchBounce_us = 1000U;
+
+    params->encoderCountsPerTurn = 2400U;   /* a 600 line encoder */
+    params->step_us = PLANT_DEFAULT_STEP_US;
+}
+
+void Plant_Init(Plant_t *plant, const Plant_Params_t *params, double position_m, uint64_t time_us)
+{
+    memset(plant, 0, sizeof(*plant));
+    plant->params = *params;
+
+    /* Everything the step needs at the motor shaft */
+    double n = params->gearRatio;
+    double blindInertia = params->rollerInertia_kgm2 +
+                          ((params->barMass_kg + params->fabricMass_kg) * params->rollerRadius_m * params->rollerRadius_m);
+    plant->dt_s = (double)params->step_us * 1e-6;
+    plant->dtOverL = plant->dt_s / params->inductance_H;
+    plant->circuit_ohm = params->resistance_ohm + (2.0 * params->switchOn_ohm) + params->series_ohm;
+    plant->dtOverJ = plant->dt_s / (params->rotorInertia_kgm2 + (blindInertia / (n * n)));
+    plant->metersPerRad = params->rollerRadius_m / n;
+    plant->barTorque_Nm = params->barMass_kg * GRAVITY_MPS2 * plant->metersPerRad;
+    plant->fabricTorquePerM_Nm = (params->fabricMass_kg / params->bottomStop_m) * GRAVITY_MPS2 * plant->metersPerRad;
+    plant->staticFriction_Nm = params->staticFriction_Nm / n;
+    plant->kineticFriction_Nm = params->kineticFriction_Nm / n;
+
+    plant->time_us = time_us;
+    plant->position_m = position_m;
+    plant->stats.minPosition_m = plant->stats.maxPosition_m = position_m;
+    plant->random = 0x9E3779B9u;
+    plant->topPressed = plant->topLevel = (position_m < params->topSwitch_m);
+    plant->bottomPressed = plant->bottomLevel = (position_m > params->bottomSwitch_m);
+    UpdateEncoder(plant);
+    plant->stats.encoderEdges = 0U;
+}
+
+void Plant_SetBridge(Plant_t *plant, bool in1, bool in2)
+{
+    if((in1 != plant->in1) || (in2 != plant->in2))
+    {
+        plant->in1 = in1;
+        plant->in2 = in2;
+        plant->stats.bridgeChanges++;
+    }
+}
+
+void Plant_SetObstruction(Plant_t *plant, double position_m)
+{
+    plant->obstructed = true;
+    plant->obstruction_m = position_m;
+}
+
+void Plant_ClearObstruction(Plant_t *plant)
+{
+    plant->obstructed = false;
+}
+
+void Plant_Step(Plant_t *plant)
+{
+    const Plant_Params_t *params = &plant->params;
+    double voltage = (plant->in1 ? params->supply_V : 0.0) - (plant->in2 ? params->supply_V : 0.0);
+    double current = plant->current_A;
+    double speed = plant->speed_radps;
+
+    /* Motor circuit - semi-implicit Euler, the step is far below L/R (~48ms) */
+    current += plant->dtOverL * (voltage - (plant->circuit_ohm * current) - (params->backEmfConstant_VsPerRad * speed));
+    if((voltage == 0.0) && (speed == 0.0) && (fabs(current) < CURRENT_AT_REST_A))
+    {
+        current = 0.0;
+    }
+
+    /* Shaft - the motor, the viscous friction and the gravity of the blind, then the dry friction which sticks a standing
+       shaft until the rest of the torque overcomes it and never reverses a turning one */
+    double torque = (params->torqueConstant_NmPerA * current) - (params->viscousFriction_Nms * speed) +
+                    GravityTorque(plant, plant->position_m);
+    if(speed == 0.0)
+    {
+        torque = (fabs(torque) <= plant->staticFriction_Nm) ? 0.0 : (torque - copysign(plant->kineticFriction_Nm, torque));
+    }
+    else
+    {
+        torque -= copysign(plant->kineticFriction_Nm, speed);
+    }
+    double newSpeed = speed + (plant->dtOverJ * torque);
+    if((speed != 0.0) && ((newSpeed * speed) < 0.0))
+    {
+        newSpeed = 0.0;
+    }
+
+    /* End stops and the obstruction stop the blind dead */
+    double position = plant->position_m + (plant->metersPerRad * newSpeed * plant->dt_s);
+    double lowest = (plant->obstructed && (plant->obstruction_m < params->bottomStop_m)) ? plant->obstruction_m : params->bottomStop_m;
+    bool blocked = false;
+    if((position <= 0.0) && (newSpeed < 0.0))
+    {
+        position = 0.0;
+        newSpeed = 0.0;
+        blocked = true;
+    }
+    else if((position >= lowest) && (newSpeed > 0.0))
+    {
+        position = lowest;
+        newSpeed = 0.0;
+        blocked = true;
+    }
+
+    plant->current_A = current;
+    plant->speed_radps = newSpeed;
+    plant->position_m = position;
+    plant->time_us += params->step_us;
+    plant->steps++;
+
+    /* Statistics */
+    double supplyCurrent = Plant_SupplyCurrent(plant);
+    if(fabs(current) > plant->stats.peakCurrent_A) plant->stats.peakCurrent_A = fabs(current);
+    plant->stats.supplyCharge_C += supplyCurrent * plant->dt_s;
+    plant->stats.supplyEnergy_J += params->supply_V * supplyCurrent * plant->dt_s;
+    plant->stats.heat_J += plant->circuit_ohm * current * current * plant->dt_s;
+    if(position < plant->stats.minPosition_m) plant->stats.minPosition_m = position;
+    if(position > plant->stats.maxPosition_m) plant->stats.maxPosition_m = position;
+    if(newSpeed != 0.0) plant->stats.moving_us += params->step_us;
+    else if(blocked && (voltage != 0.0)) plant->stats.stalled_us += params->step_us;
+
+    /* Limit switches */
+    bool top = (position < (params->topSwitch_m + (plant->topPressed ? params->switchHysteresis_m : 0.0)));
+    bool bottom = (position > (params->bottomSwitch_m - (plant->bottomPressed ? params->switchHysteresis_m : 0.0)));
+    UpdateSwitch(plant, top, &plant->topPressed, &plant->topLevel, &plant->topBounceEnd_us, &plant->stats.topPresses);
+    UpdateSwitch(plant, bottom, &plant->bottomPressed, &plant->bottomLevel, &plant->bottomBounceEnd_us, &plant->stats.bottomPresses);
+    UpdateEncoder(plant);
+}
+
+bool Plant_AtRest(const Plant_t *plant)
+{
+    return (plant->in1 == plant->in2) && (plant->speed_radps == 0.0) && (plant->current_A == 0.0) &&
+           (plant->time_us >= plant->topBounceEnd_us) && (plant->time_us >= plant->bottomBounceEnd_us) &&
+           (plant->topLevel == plant->topPressed) && (plant->bottomLevel == plant->bottomPressed) &&
+           (GravityTorque(plant, plant->position_m) <= plant->staticFriction_Nm);
+}
+
+uint64_t Plant_NextStepUs(const Plant_t *plant)
+{
+    return Plant_AtRest(plant) ? PLANT_AT_REST : (plant->time_us + plant->params.step_us);
+}
+
+uint64_t Plant_Advance(Plant_t *plant, uint64_t time_us)
+{
+    while((plant->time_us + plant->params.step_us) <= time_us)
+    {
+        if(Plant_AtRest(plant))
+        {
+            plant->time_us = time_us;
+            break;
+        }
+        Plant_Step(plant);
+    }
+    return Plant_NextStepUs(plant);
+}
+
+double Plant_SupplyCurrent(const Plant_t *plant)
+{
+    if(plant->in1 == plant->in2)
+    {
+        return 0.0;
+    }
+    return plant->in1 ? plant->current_A : -plant->current_A;
+}
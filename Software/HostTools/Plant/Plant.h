@@ -0,0 +1,151 @@
+#ifndef PLANT_H
+#define PLANT_H
+
+/* Plant - physics model of what the firmware drives: the 12V DC motor behind the H-bridge of
+   Hardware/CircuitSchematics/H-bridge_circuit_FALSTAD_EXPORT.txt, the printed gear case, the roller blind (inertia, gravity,
+   friction, end stops) and its top and bottom limit switches. Stepped at a fixed timestep (PLANT_DEFAULT_STEP_US), a step
+   is a few dozen floating point operations and a blind at rest is not stepped at all, so simulated days at 10kHz are cheap.
+
+   Sign convention: a positive motor speed/current turns the blind shaft clockwise - the blind goes down (MOTOR_CONTROL_1,
+   STATE_CLOCKWISE). Positions are measured down from the top end stop (the blind fully rolled up against the housing).
+
+   Plant_Attach couples a model to HostSim (the motor outputs in, the limit switch inputs out) - the rest of this interface
+   does not need HostSim, a tool may step the model on its own. */
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------- MACROS ---------------*/
+#define PLANT_DEFAULT_STEP_US       (100U)              /* 10kHz */
+#define PLANT_AT_REST               (UINT64_MAX)        /* Plant_NextStepUs of a model which does not move */
+#define PLANT_MAX_ATTACHED          (4U)                /* models coupled to HostSim - one per channel */
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+    /* H-bridge - IN1/IN2 high connect their side to the supply (P-MOSFET on), low to the ground (N-MOSFET on), so both low
+       or both high short the motor through two MOSFETs (dynamic brake) */
+    double supply_V;
+    double switchOn_ohm;                /* one conducting MOSFET */
+    double series_ohm;                  /* in series with the motor, e.g. 2.2 of the soft starter (SoftStarterMotorDC.circuitjs.txt) */
+
+    /* DC motor */
+    double inductance_H;
+    double resistance_ohm;
+    double torqueConstant_NmPerA;
+    double backEmfConstant_VsPerRad;
+    double rotorInertia_kgm2;
+    double viscousFriction_Nms;         /* at the motor shaft */
+
+    /* Gear case - turns of the motor per turn of the blind shaft */
+    double gearRatio;
+
+    /* Blind - roller, the bottom bar and the fabric (its hanging part pulls the blind down) */
+    double rollerRadius_m;
+    double rollerInertia_kgm2;
+    double barMass_kg;
+    double fabricMass_kg;
+    double staticFriction_Nm;           /* at the blind shaft - gear case, bearings, the fabric in its guides */
+    double kineticFriction_Nm;
+
+    /* End stops and limit switches, down from the top end stop */
+    double bottomStop_m;                /* the fabric fully unrolled */
+    double topSwitch_m;                 /* the top switch is pressed above this position */
+    double bottomSwitch_m;              /* the bottom switch is pressed below this position */
+    double switchHysteresis_m;          /* travel from the press to the release point */
+    uint32_t switchBounce_us;           /* contact chatter after every change of a switch, 0 - clean contacts */
+
+    /* Quadrature encoder on the blind shaft (ENCODER_ENABLED) - counts per turn, 4 per line, 0 - none */
+    uint32_t encoderCountsPerTurn;
+
+    uint32_t step_us;
+}Plant_Params_t;
+
+typedef struct
+{
+    double peakCurrent_A;               /* absolute motor current */
+    double supplyCharge_C;              /* drawn from the 12V supply (negative while the motor brakes into it) */
+    double supplyEnergy_J;
+    double heat_J;                      /* in the motor winding, the MOSFETs and the series resistor */
+    uint64_t moving_us;
+    uint64_t stalled_us;                /* driven against an end stop or an obstruction */
+    double minPosition_m;               /* how far the blind got past the switches */
+    double maxPosition_m;
+    uint32_t topPresses;
+    uint32_t bottomPresses;
+    uint32_t switchEdges;               /* contact changes seen on the inputs, the chatter included */
+    uint32_t encoderEdges;              /* changes of A or B */
+    uint32_t bridgeChanges;
+}Plant_Stats_t;
+
+typedef struct
+{
+    Plant_Params_t params;
+
+    /* Derived from the parameters by Plant_Init */
+    double dt_s;
+    double dtOverL;
+    double circuit_ohm;
+    double dtOverJ;                     /* the inertia of the motor, the roller and the blind at the motor shaft */
+    double metersPerRad;                /* blind travel per radian of the motor */
+    double barTorque_Nm;                /* gravity of the bottom bar at the motor shaft */
+    double fabricTorquePerM_Nm;         /* gravity of the hanging fabric at the motor shaft, per meter unrolled */
+    double staticFriction_Nm;           /* at the motor shaft */
+    double kineticFriction_Nm;
+
+    /* State */
+    uint64_t time_us;
+    uint64_t steps;
+    double current_A;
+    double speed_radps;                 /* motor shaft */
+    double position_m;
+    bool in1, in2;
+    bool obstructed;
+    double obstruction_m;               /* an obstruction below the blind stops it going down */
+    bool topPressed, bottomPressed;     /* the switch contacts */
+    bool topLevel, bottomLevel;         /* the inputs, with the chatter */
+    uint64_t topBounceEnd_us, bottomBounceEnd_us;
+    int32_t encoderCount;               /* from the top end stop, counting up down */
+    bool encoderA, encoderB;
+    uint32_t random;
+
+    Plant_Stats_t stats;
+}Plant_t;
+
+/*--------------- GLOBAL FUNCTION DECLARATIONS ---------------*/
+
+/* Motor and bridge from the Falstad export, the gear case and the blind assumed (see Plant.c) */
+void Plant_DefaultParams(Plant_Params_t *params);
+
+/* Blind at rest at the given position, the motor off (both IN low), time_us is the start of the model time */
+void Plant_Init(Plant_t *plant, const Plant_Params_t *params, double position_m, uint64_t time_us);
+
+/* H-bridge inputs - MOTOR_CONTROL_1 (IN1, clockwise) and MOTOR_CONTROL_2 (IN2, anticlockwise) */
+void Plant_SetBridge(Plant_t *plant, bool in1, bool in2);
+
+void Plant_SetObstruction(Plant_t *plant, double position_m);
+void Plant_ClearObstruction(Plant_t *plant);
+
+/* One step of params.step_us */
+void Plant_Step(Plant_t *plant);
+
+/* Steps the model up to time_us (the clock of a model at rest just moves on) and returns the time of the next step */
+uint64_t Plant_Advance(Plant_t *plant, uint64_t time_us);
+uint64_t Plant_NextStepUs(const Plant_t *plant);
+bool Plant_AtRest(const Plant_t *plant);
+
+/* Current the H-bridge draws from the supply (the motor current while it drives, 0 while it brakes) */
+double Plant_SupplyCurrent(const Plant_t *plant);
+
+/* Couples the model to HostSim from now on: the levels of the motor outputs drive the bridge, the switches drive the
+   limit switch inputs (pressed - high, like the switches to 3.3V with the pull-downs of the board). Call before
+   HostSim_Boot for the firmware to see the switches at the boot */
+void Plant_Attach(Plant_t *plant, uint32_t motorControl1Gpio, uint32_t motorControl2Gpio, uint32_t topLimitGpio, uint32_t bottomLimitGpio);
+void Plant_DetachAll(void);
+
+/* The encoder outputs of an attached model drive these inputs too (A leads B going up, so the count goes up going down) */
+void Plant_AttachEncoder(Plant_t *plant, uint32_t aGpio, uint32_t bGpio);
+
+#endif /* PLANT_H */
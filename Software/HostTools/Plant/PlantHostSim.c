@@ -0,0 +1,94 @@
+/* PlantHostSim.c - the plant models coupled to the GPIOs of HostSim (HostSim_SetPlantHook) */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stddef.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+#include "Plant.h"
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    Plant_t *plant;
+    uint32_t motorControl1Gpio;
+    uint32_t motorControl2Gpio;
+    uint32_t topLimitGpio;
+    uint32_t bottomLimitGpio;
+    bool encoder;
+    uint32_t encoderAGpio;
+    uint32_t encoderBGpio;
+}Attachment_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static Attachment_t Attachments[PLANT_MAX_ATTACHED];
+static uint32_t NumOfAttachments;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint64_t PlantHook(uint64_t now_us)
+{
+    uint64_t next = HOSTSIM_PLANT_AT_REST;
+    for(uint32_t i = 0; i < NumOfAttachments; i++)
+    {
+        Attachment_t *attachment = &Attachments[i];
+
+        /* Up to now with the bridge as it was, then the outputs of now */
+        (void)Plant_Advance(attachment->plant, now_us);
+        Plant_SetBridge(attachment->plant, HostSim_GetPin(attachment->motorControl1Gpio), HostSim_GetPin(attachment->motorControl2Gpio));
+        HostSim_SetInput(attachment->topLimitGpio, attachment->plant->topLevel);
+        HostSim_SetInput(attachment->bottomLimitGpio, attachment->plant->bottomLevel);
+        if(attachment->encoder)
+        {
+            HostSim_SetInput(attachment->encoderAGpio, attachment->plant->encoderA);
+            HostSim_SetInput(attachment->encoderBGpio, attachment->plant->encoderB);
+        }
+
+        uint64_t step = Plant_NextStepUs(attachment->plant);
+        if(step < next) next = step;
+    }
+    return next;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+void Plant_Attach(Plant_t *plant, uint32_t motorControl1Gpio, uint32_t motorControl2Gpio, uint32_t topLimitGpio, uint32_t bottomLimitGpio)
+{
+    if(NumOfAttachments >= PLANT_MAX_ATTACHED)
+    {
+        return;
+    }
+    Attachments[NumOfAttachments] = (Attachment_t){ plant, motorControl1Gpio, motorControl2Gpio, topLimitGpio, bottomLimitGpio, false, 0U, 0U };
+    NumOfAttachments++;
+
+    plant->time_us = HostSim_NowUs();
+    HostSim_SetInput(topLimitGpio, plant->topLevel);
+    HostSim_SetInput(bottomLimitGpio, plant->bottomLevel);
+    HostSim_SetPlantHook(PlantHook);
+}
+
+void Plant_DetachAll(void)
+{
+    NumOfAttachments = 0;
+    HostSim_SetPlantHook(NULL);
+}
+
+void Plant_AttachEncoder(Plant_t *plant, uint32_t aGpio, uint32_t bGpio)
+{
+    for(uint32_t i = 0; i < NumOfAttachments; i++)
+    {
+        if(Attachments[i].plant == plant)
+        {
+            Attachments[i].encoder = true;
+            Attachments[i].encoderAGpio = aGpio;
+            Attachments[i].encoderBGpio = bGpio;
+            HostSim_SetInput(aGpio, plant->encoderA);
+            HostSim_SetInput(bGpio, plant->encoderB);
+        }
+    }
+}
@@ -0,0 +1,302 @@
+/* PlantModel.c - the plant model (Plant/Plant.h - motor, H-bridge, gear case, blind, limit switches) on its own and
+   driving the firmware in HostSim.
+
+   Benchmark - the model alone at 10kHz, the blind moved between the limit switches by a bang-bang controller:
+     - continuous: every step computed for the given simulated hours (the blind never rests) - ns per step and the speed-up
+       over real time
+     - days: two moves a day (closed in the evening, opened in the morning) for SIMULATED_DAYS days, the model at rest is
+       not stepped - the steps actually computed and the host time of the whole period
+
+   Closed loop - every scenario boots a fresh firmware image (own process) with the model of the blind on channel 0, the
+   buttons and the schedule move it and the firmware reacts to the limit switches the model presses. Reported: where the
+   blind ended and how far it got past the switches, the switch presses and the back-offs the firmware recorded, the time
+   the blind moved and the motor stalled, the peak motor current, the energy from the 12V supply, the model steps and the
+   host time.
+
+   Usage: PlantModel [--hours N]
+   Exits with 1 if a closed loop scenario did not end where expected. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "ButtonTask.h"
+
+#include "Plant.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define DEFAULT_HOURS           (24U)
+#define SIMULATED_DAYS          (30U)
+#define EVENING_S               (20U * 3600U)
+#define MORNING_S               (6U * 3600U)
+#define BOOT_SETTLE_US          (6000000ULL)
+#define HOLD_US                 (120000000ULL)       /* longer than the full travel */
+#define FINAL_SETTLE_US         (5000000ULL)
+#define MIDDLE_M                (0.6)
+#define OBSTRUCTION_M           (0.7)
+#define OBSTRUCTED_HOLD_US      (20000000ULL)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    Plant_Stats_t stats;
+    double position_m;
+    bool topPressed;
+    bool bottomPressed;
+    uint32_t backoffs;              /* completed by the firmware, both switches */
+    uint32_t backoffTimeouts;
+    uint64_t steps;
+    uint64_t host_ns;
+}Result_t;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(Plant_t *plant);
+    double start_m;
+    double minFinal_m;              /* expected range of the final position */
+    double maxFinal_m;
+    uint32_t topPresses;            /* exact */
+    uint32_t bottomPresses;
+    bool stall;                     /* the motor is expected to stall */
+}Scenario_t;
+
+/*---------------- LOCAL FUNCTION DECLARATIONS ----------------------*/
+
+static void HoldUp(Plant_t *plant);
+static void HoldDown(Plant_t *plant);
+static void ScheduleDay(Plant_t *plant);
+static void ObstructedClose(Plant_t *plant);
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Up held from the middle - the top switch stops the blind, the back-off leaves it just below the switch */
+    { "hold_up_to_top",      HoldUp,          MIDDLE_M, 0.011, 0.03,  1, 0, false },
+    /* Down held from the middle - the same at the bottom */
+    { "hold_down_to_bottom", HoldDown,        MIDDLE_M, 1.17,  1.189, 0, 1, false },
+    /* Open blind at midday - closed at sunset, opened at sunrise, both moves end at the switches */
+    { "schedule_day",        ScheduleDay,     0.02,     0.011, 0.03,  1, 1, false },
+    /* Down held into an obstruction - no switch is reached, the motor stalls until the button is released */
+    { "obstructed_close",    ObstructedClose, MIDDLE_M, OBSTRUCTION_M, OBSTRUCTION_M, 0, 0, true },
+};
+
+static volatile double Sink;   /* keeps the benchmark loops */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/* ---- Benchmark ---- */
+
+/* Down until the bottom switch, up until the top switch - the bridge input of the next step */
+static void BangBang(Plant_t *plant, bool *down)
+{
+    if(*down && plant->bottomPressed) *down = false;
+    else if(!*down && plant->topPressed) *down = true;
+    Plant_SetBridge(plant, *down, !*down);
+}
+
+static void BenchmarkContinuous(uint32_t hours)
+{
+    Plant_Params_t params;
+    Plant_t plant;
+    bool down = true;
+
+    Plant_DefaultParams(&params);
+    Plant_Init(&plant, &params, MIDDLE_M, 0U);
+
+    uint64_t steps = ((uint64_t)hours * 3600ULL * 1000000ULL) / params.step_us;
+    double start = NowNs();
+    for(uint64_t i = 0; i < steps; i++)
+    {
+        BangBang(&plant, &down);
+        Plant_Step(&plant);
+    }
+    double elapsed_ns = NowNs() - start;
+    Sink = plant.position_m;
+
+    printf("continuous %3u h  %11llu steps  %6.2f ns/step  %8.0fx real time  %6.2f s host  %5u moves  peak %.2f A\n",
+           (unsigned)hours, (unsigned long long)steps, elapsed_ns / (double)steps,
+           ((double)hours * 3600e9) / elapsed_ns, elapsed_ns / 1e9, (unsigned)(plant.stats.topPresses + plant.stats.bottomPresses),
+           plant.stats.peakCurrent_A);
+}
+
+static void BenchmarkDays(void)
+{
+    Plant_Params_t params;
+    Plant_t plant;
+
+    Plant_DefaultParams(&params);
+    Plant_Init(&plant, &params, 0.02, 0U);
+
+    double start = NowNs();
+    for(uint32_t day = 0; day < SIMULATED_DAYS; day++)
+    {
+        uint64_t dayStart_us = (uint64_t)day * 86400ULL * 1000000ULL;
+        bool down = true;
+
+        /* Closed in the evening, opened in the morning of the next day - the switch stops the motor after the step */
+        for(uint32_t move = 0; move < 2U; move++)
+        {
+            uint64_t start_us = dayStart_us + (uint64_t)((move == 0U) ? EVENING_S : (86400U + MORNING_S)) * 1000000ULL;
+            (void)Plant_Advance(&plant, start_us);
+            Plant_SetBridge(&plant, down, !down);
+            while(down ? !plant.bottomPressed : !plant.topPressed)
+            {
+                Plant_Step(&plant);
+            }
+            Plant_SetBridge(&plant, false, false);
+            down = !down;
+        }
+    }
+    (void)Plant_Advance(&plant, (uint64_t)SIMULATED_DAYS * 86400ULL * 1000000ULL + (86400ULL * 1000000ULL));
+    double elapsed_ns = NowNs() - start;
+    Sink = plant.position_m;
+
+    uint64_t nominal = ((uint64_t)(SIMULATED_DAYS + 1U) * 86400ULL * 1000000ULL) / params.step_us;
+    printf("days       %3u d  %11llu steps  %6.3f %% of 10kHz  %6.2f ms host  %5u moves  %.1f J from the supply\n",
+           (unsigned)SIMULATED_DAYS, (unsigned long long)plant.steps, (100.0 * (double)plant.steps) / (double)nominal,
+           elapsed_ns / 1e6, (unsigned)(plant.stats.topPresses + plant.stats.bottomPresses), plant.stats.supplyEnergy_J);
+}
+
+/* ---- Closed loop scenarios ---- */
+
+static void Boot(Plant_t *plant, uint32_t hour, uint8_t isClosed)
+{
+    HostSim_RtcSetTime(2026, 6, 15, hour, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, isClosed);
+    Plant_Attach(plant, MOTOR_CONTROL_1, MOTOR_CONTROL_2, BUTTON_TOP_LIMIT, BUTTON_BOTTOM_LIMIT);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+}
+
+static void Hold(uint32_t gpio, uint64_t hold_us)
+{
+    HostSim_SetInput(gpio, true);
+    HostSim_RunForUs(hold_us);
+    HostSim_SetInput(gpio, false);
+    HostSim_RunForUs(FINAL_SETTLE_US);
+}
+
+static void HoldUp(Plant_t *plant)
+{
+    Boot(plant, 12, BLINDS_OPEN);
+    Hold(BUTTON_UP, HOLD_US);
+}
+
+static void HoldDown(Plant_t *plant)
+{
+    Boot(plant, 12, BLINDS_OPEN);
+    Hold(BUTTON_DOWN, HOLD_US);
+}
+
+static void ScheduleDay(Plant_t *plant)
+{
+    Boot(plant, 12, BLINDS_OPEN);
+    HostSim_RunForUs(24ULL * 3600ULL * 1000000ULL);
+}
+
+static void ObstructedClose(Plant_t *plant)
+{
+    Plant_SetObstruction(plant, OBSTRUCTION_M);
+    Boot(plant, 12, BLINDS_OPEN);
+    Hold(BUTTON_DOWN, OBSTRUCTED_HOLD_US);
+}
+
+/* The process of a scenario - the plant coupled to a fresh firmware image */
+static void RunScenario(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+    Plant_Params_t params;
+    Plant_t plant;
+
+    memset(result, 0, sizeof(*result));
+    Plant_DefaultParams(&params);
+    Plant_Init(&plant, &params, scenario->start_m, 0U);
+    double start = NowNs();
+    scenario->run(&plant);
+    result->host_ns = (uint64_t)(NowNs() - start);
+    (void)Plant_Advance(&plant, HostSim_NowUs());
+    result->stats = plant.stats;
+    result->position_m = plant.position_m;
+    result->topPressed = plant.topPressed;
+    result->bottomPressed = plant.bottomPressed;
+    result->steps = plant.steps;
+    result->backoffs = TopLimitStats[0].count + BottomLimitStats[0].count;
+    result->backoffTimeouts = TopLimitStats[0].timeouts + BottomLimitStats[0].timeouts;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    uint32_t hours = DEFAULT_HOURS;
+    uint32_t failures = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--hours") == 0) && ((i + 1) < argc)) hours = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--hours N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("Benchmark (model alone, %u us step)\n", (unsigned)PLANT_DEFAULT_STEP_US);
+    BenchmarkContinuous(hours);
+    BenchmarkDays();
+
+    printf("\nClosed loop (firmware in HostSim, channel 0)\n");
+    printf("%-20s %7s %7s %7s %4s %4s %6s %7s %7s %6s %7s %10s %8s  %s\n", "scenario", "end mm", "min mm", "max mm", "top", "bot",
+           "backof", "move s", "stall s", "peak A", "J", "steps", "host ms", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(RunScenario, scenario, &result, sizeof(result)))
+        {
+            printf("%-20s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+
+        /* Ends where expected with both switches released, and stalls only when the scenario makes it */
+        bool ok = (result.position_m >= scenario->minFinal_m) && (result.position_m <= scenario->maxFinal_m) &&
+                  !result.topPressed && !result.bottomPressed && (result.backoffTimeouts == 0U) &&
+                  (result.stats.topPresses == scenario->topPresses) && (result.stats.bottomPresses == scenario->bottomPresses) &&
+                  (result.backoffs == (scenario->topPresses + scenario->bottomPresses)) &&
+                  ((result.stats.stalled_us > 0U) == scenario->stall);
+        if(!ok) failures++;
+
+        printf("%-20s %7.1f %7.1f %7.1f %4u %4u %6u %7.2f %7.2f %6.3f %7.1f %10llu %8.1f  %s\n", scenario->name,
+               result.position_m * 1e3, result.stats.minPosition_m * 1e3, result.stats.maxPosition_m * 1e3,
+               (unsigned)result.stats.topPresses, (unsigned)result.stats.bottomPresses, (unsigned)result.backoffs,
+               (double)result.stats.moving_us / 1e6, (double)result.stats.stalled_us / 1e6, result.stats.peakCurrent_A,
+               result.stats.supplyEnergy_J, (unsigned long long)result.steps, (double)result.host_ns / 1e6, ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,462 @@
+/* PositionControl.c - the quadrature encoder of the firmware built with ENCODER_ENABLED (Encoder.c): the PIO program that
+   counts it runs on the interpreter of HostSim (HostSim_Pio.c), fed by the encoder of the plant model (Plant/Plant.h) on
+   the blind shaft of channel 0, and the position moves of MotorControllerTask are driven over the USB link. One process per
+   scenario, every one boots a fresh firmware image with the blind half way down:
+     count       - full travels down, up and down again: the count of the firmware against the count of the plant every
+                   10 ms, and the travel between the switches it learned
+     position    - a sequence of targets over the USB link (POSITION) after the switches were seen: where the blind stopped,
+                   how long it took and how often it was corrected, the overrun the firmware learned on the way, the counters
+                   read back over the USB link (POSITION_INFO)
+     timed       - the same targets as timed moves from the travel times (the glare control without the encoder) - the
+                   baseline the position moves are compared with
+     refused     - a position before the switches were seen, out of the travel and a short frame
+     interrupted - a move into an obstruction (stopped by the stall detection), a move released by its source half way,
+                   and the move after the obstruction is gone
+
+   Usage: PositionControl
+   Exits with 1 if the firmware count differs from the plant, a position move stops further from its target than
+   MOTOR_POSITION_TOLERANCE or ends worse than the timed moves, a refused command is accepted, a stall is not stopped within
+   MOTOR_POSITION_STALL_IN_US and a sample period or the position counters read over the USB link differ from the firmware. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "Encoder.h"
+#include "UsbLink.h"
+
+#include "UpdateProtocol.h"
+#include "Plant.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_POSITION_M         (0.5)
+#define BOOT_SETTLE_US          (3000000ULL)
+#define SAMPLE_US               (10000ULL)
+#define USB_RESPONSE_US         (20000ULL)
+#define MOVE_TIMEOUT_US         (200000000ULL)
+#define MAX_RESPONSES           (16U)
+#define OBSTRUCTION_M           (0.7)
+#define STALL_TARGET            (0.8f)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    SCENARIO_COUNT,
+    SCENARIO_POSITION,
+    SCENARIO_TIMED,
+    SCENARIO_REFUSED,
+    SCENARIO_INTERRUPTED,
+    NUM_OF_SCENARIOS
+}Scenario_t;
+
+typedef struct
+{
+    /* count */
+    uint32_t samples;
+    uint32_t mismatches;            /* samples with the count of the firmware off the plant */
+    int32_t maxMismatch;
+    uint32_t plantEdges;
+    int32_t span;                   /* counts between the switches the firmware learned */
+    int32_t plantSpan;              /* and between their press points on the plant */
+    bool calibrated;
+
+    /* position, timed */
+    uint32_t targets;
+    double meanError_mm;
+    double maxError_mm;
+    double meanTime_s;
+    double maxTime_s;
+    MotorPositionStats_t stats;
+    bool infoMatches;
+
+    /* refused */
+    char responses[MAX_RESPONSES];  /* A - #ACK, P - #ERR position, L - #ERR length, D - #ERR dropped, ? - anything else */
+    long uncalibratedPosition;      /* of POSITION_INFO before the switches were seen */
+
+    /* interrupted */
+    double stallStop_s;             /* from the blind stopped by the obstruction to the motor off */
+    bool stalledOff;
+    double finalError_mm;
+
+    /* host cost */
+    HostSim_PioStats_t pio;
+    uint32_t reads;
+    double sim_s;
+    double host_s;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *const ScenarioNames[NUM_OF_SCENARIOS] = { "count", "position", "timed", "refused", "interrupted" };
+
+/* Positions of the sequence - long and short moves both ways */
+static const float Targets[] = { 0.25f, 0.60f, 0.55f, 0.90f, 0.10f, 0.50f, 0.48f, 0.75f, 0.30f, 0.65f };
+
+static Plant_Params_t Params;
+static Plant_t PlantModel;
+static int32_t CountOffset;         /* of the plant at the boot - the firmware counts from 0 there */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static double MetersPerCount(void)
+{
+    return (2.0 * M_PI * Params.rollerRadius_m) / (double)Params.encoderCountsPerTurn;
+}
+
+static void Boot(void)
+{
+    Plant_DefaultParams(&Params);
+    Plant_Init(&PlantModel, &Params, BOOT_POSITION_M, 0U);
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    Plant_Attach(&PlantModel, MOTOR_CONTROL_1, MOTOR_CONTROL_2, BUTTON_TOP_LIMIT, BUTTON_BOTTOM_LIMIT);
+    Plant_AttachEncoder(&PlantModel, ENCODER_A_GPIO, ENCODER_B_GPIO);
+    CountOffset = PlantModel.encoderCount;
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+}
+
+/* One command over the USB link - the response letter (see Result_t.responses) */
+static char Command(UsbLinkCommand_t command, const uint8_t *payload, uint32_t length, char *line, uint32_t size)
+{
+    uint8_t frame[USB_LINK_MAX_FRAME];
+
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame((uint8_t)command, payload, length, frame));
+    if(!HostSim_UsbReadResponse(line, size, USB_RESPONSE_US)) return '?';
+    if(strncmp(line, "ACK", 3) == 0) return 'A';
+    if(strncmp(line, "ERR position", 12) == 0) return 'P';
+    if(strncmp(line, "ERR length", 10) == 0) return 'L';
+    if(strncmp(line, "ERR dropped", 11) == 0) return 'D';
+    return '?';
+}
+
+static char Position(uint32_t permille)
+{
+    uint8_t payload[3] = { 0U, (uint8_t)(permille & 0xFFU), (uint8_t)(permille >> 8) };
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    return Command(USB_LINK_CMD_POSITION, payload, sizeof(payload), line, sizeof(line));
+}
+
+static char Motor(MotorState_t state)
+{
+    uint8_t payload[2] = { 0U, (uint8_t)state };
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    return Command(USB_LINK_CMD_MOTOR, payload, sizeof(payload), line, sizeof(line));
+}
+
+static void AddResponse(Result_t *result, char response)
+{
+    size_t length = strlen(result->responses);
+    if(length < (sizeof(result->responses) - 1U))
+    {
+        result->responses[length] = response;
+        result->responses[length + 1U] = '\0';
+    }
+}
+
+/* The count of the firmware against the plant - a sample of the count scenario */
+static void SampleCount(Result_t *result)
+{
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    int32_t error = Encoder_Read() - (PlantModel.encoderCount - CountOffset);
+    result->samples++;
+    if(error != 0) result->mismatches++;
+    if(abs(error) > result->maxMismatch) result->maxMismatch = abs(error);
+}
+
+/* Runs in samples until the channel is off and the plant stands (or the timeout) - the sample time in us */
+static uint64_t RunUntilStill(Result_t *result, uint64_t timeout_us)
+{
+    uint64_t start = HostSim_NowUs();
+    do
+    {
+        HostSim_RunForUs(SAMPLE_US);
+        if(result != NULL) SampleCount(result);
+        (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    } while(((CurrentState[0] != STATE_OFF) || (MotorCommands[0].priority != MOTOR_PRIORITY_NONE) || !Plant_AtRest(&PlantModel)) &&
+            ((HostSim_NowUs() - start) < timeout_us));
+    return HostSim_NowUs() - start;
+}
+
+/* A remote move to a switch - the back-off of ButtonTask and the release of the channel after it */
+static void MoveToLimit(Result_t *result, MotorState_t state)
+{
+    (void)Motor(state);
+    (void)RunUntilStill(result, MOVE_TIMEOUT_US);
+    (void)Motor(STATE_OFF);
+}
+
+/* Both switches, the top one last */
+static void Calibrate(Result_t *result)
+{
+    MoveToLimit(result, STATE_CLOCKWISE);
+    MoveToLimit(result, STATE_ANTICLOCKWISE);
+}
+
+/* Where the blind stands against a position of the travel the firmware learned */
+static double ErrorMm(float target)
+{
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    int32_t count = PlantModel.encoderCount - CountOffset;
+    return (double)abs(count - Encoder_CountAt(target)) * MetersPerCount() * 1000.0;
+}
+
+static void AddError(Result_t *result, double error_mm, double time_s)
+{
+    result->targets++;
+    result->meanError_mm += error_mm;
+    result->meanTime_s += time_s;
+    if(error_mm > result->maxError_mm) result->maxError_mm = error_mm;
+    if(time_s > result->maxTime_s) result->maxTime_s = time_s;
+}
+
+static void Count(Result_t *result)
+{
+    Calibrate(result);
+    MoveToLimit(result, STATE_CLOCKWISE);
+
+    result->plantEdges = PlantModel.stats.encoderEdges;
+    result->calibrated = Encoder_Calibrated();
+    result->span = EncoderState.bottomCount - EncoderState.topCount;
+    result->plantSpan = (int32_t)lround((Params.bottomSwitch_m - Params.topSwitch_m) / MetersPerCount());
+}
+
+static void PositionMoves(Result_t *result)
+{
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    unsigned long counters[11];
+    long count, permille, lastError;
+
+    Calibrate(NULL);
+    for(uint32_t i = 0; i < (sizeof(Targets) / sizeof(Targets[0])); i++)
+    {
+        uint64_t start = HostSim_NowUs();
+        AddResponse(result, Position((uint32_t)lroundf(Targets[i] * 1000.0f)));
+        (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+        AddError(result, ErrorMm(Targets[i]), (double)(HostSim_NowUs() - start) / 1e6);
+    }
+    result->stats = MotorPositionStats;
+
+    /* POSITION_INFO changes nothing the response shows */
+    result->infoMatches = (Command(USB_LINK_CMD_POSITION_INFO, NULL, 0U, line, sizeof(line)) == '?') &&
+                          (sscanf(line, "POSITION %ld %ld %lu %lu %lu %lu %lu %ld %lu %lu %lu", &count, &permille, &counters[0],
+                                  &counters[1], &counters[2], &counters[3], &counters[4], &lastError, &counters[5], &counters[6],
+                                  &counters[7]) == 11) &&
+                          (count == (long)(PlantModel.encoderCount - CountOffset)) &&
+                          (permille == lroundf(Encoder_PositionAt((int32_t)count) * 1000.0f)) &&
+                          (counters[0] == MotorPositionStats.moves) && (counters[1] == MotorPositionStats.missed) &&
+                          (counters[2] == MotorPositionStats.corrections) && (counters[3] == MotorPositionStats.aborted) &&
+                          (counters[4] == MotorPositionStats.stalls) && (lastError == (long)MotorPositionStats.lastError) &&
+                          (counters[5] == MotorPositionStats.lastDuration_us) && (counters[6] == MotorPositionStats.overrun_us[1]) &&
+                          (counters[7] == MotorPositionStats.overrun_us[0]);
+}
+
+/* The timed moves of the glare control - the travel time of the distance at the full speed, stopped by the task */
+static void TimedMoves(Result_t *result)
+{
+    Calibrate(NULL);
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    for(uint32_t i = 0; i < (sizeof(Targets) / sizeof(Targets[0])); i++)
+    {
+        float position = Encoder_PositionAt(PlantModel.encoderCount - CountOffset);
+        bool down = (Targets[i] > position);
+        float travel_ms = (float)(down ? BLIND_TRAVEL_DOWN_IN_MS : BLIND_TRAVEL_UP_IN_MS) * fabsf(Targets[i] - position);
+        uint64_t start = HostSim_NowUs();
+        AddResponse(result, MotorCommand_SubmitTimed(0U, down ? STATE_CLOCKWISE : STATE_ANTICLOCKWISE, MOTOR_PRIORITY_REMOTE,
+                                                     MOTOR_DEADLINE_REMOTE_IN_US, (uint32_t)(travel_ms * 1000.0f)) ? 'A' : 'D');
+        (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+        AddError(result, ErrorMm(Targets[i]), (double)(HostSim_NowUs() - start) / 1e6);
+    }
+}
+
+static void Refused(Result_t *result)
+{
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    uint8_t shortFrame[2] = { 0U, 0U };
+    long count = 0;
+
+    AddResponse(result, Position(500U));
+    result->uncalibratedPosition = ((Command(USB_LINK_CMD_POSITION_INFO, NULL, 0U, line, sizeof(line)) == '?') &&
+                                    (sscanf(line, "POSITION %ld %ld", &count, &result->uncalibratedPosition) == 2)) ?
+                                   result->uncalibratedPosition : 0L;
+    Calibrate(NULL);
+    AddResponse(result, Position(1001U));
+    AddResponse(result, Command(USB_LINK_CMD_POSITION, shortFrame, sizeof(shortFrame), line, sizeof(line)));
+    AddResponse(result, Position(500U));
+    (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+    result->finalError_mm = ErrorMm(0.5f);
+}
+
+static void Interrupted(Result_t *result)
+{
+    uint64_t stalledAt = 0U, offAt = 0U;
+
+    Calibrate(NULL);
+
+    /* Into the obstruction - the blind stands, the motor is still driven until the stall detection */
+    Plant_SetObstruction(&PlantModel, OBSTRUCTION_M);
+    AddResponse(result, Position((uint32_t)lroundf(STALL_TARGET * 1000.0f)));
+    uint64_t start = HostSim_NowUs();
+    while(((HostSim_NowUs() - start) < MOVE_TIMEOUT_US) && (offAt == 0U))
+    {
+        HostSim_RunForUs(SAMPLE_US);
+        (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+        if((stalledAt == 0U) && (PlantModel.stats.stalled_us > 0U)) stalledAt = HostSim_NowUs() - PlantModel.stats.stalled_us;
+        if((stalledAt != 0U) && (CurrentState[0] == STATE_OFF)) offAt = HostSim_NowUs();
+    }
+    result->stalledOff = (offAt != 0U) && (MotorCommands[0].priority == MOTOR_PRIORITY_NONE);
+    result->stallStop_s = (offAt != 0U) ? ((double)(offAt - stalledAt) / 1e6) : 0.0;
+    (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+    Plant_ClearObstruction(&PlantModel);
+
+    /* Back up, released by the source half way */
+    AddResponse(result, Position(200U));
+    HostSim_RunForUs(5000000ULL);
+    AddResponse(result, Motor(STATE_OFF));
+    (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+
+    /* Nothing in the way any more */
+    AddResponse(result, Position((uint32_t)lroundf(STALL_TARGET * 1000.0f)));
+    (void)RunUntilStill(NULL, MOVE_TIMEOUT_US);
+    result->finalError_mm = ErrorMm(STALL_TARGET);
+    result->stats = MotorPositionStats;
+}
+
+static void RunScenario(const void *context, void *output)
+{
+    Scenario_t scenario = *(const Scenario_t*)context;
+    Result_t *result = output;
+
+    memset(result, 0, sizeof(*result));
+    double start = NowNs();
+    Boot();
+    switch(scenario)
+    {
+        case SCENARIO_COUNT:        Count(result);          break;
+        case SCENARIO_POSITION:     PositionMoves(result);  break;
+        case SCENARIO_TIMED:        TimedMoves(result);     break;
+        case SCENARIO_REFUSED:      Refused(result);        break;
+        case SCENARIO_INTERRUPTED:  Interrupted(result);    break;
+        default:                                            break;
+    }
+    if(result->targets > 0U)
+    {
+        result->meanError_mm /= result->targets;
+        result->meanTime_s /= result->targets;
+    }
+    result->pio = *HostSim_GetPioStats();
+    result->reads = EncoderState.reads;
+    result->plantEdges = PlantModel.stats.encoderEdges;
+    result->sim_s = (double)HostSim_NowUs() / 1e6;
+    result->host_s = (NowNs() - start) / 1e9;
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-52s %-30s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_SCENARIOS];
+    uint32_t failures = 0;
+    char value[64];
+
+    Plant_DefaultParams(&Params);
+    for(Scenario_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        if(!HostSim_RunIsolated(RunScenario, &scenario, &results[scenario], sizeof(results[scenario])))
+        {
+            printf("simulation of %s crashed\n", ScenarioNames[scenario]);
+            return 1;
+        }
+    }
+
+    printf("Quadrature encoder of channel 0 (%u counts per turn of the blind shaft, %.3f mm per count) on the PIO interpreter\n\n",
+           (unsigned)Params.encoderCountsPerTurn, MetersPerCount() * 1000.0);
+    printf("%-12s %8s %10s %12s %10s %8s %8s %9s %9s %9s\n", "scenario", "sim [s]", "host [s]", "PIO instr", "edges",
+           "instr/e", "reads", "dropped", "targets", "mean mm");
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        const Result_t *result = &results[scenario];
+        printf("%-12s %8.0f %10.2f %12llu %10u %8.1f %8u %9llu %9u %9.2f\n", ScenarioNames[scenario], result->sim_s, result->host_s,
+               (unsigned long long)result->pio.instructions, (unsigned)result->plantEdges,
+               (result->plantEdges > 0U) ? ((double)result->pio.instructions / result->plantEdges) : 0.0, (unsigned)result->reads,
+               (unsigned long long)result->pio.droppedPushes, (unsigned)result->targets, result->meanError_mm);
+    }
+
+    const Result_t *count = &results[SCENARIO_COUNT];
+    const Result_t *position = &results[SCENARIO_POSITION];
+    const Result_t *timed = &results[SCENARIO_TIMED];
+    const Result_t *refused = &results[SCENARIO_REFUSED];
+    const Result_t *interrupted = &results[SCENARIO_INTERRUPTED];
+    double tolerance_mm = (double)MOTOR_POSITION_TOLERANCE * (double)abs(count->span) * MetersPerCount() * 1000.0;
+
+    printf("\n%-52s %-30s %s\n", "check", "value", "result");
+    snprintf(value, sizeof(value), "%u/%u off, largest %d", (unsigned)count->mismatches, (unsigned)count->samples, (int)count->maxMismatch);
+    failures += !Check("count: the firmware count is the plant count", value, (count->samples > 0U) && (count->mismatches == 0U));
+    snprintf(value, sizeof(value), "%d counts, plant %d", (int)count->span, (int)count->plantSpan);
+    failures += !Check("count: travel between the switches learned", value, count->calibrated &&
+                       (abs(count->span - count->plantSpan) <= (count->plantSpan / 50)));
+    snprintf(value, sizeof(value), "%.1f instructions per edge", (double)count->pio.instructions / count->plantEdges);
+    failures += !Check("count: the state machine settles on every edge", value, count->pio.settles > 0U);
+
+    snprintf(value, sizeof(value), "%u/%u, mean %.2f max %.2f mm", (unsigned)position->stats.moves, (unsigned)position->targets,
+             position->meanError_mm, position->maxError_mm);
+    failures += !Check("position: every target within the tolerance", value, (strcmp(position->responses, "AAAAAAAAAA") == 0) &&
+                       (position->stats.moves == position->targets) && (position->stats.missed == 0U) &&
+                       (position->maxError_mm <= tolerance_mm));
+    snprintf(value, sizeof(value), "%u corrections, %u aborted", (unsigned)position->stats.corrections, (unsigned)position->stats.aborted);
+    failures += !Check("position: corrections of the moves", value, (position->stats.corrections <= position->targets) &&
+                       (position->stats.aborted == 0U) && (position->stats.stalls == 0U));
+    snprintf(value, sizeof(value), "down %.0f ms, up %.0f ms", position->stats.overrun_us[1] / 1000.0, position->stats.overrun_us[0] / 1000.0);
+    failures += !Check("position: overrun after the brake learned", value, (position->stats.overrun_us[1] != MOTOR_POSITION_OVERRUN_IN_US) &&
+                       (position->stats.overrun_us[0] != MOTOR_POSITION_OVERRUN_IN_US));
+    snprintf(value, sizeof(value), "mean %.1f s, longest %.1f s", position->meanTime_s, position->maxTime_s);
+    failures += !Check("position: time to the target", value, position->targets > 0U);
+    snprintf(value, sizeof(value), "%s", position->infoMatches ? "same" : "different");
+    failures += !Check("position: POSITION_INFO shows the counters", value, position->infoMatches);
+
+    snprintf(value, sizeof(value), "timed mean %.2f max %.2f mm", timed->meanError_mm, timed->maxError_mm);
+    failures += !Check("timed: position moves closer than the timed ones", value, (timed->targets == position->targets) &&
+                       (position->meanError_mm < timed->meanError_mm) && (position->maxError_mm < timed->maxError_mm));
+
+    snprintf(value, sizeof(value), "%s, position %ld", refused->responses, refused->uncalibratedPosition);
+    failures += !Check("refused: early, out of the travel, short frame", value, (strcmp(refused->responses, "PPLA") == 0) &&
+                       (refused->uncalibratedPosition == -1L) && (refused->finalError_mm <= tolerance_mm));
+
+    snprintf(value, sizeof(value), "%.2f s, %u stalls", interrupted->stallStop_s, (unsigned)interrupted->stats.stalls);
+    failures += !Check("interrupted: stall stopped and released", value, interrupted->stalledOff && (interrupted->stats.stalls == 1U) &&
+                       (interrupted->stallStop_s <= ((MOTOR_POSITION_STALL_IN_US / 1e6) + (2.0 * MOTOR_POSITION_PERIOD / 1000.0))));
+    snprintf(value, sizeof(value), "%s, %u aborted", interrupted->responses, (unsigned)interrupted->stats.aborted);
+    failures += !Check("interrupted: a release by the source ends the move", value, (strcmp(interrupted->responses, "AAAA") == 0) &&
+                       (interrupted->stats.aborted == 1U));
+    snprintf(value, sizeof(value), "%.2f mm", interrupted->finalError_mm);
+    failures += !Check("interrupted: the next move gets there", value, interrupted->finalError_mm <= tolerance_mm);
+
+    return (failures == 0U) ? 0 : 1;
+}
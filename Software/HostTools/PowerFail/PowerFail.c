@@ -0,0 +1,663 @@
+/* PowerFail.c - the supply monitor of the firmware built with POWER_MONITOR_ENABLED (PowerMonitor.c): the 12V rail behind the
+   divider on ADC1 is a model of the bulk capacitor of the board, charged by the supply and discharged by the H-bridge (the
+   motor current of the plant model, Plant/Plant.h) and the rest of the board. After a cut the rail decays until the regulator
+   drops out - there the chip dies, and the next firmware image boots in a fresh process with what survives (the virtual time,
+   the battery backed DS1307), the blind where it came to rest. The light sensor is built in too - its input is converted by
+   the monitor. One process per boot:
+     moving  - an automatic opening cut half way: the time from the rail crossing POWER_MONITOR_FAIL_MV until the edge was
+               detected, the H-bridge was off and the record was in the DS1307, against the hold-up of the capacitor; IS_CLOSED
+               (the target since the move was accepted) written back to the state before the move, the boot after the cut
+               restoring the encoder travel and resuming the opening
+     idle    - the same cut with nothing moving and the encoder not calibrated yet
+     dip     - the rail falls below the threshold during a move and comes back - the move stopped, the board lives on, the
+               record cleared again, the counters read over the USB link (POWER_INFO)
+     glitch  - a spike shorter than a sample period - no edge
+     limit   - a remote move up into the top switch, the rail sags below the threshold while the back-off reverses off it and
+               stays there for longer than the back-off, a remote move up comes in meanwhile - the channel held off by the
+               monitor all along (the end of the back-off does not give it back), free again once the rail recovered
+     sync    - the supply cut while a time sync over the USB link waits for the second it writes (the RTC taken) - the sync
+               given up, the record in the DS1307 all the same
+
+   Usage: PowerFail
+   Exits with 1 if an edge is detected later than POWER_MONITOR_FAIL_SAMPLES + 1 sample periods after the crossing, the
+   record is not in the DS1307 before the dropout, IS_CLOSED is not the state before a move that was cut, the boot after the cut does
+   not restore the travel or resume the move, a dip is not recovered from, a glitch is taken for an edge, a motor starts
+   while the rail is failing, a time sync keeps the RTC from the flush or the light sensor input is not sampled along. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "PowerMonitor.h"
+#include "LightSensor.h"
+#include "Watchdog.h"
+#include "ButtonTask.h"
+#include "Encoder.h"
+#include "UsbLink.h"
+#include "TimeSync.h"
+
+#include "UpdateProtocol.h"
+#include "Plant.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_POSITION_M         (0.5)
+#define BOOT_SETTLE_US          (5000000ULL)
+#define STEP_US                 (25ULL)             /* of the supply model */
+#define SAMPLE_US               (10000ULL)
+#define USB_RESPONSE_US         (20000ULL)
+#define MOVE_TIMEOUT_US         (200000000ULL)
+#define CUT_AFTER_START_US      (20000000ULL)       /* into the automatic opening */
+#define DIP_US                  (3000ULL)
+#define GLITCH_US               (100ULL)            /* around one check of the monitor */
+#define GLITCH_V                (9.0)
+#define SAG_V                   (8.0)               /* a brownout - below the threshold, above the dropout */
+#define SAG_US                  (1000000ULL)
+#define SAG_MOVE_AFTER_US       (LIMIT_SWITCH_BACKOFF_TOP_IN_US + 100000ULL)   /* the back-off over - a remote move up */
+#define SYNC_UTC_US             (1781524800100000ULL)   /* 2026-06-15 12:00:00.1 UTC - the second written 0.9 s after the frame */
+#define SYNC_CUT_AFTER_US       (50000ULL)
+#define LIGHT_COUNTS            (1500U)
+#define SUPPLY_CAPACITANCE_F    (470e-6)
+#define BOARD_CURRENT_A         (0.12)              /* the regulator, the RP2040, the DS1307 and the pull-ups at 12V */
+#define DROPOUT_V               (5.0)               /* the regulator loses the 3.3V below this */
+#define NO_TIME                 (UINT64_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    SCENARIO_MOVING,
+    SCENARIO_IDLE,
+    SCENARIO_DIP,
+    SCENARIO_GLITCH,
+    SCENARIO_LIMIT,
+    SCENARIO_SYNC,
+    NUM_OF_SCENARIOS
+}Scenario_t;
+
+typedef struct
+{
+    /* the boot with the cut */
+    bool died;
+    HostSim_PersistentState_t state;
+    double restPosition_m;          /* where the blind came to rest after the dropout */
+    int32_t trueFromTop;            /* its encoder count from the top switch the firmware saw */
+    int32_t plantSpan;              /* between the press points of the switches */
+    uint64_t crossing_us;           /* the rail below POWER_MONITOR_FAIL_MV */
+    uint64_t detect_us;
+    uint64_t bridgeOff_us;
+    uint64_t flush_us;              /* the record in the DS1307 */
+    uint64_t dropout_us;
+    double motorCurrent_A;          /* at the crossing */
+    uint8_t isClosedBefore;         /* IS_CLOSED before the cut */
+    uint8_t nvram[1U + POWER_FAIL_RECORD_SIZE];     /* IS_CLOSED and the record at the dropout */
+    PowerMonitorStats_t stats;
+    bool stoppedAndReleased;        /* dip, limit - the channel off and nobody owns it */
+    bool heldWhileFailing;          /* limit - the channel off and the monitor's from the edge until the rail was back */
+    uint32_t startsWhileFailing;    /* motor starts in that time */
+    uint32_t backoffs;              /* completed */
+    bool backoffActive;
+    uint32_t syncs;                 /* sync - completed time syncs */
+    bool recordCleared;
+    bool infoMatches;
+    uint32_t lightFiltered;
+    double conversionsPerS;
+
+    /* the boot after the cut */
+    PowerFailRecord_t bootRecord;
+    bool encoderRestored;
+    int32_t restoredFromTop;
+    int32_t restoredSpan;
+    uint64_t resumed_us;            /* from the boot until the motor ran again, NO_TIME - not at all */
+    uint8_t isClosedAfter;          /* once the resumed move ended */
+}Result_t;
+
+/* What the process of a boot gets */
+typedef struct
+{
+    Scenario_t scenario;
+    bool afterCut;
+}BootRun_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *const ScenarioNames[NUM_OF_SCENARIOS] = { "moving", "idle", "dip", "glitch", "limit", "sync" };
+
+static Plant_Params_t Params;
+static Plant_t PlantModel;
+static int32_t CountOffset;         /* of the plant at the boot - the firmware counts from 0 there */
+static double SupplyV;
+static bool SupplyConnected;
+static uint64_t Crossing_us;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double MetersPerCount(void)
+{
+    return (2.0 * M_PI * Params.rollerRadius_m) / (double)Params.encoderCountsPerTurn;
+}
+
+/* The rail as the ADC sees it behind the divider */
+static void SetSupply(double volts)
+{
+    double counts = (volts / POWER_MONITOR_DIVIDER) / (POWER_MONITOR_ADC_REF_MV / 1000.0) * 4096.0;
+    SupplyV = volts;
+    PlantModel.params.supply_V = volts;
+    HostSim_SetAdcInput(POWER_MONITOR_ADC_INPUT, (uint16_t)((counts > 4095.0) ? 4095.0 : counts));
+}
+
+/* One step of the capacitor - recharged at once while the supply is connected */
+static void StepSupply(void)
+{
+    HostSim_RunForUs(STEP_US);
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    if(SupplyConnected)
+    {
+        SetSupply(Params.supply_V);
+        return;
+    }
+
+    double load_A = Plant_SupplyCurrent(&PlantModel) + BOARD_CURRENT_A;
+    double volts = SupplyV - (load_A * (STEP_US / 1e6) / SUPPLY_CAPACITANCE_F);
+    if((Crossing_us == NO_TIME) && (volts * 1000.0 < POWER_MONITOR_FAIL_MV)) Crossing_us = HostSim_NowUs();
+    SetSupply((volts > 0.0) ? volts : 0.0);
+}
+
+static void Boot(const HostSim_PersistentState_t *state, double position_m)
+{
+    Plant_DefaultParams(&Params);
+    Plant_Init(&PlantModel, &Params, position_m, 0U);
+    if(state == NULL)
+    {
+        HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+        HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    }
+    else
+    {
+        HostSim_RestoreState(state);
+        PlantModel.time_us = HostSim_NowUs();
+    }
+    SupplyConnected = true;
+    Crossing_us = NO_TIME;
+    SetSupply(Params.supply_V);
+    HostSim_SetAdcInput(LIGHT_SENSOR_ADC_INPUT, LIGHT_COUNTS);
+    Plant_Attach(&PlantModel, MOTOR_CONTROL_1, MOTOR_CONTROL_2, BUTTON_TOP_LIMIT, BUTTON_BOTTOM_LIMIT);
+    Plant_AttachEncoder(&PlantModel, ENCODER_A_GPIO, ENCODER_B_GPIO);
+    CountOffset = PlantModel.encoderCount;
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+}
+
+static bool Command(UsbLinkCommand_t command, const uint8_t *payload, uint32_t length, char *line, uint32_t size)
+{
+    uint8_t frame[USB_LINK_MAX_FRAME];
+
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame((uint8_t)command, payload, length, frame));
+    return HostSim_UsbReadResponse(line, size, USB_RESPONSE_US);
+}
+
+static void Motor(MotorState_t state)
+{
+    uint8_t payload[2] = { 0U, (uint8_t)state };
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    (void)Command(USB_LINK_CMD_MOTOR, payload, sizeof(payload), line, sizeof(line));
+}
+
+/* Runs in samples until the channel is off and the plant stands (or the timeout) */
+static void RunUntilStill(uint64_t timeout_us)
+{
+    uint64_t start = HostSim_NowUs();
+    do
+    {
+        HostSim_RunForUs(SAMPLE_US);
+        (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    } while(((CurrentState[0] != STATE_OFF) || (MotorCommands[0].priority != MOTOR_PRIORITY_NONE) || !Plant_AtRest(&PlantModel)) &&
+            ((HostSim_NowUs() - start) < timeout_us));
+}
+
+/* A remote move to a switch - the back-off of ButtonTask and the release of the channel after it */
+static void MoveToLimit(MotorState_t state)
+{
+    Motor(state);
+    RunUntilStill(MOVE_TIMEOUT_US);
+    Motor(STATE_OFF);
+}
+
+/* The 64-bit time of a 32-bit timer value from shortly after from_us */
+static uint64_t After(uint64_t from_us, uint32_t timer_us)
+{
+    return from_us + (uint32_t)(timer_us - (uint32_t)from_us);
+}
+
+static void ReadNvram(uint8_t nvram[1U + POWER_FAIL_RECORD_SIZE])
+{
+    for(uint32_t i = 0; i < (1U + POWER_FAIL_RECORD_SIZE); i++)
+    {
+        nvram[i] = HostSim_RtcReadRegister((uint8_t)(DS1307_REG_ADDR_IS_CLOSED + i));
+    }
+}
+
+/* The times of the edge from the monitor and the motor log */
+static void CollectEdge(Result_t *result)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+
+    result->crossing_us = Crossing_us;
+    result->stats = PowerMonitorStats;
+    result->detect_us = (PowerMonitorStats.failures > 0U) ? After(Crossing_us, PowerMonitorStats.lastDetect_us) : NO_TIME;
+    result->flush_us = (PowerMonitorStats.flushes > 0U) ? (result->detect_us + PowerMonitorStats.lastFlush_us) : NO_TIME;
+    result->bridgeOff_us = NO_TIME;
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if((log[i].time_us >= Crossing_us) && !log[i].motorControl1 && !log[i].motorControl2)
+        {
+            result->bridgeOff_us = log[i].time_us;
+            break;
+        }
+    }
+}
+
+/* The supply gone - stepped until the dropout, then what the next boot gets: no watchdog reset, the blind at rest */
+static void Cut(Result_t *result)
+{
+    result->isClosedBefore = HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED);
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    result->motorCurrent_A = Plant_SupplyCurrent(&PlantModel);
+    SupplyConnected = false;
+    while(SupplyV > DROPOUT_V)
+    {
+        StepSupply();
+    }
+    result->died = true;
+    result->dropout_us = HostSim_NowUs();
+    CollectEdge(result);
+    ReadNvram(result->nvram);
+    result->lightFiltered = LightFiltered;
+    result->conversionsPerS = (double)HostSim_GetAdcConversions() / ((double)HostSim_NowUs() / 1e6);
+
+    /* Whatever the blind still coasts - the firmware does not see it any more */
+    Plant_SetBridge(&PlantModel, false, false);
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs() + 2000000ULL);
+    result->restPosition_m = PlantModel.position_m;
+    result->trueFromTop = PlantModel.encoderCount - CountOffset - EncoderState.topCount;
+    result->plantSpan = (int32_t)lround((Params.bottomSwitch_m - Params.topSwitch_m) / MetersPerCount());
+
+    HostSim_SaveState(&result->state);
+    memset(result->state.watchdogScratch, 0, sizeof(result->state.watchdogScratch));
+    result->state.watchdogReset = false;
+}
+
+/* Both switches seen, the blind at the bottom - then an automatic opening is due (IS_CLOSED closed at midday), cut half way */
+static void Moving(Result_t *result)
+{
+    MoveToLimit(STATE_ANTICLOCKWISE);
+    MoveToLimit(STATE_CLOCKWISE);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_CLOSED);
+
+    uint64_t start = HostSim_NowUs();
+    while(((CurrentState[0] != STATE_ANTICLOCKWISE) || (MotorCommands[0].priority != MOTOR_PRIORITY_AUTOMATIC)) &&
+          ((HostSim_NowUs() - start) < MOVE_TIMEOUT_US))
+    {
+        HostSim_RunForUs(SAMPLE_US);
+    }
+    HostSim_RunForUs(CUT_AFTER_START_US);
+    Cut(result);
+}
+
+/* A remote move down, the rail dips below the threshold and comes back */
+static void Dip(Result_t *result)
+{
+    char line[UPDATE_PROTOCOL_MAX_LINE];
+    unsigned long values[8];
+    unsigned int bootValid, channels, restored;
+    int count, span;
+
+    Motor(STATE_CLOCKWISE);
+    HostSim_RunForUs(5000000ULL);
+    (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    result->motorCurrent_A = Plant_SupplyCurrent(&PlantModel);
+    result->isClosedBefore = HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED);
+
+    SupplyConnected = false;
+    uint64_t start = HostSim_NowUs();
+    while((HostSim_NowUs() - start) < DIP_US)
+    {
+        StepSupply();
+    }
+    ReadNvram(result->nvram);
+    CollectEdge(result);
+    SupplyConnected = true;
+    SetSupply(Params.supply_V);
+    RunUntilStill(MOVE_TIMEOUT_US);
+
+    /* The record of the dip is gone, IS_CLOSED as it was */
+    uint8_t nvram[1U + POWER_FAIL_RECORD_SIZE];
+    ReadNvram(nvram);
+    uint8_t check = nvram[1];
+    uint8_t clearedCheck = (uint8_t)~result->nvram[1];
+    result->recordCleared = (check == clearedCheck) && (nvram[0] == result->isClosedBefore);
+    result->stoppedAndReleased = (CurrentState[0] == STATE_OFF) && (MotorCommands[0].priority == MOTOR_PRIORITY_NONE) &&
+                                 (PlantModel.position_m < Params.bottomSwitch_m);
+    result->stats = PowerMonitorStats;
+
+    result->infoMatches = Command(USB_LINK_CMD_POWER_INFO, NULL, 0U, line, sizeof(line)) &&
+                          (sscanf(line, "POWER %lu %lu %lu %lu %lu %lu %lu %lu %u %x %d %d %u", &values[0], &values[1], &values[2],
+                                  &values[3], &values[4], &values[5], &values[6], &values[7], &bootValid, &channels, &count, &span,
+                                  &restored) == 13) &&
+                          (values[1] == PowerMonitor_Millivolts(PowerMonitorStats.lowest)) && (values[2] == PowerMonitorStats.failures) &&
+                          (values[3] == PowerMonitorStats.recoveries) && (values[4] == PowerMonitorStats.flushes) &&
+                          (values[5] == PowerMonitorStats.flushErrors) && (values[6] == PowerMonitorStats.lastFlush_us) &&
+                          (values[7] == PowerMonitorStats.longestFlush_us) && (bootValid == 0U) && (restored == 0U);
+    result->lightFiltered = LightFiltered;
+    result->conversionsPerS = (double)HostSim_GetAdcConversions() / ((double)HostSim_NowUs() / 1e6);
+}
+
+/* A spike on the rail while nothing moves - from half way between two checks, so that exactly one sees it */
+static void Glitch(Result_t *result)
+{
+    uint32_t checks = PowerMonitorStats.checks;
+    while(PowerMonitorStats.checks == checks)
+    {
+        HostSim_RunForUs(1U);
+    }
+    HostSim_RunForUs(POWER_MONITOR_PERIOD_IN_US - (GLITCH_US / 2U));
+    SetSupply(GLITCH_V);
+    HostSim_RunForUs(GLITCH_US);
+    SetSupply(Params.supply_V);
+    HostSim_RunForUs(1000000ULL);
+    result->stats = PowerMonitorStats;
+    result->lightFiltered = LightFiltered;
+    result->conversionsPerS = (double)HostSim_GetAdcConversions() / ((double)HostSim_NowUs() / 1e6);
+}
+
+/* A remote move up into the top switch, the rail sags below the threshold while the back-off reverses off the released
+   switch (its extra travel) and stays below for longer than the back-off lasts - a remote move up comes in meanwhile */
+static void Limit(Result_t *result)
+{
+    const HostSim_MotorEvent_t *log;
+
+    Motor(STATE_ANTICLOCKWISE);
+    uint64_t start = HostSim_NowUs();
+    while(((MotorCommands[0].priority != MOTOR_PRIORITY_SAFETY) || PlantModel.topPressed) && ((HostSim_NowUs() - start) < MOVE_TIMEOUT_US))
+    {
+        HostSim_RunForUs(STEP_US);
+        (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+    }
+    result->motorCurrent_A = Plant_SupplyCurrent(&PlantModel);
+    result->isClosedBefore = HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED);
+
+    Crossing_us = HostSim_NowUs();
+    SetSupply(SAG_V);
+    result->heldWhileFailing = true;
+    bool moveSent = false;
+    while((HostSim_NowUs() - Crossing_us) < SAG_US)
+    {
+        HostSim_RunForUs(STEP_US);
+        (void)Plant_Advance(&PlantModel, HostSim_NowUs());
+        if((PowerMonitorStats.failures > 0U) &&
+           ((MotorCommands[0].priority != MOTOR_PRIORITY_POWER_FAIL) || (CurrentState[0] != STATE_OFF)))
+        {
+            result->heldWhileFailing = false;
+        }
+        if(!moveSent && ((HostSim_NowUs() - Crossing_us) >= SAG_MOVE_AFTER_US))
+        {
+            Motor(STATE_ANTICLOCKWISE);
+            moveSent = true;
+        }
+    }
+    uint64_t sagEnd_us = HostSim_NowUs();
+    ReadNvram(result->nvram);
+    CollectEdge(result);
+
+    uint32_t length = HostSim_GetMotorLog(&log);
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if((result->detect_us != NO_TIME) && (log[i].time_us >= result->detect_us) && (log[i].time_us < sagEnd_us) &&
+           (log[i].motorControl1 || log[i].motorControl2))
+        {
+            result->startsWhileFailing++;
+        }
+    }
+
+    SetSupply(Params.supply_V);
+    RunUntilStill(MOVE_TIMEOUT_US);
+    result->stoppedAndReleased = (CurrentState[0] == STATE_OFF) && (MotorCommands[0].priority == MOTOR_PRIORITY_NONE);
+    result->backoffs = TopLimitStats[0].count;
+    result->backoffActive = (LimitSwitchBackoffActive & 1U) != 0U;
+    result->stats = PowerMonitorStats;
+    result->lightFiltered = LightFiltered;
+    result->conversionsPerS = (double)HostSim_GetAdcConversions() / ((double)HostSim_NowUs() / 1e6);
+}
+
+/* A first time sync of the DS1307 - the cut comes while it waits for the second to write (the RTC taken) */
+static void Sync(Result_t *result)
+{
+    uint8_t frame[USB_LINK_MAX_FRAME];
+    uint8_t payload[TIME_SYNC_PAYLOAD_SIZE] = { 0U };   /* no link delay */
+
+    for(uint32_t i = 0; i < 8U; i++)
+    {
+        payload[i] = (uint8_t)(SYNC_UTC_US >> (8U * i));
+    }
+    HostSim_UsbWrite(frame, UpdateProtocol_Frame((uint8_t)USB_LINK_CMD_TIME_SYNC, payload, sizeof(payload), frame));
+    HostSim_RunForUs(SYNC_CUT_AFTER_US);
+    Cut(result);
+    result->syncs = TimeSyncStats.syncs;
+}
+
+/* The boot after the cut - what the monitor read, then the opening resumed until it ended */
+static void AfterCut(Result_t *result)
+{
+    uint64_t bootStart = result->state.time_us;         /* the supply back - the startup delay of the firmware included */
+    const HostSim_MotorEvent_t *log;
+
+    result->bootRecord = PowerMonitorStats.bootRecord;
+    result->encoderRestored = PowerMonitorStats.encoderRestored;
+    result->restoredFromTop = -EncoderState.topCount;      /* the count of the boot is 0 - the blind where it came to rest */
+    result->restoredSpan = EncoderState.bottomCount - EncoderState.topCount;
+
+    uint64_t start = HostSim_NowUs();
+    while((HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED) != BLINDS_OPEN) && ((HostSim_NowUs() - start) < MOVE_TIMEOUT_US))
+    {
+        HostSim_RunForUs(SAMPLE_US);
+    }
+    result->isClosedAfter = HostSim_RtcReadRegister(DS1307_REG_ADDR_IS_CLOSED);
+
+    result->resumed_us = NO_TIME;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if(log[i].motorControl1 || log[i].motorControl2)
+        {
+            result->resumed_us = log[i].time_us - bootStart;
+            break;
+        }
+    }
+}
+
+/* One boot in its own process - the boot after the cut starts from the state and the rest position in the result */
+static void Run(const void *context, void *output)
+{
+    const BootRun_t *run = context;
+    Result_t *result = output;
+
+    if(!run->afterCut)
+    {
+        memset(result, 0, sizeof(*result));
+        result->crossing_us = result->detect_us = result->bridgeOff_us = result->flush_us = result->dropout_us = NO_TIME;
+        Boot(NULL, BOOT_POSITION_M);
+        switch(run->scenario)
+        {
+            case SCENARIO_MOVING:   Moving(result);     break;
+            case SCENARIO_IDLE:     Cut(result);        break;
+            case SCENARIO_DIP:      Dip(result);        break;
+            case SCENARIO_GLITCH:   Glitch(result);     break;
+            case SCENARIO_LIMIT:    Limit(result);      break;
+            case SCENARIO_SYNC:     Sync(result);       break;
+            default:                                    break;
+        }
+    }
+    else
+    {
+        Boot(&result->state, result->restPosition_m);
+        AfterCut(result);
+    }
+}
+
+static bool RunProcess(Scenario_t scenario, bool afterCut, Result_t *result)
+{
+    BootRun_t run = { scenario, afterCut };
+    return HostSim_RunIsolated(Run, &run, result, sizeof(*result));
+}
+
+static double Ms(uint64_t from_us, uint64_t to_us)
+{
+    return ((from_us == NO_TIME) || (to_us == NO_TIME) || (to_us < from_us)) ? -1.0 : ((to_us - from_us) / 1000.0);
+}
+
+static void PrintTime(uint64_t from_us, uint64_t to_us)
+{
+    if(Ms(from_us, to_us) < 0.0) printf(" %10s", "-");
+    else printf(" %8.3fms", Ms(from_us, to_us));
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-52s %-30s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_SCENARIOS];
+    uint32_t failures = 0;
+    char value[64];
+
+    Plant_DefaultParams(&Params);
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        Result_t *result = &results[scenario];
+        if(!RunProcess((Scenario_t)scenario, false, result) || (result->died && !RunProcess((Scenario_t)scenario, true, result)))
+        {
+            printf("simulation of %s crashed\n", ScenarioNames[scenario]);
+            return 1;
+        }
+    }
+
+    printf("12V rail on %.0f uF, %.0f mA for the board, dropout at %.1f V - fail below %u mV, good above %u mV, checked every %u us\n\n",
+           SUPPLY_CAPACITANCE_F * 1e6, BOARD_CURRENT_A * 1000.0, DROPOUT_V, (unsigned)POWER_MONITOR_FAIL_MV,
+           (unsigned)POWER_MONITOR_GOOD_MV, (unsigned)POWER_MONITOR_PERIOD_IN_US);
+    printf("%-8s %9s %10s %10s %10s %10s %10s %8s %8s\n", "scenario", "motor [A]", "detect", "bridge off", "flush", "dropout",
+           "lowest mV", "edges", "checks/s");
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        const Result_t *result = &results[scenario];
+        printf("%-8s %9.2f", ScenarioNames[scenario], result->motorCurrent_A);
+        PrintTime(result->crossing_us, result->detect_us);
+        PrintTime(result->crossing_us, result->bridgeOff_us);
+        PrintTime(result->crossing_us, result->flush_us);
+        PrintTime(result->crossing_us, result->dropout_us);
+        printf(" %10u %8u %8.0f\n", (unsigned)PowerMonitor_Millivolts(result->stats.lowest), (unsigned)result->stats.failures, result->conversionsPerS);
+    }
+    printf("(times from the rail crossing %u mV)\n", (unsigned)POWER_MONITOR_FAIL_MV);
+
+    const Result_t *moving = &results[SCENARIO_MOVING];
+    const Result_t *idle = &results[SCENARIO_IDLE];
+    const Result_t *dip = &results[SCENARIO_DIP];
+    const Result_t *glitch = &results[SCENARIO_GLITCH];
+    const Result_t *limit = &results[SCENARIO_LIMIT];
+    const Result_t *sync = &results[SCENARIO_SYNC];
+    double detectLimit_ms = (POWER_MONITOR_FAIL_SAMPLES + 1U) * POWER_MONITOR_PERIOD_IN_US / 1000.0;
+    double mmPerCount = MetersPerCount() * 1000.0;
+    double tolerance_mm = (double)MOTOR_POSITION_TOLERANCE * (double)moving->plantSpan * mmPerCount;
+    /* The dropout had the H-bridge stayed on - the motor current at the crossing on top of the board */
+    double bridgeOnDropout_ms = SUPPLY_CAPACITANCE_F * ((POWER_MONITOR_FAIL_MV / 1000.0) - DROPOUT_V) /
+                                (moving->motorCurrent_A + BOARD_CURRENT_A) * 1000.0;
+
+    printf("\n%-52s %-30s %s\n", "check", "value", "result");
+    snprintf(value, sizeof(value), "%.3f / %.3f ms", Ms(moving->crossing_us, moving->detect_us), Ms(idle->crossing_us, idle->detect_us));
+    failures += !Check("edge: detected within the samples of the filter", value,
+                       (moving->stats.failures == 1U) && (idle->stats.failures == 1U) &&
+                       (Ms(moving->crossing_us, moving->detect_us) >= 0.0) && (Ms(moving->crossing_us, moving->detect_us) <= detectLimit_ms) &&
+                       (Ms(idle->crossing_us, idle->detect_us) >= 0.0) && (Ms(idle->crossing_us, idle->detect_us) <= detectLimit_ms));
+    snprintf(value, sizeof(value), "%.3f ms after the detection", Ms(moving->detect_us, moving->bridgeOff_us));
+    failures += !Check("moving: H-bridge off at the edge", value, (moving->bridgeOff_us != NO_TIME) &&
+                       (moving->bridgeOff_us <= (moving->detect_us + POWER_MONITOR_PERIOD_IN_US)));
+    snprintf(value, sizeof(value), "%.3f ms, %.1f ms hold-up", Ms(moving->detect_us, moving->flush_us), Ms(moving->detect_us, moving->dropout_us));
+    failures += !Check("moving: record flushed before the dropout", value, (moving->stats.flushes == 1U) &&
+                       (moving->stats.flushErrors == 0U) && (moving->flush_us < moving->dropout_us));
+    snprintf(value, sizeof(value), "%.1f ms, %.2f ms bridge on", Ms(moving->crossing_us, moving->dropout_us), bridgeOnDropout_ms);
+    failures += !Check("moving: hold-up gained by the H-bridge off", value,
+                       Ms(moving->crossing_us, moving->dropout_us) > (2.0 * bridgeOnDropout_ms));
+    snprintf(value, sizeof(value), "%.3f ms, %.1f ms hold-up", Ms(idle->detect_us, idle->flush_us), Ms(idle->detect_us, idle->dropout_us));
+    failures += !Check("idle: record flushed before the dropout", value, (idle->stats.flushes == 1U) && (idle->flush_us < idle->dropout_us));
+    snprintf(value, sizeof(value), "%u during the move, %u at the cut", (unsigned)moving->isClosedBefore, (unsigned)moving->nvram[0]);
+    failures += !Check("moving: IS_CLOSED back to the state before the move", value, (moving->isClosedBefore == BLINDS_OPEN) &&
+                       (moving->nvram[0] == BLINDS_CLOSED));
+
+    const PowerFailRecord_t *record = &moving->bootRecord;
+    snprintf(value, sizeof(value), "%s, channel 0 0x%02x", record->valid ? "valid" : "none", (unsigned)record->channels[0]);
+    failures += !Check("after: the record of the automatic move read", value, record->valid &&
+                       ((record->channels[0] & WATCHDOG_CHANNEL_STATE_MASK) == STATE_ANTICLOCKWISE) &&
+                       ((record->channels[0] & WATCHDOG_CHANNEL_AUTOMATIC) != 0U));
+    snprintf(value, sizeof(value), "span %d, plant %d", (int)moving->restoredSpan, (int)moving->plantSpan);
+    failures += !Check("after: encoder travel restored from the record", value, moving->encoderRestored &&
+                       (abs(moving->restoredSpan - moving->plantSpan) <= (moving->plantSpan / 50)));
+    snprintf(value, sizeof(value), "%.2f mm off", abs(moving->restoredFromTop - moving->trueFromTop) * mmPerCount);
+    failures += !Check("after: position of the blind from the record", value,
+                       (abs(moving->restoredFromTop - moving->trueFromTop) * mmPerCount) <= tolerance_mm);
+    snprintf(value, sizeof(value), "motor on %.2f s after the boot, IS_CLOSED %u", (moving->resumed_us != NO_TIME) ? moving->resumed_us / 1e6 : -1.0,
+             (unsigned)moving->isClosedAfter);
+    failures += !Check("after: the cut opening resumed and ended", value, (moving->resumed_us != NO_TIME) &&
+                       (moving->isClosedAfter == BLINDS_OPEN));
+    snprintf(value, sizeof(value), "%s, count %d", idle->bootRecord.valid ? "valid" : "none", (int)idle->bootRecord.count);
+    failures += !Check("after idle: record without an encoder travel", value, idle->bootRecord.valid &&
+                       (idle->bootRecord.count == POWER_FAIL_NO_COUNT) && !idle->encoderRestored && (idle->resumed_us == NO_TIME));
+
+    snprintf(value, sizeof(value), "%u edges, %u recoveries, lowest %u mV", (unsigned)dip->stats.failures, (unsigned)dip->stats.recoveries,
+             (unsigned)PowerMonitor_Millivolts(dip->stats.lowest));
+    failures += !Check("dip: detected and recovered from", value, (dip->stats.failures == 1U) && (dip->stats.recoveries == 1U) &&
+                       (dip->stats.flushes == 1U));
+    snprintf(value, sizeof(value), "%s, record %s", dip->stoppedAndReleased ? "stopped" : "running", dip->recordCleared ? "cleared" : "kept");
+    failures += !Check("dip: the move stopped, the record cleared", value, dip->stoppedAndReleased && dip->recordCleared);
+    snprintf(value, sizeof(value), "%s", dip->infoMatches ? "same" : "different");
+    failures += !Check("dip: POWER_INFO shows the counters", value, dip->infoMatches);
+
+    snprintf(value, sizeof(value), "%u edges, lowest %u mV", (unsigned)glitch->stats.failures, (unsigned)PowerMonitor_Millivolts(glitch->stats.lowest));
+    failures += !Check("glitch: a single sample below is no edge", value, (glitch->stats.failures == 0U) &&
+                       (PowerMonitor_Millivolts(glitch->stats.lowest) < POWER_MONITOR_FAIL_MV));
+
+    snprintf(value, sizeof(value), "%s, %u motor starts", limit->heldWhileFailing ? "held" : "given away", (unsigned)limit->startsWhileFailing);
+    failures += !Check("limit: back-off and move held while failing", value, (limit->stats.failures == 1U) &&
+                       limit->heldWhileFailing && (limit->startsWhileFailing == 0U) && (limit->bridgeOff_us != NO_TIME) &&
+                       (limit->bridgeOff_us <= (limit->detect_us + POWER_MONITOR_PERIOD_IN_US)));
+    snprintf(value, sizeof(value), "%u back-offs, %s", (unsigned)limit->backoffs, limit->stoppedAndReleased ? "channel free" : "channel owned");
+    failures += !Check("limit: back-off over, channel free on recovery", value, (limit->stats.recoveries == 1U) &&
+                       (limit->backoffs == 1U) && !limit->backoffActive && limit->stoppedAndReleased);
+
+    snprintf(value, sizeof(value), "%.3f ms, %u given up, %u syncs", Ms(sync->detect_us, sync->flush_us), (unsigned)sync->stats.rtcBusy,
+             (unsigned)sync->syncs);
+    failures += !Check("sync: record flushed, the sync given up", value, (sync->stats.flushes == 1U) &&
+                       (sync->stats.rtcBusy == 0U) && (sync->flush_us < sync->dropout_us) && (sync->syncs == 0U) &&
+                       sync->bootRecord.valid);
+
+    snprintf(value, sizeof(value), "%u / %u counts", (unsigned)glitch->lightFiltered, (unsigned)LIGHT_COUNTS);
+    failures += !Check("light: the input sampled along with the supply", value,
+                       (abs((int)glitch->lightFiltered - (int)LIGHT_COUNTS) <= 8) && (abs((int)dip->lightFiltered - (int)LIGHT_COUNTS) <= 8));
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/* Profile.c - the captures of the firmware profiler on the host (see Profile.h). The text file is one line per item:
+     rate <Hz> / period <us> / late <alarms> - the capture
+     task <index> <name>                        - the tasks the samples refer to
+     sample <pc in hex> <task index>            - 255 (PROFILER_TASK_NONE) - no task */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Profile.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define ELF_CLASS_32            (1U)
+#define ELF_CLASS_64            (2U)
+#define ELF_DATA_LSB            (1U)
+#define ELF_MACHINE_ARM         (40U)
+#define ELF_SECTION_SYMTAB      (2U)
+#define ELF_SYMBOL_FUNC         (2U)
+#define BOOT_ROM_END            (0x4000U)   /* RP2040 - the soft float and memcpy of the SDK run from the boot ROM */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- ELF ---- */
+
+static uint64_t Get(const uint8_t *p, uint32_t size)
+{
+    uint64_t value = 0;
+    for(uint32_t i = size; i > 0U; i--) value = (value << 8) | p[i - 1U];
+    return value;
+}
+
+static int CompareSymbols(const void *a, const void *b)
+{
+    const ProfileSymbol_t *left = a, *right = b;
+    return (left->address > right->address) - (left->address < right->address);
+}
+
+static int CompareEntries(const void *a, const void *b)
+{
+    const ProfileEntry_t *left = a, *right = b;
+    if(left->samples != right->samples) return (left->samples < right->samples) ? 1 : -1;
+    int byName = strcmp(left->function, right->function);
+    return (byName != 0) ? byName : strcmp(left->task, right->task);
+}
+
+/* Function symbols of one symbol table (and the string table it links to) */
+static void AddSymbols(ProfileSymbols_t *symbols, size_t length, uint64_t offset, uint64_t size, uint64_t stringsOffset, bool is64)
+{
+    uint32_t entrySize = is64 ? 24U : 16U;
+    const uint8_t *image = symbols->image;
+
+    if((offset + size > length) || (stringsOffset >= length)) return;
+    ProfileSymbol_t *grown = realloc(symbols->symbols, (symbols->numOfSymbols + (size / entrySize)) * sizeof(ProfileSymbol_t));
+    if(grown == NULL) return;
+    symbols->symbols = grown;
+
+    for(uint64_t entry = offset; entry + entrySize <= offset + size; entry += entrySize)
+    {
+        const uint8_t *sym = &image[entry];
+        uint32_t name = (uint32_t)Get(sym, 4U);
+        uint8_t info = is64 ? sym[4] : sym[12];
+        uint64_t value = is64 ? Get(&sym[8], 8U) : Get(&sym[4], 4U);
+        uint64_t symSize = is64 ? Get(&sym[16], 8U) : Get(&sym[8], 4U);
+        if(((info & 0x0FU) != ELF_SYMBOL_FUNC) || (value == 0U) || (stringsOffset + name >= length)) continue;
+
+        ProfileSymbol_t *symbol = &symbols->symbols[symbols->numOfSymbols++];
+        symbol->address = (uint32_t)value & (symbols->arm ? ~1U : ~0U);
+        symbol->size = (uint32_t)symSize;
+        symbol->name = (const char *)&image[stringsOffset + name];
+    }
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- Capture ---- */
+
+bool Profile_Download(const UpdateTransport_t *transport, Profile_t *profile)
+{
+    UpdateProfileInfo_t info;
+    char reason[32];
+
+    memset(profile, 0, sizeof(*profile));
+    if(!UpdateProtocol_ProfileInfo(transport, &info)) return false;
+    if(strcmp(info.state, "capturing") == 0)
+    {
+        if(!UpdateProtocol_ProfileStart(transport, 0U, reason, sizeof(reason)) || !UpdateProtocol_ProfileInfo(transport, &info)) return false;
+    }
+    profile->rate_hz = info.rate_hz;
+    profile->period_us = info.period_us;
+    profile->late = info.late;
+    if(info.samples > 0U)
+    {
+        uint32_t samples = (info.samples < PROFILER_MAX_SAMPLES) ? info.samples : PROFILER_MAX_SAMPLES;
+        profile->numOfSamples = UpdateProtocol_ProfileRead(transport, profile->pcs, profile->tasks, samples);
+        if(profile->numOfSamples != samples) return false;
+    }
+    profile->numOfTasks = (info.tasks < PROFILER_MAX_TASKS) ? info.tasks : PROFILER_MAX_TASKS;
+    for(uint32_t task = 0; task < profile->numOfTasks; task++)
+    {
+        if(!UpdateProtocol_ProfileTask(transport, task, profile->taskNames[task], PROFILE_TASK_NAME_SIZE)) return false;
+    }
+    return true;
+}
+
+bool Profile_Save(const Profile_t *profile, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if(file == NULL) return false;
+
+    fprintf(file, "rate %u\nperiod %u\nlate %u\n", (unsigned)profile->rate_hz, (unsigned)profile->period_us, (unsigned)profile->late);
+    for(uint32_t task = 0; task < profile->numOfTasks; task++)
+    {
+        fprintf(file, "task %u %s\n", (unsigned)task, profile->taskNames[task]);
+    }
+    for(uint32_t sample = 0; sample < profile->numOfSamples; sample++)
+    {
+        fprintf(file, "sample %08x %u\n", (unsigned)profile->pcs[sample], (unsigned)profile->tasks[sample]);
+    }
+    return (fclose(file) == 0);
+}
+
+bool Profile_Load(Profile_t *profile, const char *path)
+{
+    char line[128], name[PROFILE_TASK_NAME_SIZE];
+    unsigned int first, second;
+    bool ok = true;
+
+    FILE *file = fopen(path, "r");
+    if(file == NULL) return false;
+    memset(profile, 0, sizeof(*profile));
+    while(ok && (fgets(line, sizeof(line), file) != NULL))
+    {
+        if(sscanf(line, "rate %u", &first) == 1) profile->rate_hz = first;
+        else if(sscanf(line, "period %u", &first) == 1) profile->period_us = first;
+        else if(sscanf(line, "late %u", &first) == 1) profile->late = first;
+        else if(sscanf(line, "task %u %31s", &first, name) == 2)
+        {
+            ok = (first == profile->numOfTasks) && (first < PROFILER_MAX_TASKS);
+            if(ok) snprintf(profile->taskNames[profile->numOfTasks++], PROFILE_TASK_NAME_SIZE, "%s", name);
+        }
+        else if(sscanf(line, "sample %x %u", &first, &second) == 2)
+        {
+            ok = (profile->numOfSamples < PROFILER_MAX_SAMPLES) && (second <= 0xFFU);
+            if(ok)
+            {
+                profile->pcs[profile->numOfSamples] = first;
+                profile->tasks[profile->numOfSamples++] = (uint8_t)second;
+            }
+        }
+        else ok = (line[0] == '\n') || (line[0] == '#');
+    }
+    fclose(file);
+    return ok && (profile->period_us > 0U);
+}
+
+const char* Profile_TaskName(const Profile_t *profile, uint8_t task)
+{
+    return (task < profile->numOfTasks) ? profile->taskNames[task] : "[no task]";
+}
+
+/* ---- Symbols ---- */
+
+bool Profile_LoadSymbols(ProfileSymbols_t *symbols, const char *path)
+{
+    memset(symbols, 0, sizeof(*symbols));
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    symbols->image = (length > 64) ? malloc((size_t)length) : NULL;
+    bool read = (symbols->image != NULL) && (fread(symbols->image, 1U, (size_t)length, file) == (size_t)length);
+    fclose(file);
+
+    const uint8_t *image = symbols->image;
+    if(!read || (memcmp(image, "\x7F" "ELF", 4U) != 0) || (image[5] != ELF_DATA_LSB) ||
+       ((image[4] != ELF_CLASS_32) && (image[4] != ELF_CLASS_64)))
+    {
+        Profile_FreeSymbols(symbols);
+        return false;
+    }
+
+    bool is64 = (image[4] == ELF_CLASS_64);
+    symbols->arm = (Get(&image[18], 2U) == ELF_MACHINE_ARM);
+    uint64_t sectionsOffset = is64 ? Get(&image[40], 8U) : Get(&image[32], 4U);
+    uint32_t sectionSize = (uint32_t)(is64 ? Get(&image[58], 2U) : Get(&image[46], 2U));
+    uint32_t numOfSections = (uint32_t)(is64 ? Get(&image[60], 2U) : Get(&image[48], 2U));
+    if(sectionsOffset + ((uint64_t)sectionSize * numOfSections) > (uint64_t)length)
+    {
+        Profile_FreeSymbols(symbols);
+        return false;
+    }
+
+    for(uint32_t section = 0; section < numOfSections; section++)
+    {
+        const uint8_t *header = &image[sectionsOffset + ((uint64_t)section * sectionSize)];
+        if(Get(&header[4], 4U) != ELF_SECTION_SYMTAB) continue;
+        uint64_t offset = is64 ? Get(&header[24], 8U) : Get(&header[16], 4U);
+        uint64_t size = is64 ? Get(&header[32], 8U) : Get(&header[20], 4U);
+        uint32_t link = (uint32_t)Get(&header[is64 ? 40U : 24U], 4U);
+        if(link >= numOfSections) continue;
+        const uint8_t *strings = &image[sectionsOffset + ((uint64_t)link * sectionSize)];
+        AddSymbols(symbols, (size_t)length, offset, size, is64 ? Get(&strings[24], 8U) : Get(&strings[16], 4U), is64);
+    }
+    qsort(symbols->symbols, symbols->numOfSymbols, sizeof(ProfileSymbol_t), CompareSymbols);
+    return (symbols->numOfSymbols > 0U);
+}
+
+void Profile_FreeSymbols(ProfileSymbols_t *symbols)
+{
+    free(symbols->symbols);
+    free(symbols->image);
+    memset(symbols, 0, sizeof(*symbols));
+}
+
+/* The function the PC is in - the last symbol at or below it, its size when the image has one */
+void Profile_FunctionName(const ProfileSymbols_t *symbols, uint32_t pc, char *name, uint32_t size)
+{
+    if(pc == 0U)
+    {
+        snprintf(name, size, "(idle)");
+        return;
+    }
+    if(symbols->arm && (pc < BOOT_ROM_END))
+    {
+        snprintf(name, size, "[bootrom]");
+        return;
+    }
+
+    uint32_t low = 0, high = symbols->numOfSymbols;
+    while(low < high)
+    {
+        uint32_t middle = (low + high) / 2U;
+        if(symbols->symbols[middle].address <= pc) low = middle + 1U;
+        else high = middle;
+    }
+    const ProfileSymbol_t *symbol = (low > 0U) ? &symbols->symbols[low - 1U] : NULL;
+    if((symbol != NULL) && ((symbol->size == 0U) || (pc < (symbol->address + symbol->size))))
+    {
+        snprintf(name, size, "%s", symbol->name);
+    }
+    else
+    {
+        snprintf(name, size, "0x%08x", (unsigned)pc);
+    }
+}
+
+/* ---- Reports ---- */
+
+uint32_t Profile_Aggregate(const Profile_t *profile, const ProfileSymbols_t *symbols, ProfileEntry_t *entries, uint32_t maxEntries)
+{
+    uint32_t numOfEntries = 0;
+    char function[PROFILE_MAX_NAME];
+
+    for(uint32_t sample = 0; sample < profile->numOfSamples; sample++)
+    {
+        const char *task = Profile_TaskName(profile, profile->tasks[sample]);
+        Profile_FunctionName(symbols, profile->pcs[sample], function, sizeof(function));
+
+        uint32_t entry = 0;
+        while((entry < numOfEntries) && ((strcmp(entries[entry].function, function) != 0) || (strcmp(entries[entry].task, task) != 0))) entry++;
+        if(entry == numOfEntries)
+        {
+            if(numOfEntries >= maxEntries) continue;
+            snprintf(entries[entry].function, sizeof(entries[entry].function), "%s", function);
+            snprintf(entries[entry].task, sizeof(entries[entry].task), "%s", task);
+            entries[entry].samples = 0;
+            numOfEntries++;
+        }
+        entries[entry].samples++;
+    }
+    qsort(entries, numOfEntries, sizeof(ProfileEntry_t), CompareEntries);
+    return numOfEntries;
+}
+
+/* The top functions (the time estimated from the samples at the period), then the share of every task */
+void Profile_PrintFlat(FILE *out, const Profile_t *profile, const ProfileEntry_t *entries, uint32_t numOfEntries, uint32_t top)
+{
+    double total = (profile->numOfSamples > 0U) ? (double)profile->numOfSamples : 1.0;
+
+    fprintf(out, "%u samples at %u Hz (period %u us, %u late) - %.3f s of run time\n\n", (unsigned)profile->numOfSamples,
+            (unsigned)profile->rate_hz, (unsigned)profile->period_us, (unsigned)profile->late, (profile->numOfSamples * (double)profile->period_us) / 1e6);
+    fprintf(out, "%8s %7s %10s  %-40s %s\n", "samples", "%", "est. ms", "function", "task");
+    for(uint32_t entry = 0; (entry < numOfEntries) && ((top == 0U) || (entry < top)); entry++)
+    {
+        fprintf(out, "%8u %6.2f%% %10.1f  %-40s %s\n", (unsigned)entries[entry].samples, (100.0 * entries[entry].samples) / total,
+                (entries[entry].samples * (double)profile->period_us) / 1000.0, entries[entry].function, entries[entry].task);
+    }
+
+    fprintf(out, "\n%8s %7s  %s\n", "samples", "%", "task");
+    for(uint32_t entry = 0; entry < numOfEntries; entry++)
+    {
+        bool seen = false;
+        uint32_t samples = 0;
+        for(uint32_t other = 0; other < numOfEntries; other++)
+        {
+            if(strcmp(entries[other].task, entries[entry].task) != 0) continue;
+            if(other < entry) seen = true;
+            samples += entries[other].samples;
+        }
+        if(!seen) fprintf(out, "%8u %6.2f%%  %s\n", (unsigned)samples, (100.0 * samples) / total, entries[entry].task);
+    }
+}
+
+/* task;function count - the input of flamegraph.pl */
+void Profile_PrintFolded(FILE *out, const ProfileEntry_t *entries, uint32_t numOfEntries)
+{
+    for(uint32_t entry = 0; entry < numOfEntries; entry++)
+    {
+        fprintf(out, "%s;%s %u\n", entries[entry].task, entries[entry].function, (unsigned)entries[entry].samples);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Profile.h - a capture of the profiler of the firmware (Profiler.h) on the host: downloaded over the USB link, kept in a text
+   file, symbolized with the symbol table of the ELF image it was taken on and reported flat or folded (flamegraph.pl) */
+
+/*---------------- INCLUDES ----------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Profiler.h"
+#include "UpdateProtocol.h"
+
+/*--------------- MACROS ---------------*/
+#define PROFILE_MAX_NAME                    (64U)
+#define PROFILE_TASK_NAME_SIZE              (32U)
+
+/*--------------- DATA TYPES ---------------*/
+
+typedef struct
+{
+    uint32_t rate_hz;
+    uint32_t period_us;
+    uint32_t late;
+    uint32_t numOfSamples;
+    uint32_t pcs[PROFILER_MAX_SAMPLES];
+    uint8_t tasks[PROFILER_MAX_SAMPLES];            /* index in taskNames, PROFILER_TASK_NONE - no task */
+    uint32_t numOfTasks;
+    char taskNames[PROFILER_MAX_TASKS][PROFILE_TASK_NAME_SIZE];
+}Profile_t;
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t size;
+    const char *name;                               /* in the string table of the image */
+}ProfileSymbol_t;
+
+typedef struct
+{
+    uint8_t *image;
+    ProfileSymbol_t *symbols;                       /* sorted by address */
+    uint32_t numOfSymbols;
+    bool arm;                                       /* thumb bit masked, the boot ROM below 0x4000 */
+}ProfileSymbols_t;
+
+/* Samples of one function in one task */
+typedef struct
+{
+    char function[PROFILE_MAX_NAME];
+    char task[PROFILE_TASK_NAME_SIZE];
+    uint32_t samples;
+}ProfileEntry_t;
+
+/*--------------- GLOBAL FUNCTION DECLARATIONS ---------------*/
+
+/* The capture of the board - its rate, the samples and the task names (a capture still running is stopped first), false on a
+   timeout */
+bool Profile_Download(const UpdateTransport_t *transport, Profile_t *profile);
+bool Profile_Save(const Profile_t *profile, const char *path);
+bool Profile_Load(Profile_t *profile, const char *path);
+const char* Profile_TaskName(const Profile_t *profile, uint8_t task);
+
+/* Function symbols of an ELF image (32 or 64-bit, little-endian) */
+bool Profile_LoadSymbols(ProfileSymbols_t *symbols, const char *path);
+void Profile_FreeSymbols(ProfileSymbols_t *symbols);
+void Profile_FunctionName(const ProfileSymbols_t *symbols, uint32_t pc, char *name, uint32_t size);
+
+/* Samples per function and task, most samples first - the number of entries */
+uint32_t Profile_Aggregate(const Profile_t *profile, const ProfileSymbols_t *symbols, ProfileEntry_t *entries, uint32_t maxEntries);
+void Profile_PrintFlat(FILE *out, const Profile_t *profile, const ProfileEntry_t *entries, uint32_t numOfEntries, uint32_t top);
+void Profile_PrintFolded(FILE *out, const ProfileEntry_t *entries, uint32_t numOfEntries);
+
+#endif /* PROFILE_H */
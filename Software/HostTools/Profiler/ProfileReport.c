@@ -0,0 +1,75 @@
+/* ProfileReport.c - the report of a capture of the firmware profiler (UpdateSender --profile-read): the samples symbolized with
+   the .elf of the image they were taken on (build/SwComponents/ElectronicBlinds_Main.elf), flat - the functions and the tasks
+   by their share of the samples - and folded for flamegraph.pl (a "task;function" stack per line).
+
+   Usage: ProfileReport --elf ElectronicBlinds_Main.elf --profile profile.txt [--top N] [--folded profile.folded]
+   Exits with 1 if the profile or the symbols of the image cannot be read. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Profile.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define DEFAULT_TOP             (25U)
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    static Profile_t profile;
+    static ProfileEntry_t entries[PROFILER_MAX_SAMPLES];
+    const char *elfPath = NULL, *profilePath = NULL, *foldedPath = NULL;
+    uint32_t top = DEFAULT_TOP;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--elf") == 0) && ((i + 1) < argc)) elfPath = argv[++i];
+        else if((strcmp(argv[i], "--profile") == 0) && ((i + 1) < argc)) profilePath = argv[++i];
+        else if((strcmp(argv[i], "--folded") == 0) && ((i + 1) < argc)) foldedPath = argv[++i];
+        else if((strcmp(argv[i], "--top") == 0) && ((i + 1) < argc)) top = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else
+        {
+            elfPath = NULL;
+            break;
+        }
+    }
+    if((elfPath == NULL) || (profilePath == NULL))
+    {
+        fprintf(stderr, "Usage: %s --elf IMAGE.elf --profile FILE [--top N] [--folded FILE]\n", argv[0]);
+        return 1;
+    }
+
+    ProfileSymbols_t symbols;
+    if(!Profile_Load(&profile, profilePath))
+    {
+        fprintf(stderr, "%s: not a profile\n", profilePath);
+        return 1;
+    }
+    if(!Profile_LoadSymbols(&symbols, elfPath))
+    {
+        fprintf(stderr, "%s: no function symbols (not an ELF image or stripped)\n", elfPath);
+        return 1;
+    }
+
+    uint32_t numOfEntries = Profile_Aggregate(&profile, &symbols, entries, PROFILER_MAX_SAMPLES);
+    Profile_PrintFlat(stdout, &profile, entries, numOfEntries, top);
+    if(foldedPath != NULL)
+    {
+        FILE *folded = fopen(foldedPath, "w");
+        if(folded == NULL)
+        {
+            perror(foldedPath);
+            Profile_FreeSymbols(&symbols);
+            return 1;
+        }
+        Profile_PrintFolded(folded, entries, numOfEntries);
+        fclose(folded);
+    }
+    Profile_FreeSymbols(&symbols);
+    return 0;
+}
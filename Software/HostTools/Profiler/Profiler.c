@@ -0,0 +1,279 @@
+/* Profiler.c - the statistical profiler of the firmware (Profiler.c of the firmware, PROFILER_ENABLED=1): captures started and
+   read over the USB link like UpdateSender --profile-start/--profile-read do, symbolized with the symbol table of this
+   executable like ProfileReport does with the .elf of the image.
+
+   In the simulation task code takes no virtual time - the alarm interrupts a busy wait (its caller is the PC sampled) or the
+   idle core (PC 0). One boot per scenario, each in its own process:
+     idle   - the board at rest: a rate over PROFILER_MAX_RATE_HZ is refused, a capture stopped after a second holds a second
+              of samples, a capture left to run stops full at PROFILER_MAX_SAMPLES - nearly all of them on the idle core
+     stall  - SolarWorkerTask made to busy-loop for STALL_US at the end of its second run (HostSim_StallTask) while a capture
+              at STALL_RATE_HZ runs: the hot function of the profile (after the idle core) is that
+              loop, in that task, for the length of the stall
+
+   Usage: Profiler
+   Exits with 1 if a check fails: a bad rate is taken, the number of samples does not follow the rate, samples are late, the
+   idle board is not seen idle, the stall is not the hot function of the profile (in its task, symbolized, for its length) or a
+   profile does not read back from its file the same. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "Profiler.h"
+
+#include "UpdateProtocol.h"
+#include "Profile.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (6000000ULL)
+#define STOP_AFTER_US           (1000000ULL)
+#define FULL_WAIT_US            (2500000ULL)                                            /* PROFILER_MAX_SAMPLES at the default rate */
+#define STALL_ARMED_US          ((uint64_t)AUTOMATIC_CONTROL_TASK_PERIOD * 600ULL)      /* between the first and the second run */
+#define STALL_CAPTURE_US        ((uint64_t)AUTOMATIC_CONTROL_TASK_PERIOD * 1000ULL)     /* a few seconds before the second run */
+#define STALL_US                (3000000ULL)
+#define STALL_RATE_HZ           (199U)                                                  /* 10 s of samples */
+#define SAMPLES_TOLERANCE       (0.02)
+#define STALL_TOLERANCE         (0.05)
+#define MIN_IDLE_SHARE          (0.95)
+#define MAX_ENTRIES             (64U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    SCENARIO_IDLE,
+    SCENARIO_STALL,
+    NUM_OF_SCENARIOS
+}ScenarioId_t;
+
+typedef struct
+{
+    bool reset;                             /* the boot ended with a reset */
+    char refused[32];                       /* reason of the #ERR to the rate over the limit, "ACK" if it was taken */
+    bool stopped;
+    UpdateProfileInfo_t stopInfo;           /* the capture stopped after STOP_AFTER_US */
+    bool downloaded;
+    char state[16];                         /* of the capture downloaded, before the download */
+    Profile_t profile;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *const ScenarioNames[NUM_OF_SCENARIOS] = { "idle", "stall" };
+
+static Result_t Result;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- USB link ---- */
+
+static void SimWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    HostSim_UsbWrite(data, length);
+}
+
+static bool SimReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    (void)context;
+    return HostSim_UsbReadLine(line, size, timeout_ms * 1000ULL);
+}
+
+static void SimSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    HostSim_RunForUs(ms * 1000ULL);
+}
+
+/* ---- Scenarios ---- */
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    (void)state;
+    Result.reset = true;
+    HostSim_IsolatedResult(&Result);
+}
+
+static void Download(const UpdateTransport_t *transport)
+{
+    UpdateProfileInfo_t info;
+
+    if(UpdateProtocol_ProfileInfo(transport, &info)) snprintf(Result.state, sizeof(Result.state), "%s", info.state);
+    Result.downloaded = Profile_Download(transport, &Result.profile);
+}
+
+static void RunIdle(const UpdateTransport_t *transport)
+{
+    char reason[32];
+
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    if(UpdateProtocol_ProfileStart(transport, PROFILER_MAX_RATE_HZ + 1U, Result.refused, sizeof(Result.refused)))
+    {
+        snprintf(Result.refused, sizeof(Result.refused), "ACK");
+    }
+
+    Result.stopped = UpdateProtocol_ProfileStart(transport, PROFILER_DEFAULT_RATE_HZ, reason, sizeof(reason));
+    HostSim_RunForUs(STOP_AFTER_US);
+    Result.stopped = Result.stopped && UpdateProtocol_ProfileStart(transport, 0U, reason, sizeof(reason)) &&
+                     UpdateProtocol_ProfileInfo(transport, &Result.stopInfo);
+
+    if(UpdateProtocol_ProfileStart(transport, PROFILER_DEFAULT_RATE_HZ, reason, sizeof(reason)))
+    {
+        HostSim_RunForUs(FULL_WAIT_US);
+        Download(transport);
+    }
+}
+
+static void RunStall(const UpdateTransport_t *transport)
+{
+    char reason[32];
+
+    HostSim_SetPreemption(true);
+    HostSim_StallTask("SolarWorkerTask", STALL_ARMED_US, STALL_US);
+    HostSim_Boot();
+    HostSim_RunUntilUs(STALL_CAPTURE_US);
+    if(UpdateProtocol_ProfileStart(transport, STALL_RATE_HZ, reason, sizeof(reason)))
+    {
+        HostSim_RunForUs(((PROFILER_MAX_SAMPLES * 1000000ULL) / STALL_RATE_HZ) + STOP_AFTER_US);
+        Download(transport);
+    }
+}
+
+/* One scenario in its own process - the result (larger than a pipe buffer) in Result, sent at the end or by the reboot hook */
+static void Run(const void *context, void *output)
+{
+    ScenarioId_t scenario = *(const ScenarioId_t*)context;
+    UpdateTransport_t transport = { NULL, SimWrite, SimReadLine, SimSleep };
+
+    (void)output;
+    memset(&Result, 0, sizeof(Result));
+    HostSim_SetRebootHook(RebootHook);
+    /* Midday in June with the blinds open - nothing moves */
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    if(scenario == SCENARIO_IDLE) RunIdle(&transport);
+    else RunStall(&transport);
+    HostSim_IsolatedResult(&Result);
+}
+
+/* Samples of a function, in any task */
+static uint32_t FunctionSamples(const ProfileEntry_t *entries, uint32_t numOfEntries, const char *function)
+{
+    uint32_t samples = 0;
+    for(uint32_t entry = 0; entry < numOfEntries; entry++)
+    {
+        if(strcmp(entries[entry].function, function) == 0) samples += entries[entry].samples;
+    }
+    return samples;
+}
+
+/* The profile saved and loaded again */
+static bool RoundTrip(const Profile_t *profile)
+{
+    static Profile_t loaded;
+    char path[] = "/tmp/ProfilerXXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) return false;
+    close(fd);
+
+    bool ok = Profile_Save(profile, path) && Profile_Load(&loaded, path) && (loaded.rate_hz == profile->rate_hz) &&
+              (loaded.period_us == profile->period_us) && (loaded.late == profile->late) && (loaded.numOfSamples == profile->numOfSamples) &&
+              (loaded.numOfTasks == profile->numOfTasks) && (memcmp(loaded.pcs, profile->pcs, profile->numOfSamples * sizeof(uint32_t)) == 0) &&
+              (memcmp(loaded.tasks, profile->tasks, profile->numOfSamples) == 0) &&
+              (memcmp(loaded.taskNames, profile->taskNames, sizeof(loaded.taskNames)) == 0);
+    unlink(path);
+    return ok;
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-46s %-34s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_SCENARIOS];
+    static ProfileEntry_t entries[NUM_OF_SCENARIOS][MAX_ENTRIES];
+    uint32_t numOfEntries[NUM_OF_SCENARIOS];
+    ProfileSymbols_t symbols;
+    char value[64];
+    uint32_t failures = 0;
+
+    if(!Profile_LoadSymbols(&symbols, "/proc/self/exe"))
+    {
+        printf("no symbols in /proc/self/exe\n");
+        return 1;
+    }
+    for(ScenarioId_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        if(!HostSim_RunIsolated(Run, &scenario, &results[scenario], sizeof(results[scenario])))
+        {
+            printf("simulation of %s crashed\n", ScenarioNames[scenario]);
+            return 1;
+        }
+        numOfEntries[scenario] = Profile_Aggregate(&results[scenario].profile, &symbols, entries[scenario], MAX_ENTRIES);
+    }
+
+    const Result_t *idle = &results[SCENARIO_IDLE], *stall = &results[SCENARIO_STALL];
+    printf("stall: %.1f s of SolarWorkerTask at the end of its second run, captured at %u Hz from %.1f s on\n\n", STALL_US / 1e6,
+           (unsigned)STALL_RATE_HZ, STALL_CAPTURE_US / 1e6);
+    Profile_PrintFlat(stdout, &stall->profile, entries[SCENARIO_STALL], numOfEntries[SCENARIO_STALL], 8U);
+    printf("\n%-46s %-34s %s\n", "check", "value", "result");
+
+    /* At rest */
+    snprintf(value, sizeof(value), "#ERR %s", idle->refused);
+    failures += !Check("idle: rate over PROFILER_MAX_RATE_HZ refused", value, strcmp(idle->refused, "rate") == 0);
+    double expected = (PROFILER_DEFAULT_RATE_HZ * (double)STOP_AFTER_US) / 1e6;
+    snprintf(value, sizeof(value), "%s, %u samples (%.0f expected)", idle->stopInfo.state, (unsigned)idle->stopInfo.samples, expected);
+    failures += !Check("idle: stopped after 1 s", idle->stopped ? value : "no #PROFILE", idle->stopped &&
+                       (strcmp(idle->stopInfo.state, "done") == 0) && (idle->stopInfo.samples >= (expected * (1.0 - SAMPLES_TOLERANCE))) &&
+                       (idle->stopInfo.samples <= (expected * (1.0 + SAMPLES_TOLERANCE))));
+    snprintf(value, sizeof(value), "%u Hz, period %u us", (unsigned)idle->profile.rate_hz, (unsigned)idle->profile.period_us);
+    failures += !Check("idle: rate of the capture", value, (idle->profile.period_us == (1000000U / PROFILER_DEFAULT_RATE_HZ)) &&
+                       (idle->profile.rate_hz == (1000000U / idle->profile.period_us)));
+    snprintf(value, sizeof(value), "%s, %u samples, %u late", idle->state, (unsigned)idle->profile.numOfSamples, (unsigned)idle->profile.late);
+    failures += !Check("idle: capture left to run stops full", idle->downloaded ? value : "no download", idle->downloaded &&
+                       (strcmp(idle->state, "done") == 0) && (idle->profile.numOfSamples == PROFILER_MAX_SAMPLES) && (idle->profile.late == 0U));
+    uint32_t idleSamples = FunctionSamples(entries[SCENARIO_IDLE], numOfEntries[SCENARIO_IDLE], "(idle)");
+    double idleShare = (double)idleSamples / ((idle->profile.numOfSamples > 0U) ? idle->profile.numOfSamples : 1U);
+    snprintf(value, sizeof(value), "%.1f%% of the samples", 100.0 * idleShare);
+    failures += !Check("idle: the core idle", value, idleShare >= MIN_IDLE_SHARE);
+
+    /* Stalled worker - the top of the profile after the idle core */
+    const ProfileEntry_t *top = NULL;
+    for(uint32_t entry = 0; (entry < numOfEntries[SCENARIO_STALL]) && (top == NULL); entry++)
+    {
+        if(strcmp(entries[SCENARIO_STALL][entry].function, "(idle)") != 0) top = &entries[SCENARIO_STALL][entry];
+    }
+    snprintf(value, sizeof(value), "%u samples, %u late", (unsigned)stall->profile.numOfSamples, (unsigned)stall->profile.late);
+    failures += !Check("stall: capture full", stall->downloaded ? value : "no download", stall->downloaded && !stall->reset &&
+                       (stall->profile.numOfSamples == PROFILER_MAX_SAMPLES) && (stall->profile.late == 0U));
+    snprintf(value, sizeof(value), "%.32s in %.24s", (top != NULL) ? top->function : "-", (top != NULL) ? top->task : "-");
+    failures += !Check("stall: hot function", value, (top != NULL) && (strcmp(top->task, "SolarWorkerTask") == 0) &&
+                       (top->function[0] != '(') && (strncmp(top->function, "0x", 2U) != 0));
+    expected = (STALL_RATE_HZ * (double)STALL_US) / 1e6;
+    snprintf(value, sizeof(value), "%u samples (%.0f expected)", (top != NULL) ? (unsigned)top->samples : 0U, expected);
+    failures += !Check("stall: length of the stall", value, (top != NULL) && (top->samples >= (expected * (1.0 - STALL_TOLERANCE))) &&
+                       (top->samples <= (expected * (1.0 + STALL_TOLERANCE))));
+
+    bool roundTrip = RoundTrip(&idle->profile) && RoundTrip(&stall->profile);
+    failures += !Check("profile file: saved and loaded the same", roundTrip ? "yes" : "no", roundTrip);
+
+    Profile_FreeSymbols(&symbols);
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+/* ResponseTime.c - response-time and schedulability analysis of the firmware task set.
+
+   The execution times come from the firmware's own instrumentation (CycleCounter) - either measured in HostSim
+   by running a button/limit switch workload (MEASUREMENT_RUNS times, the median of the worst case of each run - the host
+   clock counts the preemptions of the process too, one of them must not decide the result), or parsed from a target log (the "CYCLES ..." lines printed by
+   CycleCounter_Report when the prints are enabled). The priorities, periods and delays are taken from
+   ElectronicBlinds_Main.h at build time and can be changed for a what-if analysis with --set NAME=VALUE.
+
+   Model (fixed priority preemptive, configRUN_MULTIPLE_PRIORITIES == 0 so the tasks behave as on one core):
+     - the interrupts share one NVIC priority, so an interrupt waits for at most one run of each of the others,
+       the SysTick handler runs at the lowest priority and never delays them
+     - an input interrupts at most 1 + DEBOUNCE_MAX_EDGES times within its debounce delay - the first edge and the bounce
+       timed by the adaptive debounce (Debounce.h), masked afterwards (sporadic arrivals)
+     - R_task = C + B + sum over higher/equal priority tasks and interrupts of ceil(R / T) * C
+     - Up/Down button -> motor on is a chain of GPIO IRQ, debounce alarm, ButtonTask polling the result and
+       MotorControllerTask (which waits for its next period after every request), every polling stage adds T + R
+     - limit switch -> motor stop only goes through the GPIO IRQ and the debounce alarm, the back-off reverses
+       the motor in the alarm handler
+     - SolarWorkerTask runs once per period of AutomaticControlTask, its worst job includes the compile of the schedule
+
+   Usage: ResponseTime [--measurements FILE] [--margin PERCENT] [--set NAME=VALUE]... [--list]
+   Exits with 1 if a deadline or one of the end-to-end bounds is broken. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "CycleCounter.h"
+#include "Debounce.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (6000000ULL)
+#define WORKLOAD_ROUNDS         (24U)
+#define MEASUREMENT_RUNS        (7U)
+#define RTA_MAX_ITERATIONS      (1000U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    PARAM_BUTTON_TASK_PRIORITY,
+    PARAM_MOTOR_CONTROLLER_TASK_PRIORITY,
+    PARAM_AUTOMATIC_CONTROL_TASK_PRIORITY,
+    PARAM_SOLAR_WORKER_TASK_PRIORITY,
+    PARAM_BUTTON_TASK_PERIOD,
+    PARAM_MOTOR_CONTROLLER_TASK_PERIOD,
+    PARAM_AUTOMATIC_CONTROL_TASK_PERIOD,
+    PARAM_DEBOUNCING_DELAY_IN_US,
+    PARAM_DEBOUNCING_DELAY_IN_US_LIMITTER,
+    PARAM_DEBOUNCE_MAX_EDGES,
+    PARAM_LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US,
+    PARAM_BUTTON_TO_MOTOR_ON_BOUND_IN_US,
+    PARAM_TICK_ISR_CYCLES,
+    PARAM_CRITICAL_SECTION_IN_US,
+    PARAM_NUM_OF_PARAMS
+}ParamId_t;
+
+typedef struct
+{
+    const char *name;
+    double value;
+    const char *description;
+}Parameter_t;
+
+/* One entity of the analysis - a task or an interrupt source */
+typedef struct
+{
+    const char *name;
+    double priority;        /* tasks only */
+    double period_us;       /* period or minimum inter-arrival time */
+    double wcet_us;
+    double response_us;
+    bool schedulable;
+}Entity_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static Parameter_t Params[PARAM_NUM_OF_PARAMS] =
+{
+    { "BUTTON_TASK_PRIORITY",                   BUTTON_TASK_PRIORITY,                   "ButtonTask priority" },
+    { "MOTOR_CONTROLLER_TASK_PRIORITY",         MOTOR_CONTROLLER_TASK_PRIORITY,         "MotorControllerTask priority" },
+    { "AUTOMATIC_CONTROL_TASK_PRIORITY",        AUTOMATIC_CONTROL_TASK_PRIORITY,        "AutomaticControlTask priority" },
+    { "SOLAR_WORKER_TASK_PRIORITY",             SOLAR_WORKER_TASK_PRIORITY,             "SolarWorkerTask priority" },
+    { "BUTTON_TASK_PERIOD",                     BUTTON_TASK_PERIOD,                     "ButtonTask period [ms]" },
+    { "MOTOR_CONTROLLER_TASK_PERIOD",           MOTOR_CONTROLLER_TASK_PERIOD,           "MotorControllerTask period [ms]" },
+    { "AUTOMATIC_CONTROL_TASK_PERIOD",          AUTOMATIC_CONTROL_TASK_PERIOD,          "AutomaticControlTask period [ms]" },
+    { "DEBOUNCING_DELAY_IN_US",                 DEBOUNCING_DELAY_IN_US,                 "Up/Down button debounce delay [us]" },
+    { "DEBOUNCING_DELAY_IN_US_LIMITTER",        DEBOUNCING_DELAY_IN_US_LIMITTER,        "Limit switch debounce delay [us]" },
+    { "DEBOUNCE_MAX_EDGES",                     DEBOUNCE_MAX_EDGES,                     "Bounce edges timed per press [interrupts]" },
+    { "LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US", LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US, "Requirement: limit switch -> motor stop [us]" },
+    { "BUTTON_TO_MOTOR_ON_BOUND_IN_US",         BUTTON_TO_MOTOR_ON_BOUND_IN_US,         "Requirement: button -> motor on [us]" },
+    { "TICK_ISR_CYCLES",                        2000,                                   "Assumed FreeRTOS tick handler cost [cycles] (not instrumented)" },
+    { "CRITICAL_SECTION_IN_US",                 20,                                     "Assumed longest section with the interrupts disabled [us]" },
+};
+
+static double WorstCycles[CYCLES_NUM_OF_ITEMS];
+static uint32_t Counts[CYCLES_NUM_OF_ITEMS];
+
+static double ObservedButtonLatency_us, ObservedLimitLatency_us;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double Param(ParamId_t id)
+{
+    return Params[id].value;
+}
+
+static bool SetParam(const char *assignment)
+{
+    const char *equals = strchr(assignment, '=');
+    if(equals == NULL) return false;
+    for(uint32_t i = 0; i < PARAM_NUM_OF_PARAMS; i++)
+    {
+        if((strlen(Params[i].name) == (size_t)(equals - assignment)) && (strncmp(Params[i].name, assignment, (size_t)(equals - assignment)) == 0))
+        {
+            Params[i].value = atof(equals + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Time from the input change until the motor outputs show the expected state (first matching log entry) */
+static double MotorLatency(uint64_t since_us, bool motorControl1, bool motorControl2)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    for(uint32_t i = 0; i < length; i++)
+    {
+        if((log[i].time_us >= since_us) && (log[i].motorControl1 == motorControl1) && (log[i].motorControl2 == motorControl2))
+        {
+            return (double)(log[i].time_us - since_us);
+        }
+    }
+    return -1.0;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Button presses and limit switch hits at varying phases relative to the task periods */
+static void RunWorkload(void)
+{
+    CycleCounter_Reset();
+
+    for(uint32_t round = 0; round < WORKLOAD_ROUNDS; round++)
+    {
+        /* Shift every round by a prime number of microseconds so the presses sample different task phases */
+        HostSim_RunForUs(7919ULL * round);
+
+        /* Up - motor runs anticlockwise until released */
+        uint64_t press_us = HostSim_NowUs();
+        HostSim_SetInput(BUTTON_UP, true);
+        HostSim_RunForUs(600000);
+        double latency = MotorLatency(press_us, false, true);
+        if(latency > ObservedButtonLatency_us) ObservedButtonLatency_us = latency;
+        HostSim_SetInput(BUTTON_UP, false);
+        HostSim_RunForUs(400000);
+
+        /* Down until the bottom limit switch is hit - the back-off reverses the motor */
+        HostSim_SetInput(BUTTON_DOWN, true);
+        HostSim_RunForUs(400000);
+        press_us = HostSim_NowUs();
+        HostSim_SetInput(BUTTON_BOTTOM_LIMIT, true);
+        HostSim_RunForUs(100000);
+        latency = MotorLatency(press_us, false, true);
+        if(latency > ObservedLimitLatency_us) ObservedLimitLatency_us = latency;
+        HostSim_SetInput(BUTTON_BOTTOM_LIMIT, false);
+        HostSim_RunForUs(300000);
+        HostSim_SetInput(BUTTON_DOWN, false);
+        HostSim_RunForUs(400000);
+    }
+
+    /* At least one AutomaticControlTask job (and the run of SolarWorkerTask before it) */
+    HostSim_RunForUs((uint64_t)AUTOMATIC_CONTROL_TASK_PERIOD * 1000ULL);
+}
+
+/* The latencies are in virtual time - the worst of all runs. The execution times on the host clock - the median of the runs */
+static void MeasureInHostSim(void)
+{
+    static double worst[CYCLES_NUM_OF_ITEMS][MEASUREMENT_RUNS];
+
+    /* Midday in June with the blinds open - AutomaticControlTask runs its calculation but leaves the motor alone */
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    for(uint32_t run = 0; run < MEASUREMENT_RUNS; run++)
+    {
+        RunWorkload();
+        for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+        {
+            worst[i][run] = CycleStats[i].worst;
+            Counts[i] += CycleStats[i].count;
+        }
+    }
+
+    for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+    {
+        qsort(worst[i], MEASUREMENT_RUNS, sizeof(worst[i][0]), CompareDoubles);
+        WorstCycles[i] = worst[i][MEASUREMENT_RUNS / 2U];
+    }
+}
+
+/* Parses the "CYCLES <name> count=.. last=.. avg=.. worst=.." lines of a target log (the worst of all reports is used) */
+static bool ReadMeasurements(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        const char *start = strstr(line, "CYCLES ");
+        char name[64];
+        unsigned long count, last, average, worst;
+        if((start == NULL) || (sscanf(start, "CYCLES %63s count=%lu last=%lu avg=%lu worst=%lu", name, &count, &last, &average, &worst) != 5))
+        {
+            continue;
+        }
+        for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+        {
+            if(strcmp(name, CycleItemNames[i]) == 0)
+            {
+                if((double)worst > WorstCycles[i]) WorstCycles[i] = (double)worst;
+                if(count > Counts[i]) Counts[i] = (uint32_t)count;
+            }
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+/* Interference of all the interrupts (including the tick) on a task within a window */
+static double InterruptInterference(const Entity_t *isrs, uint32_t isrCount, double window_us)
+{
+    double interference = 0.0;
+    for(uint32_t i = 0; i < isrCount; i++)
+    {
+        interference += ceil(window_us / isrs[i].period_us) * isrs[i].wcet_us;
+    }
+    return interference;
+}
+
+static void AnalyseTasks(Entity_t *tasks, uint32_t taskCount, const Entity_t *isrs, uint32_t isrCount, double blocking_us)
+{
+    for(uint32_t i = 0; i < taskCount; i++)
+    {
+        double response = tasks[i].wcet_us + blocking_us;
+        tasks[i].schedulable = false;
+        for(uint32_t iteration = 0; iteration < RTA_MAX_ITERATIONS; iteration++)
+        {
+            double next = tasks[i].wcet_us + blocking_us + InterruptInterference(isrs, isrCount, response);
+            for(uint32_t j = 0; j < taskCount; j++)
+            {
+                /* Equal priority tasks are time sliced - count them as interference as well */
+                if((j != i) && (tasks[j].priority >= tasks[i].priority))
+                {
+                    next += ceil(response / tasks[j].period_us) * tasks[j].wcet_us;
+                }
+            }
+            if(next > tasks[i].period_us)
+            {
+                response = next;
+                break;
+            }
+            if(next == response)
+            {
+                tasks[i].schedulable = true;
+                break;
+            }
+            response = next;
+        }
+        tasks[i].response_us = response;
+    }
+}
+
+static void PrintUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--measurements FILE] [--margin PERCENT] [--set NAME=VALUE]... [--list]\n", program);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    const char *measurementsPath = NULL;
+    double margin_percent = 20.0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--measurements") == 0) && (i + 1 < argc)) measurementsPath = argv[++i];
+        else if((strcmp(argv[i], "--margin") == 0) && (i + 1 < argc)) margin_percent = atof(argv[++i]);
+        else if((strcmp(argv[i], "--set") == 0) && (i + 1 < argc))
+        {
+            if(!SetParam(argv[++i]))
+            {
+                fprintf(stderr, "Unknown parameter in '%s' (see --list)\n", argv[i]);
+                return 2;
+            }
+        }
+        else if(strcmp(argv[i], "--list") == 0)
+        {
+            for(uint32_t p = 0; p < PARAM_NUM_OF_PARAMS; p++)
+            {
+                printf("%-40s %12.0f  %s\n", Params[p].name, Params[p].value, Params[p].description);
+            }
+            return 0;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if(measurementsPath != NULL)
+    {
+        if(!ReadMeasurements(measurementsPath)) return 2;
+        printf("Execution times from %s\n", measurementsPath);
+    }
+    else
+    {
+        MeasureInHostSim();
+        printf("Execution times measured in HostSim (host CPU scaled to clk_sys, median of %u runs - run with --measurements for target numbers)\n",
+               MEASUREMENT_RUNS);
+    }
+
+    for(uint32_t i = 0; i < CYCLES_NUM_OF_ITEMS; i++)
+    {
+        if(Counts[i] == 0U)
+        {
+            printf("warning: no measurement of %s - assumed to take 0 cycles\n", CycleItemNames[i]);
+        }
+    }
+
+    /* Measured worst cases are not proven bounds - add the margin */
+    double scale = (1.0 + (margin_percent / 100.0)) / CYCLE_COUNTER_CLK_SYS_MHZ;
+    double blocking_us = Param(PARAM_CRITICAL_SECTION_IN_US);
+
+    /* Interrupt sources - the GPIO interrupt of each input is masked after its bounce edges until its debounce delay is over */
+    double edgesPerPress = 1.0 + Param(PARAM_DEBOUNCE_MAX_EDGES);
+    Entity_t isrs[] =
+    {
+        { "GPIO (Up/Down)",            0, Param(PARAM_DEBOUNCING_DELAY_IN_US) / (2.0 * edgesPerPress),          WorstCycles[CYCLES_ISR_GPIO] * scale, 0, true },
+        { "GPIO (limit switches)",     0, Param(PARAM_DEBOUNCING_DELAY_IN_US_LIMITTER) / (2.0 * edgesPerPress), WorstCycles[CYCLES_ISR_GPIO] * scale, 0, true },
+        { "TIMER_UPDOWNBUTTONS",       0, Param(PARAM_DEBOUNCING_DELAY_IN_US),                WorstCycles[CYCLES_ISR_TIMER_UPDOWNBUTTONS] * scale, 0, true },
+        { "TIMER_LIMITSWITCHES",       0, Param(PARAM_DEBOUNCING_DELAY_IN_US_LIMITTER),       WorstCycles[CYCLES_ISR_TIMER_LIMITSWITCHES] * scale, 0, true },
+        { "SysTick (FreeRTOS tick)",   0, 1000000.0 / configTICK_RATE_HZ,                     Param(PARAM_TICK_ISR_CYCLES) / CYCLE_COUNTER_CLK_SYS_MHZ, 0, true },
+    };
+    const uint32_t isrCount = sizeof(isrs) / sizeof(isrs[0]);
+    const uint32_t ourIsrCount = isrCount - 1U; /* all but the tick share the NVIC priority */
+
+    /* Same NVIC priority - a pending interrupt waits for at most one run of each of the others (plus a critical section) */
+    double isrOthers = 0.0;
+    for(uint32_t i = 0; i < ourIsrCount; i++) isrOthers += isrs[i].wcet_us;
+    for(uint32_t i = 0; i < ourIsrCount; i++)
+    {
+        isrs[i].response_us = blocking_us + isrOthers;
+        isrs[i].schedulable = (isrs[i].response_us <= isrs[i].period_us);
+    }
+    isrs[ourIsrCount].response_us = isrs[ourIsrCount].wcet_us + isrOthers + blocking_us;
+    isrs[ourIsrCount].schedulable = (isrs[ourIsrCount].response_us <= isrs[ourIsrCount].period_us);
+
+    Entity_t tasks[] =
+    {
+        { "ButtonTask",           Param(PARAM_BUTTON_TASK_PRIORITY),            Param(PARAM_BUTTON_TASK_PERIOD) * 1000.0,            WorstCycles[CYCLES_TASK_BUTTON] * scale, 0, false },
+        { "MotorControllerTask",  Param(PARAM_MOTOR_CONTROLLER_TASK_PRIORITY),  Param(PARAM_MOTOR_CONTROLLER_TASK_PERIOD) * 1000.0,  WorstCycles[CYCLES_TASK_MOTOR_CONTROLLER] * scale, 0, false },
+        { "AutomaticControlTask", Param(PARAM_AUTOMATIC_CONTROL_TASK_PRIORITY), Param(PARAM_AUTOMATIC_CONTROL_TASK_PERIOD) * 1000.0, WorstCycles[CYCLES_TASK_AUTOMATIC_CONTROL] * scale, 0, false },
+        { "SolarWorkerTask",      Param(PARAM_SOLAR_WORKER_TASK_PRIORITY),      Param(PARAM_AUTOMATIC_CONTROL_TASK_PERIOD) * 1000.0, WorstCycles[CYCLES_TASK_SOLAR_WORKER] * scale, 0, false },
+    };
+    const uint32_t taskCount = sizeof(tasks) / sizeof(tasks[0]);
+    AnalyseTasks(tasks, taskCount, isrs, isrCount, blocking_us);
+
+    bool ok = true;
+    printf("\nWCET margin %.0f%%, blocking (interrupts disabled) %.1f us, clk_sys %u MHz\n\n", margin_percent, blocking_us, CYCLE_COUNTER_CLK_SYS_MHZ);
+    printf("%-24s %5s %12s %12s %12s  %s\n", "interrupt/task", "prio", "T/MIT [us]", "C [us]", "R [us]", "");
+    for(uint32_t i = 0; i < isrCount; i++)
+    {
+        printf("%-24s %5s %12.0f %12.2f %12.2f  %s\n", isrs[i].name, "irq", isrs[i].period_us, isrs[i].wcet_us, isrs[i].response_us,
+               isrs[i].schedulable ? "ok" : "MISSES DEADLINE");
+        ok = ok && isrs[i].schedulable;
+    }
+    for(uint32_t i = 0; i < taskCount; i++)
+    {
+        printf("%-24s %5.0f %12.0f %12.2f %12.2f  %s\n", tasks[i].name, tasks[i].priority, tasks[i].period_us, tasks[i].wcet_us, tasks[i].response_us,
+               tasks[i].schedulable ? "ok" : "MISSES DEADLINE");
+        ok = ok && tasks[i].schedulable;
+    }
+
+    /* End-to-end chains */
+    const Entity_t *gpioIsr = &isrs[0];
+    const Entity_t *alarm0Isr = &isrs[2];
+    const Entity_t *alarm1Isr = &isrs[3];
+    const Entity_t *buttonTask = &tasks[0];
+    const Entity_t *motorTask = &tasks[1];
+
+    double limitToStop_us = gpioIsr->response_us + Param(PARAM_DEBOUNCING_DELAY_IN_US_LIMITTER) + alarm1Isr->response_us;
+    double buttonToOn_us = gpioIsr->response_us + Param(PARAM_DEBOUNCING_DELAY_IN_US) + alarm0Isr->response_us
+                         + buttonTask->period_us + buttonTask->response_us
+                         + motorTask->period_us + motorTask->response_us;
+    bool limitOk = limitToStop_us <= Param(PARAM_LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US);
+    bool buttonOk = buttonToOn_us <= Param(PARAM_BUTTON_TO_MOTOR_ON_BOUND_IN_US);
+
+    printf("\n%-32s %14s %14s %14s  %s\n", "end-to-end", "worst [us]", "bound [us]", "observed [us]", "");
+    printf("%-32s %14.0f %14.0f %14.0f  %s\n", "limit switch -> motor stop", limitToStop_us, Param(PARAM_LIMIT_SWITCH_TO_MOTOR_STOP_BOUND_IN_US),
+           ObservedLimitLatency_us, limitOk ? "ok" : "BOUND BROKEN");
+    printf("    GPIO IRQ %.1f + debounce %.0f + alarm IRQ %.1f\n", gpioIsr->response_us, Param(PARAM_DEBOUNCING_DELAY_IN_US_LIMITTER), alarm1Isr->response_us);
+    printf("%-32s %14.0f %14.0f %14.0f  %s\n", "button press -> motor on", buttonToOn_us, Param(PARAM_BUTTON_TO_MOTOR_ON_BOUND_IN_US),
+           ObservedButtonLatency_us, buttonOk ? "ok" : "BOUND BROKEN");
+    printf("    GPIO IRQ %.1f + debounce %.0f + alarm IRQ %.1f + ButtonTask %.0f+%.1f + MotorControllerTask %.0f+%.1f\n",
+           gpioIsr->response_us, Param(PARAM_DEBOUNCING_DELAY_IN_US), alarm0Isr->response_us,
+           buttonTask->period_us, buttonTask->response_us, motorTask->period_us, motorTask->response_us);
+    if(measurementsPath != NULL)
+    {
+        printf("    (observed latencies are only available when measuring in HostSim)\n");
+    }
+
+    ok = ok && limitOk && buttonOk;
+    printf("\n%s\n", ok ? "All deadlines and bounds met" : "DEADLINE OR BOUND BROKEN");
+    return ok ? 0 : 1;
+}
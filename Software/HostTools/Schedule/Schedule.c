@@ -0,0 +1,292 @@
+/* Schedule.c - the compiled schedule of AutomaticControlTask (Schedule.c of the firmware) against a direct evaluation.
+
+   Built once per rule set: Schedule (the default - closed between sunset and sunrise) and Schedule_Rules (firmware built
+   with SCHEDULE_RULES_ENABLED). The rules are compiled for a common and a leap year, and for every minute of the year and
+   every light level the state of the table lookup is compared with a chain of conditions evaluated for that minute alone -
+   for the default rule set the comparison of the RTC time with the sunrise/sunset that AutomaticControlTask did before.
+
+   Reported: compile time, table size, cost of one evaluation (the old per-run calculation, the lookup with the cached
+   transition and a lookup at random times), the compiled times of some days, and the mismatches.
+
+   Usage: Schedule
+   Exits with 1 if the table gives a different state than the direct evaluation at any minute. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "Schedule.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define TIMING_EVALUATIONS      (200000U)
+#define MAX_DAYS                (366U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    uint32_t month, day;
+    const char *note;
+}SampleDay_t;
+
+/* Direct evaluation of one day */
+typedef struct
+{
+    double sunrise, sunset;         /* hours, DST corrected */
+    int32_t open, close;            /* minutes of the day */
+    uint8_t dayBit;
+}ReferenceDay_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const uint32_t Years[] = { 2026, 2028 };
+
+static const SampleDay_t SampleDays[] =
+{
+    { 1, 5,   "winter Monday" },
+    { 1, 6,   "holiday (Tuesday)" },
+    { 3, 29,  "DST starts (Sunday)" },
+    { 4, 6,   "Easter Monday in 2026" },
+    { 6, 22,  "summer Monday" },
+    { 6, 27,  "summer Saturday" },
+    { 10, 25, "DST ends (Sunday)" },
+    { 12, 21, "winter solstice" },
+};
+
+static ReferenceDay_t ReferenceDays[MAX_DAYS];
+static volatile bool Sink;     /* keeps the timed evaluations */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static uint32_t DaysInMonth(uint32_t year, uint32_t month)
+{
+    static const uint32_t days[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return ((month == 2U) && isLeapYear(year)) ? 29U : days[month];
+}
+
+static uint32_t DayOfYear(uint32_t year, uint32_t month, uint32_t day)
+{
+    return CalculateDayOfYear(ConvertBCD((uint8_t)(year - 2000U), DEC_TO_BCD), ConvertBCD((uint8_t)month, DEC_TO_BCD), ConvertBCD((uint8_t)day, DEC_TO_BCD));
+}
+
+/* The old AutomaticControlTask calculation - sunrise/sunset in hours with the DST correction */
+static void LegacySunriseSunset(uint32_t year, uint32_t month, uint32_t day, double *sunrise, double *sunset)
+{
+    uint8_t yearBCD = ConvertBCD((uint8_t)(year - 2000U), DEC_TO_BCD);
+    uint8_t monthBCD = ConvertBCD((uint8_t)month, DEC_TO_BCD);
+    uint8_t dayBCD = ConvertBCD((uint8_t)day, DEC_TO_BCD);
+    CalculateSunriseSunset(LATITUDE_SIEROSZEWICE_NOWA_10, LONGITUDE_SIEROSZEWICE_NOWA_10, (int)CalculateDayOfYear(yearBCD, monthBCD, dayBCD), TIME_ZONE_PLUS_TO_E, sunrise, sunset);
+    if(isDST(yearBCD, monthBCD, dayBCD) == false)
+    {
+        *sunrise -= 1.0;
+        *sunset -= 1.0;
+    }
+}
+
+static uint32_t EasterDayOfYear(uint32_t year)
+{
+    /* Gauss, with the Gregorian corrections - independent of the firmware calculation */
+    uint32_t a = year % 19U, b = year % 4U, c = year % 7U;
+    uint32_t k = year / 100U, p = (13U + (8U * k)) / 25U, q = k / 4U;
+    uint32_t M = (15U - p + k - q) % 30U, N = (4U + k - q) % 7U;
+    uint32_t d = ((19U * a) + M) % 30U, e = ((2U * b) + (4U * c) + (6U * d) + N) % 7U;
+    uint32_t marchDay = 22U + d + e;
+    if((d == 29U) && (e == 6U)) marchDay -= 7U;
+    else if((d == 28U) && (e == 6U) && (((11U * M) + 11U) % 30U < 19U)) marchDay -= 7U;
+    return DayOfYear(year, 3, 1) - 1U + marchDay;
+}
+
+/* First minute of the day at or after the time in hours - when the comparison of the RTC time with it becomes true */
+static int32_t FirstMinuteAtOrAfter(double hours)
+{
+    int32_t minute = 0;
+    while((minute <= SCHEDULE_MINUTES_PER_DAY) && (((minute / 60) + ((minute % 60) / 60.0)) < hours)) minute++;
+    return minute;
+}
+
+static int32_t ReferenceTime(const ScheduleTime_t *time, int32_t sunrise, int32_t sunset, int32_t fallback)
+{
+    int32_t minute;
+    switch(time->ref)
+    {
+        case SCHEDULE_REF_CLOCK:   minute = time->offset; break;
+        case SCHEDULE_REF_SUNRISE: minute = sunrise + time->offset; break;
+        case SCHEDULE_REF_SUNSET:  minute = sunset + time->offset; break;
+        default:                   return fallback;
+    }
+    if(time->bound == SCHEDULE_BOUND_NOT_BEFORE) minute = (minute > time->boundMinute) ? minute : time->boundMinute;
+    if(time->bound == SCHEDULE_BOUND_NOT_AFTER) minute = (minute < time->boundMinute) ? minute : time->boundMinute;
+    return (minute < 0) ? 0 : ((minute > SCHEDULE_MINUTES_PER_DAY) ? SCHEDULE_MINUTES_PER_DAY : minute);
+}
+
+static void ReferenceDay(uint32_t year, uint32_t month, uint32_t day, ReferenceDay_t *reference)
+{
+    LegacySunriseSunset(year, month, day, &reference->sunrise, &reference->sunset);
+    int32_t sunrise = FirstMinuteAtOrAfter(reference->sunrise);
+    int32_t sunset = FirstMinuteAtOrAfter(reference->sunset);
+
+    uint32_t dayOfYear = DayOfYear(year, month, day);
+    bool holiday = false;
+    for(uint32_t h = 0; h < ScheduleConfig.numOfHolidays; h++)
+    {
+        const ScheduleHoliday_t *entry = &ScheduleConfig.holidays[h];
+        if(entry->month == SCHEDULE_EASTER) holiday |= ((int32_t)dayOfYear == ((int32_t)EasterDayOfYear(year) + entry->day));
+        else holiday |= ((entry->month == month) && ((uint32_t)entry->day == day));
+    }
+    reference->dayBit = holiday ? SCHEDULE_DAY_HOLIDAY : (uint8_t)(1U << ZellersCongruence((int)year, (int)month, (int)day));
+
+    const ScheduleTime_t *open = NULL, *close = NULL;
+    uint16_t date = SCHEDULE_MMDD(month, day);
+    for(uint32_t r = 0; r < ScheduleConfig.numOfRules; r++)
+    {
+        const ScheduleRule_t *rule = &ScheduleConfig.rules[r];
+        bool inRange = ((rule->from == 0U) && (rule->to == 0U))
+                       || ((rule->from <= rule->to) ? ((date >= rule->from) && (date <= rule->to)) : ((date >= rule->from) || (date <= rule->to)));
+        if(((rule->days & reference->dayBit) == 0U) || !inRange) continue;
+        if((open == NULL) && (rule->open.ref != SCHEDULE_REF_NONE)) open = &rule->open;
+        if((close == NULL) && (rule->close.ref != SCHEDULE_REF_NONE)) close = &rule->close;
+    }
+    reference->open = (open != NULL) ? ReferenceTime(open, sunrise, sunset, sunrise) : sunrise;
+    reference->close = (close != NULL) ? ReferenceTime(close, sunrise, sunset, sunset) : sunset;
+}
+
+/* Chain of conditions for one minute - the open period of the day and of its neighbours moved by the light level */
+static bool ReferenceIsOpen(uint32_t numOfDays, int32_t minuteOfYear, int32_t narrow_min)
+{
+    int32_t day = minuteOfYear / SCHEDULE_MINUTES_PER_DAY;
+    for(int32_t d = day - 1; d <= day + 1; d++)
+    {
+        if((d < 0) || (d >= (int32_t)numOfDays)) continue;
+        const ReferenceDay_t *reference = &ReferenceDays[d];
+        if(reference->open >= reference->close) continue;
+        int32_t dayStart = d * SCHEDULE_MINUTES_PER_DAY;
+        if(((minuteOfYear - dayStart) >= (reference->open + narrow_min)) && ((minuteOfYear - dayStart) < (reference->close - narrow_min))) return true;
+    }
+    return false;
+}
+
+/* Old AutomaticControlTask decision for one run (time in hours of the RTC) */
+static void LegacyEvaluation(uint32_t year, uint32_t month, uint32_t day, double time)
+{
+    double sunrise, sunset;
+    LegacySunriseSunset(year, month, day, &sunrise, &sunset);
+    Sink = (time >= sunrise) && (time < sunset);
+}
+
+static void PrintMinute(int32_t minute)
+{
+    printf("  %02d:%02d", (int)(minute / 60), (int)(minute % 60));
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static const int32_t narrowings[] = { 0, SCHEDULE_LIGHT_SHIFT_IN_MINUTES, -SCHEDULE_LIGHT_SHIFT_IN_MINUTES };
+    uint32_t failures = 0;
+
+    printf("rule set: %s (%u rules, %u holidays)\n", (SCHEDULE_RULES_ENABLED == 1) ? "SCHEDULE_RULES_ENABLED" : "default",
+           (unsigned)ScheduleConfig.numOfRules, (unsigned)ScheduleConfig.numOfHolidays);
+
+    for(uint32_t y = 0; y < sizeof(Years) / sizeof(Years[0]); y++)
+    {
+        uint32_t year = Years[y];
+
+        double start = NowNs();
+        Schedule_Compile(&ScheduleConfig, year);
+        double compile_us = (NowNs() - start) / 1000.0;
+        const uint32_t *transitions;
+        uint32_t length = Schedule_Transitions(&transitions);
+
+        uint32_t numOfDays = 0;
+        for(uint32_t month = 1; month <= 12U; month++)
+        {
+            for(uint32_t day = 1; day <= DaysInMonth(year, month); day++)
+            {
+                ReferenceDay(year, month, day, &ReferenceDays[numOfDays++]);
+            }
+        }
+
+        /* Every minute of the year, in time order like the task runs (mostly the cached transition) */
+        uint32_t mismatches = 0;
+        int32_t firstMismatch = -1;
+        for(uint32_t n = 0; n < sizeof(narrowings) / sizeof(narrowings[0]); n++)
+        {
+            for(int32_t minute = 0; minute < (int32_t)(numOfDays * SCHEDULE_MINUTES_PER_DAY); minute++)
+            {
+                if(Schedule_IsOpen(minute, narrowings[n]) != ReferenceIsOpen(numOfDays, minute, narrowings[n]))
+                {
+                    if(firstMismatch < 0) firstMismatch = minute;
+                    mismatches++;
+                }
+            }
+        }
+
+        /* Cost of one decision - sequential minutes (cached), random minutes (binary search) and the old calculation */
+        start = NowNs();
+        for(uint32_t i = 0; i < TIMING_EVALUATIONS; i++) Sink = Schedule_IsOpen((int32_t)i, 0);
+        double cached_ns = (NowNs() - start) / TIMING_EVALUATIONS;
+        srand(year);
+        start = NowNs();
+        for(uint32_t i = 0; i < TIMING_EVALUATIONS; i++) Sink = Schedule_IsOpen(rand() % (int32_t)(numOfDays * SCHEDULE_MINUTES_PER_DAY), 0);
+        double search_ns = (NowNs() - start) / TIMING_EVALUATIONS;
+        start = NowNs();
+        for(uint32_t i = 0; i < TIMING_EVALUATIONS; i++) LegacyEvaluation(year, 1U + (i % 12U), 1U + (i % 28U), (i % 1440U) / 60.0);
+        double legacy_ns = (NowNs() - start) / TIMING_EVALUATIONS;
+
+        printf("\n%u: %u days, %u transitions (%u bytes), compiled in %.0fus\n", (unsigned)year, (unsigned)numOfDays, (unsigned)length,
+               (unsigned)(length * sizeof(uint32_t)), compile_us);
+        printf("evaluation: old calculation %.0fns, cached %.1fns, binary search %.1fns\n", legacy_ns, cached_ns, search_ns);
+
+        printf("%-6s %-20s %7s %7s %7s %7s\n", "date", "day", "sunrise", "sunset", "open", "close");
+        for(uint32_t s = 0; s < sizeof(SampleDays) / sizeof(SampleDays[0]); s++)
+        {
+            const SampleDay_t *sample = &SampleDays[s];
+            const ReferenceDay_t *reference = &ReferenceDays[DayOfYear(year, sample->month, sample->day) - 1U];
+            int32_t open, close;
+            printf("%02u-%02u  %-20s", (unsigned)sample->month, (unsigned)sample->day, sample->note);
+            PrintMinute(FirstMinuteAtOrAfter(reference->sunrise));
+            PrintMinute(FirstMinuteAtOrAfter(reference->sunset));
+            if(Schedule_Day(DayOfYear(year, sample->month, sample->day), &open, &close))
+            {
+                PrintMinute(open);
+                PrintMinute(close);
+            }
+            else
+            {
+                printf("  closed");
+            }
+            printf("\n");
+        }
+
+        if(mismatches > 0U)
+        {
+            printf("MISMATCH: %u minutes, first at day %d %02d:%02d\n", (unsigned)mismatches, (int)(firstMismatch / SCHEDULE_MINUTES_PER_DAY) + 1,
+                   (int)((firstMismatch % SCHEDULE_MINUTES_PER_DAY) / 60), (int)(firstMismatch % 60));
+            failures++;
+        }
+        else
+        {
+            printf("every minute and light level: same state as the direct evaluation\n");
+        }
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
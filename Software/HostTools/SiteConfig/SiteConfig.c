@@ -0,0 +1,435 @@
+/* SiteConfig.c - the site configuration block in the flash (SiteConfig.c of the firmware): read in place through the XIP
+   window at the boot, written over the USB link like UpdateSender --config-set does.
+
+   Every boot is a fresh firmware image in its own process, the flash model is shared by all of them:
+     defaults - the config sector erased: the board runs on the build defaults and sends them back, blocks with a pin taken
+                twice, a bad CRC, a period over the watchdog deadline or a latitude past the polar circle are refused with the
+                field in error (the sector stays erased), then the block of another site is written and the board reboots
+     site     - Helsinki (other location and time zone), a shorter period of AutomaticControlTask, a shorter debounce delay
+                and channel 0 moved to the pins of channel 1: the board runs on the block in the flash (SiteConfig points into
+                the flash model - no copy), the old Up button does nothing, the new one moves the motor on the new pins, the
+                evening close follows the sunset of Helsinki to the period
+     corrupt  - one bit of the block flipped in the flash: the CRC does not match, the board is back on the build defaults
+                (the sunset of the home site is long past - the close comes right after the boot, on the default pins)
+
+   Usage: SiteConfig
+   Exits with 1 if a check fails: the defaults are not what the board uses without a block, a bad block is written or used,
+   the block written is not used after the reboot, a move goes to the pins of the other configuration or the close is not
+   within a period after the sunset of the configured site. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "BootControl.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+#include "Hash.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (6000000ULL)
+#define REBOOT_WAIT_US          (1000000ULL)    /* the ACK goes out, then the board reboots */
+#define PRESS_US                (400000U)
+#define GAP_US                  (2000000U)
+#define CLOSE_SLACK_S           (2.0)           /* the polling of MotorControllerTask and the start stagger */
+#define DEFAULT_CLOSE_US        (10000000ULL)   /* the first run of AutomaticControlTask comes with the boot */
+#define NUM_OF_REJECTS          (4U)
+
+/* The other site - Helsinki, channel 0 on the pins of channel 1 (unused with one channel) */
+#define SITE_LATITUDE           (60.1699)
+#define SITE_LONGITUDE          (24.9384)
+#define SITE_TIME_ZONE          (3)
+#define SITE_PERIOD_MS          (10000U)
+#define SITE_DEBOUNCE_US        (40000U)
+#define SITE_UP_GPIO            CH1_BUTTON_UP
+#define SITE_MOTOR_1_GPIO       CH1_MOTOR_CONTROL_1
+#define SITE_MOTOR_2_GPIO       CH1_MOTOR_CONTROL_2
+
+#define DEFAULT_PINS            ((1u << MOTOR_CONTROL_1) | (1u << MOTOR_CONTROL_2))
+#define SITE_PINS               ((1u << SITE_MOTOR_1_GPIO) | (1u << SITE_MOTOR_2_GPIO))
+
+/* An evening in June - the home site after its sunset, Helsinki before */
+#define EVENING_YEAR            (2026U)
+#define EVENING_MONTH           (6U)
+#define EVENING_DAY             (15U)
+#define EVENING_DAY_OF_YEAR     (166)
+#define EVENING_HOUR            (21U)
+#define EVENING_MINUTE          (30U)
+#define NIGHT_HOUR              (23U)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    BOOT_DEFAULTS,
+    BOOT_SITE,
+    BOOT_CORRUPT,
+    NUM_OF_BOOTS
+}Boot_t;
+
+typedef struct
+{
+    bool reset;                             /* the boot ended with the reboot of CONFIG_WRITE */
+    HostSim_PersistentState_t state;
+    bool info;
+    char source[16], flashState[16];        /* #CONFIG */
+    bool inPlace;                           /* SiteConfig points into the flash model */
+
+    /* defaults */
+    bool defaultsRead;                      /* CONFIG_READ gave the build defaults */
+    char rejected[NUM_OF_REJECTS][32];      /* reason of the #ERR, "ACK" if it was written */
+    bool stillErased;
+    bool written;
+    uint32_t erases, programs;
+
+    /* site and corrupt */
+    uint32_t settle_us;                     /* the settle window of channel 0 Up - the fixed delay before any learning */
+    uint32_t oldButtonStarts;
+    uint32_t newButtonStarts, newButtonOutputs;
+    double close_s;                         /* second of the day of the first automatic start (corrupt - after the boot), -1 - none */
+    uint32_t closeOutputs;
+}Result_t;
+
+/* What the process of a boot gets */
+typedef struct
+{
+    Boot_t boot;
+    const HostSim_PersistentState_t *state;     /* NULL on the first boot */
+}BootRun_t;
+
+/* A bad block - one field of the defaults changed, the field the board names in its #ERR */
+typedef struct
+{
+    const char *name;
+    const char *expected;
+}Reject_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Reject_t Rejects[NUM_OF_REJECTS] =
+{
+    { "up on a motor pin", "gpio" },
+    { "bad CRC",           "crc" },
+    { "period 60s",        "period" },
+    { "latitude 70",       "latitude" },
+};
+
+static Result_t Result;
+static uint64_t EveningStart_us;             /* virtual time of EVENING_HOUR:EVENING_MINUTE */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* ---- USB link ---- */
+
+static void SimWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    HostSim_UsbWrite(data, length);
+}
+
+static bool SimReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    (void)context;
+    return HostSim_UsbReadLine(line, size, timeout_ms * 1000ULL);
+}
+
+static void SimSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    HostSim_RunForUs(ms * 1000ULL);
+}
+
+/* ---- Blocks ---- */
+
+static void Seal(SiteConfig_t *config)
+{
+    config->crc = Hash_Crc32(config, offsetof(SiteConfig_t, crc));
+}
+
+static void MakeReject(uint32_t reject, SiteConfig_t *config)
+{
+    *config = SiteConfigDefault;
+    switch(reject)
+    {
+        case 0U: config->channels.inputGpio[CHANNEL_INPUT_UP][0] = MOTOR_CONTROL_1; break;
+        case 1U: break;
+        case 2U: config->automaticControlPeriod_ms = 60000U; break;
+        default: config->latitude = 70.0; break;
+    }
+    Seal(config);
+    if(reject == 1U) config->crc ^= 1U;
+}
+
+static void MakeSite(SiteConfig_t *config)
+{
+    *config = SiteConfigDefault;
+    config->latitude = SITE_LATITUDE;
+    config->longitude = SITE_LONGITUDE;
+    config->timeZone = SITE_TIME_ZONE;
+    config->automaticControlPeriod_ms = SITE_PERIOD_MS;
+    config->debounceButton_us = SITE_DEBOUNCE_US;
+    config->channels.inputGpio[CHANNEL_INPUT_UP][0] = SITE_UP_GPIO;
+    config->channels.motorControl1Gpio[0] = SITE_MOTOR_1_GPIO;
+    config->channels.motorControl2Gpio[0] = SITE_MOTOR_2_GPIO;
+    Seal(config);
+}
+
+/* ---- Motor log ---- */
+
+/* Starts (all the logged outputs off -> any on) from the log entry on, with the outputs they drove */
+static uint32_t Starts(uint32_t logStart, uint32_t *outputs, uint64_t *firstStart_us)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+    uint32_t starts = 0, previous = 0;
+
+    *outputs = 0;
+    if(firstStart_us != NULL) *firstStart_us = 0;
+    for(uint32_t i = logStart; i < length; i++)
+    {
+        if((log[i].outputs != 0U) && (previous == 0U))
+        {
+            if((starts == 0U) && (firstStart_us != NULL)) *firstStart_us = log[i].time_us;
+            starts++;
+        }
+        *outputs |= log[i].outputs;
+        previous = log[i].outputs;
+    }
+    return starts;
+}
+
+static uint32_t Press(uint32_t gpio, uint32_t *outputs)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t logStart = HostSim_GetMotorLog(&log);
+
+    HostSim_SetInput(gpio, true);
+    HostSim_RunForUs(PRESS_US);
+    HostSim_SetInput(gpio, false);
+    HostSim_RunForUs(GAP_US);
+    return Starts(logStart, outputs, NULL);
+}
+
+static double SecondOfDay(uint64_t time_us)
+{
+    return (EVENING_HOUR * 3600.0) + (EVENING_MINUTE * 60.0) + ((double)(time_us - EveningStart_us) / 1e6);
+}
+
+/* ---- Boots ---- */
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    const HostSim_FlashStats_t *flash = HostSim_GetFlashStats();
+
+    Result.reset = true;
+    Result.state = *state;
+    Result.erases = flash->erases;
+    Result.programs = flash->programs;
+    HostSim_IsolatedResult(&Result);
+}
+
+static void RunDefaults(const UpdateTransport_t *transport)
+{
+    SiteConfig_t config, read;
+
+    Result.defaultsRead = (UpdateProtocol_ConfigRead(transport, (uint8_t *)&read, sizeof(read)) == sizeof(read)) &&
+                          (memcmp(&read, &SiteConfigDefault, offsetof(SiteConfig_t, crc)) == 0);
+
+    for(uint32_t reject = 0; reject < NUM_OF_REJECTS; reject++)
+    {
+        MakeReject(reject, &config);
+        if(UpdateProtocol_ConfigWrite(transport, (const uint8_t *)&config, sizeof(config), Result.rejected[reject], sizeof(Result.rejected[reject])))
+        {
+            snprintf(Result.rejected[reject], sizeof(Result.rejected[reject]), "ACK");
+        }
+    }
+    const uint8_t *sector = HostSim_Flash() + BOOT_CONFIG_OFFSET;
+    Result.stillErased = true;
+    for(uint32_t i = 0; i < FLASH_SECTOR_SIZE; i++)
+    {
+        if(sector[i] != 0xFFU) Result.stillErased = false;
+    }
+
+    char reason[32];
+    MakeSite(&config);
+    Result.written = UpdateProtocol_ConfigWrite(transport, (const uint8_t *)&config, sizeof(config), reason, sizeof(reason));
+    HostSim_RunForUs(REBOOT_WAIT_US);
+}
+
+static void RunSite(const UpdateTransport_t *transport)
+{
+    UpdateDebounceStats_t items[CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS];
+    uint32_t outputs;
+
+    if(UpdateProtocol_DebounceInfo(transport, items, CHANNEL_NUM_OF_INPUTS * BLINDS_MAX_NUM_OF_CHANNELS) > CHANNEL_INPUT_UP)
+    {
+        Result.settle_us = items[CHANNEL_INPUT_UP].settle_us;
+    }
+    Result.oldButtonStarts = Press(BUTTON_UP, &outputs);
+    Result.newButtonStarts = Press(SITE_UP_GPIO, &Result.newButtonOutputs);
+
+    /* The evening close - the first start from here on */
+    const HostSim_MotorEvent_t *log;
+    uint32_t logStart = HostSim_GetMotorLog(&log);
+    uint64_t start_us;
+    HostSim_RunUntilUs(EveningStart_us + (uint64_t)(NIGHT_HOUR - EVENING_HOUR) * 3600000000ULL - (uint64_t)EVENING_MINUTE * 60000000ULL);
+    Result.close_s = (Starts(logStart, &Result.closeOutputs, &start_us) > 0U) ? SecondOfDay(start_us) : -1.0;
+}
+
+/* The first run of AutomaticControlTask comes with the boot - the whole log of this boot */
+static void RunCorrupt(void)
+{
+    uint64_t start_us;
+
+    HostSim_RunUntilUs(EveningStart_us + DEFAULT_CLOSE_US);
+    Result.close_s = (Starts(0U, &Result.closeOutputs, &start_us) > 0U) ? ((double)(start_us - EveningStart_us) / 1e6) : -1.0;
+}
+
+static void Run(Boot_t boot, const HostSim_PersistentState_t *state)
+{
+    UpdateTransport_t transport = { NULL, SimWrite, SimReadLine, SimSleep };
+
+    if(state != NULL) HostSim_RestoreState(state);
+    HostSim_SetRebootHook(RebootHook);
+    HostSim_SetMotorLogMask(DEFAULT_PINS | SITE_PINS);
+
+    /* The evening - open blinds, the schedule decides when they close */
+    HostSim_RtcSetTime(EVENING_YEAR, EVENING_MONTH, EVENING_DAY, EVENING_HOUR, EVENING_MINUTE, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    EveningStart_us = HostSim_NowUs();
+    if(boot == BOOT_DEFAULTS)
+    {
+        /* Midday instead - nothing moves while the blocks are written */
+        HostSim_RtcSetTime(EVENING_YEAR, EVENING_MONTH, EVENING_DAY, 12, 0, 0);
+    }
+    HostSim_Boot();
+    if(boot == BOOT_CORRUPT)
+    {
+        RunCorrupt();
+    }
+    else
+    {
+        HostSim_RunForUs(BOOT_SETTLE_US);
+    }
+
+    Result.inPlace = (SiteConfig == (const SiteConfig_t *)(HostSim_Flash() + BOOT_CONFIG_OFFSET));
+    Result.info = UpdateProtocol_ConfigInfo(&transport, Result.source, sizeof(Result.source), Result.flashState, sizeof(Result.flashState));
+    if(boot == BOOT_DEFAULTS) RunDefaults(&transport);
+    else if(boot == BOOT_SITE) RunSite(&transport);
+    HostSim_SaveState(&Result.state);
+}
+
+/* The process of a boot - the result in Result, sent at the end or by the reboot hook */
+static void RunBootProcess(const void *context, void *output)
+{
+    const BootRun_t *run = context;
+
+    (void)output;
+    memset(&Result, 0, sizeof(Result));
+    Result.close_s = -1.0;
+    Run(run->boot, run->state);
+    HostSim_IsolatedResult(&Result);
+}
+
+static bool RunBoot(Boot_t boot, const HostSim_PersistentState_t *state, Result_t *result)
+{
+    BootRun_t run = { boot, state };
+    return HostSim_RunIsolated(RunBootProcess, &run, result, sizeof(*result));
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-46s %-30s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_BOOTS];
+    char value[64];
+    uint32_t failures = 0;
+
+    /* The flash model before the first fork - all the boots share it, the config sector erased */
+    memset(HostSim_Flash() + BOOT_CONFIG_OFFSET, 0xFF, FLASH_SECTOR_SIZE);
+
+    if(!RunBoot(BOOT_DEFAULTS, NULL, &results[BOOT_DEFAULTS]) || !results[BOOT_DEFAULTS].reset ||
+       !RunBoot(BOOT_SITE, &results[BOOT_DEFAULTS].state, &results[BOOT_SITE]))
+    {
+        printf("simulation crashed\n");
+        return 1;
+    }
+    /* One bit of the latitude flipped - the CRC no longer matches */
+    HostSim_Flash()[BOOT_CONFIG_OFFSET + offsetof(SiteConfig_t, latitude)] ^= 0x01U;
+    if(!RunBoot(BOOT_CORRUPT, &results[BOOT_SITE].state, &results[BOOT_CORRUPT]))
+    {
+        printf("simulation crashed\n");
+        return 1;
+    }
+
+    const Result_t *defaults = &results[BOOT_DEFAULTS], *site = &results[BOOT_SITE], *corrupt = &results[BOOT_CORRUPT];
+    printf("site configuration block: %u bytes at flash offset 0x%06X\n\n", (unsigned)sizeof(SiteConfig_t), (unsigned)BOOT_CONFIG_OFFSET);
+    printf("%-46s %-30s %s\n", "check", "value", "result");
+
+    /* Erased sector */
+    snprintf(value, sizeof(value), "%s, flash block %s", defaults->source, defaults->flashState);
+    failures += !Check("erased: #CONFIG", value, defaults->info && (strcmp(defaults->source, "default") == 0) && (strcmp(defaults->flashState, "erased") == 0));
+    failures += !Check("erased: CONFIG_READ = build defaults", defaults->defaultsRead ? "yes" : "no", defaults->defaultsRead);
+    for(uint32_t reject = 0; reject < NUM_OF_REJECTS; reject++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "refused: %s", Rejects[reject].name);
+        snprintf(value, sizeof(value), "#ERR %s", defaults->rejected[reject]);
+        failures += !Check(name, value, strcmp(defaults->rejected[reject], Rejects[reject].expected) == 0);
+    }
+    failures += !Check("refused blocks: sector still erased", defaults->stillErased ? "yes" : "no", defaults->stillErased);
+    snprintf(value, sizeof(value), "ACK, %u erase, %u program", (unsigned)defaults->erases, (unsigned)defaults->programs);
+    failures += !Check("site block written, reboot", defaults->written ? value : "no ACK", defaults->written && defaults->reset);
+
+    /* The block of the site */
+    double sunrise, sunset;
+    CalculateSunriseSunset(SITE_LATITUDE, SITE_LONGITUDE, EVENING_DAY_OF_YEAR, SITE_TIME_ZONE, &sunrise, &sunset);
+    double sunset_s = ceil(sunset * 60.0) * 60.0;
+    snprintf(value, sizeof(value), "%s, flash block %s", site->source, site->flashState);
+    failures += !Check("site: #CONFIG", value, site->info && (strcmp(site->source, "flash") == 0) && (strcmp(site->flashState, "ok") == 0));
+    failures += !Check("site: SiteConfig read in place (XIP)", site->inPlace ? "yes" : "no", site->inPlace);
+    snprintf(value, sizeof(value), "%.1f ms", site->settle_us / 1000.0);
+    failures += !Check("site: debounce delay of channel 0 Up", value, site->settle_us == SITE_DEBOUNCE_US);
+    snprintf(value, sizeof(value), "%u starts", (unsigned)site->oldButtonStarts);
+    failures += !Check("site: default Up button (GPIO 14)", value, site->oldButtonStarts == 0U);
+    snprintf(value, sizeof(value), "%u starts, outputs 0x%06X", (unsigned)site->newButtonStarts, (unsigned)site->newButtonOutputs);
+    failures += !Check("site: configured Up button (GPIO 2)", value, (site->newButtonStarts == 1U) && (site->newButtonOutputs != 0U) &&
+                       ((site->newButtonOutputs & ~SITE_PINS) == 0U));
+    snprintf(value, sizeof(value), "%02d:%02d:%04.1f (sunset %02d:%02d)", (int)(site->close_s / 3600.0), (int)fmod(site->close_s / 60.0, 60.0),
+             fmod(site->close_s, 60.0), (int)(sunset_s / 3600.0), (int)fmod(sunset_s / 60.0, 60.0));
+    failures += !Check("site: evening close", (site->close_s >= 0.0) ? value : "none",
+                       (site->close_s >= sunset_s) && (site->close_s <= (sunset_s + (SITE_PERIOD_MS / 1000.0) + CLOSE_SLACK_S)));
+    snprintf(value, sizeof(value), "0x%06X", (unsigned)site->closeOutputs);
+    failures += !Check("site: close on the configured motor pins", value, (site->closeOutputs != 0U) && ((site->closeOutputs & ~SITE_PINS) == 0U));
+
+    /* Corrupted block */
+    snprintf(value, sizeof(value), "%s, flash block %s", corrupt->source, corrupt->flashState);
+    failures += !Check("corrupt: #CONFIG", value, corrupt->info && (strcmp(corrupt->source, "default") == 0) && (strcmp(corrupt->flashState, "crc") == 0));
+    failures += !Check("corrupt: SiteConfig read in place (XIP)", corrupt->inPlace ? "yes" : "no", !corrupt->inPlace);
+    snprintf(value, sizeof(value), "%.1f s after the boot, 0x%06X", corrupt->close_s,
+             (unsigned)corrupt->closeOutputs);
+    failures += !Check("corrupt: close at once on the default pins", value, (corrupt->close_s >= 0.0) && (corrupt->closeOutputs != 0U) &&
+                       ((corrupt->closeOutputs & ~DEFAULT_PINS) == 0U));
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+/* SolarWorker.c - the slow part of the automatic control in SolarWorkerTask below the buttons and the motor (SolarWorker.c of
+   the firmware): the latency of the Up button while the worker computes without end.
+
+   The simulation preempts the busy loops (HostSim_SetPreemption) like the scheduler of the target does, and the worker is made
+   to loop for good right after its second run (HostSim_HangTask) - every cycle of the CPU it can get. The first run waits for
+   the CPU behind every other task at the boot, so the plant hook watches for the second one and the presses start from it -
+   the harness itself never gets the CPU back while the worker loops. One boot per
+   scenario, each in its own process:
+     idle       - the worker blocks between its runs as it should: the latency of the presses without any load
+     busy       - the worker loops at SOLAR_WORKER_TASK_PRIORITY: the presses are served as fast as without the load, the
+                  decisions of AutomaticControlTask stop and the watchdog resets the board a deadline later
+     busy-high  - the same loop at AUTOMATIC_CONTROL_TASK_PRIORITY, where the computation ran before it moved to the worker:
+                  ButtonTask never runs again, no press is served and the watchdog resets the board within its deadline
+
+   Usage: SolarWorker
+   Exits with 1 if a press is missed or slower than BUTTON_TO_MOTOR_ON_BOUND_IN_US without the load, the loop of the worker
+   makes a press slower by more than a tick, a decision read a day not published whole, the loop at the old priority does
+   not starve the buttons or a loop is not caught by the watchdog. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "CycleCounter.h"
+#include "SolarWorker.h"
+#include "Watchdog.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define HANG_ARMED_US           ((uint64_t)AUTOMATIC_CONTROL_TASK_PERIOD * 500ULL)     /* between the first and the second run */
+#define FIRST_PRESS_DELAY_US    (20000ULL)                                              /* after the second run */
+#define PRESS_HOLD_US           (600000ULL)
+#define PRESS_PERIOD_US         (2000000ULL)
+#define NUM_OF_PRESSES          (12U)
+#define END_US                  ((2ULL * AUTOMATIC_CONTROL_TASK_PERIOD * 1000ULL) + (NUM_OF_PRESSES * PRESS_PERIOD_US))
+#define TICK_US                 (1000000ULL / configTICK_RATE_HZ)
+#define NO_TIME                 (UINT64_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    SCENARIO_IDLE,
+    SCENARIO_BUSY,
+    SCENARIO_BUSY_HIGH,
+    NUM_OF_SCENARIOS
+}ScenarioId_t;
+
+typedef struct
+{
+    bool reset;                                 /* the boot ended with a reset */
+    uint64_t reset_us;
+    uint64_t loopStart_us;                      /* the second run of the worker seen */
+    uint32_t presses;
+    uint64_t latency_us[NUM_OF_PRESSES];        /* press -> motor on, NO_TIME - not served while held */
+    SolarWorkerStats_t worker;
+    uint32_t decisions;                         /* jobs of AutomaticControlTask */
+    uint32_t workerRuns;                        /* jobs of SolarWorkerTask */
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *const ScenarioNames[NUM_OF_SCENARIOS] = { "idle", "busy", "busy-high" };
+
+static Result_t Result;
+static ScenarioId_t Scenario;
+static uint64_t PressStart_us[NUM_OF_PRESSES];
+static uint32_t NextEvent;                      /* even - press, odd - release */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+/* Latency of every press from the motor log - the first start while it was held */
+static void CollectLatencies(void)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+
+    for(uint32_t press = 0; press < Result.presses; press++)
+    {
+        Result.latency_us[press] = NO_TIME;
+        for(uint32_t i = 0; i < length; i++)
+        {
+            if((log[i].time_us >= PressStart_us[press]) && (log[i].time_us < (PressStart_us[press] + PRESS_HOLD_US)) &&
+               (log[i].outputs != 0U))
+            {
+                Result.latency_us[press] = log[i].time_us - PressStart_us[press];
+                break;
+            }
+        }
+    }
+}
+
+static void SendResult(void)
+{
+    CollectLatencies();
+    Result.worker = SolarWorkerStats;
+    Result.decisions = CycleStats[CYCLES_TASK_AUTOMATIC_CONTROL].count;
+    Result.workerRuns = CycleStats[CYCLES_TASK_SOLAR_WORKER].count;
+    HostSim_IsolatedResult(&Result);
+}
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    Result.reset = true;
+    Result.reset_us = state->time_us;
+    SendResult();
+}
+
+/* The outside world - presses and releases of Up from the second run of the worker on (polled every tick until then), and
+   the worker moved to the old priority once its loop starts */
+static uint64_t Plant(uint64_t now_us)
+{
+    if(Result.loopStart_us == NO_TIME)
+    {
+        if(CycleStats[CYCLES_TASK_SOLAR_WORKER].count < 2U)
+        {
+            return now_us + TICK_US;
+        }
+        Result.loopStart_us = now_us;
+        if(Scenario == SCENARIO_BUSY_HIGH)
+        {
+            vTaskPrioritySet(xTaskGetHandle("SolarWorkerTask"), AUTOMATIC_CONTROL_TASK_PRIORITY);
+        }
+    }
+    while(NextEvent < (2U * NUM_OF_PRESSES))
+    {
+        uint32_t press = NextEvent / 2U;
+        uint64_t event_us = Result.loopStart_us + FIRST_PRESS_DELAY_US + (press * PRESS_PERIOD_US) + (((NextEvent % 2U) != 0U) ? PRESS_HOLD_US : 0U);
+        if(event_us > now_us)
+        {
+            return event_us;
+        }
+        if((NextEvent % 2U) == 0U)
+        {
+            PressStart_us[press] = now_us;
+            Result.presses = press + 1U;
+        }
+        HostSim_SetInput(BUTTON_UP, (NextEvent % 2U) == 0U);
+        NextEvent++;
+    }
+    return NO_TIME;
+}
+
+/* One scenario in its own process - the result in Result, sent at the end or by the reboot hook */
+static void Run(const void *context, void *output)
+{
+    (void)output;
+    Scenario = *(const ScenarioId_t*)context;
+    Result.loopStart_us = NO_TIME;
+    HostSim_SetRebootHook(RebootHook);
+    HostSim_SetPreemption(true);
+    HostSim_SetPlantHook(Plant);
+
+    /* Midday in June with the blinds open - the schedule leaves the motor to the button */
+    HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+    if(Scenario != SCENARIO_IDLE)
+    {
+        /* The next time the worker blocks - after its second run */
+        HostSim_HangTask("SolarWorkerTask", HANG_ARMED_US);
+    }
+    HostSim_Boot();
+    HostSim_RunUntilUs(END_US);
+    SendResult();
+}
+
+/* Served presses and their worst latency */
+static uint32_t Served(const Result_t *result, uint64_t *worst_us)
+{
+    uint32_t served = 0;
+    *worst_us = 0;
+    for(uint32_t press = 0; press < result->presses; press++)
+    {
+        if(result->latency_us[press] == NO_TIME) continue;
+        served++;
+        if(result->latency_us[press] > *worst_us) *worst_us = result->latency_us[press];
+    }
+    return served;
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-52s %-30s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_SCENARIOS];
+    uint64_t worst_us[NUM_OF_SCENARIOS];
+    uint32_t served[NUM_OF_SCENARIOS];
+    char value[64];
+    uint32_t failures = 0;
+
+    for(ScenarioId_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        if(!HostSim_RunIsolated(Run, &scenario, &results[scenario], sizeof(results[scenario])))
+        {
+            printf("simulation of %s crashed\n", ScenarioNames[scenario]);
+            return 1;
+        }
+        served[scenario] = Served(&results[scenario], &worst_us[scenario]);
+    }
+
+    printf("Up pressed every %.1f s from %.0f ms after the second run of the worker on, worker priority %u, AutomaticControlTask %u, ButtonTask %u\n\n",
+           PRESS_PERIOD_US / 1e6, FIRST_PRESS_DELAY_US / 1e3, (unsigned)SOLAR_WORKER_TASK_PRIORITY, (unsigned)AUTOMATIC_CONTROL_TASK_PRIORITY,
+           (unsigned)BUTTON_TASK_PRIORITY);
+    printf("%-12s %8s %8s %14s %14s %14s %6s %10s %8s\n", "scenario", "presses", "served", "worst [ms]", "2nd run [s]", "reset [s]", "runs",
+           "decisions", "retries");
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        const Result_t *result = &results[scenario];
+        char reset[16] = "-";
+        if(result->reset) snprintf(reset, sizeof(reset), "%.3f", result->reset_us / 1e6);
+        printf("%-12s %8u %8u %14.1f %14.3f %14s %6u %10u %8u\n", ScenarioNames[scenario], (unsigned)result->presses, (unsigned)served[scenario],
+               worst_us[scenario] / 1000.0, (result->loopStart_us != NO_TIME) ? result->loopStart_us / 1e6 : -1.0, reset, (unsigned)result->workerRuns, (unsigned)result->decisions, (unsigned)result->worker.readRetries);
+    }
+    printf("\n%-52s %-30s %s\n", "check", "value", "result");
+
+    const Result_t *idle = &results[SCENARIO_IDLE], *busy = &results[SCENARIO_BUSY], *high = &results[SCENARIO_BUSY_HIGH];
+    snprintf(value, sizeof(value), "%u/%u, worst %.1f ms", (unsigned)served[SCENARIO_IDLE], (unsigned)idle->presses, worst_us[SCENARIO_IDLE] / 1000.0);
+    failures += !Check("idle: presses served within the bound", value, (idle->presses == NUM_OF_PRESSES) &&
+                       (served[SCENARIO_IDLE] == NUM_OF_PRESSES) && (worst_us[SCENARIO_IDLE] <= BUTTON_TO_MOTOR_ON_BOUND_IN_US) && !idle->reset);
+    snprintf(value, sizeof(value), "%u publishes, %u decisions", (unsigned)idle->worker.publishes, (unsigned)idle->decisions);
+    failures += !Check("idle: a decision per published day", value, (idle->worker.publishes >= 2U) && (idle->decisions == idle->worker.publishes));
+    snprintf(value, sizeof(value), "%u compile, %u retries", (unsigned)idle->worker.compiles, (unsigned)idle->worker.readRetries);
+    failures += !Check("idle: the year compiled once, no torn read", value, (idle->worker.compiles == 1U) && (idle->worker.readRetries == 0U));
+
+    snprintf(value, sizeof(value), "%u/%u, worst %.1f ms", (unsigned)served[SCENARIO_BUSY], (unsigned)busy->presses, worst_us[SCENARIO_BUSY] / 1000.0);
+    failures += !Check("busy: presses served while the worker loops", value, (busy->presses == NUM_OF_PRESSES) &&
+                       (served[SCENARIO_BUSY] == NUM_OF_PRESSES) && (worst_us[SCENARIO_BUSY] <= (worst_us[SCENARIO_IDLE] + TICK_US)));
+    snprintf(value, sizeof(value), "%.3f s into the loop", busy->reset ? (busy->reset_us - busy->loopStart_us) / 1e6 : -1.0);
+    failures += !Check("busy: decisions stopped - watchdog reset", value, busy->reset &&
+                       ((busy->reset_us - busy->loopStart_us) > (NUM_OF_PRESSES * PRESS_PERIOD_US)) &&
+                       ((busy->reset_us - busy->loopStart_us) <= ((WATCHDOG_DEADLINE_AUTOMATIC_CONTROL + WATCHDOG_TIMEOUT_IN_MS + 1U) * 1000ULL)));
+
+    snprintf(value, sizeof(value), "%u/%u served", (unsigned)served[SCENARIO_BUSY_HIGH], (unsigned)high->presses);
+    failures += !Check("busy-high: the buttons starved", value, served[SCENARIO_BUSY_HIGH] == 0U);
+    snprintf(value, sizeof(value), "%.3f s into the loop", high->reset ? (high->reset_us - high->loopStart_us) / 1e6 : -1.0);
+    failures += !Check("busy-high: ButtonTask missed - watchdog reset", value, high->reset &&
+                       ((high->reset_us - high->loopStart_us) <= ((WATCHDOG_DEADLINE_BUTTON + BUTTON_TASK_PERIOD + WATCHDOG_TIMEOUT_IN_MS) * 1000ULL)));
+
+    return (failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/* TimeSync.c - the runtime time sync of the DS1307 over the USB link (TimeSync.c of the firmware) and its drift correction.
+
+   Every scenario boots a fresh firmware image (own process) with the DS1307 off the true local time (minutes behind like after
+   the old build that set the date, an hour off after a DST change) and runs the host side of UpdateSender --time-sync against it over
+   the modelled USB link (the latencies of the link set per scenario). The true time is the virtual time plus the UTC the
+   scenario starts at. With a drift of the DS1307 oscillator a second sync follows days later, then the clock is left running
+   for a week with the correction of AutomaticControlTask. Reported: how long the sync took, the error of the DS1307 (its exact
+   phase against the true local time) right after the sync, the drift the board measured, the largest error over the week
+   (sampled every hour), the steps of the correction and the error the drift would have caused without it.
+
+   Usage: TimeSync
+   Exits with 1 if a sync fails or takes longer than MAX_SYNC_US, the local time is not the expected one, the error after a
+   sync is over MAX_SYNC_ERROR_US (plus half the asymmetry of the link), the drift is off by more than MAX_DRIFT_ERROR_PPB or
+   the error over the week reaches MAX_RUN_ERROR_US. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "DS1307.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "UsbLink.h"
+#include "TimeSync.h"
+
+#include "UpdateProtocol.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define BOOT_SETTLE_US          (3000000ULL)
+#define HOUR_US                 (3600000000ULL)
+#define DAY_US                  (24ULL * HOUR_US)
+#define MAX_SYNC_US             (2500000ULL)    /* a first sync takes about a second, one that measures the drift up to two */
+#define MAX_SYNC_ERROR_US       (3000.0)
+#define MAX_DRIFT_ERROR_PPB     (500)
+#define MAX_RUN_ERROR_US        (600000.0)      /* the step threshold and what the drift estimate is off by */
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef struct
+{
+    const char *name;
+    uint32_t month, day, hour, minute, second, ms;  /* UTC at the virtual time 0, 2026 */
+    int32_t utcOffset_min;                          /* expected local time */
+    int32_t rtcOffset_s;                            /* DS1307 at the boot against the true local time */
+    uint32_t hostToBoard_us, boardToHost_us;
+    double drift_ppm;
+    uint32_t daysBetween;                           /* a second sync that many days after the first, 0 - none */
+    uint32_t daysAfter;                             /* run after the last sync */
+}Scenario_t;
+
+typedef struct
+{
+    bool synced;
+    UpdateTimeSyncStats_t first, last;
+    bool localOk;
+    double syncError_us;                            /* right after the last sync */
+    double maxError_us;                             /* largest over daysAfter */
+    double uncorrected_us;                          /* drift * time since the last sync at the end */
+    uint32_t steps;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Provisioning - the DS1307 3 minutes behind (set by an older build), summer and winter local time */
+    { "summer_provision",  7, 15, 10, 0, 0, 370, 120, -180,    0U,  1000U,   0.0, 0U, 1U },
+    { "winter_provision",  1, 15, 10, 0, 0, 820,  60, 3600,    0U,  1000U,   0.0, 0U, 1U },
+    /* A slow link (hub, busy host) - the delay is measured, not assumed */
+    { "slow_link",         7, 15, 10, 0, 0, 370, 120, -180, 8000U,  8000U,   0.0, 0U, 1U },
+    /* Only the round trip is known - half of the asymmetry stays as an error */
+    { "asymmetric_link",   7, 15, 10, 0, 0, 370, 120, -180,    0U, 12000U,   0.0, 0U, 1U },
+    /* Oscillator drift - measured by the second sync, corrected for a week after it */
+    { "drift_fast",        5, 10,  6, 30, 0, 50, 120,  -20,    0U,  1000U,  40.0, 2U, 7U },
+    { "drift_slow",       11,  2, 18, 15, 0, 640, 60,   45,    0U,  1000U, -25.0, 2U, 7U },
+};
+
+static int64_t Utc0_us;                             /* UTC at the virtual time 0, us since 1970 */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static int64_t SimUtcNow(void *context)
+{
+    (void)context;
+    return Utc0_us + (int64_t)HostSim_NowUs();
+}
+
+/* True local time in us since 2000 - the DS1307 time base */
+static int64_t TrueLocalUs(int32_t utcOffset_min)
+{
+    return SimUtcNow(NULL) - (TIME_SYNC_UNIX_2000_IN_S * 1000000LL) + ((int64_t)utcOffset_min * 60000000LL);
+}
+
+static void SimWrite(void *context, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    HostSim_UsbWrite(data, length);
+}
+
+static bool SimReadLine(void *context, char *line, uint32_t size, uint32_t timeout_ms)
+{
+    (void)context;
+    return HostSim_UsbReadLine(line, size, timeout_ms * 1000ULL);
+}
+
+static void SimSleep(void *context, uint32_t ms)
+{
+    (void)context;
+    HostSim_RunForUs(ms * 1000ULL);
+}
+
+static void Run(const void *context, void *output)
+{
+    const Scenario_t *scenario = context;
+    Result_t *result = output;
+    UpdateTransport_t transport = { NULL, SimWrite, SimReadLine, SimSleep };
+
+    memset(result, 0, sizeof(*result));
+    struct tm utc = { .tm_year = 2026 - 1900, .tm_mon = (int)scenario->month - 1, .tm_mday = (int)scenario->day,
+                      .tm_hour = (int)scenario->hour, .tm_min = (int)scenario->minute, .tm_sec = (int)scenario->second };
+    Utc0_us = ((int64_t)timegm(&utc) * 1000000LL) + (scenario->ms * 1000LL);
+
+    /* The DS1307 on whole seconds at the boot, off the true local time */
+    time_t rtc = (time_t)((Utc0_us / 1000000LL) + (scenario->utcOffset_min * 60) + scenario->rtcOffset_s);
+    struct tm civil;
+    gmtime_r(&rtc, &civil);
+    HostSim_RtcSetTime((uint32_t)civil.tm_year + 1900U, (uint32_t)civil.tm_mon + 1U, (uint32_t)civil.tm_mday, (uint32_t)civil.tm_hour,
+                       (uint32_t)civil.tm_min, (uint32_t)civil.tm_sec);
+    HostSim_RtcSetDrift(scenario->drift_ppm);
+    HostSim_UsbSetLatency(scenario->hostToBoard_us, scenario->boardToHost_us);
+    HostSim_Boot();
+    HostSim_RunForUs(BOOT_SETTLE_US);
+
+    result->synced = UpdateProtocol_TimeSync(&transport, SimUtcNow, &result->first);
+    result->last = result->first;
+    if(result->synced && (scenario->daysBetween > 0U))
+    {
+        HostSim_RunForUs(scenario->daysBetween * DAY_US);
+        result->synced = UpdateProtocol_TimeSync(&transport, SimUtcNow, &result->last);
+    }
+    if(!result->synced) return;
+
+    /* Right after the sync the registers show the local time of the zone (the date is not checked - no scenario is near midnight) */
+    uint64_t synced_us = HostSim_NowUs();
+    result->syncError_us = (double)(HostSim_RtcTimeUs() - TrueLocalUs(scenario->utcOffset_min));
+    int64_t localSecondOfDay = (TrueLocalUs(scenario->utcOffset_min) / 1000000LL) % 86400LL;
+    int64_t rtcSecondOfDay = (ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_HOURS), BCD_TO_DEC) * 3600LL) +
+                             (ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_MINUTES), BCD_TO_DEC) * 60LL) +
+                             ConvertBCD(HostSim_RtcReadRegister(DS1307_REG_ADDR_SECONDS) & 0x7Fu, BCD_TO_DEC);
+    result->localOk = llabs(rtcSecondOfDay - localSecondOfDay) <= 1;
+
+    for(uint32_t hour = 0; hour < (scenario->daysAfter * 24U); hour++)
+    {
+        HostSim_RunForUs(HOUR_US);
+        double error_us = (double)(HostSim_RtcTimeUs() - TrueLocalUs(scenario->utcOffset_min));
+        if(fabs(error_us) > fabs(result->maxError_us)) result->maxError_us = error_us;
+    }
+    result->uncorrected_us = scenario->drift_ppm * (double)(HostSim_NowUs() - synced_us) * 1e-6;
+    result->steps = TimeSyncStats.steps;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    printf("%-17s %-19s %7s %8s %10s %10s %9s %12s %6s %12s  %s\n", "scenario", "rtc before", "rtt ms", "sync s", "error ms",
+           "drift ppm", "measured", "week max ms", "steps", "without ms", "result");
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+
+        Result_t result;
+        if(!HostSim_RunIsolated(Run, scenario, &result, sizeof(result)))
+        {
+            printf("%-17s simulation crashed\n", scenario->name);
+            failures++;
+            continue;
+        }
+        if(!result.synced)
+        {
+            printf("%-17s sync failed: %s / %s\n", scenario->name, result.first.failure, result.last.failure);
+            failures++;
+            continue;
+        }
+
+        double asymmetry_us = fabs((double)scenario->boardToHost_us - (double)scenario->hostToBoard_us) / 2.0;
+        bool drifting = (scenario->daysBetween > 0U);
+        bool ok = result.localOk && (result.first.duration_us <= MAX_SYNC_US) && (result.last.duration_us <= MAX_SYNC_US) &&
+                  (fabs(result.syncError_us) <= (MAX_SYNC_ERROR_US + asymmetry_us)) && (fabs(result.maxError_us) < MAX_RUN_ERROR_US) &&
+                  (!drifting || ((result.last.interval_s > 0U) && (fabs(result.last.drift_ppb - (scenario->drift_ppm * 1000.0)) <= MAX_DRIFT_ERROR_PPB)));
+        if(!ok) failures++;
+
+        char measured[16];
+        snprintf(measured, sizeof(measured), drifting ? "%+.2f" : "-", result.last.drift_ppb / 1000.0);
+        printf("%-17s %-19s %7.2f %8.3f %10.3f %+10.1f %9s %12.1f %6u %12.1f  %s\n", scenario->name, result.first.rtcBefore,
+               result.last.bestRoundTrip_us / 1000.0, result.last.duration_us / 1e6, result.syncError_us / 1000.0, scenario->drift_ppm,
+               measured, result.maxError_us / 1000.0, (unsigned)result.steps, result.uncorrected_us / 1000.0, ok ? "ok" : "UNEXPECTED");
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}
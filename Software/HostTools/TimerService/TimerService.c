@@ -0,0 +1,407 @@
+/* TimerService.c - the software deadlines of the firmware on one hardware alarm (TimerService.c of the firmware): a model of
+   every timer next to the timing wheel, started, restarted and cancelled at random - from the harness and from the callbacks
+   themselves - and every expiry checked against the microsecond the model expects it at. One process per scenario:
+     wheel      - the service alone (no boot), TIMER_SERVICE_LEVELS deep: delays of up to 2^32 - 1 us and periods of up to a
+                  minute for six hours of the clock, past the wrap of the 32-bit alarm compare
+     firmware   - the booted firmware beside it: the debounce of ButtonTask in the same wheel while Up is pressed every
+                  2 s, the other timers at the periods and delays of watchdog kicks and scheduled moves
+
+   Usage: TimerService
+   Exits with 1 if a deadline expires early, late, twice or after it was cancelled, one is missed, a deadline moves down the
+   wheel more often than it has levels, the alarm stays armed with nothing in the wheel, a press is missed or the debounce
+   still uses alarm 1. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "hardware/irq.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "TimerService.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_TIMERS              (512U)
+#define PERIODIC_EVERY          (16U)                   /* every 16th timer may be started periodic */
+#define CALLBACK_OPERATES_EVERY (4U)                    /* the callback of every 4th timer starts or cancels another one */
+#define WHEEL_END_US            (6ULL * 3600ULL * 1000000ULL)
+#define FIRMWARE_END_US         (30ULL * 1000000ULL)
+#define PRESS_START_US          (2000000ULL)
+#define PRESS_HOLD_US           (600000ULL)
+#define PRESS_PERIOD_US         (2000000ULL)
+#define NUM_OF_PRESSES          (12U)
+#define SEED                    (0x2545F491U)
+#define NO_TIME                 (UINT64_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+typedef enum
+{
+    SCENARIO_WHEEL,
+    SCENARIO_FIRMWARE,
+    NUM_OF_SCENARIOS
+}ScenarioId_t;
+
+typedef struct
+{
+    uint32_t numOfTimers;
+    uint32_t maxDelayBits;                      /* one-shot delays of up to 2^bits - 1 us */
+    uint32_t minPeriodBits, maxPeriodBits;
+    uint32_t maxGapBits;                        /* between the operations of the harness */
+    uint64_t end_us;
+    uint64_t drain_us;                          /* after everything is cancelled - the last step of the alarm passes */
+    bool boot;
+}Scenario_t;
+
+/* What the firmware should do - the deadline every timer is armed for */
+typedef struct
+{
+    bool armed;
+    uint64_t deadline_us;
+    uint32_t period_us;
+    uint32_t delay_us;
+}ModelTimer_t;
+
+typedef struct
+{
+    uint64_t starts;
+    uint64_t cancels;
+    uint64_t expiries;
+    uint64_t periodicExpiries;
+    uint64_t early;
+    uint64_t late;
+    uint64_t maxLate_us;
+    uint64_t spurious;                          /* expired while the model has it cancelled or already expired */
+    uint64_t missed;                            /* still armed in the model past its deadline */
+    uint64_t stillArmed;                        /* armed in the service after all of them were cancelled */
+    uint64_t longest_us;                        /* longest one-shot delay that expired */
+    uint32_t deepestLevel;
+    TimerServiceStats_t service;
+    uint32_t alarmIsrEntries;
+    uint32_t alarm1IsrEntries;
+    bool alarmArmed;                            /* alarm of the service armed after the drain */
+    bool alarm1Armed;
+    uint32_t presses;
+    uint32_t served;
+}Result_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[NUM_OF_SCENARIOS] =
+{
+    [SCENARIO_WHEEL]    = { MAX_TIMERS, 32U, 10U, 26U, 23U, WHEEL_END_US, 2ULL * TIMER_SERVICE_MAX_ALARM_US, false },
+    [SCENARIO_FIRMWARE] = { 64U, 24U, 10U, 20U, 16U, FIRMWARE_END_US, 1ULL << 25, true },
+};
+static const char *const ScenarioNames[NUM_OF_SCENARIOS] = { "wheel", "firmware" };
+
+static Result_t Result;
+static const Scenario_t *Scenario;
+static TimerService_Timer_t Timers[MAX_TIMERS];
+static ModelTimer_t Model[MAX_TIMERS];
+static uint32_t Random = SEED;
+static uint64_t NextOperation_us;
+static bool Operating;
+static uint64_t PressStart_us[NUM_OF_PRESSES];
+static uint32_t NextPressEvent;                 /* even - press, odd - release */
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static uint32_t NextRandom(void)
+{
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    return Random;
+}
+
+/* Spread evenly over the orders of magnitude - every level of the wheel gets its share */
+static uint32_t RandomBelowBits(uint32_t minBits, uint32_t maxBits)
+{
+    uint32_t bits = minBits + (NextRandom() % (maxBits - minBits + 1U));
+    uint32_t mask = (bits >= 32U) ? UINT32_MAX : ((1u << bits) - 1U);
+    return NextRandom() & mask;
+}
+
+static void RandomOperation(uint64_t now_us)
+{
+    uint32_t index = NextRandom() % Scenario->numOfTimers;
+    uint32_t kind = NextRandom() % 8U;
+    ModelTimer_t *model = &Model[index];
+
+    if(kind < 2U)
+    {
+        model->armed = false;
+        TimerService_Cancel(&Timers[index]);
+        Result.cancels++;
+    }
+    else if((kind == 2U) && ((index % PERIODIC_EVERY) == 0U))
+    {
+        uint32_t period_us = RandomBelowBits(Scenario->minPeriodBits, Scenario->maxPeriodBits) | 1U;
+        *model = (ModelTimer_t){ true, now_us + period_us, period_us, period_us };
+        TimerService_StartPeriodic(&Timers[index], period_us);
+        Result.starts++;
+    }
+    else
+    {
+        uint32_t delay_us = RandomBelowBits(0U, Scenario->maxDelayBits);
+        *model = (ModelTimer_t){ true, now_us + delay_us, 0U, delay_us };
+        TimerService_Start(&Timers[index], delay_us);
+        Result.starts++;
+    }
+    if(Timers[index].level > Result.deepestLevel) Result.deepestLevel = Timers[index].level;
+}
+
+/* In the alarm interrupt of the service */
+static void Expired(TimerService_Timer_t *timer, void *context)
+{
+    uint32_t index = (uint32_t)(uintptr_t)context;
+    ModelTimer_t *model = &Model[index];
+    uint64_t now_us = HostSim_NowUs();
+    (void)timer;
+
+    Result.expiries++;
+    if(!model->armed)
+    {
+        Result.spurious++;
+        return;
+    }
+    if(now_us < model->deadline_us)
+    {
+        Result.early++;
+    }
+    else if(now_us > model->deadline_us)
+    {
+        Result.late++;
+        if((now_us - model->deadline_us) > Result.maxLate_us) Result.maxLate_us = now_us - model->deadline_us;
+    }
+
+    if(model->period_us != 0U)
+    {
+        Result.periodicExpiries++;
+        model->deadline_us += model->period_us;
+        if(model->deadline_us <= now_us)
+        {
+            model->deadline_us += (((now_us - model->deadline_us) / model->period_us) + 1U) * model->period_us;
+        }
+    }
+    else
+    {
+        model->armed = false;
+        if(model->delay_us > Result.longest_us) Result.longest_us = model->delay_us;
+    }
+
+    if(Operating && ((index % CALLBACK_OPERATES_EVERY) == 0U))
+    {
+        RandomOperation(now_us);
+    }
+}
+
+/* Every deadline of the model in the past expired - the ones left are all still ahead */
+static void CountMissed(uint64_t now_us)
+{
+    for(uint32_t i = 0; i < Scenario->numOfTimers; i++)
+    {
+        if(Model[i].armed && (Model[i].deadline_us < now_us))
+        {
+            Result.missed++;
+        }
+    }
+}
+
+static void SendResult(void)
+{
+    Result.service = TimerServiceStats;
+    Result.alarmIsrEntries = HostSim_GetIsrStats(TIMER_SERVICE_IRQ)->entries;
+    Result.alarm1IsrEntries = HostSim_GetIsrStats(TIMER_IRQ_1)->entries;
+    HostSim_IsolatedResult(&Result);
+}
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    (void)state;
+    SendResult();
+}
+
+/* Presses of Up served - the first motor start while each was held */
+static void CollectPresses(void)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+
+    for(uint32_t press = 0; press < Result.presses; press++)
+    {
+        for(uint32_t i = 0; i < length; i++)
+        {
+            if((log[i].time_us >= PressStart_us[press]) && (log[i].time_us < (PressStart_us[press] + PRESS_HOLD_US)) &&
+               (log[i].outputs != 0U))
+            {
+                Result.served++;
+                break;
+            }
+        }
+    }
+}
+
+/* The operations of the harness and, with the firmware booted, the presses of Up */
+static uint64_t Plant(uint64_t now_us)
+{
+    if(!Operating)
+    {
+        return NO_TIME;
+    }
+
+    uint64_t next_us = NO_TIME;
+    if(Scenario->boot)
+    {
+        while(NextPressEvent < (2U * NUM_OF_PRESSES))
+        {
+            uint32_t press = NextPressEvent / 2U;
+            uint64_t event_us = PRESS_START_US + (press * PRESS_PERIOD_US) + (((NextPressEvent % 2U) != 0U) ? PRESS_HOLD_US : 0U);
+            if(event_us > now_us)
+            {
+                next_us = event_us;
+                break;
+            }
+            if((NextPressEvent % 2U) == 0U)
+            {
+                PressStart_us[press] = now_us;
+                Result.presses = press + 1U;
+            }
+            HostSim_SetInput(BUTTON_UP, (NextPressEvent % 2U) == 0U);
+            NextPressEvent++;
+        }
+    }
+
+    if(now_us >= NextOperation_us)
+    {
+        RandomOperation(now_us);
+        NextOperation_us = now_us + 1U + RandomBelowBits(Scenario->maxGapBits, Scenario->maxGapBits);
+    }
+    return (NextOperation_us < next_us) ? NextOperation_us : next_us;
+}
+
+/* One scenario in its own process - the result in Result, sent at the end or by the reboot hook */
+static void Run(const void *context, void *output)
+{
+    (void)output;
+    Scenario = context;
+    HostSim_SetRebootHook(RebootHook);
+
+    if(Scenario->boot)
+    {
+        /* Midday in June with the blinds open - the schedule leaves the motor to the button */
+        HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+        HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_OPEN);
+        HostSim_Boot();
+    }
+    else
+    {
+        TimerService_Init();
+    }
+    for(uint32_t i = 0; i < Scenario->numOfTimers; i++)
+    {
+        TimerService_Setup(&Timers[i], Expired, (void *)(uintptr_t)i);
+    }
+
+    Operating = true;
+    NextOperation_us = HostSim_NowUs();
+    HostSim_SetPlantHook(Plant);
+    HostSim_RunUntilUs(Scenario->end_us);
+    Operating = false;
+    CountMissed(HostSim_NowUs());
+    if(Scenario->boot) CollectPresses();
+
+    /* Everything cancelled - nothing may expire any more and the alarm goes idle after the last step it was set to */
+    for(uint32_t i = 0; i < Scenario->numOfTimers; i++)
+    {
+        TimerService_Cancel(&Timers[i]);
+        Model[i].armed = false;
+    }
+    HostSim_RunForUs(Scenario->drain_us);
+    for(uint32_t i = 0; i < Scenario->numOfTimers; i++)
+    {
+        if(TimerService_IsArmed(&Timers[i])) Result.stillArmed++;
+    }
+    /* ButtonTask keeps its own deadlines - the alarm is idle only once they expired too */
+    Result.alarmArmed = HostSim_IsAlarmArmed(TIMER_SERVICE_ALARM_NUM);
+    Result.alarm1Armed = HostSim_IsAlarmArmed(1U);
+    SendResult();
+}
+
+static bool Check(const char *name, const char *value, bool ok)
+{
+    printf("%-52s %-30s %s\n", name, value, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    static Result_t results[NUM_OF_SCENARIOS];
+    char name[64], value[64];
+    uint32_t failures = 0;
+
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        if(!HostSim_RunIsolated(Run, &Scenarios[scenario], &results[scenario], sizeof(results[scenario])))
+        {
+            printf("simulation of %s crashed\n", ScenarioNames[scenario]);
+            return 1;
+        }
+    }
+
+    printf("Timing wheel of %u levels of %u slots on alarm %u\n\n", (unsigned)TIMER_SERVICE_LEVELS, (unsigned)TIMER_SERVICE_SLOTS,
+           (unsigned)TIMER_SERVICE_ALARM_NUM);
+    printf("%-10s %7s %10s %10s %9s %11s %11s %11s %9s %7s\n", "scenario", "timers", "sim [s]", "starts", "cancels", "expiries",
+           "cascades", "alarm isr", "max lvl", "late");
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        const Result_t *result = &results[scenario];
+        printf("%-10s %7u %10.0f %10llu %9llu %11llu %11u %11u %9u %7llu\n", ScenarioNames[scenario],
+               (unsigned)Scenarios[scenario].numOfTimers, Scenarios[scenario].end_us / 1e6, (unsigned long long)result->starts,
+               (unsigned long long)result->cancels, (unsigned long long)result->expiries, (unsigned)result->service.cascades,
+               (unsigned)result->alarmIsrEntries, (unsigned)result->deepestLevel, (unsigned long long)result->late);
+    }
+    printf("\n%-52s %-30s %s\n", "check", "value", "result");
+
+    for(uint32_t scenario = 0; scenario < NUM_OF_SCENARIOS; scenario++)
+    {
+        const Result_t *result = &results[scenario];
+        const char *label = ScenarioNames[scenario];
+
+        snprintf(name, sizeof(name), "%s: every expiry at its microsecond", label);
+        snprintf(value, sizeof(value), "%llu early, %llu late", (unsigned long long)result->early, (unsigned long long)result->late);
+        failures += !Check(name, value, (result->expiries > 0U) && (result->early == 0U) && (result->late == 0U));
+        snprintf(name, sizeof(name), "%s: none missed, none after its cancel", label);
+        snprintf(value, sizeof(value), "%llu missed, %llu spurious", (unsigned long long)result->missed, (unsigned long long)result->spurious);
+        failures += !Check(name, value, (result->missed == 0U) && (result->spurious == 0U) && (result->stillArmed == 0U));
+        /* Every start and every periodic re-arm goes down the wheel at most once per level above 0 - ButtonTask starts its own */
+        snprintf(name, sizeof(name), "%s: cascades within the levels", label);
+        snprintf(value, sizeof(value), "%.2f per start", (double)result->service.cascades / (double)result->service.starts);
+        failures += !Check(name, value, result->service.cascades <=
+                           ((uint64_t)(TIMER_SERVICE_LEVELS - 1U) * ((uint64_t)result->service.starts + result->periodicExpiries)));
+        snprintf(name, sizeof(name), "%s: alarm idle once the wheel is empty", label);
+        snprintf(value, sizeof(value), "%s", result->alarmArmed ? "armed" : "idle");
+        failures += !Check(name, value, !result->alarmArmed);
+    }
+
+    const Result_t *wheel = &results[SCENARIO_WHEEL], *firmware = &results[SCENARIO_FIRMWARE];
+    snprintf(value, sizeof(value), "%.0f s, level %u", wheel->longest_us / 1e6, (unsigned)wheel->deepestLevel);
+    failures += !Check("wheel: deadlines beyond one step of the alarm", value, (wheel->longest_us > TIMER_SERVICE_MAX_ALARM_US) &&
+                       (wheel->deepestLevel >= 6U));
+    snprintf(value, sizeof(value), "%u/%u", (unsigned)firmware->served, (unsigned)firmware->presses);
+    failures += !Check("firmware: presses debounced through the wheel", value, (firmware->presses == NUM_OF_PRESSES) &&
+                       (firmware->served == NUM_OF_PRESSES));
+    snprintf(value, sizeof(value), "%u interrupts, %s", (unsigned)firmware->alarm1IsrEntries, firmware->alarm1Armed ? "armed" : "idle");
+    failures += !Check("firmware: alarm 1 left free", value, (firmware->alarm1IsrEntries == 0U) && !firmware->alarm1Armed);
+
+    return (failures == 0U) ? 0 : 1;
+}
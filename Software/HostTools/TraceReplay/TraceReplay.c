@@ -0,0 +1,576 @@
+/* TraceReplay.c - deterministic replay of a field trace (Trace.h) in the host build of the firmware.
+
+   A firmware image built with TRACE_ENABLED=1 records what it takes from the outside world (the GPIO edges its interrupt
+   handler got, the input levels and DS1307 registers it read) and the motor outputs it drove. The replay boots the same
+   firmware (HostSim, built with TRACE_ENABLED=1) and feeds the recorded inputs back at their recorded times: an edge at its
+   time, so the interrupt handler runs at the same instant, a level or register value 1us before the read that saw it. The
+   motor outputs of the replay (its own trace) are compared with the recorded ones, the first divergence is reported.
+   Virtual time makes the replay much faster than real time - a trace of days takes seconds, --until stops it earlier.
+
+   Without a trace the tool tests itself: a capture of CAPTURE_DAYS in HostSim (automatic moves, button presses with
+   bounce, limit switches of a simple blind model), its replay (identical) and the replay of a copy with one button
+   press dropped (has to diverge right there).
+
+   Usage: TraceReplay TRACE.bin [--until SECONDS] [--tolerance US]     (TRACE.bin from UpdateSender --trace-read)
+          TraceReplay [--save TRACE.bin]                                (self-test, --save keeps the capture)
+   Exits with 1 when the motor outputs diverge (the self-test: when its replay diverges or the perturbed one does not). */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+#include "hardware/sync.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "Channels.h"
+#include "SiteConfig.h"
+#include "BootControl.h"
+#include "Trace.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define CAPTURE_DAYS            (2U)
+#define CAPTURE_START_HOUR      (3U)
+#define TRAVEL_US               (20000000ULL)   /* blind model - bottom to top */
+#define LIMIT_PRESS_US          (40000ULL)      /* the limit switch is pressed while the blind passes its end position */
+#define BOUNCE_US               (200ULL)
+#define PRESS_MIN_GAP_S         (2U * 3600U)    /* button presses of the capture - every 2..8 hours, held 1..6 s */
+#define PRESS_MAX_GAP_S         (8U * 3600U)
+#define MOTOR_STEP_US           (1000ULL)       /* blind model step while a motor runs */
+#define IDLE_STEP_US            (1000000ULL)
+#define REPLAY_TAIL_US          (1000000ULL)    /* replayed after the last record */
+#define REPLAY_BOOT_US          (100000ULL)     /* HostSim_Boot runs the first jobs of the tasks - up to that long with the I2C */
+#define DEFAULT_TOLERANCE_US    (0ULL)
+#define NO_TIME                 (UINT64_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+/* One decoded record - time relative to the origin of the trace */
+typedef struct
+{
+    uint64_t time_us;
+    uint8_t type;                   /* TraceType_t */
+    uint8_t id;
+    uint32_t value;
+}TraceEvent_t;
+
+typedef struct
+{
+    TraceHeader_t header;
+    TraceEvent_t *events;
+    uint32_t numOfEvents;
+}Trace_t;
+
+typedef struct
+{
+    bool ok;
+    uint32_t state;                 /* TraceState of the run */
+    uint64_t virtual_us;            /* simulated from the trace origin */
+}RunResult_t;
+
+/* What the process of a run gets - the trace to replay, NULL for the capture */
+typedef struct
+{
+    const Trace_t *trace;
+    uint64_t until_us;
+}Run_t;
+
+typedef struct
+{
+    bool diverged;
+    uint64_t time_us;               /* first motor record that differs */
+    uint32_t motorRecords;          /* compared */
+    bool identical;                 /* all the records of both traces, times included */
+}Comparison_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const char *const TypeNames[] = { "?", "edge", "inputs", "i2c read", "i2c write", "motor" };
+static const char *const StateNames[] = { "off", "capturing", "full", "overflow" };
+
+/* DS1307 registers of the replay - the recorded reads, and what the firmware wrote since */
+static uint8_t ReplayRegisters[64];
+static uint64_t ReplayRegistersKnown;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static double HostSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static bool ReadVarint(const uint8_t *bytes, uint32_t length, uint32_t *position, uint64_t *value)
+{
+    uint32_t shift = 0;
+    *value = 0;
+    while(*position < length)
+    {
+        uint8_t byte = bytes[(*position)++];
+        *value |= (uint64_t)(byte & 0x7FU) << shift;
+        if((byte & 0x80U) == 0U) return true;
+        shift += 7U;
+    }
+    return false;
+}
+
+/* Trace area as on the flash (header page, records) - false if it is not a trace of this firmware configuration */
+static bool DecodeTrace(const uint8_t *area, uint32_t length, Trace_t *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+    if(length < FLASH_PAGE_SIZE) return false;
+    memcpy(&trace->header, area, sizeof(trace->header));
+    if((trace->header.magic != TRACE_MAGIC) || (trace->header.version != TRACE_VERSION)) return false;
+
+    const uint8_t *records = &area[FLASH_PAGE_SIZE];
+    uint32_t size = length - FLASH_PAGE_SIZE, position = 0;
+    uint64_t time_us = 0;
+    trace->events = malloc(((size / 4U) + 1U) * sizeof(TraceEvent_t));
+    while(((position + 2U) <= size) && (records[position] != TRACE_END_OF_RECORDS))
+    {
+        TraceEvent_t *event = &trace->events[trace->numOfEvents];
+        uint64_t delta, value;
+        event->type = records[position];
+        event->id = records[position + 1U];
+        position += 2U;
+        if(!ReadVarint(records, size, &position, &delta) || !ReadVarint(records, size, &position, &value)) break;
+        time_us += delta;
+        event->time_us = time_us;
+        event->value = (uint32_t)value;
+        trace->numOfEvents++;
+    }
+    return true;
+}
+
+static bool ReplayRead(uint8_t reg, uint8_t *value)
+{
+    reg %= 64U;
+    if(((ReplayRegistersKnown >> reg) & 1U) == 0U) return false;
+    *value = ReplayRegisters[reg];
+    return true;
+}
+
+static void ReplayI2cHook(bool write, uint8_t reg, uint8_t value)
+{
+    if(write)
+    {
+        ReplayRegisters[reg % 64U] = value;
+        ReplayRegistersKnown |= 1ULL << (reg % 64U);
+    }
+}
+
+static void RunUntilBefore(uint64_t time_us)
+{
+    if(time_us > HostSim_NowUs()) HostSim_RunUntilUs(time_us);
+}
+
+static void SetInputs(uint32_t levels)
+{
+    for(uint32_t gpio = 0; gpio < HOSTSIM_NUM_GPIOS; gpio++)
+    {
+        if((ChannelLookup.inputsMask >> gpio) & 1U) HostSim_SetInput(gpio, ((levels >> gpio) & 1U) != 0U);
+    }
+}
+
+/* Child process - the firmware fed with the recorded inputs, its own trace ends up in the (shared) flash */
+static void Replay(const Trace_t *trace, uint64_t until_us)
+{
+    RunResult_t result = { false, 0U, 0U };
+    uint32_t initialLevels = 0;
+    bool levelsRead = false;
+
+    /* HostSim_Boot runs the tasks of the capture start already (the first job of AutomaticControlTask reads the DS1307 after the
+       I2C transfers of TimeSync_Service) - what they read there is set up before */
+    for(uint32_t e = 0; (e < trace->numOfEvents) && (trace->events[e].time_us < REPLAY_BOOT_US) &&
+                        ((trace->events[e].type == TRACE_INPUTS) || (trace->events[e].type == TRACE_I2C_READ)); e++)
+    {
+        const TraceEvent_t *event = &trace->events[e];
+        if((event->type == TRACE_INPUTS) && !levelsRead)
+        {
+            initialLevels = event->value;
+            levelsRead = true;
+        }
+        if((event->type == TRACE_I2C_READ) && (((ReplayRegistersKnown >> (event->id % 64U)) & 1U) == 0U))
+        {
+            ReplayRegisters[event->id % 64U] = (uint8_t)event->value;
+            ReplayRegistersKnown |= 1ULL << (event->id % 64U);
+        }
+    }
+    for(uint32_t gpio = 0; gpio < HOSTSIM_NUM_GPIOS; gpio++)
+    {
+        if((initialLevels >> gpio) & 1U) HostSim_SetInput(gpio, true);
+    }
+    HostSim_SetI2cReadSource(ReplayRead);
+    HostSim_SetI2cHook(ReplayI2cHook);
+    HostSim_Boot();
+    if(TraceState != TRACE_STATE_CAPTURING) HostSim_IsolatedResult(&result);
+
+    uint64_t origin = TraceOrigin_us;
+    for(uint32_t e = 0; (e < trace->numOfEvents) && (trace->events[e].time_us <= until_us); e++)
+    {
+        const TraceEvent_t *event = &trace->events[e];
+        uint64_t time_us = origin + event->time_us;
+        switch(event->type)
+        {
+            case TRACE_GPIO_EDGE:
+                RunUntilBefore(time_us);
+                if(event->value == GPIO_IRQ_EDGE_RISE) HostSim_SetInput(event->id, true);
+                else if(event->value == GPIO_IRQ_EDGE_FALL) HostSim_SetInput(event->id, false);
+                else
+                {
+                    /* Both edges in one interrupt - a glitch shorter than the interrupt latency */
+                    bool level = HostSim_GetPin(event->id);
+                    uint32_t status = save_and_disable_interrupts();
+                    HostSim_SetInput(event->id, !level);
+                    HostSim_SetInput(event->id, level);
+                    restore_interrupts(status);
+                }
+                break;
+            case TRACE_INPUTS:
+                RunUntilBefore(time_us - 1U);
+                SetInputs(event->value);
+                break;
+            case TRACE_I2C_READ:
+                RunUntilBefore(time_us - 1U);
+                ReplayRegisters[event->id % 64U] = (uint8_t)event->value;
+                ReplayRegistersKnown |= 1ULL << (event->id % 64U);
+                break;
+            default:
+                break;      /* outputs of the firmware */
+        }
+    }
+    uint64_t end_us = (trace->numOfEvents > 0U) ? (trace->events[trace->numOfEvents - 1U].time_us + REPLAY_TAIL_US) : REPLAY_TAIL_US;
+    HostSim_RunUntilUs(origin + ((end_us < until_us) ? end_us : until_us));
+
+    Trace_Flush();
+    result.ok = true;
+    result.state = TraceState;
+    result.virtual_us = HostSim_NowUs() - origin;
+    HostSim_IsolatedResult(&result);
+}
+
+/* Blind model of channel 0 for the capture - a limit switch is pressed while the blind passes its end position */
+static void Capture(void)
+{
+    RunResult_t result = { false, 0U, 0U };
+    uint32_t seed = 12345U;
+    int64_t position_us = 0;                /* closed */
+    uint64_t limitRelease_us = NO_TIME;
+    uint32_t limitGpio = 0;
+
+    HostSim_RtcSetTime(2026, 3, 20, CAPTURE_START_HOUR, 0, 0);
+    HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, BLINDS_CLOSED);
+    HostSim_Boot();
+    if(TraceState != TRACE_STATE_CAPTURING) HostSim_IsolatedResult(&result);
+
+    uint64_t end_us = CAPTURE_DAYS * 86400ULL * 1000000ULL;
+    uint64_t nextPress_us = 3600ULL * 1000000ULL;
+    while(HostSim_NowUs() < end_us)
+    {
+        if(HostSim_NowUs() >= nextPress_us)
+        {
+            /* Up or Down held for 1..6 s, with contact bounce at the press and the release */
+            seed = (seed * 1103515245U) + 12345U;
+            uint32_t gpio = ((seed >> 16) & 1U) ? BUTTON_UP : BUTTON_DOWN;
+            uint64_t hold_us = (1U + ((seed >> 8) % 6U)) * 1000000ULL;
+            for(uint32_t edge = 0; edge < 3U; edge++)
+            {
+                HostSim_SetInput(gpio, (edge % 2U) == 0U);
+                HostSim_RunForUs(BOUNCE_US);
+            }
+            uint64_t release_us = HostSim_NowUs() + hold_us;
+            while(HostSim_NowUs() < release_us)
+            {
+                bool up = HostSim_GetPin(SiteConfig->channels.motorControl2Gpio[0]);
+                bool down = HostSim_GetPin(SiteConfig->channels.motorControl1Gpio[0]);
+                position_us += up ? (int64_t)MOTOR_STEP_US : (down ? -(int64_t)MOTOR_STEP_US : 0);
+                HostSim_RunForUs(MOTOR_STEP_US);
+            }
+            for(uint32_t edge = 0; edge < 3U; edge++)
+            {
+                HostSim_SetInput(gpio, (edge % 2U) != 0U);
+                HostSim_RunForUs(BOUNCE_US);
+            }
+            seed = (seed * 1103515245U) + 12345U;
+            nextPress_us = HostSim_NowUs() + (PRESS_MIN_GAP_S + ((seed >> 8) % (PRESS_MAX_GAP_S - PRESS_MIN_GAP_S))) * 1000000ULL;
+        }
+
+        bool up = HostSim_GetPin(SiteConfig->channels.motorControl2Gpio[0]);
+        bool down = HostSim_GetPin(SiteConfig->channels.motorControl1Gpio[0]);
+        if(!up && !down && (limitRelease_us == NO_TIME))
+        {
+            uint64_t next_us = HostSim_NowUs() + IDLE_STEP_US;
+            HostSim_RunUntilUs((next_us < nextPress_us) ? next_us : nextPress_us);
+            continue;
+        }
+
+        int64_t before = position_us;
+        position_us += up ? (int64_t)MOTOR_STEP_US : (down ? -(int64_t)MOTOR_STEP_US : 0);
+        if(up && (before < (int64_t)TRAVEL_US) && (position_us >= (int64_t)TRAVEL_US)) limitGpio = SiteConfig->channels.inputGpio[CHANNEL_INPUT_TOP_LIMIT][0];
+        else if(down && (before > 0) && (position_us <= 0)) limitGpio = SiteConfig->channels.inputGpio[CHANNEL_INPUT_BOTTOM_LIMIT][0];
+        else limitGpio = 0U;
+        if(limitGpio != 0U)
+        {
+            HostSim_SetInput(limitGpio, true);
+            limitRelease_us = HostSim_NowUs() + LIMIT_PRESS_US;
+        }
+        if((limitRelease_us != NO_TIME) && (HostSim_NowUs() >= limitRelease_us))
+        {
+            HostSim_SetInput(SiteConfig->channels.inputGpio[CHANNEL_INPUT_TOP_LIMIT][0], false);
+            HostSim_SetInput(SiteConfig->channels.inputGpio[CHANNEL_INPUT_BOTTOM_LIMIT][0], false);
+            limitRelease_us = NO_TIME;
+        }
+        HostSim_RunForUs(MOTOR_STEP_US);
+    }
+
+    Trace_Flush();
+    result.ok = true;
+    result.state = TraceState;
+    result.virtual_us = HostSim_NowUs() - TraceOrigin_us;
+    HostSim_IsolatedResult(&result);
+}
+
+static void Run(const void *context, void *output)
+{
+    const Run_t *run = context;
+
+    (void)output;
+    if(run->trace == NULL) Capture();
+    else Replay(run->trace, run->until_us);
+}
+
+/* Runs the capture (trace NULL) or a replay in a fresh firmware image, with the trace area erased before */
+static bool RunProcess(const Trace_t *trace, uint64_t until_us, RunResult_t *result, double *host_s)
+{
+    Run_t run = { trace, until_us };
+
+    memset(HostSim_Flash() + BOOT_TRACE_OFFSET, 0xFF, BOOT_TRACE_SIZE);
+    double start = HostSeconds();
+    bool ok = HostSim_RunIsolated(Run, &run, result, sizeof(*result));
+    *host_s = HostSeconds() - start;
+    return ok && result->ok;
+}
+
+/* The trace area of the last run, as on the flash */
+static uint32_t FlashTrace(uint8_t *area)
+{
+    memcpy(area, HostSim_Flash() + BOOT_TRACE_OFFSET, BOOT_TRACE_SIZE);
+    return BOOT_TRACE_SIZE;
+}
+
+/* Motor records in order - the same channel and outputs within the tolerance, up to the end of the replayed time */
+static Comparison_t Compare(const Trace_t *recorded, const Trace_t *replayed, uint64_t until_us, uint64_t tolerance_us)
+{
+    Comparison_t comparison = { false, NO_TIME, 0U, true };
+    uint32_t a = 0, b = 0;
+
+    for(;;)
+    {
+        while((a < recorded->numOfEvents) && (recorded->events[a].type != TRACE_MOTOR)) a++;
+        while((b < replayed->numOfEvents) && (replayed->events[b].type != TRACE_MOTOR)) b++;
+        const TraceEvent_t *x = ((a < recorded->numOfEvents) && (recorded->events[a].time_us <= until_us)) ? &recorded->events[a] : NULL;
+        const TraceEvent_t *y = ((b < replayed->numOfEvents) && (replayed->events[b].time_us <= until_us)) ? &replayed->events[b] : NULL;
+        if((x == NULL) && (y == NULL)) break;
+
+        uint64_t dt = ((x != NULL) && (y != NULL)) ? ((x->time_us > y->time_us) ? (x->time_us - y->time_us) : (y->time_us - x->time_us)) : 0U;
+        if((x == NULL) || (y == NULL) || (x->id != y->id) || (x->value != y->value) || (dt > tolerance_us))
+        {
+            comparison.diverged = true;
+            comparison.time_us = (x == NULL) ? y->time_us : ((y == NULL) ? x->time_us : ((x->time_us < y->time_us) ? x->time_us : y->time_us));
+            break;
+        }
+        comparison.motorRecords++;
+        a++;
+        b++;
+    }
+
+    uint32_t count = 0;
+    while((count < recorded->numOfEvents) && (recorded->events[count].time_us <= until_us)) count++;
+    comparison.identical = (count <= replayed->numOfEvents);
+    for(uint32_t e = 0; comparison.identical && (e < count); e++)
+    {
+        comparison.identical = (memcmp(&recorded->events[e], &replayed->events[e], sizeof(TraceEvent_t)) == 0);
+    }
+    return comparison;
+}
+
+static void PrintTrace(const char *name, const Trace_t *trace)
+{
+    uint32_t counts[6] = { 0 };
+    for(uint32_t e = 0; e < trace->numOfEvents; e++) counts[(trace->events[e].type < 6U) ? trace->events[e].type : 0U]++;
+    printf("%s: %u records over %.1f h -", name, (unsigned)trace->numOfEvents,
+           (trace->numOfEvents > 0U) ? trace->events[trace->numOfEvents - 1U].time_us / 3.6e9 : 0.0);
+    for(uint32_t type = TRACE_GPIO_EDGE; type <= TRACE_MOTOR; type++) printf(" %s %u", TypeNames[type], (unsigned)counts[type]);
+    printf("\n");
+}
+
+/* Replays the trace and compares - true if the motor outputs did not diverge */
+static bool ReplayAndCompare(const char *name, const Trace_t *trace, uint64_t until_us, uint64_t tolerance_us, Comparison_t *comparison)
+{
+    static uint8_t area[BOOT_TRACE_SIZE];
+    RunResult_t result;
+    Trace_t replayed;
+    double host_s;
+
+    if(!RunProcess(trace, until_us, &result, &host_s))
+    {
+        printf("%s: replay failed (no capture in the replay image - built without TRACE_ENABLED?)\n", name);
+        comparison->diverged = true;
+        comparison->time_us = 0U;
+        return false;
+    }
+    if(!DecodeTrace(area, FlashTrace(area), &replayed))
+    {
+        printf("%s: the replay left no trace\n", name);
+        comparison->diverged = true;
+        comparison->time_us = 0U;
+        return false;
+    }
+    *comparison = Compare(trace, &replayed, until_us, tolerance_us);
+    printf("%s: %.1f h replayed in %.2f s (%.0fx real time), trace %s, %u motor records match, ", name, result.virtual_us / 3.6e9,
+           host_s, (result.virtual_us / 1e6) / host_s, StateNames[result.state % 4U], (unsigned)comparison->motorRecords);
+    if(comparison->diverged) printf("DIVERGED at %.6f s\n", comparison->time_us / 1e6);
+    else printf("no divergence%s\n", comparison->identical ? ", all records identical" : "");
+
+    if(comparison->diverged)
+    {
+        /* Context of the divergence - the recorded records around it and what the replay did */
+        for(uint32_t e = 0; e < trace->numOfEvents; e++)
+        {
+            const TraceEvent_t *event = &trace->events[e];
+            if((event->time_us + 2000000ULL >= comparison->time_us) && (event->time_us <= comparison->time_us + 1000000ULL))
+                printf("    recorded %12.6f s %-9s %3u %u\n", event->time_us / 1e6, TypeNames[event->type % 6U], event->id, (unsigned)event->value);
+        }
+        for(uint32_t e = 0; e < replayed.numOfEvents; e++)
+        {
+            const TraceEvent_t *event = &replayed.events[e];
+            if((event->type == TRACE_MOTOR) && (event->time_us + 2000000ULL >= comparison->time_us) && (event->time_us <= comparison->time_us + 1000000ULL))
+                printf("    replayed %12.6f s %-9s %3u %u\n", event->time_us / 1e6, TypeNames[event->type % 6U], event->id, (unsigned)event->value);
+        }
+    }
+    free(replayed.events);
+    return !comparison->diverged;
+}
+
+static int SelfTest(const char *savePath)
+{
+    static uint8_t area[BOOT_TRACE_SIZE];
+    RunResult_t result;
+    Trace_t trace;
+    Comparison_t comparison;
+    double host_s;
+
+    if(!RunProcess(NULL, 0U, &result, &host_s) || !DecodeTrace(area, FlashTrace(area), &trace))
+    {
+        printf("capture failed\n");
+        return 1;
+    }
+    printf("capture: %u days in %.2f s, trace %s\n", CAPTURE_DAYS, host_s, StateNames[result.state % 4U]);
+    PrintTrace("capture", &trace);
+    if(savePath != NULL)
+    {
+        FILE *file = fopen(savePath, "wb");
+        if((file == NULL) || (fwrite(area, 1, sizeof(area), file) != sizeof(area))) perror(savePath);
+        if(file != NULL) fclose(file);
+    }
+
+    bool ok = ReplayAndCompare("replay", &trace, NO_TIME, 0U, &comparison) && comparison.identical;
+
+    /* The first button press of the second day dropped - the replay has to diverge at its motor start */
+    uint32_t dropped = trace.numOfEvents;
+    for(uint32_t e = 0; e < trace.numOfEvents; e++)
+    {
+        const TraceEvent_t *event = &trace.events[e];
+        if((event->type == TRACE_GPIO_EDGE) && (event->time_us >= 86400ULL * 1000000ULL) &&
+           ((event->id == BUTTON_UP) || (event->id == BUTTON_DOWN)) && (event->value == GPIO_IRQ_EDGE_RISE))
+        {
+            dropped = e;
+            break;
+        }
+    }
+    if(dropped == trace.numOfEvents)
+    {
+        printf("no button press on the second day\n");
+        return 1;
+    }
+    uint64_t dropped_us = trace.events[dropped].time_us;
+    uint32_t droppedGpio = trace.events[dropped].id;
+    printf("perturbed: button press (GPIO %u) at %.6f s dropped\n", droppedGpio, dropped_us / 1e6);
+    /* With its bounce - the adaptive debounce (Debounce.c) takes the edges after the first one, the press would only start later */
+    uint32_t kept = dropped;
+    for(uint32_t e = dropped; e < trace.numOfEvents; e++)
+    {
+        const TraceEvent_t *event = &trace.events[e];
+        if((event->type == TRACE_GPIO_EDGE) && (event->id == droppedGpio) && (event->time_us < dropped_us + DEBOUNCING_DELAY_IN_US)) continue;
+        trace.events[kept++] = *event;
+    }
+    trace.numOfEvents = kept;
+    ReplayAndCompare("perturbed replay", &trace, NO_TIME, 0U, &comparison);
+    bool detected = comparison.diverged && (comparison.time_us >= dropped_us) && (comparison.time_us < dropped_us + 1000000ULL);
+    printf("divergence %s\n", detected ? "detected at the dropped press" : "NOT DETECTED where expected");
+
+    free(trace.events);
+    return (ok && detected) ? 0 : 1;
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL, *savePath = NULL;
+    uint64_t until_us = NO_TIME, tolerance_us = DEFAULT_TOLERANCE_US;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--until") == 0) && ((i + 1) < argc)) until_us = (uint64_t)(atof(argv[++i]) * 1e6);
+        else if((strcmp(argv[i], "--tolerance") == 0) && ((i + 1) < argc)) tolerance_us = strtoull(argv[++i], NULL, 10);
+        else if((strcmp(argv[i], "--save") == 0) && ((i + 1) < argc)) savePath = argv[++i];
+        else if((argv[i][0] != '-') && (path == NULL)) path = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [TRACE.bin [--until SECONDS] [--tolerance US]] | [--save TRACE.bin]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* Touched before the first fork - the flash is shared with the capture/replay processes */
+    (void)HostSim_Flash();
+    if(path == NULL)
+    {
+        return SelfTest(savePath);
+    }
+
+    static uint8_t area[BOOT_TRACE_SIZE];
+    FILE *file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    uint32_t length = (uint32_t)fread(area, 1, sizeof(area), file);
+    fclose(file);
+
+    Trace_t trace;
+    Comparison_t comparison;
+    if(!DecodeTrace(area, length, &trace))
+    {
+        fprintf(stderr, "%s: not a trace\n", path);
+        return 1;
+    }
+    if((trace.header.channels != BLINDS_NUM_OF_CHANNELS) || (trace.header.features != TRACE_FEATURES))
+    {
+        fprintf(stderr, "%s: recorded by an image with %u channels and features 0x%x - this replay has %u and 0x%x\n", path,
+                (unsigned)trace.header.channels, (unsigned)trace.header.features, (unsigned)BLINDS_NUM_OF_CHANNELS, (unsigned)TRACE_FEATURES);
+        return 1;
+    }
+    PrintTrace(path, &trace);
+    return ReplayAndCompare("replay", &trace, until_us, tolerance_us, &comparison) ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/* WatchdogRecovery.c - crash recovery scenarios of the watchdog service.
+
+   A task is made to hang (busy loop - e.g. stuck in an I2C transfer) in the middle of a move. The watchdog resets the chip,
+   the next firmware image boots in a fresh process with what survives a reset (virtual time, inputs, DS1307, watchdog
+   scratch registers) and takes the fast path: no startup delay, no RTC setup, the interrupted move resumed or aborted.
+
+   Reported per boot: what the firmware read from the scratch registers, the time from the hang until the H-bridge was
+   off and until the reset, and the time from the reset until the resumed move had the motor running again.
+
+   Usage: WatchdogRecovery
+   Exits with 1 if a scenario did not reset/resume/abort as expected or the recovery took longer than MAX_RECOVERY_US. */
+
+/*---------------- INCLUDES ----------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* HostSim includes */
+#include "HostSim.h"
+
+/* Firmware includes */
+#include "ElectronicBlinds_Main.h"
+#include "AutomaticControlTask.h"
+#include "MotorControllerTask.h"
+#include "Watchdog.h"
+
+/*---------------- LOCAL MACROS ----------------------*/
+#define MAX_BOOTS               (6U)
+#define MAX_EVENTS              (4U)
+#define MAX_RECOVERY_US         (300000ULL)  /* from the reset until the resumed move runs again */
+#define NO_TIME                 (UINT64_MAX)
+
+/*---------------- LOCAL DATA TYPES ----------------------*/
+
+/* Input change at an absolute time of the scenario */
+typedef struct
+{
+    uint32_t time_ms;
+    uint32_t gpio;
+    bool level;
+}InputEvent_t;
+
+typedef struct
+{
+    const char *name;
+    uint8_t isClosed;               /* blinds state stored in the RTC - closed at midday: the automatic opening starts at boot */
+    InputEvent_t events[MAX_EVENTS];
+    uint32_t numOfEvents;
+    const char *hangTask;
+    uint32_t hangAfterBoot_ms;
+    uint32_t hangBoots;             /* the hang is injected in this many boots */
+    uint32_t end_ms;
+    uint32_t expectedResets;
+    uint32_t expectedResumes;       /* boots that resumed the interrupted move */
+}Scenario_t;
+
+typedef struct
+{
+    bool reset;                     /* the boot ended by a watchdog reset */
+    HostSim_PersistentState_t state;
+    uint64_t bootStart_us;
+    uint64_t hang_us;
+    uint64_t firstMotorOn_us;       /* first motor start after the boot */
+    uint64_t lastMotorOff_us;       /* last time the outputs went off */
+    bool motorOnAtEnd;
+    WatchdogRecord_t record;        /* what the firmware read from the scratch registers at the boot */
+}BootResult_t;
+
+/* What the process of a boot gets */
+typedef struct
+{
+    const Scenario_t *scenario;
+    uint32_t boot;
+    const HostSim_PersistentState_t *state;     /* of the boot before, unused by the first */
+}BootRun_t;
+
+/*---------------- FILE-SCOPE, STATIC STORAGE DURATION VARIABLES (DECL & DEF) ----------------------*/
+
+static const Scenario_t Scenarios[] =
+{
+    /* Automatic opening, ButtonTask hangs - the opening resumes after the reset and ends at the top limit switch */
+    { "auto_open_button_hang",   BLINDS_CLOSED, { {20000, BUTTON_TOP_LIMIT, true}, {20050, BUTTON_TOP_LIMIT, false} }, 2,
+      "ButtonTask", 6000, 1, 30000, 1, 1 },
+    /* Automatic opening, MotorControllerTask hangs with the motor on */
+    { "auto_open_motor_hang",    BLINDS_CLOSED, { {20000, BUTTON_TOP_LIMIT, true}, {20050, BUTTON_TOP_LIMIT, false} }, 2,
+      "MotorControllerTask", 6000, 1, 30000, 1, 1 },
+    /* Manual move (Down held), MotorControllerTask hangs - the move is aborted, the button is still held but needs a new press */
+    { "manual_down_hang",        BLINDS_OPEN,   { {5000, BUTTON_DOWN, true}, {25000, BUTTON_DOWN, false} }, 2,
+      "MotorControllerTask", 8000, 1, 30000, 1, 0 },
+    /* Crash loop - the move is resumed WATCHDOG_MAX_RESUMES times, then aborted */
+    { "crash_loop",              BLINDS_CLOSED, { {0} }, 0,
+      "ButtonTask", 5000, MAX_BOOTS, 60000, MAX_BOOTS, WATCHDOG_MAX_RESUMES },
+};
+
+static BootResult_t Result;
+
+/*---------------- LOCAL FUNCTION DEFINITIONS ----------------------*/
+
+static void CollectMotorLog(void)
+{
+    const HostSim_MotorEvent_t *log;
+    uint32_t length = HostSim_GetMotorLog(&log);
+
+    Result.firstMotorOn_us = NO_TIME;
+    Result.lastMotorOff_us = NO_TIME;
+    for(uint32_t i = 0; i < length; i++)
+    {
+        bool on = log[i].motorControl1 || log[i].motorControl2;
+        if(on && (Result.firstMotorOn_us == NO_TIME)) Result.firstMotorOn_us = log[i].time_us;
+        if(!on) Result.lastMotorOff_us = log[i].time_us;
+    }
+    Result.motorOnAtEnd = (length > 0U) && (log[length - 1U].motorControl1 || log[length - 1U].motorControl2);
+    Result.record = WatchdogLastReset;
+}
+
+static void RebootHook(const HostSim_PersistentState_t *state)
+{
+    CollectMotorLog();
+    Result.reset = true;
+    Result.state = *state;
+    HostSim_IsolatedResult(&Result);
+}
+
+/* One boot in its own process - the result in Result, sent at the end or by the reboot hook */
+static void RunBoot(const void *context, void *output)
+{
+    const BootRun_t *run = context;
+    const Scenario_t *scenario = run->scenario;
+    uint32_t boot = run->boot;
+
+    (void)output;
+    if(boot == 0U)
+    {
+        HostSim_RtcSetTime(2026, 6, 15, 12, 0, 0);
+        HostSim_RtcWriteRegister(DS1307_REG_ADDR_IS_CLOSED, scenario->isClosed);
+    }
+    else
+    {
+        HostSim_RestoreState(run->state);
+    }
+    Result.bootStart_us = HostSim_NowUs();
+    Result.hang_us = NO_TIME;
+    if(boot < scenario->hangBoots)
+    {
+        Result.hang_us = Result.bootStart_us + scenario->hangAfterBoot_ms * 1000ULL;
+        HostSim_HangTask(scenario->hangTask, Result.hang_us);
+    }
+    HostSim_SetRebootHook(RebootHook);
+    HostSim_Boot();
+
+    for(uint32_t e = 0; e < scenario->numOfEvents; e++)
+    {
+        uint64_t time_us = scenario->events[e].time_ms * 1000ULL;
+        if(time_us < Result.bootStart_us) continue; /* before this boot - the input level survived the reset */
+        HostSim_RunUntilUs(time_us);
+        HostSim_SetInput(scenario->events[e].gpio, scenario->events[e].level);
+    }
+    HostSim_RunUntilUs(scenario->end_ms * 1000ULL);
+
+    CollectMotorLog();
+    Result.reset = false;
+    HostSim_IsolatedResult(&Result);
+}
+
+static bool RunBootProcess(const Scenario_t *scenario, uint32_t boot, const HostSim_PersistentState_t *state, BootResult_t *result)
+{
+    BootRun_t run = { scenario, boot, state };
+    return HostSim_RunIsolated(RunBoot, &run, result, sizeof(*result));
+}
+
+static const char* ClientName(uint32_t client)
+{
+    static const char *const names[WATCHDOG_NUM_OF_CLIENTS] = { "ButtonTask", "MotorControllerTask", "AutomaticControlTask", "MotionSensorTask",
+                                                                      "UsbLinkTask" };
+    return (client < WATCHDOG_NUM_OF_CLIENTS) ? names[client] : "?";
+}
+
+static void PrintTime(uint64_t from_us, uint64_t to_us)
+{
+    if((from_us == NO_TIME) || (to_us == NO_TIME) || (to_us < from_us)) printf(" %10s", "-");
+    else printf(" %8.1fms", (to_us - from_us) / 1000.0);
+}
+
+/*---------------- GLOBAL FUNCTION DEFINITIONS ----------------------*/
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    for(uint32_t s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++)
+    {
+        const Scenario_t *scenario = &Scenarios[s];
+        HostSim_PersistentState_t state;
+        BootResult_t result;
+        uint32_t resets = 0, resumes = 0;
+        bool ok = true;
+
+        printf("%s (%s hangs %u ms after the boot)\n", scenario->name, scenario->hangTask, (unsigned)scenario->hangAfterBoot_ms);
+        printf("  %4s %9s %-28s %7s %8s %10s %10s %10s %10s\n", "boot", "at", "record (cause, client)", "resets", "resumed",
+               "boot->on", "hang->off", "hang->rst", "end");
+        for(uint32_t boot = 0; boot < MAX_BOOTS; boot++)
+        {
+            if(!RunBootProcess(scenario, boot, &state, &result))
+            {
+                printf("  %4u simulation crashed\n", (unsigned)boot);
+                ok = false;
+                break;
+            }
+
+            char record[40];
+            if(result.record.valid)
+            {
+                snprintf(record, sizeof(record), "%s, %s", (result.record.cause == WATCHDOG_CAUSE_CHECKIN) ? "check-in" : "timeout",
+                         ClientName(result.record.client));
+            }
+            else snprintf(record, sizeof(record), "power-on");
+            if(result.record.resumedMoves != 0U) resumes++;
+
+            /* A resumed move has to run again quickly after the reset */
+            if((boot > 0U) && (result.record.resumedMoves != 0U) &&
+               ((result.firstMotorOn_us == NO_TIME) || ((result.firstMotorOn_us - result.bootStart_us) > MAX_RECOVERY_US))) ok = false;
+            /* An aborted move must not start the motor again */
+            if((boot > 0U) && (result.record.resumedMoves == 0U) && (result.firstMotorOn_us != NO_TIME)) ok = false;
+
+            printf("  %4u %8.3fs %-28s %7u %8s", (unsigned)boot, result.bootStart_us / 1e6, record, (unsigned)result.record.resets,
+                   (result.record.resumedMoves != 0U) ? "yes" : "no");
+            PrintTime(result.bootStart_us, result.firstMotorOn_us);
+            PrintTime(result.hang_us, result.lastMotorOff_us);
+            PrintTime(result.hang_us, result.reset ? result.state.time_us : NO_TIME);
+            printf(" %10s\n", result.reset ? "reset" : (result.motorOnAtEnd ? "motor on" : "motor off"));
+
+            if(!result.reset) break;
+            resets++;
+            state = result.state;
+        }
+
+        ok = ok && (resets == scenario->expectedResets) && (resumes == scenario->expectedResumes) && !result.motorOnAtEnd;
+        printf("  resets %u (expected %u), resumed %u (expected %u): %s\n\n", (unsigned)resets, (unsigned)scenario->expectedResets,
+               (unsigned)resumes, (unsigned)scenario->expectedResumes, ok ? "ok" : "UNEXPECTED");
+        if(!ok) failures++;
+    }
+
+    return (failures == 0U) ? 0 : 1;
+}